@@ -19,14 +19,31 @@ FILE
     bundled into "groups" for more general storage.
 
     The groups are stored in an array of pointers to store each group in an
-    element. Each "atomic group" node contains a link to a hash table to
-    manage the atoms in each group.  The allowed "atomic groups" are stored
-    in an enum (called group_t) in atom_priv.h.
+    element. Each "atomic group" node contains an open-addressed hash table
+    (linear probing) holding the atom and object of every atom in the group.
+    A removed atom's slot is marked as removed rather than emptied, and is
+    reused by a later atom.  The table is built again, twice the size if
+    need be, when half of its slots are in use or removed, so a lookup only
+    ever looks at a few slots.  Atom indices come from a per-group counter
+    which is never reset, so an atom which has been removed (e.g. the ID of
+    a closed file) doesn't match a later atom, even if the group has been
+    destroyed and initialized again in between.  The allowed "atomic
+    groups" are stored in an enum (called group_t) in atom_priv.h.
+
+    Looking up an atom takes no lock.  In the thread-safe library the
+    changes to a group are serialized by a mutex, and each change is made
+    so that a lookup running alongside it still finds every atom which
+    isn't being removed: an atom never moves within a table, slots are
+    written with atomic stores, and a table which is built again replaces
+    the old one with a single atomic store of the pointer to it.  An old
+    table is only freed once no lookup is running in its group, which is
+    kept track of by a count of the lookups under way in each group.
 
 */
 
 #include "hdf_priv.h"
 #include "atom_priv.h"
+#include "hthread_priv.h"
 
 /******************
  * Private macros *
@@ -50,17 +67,56 @@ FILE
 #define MAKE_ATOM(g, i)                                                                                      \
     ((((atom_t)(g) & GROUP_MASK) << ((sizeof(atom_t) * 8) - GROUP_BITS)) | ((atom_t)(i) & ATOM_MASK))
 
-/* # of previous atoms cached, change HAatom_object & SWAP_CACHE if this changes */
-#define ATOM_CACHE_SIZE 4
+/* Mark an unused slot and the slot of a removed atom in a group's hash table
+   (neither is a valid atom) */
+#define EMPTY_ATOM   ((atom_t)-1)
+#define REMOVED_ATOM ((atom_t)-2)
 
-/* Swap cache elements using XOR operator. Ugly but fast... */
-#define SWAP_CACHE(i, j)                                                                                     \
-    atom_id_cache[i] ^= atom_id_cache[j],                                                                    \
-        atom_obj_cache[i] = (void *)((intptr_t)atom_obj_cache[j] ^ (intptr_t)atom_obj_cache[i]),             \
-        atom_id_cache[j] ^= atom_id_cache[i],                                                                \
-        atom_obj_cache[j] = (void *)((intptr_t)atom_obj_cache[i] ^ (intptr_t)atom_obj_cache[j]),             \
-        atom_id_cache[i] ^= atom_id_cache[j],                                                                \
-        atom_obj_cache[i] = (void *)((intptr_t)atom_obj_cache[i] ^ (intptr_t)atom_obj_cache[j])
+/*
+ * Lock on the changes to the atom groups.  It's the innermost lock, so
+ * nothing else is locked while it's held.  Lookups don't take it; what they
+ * read while a group may be changed is read and written with the atomic
+ * operations below.  A lookup counts itself in its group before it reads the
+ * group's table pointer, and a change frees the tables it replaced only when
+ * it finds no lookup counted after it has stored the new pointer.  Those four
+ * are sequentially consistent, so a lookup the change doesn't see counted
+ * reads the new pointer.
+ */
+#ifdef H4_HAVE_THREADSAFE
+static pthread_mutex_t atom_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define HA_LOCK()   pthread_mutex_lock(&atom_lock)
+#define HA_UNLOCK() pthread_mutex_unlock(&atom_lock)
+
+#define HA_LOAD(x)             __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define HA_LOAD_RELAXED(x)     __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define HA_STORE(x, v)         __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#define HA_STORE_RELAXED(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#define HA_ACQUIRE_FENCE()     __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define HA_RELEASE_FENCE()     __atomic_thread_fence(__ATOMIC_RELEASE)
+
+#define HA_ENTER(g)        ((void)__atomic_add_fetch(&(g)->readers, 1, __ATOMIC_SEQ_CST))
+#define HA_LEAVE(g)        ((void)__atomic_sub_fetch(&(g)->readers, 1, __ATOMIC_RELEASE))
+#define HA_GET_TABLE(g)    __atomic_load_n(&(g)->table, __ATOMIC_SEQ_CST)
+#define HA_SET_TABLE(g, t) __atomic_store_n(&(g)->table, (t), __ATOMIC_SEQ_CST)
+#define HA_IDLE(g)         (__atomic_load_n(&(g)->readers, __ATOMIC_SEQ_CST) == 0)
+#else
+#define HA_LOCK()   ((void)0)
+#define HA_UNLOCK() ((void)0)
+
+#define HA_LOAD(x)             (x)
+#define HA_LOAD_RELAXED(x)     (x)
+#define HA_STORE(x, v)         ((x) = (v))
+#define HA_STORE_RELAXED(x, v) ((x) = (v))
+#define HA_ACQUIRE_FENCE()     ((void)0)
+#define HA_RELEASE_FENCE()     ((void)0)
+
+#define HA_ENTER(g)        ((void)0)
+#define HA_LEAVE(g)        ((void)0)
+#define HA_GET_TABLE(g)    ((g)->table)
+#define HA_SET_TABLE(g, t) ((g)->table = (t))
+#define HA_IDLE(g)         TRUE
+#endif
 
 /********************
  * Private typedefs *
@@ -68,51 +124,48 @@ FILE
 
 /* Atom information structure used */
 typedef struct atom_info_struct_tag {
-    atom_t                       id;      /* atom ID for this info */
-    void                       **obj_ptr; /* pointer associated with the atom */
-    struct atom_info_struct_tag *next;    /* link to next atom (in case of hash-clash) */
+    atom_t id;      /* atom ID for this info, EMPTY_ATOM or REMOVED_ATOM for an unused slot */
+    void  *obj_ptr; /* pointer associated with the atom */
 } atom_info_t;
 
+/* Hash table of the atoms of a group; it's replaced as a whole, never resized */
+typedef struct atom_table_struct_tag {
+    unsigned                      hash_size; /* # of slots, a power of 2 */
+    struct atom_table_struct_tag *next;      /* next replaced table waiting to be freed */
+    atom_info_t                   slots[];   /* the slots */
+} atom_table_t;
+
 /* Atom group structure used */
 typedef struct atom_group_struct_tag {
-    unsigned      count;     /* # of times this group has been initialized */
-    unsigned      hash_size; /* size of the hash table to store the atoms in */
-    unsigned      atoms;     /* current number of atoms held */
-    unsigned      nextid;    /* atom ID to use for the next atom */
-    atom_info_t **atom_list; /* pointer to an array of ptrs to atoms */
+    unsigned      count;   /* # of times this group has been initialized */
+    unsigned      atoms;   /* current number of atoms held */
+    unsigned      removed; /* # of slots of removed atoms */
+    unsigned      nextid;  /* atom ID to use for the next atom */
+    unsigned      readers; /* # of lookups under way in the group */
+    atom_table_t *table;   /* hash table of atoms, NULL while the group isn't initialized */
+    atom_table_t *retired; /* replaced tables, freed when no lookup is under way */
 } atom_group_t;
 
 /********************
  * Global variables *
  ********************/
 
-/* Array of pointers to atomic groups */
+/* Array of pointers to atomic groups; a group is never freed before HAshutdown */
 static atom_group_t *atom_group_list[MAXGROUP] = {NULL};
 
-/* Pointer to the atom node free list */
-static atom_info_t *atom_free_list = NULL;
-
-/* Atom cache arrays
- *
- * One of the arrays holds the atoms and the other holds the objects the
- * atoms point to. These MUST be kept in sync!
- */
-static atom_t atom_id_cache[ATOM_CACHE_SIZE]  = {-1, -1, -1, -1};
-static void  *atom_obj_cache[ATOM_CACHE_SIZE] = {NULL, NULL, NULL, NULL};
-
 /*******************************
  * Private function prototypes *
  *******************************/
 
-static void *HAIatom_object(atom_t atm);
-
 static atom_info_t *HAIfind_atom(atom_t atm);
 
-static atom_info_t *HAIget_atom_node(void);
+static int HAIlookup_atom(atom_table_t *tbl, atom_t atm, void **obj);
+
+static atom_table_t *HAIalloc_table(unsigned hash_size);
 
-static void HAIrelease_atom_node(atom_info_t *atm);
+static int HAIrebuild_group(atom_group_t *grp_ptr);
 
-static void HAIfree_atom_list(atom_info_t *info);
+static void HAIretire_table(atom_group_t *grp_ptr, atom_table_t *tbl);
 
 /******************************************************************************
  NAME
@@ -132,10 +185,13 @@ HAinit_group(group_t  grp,      /* IN: Group to initialize */
              unsigned hash_size /* IN: Minimum hash table size to use for group */
 )
 {
-    atom_group_t *grp_ptr   = NULL; /* ptr to the atomic group */
+    atom_group_t *grp_ptr   = NULL;  /* ptr to the atomic group */
+    atom_table_t *tbl       = NULL;  /* the group's new hash table */
+    int           new_grp   = FALSE; /* whether the group info was allocated here */
     int           ret_value = SUCCEED;
 
     HEclear();
+    HA_LOCK();
 
     if (grp <= BADGROUP || grp >= MAXGROUP || hash_size == 0)
         HGOTO_ERROR(DFE_ARGS, FAIL);
@@ -143,40 +199,40 @@ HAinit_group(group_t  grp,      /* IN: Group to initialize */
     if ((hash_size & (hash_size - 1)) != 0)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
-    /* Assertion necessary for faster pointer swapping */
-    assert(sizeof(hdf_pint_t) == sizeof(void *));
-
     if (atom_group_list[grp] == NULL) {
         /* Allocate the group information */
         grp_ptr = (atom_group_t *)calloc(1, sizeof(atom_group_t));
         if (grp_ptr == NULL)
             HGOTO_ERROR(DFE_NOSPACE, FAIL);
-        atom_group_list[grp] = grp_ptr;
+        new_grp = TRUE;
     }
     else /* Get the pointer to the existing group */
         grp_ptr = atom_group_list[grp];
 
     if (grp_ptr->count == 0) {
-        /* Initialize the atom group structure */
-        grp_ptr->hash_size = hash_size;
-        grp_ptr->atoms     = 0;
-        grp_ptr->nextid    = 0;
-        if ((grp_ptr->atom_list = (atom_info_t **)calloc(hash_size, sizeof(atom_info_t *))) == NULL)
+        /* Initialize the atom group structure.  nextid is left alone, so
+           atoms from before the group was last destroyed stay invalid. */
+        grp_ptr->atoms   = 0;
+        grp_ptr->removed = 0;
+        if ((tbl = HAIalloc_table(hash_size)) == NULL)
             HGOTO_ERROR(DFE_NOSPACE, FAIL);
+        HA_SET_TABLE(grp_ptr, tbl);
     }
 
     /* Increment the count of the times this group has been initialized */
     grp_ptr->count++;
 
+    /* Lookups can find a new group from now on */
+    if (new_grp)
+        HA_STORE(atom_group_list[grp], grp_ptr);
+
 done:
     /* Error condition cleanup */
     if (ret_value == FAIL) {
-        if (grp_ptr != NULL) {
-            if (grp_ptr->atom_list != NULL)
-                free(grp_ptr->atom_list);
+        if (new_grp)
             free(grp_ptr);
-        }
     }
+    HA_UNLOCK();
 
     return ret_value;
 } /* end HAinit_group() */
@@ -199,9 +255,11 @@ HAdestroy_group(group_t grp /* IN: Group to destroy */
 )
 {
     atom_group_t *grp_ptr   = NULL; /* ptr to the atomic group */
+    atom_table_t *tbl;              /* the group's hash table */
     int           ret_value = SUCCEED;
 
     HEclear();
+    HA_LOCK();
     if (grp <= BADGROUP || grp >= MAXGROUP)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
@@ -211,17 +269,15 @@ HAdestroy_group(group_t grp /* IN: Group to destroy */
 
     /* Decrement the number of users of the atomic group */
     if ((--(grp_ptr->count)) == 0) {
-        for (unsigned u = 0; u < ATOM_CACHE_SIZE; u++) {
-            if (ATOM_TO_GROUP(atom_id_cache[u]) == grp) {
-                atom_id_cache[u]  = -1;
-                atom_obj_cache[u] = NULL;
-            }
-        }
-        free(grp_ptr->atom_list);
-        grp_ptr->atom_list = NULL;
+        tbl = grp_ptr->table;
+        HA_SET_TABLE(grp_ptr, NULL);
+        grp_ptr->atoms   = 0;
+        grp_ptr->removed = 0;
+        HAIretire_table(grp_ptr, tbl);
     }
 
 done:
+    HA_UNLOCK();
     return ret_value;
 } /* end HAdestroy_group() */
 
@@ -245,13 +301,16 @@ HAregister_atom(group_t grp,   /* IN: Group to register the object in */
                 void   *object /* IN: Object to attach to atom */
 )
 {
-    atom_group_t *grp_ptr = NULL; /* ptr to the atomic group */
-    atom_info_t  *atm_ptr = NULL; /* ptr to the new atom */
-    atom_t        atm_id;         /* new atom ID */
-    unsigned      hash_loc;       /* new item's hash table location */
+    atom_group_t *grp_ptr  = NULL; /* ptr to the atomic group */
+    atom_table_t *tbl      = NULL; /* the group's hash table */
+    atom_info_t  *atm_ptr  = NULL; /* ptr to the slot being checked */
+    atom_info_t  *free_ptr = NULL; /* ptr to the new atom's slot */
+    atom_t        atm_id;          /* new atom ID */
+    unsigned      hash_loc;        /* new item's hash table location */
     atom_t        ret_value = SUCCEED;
 
     HEclear();
+    HA_LOCK();
     if (grp <= BADGROUP || grp >= MAXGROUP)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
@@ -259,30 +318,46 @@ HAregister_atom(group_t grp,   /* IN: Group to register the object in */
     if (grp_ptr == NULL || grp_ptr->count <= 0)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
-    if ((atm_ptr = HAIget_atom_node()) == NULL)
-        HGOTO_ERROR(DFE_NOSPACE, FAIL);
-
-    /* Create the atom & it's ID */
-    atm_id           = MAKE_ATOM(grp, grp_ptr->nextid);
-    atm_ptr->id      = atm_id;
-    atm_ptr->obj_ptr = object;
-    atm_ptr->next    = NULL;
-
-    /* Simple mod operation to find hash bucket */
-    hash_loc = grp_ptr->nextid % grp_ptr->hash_size;
-
-    /* Hash bucket already contains linked list nodes, prepend to front */
-    if (grp_ptr->atom_list[hash_loc] != NULL)
-        atm_ptr->next = grp_ptr->atom_list[hash_loc];
-
-    /* Insert into the group */
-    grp_ptr->atom_list[hash_loc] = atm_ptr;
+    /* Keep at most half of the slots in use or removed */
+    if (2 * (grp_ptr->atoms + grp_ptr->removed + 1) > grp_ptr->table->hash_size)
+        if (HAIrebuild_group(grp_ptr) == FAIL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    tbl = grp_ptr->table;
+
+    /* Create the atom & it's ID, skipping any ID still in use after the
+       atom index has wrapped around */
+    do {
+        atm_id = MAKE_ATOM(grp, grp_ptr->nextid);
+        grp_ptr->nextid++;
+
+        /* Probe for an unused slot, taking the first removed atom's slot on
+           the way, but only once it's certain the ID isn't in use */
+        free_ptr = NULL;
+        hash_loc = ATOM_TO_LOC(atm_id, tbl->hash_size);
+        for (atm_ptr = &tbl->slots[hash_loc]; atm_ptr->id != EMPTY_ATOM && atm_ptr->id != atm_id;
+             atm_ptr = &tbl->slots[hash_loc]) {
+            if (atm_ptr->id == REMOVED_ATOM && free_ptr == NULL)
+                free_ptr = atm_ptr;
+            hash_loc = (hash_loc + 1) & (tbl->hash_size - 1);
+        }
+    } while (atm_ptr->id == atm_id);
+
+    if (free_ptr == NULL)
+        free_ptr = atm_ptr;
+    else
+        grp_ptr->removed--;
+
+    /* Insert into the group.  A lookup which reads the object of an atom
+       removed from the slot reads the slot's new ID after it. */
+    HA_RELEASE_FENCE();
+    HA_STORE_RELAXED(free_ptr->obj_ptr, object);
+    HA_STORE(free_ptr->id, atm_id);
     grp_ptr->atoms++;
-    grp_ptr->nextid++;
 
     ret_value = atm_id;
 
 done:
+    HA_UNLOCK();
     return ret_value;
 } /* end HAregister_atom() */
 
@@ -291,9 +366,8 @@ done:
      HAatom_object - Returns to the object ptr for the atom
 
  DESCRIPTION
-    Retrieves the object ptr which is associated with the atom. This call
-    first checks the atom cache and reverts to the general lookup if that
-    fails.
+    Retrieves the object ptr which is associated with the atom.  No lock is
+    taken.
 
  RETURNS
     Returns object ptr if successful and NULL otherwise
@@ -301,50 +375,24 @@ done:
 void *
 HAatom_object(atom_t atm)
 {
-    /* This unmaintainable mess was converted from a public macro in atom.h and
-     * should be cleaned up and merged with HAIatom_object()
-     */
-
-    /* Note! This is hardwired to the atom cache size being 4 */
-
-    /* Checks if the atom is in the cache, moving items around as it goes. If
-     * the atom is not found, it does a general lookup via HAIatom_object()
-     * and returns that.
-     */
-    return (atom_id_cache[0] == atm   ? atom_obj_cache[0]
-            : atom_id_cache[1] == atm ? (SWAP_CACHE(0, 1), atom_obj_cache[0])
-            : atom_id_cache[2] == atm ? (SWAP_CACHE(1, 2), atom_obj_cache[1])
-            : atom_id_cache[3] == atm ? (SWAP_CACHE(2, 3), atom_obj_cache[2])
-                                      : HAIatom_object(atm));
-}
-
-/******************************************************************************
- NAME
-     HAIatom_object - Returns to the object ptr for the atom
-
- DESCRIPTION
-    Retrieves the object ptr which is associated with the atom without using
-    the atom cache.
-
- RETURNS
-    Returns object ptr if successful and NULL otherwise
-*******************************************************************************/
-static void *
-HAIatom_object(atom_t atm /* IN: Atom to retrieve object for */
-)
-{
-    atom_info_t *atm_ptr   = NULL; /* ptr to the new atom */
-    void        *ret_value = NULL;
+    atom_group_t *grp_ptr = NULL; /* ptr to the atomic group */
+    group_t       grp;            /* atom's atomic group */
+    int           found;          /* whether the atom is in the group */
+    void         *ret_value = NULL;
 
-    HEclear();
+    grp = ATOM_TO_GROUP(atm);
+    if (grp <= BADGROUP || grp >= MAXGROUP)
+        HGOTO_ERROR(DFE_INTERNAL, NULL);
+    if ((grp_ptr = HA_LOAD(atom_group_list[grp])) == NULL)
+        HGOTO_ERROR(DFE_INTERNAL, NULL);
 
     /* General lookup of the atom */
-    if ((atm_ptr = HAIfind_atom(atm)) == NULL)
-        HGOTO_ERROR(DFE_INTERNAL, NULL);
+    HA_ENTER(grp_ptr);
+    found = HAIlookup_atom(HA_GET_TABLE(grp_ptr), atm, &ret_value);
+    HA_LEAVE(grp_ptr);
 
-    /* Check if we've found the correct atom */
-    if (atm_ptr != NULL)
-        ret_value = atm_ptr->obj_ptr;
+    if (!found)
+        HGOTO_ERROR(DFE_INTERNAL, NULL);
 
 done:
     return ret_value;
@@ -390,65 +438,26 @@ HAremove_atom(atom_t atm /* IN: Atom to remove */
 )
 {
     atom_group_t *grp_ptr = NULL; /* ptr to the atomic group */
-    atom_info_t  *curr_atm;       /* ptr to the current atom */
-    atom_info_t  *last_atm;       /* ptr to the last atom */
-    group_t       grp;            /* atom's atomic group */
-    unsigned      hash_loc;       /* atom's hash table location */
+    atom_info_t  *atm_ptr;        /* ptr to the atom's slot */
     void         *ret_value = NULL;
 
     HEclear();
+    HA_LOCK();
 
-    grp = ATOM_TO_GROUP(atm);
-    if (grp <= BADGROUP || grp >= MAXGROUP)
-        HGOTO_ERROR(DFE_ARGS, NULL);
-
-    grp_ptr = atom_group_list[grp];
-    if (grp_ptr == NULL || grp_ptr->count <= 0)
-        HGOTO_ERROR(DFE_INTERNAL, NULL);
-
-    /* Get the hash bucket in which the atom is located */
-    hash_loc = ATOM_TO_LOC(atm, grp_ptr->hash_size);
-    curr_atm = grp_ptr->atom_list[hash_loc];
-    if (curr_atm == NULL)
-        HGOTO_ERROR(DFE_INTERNAL, NULL);
-
-    /* Iterate through the linked list to find the atom */
-    last_atm = NULL;
-    while (curr_atm != NULL) {
-        if (curr_atm->id == atm)
-            break;
-        last_atm = curr_atm;
-        curr_atm = curr_atm->next;
-    }
-
-    if (curr_atm != NULL) {
-        if (last_atm == NULL) {
-            /* Atom is the first in the list */
-            grp_ptr->atom_list[hash_loc] = curr_atm->next;
-        }
-        else
-            last_atm->next = curr_atm->next;
-        ret_value = curr_atm->obj_ptr;
-        HAIrelease_atom_node(curr_atm);
-    }
-    else /* Couldn't find the atom in the proper place */
+    if ((atm_ptr = HAIfind_atom(atm)) == NULL)
         HGOTO_ERROR(DFE_INTERNAL, NULL);
+    ret_value = atm_ptr->obj_ptr;
 
-    /* Delete object from cache (assumes only be a single instance of the
-     * atom can be stored in the cache)
-     */
-    for (unsigned u = 0; u < ATOM_CACHE_SIZE; u++) {
-        if (atom_id_cache[u] == atm) {
-            atom_id_cache[u]  = -1;
-            atom_obj_cache[u] = NULL;
-            break;
-        }
-    }
+    /* Lookups probe on past the slot, and the atoms in it don't move */
+    HA_STORE_RELAXED(atm_ptr->id, REMOVED_ATOM);
 
     /* Decrement the number of atoms in the group */
+    grp_ptr = atom_group_list[ATOM_TO_GROUP(atm)];
     (grp_ptr->atoms)--;
+    (grp_ptr->removed)++;
 
 done:
+    HA_UNLOCK();
     return ret_value;
 } /* end HAremove_atom() */
 
@@ -460,7 +469,7 @@ done:
     Searches for an object in a group and returns the pointer to it.
     This routine calls the function pointer passed in for each object in the
     group until it finds a match.  Currently there is no way to resume a
-    search.
+    search.  No lock is taken.
 
  RETURNS
     Returns pointer an atom's object if successful and NULL otherwise
@@ -471,27 +480,45 @@ HAsearch_atom(group_t         grp,  /* IN: Group to search for the object in */
               const void     *key   /* IN: pointer to key to compare against */
 )
 {
-    atom_group_t *grp_ptr   = NULL; /* ptr to the atomic group */
-    atom_info_t  *atm_ptr   = NULL; /* ptr to the new atom */
+    atom_group_t *grp_ptr = NULL; /* ptr to the atomic group */
+    atom_table_t *tbl     = NULL; /* the group's hash table */
+    atom_info_t  *atm_ptr = NULL; /* ptr to the current atom's slot */
+    atom_t        atm;            /* the current atom */
+    void         *obj;            /* the current atom's object */
     void         *ret_value = NULL;
 
     HEclear();
     if (grp <= BADGROUP || grp >= MAXGROUP)
         HGOTO_ERROR(DFE_ARGS, NULL);
 
-    grp_ptr = atom_group_list[grp];
-    if (grp_ptr == NULL || grp_ptr->count <= 0)
+    if ((grp_ptr = HA_LOAD(atom_group_list[grp])) == NULL)
+        HGOTO_ERROR(DFE_INTERNAL, NULL);
+
+    HA_ENTER(grp_ptr);
+    if ((tbl = HA_GET_TABLE(grp_ptr)) == NULL) {
+        HA_LEAVE(grp_ptr);
         HGOTO_ERROR(DFE_INTERNAL, NULL);
+    }
 
     /* Start at the beginning of the array */
-    for (unsigned u = 0; u < grp_ptr->hash_size; u++) {
-        atm_ptr = grp_ptr->atom_list[u];
-        while (atm_ptr != NULL) {
-            if ((*func)(atm_ptr->obj_ptr, key))
-                HGOTO_DONE(atm_ptr->obj_ptr); /* found the item we are looking for */
-            atm_ptr = atm_ptr->next;
+    for (unsigned u = 0; u < tbl->hash_size; u++) {
+        atm_ptr = &tbl->slots[u];
+        atm     = HA_LOAD(atm_ptr->id);
+        if (atm == EMPTY_ATOM || atm == REMOVED_ATOM)
+            continue;
+
+        /* Skip the object if the slot was reused while it was read */
+        obj = HA_LOAD_RELAXED(atm_ptr->obj_ptr);
+        HA_ACQUIRE_FENCE();
+        if (HA_LOAD_RELAXED(atm_ptr->id) != atm)
+            continue;
+
+        if ((*func)(obj, key)) {
+            ret_value = obj; /* found the item we are looking for */
+            break;
         }
     }
+    HA_LEAVE(grp_ptr);
 
 done:
     return ret_value;
@@ -502,7 +529,8 @@ done:
      HAIfind_atom - Finds a atom in a group
 
  DESCRIPTION
-    Retrieves the atom ptr which is associated with the atom.
+    Retrieves the slot in the group's hash table which holds the atom.  The
+    atom lock must be held.
 
  RETURNS
     Returns atom ptr if successful and NULL otherwise
@@ -512,112 +540,178 @@ HAIfind_atom(atom_t atm /* IN: Atom to retrieve atom for */
 )
 {
     atom_group_t *grp_ptr = NULL; /* ptr to the atomic group */
-    atom_info_t  *atm_ptr = NULL; /* ptr to the new atom */
+    atom_table_t *tbl     = NULL; /* the group's hash table */
+    atom_info_t  *atm_ptr = NULL; /* ptr to the current atom's slot */
     group_t       grp;            /* atom's atomic group */
     unsigned      hash_loc;       /* atom's hash table location */
-    atom_info_t  *ret_value = NULL;
 
-    HEclear();
     grp = ATOM_TO_GROUP(atm);
     if (grp <= BADGROUP || grp >= MAXGROUP)
-        HGOTO_ERROR(DFE_ARGS, NULL);
+        return NULL;
 
     grp_ptr = atom_group_list[grp];
     if (grp_ptr == NULL || grp_ptr->count <= 0)
-        HGOTO_ERROR(DFE_INTERNAL, NULL);
-
-    /* Get the location in which the atom is located */
-    hash_loc = ATOM_TO_LOC(atm, grp_ptr->hash_size);
-    atm_ptr  = grp_ptr->atom_list[hash_loc];
-    if (atm_ptr == NULL)
-        HGOTO_ERROR(DFE_INTERNAL, NULL);
+        return NULL;
+    tbl = grp_ptr->table;
 
-    while (atm_ptr != NULL) {
+    /* Probe from the atom's home location until the atom or an unused slot */
+    hash_loc = ATOM_TO_LOC(atm, tbl->hash_size);
+    for (atm_ptr = &tbl->slots[hash_loc]; atm_ptr->id != EMPTY_ATOM; atm_ptr = &tbl->slots[hash_loc]) {
         if (atm_ptr->id == atm)
-            break;
-        atm_ptr = atm_ptr->next;
-    }
-
-    if (atm_ptr) {
-        /* if found, add it to the end of the cached list */
-        atom_id_cache[ATOM_CACHE_SIZE - 1]  = atm;
-        atom_obj_cache[ATOM_CACHE_SIZE - 1] = atm_ptr->obj_ptr;
+            return atm_ptr;
+        hash_loc = (hash_loc + 1) & (tbl->hash_size - 1);
     }
 
-    ret_value = atm_ptr;
-
-done:
-    return ret_value;
+    return NULL;
 } /* end HAIfind_atom() */
 
 /******************************************************************************
  NAME
-     HAIget_atom_node - Gets an atom node
+     HAIlookup_atom - Looks up the object of an atom without a lock
 
  DESCRIPTION
-    Either gets an atom node from the free list (if there is one available)
-    or allocate a node.
+    Gets the object of the atom out of a group's hash table, which may be
+    changed while it's read.  The caller is counted in the group's lookups.
 
  RETURNS
-    Returns atom ptr if successful and NULL otherwise
+    Returns TRUE and the object in *obj if the atom is in the table and FALSE
+    otherwise
 *******************************************************************************/
-static atom_info_t *
-HAIget_atom_node(void)
+static int
+HAIlookup_atom(atom_table_t *tbl, /* IN: hash table of the atom's group, or NULL */
+               atom_t        atm, /* IN: Atom to look up */
+               void        **obj  /* OUT: the atom's object */
+)
 {
-    atom_info_t *ret_value = NULL;
-
-    HEclear();
-    if (atom_free_list != NULL) {
-        ret_value      = atom_free_list;
-        atom_free_list = atom_free_list->next;
+    atom_info_t *atm_ptr; /* ptr to the current atom's slot */
+    atom_t       id;      /* atom in the current slot */
+    unsigned     hash_loc;
+
+    if (tbl == NULL)
+        return FALSE;
+
+    /* Probe from the atom's home location until the atom or an unused slot */
+    for (hash_loc = ATOM_TO_LOC(atm, tbl->hash_size);; hash_loc = (hash_loc + 1) & (tbl->hash_size - 1)) {
+        atm_ptr = &tbl->slots[hash_loc];
+        if ((id = HA_LOAD(atm_ptr->id)) == EMPTY_ATOM)
+            return FALSE;
+        if (id == atm) {
+            /* The object is the atom's only if the slot still holds the atom
+               after the object is read; it may have been removed and the
+               slot reused meanwhile */
+            *obj = HA_LOAD_RELAXED(atm_ptr->obj_ptr);
+            HA_ACQUIRE_FENCE();
+            return HA_LOAD_RELAXED(atm_ptr->id) == atm;
+        }
     }
-    else {
-        if ((ret_value = (atom_info_t *)malloc(sizeof(atom_info_t))) == NULL)
-            HGOTO_ERROR(DFE_NOSPACE, NULL);
+} /* end HAIlookup_atom() */
+
+/******************************************************************************
+ NAME
+     HAIalloc_table - Allocates an empty hash table of atoms
+
+ DESCRIPTION
+    Allocates a hash table with every slot unused.
+
+ RETURNS
+    Returns the hash table if successful and NULL otherwise
+*******************************************************************************/
+static atom_table_t *
+HAIalloc_table(unsigned hash_size /* IN: # of slots (a power of 2) */
+)
+{
+    atom_table_t *ret_value = NULL;
+
+    if ((ret_value = (atom_table_t *)malloc(sizeof(atom_table_t) + hash_size * sizeof(atom_info_t))) == NULL)
+        return NULL;
+    ret_value->hash_size = hash_size;
+    ret_value->next      = NULL;
+    for (unsigned u = 0; u < hash_size; u++) {
+        ret_value->slots[u].id      = EMPTY_ATOM;
+        ret_value->slots[u].obj_ptr = NULL;
     }
 
-done:
-    memset(ret_value, 0, sizeof(atom_info_t));
     return ret_value;
-} /* end HAIget_atom_node() */
+} /* end HAIalloc_table() */
 
 /******************************************************************************
  NAME
-     HAIrelease_atom_node - Releases an atom node
+     HAIrebuild_group - Builds a group's hash table again
 
  DESCRIPTION
-    Puts an atom node into the free list
+    Moves every atom in the group into a new hash table without the slots of
+    removed atoms, twice the size of the current one if the atoms would fill
+    more than a quarter of a table of the current size.  The current table
+    is freed when no lookup can be reading it any more.
 
  RETURNS
-    No return value
+    Returns SUCCEED if successful and FAIL otherwise
 *******************************************************************************/
-static void
-HAIrelease_atom_node(atom_info_t *atm)
+static int
+HAIrebuild_group(atom_group_t *grp_ptr /* IN: Group to build the hash table of */
+)
 {
-    /* Insert the atom at the beginning of the free list */
-    atm->next      = atom_free_list;
-    atom_free_list = atm;
-} /* end HAIrelease_atom_node() */
+    atom_table_t *old_tbl  = grp_ptr->table;     /* the current hash table */
+    atom_table_t *new_tbl  = NULL;               /* the new hash table */
+    unsigned      new_size = old_tbl->hash_size; /* # of slots in the new hash table */
+
+    while (4 * (grp_ptr->atoms + 1) > new_size) {
+        new_size *= 2;
+        if (new_size == 0 || new_size > (unsigned)ATOM_MASK + 1)
+            return FAIL;
+    }
+    if ((new_tbl = HAIalloc_table(new_size)) == NULL)
+        return FAIL;
+
+    for (unsigned u = 0; u < old_tbl->hash_size; u++) {
+        atom_t   atm = old_tbl->slots[u].id;
+        unsigned hash_loc;
+
+        if (atm == EMPTY_ATOM || atm == REMOVED_ATOM)
+            continue;
+        for (hash_loc = ATOM_TO_LOC(atm, new_size); new_tbl->slots[hash_loc].id != EMPTY_ATOM;
+             hash_loc = (hash_loc + 1) & (new_size - 1))
+            ;
+        new_tbl->slots[hash_loc] = old_tbl->slots[u];
+    }
 
-/*--------------------------------------------------------------------------
+    HA_SET_TABLE(grp_ptr, new_tbl);
+    grp_ptr->removed = 0;
+    HAIretire_table(grp_ptr, old_tbl);
+
+    return SUCCEED;
+} /* end HAIrebuild_group() */
+
+/******************************************************************************
  NAME
-    HAIfree_atom_list
+     HAIretire_table - Frees a group's replaced hash table when it's safe
 
- PURPOSE
-    Free a linked list of atoms
---------------------------------------------------------------------------*/
+ DESCRIPTION
+    Adds the table (if not NULL) to the group's replaced tables, then frees
+    them all if no lookup is under way in the group.  A lookup which starts
+    later reads the group's current table, so none can be reading them.
+    Otherwise they wait for a later change to the group, or HAshutdown.
+
+ RETURNS
+    None
+*******************************************************************************/
 static void
-HAIfree_atom_list(atom_info_t *info)
+HAIretire_table(atom_group_t *grp_ptr, /* IN: Group whose table was replaced */
+                atom_table_t *tbl      /* IN: the replaced table, or NULL */
+)
 {
-    atom_info_t *curr = info;
-    atom_info_t *next = NULL;
+    if (tbl != NULL) {
+        tbl->next        = grp_ptr->retired;
+        grp_ptr->retired = tbl;
+    }
 
-    while (curr != NULL) {
-        next = curr->next;
-        free(curr);
-        curr = next;
+    if (HA_IDLE(grp_ptr)) {
+        while ((tbl = grp_ptr->retired) != NULL) {
+            grp_ptr->retired = tbl->next;
+            free(tbl);
+        }
     }
-}
+} /* end HAIretire_table() */
 
 /*--------------------------------------------------------------------------
  NAME
@@ -633,20 +727,26 @@ HAIfree_atom_list(atom_info_t *info)
 int
 HAshutdown(void)
 {
-    /* Release the free list */
-    HAIfree_atom_list(atom_free_list);
+    atom_table_t *tbl;
+
+    HA_LOCK();
 
     /* Free the atom groups */
     for (int i = 0; i < (int)MAXGROUP; i++) {
         if (atom_group_list[i] != NULL) {
-            free(atom_group_list[i]->atom_list);
+            free(atom_group_list[i]->table);
+            while ((tbl = atom_group_list[i]->retired) != NULL) {
+                atom_group_list[i]->retired = tbl->next;
+                free(tbl);
+            }
             free(atom_group_list[i]);
         }
     }
 
     /* Don't leave stale global data around */
-    atom_free_list = NULL;
     memset(atom_group_list, 0, sizeof(atom_group_t *) * MAXGROUP);
 
+    HA_UNLOCK();
+
     return SUCCEED;
 } /* end HAshutdown() */
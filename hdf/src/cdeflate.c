@@ -426,7 +426,7 @@ HCPcdeflate_stwrite(accrec_t *access_rec)
  USAGE
     int32 HCPcdeflate_seek(access_rec,offset,origin)
     accrec_t *access_rec;   IN: the access record of the data element
-    int32 offset;       IN: the offset in bytes from the origin specified
+    hdf_off_t offset;   IN: the offset in bytes from the origin specified
     int origin;        IN: the origin to seek from [UNUSED!]
 
  RETURNS
@@ -439,7 +439,7 @@ HCPcdeflate_stwrite(accrec_t *access_rec)
     because of this.
 --------------------------------------------------------------------------*/
 int32
-HCPcdeflate_seek(accrec_t *access_rec, int32 offset, int origin)
+HCPcdeflate_seek(accrec_t *access_rec, hdf_off_t offset, int origin)
 {
     compinfo_t                *info;             /* special element information */
     comp_coder_deflate_info_t *deflate_info;     /* ptr to gzip 'deflate' info */
@@ -486,7 +486,7 @@ HCPcdeflate_seek(accrec_t *access_rec, int32 offset, int origin)
     }
     if (deflate_info->offset < offset) {
         /* grab the last chunk */
-        if (HCIcdeflate_decode(info, offset - deflate_info->offset, tmp_buf) == FAIL) {
+        if (HCIcdeflate_decode(info, (int32)offset - deflate_info->offset, tmp_buf) == FAIL) {
             HGOTO_ERROR(DFE_CDECODE, FAIL);
         }
     }
@@ -620,8 +620,8 @@ HCPcdeflate_write(accrec_t *access_rec, int32 length, const void *data)
     [Currently a NOP].
 --------------------------------------------------------------------------*/
 int32
-HCPcdeflate_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                    int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial)
+HCPcdeflate_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+                    hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
 {
     (void)access_rec;
     (void)pfile_id;
@@ -672,3 +672,47 @@ HCPcdeflate_endaccess(accrec_t *access_rec)
 
     return SUCCEED;
 } /* HCPcdeflate_endaccess() */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HCPcdeflate_inflate -- Decode gzip 'deflated' data held in memory
+
+ USAGE
+    int32 HCPcdeflate_inflate(src, src_len, dst, dst_len)
+    void *src;          IN: the compressed data, as read by HCPgetrawdata
+    int32 src_len;      IN: # of bytes of compressed data
+    void *dst;          OUT: buffer to store the decoded bytes
+    int32 dst_len;      IN: # of bytes to decode
+
+ RETURNS
+    Returns # of bytes decoded or FAIL
+
+ DESCRIPTION
+    Decodes a whole compressed element at once.  Errors aren't pushed on
+    the error stack, so this can be called on any thread.
+--------------------------------------------------------------------------*/
+int32
+HCPcdeflate_inflate(void *src, int32 src_len, void *dst, int32 dst_len)
+{
+    z_stream zs;    /* inflation context */
+    int      zstat; /* inflate status */
+    int32    ret_value = FAIL;
+
+    memset(&zs, 0, sizeof(zs));
+    zs.next_in   = (Bytef *)src;
+    zs.avail_in  = (uInt)src_len;
+    zs.next_out  = (Bytef *)dst;
+    zs.avail_out = (uInt)dst_len;
+
+    if (inflateInit(&zs) != Z_OK)
+        return FAIL;
+
+    /* like HCIcdeflate_decode, stop at the end of the data or of the buffer */
+    zstat = inflate(&zs, Z_FINISH);
+    if (zstat == Z_STREAM_END || zs.avail_out == 0)
+        ret_value = dst_len - (int32)zs.avail_out;
+
+    inflateEnd(&zs);
+
+    return ret_value;
+} /* HCPcdeflate_inflate() */
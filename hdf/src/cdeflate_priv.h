@@ -51,10 +51,10 @@ HDFLIBAPI int32 HCPcdeflate_stread(accrec_t *rec);
 
 HDFLIBAPI int32 HCPcdeflate_stwrite(accrec_t *rec);
 
-HDFLIBAPI int32 HCPcdeflate_seek(accrec_t *access_rec, int32 offset, int origin);
+HDFLIBAPI int32 HCPcdeflate_seek(accrec_t *access_rec, hdf_off_t offset, int origin);
 
 HDFLIBAPI int32 HCPcdeflate_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref,
-                                    int32 *plength, int32 *poffset, int32 *pposn, int16 *paccess,
+                                    hdf_off_t *plength, hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess,
                                     int16 *pspecial);
 
 HDFLIBAPI int32 HCPcdeflate_read(accrec_t *access_rec, int32 length, void *data);
@@ -63,6 +63,8 @@ HDFLIBAPI int32 HCPcdeflate_write(accrec_t *access_rec, int32 length, const void
 
 HDFLIBAPI int HCPcdeflate_endaccess(accrec_t *access_rec);
 
+HDFLIBAPI int32 HCPcdeflate_inflate(void *src, int32 src_len, void *dst, int32 dst_len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -35,6 +35,9 @@ funclist_t cnbit_funcs = {HCPcnbit_stread,
                           NULL,
                           NULL};
 
+/* number of n-bit fields read or written at once */
+#define NBIT_FIELDS 256
+
 /* Local Variables */
 static const uint8 mask_arr8[9] = {/* array of values with [n] bits set */
                                    0x00, 0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F, 0xFF};
@@ -52,6 +55,12 @@ static int32 HCIcnbit_staccess(accrec_t *access_rec, int16 acc_mode);
 
 static int32 HCIcnbit_init(accrec_t *access_rec);
 
+static void HCIcnbit_unpack(const comp_coder_nbit_info_t *nbit_info, const uint32 *fields, int32 nitems,
+                            uint8 *buf);
+
+static void HCIcnbit_pack(const comp_coder_nbit_info_t *nbit_info, const uint8 *buf, int32 nitems,
+                          uint32 *fields);
+
 static int32 HCIcnbit_decode(compinfo_t *info, int32 length, uint8 *buf);
 
 static int32 HCIcnbit_encode(compinfo_t *info, int32 length, const uint8 *buf);
@@ -90,6 +99,7 @@ HCIcnbit_init(accrec_t *access_rec)
 
     /* Initialize N-bit state information */
     nbit_info->buf_pos = NBIT_BUF_SIZE; /* start at the beginning of the buffer */
+    nbit_info->buf_len = 0;             /* nothing expanded yet */
     nbit_info->nt_pos  = 0;             /* start at beginning of the NT info */
     nbit_info->offset  = 0;             /* offset into the file */
     memset(nbit_info->mask_buf, (nbit_info->fill_one == TRUE ? 0xff : 0), (size_t)nbit_info->nt_size);
@@ -146,9 +156,160 @@ HCIcnbit_init(accrec_t *access_rec)
             nbit_info->mask_buf[i] &= ~(nbit_info->mask_info[i].mask);
     } /* end if */
 
+    /* items of a usual size with fields which fit in 32 bits are expanded
+       and packed as whole integers rather than a byte at a time */
+    nbit_info->whole_items =
+        (nbit_info->nt_size == 1 || nbit_info->nt_size == 2 || nbit_info->nt_size == 4 ||
+         nbit_info->nt_size == 8) &&
+        nbit_info->mask_len > 0 && nbit_info->mask_len <= 32 && mask_bot >= 0 && mask_top < bits;
+    nbit_info->fill_bits = 0;
+    nbit_info->sign_bits = 0;
+    if (nbit_info->whole_items) {
+        for (i = 0; i < nbit_info->nt_size; i++)
+            nbit_info->fill_bits = (nbit_info->fill_bits << 8) | nbit_info->mask_buf[i];
+        if (nbit_info->sign_ext && mask_top < bits - 1)
+            nbit_info->sign_bits = (~(uint64_t)0 >> (64 - bits)) & ~(~(uint64_t)0 >> (63 - mask_top));
+    } /* end if */
+
     return SUCCEED;
 } /* end HCIcnbit_init() */
 
+/*--------------------------------------------------------------------------
+ NAME
+    HCIcnbit_unpack -- Expand n-bit fields into whole items
+
+ USAGE
+    void HCIcnbit_unpack(nbit_info,fields,nitems,buf)
+    const comp_coder_nbit_info_t *nbit_info; IN: the n-bit info
+    const uint32 *fields;   IN: the n-bit fields, one per item
+    int32 nitems;           IN: number of items to expand
+    uint8 *buf;             OUT: buffer to store the items in
+
+ RETURNS
+    none
+
+ DESCRIPTION
+    Shifts each field into place over the fill bits, sign extends it and
+    stores the item in big-endian order.  There's a loop for each size of
+    item, with no branches, so that the compiler can vectorize them.
+    Only called when nbit_info->whole_items is set.
+--------------------------------------------------------------------------*/
+static void
+HCIcnbit_unpack(const comp_coder_nbit_info_t *nbit_info, const uint32 *fields, int32 nitems, uint8 *buf)
+{
+    int    shift = nbit_info->mask_off - nbit_info->mask_len + 1; /* bit position of the field */
+    int    top   = nbit_info->mask_len - 1;                       /* sign bit of the field */
+    uint32 fill  = (uint32)nbit_info->fill_bits;
+    uint32 sign  = (uint32)nbit_info->sign_bits;
+    uint32 v;
+    int32  i;
+
+    switch (nbit_info->nt_size) {
+        case 1:
+            for (i = 0; i < nitems; i++) {
+                v      = fill | (fields[i] << shift);
+                v      = (v & ~sign) | ((0 - ((fields[i] >> top) & 1)) & sign);
+                buf[i] = (uint8)v;
+            }
+            break;
+
+        case 2:
+            for (i = 0; i < nitems; i++, buf += 2) {
+                v      = fill | (fields[i] << shift);
+                v      = (v & ~sign) | ((0 - ((fields[i] >> top) & 1)) & sign);
+                buf[0] = (uint8)(v >> 8);
+                buf[1] = (uint8)v;
+            }
+            break;
+
+        case 4:
+            for (i = 0; i < nitems; i++, buf += 4) {
+                v      = fill | (fields[i] << shift);
+                v      = (v & ~sign) | ((0 - ((fields[i] >> top) & 1)) & sign);
+                buf[0] = (uint8)(v >> 24);
+                buf[1] = (uint8)(v >> 16);
+                buf[2] = (uint8)(v >> 8);
+                buf[3] = (uint8)v;
+            }
+            break;
+
+        case 8: {
+            uint64_t v64;
+
+            for (i = 0; i < nitems; i++, buf += 8) {
+                v64 = nbit_info->fill_bits | ((uint64_t)fields[i] << shift);
+                v64 = (v64 & ~nbit_info->sign_bits) |
+                      ((0 - (uint64_t)((fields[i] >> top) & 1)) & nbit_info->sign_bits);
+                for (int j = 0; j < 8; j++)
+                    buf[j] = (uint8)(v64 >> (56 - 8 * j));
+            }
+        } break;
+
+        default:
+            break;
+    } /* end switch */
+} /* end HCIcnbit_unpack() */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HCIcnbit_pack -- Gather the n-bit fields of whole items
+
+ USAGE
+    void HCIcnbit_pack(nbit_info,buf,nitems,fields)
+    const comp_coder_nbit_info_t *nbit_info; IN: the n-bit info
+    const uint8 *buf;       IN: the items, in big-endian order
+    int32 nitems;           IN: number of items to pack
+    uint32 *fields;         OUT: the n-bit fields, one per item
+
+ RETURNS
+    none
+
+ DESCRIPTION
+    The reverse of HCIcnbit_unpack.  Only called when
+    nbit_info->whole_items is set.
+--------------------------------------------------------------------------*/
+static void
+HCIcnbit_pack(const comp_coder_nbit_info_t *nbit_info, const uint8 *buf, int32 nitems, uint32 *fields)
+{
+    int    shift = nbit_info->mask_off - nbit_info->mask_len + 1; /* bit position of the field */
+    uint32 mask  = mask_arr32[nbit_info->mask_len];
+    int32  i;
+
+    switch (nbit_info->nt_size) {
+        case 1:
+            for (i = 0; i < nitems; i++)
+                fields[i] = ((uint32)buf[i] >> shift) & mask;
+            break;
+
+        case 2:
+            for (i = 0; i < nitems; i++, buf += 2)
+                fields[i] = ((((uint32)buf[0] << 8) | buf[1]) >> shift) & mask;
+            break;
+
+        case 4:
+            for (i = 0; i < nitems; i++, buf += 4)
+                fields[i] =
+                    ((((uint32)buf[0] << 24) | ((uint32)buf[1] << 16) | ((uint32)buf[2] << 8) | buf[3]) >>
+                     shift) &
+                    mask;
+            break;
+
+        case 8: {
+            uint64_t v64;
+
+            for (i = 0; i < nitems; i++, buf += 8) {
+                v64 = 0;
+                for (int j = 0; j < 8; j++)
+                    v64 = (v64 << 8) | buf[j];
+                fields[i] = (uint32)(v64 >> shift) & mask;
+            }
+        } break;
+
+        default:
+            break;
+    } /* end switch */
+} /* end HCIcnbit_pack() */
+
 /*--------------------------------------------------------------------------
  NAME
     HCIcnbit_decode -- Decode n-bit data into a buffer.
@@ -177,8 +338,10 @@ HCIcnbit_decode(compinfo_t *info, int32 length, uint8 *buf)
         sign_bit = 0;                    /* the sign bit from the n_bit data */
     nbit_mask_info_t *mask_info;         /* ptr to the mask info */
     int               copy_length;       /* number of bytes to copy */
-    int               buf_size,          /* size of the expansion buffer to use */
-        buf_items;                       /* number of items which will fit into expansion buffer */
+    int32             buf_items,         /* number of items to expand into the buffer */
+        nitems,                          /* number of items expanded at once */
+        nread;                           /* number of items read from the file */
+    uint32 fields[NBIT_FIELDS];          /* the n-bit fields of whole items */
     uint8 *rbuf, *rbuf2;                 /* pointer into the n-bit read buffer */
     int    i, j;                         /* local counting variable */
 
@@ -190,57 +353,74 @@ HCIcnbit_decode(compinfo_t *info, int32 length, uint8 *buf)
     sign_byte     = nbit_info->nt_size - ((nbit_info->mask_off / 8) + 1);
     sign_mask     = mask_arr32[(nbit_info->mask_off % 8) + 1] ^ mask_arr32[nbit_info->mask_off % 8];
 
-    buf_size    = MIN(NBIT_BUF_SIZE, length);
-    buf_items   = buf_size / nbit_info->nt_size; /* compute # of items in buffer */
-    orig_length = length;                        /* save this for later */
-    while (length > 0) {                         /* decode until we have all the bytes */
-        if (nbit_info->buf_pos >= buf_size) {    /* re-fill buffer */
-            rbuf = (uint8 *)nbit_info->buffer;   /* get a ptr to the buffer */
-
-            /* get initial copy of the mask */
-            HDmemfill(rbuf, nbit_info->mask_buf, (uint32)nbit_info->nt_size, (uint32)buf_items);
-
-            for (i = 0; i < buf_items; i++) {
-                /* get a ptr to the mask info for convenience also */
-                mask_info = &(nbit_info->mask_info[0]);
-
-                if (nbit_info->sign_ext) { /* special code for expanding sign extended data */
-                    rbuf2 = rbuf;          /* set temporary pointer into buffer */
-                    for (j = 0; j < nbit_info->nt_size; j++, mask_info++, rbuf2++) {
-                        if (mask_info->length > 0) { /* check if we need to read bits */
-                            Hbitread(info->aid, mask_info->length, &input_bits);
-                            input_bits <<= (mask_info->offset - mask_info->length) + 1;
-                            *rbuf2 |= (uint8)(mask_info->mask & (uint8)input_bits);
-                            if (j == sign_byte) /* check if this is the sign byte */
-                                sign_bit = sign_mask & input_bits ? 1 : 0;
+    orig_length = length;                            /* save this for later */
+    while (length > 0) {                             /* decode until we have all the bytes */
+        if (nbit_info->buf_pos >= nbit_info->buf_len) { /* re-fill buffer */
+            rbuf = (uint8 *)nbit_info->buffer;          /* get a ptr to the buffer */
+
+            /* expand the items holding the bytes wanted, and no more, so
+               that what's left in the file is where the next read starts */
+            buf_items          = (MIN(NBIT_BUF_SIZE, length) + nbit_info->nt_size - 1) / nbit_info->nt_size;
+            nbit_info->buf_len = (int)buf_items * nbit_info->nt_size;
+
+            if (nbit_info->whole_items) {
+                /* read the fields of many items at once, then expand them */
+                for (i = 0; i < buf_items; i += NBIT_FIELDS) {
+                    nitems = MIN(NBIT_FIELDS, buf_items - i);
+                    nread  = Hbitread_n(info->aid, nbit_info->mask_len, nitems, fields);
+                    if (nread == FAIL)
+                        HRETURN_ERROR(DFE_CDECODE, FAIL);
+                    for (; nread < nitems; nread++) /* past the end of the data */
+                        fields[nread] = 0;
+                    HCIcnbit_unpack(nbit_info, fields, nitems, rbuf);
+                    rbuf += nitems * nbit_info->nt_size;
+                }
+            }
+            else { /* read a byte's bits at a time */
+                /* get initial copy of the mask */
+                HDmemfill(rbuf, nbit_info->mask_buf, (uint32)nbit_info->nt_size, (uint32)buf_items);
+
+                for (i = 0; i < buf_items; i++) {
+                    /* get a ptr to the mask info for convenience also */
+                    mask_info = &(nbit_info->mask_info[0]);
+
+                    if (nbit_info->sign_ext) { /* special code for expanding sign extended data */
+                        rbuf2 = rbuf;          /* set temporary pointer into buffer */
+                        for (j = 0; j < nbit_info->nt_size; j++, mask_info++, rbuf2++) {
+                            if (mask_info->length > 0) { /* check if we need to read bits */
+                                Hbitread(info->aid, mask_info->length, &input_bits);
+                                input_bits <<= (mask_info->offset - mask_info->length) + 1;
+                                *rbuf2 |= (uint8)(mask_info->mask & (uint8)input_bits);
+                                if (j == sign_byte) /* check if this is the sign byte */
+                                    sign_bit = sign_mask & input_bits ? 1 : 0;
+                            }
                         }
-                    }
 
-                    /* we only have to sign extend if the sign is not the same */
-                    /* as the bit we are filling the n-bit data with */
-                    if (sign_bit != nbit_info->fill_one) {
-                        rbuf2 = rbuf;        /* set temporary pointer into buffer */
-                        if (sign_bit == 1) { /* fill with ones */
-                            for (j = 0; j < sign_byte; j++, rbuf2++)
-                                *rbuf2 = 0xff;
-                            *rbuf2 |= (uint8)sign_ext_mask;
-                        }
-                        else { /* fill with zeroes */
-                            for (j = 0; j < sign_byte; j++, rbuf2++)
-                                *rbuf2 = 0x00;
-                            *rbuf2 &= (uint8)~sign_ext_mask;
+                        /* we only have to sign extend if the sign is not the same */
+                        /* as the bit we are filling the n-bit data with */
+                        if (sign_bit != nbit_info->fill_one) {
+                            rbuf2 = rbuf;        /* set temporary pointer into buffer */
+                            if (sign_bit == 1) { /* fill with ones */
+                                for (j = 0; j < sign_byte; j++, rbuf2++)
+                                    *rbuf2 = 0xff;
+                                *rbuf2 |= (uint8)sign_ext_mask;
+                            }
+                            else { /* fill with zeroes */
+                                for (j = 0; j < sign_byte; j++, rbuf2++)
+                                    *rbuf2 = 0x00;
+                                *rbuf2 &= (uint8)~sign_ext_mask;
+                            }
                         }
+                        rbuf += nbit_info->nt_size; /* increment buffer ptr */
                     }
-                    rbuf += nbit_info->nt_size; /* increment buffer ptr */
-                }
-                else { /* no sign extension */
-                    for (j = 0; j < nbit_info->nt_size; j++, mask_info++, rbuf++) {
-                        if (mask_info->length > 0) { /* check if we need to read bits */
-                            if (Hbitread(info->aid, mask_info->length, &input_bits) != mask_info->length)
-                                HRETURN_ERROR(DFE_CDECODE, FAIL);
-                            *rbuf |=
-                                (uint8)(mask_info->mask &
-                                        (uint8)(input_bits << ((mask_info->offset - mask_info->length) + 1)));
+                    else { /* no sign extension */
+                        for (j = 0; j < nbit_info->nt_size; j++, mask_info++, rbuf++) {
+                            if (mask_info->length > 0) { /* check if we need to read bits */
+                                if (Hbitread(info->aid, mask_info->length, &input_bits) != mask_info->length)
+                                    HRETURN_ERROR(DFE_CDECODE, FAIL);
+                                input_bits <<= (mask_info->offset - mask_info->length) + 1;
+                                *rbuf |= (uint8)(mask_info->mask & (uint8)input_bits);
+                            }
                         }
                     }
                 }
@@ -249,8 +429,9 @@ HCIcnbit_decode(compinfo_t *info, int32 length, uint8 *buf)
             nbit_info->buf_pos = 0; /* reset buffer position */
         }
 
-        copy_length =
-            (int)((length > (buf_size - nbit_info->buf_pos)) ? (buf_size - nbit_info->buf_pos) : length);
+        copy_length = (int)((length > (nbit_info->buf_len - nbit_info->buf_pos))
+                                ? (nbit_info->buf_len - nbit_info->buf_pos)
+                                : length);
 
         memcpy(buf, &(nbit_info->buffer[nbit_info->buf_pos]), (size_t)copy_length);
 
@@ -286,14 +467,29 @@ HCIcnbit_encode(compinfo_t *info, int32 length, const uint8 *buf)
     int32                   orig_length; /* original length to write */
     uint32                  output_bits; /* bits to write to the file */
     nbit_mask_info_t       *mask_info;   /* ptr to the mask info */
+    uint32                  fields[NBIT_FIELDS]; /* n-bit fields of whole items */
+    int32                   nitems;              /* # of whole items to write at once */
 
     /* get a local ptr to the nbit info for convenience */
     nbit_info = &(info->cinfo.coder_info.nbit_info);
 
+    orig_length = length; /* save this for later */
+
+    /* Gather the fields of whole items and write them at once */
+    if (nbit_info->whole_items && nbit_info->nt_pos == 0) {
+        while (length >= nbit_info->nt_size) {
+            nitems = MIN(length / nbit_info->nt_size, NBIT_FIELDS);
+            HCIcnbit_pack(nbit_info, buf, nitems, fields);
+            if (Hbitwrite_n(info->aid, nbit_info->mask_len, nitems, fields) != nitems)
+                HRETURN_ERROR(DFE_CENCODE, FAIL);
+            buf += nitems * nbit_info->nt_size;
+            length -= nitems * nbit_info->nt_size;
+        }
+    }
+
     /* get a ptr to the mask info for convenience also */
     mask_info = &(nbit_info->mask_info[nbit_info->nt_pos]);
 
-    orig_length = length;                 /* save this for later */
     for (; length > 0; length--, buf++) { /* encode until we store all the bytes */
         if (mask_info->length > 0) {      /* check if we need to output bits */
             output_bits =
@@ -425,7 +621,7 @@ HCPcnbit_stwrite(accrec_t *access_rec)
  USAGE
     int32 HCPcnbit_seek(access_rec,offset,origin)
     accrec_t *access_rec;   IN: the access record of the data element
-    int32 offset;       IN: the offset in bytes from the origin specified
+    hdf_off_t offset;   IN: the offset in bytes from the origin specified
     int  origin;        IN: the origin to seek from [UNUSED!]
 
  RETURNS
@@ -438,7 +634,7 @@ HCPcnbit_stwrite(accrec_t *access_rec)
     because of this.
 --------------------------------------------------------------------------*/
 int32
-HCPcnbit_seek(accrec_t *access_rec, int32 offset, int origin)
+HCPcnbit_seek(accrec_t *access_rec, hdf_off_t offset, int origin)
 {
     compinfo_t             *info;       /* special element information */
     comp_coder_nbit_info_t *nbit_info;  /* ptr to n-bit info */
@@ -453,14 +649,14 @@ HCPcnbit_seek(accrec_t *access_rec, int32 offset, int origin)
     if (offset % nbit_info->nt_size != 0)
         HRETURN_ERROR(DFE_CSEEK, FAIL);
 
-    bit_offset = (offset / nbit_info->nt_size) * nbit_info->mask_len;
+    bit_offset = ((int32)offset / nbit_info->nt_size) * nbit_info->mask_len;
 
     if (Hbitseek(info->aid, bit_offset / 8, (int)(bit_offset % 8)) == FAIL)
         HRETURN_ERROR(DFE_CSEEK, FAIL);
 
     nbit_info->buf_pos = NBIT_BUF_SIZE; /* force re-read if writing */
     nbit_info->nt_pos  = 0;             /* start at the first byte of the mask */
-    nbit_info->offset  = offset;        /* set abs. offset into the file */
+    nbit_info->offset  = (int32)offset; /* set abs. offset into the file */
 
     return SUCCEED;
 } /* HCPcnbit_seek() */
@@ -548,8 +744,8 @@ HCPcnbit_write(accrec_t *access_rec, int32 length, const void *data)
     [Currently a NOP].
 --------------------------------------------------------------------------*/
 int32
-HCPcnbit_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                 int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial)
+HCPcnbit_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+                 hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
 {
     (void)access_rec;
     (void)pfile_id;
@@ -42,12 +42,16 @@ typedef struct {
     int              sign_ext;                  /* whether to sign extend or not */
     uint8            buffer[NBIT_BUF_SIZE];     /* buffer for expanding n-bit data in */
     int              buf_pos;                   /* current offset in the expansion buffer */
+    int              buf_len;                   /* # of bytes expanded in the buffer */
     int              mask_off;                  /* offset of the bit to start masking with */
     int              mask_len;                  /* number of bits to mask */
     int32            offset;                    /* offset in the file in terms of bytes */
     uint8            mask_buf[NBIT_MASK_SIZE];  /* buffer to hold the bitmask */
     nbit_mask_info_t mask_info[NBIT_MASK_SIZE]; /* information about the mask */
     int              nt_pos;                    /* current byte to read or write */
+    int              whole_items;               /* whether items are packed as integers, see cnbit.c */
+    uint64_t         fill_bits;                 /* an item with only the fill bits set */
+    uint64_t         sign_bits;                 /* the bits sign extension sets, if any */
 } comp_coder_nbit_info_t;
 
 #ifdef __cplusplus
@@ -64,10 +68,10 @@ HDFLIBAPI int32 HCPcnbit_stread(accrec_t *rec);
 
 HDFLIBAPI int32 HCPcnbit_stwrite(accrec_t *rec);
 
-HDFLIBAPI int32 HCPcnbit_seek(accrec_t *access_rec, int32 offset, int origin);
+HDFLIBAPI int32 HCPcnbit_seek(accrec_t *access_rec, hdf_off_t offset, int origin);
 
 HDFLIBAPI int32 HCPcnbit_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref,
-                                 int32 *plength, int32 *poffset, int32 *pposn, int16 *paccess,
+                                 hdf_off_t *plength, hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess,
                                  int16 *pspecial);
 
 HDFLIBAPI int32 HCPcnbit_read(accrec_t *access_rec, int32 length, void *data);
@@ -127,7 +127,7 @@ HCPcnone_stwrite(accrec_t *access_rec)
  USAGE
     int32 HCPcnone_seek(access_rec,offset,origin)
     accrec_t *access_rec;   IN: the access record of the data element
-    int32 offset;       IN: the offset in bytes from the origin specified
+    hdf_off_t offset;   IN: the offset in bytes from the origin specified
     int origin;        IN: the origin to seek from [UNUSED!]
 
  RETURNS
@@ -140,13 +140,13 @@ HCPcnone_stwrite(accrec_t *access_rec)
     because of this.
 --------------------------------------------------------------------------*/
 int32
-HCPcnone_seek(accrec_t *access_rec, int32 offset, int origin)
+HCPcnone_seek(accrec_t *access_rec, hdf_off_t offset, int origin)
 {
     compinfo_t *info; /* special element information */
 
     info = (compinfo_t *)access_rec->special_info;
 
-    if (Hseek(info->aid, offset, origin) == FAIL)
+    if (Hseek64(info->aid, offset, origin) == FAIL)
         HRETURN_ERROR(DFE_CSEEK, FAIL);
 
     return SUCCEED;
@@ -235,8 +235,8 @@ HCPcnone_write(accrec_t *access_rec, int32 length, const void *data)
     [Currently a NOP].
 --------------------------------------------------------------------------*/
 int32
-HCPcnone_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                 int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial)
+HCPcnone_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+                 hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
 {
     (void)access_rec;
     (void)pfile_id;
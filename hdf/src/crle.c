@@ -45,6 +45,10 @@ static int32 HCIcrle_staccess(accrec_t *access_rec, int16 acc_mode);
 
 static int32 HCIcrle_init(accrec_t *access_rec);
 
+static int HCIcrle_fill(comp_coder_rle_info_t *rle_info, int32 aid);
+
+static int HCIcrle_getbytes(comp_coder_rle_info_t *rle_info, int32 aid, int32 length, uint8 *buf);
+
 static int32 HCIcrle_decode(compinfo_t *info, int32 length, uint8 *buf);
 
 static int32 HCIcrle_encode(compinfo_t *info, int32 length, const uint8 *buf);
@@ -83,10 +87,81 @@ HCIcrle_init(accrec_t *access_rec)
     rle_info->last_byte   = (unsigned)RLE_NIL; /* start with no code in the last byte */
     rle_info->second_byte = (unsigned)RLE_NIL; /* start with no code here too */
     rle_info->offset      = 0;                 /* offset into the file */
+    rle_info->in_pos      = 0;                 /* nothing read ahead yet */
+    rle_info->in_len      = 0;
 
     return SUCCEED;
 } /* end HCIcrle_init() */
 
+/*--------------------------------------------------------------------------
+ NAME
+    HCIcrle_fill -- Read the next block of compressed bytes into the input buffer
+
+ USAGE
+    int HCIcrle_fill(rle_info,aid)
+    comp_coder_rle_info_t *rle_info;    IN: the RLE decoding state
+    int32 aid;                          IN: the AID of the compressed bytes
+
+ RETURNS
+    Returns SUCCEED or FAIL
+
+ DESCRIPTION
+    Reads up to RLE_IN_SIZE bytes in one Hread, so that the decoder doesn't
+    have to go to the file for each control byte.  It's an error to be at
+    the end of the compressed bytes.
+--------------------------------------------------------------------------*/
+static int
+HCIcrle_fill(comp_coder_rle_info_t *rle_info, int32 aid)
+{
+    int32 nread; /* # of bytes read into the buffer */
+
+    if (rle_info->in_buf == NULL && (rle_info->in_buf = (uint8 *)malloc(RLE_IN_SIZE)) == NULL)
+        HRETURN_ERROR(DFE_NOSPACE, FAIL);
+
+    if ((nread = Hread(aid, RLE_IN_SIZE, rle_info->in_buf)) == FAIL)
+        HRETURN_ERROR(DFE_READERROR, FAIL);
+    if (nread == 0) /* ran off the end of the compressed bytes */
+        HRETURN_ERROR(DFE_READERROR, FAIL);
+
+    rle_info->in_pos = 0;
+    rle_info->in_len = nread;
+
+    return SUCCEED;
+} /* end HCIcrle_fill() */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HCIcrle_getbytes -- Get compressed bytes from the input buffer
+
+ USAGE
+    int HCIcrle_getbytes(rle_info,aid,length,buf)
+    comp_coder_rle_info_t *rle_info;    IN: the RLE decoding state
+    int32 aid;                          IN: the AID of the compressed bytes
+    int32 length;                       IN: number of bytes to get
+    uint8 *buf;                         OUT: buffer to store the bytes
+
+ RETURNS
+    Returns SUCCEED or FAIL
+--------------------------------------------------------------------------*/
+static int
+HCIcrle_getbytes(comp_coder_rle_info_t *rle_info, int32 aid, int32 length, uint8 *buf)
+{
+    int32 n; /* # of bytes to take from the buffer at once */
+
+    while (length > 0) {
+        if (rle_info->in_pos >= rle_info->in_len)
+            if (HCIcrle_fill(rle_info, aid) == FAIL)
+                return FAIL;
+        n = MIN(length, rle_info->in_len - rle_info->in_pos);
+        memcpy(buf, &rle_info->in_buf[rle_info->in_pos], (size_t)n);
+        rle_info->in_pos += n;
+        buf += n;
+        length -= n;
+    }
+
+    return SUCCEED;
+} /* end HCIcrle_getbytes() */
+
 /*--------------------------------------------------------------------------
  NAME
     HCIcrle_decode -- Decode RLE compressed data into a buffer.
@@ -116,18 +191,32 @@ HCIcrle_decode(compinfo_t *info, int32 length, uint8 *buf)
     orig_length = length;                      /* save this for later */
     while (length > 0) {                       /* decode until we have all the bytes we need */
         if (rle_info->rle_state == RLE_INIT) { /* need to figure out RUN or MIX state */
-            if ((c = HDgetc(info->aid)) == FAIL)
-                HRETURN_ERROR(DFE_READERROR, FAIL);
+            if (rle_info->in_pos >= rle_info->in_len)
+                if (HCIcrle_fill(rle_info, info->aid) == FAIL)
+                    HRETURN_ERROR(DFE_READERROR, FAIL);
+            c = rle_info->in_buf[rle_info->in_pos++];
             if (c & RUN_MASK) {                                        /* run byte */
                 rle_info->rle_state  = RLE_RUN;                        /* set to run state */
                 rle_info->buf_length = (c & COUNT_MASK) + RLE_MIN_RUN; /* run length */
-                if ((rle_info->last_byte = (unsigned)HDgetc(info->aid)) == (unsigned)FAIL)
-                    HRETURN_ERROR(DFE_READERROR, FAIL);
+                if (rle_info->in_pos >= rle_info->in_len)
+                    if (HCIcrle_fill(rle_info, info->aid) == FAIL)
+                        HRETURN_ERROR(DFE_READERROR, FAIL);
+                rle_info->last_byte = rle_info->in_buf[rle_info->in_pos++];
             }
             else {                                                     /* mix byte */
                 rle_info->rle_state  = RLE_MIX;                        /* set to mix state */
                 rle_info->buf_length = (c & COUNT_MASK) + RLE_MIN_MIX; /* mix length */
-                if (Hread(info->aid, rle_info->buf_length, rle_info->buffer) == FAIL)
+
+                /* a whole mix which is wanted goes straight to the caller */
+                if (length >= rle_info->buf_length) {
+                    if (HCIcrle_getbytes(rle_info, info->aid, rle_info->buf_length, buf) == FAIL)
+                        HRETURN_ERROR(DFE_READERROR, FAIL);
+                    rle_info->rle_state = RLE_INIT;
+                    length -= rle_info->buf_length;
+                    buf += rle_info->buf_length;
+                    continue;
+                }
+                if (HCIcrle_getbytes(rle_info, info->aid, rle_info->buf_length, rle_info->buffer) == FAIL)
                     HRETURN_ERROR(DFE_READERROR, FAIL);
                 rle_info->buf_pos = 0;
             }
@@ -342,7 +431,8 @@ HCIcrle_staccess(accrec_t *access_rec, int16 acc_mode)
 
     if (info->aid == FAIL)
         HRETURN_ERROR(DFE_DENIED, FAIL);
-    return HCIcrle_init(access_rec); /* initialize the RLE info */
+    info->cinfo.coder_info.rle_info.in_buf = NULL; /* allocated when first decoding */
+    return HCIcrle_init(access_rec);               /* initialize the RLE info */
 } /* end HCIcrle_staccess() */
 
 /*--------------------------------------------------------------------------
@@ -400,7 +490,7 @@ HCPcrle_stwrite(accrec_t *access_rec)
  USAGE
     int32 HCPcrle_seek(access_rec,offset,origin)
     accrec_t *access_rec;   IN: the access record of the data element
-    int32 offset;       IN: the offset in bytes from the origin specified
+    hdf_off_t offset;   IN: the offset in bytes from the origin specified
     int origin;        IN: the origin to seek from [UNUSED!]
 
  RETURNS
@@ -413,7 +503,7 @@ HCPcrle_stwrite(accrec_t *access_rec)
     because of this.
 --------------------------------------------------------------------------*/
 int32
-HCPcrle_seek(accrec_t *access_rec, int32 offset, int origin)
+HCPcrle_seek(accrec_t *access_rec, hdf_off_t offset, int origin)
 {
     compinfo_t            *info;     /* special element information */
     comp_coder_rle_info_t *rle_info; /* ptr to RLE info */
@@ -441,7 +531,7 @@ HCPcrle_seek(accrec_t *access_rec, int32 offset, int origin)
             HRETURN_ERROR(DFE_CDECODE, FAIL);
         }
     if (rle_info->offset < offset) /* grab the last chunk */
-        if (HCIcrle_decode(info, offset - rle_info->offset, tmp_buf) == FAIL) {
+        if (HCIcrle_decode(info, (int32)offset - rle_info->offset, tmp_buf) == FAIL) {
             free(tmp_buf);
             HRETURN_ERROR(DFE_CDECODE, FAIL);
         }
@@ -511,6 +601,12 @@ HCPcrle_write(accrec_t *access_rec, int32 length, const void *data)
         (rle_info->offset != 0 && length <= (info->length - rle_info->offset)))
         HRETURN_ERROR(DFE_UNSUPPORTED, FAIL);
 
+    /* Give back the bytes read ahead, so the new ones follow those decoded */
+    if (rle_info->in_pos < rle_info->in_len)
+        if (Hseek(info->aid, rle_info->in_pos - rle_info->in_len, DF_CURRENT) == FAIL)
+            HRETURN_ERROR(DFE_SEEKERROR, FAIL);
+    rle_info->in_pos = rle_info->in_len = 0;
+
     if (HCIcrle_encode(info, length, data) == FAIL)
         HRETURN_ERROR(DFE_CENCODE, FAIL);
 
@@ -542,8 +638,8 @@ HCPcrle_write(accrec_t *access_rec, int32 length, const void *data)
     [Currently a NOP].
 --------------------------------------------------------------------------*/
 int32
-HCPcrle_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial)
+HCPcrle_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+                hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
 {
     (void)access_rec;
     (void)pfile_id;
@@ -581,6 +677,9 @@ HCPcrle_endaccess(accrec_t *access_rec)
     info     = (compinfo_t *)access_rec->special_info;
     rle_info = &(info->cinfo.coder_info.rle_info);
 
+    free(rle_info->in_buf);
+    rle_info->in_buf = NULL;
+
     /* flush out RLE buffer */
     if ((access_rec->access & DFACC_WRITE) && rle_info->rle_state != RLE_INIT)
         if (HCIcrle_term(info) == FAIL)
@@ -40,6 +40,9 @@
 /* minimum length of mix */
 #define RLE_MIN_MIX 1
 
+/* size of the buffer the compressed bytes are read through */
+#define RLE_IN_SIZE 8192
+
 /*
  * Notes on RLE_MIN_RUN and RLE_MIN_MIX:
  * (excerpt from QAK's email to RA - see bug HDFFR-1261)
@@ -63,6 +66,9 @@ typedef struct {
     int      buf_pos;              /* offset into the buffer */
     unsigned last_byte;            /* the last byte stored in the buffer */
     unsigned second_byte;          /* the second to last byte stored in the buffer */
+    uint8   *in_buf;               /* compressed bytes read ahead while decoding */
+    int32    in_pos;               /* offset of the next byte in in_buf */
+    int32    in_len;               /* number of bytes in in_buf */
     enum {
         RLE_INIT, /* initial state, need to read a byte to
                      determine the next state */
@@ -85,10 +91,10 @@ HDFLIBAPI int32 HCPcrle_stread(accrec_t *rec);
 
 HDFLIBAPI int32 HCPcrle_stwrite(accrec_t *rec);
 
-HDFLIBAPI int32 HCPcrle_seek(accrec_t *access_rec, int32 offset, int origin);
+HDFLIBAPI int32 HCPcrle_seek(accrec_t *access_rec, hdf_off_t offset, int origin);
 
 HDFLIBAPI int32 HCPcrle_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref,
-                                int32 *plength, int32 *poffset, int32 *pposn, int16 *paccess,
+                                hdf_off_t *plength, hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess,
                                 int16 *pspecial);
 
 HDFLIBAPI int32 HCPcrle_read(accrec_t *access_rec, int32 length, void *data);
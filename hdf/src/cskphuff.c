@@ -150,6 +150,8 @@ HCIcskphuff_init(accrec_t *access_rec, unsigned alloc_buf)
     /* Initialize RLE state information */
     skphuff_info->skip_pos = 0; /* start in first byte */
     skphuff_info->offset   = 0; /* start at the beginning of the data */
+    skphuff_info->nbits    = 0; /* nothing read ahead */
+    skphuff_info->in_bytes = 0;
 
     if (alloc_buf == TRUE) {
         /* allocate pointers to the compression buffers */
@@ -213,21 +215,33 @@ HCIcskphuff_decode(compinfo_t *info, int32 length, uint8 *buf)
 {
     comp_coder_skphuff_info_t *skphuff_info; /* ptr to skipping Huffman info */
     int32                      orig_length;  /* original length to read */
-    uint32                     bit;          /* bit from the file */
+    uint32                     bits;         /* byte read ahead from the file */
+    int                        nbits;        /* # of bits of it left */
+    unsigned                  *child[2];     /* the left & right children of the tree being walked */
     unsigned                   a;
     uint8                      plain; /* the source code expanded from the file */
 
     skphuff_info = &(info->cinfo.coder_info.skphuff_info);
+    bits         = skphuff_info->bits;
+    nbits        = skphuff_info->nbits;
 
     orig_length = length; /* save this for later */
     while (length > 0) {  /* decode until we have all the bytes we need */
-        a = ROOT;         /* start at the root of the tree and find the leaf we need */
-
-        do { /* walk down once for each bit on the path */
-            if (Hbitread(info->aid, 1, &bit) == FAIL)
-                HRETURN_ERROR(DFE_CDECODE, FAIL);
-            a = ((bit == 0) ? (skphuff_info->left[skphuff_info->skip_pos][a])
-                            : (skphuff_info->right[skphuff_info->skip_pos][a]));
+        child[0] = skphuff_info->left[skphuff_info->skip_pos];
+        child[1] = skphuff_info->right[skphuff_info->skip_pos];
+        a        = ROOT; /* start at the root of the tree and find the leaf we need */
+
+        /* Walk down once for each bit on the path, taking the bits from a
+           byte at a time instead of calling Hbitread for each one */
+        do {
+            if (nbits == 0) {
+                if (Hbitread(info->aid, 8, &bits) == FAIL)
+                    HRETURN_ERROR(DFE_CDECODE, FAIL);
+                nbits = 8;
+                skphuff_info->in_bytes++;
+            }
+            nbits--;
+            a = child[(bits >> nbits) & 1][a];
         } while (a <= SKPHUFF_MAX_CHAR);
 
         plain = (uint8)(a - SUCCMAX);
@@ -235,7 +249,10 @@ HCIcskphuff_decode(compinfo_t *info, int32 length, uint8 *buf)
         skphuff_info->skip_pos = (skphuff_info->skip_pos + 1) % skphuff_info->skip_size;
         *buf++                 = plain;
         length--;
-    }                                    /* end while */
+    } /* end while */
+
+    skphuff_info->bits  = bits;
+    skphuff_info->nbits = nbits;
     skphuff_info->offset += orig_length; /* incr. abs. offset into the file */
     return SUCCEED;
 } /* end HCIcskphuff_decode() */
@@ -470,7 +487,7 @@ HCPcskphuff_stwrite(accrec_t *access_rec)
  USAGE
     int32 HCPcskphuff_seek(access_rec,offset,origin)
     accrec_t *access_rec;   IN: the access record of the data element
-    int32 offset;       IN: the offset in bytes from the origin specified
+    hdf_off_t offset;   IN: the offset in bytes from the origin specified
     int origin;        IN: the origin to seek from [UNUSED!]
 
  RETURNS
@@ -488,7 +505,7 @@ HCPcskphuff_stwrite(accrec_t *access_rec)
  REVISION LOG
 --------------------------------------------------------------------------*/
 int32
-HCPcskphuff_seek(accrec_t *access_rec, int32 offset, int origin)
+HCPcskphuff_seek(accrec_t *access_rec, hdf_off_t offset, int origin)
 {
     compinfo_t                *info;         /* special element information */
     comp_coder_skphuff_info_t *skphuff_info; /* ptr to skipping Huffman info */
@@ -513,7 +530,7 @@ HCPcskphuff_seek(accrec_t *access_rec, int32 offset, int origin)
             HRETURN_ERROR(DFE_CDECODE, FAIL);
         }                              /* end if */
     if (skphuff_info->offset < offset) /* grab the last chunk */
-        if (HCIcskphuff_decode(info, offset - skphuff_info->offset, tmp_buf) == FAIL) {
+        if (HCIcskphuff_decode(info, (int32)offset - skphuff_info->offset, tmp_buf) == FAIL) {
             free(tmp_buf);
             HRETURN_ERROR(DFE_CDECODE, FAIL);
         }
@@ -592,6 +609,13 @@ HCPcskphuff_write(accrec_t *access_rec, int32 length, const void *data)
     if ((info->length != skphuff_info->offset) && (skphuff_info->offset != 0 && length <= info->length))
         HRETURN_ERROR(DFE_UNSUPPORTED, FAIL);
 
+    /* Give back the bits read ahead, so the new ones follow those decoded */
+    if (skphuff_info->nbits > 0)
+        if (Hbitseek(info->aid, skphuff_info->in_bytes - 1, (int)BITNUM - skphuff_info->nbits) == FAIL)
+            HRETURN_ERROR(DFE_SEEKERROR, FAIL);
+    skphuff_info->nbits    = 0;
+    skphuff_info->in_bytes = 0;
+
     if (HCIcskphuff_encode(info, length, data) == FAIL)
         HRETURN_ERROR(DFE_CENCODE, FAIL);
 
@@ -628,8 +652,8 @@ HCPcskphuff_write(accrec_t *access_rec, int32 length, const void *data)
  REVISION LOG
 --------------------------------------------------------------------------*/
 int32
-HCPcskphuff_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                    int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial)
+HCPcskphuff_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+                    hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
 {
     (void)access_rec;
     (void)pfile_id;
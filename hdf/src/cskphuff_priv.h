@@ -42,6 +42,9 @@ typedef struct {
     uint8 **up;       /* define the up pointer array */
     int     skip_pos; /* current byte to read or write */
     int32   offset;   /* offset in the de-compressed array */
+    uint32  bits;     /* byte read ahead while decoding */
+    int     nbits;    /* # of bits of it not decoded yet */
+    int32   in_bytes; /* # of bytes read while decoding */
 } comp_coder_skphuff_info_t;
 
 #ifdef __cplusplus
@@ -58,10 +61,10 @@ HDFLIBAPI int32 HCPcskphuff_stread(accrec_t *rec);
 
 HDFLIBAPI int32 HCPcskphuff_stwrite(accrec_t *rec);
 
-HDFLIBAPI int32 HCPcskphuff_seek(accrec_t *access_rec, int32 offset, int origin);
+HDFLIBAPI int32 HCPcskphuff_seek(accrec_t *access_rec, hdf_off_t offset, int origin);
 
 HDFLIBAPI int32 HCPcskphuff_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref,
-                                    int32 *plength, int32 *poffset, int32 *pposn, int16 *paccess,
+                                    hdf_off_t *plength, hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess,
                                     int16 *pspecial);
 
 HDFLIBAPI int32 HCPcskphuff_read(accrec_t *access_rec, int32 length, void *data);
@@ -678,7 +678,7 @@ HCPcszip_stwrite(accrec_t *access_rec)
  USAGE
     int32 HCPcszip_seek(access_rec,offset,origin)
     accrec_t *access_rec;   IN: the access record of the data element
-    int32 offset;       IN: the offset in bytes from the origin specified
+    hdf_off_t offset;   IN: the offset in bytes from the origin specified
     int origin;        IN: the origin to seek from [UNUSED!]
 
  RETURNS
@@ -691,7 +691,7 @@ HCPcszip_stwrite(accrec_t *access_rec)
     because of this.
 --------------------------------------------------------------------------*/
 int32
-HCPcszip_seek(accrec_t *access_rec, int32 offset, int origin)
+HCPcszip_seek(accrec_t *access_rec, hdf_off_t offset, int origin)
 {
     compinfo_t             *info;      /* special element information */
     comp_coder_szip_info_t *szip_info; /* ptr to SZIP info */
@@ -723,7 +723,7 @@ HCPcszip_seek(accrec_t *access_rec, int32 offset, int origin)
     }
     if (szip_info->offset < offset) /* grab the last chunk */
     {
-        if (HCIcszip_decode(info, offset - szip_info->offset, tmp_buf) == FAIL) {
+        if (HCIcszip_decode(info, (int32)offset - szip_info->offset, tmp_buf) == FAIL) {
             free(tmp_buf);
             HRETURN_ERROR(DFE_CDECODE, FAIL);
         }
@@ -835,8 +835,8 @@ HCPcszip_write(accrec_t *access_rec, int32 length, const void *data)
     [Currently a NOP].
 --------------------------------------------------------------------------*/
 int32
-HCPcszip_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                 int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial)
+HCPcszip_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+                 hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
 {
     (void)access_rec;
     (void)pfile_id;
@@ -38,6 +38,8 @@
                       routines
     DFKisnative     - Checks whether number type is native mode
     DFKislitend     - Checks whether number type is little-endian mode
+    DFKIiscopyNT    - Checks whether converting a number type is a copy
+    DFKIswapsizeNT  - Checks whether converting a number type is a swap
     DFconvert       - provide compatibility with 3.0 routines
 
  Private functions:
@@ -63,6 +65,7 @@
 
 #include "hdf_priv.h"
 #include "hconv_priv.h"
+#include "hthread_priv.h"
 
 /*
  **  Static function prototypes
@@ -77,13 +80,22 @@ extern int   DFKsetcustom(int (*DFKcustin)(void *source, void *dest, uint32 num_
                                           uint32 dest_stride));
 extern int   DFconvert(uint8 *source, uint8 *dest, int ntype, int sourcetype, int desttype, int32 size);
 
+/* Type of the conversion routines */
+typedef int (*DFKconv_func_t)(void *source, void *dest, uint32 num_elm, uint32 source_stride,
+                              uint32 dest_stride);
+
 /*
- **  Conversion Routine Pointer Definitions
+ **  Conversion settings made by DFKsetNT and DFKsetcustom, kept for each
+ **  thread.  NULL custom routines mean that DFKsetcustom hasn't been called.
  */
-static int (*DFKnumin)(void *source, void *dest, uint32 num_elm, uint32 source_stride,
-                       uint32 dest_stride)  = DFKInoset;
-static int (*DFKnumout)(void *source, void *dest, uint32 num_elm, uint32 source_stride,
-                        uint32 dest_stride) = DFKInoset;
+typedef struct {
+    int32          ntype;   /* current number type */
+    DFKconv_func_t custin;  /* custom conversion from HDF to native format */
+    DFKconv_func_t custout; /* custom conversion from native to HDF format */
+} DFKstate_t;
+
+/* The calling thread's conversion settings, or NULL if they can't be allocated */
+#define DFKIget_state() ((DFKstate_t *)HTSlocal(HTS_CONV_STATE, sizeof(DFKstate_t), NULL))
 
 /************************************************************
  * If the programmer forgot to call DFKsetntype, then let
@@ -105,13 +117,140 @@ DFKInoset(void *source, void *dest, uint32 num_elm, uint32 source_stride, uint32
     return FAIL;
 }
 
+/************************************************************
+ * DFKIgetconv()
+ *   Look up the conversion routines for a number type, without
+ *   changing the conversion settings.  Custom number types
+ *   use the routines given to DFKsetcustom.
+ ************************************************************/
+static int
+DFKIgetconv(int32 ntype, DFKconv_func_t *numin, DFKconv_func_t *numout)
+{
+    switch (ntype) {
+        case DFNT_CHAR8:
+        case DFNT_UCHAR8:
+        case DFNT_INT8:
+        case DFNT_UINT8:
+            *numin  = UI8_IN;
+            *numout = UI8_OUT;
+            break;
+        case DFNT_INT16:
+            *numin  = SI16_IN;
+            *numout = SI16_OUT;
+            break;
+        case DFNT_UINT16:
+            *numin  = UI16_IN;
+            *numout = UI16_OUT;
+            break;
+        case DFNT_INT32:
+            *numin  = SI32_IN;
+            *numout = SI32_OUT;
+            break;
+        case DFNT_UINT32:
+            *numin  = UI32_IN;
+            *numout = UI32_OUT;
+            break;
+        case DFNT_FLOAT32:
+            *numin  = F32_IN;
+            *numout = F32_OUT;
+            break;
+        case DFNT_FLOAT64:
+            *numin  = F64_IN;
+            *numout = F64_OUT;
+            break;
+
+            /*
+             * NATIVE MODE 'CONVERSIONS'
+             */
+        case DFNT_NCHAR:
+        case DFNT_NINT8:
+        case DFNT_NUCHAR:
+        case DFNT_NUINT8:
+            *numin  = NUI8_IN;
+            *numout = NUI8_OUT;
+            break;
+        case DFNT_NINT16:
+            *numin  = NSI16_IN;
+            *numout = NSI16_OUT;
+            break;
+        case DFNT_NUINT16:
+            *numin  = NUI16_IN;
+            *numout = NUI16_OUT;
+            break;
+        case DFNT_NINT32:
+            *numin  = NSI32_IN;
+            *numout = NSI32_OUT;
+            break;
+        case DFNT_NUINT32:
+            *numin  = NUI32_IN;
+            *numout = NUI32_OUT;
+            break;
+        case DFNT_NFLOAT32:
+            *numin  = NF32_IN;
+            *numout = NF32_OUT;
+            break;
+        case DFNT_NFLOAT64:
+            *numin  = NF64_IN;
+            *numout = NF64_OUT;
+            break;
+
+            /*
+             * Little Endian Conversions
+             */
+        case DFNT_LCHAR:
+        case DFNT_LINT8:
+        case DFNT_LUCHAR:
+        case DFNT_LUINT8:
+            *numin  = LUI8_IN;
+            *numout = LUI8_OUT;
+            break;
+        case DFNT_LINT16:
+            *numin  = LSI16_IN;
+            *numout = LSI16_OUT;
+            break;
+        case DFNT_LUINT16:
+            *numin  = LUI16_IN;
+            *numout = LUI16_OUT;
+            break;
+        case DFNT_LINT32:
+            *numin  = LSI32_IN;
+            *numout = LSI32_OUT;
+            break;
+        case DFNT_LUINT32:
+            *numin  = LUI32_IN;
+            *numout = LUI32_OUT;
+            break;
+        case DFNT_LFLOAT32:
+            *numin  = LF32_IN;
+            *numout = LF32_OUT;
+            break;
+        case DFNT_LFLOAT64:
+            *numin  = LF64_IN;
+            *numout = LF64_OUT;
+            break;
+
+            /* No conversion routines are specified for DFNT_custom.  User must provide. */
+            /* Users should call DFCV_SetCustomIn() and DFCV_SetCustomOut() if they      */
+            /* choose to use DFNT_CUSTOM.  Users should provide their own method to      */
+            /* distinguish between multiple 'custom' conversion routines.  HDF only      */
+            /* knows such routines as type 'DFNT_CUSTOM'.                                */
+
+        case DFNT_CUSTOM: {
+            DFKstate_t *state = DFKIget_state();
+
+            *numin  = (state != NULL && state->custin != NULL) ? state->custin : DFKInoset;
+            *numout = (state != NULL && state->custout != NULL) ? state->custout : DFKInoset;
+        } break;
+        default:
+            return FAIL;
+    }
+    return SUCCEED;
+}
+
 /*****************************************************************************
  * Routines that depend on the above information
  *****************************************************************************/
 
-static int32 g_ntype = DFNT_NONE; /* Holds current number type. */
-                                  /* Initially not set.         */
-
 /************************************************************
  * DFKqueryNT()
  *   Determine the current conversion settings
@@ -119,7 +258,9 @@ static int32 g_ntype = DFNT_NONE; /* Holds current number type. */
 int32
 DFKqueryNT(void)
 {
-    return g_ntype;
+    DFKstate_t *state = DFKIget_state();
+
+    return state == NULL ? DFNT_NONE : state->ntype;
 }
 
 /************************************************************
@@ -200,125 +341,17 @@ DFKNTsize(int32 number_type)
 int
 DFKsetNT(int32 ntype)
 {
-    HEclear();
+    DFKstate_t    *state = DFKIget_state();
+    DFKconv_func_t numin, numout;
 
-    g_ntype = ntype;
-
-    switch (ntype) {
-        case DFNT_CHAR8:
-        case DFNT_UCHAR8:
-        case DFNT_INT8:
-        case DFNT_UINT8:
-            DFKnumin  = UI8_IN;
-            DFKnumout = UI8_OUT;
-            break;
-        case DFNT_INT16:
-            DFKnumin  = SI16_IN;
-            DFKnumout = SI16_OUT;
-            break;
-        case DFNT_UINT16:
-            DFKnumin  = UI16_IN;
-            DFKnumout = UI16_OUT;
-            break;
-        case DFNT_INT32:
-            DFKnumin  = SI32_IN;
-            DFKnumout = SI32_OUT;
-            break;
-        case DFNT_UINT32:
-            DFKnumin  = UI32_IN;
-            DFKnumout = UI32_OUT;
-            break;
-        case DFNT_FLOAT32:
-            DFKnumin  = F32_IN;
-            DFKnumout = F32_OUT;
-            break;
-        case DFNT_FLOAT64:
-            DFKnumin  = F64_IN;
-            DFKnumout = F64_OUT;
-            break;
-
-            /*
-             * NATIVE MODE 'CONVERSIONS'
-             */
-        case DFNT_NCHAR:
-        case DFNT_NINT8:
-        case DFNT_NUCHAR:
-        case DFNT_NUINT8:
-            DFKnumin  = NUI8_IN;
-            DFKnumout = NUI8_OUT;
-            break;
-        case DFNT_NINT16:
-            DFKnumin  = NSI16_IN;
-            DFKnumout = NSI16_OUT;
-            break;
-        case DFNT_NUINT16:
-            DFKnumin  = NUI16_IN;
-            DFKnumout = NUI16_OUT;
-            break;
-        case DFNT_NINT32:
-            DFKnumin  = NSI32_IN;
-            DFKnumout = NSI32_OUT;
-            break;
-        case DFNT_NUINT32:
-            DFKnumin  = NUI32_IN;
-            DFKnumout = NUI32_OUT;
-            break;
-        case DFNT_NFLOAT32:
-            DFKnumin  = NF32_IN;
-            DFKnumout = NF32_OUT;
-            break;
-        case DFNT_NFLOAT64:
-            DFKnumin  = NF64_IN;
-            DFKnumout = NF64_OUT;
-            break;
-
-            /*
-             * Little Endian Conversions
-             */
-        case DFNT_LCHAR:
-        case DFNT_LINT8:
-        case DFNT_LUCHAR:
-        case DFNT_LUINT8:
-            DFKnumin  = LUI8_IN;
-            DFKnumout = LUI8_OUT;
-            break;
-        case DFNT_LINT16:
-            DFKnumin  = LSI16_IN;
-            DFKnumout = LSI16_OUT;
-            break;
-        case DFNT_LUINT16:
-            DFKnumin  = LUI16_IN;
-            DFKnumout = LUI16_OUT;
-            break;
-        case DFNT_LINT32:
-            DFKnumin  = LSI32_IN;
-            DFKnumout = LSI32_OUT;
-            break;
-        case DFNT_LUINT32:
-            DFKnumin  = LUI32_IN;
-            DFKnumout = LUI32_OUT;
-            break;
-        case DFNT_LFLOAT32:
-            DFKnumin  = LF32_IN;
-            DFKnumout = LF32_OUT;
-            break;
-        case DFNT_LFLOAT64:
-            DFKnumin  = LF64_IN;
-            DFKnumout = LF64_OUT;
-            break;
+    HEclear();
 
-            /* No conversion routines are specified for DFNT_custom.  User must provide. */
-            /* Users should call DFCV_SetCustomIn() and DFCV_SetCustomOut() if they      */
-            /* choose to use DFNT_CUSTOM.  Users should provide their own method to      */
-            /* distinguish between multiple 'custom' conversion routines.  HDF only      */
-            /* knows such routines as type 'DFNT_CUSTOM'.                                */
+    if (state == NULL)
+        HRETURN_ERROR(DFE_NOSPACE, FAIL);
+    if (DFKIgetconv(ntype, &numin, &numout) == FAIL)
+        HRETURN_ERROR(DFE_BADCONV, FAIL);
 
-        case DFNT_CUSTOM:
-            g_ntype = DFNT_CUSTOM;
-            break;
-        default:
-            HRETURN_ERROR(DFE_BADCONV, FAIL);
-    }
+    state->ntype = ntype;
     return 0;
 }
 
@@ -332,8 +365,12 @@ DFKsetcustom(int (*DFKcustin)(void * /* source */, void * /* dest */, uint32 /*
              int (*DFKcustout)(void * /* source */, void * /* dest */, uint32 /* num_elm */,
                                uint32 /* source_stride */, uint32 /* dest_stride */))
 {
-    DFKnumin  = DFKcustin;
-    DFKnumout = DFKcustout;
+    DFKstate_t *state = DFKIget_state();
+
+    if (state == NULL)
+        return FAIL;
+    state->custin  = DFKcustin;
+    state->custout = DFKcustout;
     DFKsetNT(DFNT_CUSTOM); /* Keep HDF from getting confused */
     return 0;
 }
@@ -370,6 +407,60 @@ DFKislitendNT(int32 numbertype)
     return (DFNT_LITEND & numbertype) > 0 ? 1 : 0;
 }
 
+/*------------------------------------------------------------------
+ * Name:    DFKIiscopyNT
+ * Purpose: Determine whether data of a number type is stored in the
+ *          file exactly as it is in memory on this machine
+ * Inputs:  numbertype: number type
+ * Returns: 1 if true, 0 if false
+ * Users:   hdf_xdr_NCvdata, VSread
+ * Method:  Checks whether the conversion routines for the number type
+ *          are the native mode copies, so that callers can read and
+ *          write the data without DFKconvert and its buffers
+ * Remarks:
+ *------------------------------------------------------------------*/
+
+int
+DFKIiscopyNT(int32 numbertype)
+{
+    DFKconv_func_t numin, numout;
+
+    if (DFKIgetconv(numbertype, &numin, &numout) == FAIL || numin != numout)
+        return 0;
+    return (numin == DFKnb1b || numin == DFKnb2b || numin == DFKnb4b || numin == DFKnb8b) ? 1 : 0;
+}
+
+/*------------------------------------------------------------------
+ * Name:    DFKIswapsizeNT
+ * Purpose: Determine whether data of a number type is stored in the
+ *          file with the bytes of each item in the reverse of their
+ *          order in memory on this machine
+ * Inputs:  numbertype: number type
+ * Returns: the size of the items swapped (2, 4 or 8), or 0 if the
+ *          data is converted some other way
+ * Users:   VSread
+ * Method:  Checks whether the conversion routines for the number type
+ *          are the byte swapping ones, so that callers can swap the
+ *          data with DFKIswap
+ * Remarks:
+ *------------------------------------------------------------------*/
+
+int
+DFKIswapsizeNT(int32 numbertype)
+{
+    DFKconv_func_t numin, numout;
+
+    if (DFKIgetconv(numbertype, &numin, &numout) == FAIL || numin != numout)
+        return 0;
+    if (numin == DFKsb2b)
+        return 2;
+    if (numin == DFKsb4b)
+        return 4;
+    if (numin == DFKsb8b)
+        return 8;
+    return 0;
+}
+
 /************************************************************
  * DFconvert()
  *
@@ -390,11 +481,12 @@ DFKislitendNT(int32 numbertype)
 int
 DFconvert(uint8 *source, uint8 *dest, int ntype, int sourcetype, int desttype, int32 size)
 {
-    uint32 num_elm;
+    DFKconv_func_t numin, numout;
+    uint32         num_elm;
 
     HEclear();
 
-    if (DFKsetNT(ntype) == FAIL) {
+    if (DFKsetNT(ntype) == FAIL || DFKIgetconv(ntype, &numin, &numout) == FAIL) {
         HERROR(DFE_BADCONV);
         return FAIL;
     }
@@ -408,12 +500,12 @@ DFconvert(uint8 *source, uint8 *dest, int ntype, int sourcetype, int desttype, i
 
     /* Check to see if they want to convert numbers in from the disk */
     if (sourcetype == DFNTF_IEEE && (desttype == DFNTF_VAX || desttype == DFNTF_CRAY || desttype == DFNTF_PC))
-        return (DFKnumin)((void *)source, (void *)dest, num_elm, 0, 0);
+        return (*numin)((void *)source, (void *)dest, num_elm, 0, 0);
 
     /* Check to see if they want to convert numbers out to disk */
     if (desttype == DFNTF_IEEE &&
         (sourcetype == DFNTF_VAX || sourcetype == DFNTF_CRAY || sourcetype == DFNTF_PC))
-        return DFKnumout((void *)source, (void *)dest, num_elm, 0, 0);
+        return (*numout)((void *)source, (void *)dest, num_elm, 0, 0);
 
     /* Return an error because they did not specify valid translation codes */
     HERROR(DFE_BADCONV);
@@ -479,23 +571,27 @@ DFKgetPNSC(int32 numbertype, int32 machinetype)
  *      source_stride, dest_stride -- strides in source and destination
  * Returns: 0 -- succeed; FAIL -- failure
  * Users:   DFSDgetsdg, DFSDputsdg, DFSDIgetslice, DFSDIgetslice
- * Method:  Calls DFKsetNT, then call DFnumin or DFnumout
+ * Method:  Looks up the conversion routines for the number type and
+ *          calls the one for acc_mode.  Unlike DFKsetNT, the
+ *          conversion settings are left alone.
  *---------------------------------------------------------------------------*/
 int32
 DFKconvert(void *source, void *dest, int32 ntype, int32 num_elm, int16 acc_mode, int32 source_stride,
            int32 dest_stride)
 {
-    int ret;
+    DFKconv_func_t numin, numout;
+    int            ret;
 
     /* Check args (minimally) */
     if (source == NULL || dest == NULL)
         return -1;
 
-    DFKsetNT(ntype);
+    if (DFKIgetconv(ntype, &numin, &numout) == FAIL)
+        numin = numout = DFKInoset;
     if (acc_mode == DFACC_READ)
-        ret = DFKnumin(source, dest, (uint32)num_elm, (uint32)source_stride, (uint32)dest_stride);
+        ret = (*numin)(source, dest, (uint32)num_elm, (uint32)source_stride, (uint32)dest_stride);
     else
-        ret = DFKnumout(source, dest, (uint32)num_elm, (uint32)source_stride, (uint32)dest_stride);
+        ret = (*numout)(source, dest, (uint32)num_elm, (uint32)source_stride, (uint32)dest_stride);
     return ret;
 }
 
@@ -65,8 +65,6 @@ DFKnb1b(void *s, void *d, uint32 num_elm, uint32 source_stride, uint32 dest_stri
     uint8 *source = (uint8 *)s;
     uint8 *dest   = (uint8 *)d;
 
-    HEclear();
-
     if (num_elm == 0) {
         HERROR(DFE_BADCONV);
         return FAIL;
@@ -114,8 +112,6 @@ DFKnb2b(void *s, void *d, uint32 num_elm, uint32 source_stride, uint32 dest_stri
     uint8 *source = (uint8 *)s;
     uint8 *dest   = (uint8 *)d;
 
-    HEclear();
-
     if (num_elm == 0) {
         HERROR(DFE_BADCONV);
         return FAIL;
@@ -174,8 +170,6 @@ DFKnb4b(void *s, void *d, uint32 num_elm, uint32 source_stride, uint32 dest_stri
     uint8 *source = (uint8 *)s;
     uint8 *dest   = (uint8 *)d;
 
-    HEclear();
-
     if (num_elm == 0) {
         HERROR(DFE_BADCONV);
         return FAIL;
@@ -240,8 +234,6 @@ DFKnb8b(void *s, void *d, uint32 num_elm, uint32 source_stride, uint32 dest_stri
     uint8 *source = (uint8 *)s;
     uint8 *dest   = (uint8 *)d;
 
-    HEclear();
-
     if (num_elm == 0) {
         HERROR(DFE_BADCONV);
         return FAIL;
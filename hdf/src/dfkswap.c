@@ -21,11 +21,17 @@
     DFKsb2b -  Byte swapping for 16 bit integers
     DFKsb4b -  Byte swapping for 32 bit integers
     DFKsb8b -  Byte swapping for 64 bit floats
+    DFKIswap - Byte swapping for contiguous items of those sizes
 
  Remarks:
     These files used to be in dfconv.c, but it got a little too huge,
     so I broke them out into separate files. - Q
 
+    Contiguous items are swapped 16 or 32 bytes at a time with SSE2,
+    AVX2 or NEON instructions where the compiler and the CPU have them;
+    AVX2 is used when the CPU the library runs on supports it.  Items
+    which are left over, or which are strided, are swapped one at a time.
+
  *------------------------------------------------------------------*/
 
 /*****************************************************************************/
@@ -47,6 +53,113 @@
 #include "hdf_priv.h"
 #include "hconv_priv.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DFKI_HAVE_SSE2
+#endif
+
+#if defined(DFKI_HAVE_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define DFKI_HAVE_AVX2
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define DFKI_HAVE_NEON
+#endif
+
+/* Byte swapping of a single item */
+#if defined(__GNUC__)
+#define DFKI_BSWAP16(x) __builtin_bswap16(x)
+#define DFKI_BSWAP32(x) __builtin_bswap32(x)
+#define DFKI_BSWAP64(x) __builtin_bswap64(x)
+#else
+#define DFKI_BSWAP16(x) ((uint16_t)(((x) << 8) | ((x) >> 8)))
+#define DFKI_BSWAP32(x)                                                                                      \
+    ((((x) & 0xffU) << 24) | (((x) & 0xff00U) << 8) | (((x) >> 8) & 0xff00U) | ((x) >> 24))
+#define DFKI_BSWAP64(x) (((uint64_t)DFKI_BSWAP32((uint32_t)(x)) << 32) | DFKI_BSWAP32((uint32_t)((x) >> 32)))
+#endif
+
+#ifdef DFKI_HAVE_AVX2
+/* Swaps the items in as many 32-byte blocks of nbytes as there are, and
+   returns the # of bytes swapped */
+__attribute__((target("avx2"))) static size_t
+DFKIswap_avx2(const uint8 *source, uint8 *dest, size_t nbytes, int size)
+{
+    __m128i lane;
+    __m256i mask;
+    size_t  done;
+
+    /* The same byte order in both 16-byte lanes */
+    if (size == 2)
+        lane = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    else if (size == 4)
+        lane = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    else
+        lane = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    mask = _mm256_broadcastsi128_si256(lane);
+
+    for (done = 0; done + 32 <= nbytes; done += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(const void *)(source + done));
+
+        _mm256_storeu_si256((__m256i *)(void *)(dest + done), _mm256_shuffle_epi8(v, mask));
+    }
+    return done;
+} /* DFKIswap_avx2 */
+#endif /* DFKI_HAVE_AVX2 */
+
+/* Swaps the items in as many 16 or 32-byte blocks of nbytes as there are
+   with the vector instructions available, and returns the # of bytes
+   swapped */
+static size_t
+DFKIswap_vector(const uint8 *source, uint8 *dest, size_t nbytes, int size)
+{
+    size_t done = 0;
+
+#ifdef DFKI_HAVE_AVX2
+    if (nbytes >= 32 && __builtin_cpu_supports("avx2"))
+        done = DFKIswap_avx2(source, dest, nbytes, size);
+#endif
+
+#if defined(DFKI_HAVE_SSE2)
+    for (; done + 16 <= nbytes; done += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(source + done));
+
+        /* Put the 16-bit words of each item in reverse order, then swap
+           the bytes of each word */
+        if (size == 4) {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        }
+        else if (size == 8) {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        }
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i *)(void *)(dest + done), v);
+    }
+#elif defined(DFKI_HAVE_NEON)
+    for (; done + 16 <= nbytes; done += 16) {
+        uint8x16_t v = vld1q_u8(source + done);
+
+        if (size == 2)
+            v = vrev16q_u8(v);
+        else if (size == 4)
+            v = vrev32q_u8(v);
+        else
+            v = vrev64q_u8(v);
+        vst1q_u8(dest + done, v);
+    }
+#else
+    (void)source;
+    (void)dest;
+    (void)nbytes;
+    (void)size;
+#endif
+
+    return done;
+} /* DFKIswap_vector */
+
 /*****************************************************************************/
 /* NUMBER CONVERSION ROUTINES FOR BYTE SWAPPING                              */
 /*****************************************************************************/
@@ -58,68 +171,34 @@
 int
 DFKsb2b(void *s, void *d, uint32 num_elm, uint32 source_stride, uint32 dest_stride)
 {
-    int    fast_processing = 0; /* Default is not fast processing */
-    int    in_place        = 0; /* Inplace must be detected */
-    uint32 i;
-    uint8  buf[2]; /* Inplace processing buffer */
-    uint8 *source = (uint8 *)s;
-    uint8 *dest   = (uint8 *)d;
-
-    HEclear();
+    uint8   *source = (uint8 *)s;
+    uint8   *dest   = (uint8 *)d;
+    size_t   n      = num_elm;
+    uint16_t v;
 
     if (num_elm == 0) { /* No elements is an error. */
         HERROR(DFE_BADCONV);
         return FAIL;
     }
 
-    /* Determine if faster array processing is appropriate */
-    if (source_stride == 0 && dest_stride == 0)
-        fast_processing = 1;
-
-    /* Determine if the conversion should be inplace */
-    if (source == dest)
-        in_place = 1;
-
-    if (fast_processing) {
-        if (!in_place) {
-            for (i = 0; i < num_elm; i++) {
-                dest[0] = source[1];
-                dest[1] = source[0];
-                dest += 2;
-                source += 2;
-            }
-            return 0;
-        }
-        else {
-            for (i = 0; i < num_elm; i++) {
-                buf[0]  = source[1];
-                buf[1]  = source[0];
-                dest[0] = buf[0];
-                dest[1] = buf[1];
-                dest += 2;
-                source += 2;
-            }
-            return 0;
-        }
+    /* Contiguous items are swapped a block at a time, then the rest one at
+       a time; loading each item before storing it makes in-place work */
+    if ((source_stride == 0 && dest_stride == 0) || (source_stride == 2 && dest_stride == 2)) {
+        size_t done = DFKIswap_vector(source, dest, n * 2, 2);
+
+        source += done;
+        dest += done;
+        n -= done / 2;
+        source_stride = dest_stride = 2;
     }
 
-    /* Generic stride processing */
-    if (!in_place)
-        for (i = 0; i < num_elm; i++) {
-            dest[0] = source[1];
-            dest[1] = source[0];
-            dest += dest_stride;
-            source += source_stride;
-        }
-    else
-        for (i = 0; i < num_elm; i++) {
-            buf[0]  = source[1];
-            buf[1]  = source[0];
-            dest[0] = buf[0];
-            dest[1] = buf[1];
-            dest += dest_stride;
-            source += source_stride;
-        }
+    for (; n > 0; n--) {
+        memcpy(&v, source, 2);
+        v = DFKI_BSWAP16(v);
+        memcpy(dest, &v, 2);
+        dest += dest_stride;
+        source += source_stride;
+    }
     return 0;
 }
 
@@ -130,80 +209,34 @@ DFKsb2b(void *s, void *d, uint32 num_elm, uint32 source_stride, uint32 dest_stri
 int
 DFKsb4b(void *s, void *d, uint32 num_elm, uint32 source_stride, uint32 dest_stride)
 {
-    int    fast_processing = 0; /* Default is not fast processing */
-    int    in_place        = 0; /* Inplace must be detected */
-    uint32 i;
-    uint8  buf[4]; /* Inplace processing buffer */
-    uint8 *source = (uint8 *)s;
-    uint8 *dest   = (uint8 *)d;
-
-    HEclear();
+    uint8   *source = (uint8 *)s;
+    uint8   *dest   = (uint8 *)d;
+    size_t   n      = num_elm;
+    uint32_t v;
 
     if (num_elm == 0) { /* No elements is an error. */
         HERROR(DFE_BADCONV);
         return FAIL;
     }
 
-    /* Determine if faster array processing is appropriate */
-    if (source_stride == 0 && dest_stride == 0)
-        fast_processing = 1;
-
-    /* Determine if the conversion should be inplace */
-    if (source == dest)
-        in_place = 1;
-
-    if (fast_processing) {
-        if (!in_place) {
-            for (i = 0; i < num_elm; i++) {
-                dest[0] = source[3];
-                dest[1] = source[2];
-                dest[2] = source[1];
-                dest[3] = source[0];
-                dest += 4;
-                source += 4;
-            }
-            return 0;
-        }
-        else {
-            for (i = 0; i < num_elm; i++) {
-                buf[0]  = source[3];
-                buf[1]  = source[2];
-                buf[2]  = source[1];
-                buf[3]  = source[0];
-                dest[0] = buf[0];
-                dest[1] = buf[1];
-                dest[2] = buf[2];
-                dest[3] = buf[3];
-                dest += 4;
-                source += 4;
-            }
-            return 0;
-        }
+    /* Contiguous items are swapped a block at a time, then the rest one at
+       a time */
+    if ((source_stride == 0 && dest_stride == 0) || (source_stride == 4 && dest_stride == 4)) {
+        size_t done = DFKIswap_vector(source, dest, n * 4, 4);
+
+        source += done;
+        dest += done;
+        n -= done / 4;
+        source_stride = dest_stride = 4;
     }
 
-    /* Generic stride processing */
-    if (!in_place)
-        for (i = 0; i < num_elm; i++) {
-            dest[0] = source[3];
-            dest[1] = source[2];
-            dest[2] = source[1];
-            dest[3] = source[0];
-            dest += dest_stride;
-            source += source_stride;
-        }
-    else
-        for (i = 0; i < num_elm; i++) {
-            buf[0]  = source[3];
-            buf[1]  = source[2];
-            buf[2]  = source[1];
-            buf[3]  = source[0];
-            dest[0] = buf[0];
-            dest[1] = buf[1];
-            dest[2] = buf[2];
-            dest[3] = buf[3];
-            dest += dest_stride;
-            source += source_stride;
-        }
+    for (; n > 0; n--) {
+        memcpy(&v, source, 4);
+        v = DFKI_BSWAP32(v);
+        memcpy(dest, &v, 4);
+        dest += dest_stride;
+        source += source_stride;
+    }
     return 0;
 }
 
@@ -214,104 +247,73 @@ DFKsb4b(void *s, void *d, uint32 num_elm, uint32 source_stride, uint32 dest_stri
 int
 DFKsb8b(void *s, void *d, uint32 num_elm, uint32 source_stride, uint32 dest_stride)
 {
-    int    fast_processing = 0; /* Default is not fast processing */
-    int    in_place        = 0; /* Inplace must be detected */
-    uint32 i;
-    uint8  buf[8]; /* Inplace processing buffer */
-    uint8 *source = (uint8 *)s;
-    uint8 *dest   = (uint8 *)d;
-
-    HEclear();
+    uint8   *source = (uint8 *)s;
+    uint8   *dest   = (uint8 *)d;
+    size_t   n      = num_elm;
+    uint64_t v;
 
     if (num_elm == 0) { /* No elements is an error. */
         HERROR(DFE_BADCONV);
         return FAIL;
     }
 
-    /* Determine if faster array processing is appropriate */
-    if (source_stride == 0 && dest_stride == 0)
-        fast_processing = 1;
-
-    /* Determine if the conversion should be inplace */
-    if (source == dest)
-        in_place = 1;
-
-    if (fast_processing) {
-        if (!in_place) {
-            for (i = 0; i < num_elm; i++) {
-                dest[0] = source[7];
-                dest[1] = source[6];
-                dest[2] = source[5];
-                dest[3] = source[4];
-                dest[4] = source[3];
-                dest[5] = source[2];
-                dest[6] = source[1];
-                dest[7] = source[0];
-                dest += 8;
-                source += 8;
-            }
-            return 0;
-        }
-        else {
-            for (i = 0; i < num_elm; i++) {
-                buf[0]  = source[7];
-                buf[1]  = source[6];
-                buf[2]  = source[5];
-                buf[3]  = source[4];
-                buf[4]  = source[3];
-                buf[5]  = source[2];
-                buf[6]  = source[1];
-                buf[7]  = source[0];
-                dest[0] = buf[0];
-                dest[1] = buf[1];
-                dest[2] = buf[2];
-                dest[3] = buf[3];
-                dest[4] = buf[4];
-                dest[5] = buf[5];
-                dest[6] = buf[6];
-                dest[7] = buf[7];
-                dest += 8;
-                source += 8;
-            }
-            return 0;
-        }
+    /* Contiguous items are swapped a block at a time, then the rest one at
+       a time */
+    if ((source_stride == 0 && dest_stride == 0) || (source_stride == 8 && dest_stride == 8)) {
+        size_t done = DFKIswap_vector(source, dest, n * 8, 8);
+
+        source += done;
+        dest += done;
+        n -= done / 8;
+        source_stride = dest_stride = 8;
     }
 
-    /* Generic stride processing */
-    if (!in_place)
-        for (i = 0; i < num_elm; i++) {
-            dest[0] = source[7];
-            dest[1] = source[6];
-            dest[2] = source[5];
-            dest[3] = source[4];
-            dest[4] = source[3];
-            dest[5] = source[2];
-            dest[6] = source[1];
-            dest[7] = source[0];
-            dest += dest_stride;
-            source += source_stride;
+    for (; n > 0; n--) {
+        memcpy(&v, source, 8);
+        v = DFKI_BSWAP64(v);
+        memcpy(dest, &v, 8);
+        dest += dest_stride;
+        source += source_stride;
+    }
+    return 0;
+}
+
+/************************************************************/
+/* DFKIswap()                                               */
+/* -->Byte swapping for contiguous 2, 4 or 8 byte items,    */
+/*    without the checks of the routines above, for callers */
+/*    which swap many short runs of items                   */
+/************************************************************/
+void
+DFKIswap(const void *s, void *d, size_t num_elm, int size)
+{
+    const uint8 *source = (const uint8 *)s;
+    uint8       *dest   = (uint8 *)d;
+    size_t       nbytes = num_elm * (size_t)size;
+    size_t       done   = nbytes >= 16 ? DFKIswap_vector(source, dest, nbytes, size) : 0;
+
+    if (size == 2)
+        for (; done < nbytes; done += 2) {
+            uint16_t v;
+
+            memcpy(&v, source + done, 2);
+            v = DFKI_BSWAP16(v);
+            memcpy(dest + done, &v, 2);
         }
-    else
-        for (i = 0; i < num_elm; i++) {
-            buf[0]  = source[7];
-            buf[1]  = source[6];
-            buf[2]  = source[5];
-            buf[3]  = source[4];
-            buf[4]  = source[3];
-            buf[5]  = source[2];
-            buf[6]  = source[1];
-            buf[7]  = source[0];
-            dest[0] = buf[0];
-            dest[1] = buf[1];
-            dest[2] = buf[2];
-            dest[3] = buf[3];
-            dest[4] = buf[4];
-            dest[5] = buf[5];
-            dest[6] = buf[6];
-            dest[7] = buf[7];
-            dest += dest_stride;
-            source += source_stride;
+    else if (size == 4)
+        for (; done < nbytes; done += 4) {
+            uint32_t v;
+
+            memcpy(&v, source + done, 4);
+            v = DFKI_BSWAP32(v);
+            memcpy(dest + done, &v, 4);
         }
+    else
+        for (; done < nbytes; done += 8) {
+            uint64_t v;
 
-    return 0;
+            memcpy(&v, source + done, 8);
+            v = DFKI_BSWAP64(v);
+            memcpy(dest + done, &v, 8);
+        }
 }
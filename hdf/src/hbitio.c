@@ -27,10 +27,14 @@ EXPORTED ROUTINES
    Happendable    - make a writable dataset appendable
    Hbitread       - read bits from a bitfile dataset
    Hbitwrite      - write bits to a bitfile dataset
+   Hbitread_n     - read an array of fixed-width values from a bitfile dataset
+   Hbitwrite_n    - write an array of fixed-width values to a bitfile dataset
    Hbitseek       - seek to a given bit offset in a bitfile dataset
    Hendbitaccess  - close off access to a bitfile dataset
 LOCAL ROUTINES
    HIbitflush         - flush the bits out to a writable bitfile
+   HIbitfill          - read the next block of a bitfile into its buffer
+   HIbitnext          - write out a full buffer and move to the next block
    HIget_bitfile_rec  - get a free bitfile record
    HIread2write       - switch from reading bits to writing them
    HIwrite2read       - switch from writing bits to reading them
@@ -63,6 +67,9 @@ static bitrec_t *HIget_bitfile_rec(void);
 
 static int HIbitflush(bitrec_t *bitfile_rec, int flushbit, int writeout);
 
+static int32 HIbitfill(bitrec_t *bitfile_rec);
+static int   HIbitnext(bitrec_t *bitfile_rec);
+
 static int HIwrite2read(bitrec_t *bitfile_rec);
 static int HIread2write(bitrec_t *bitfile_rec);
 
@@ -132,6 +139,7 @@ Hstartbitread(int32 file_id, uint16 tag, uint16 ref)
             return FAIL;                            /* EOF? somebody pulled the rug out from under us! */
         bitfile_rec->buf_read = (int)n;             /* keep track of the number of bytes in buffer */
         bitfile_rec->bytep    = bitfile_rec->bytea; /* set to the beginning of the buffer */
+        bitfile_rec->bytez    = bitfile_rec->bytea + n;
     }                                               /* end if */
     else {
         bitfile_rec->bytep    = bitfile_rec->bytez; /* set to the end of the buffer to force read */
@@ -290,9 +298,8 @@ Hbitappendable(int32 bitid)
 int
 Hbitwrite(int32 bitid, int count, uint32 data)
 {
-    static int32     last_bit_id = (-1);  /* the bit ID of the last bitfile_record accessed */
-    static bitrec_t *bitfile_rec = NULL;  /* access record */
-    int              orig_count  = count; /* keep track of orig, number of bits to output */
+    bitrec_t *bitfile_rec = NULL;  /* access record */
+    int       orig_count  = count; /* keep track of orig, number of bits to output */
 
     /* clear error stack and check validity of file id */
     HEclear();
@@ -300,11 +307,9 @@ Hbitwrite(int32 bitid, int count, uint32 data)
     if (count <= 0)
         HRETURN_ERROR(DFE_ARGS, FAIL);
 
-    /* cache the bitfile_record since this routine gets called so many times */
-    if (bitid != last_bit_id) {
-        bitfile_rec = HAatom_object(bitid);
-        last_bit_id = bitid;
-    }
+    /* look the record up each time; a cached one could be stale or belong to
+       another thread */
+    bitfile_rec = HAatom_object(bitid);
 
     if (bitfile_rec == NULL)
         HRETURN_ERROR(DFE_ARGS, FAIL);
@@ -332,56 +337,18 @@ Hbitwrite(int32 bitid, int count, uint32 data)
     /* fill up the current bits buffer and output the byte */
     *(bitfile_rec->bytep) = (uint8)(bitfile_rec->bits | (uint8)(data >> (count -= bitfile_rec->count)));
     bitfile_rec->byte_offset++;
-    if (++bitfile_rec->bytep == bitfile_rec->bytez) {
-        int32 write_size;
-
-        write_size         = (int32)(bitfile_rec->bytez - bitfile_rec->bytea);
-        bitfile_rec->bytep = bitfile_rec->bytea;
-        if (Hwrite(bitfile_rec->acc_id, write_size, bitfile_rec->bytea) == FAIL)
+    if (++bitfile_rec->bytep == bitfile_rec->bytez)
+        if (HIbitnext(bitfile_rec) == FAIL)
             HRETURN_ERROR(DFE_WRITEERROR, FAIL);
-        bitfile_rec->block_offset += write_size;
-
-        /* check if we should pre-read the next block into the buffer */
-        if (bitfile_rec->max_offset > bitfile_rec->byte_offset) {
-            int32 read_size; /* number of bytes to read into buffer */
-            int32 n;         /* number of bytes actually read */
-
-            read_size = MIN((bitfile_rec->max_offset - bitfile_rec->byte_offset), BITBUF_SIZE);
-            if ((n = Hread(bitfile_rec->acc_id, read_size, bitfile_rec->bytea)) == FAIL)
-                HRETURN_ERROR(DFE_READERROR, FAIL); /* EOF? somebody pulled the rug out from under us! */
-            bitfile_rec->buf_read = n;              /* keep track of the number of bytes in buffer */
-            if (Hseek(bitfile_rec->acc_id, bitfile_rec->block_offset, DF_START) == FAIL)
-                HRETURN_ERROR(DFE_SEEKERROR, FAIL);
-        } /* end if */
-    }     /* end if */
 
     /* output any and all remaining whole bytes */
     while (count >= (int)BITNUM) {
         *(bitfile_rec->bytep) = (uint8)(data >> (count -= (int)BITNUM));
         bitfile_rec->byte_offset++;
-        if (++bitfile_rec->bytep == bitfile_rec->bytez) {
-            int32 write_size;
-
-            write_size         = (int32)(bitfile_rec->bytez - bitfile_rec->bytea);
-            bitfile_rec->bytep = bitfile_rec->bytea;
-            if (Hwrite(bitfile_rec->acc_id, write_size, bitfile_rec->bytea) == FAIL)
+        if (++bitfile_rec->bytep == bitfile_rec->bytez)
+            if (HIbitnext(bitfile_rec) == FAIL)
                 HRETURN_ERROR(DFE_WRITEERROR, FAIL);
-            bitfile_rec->block_offset += write_size;
-
-            /* check if we should pre-read the next block into the buffer */
-            if (bitfile_rec->max_offset > bitfile_rec->byte_offset) {
-                int32 read_size; /* number of bytes to read into buffer */
-                int32 n;         /* number of bytes actually read */
-
-                read_size = MIN((bitfile_rec->max_offset - bitfile_rec->byte_offset), BITBUF_SIZE);
-                if ((n = Hread(bitfile_rec->acc_id, read_size, bitfile_rec->bytea)) == FAIL)
-                    HRETURN_ERROR(DFE_READERROR, FAIL); /* EOF? somebody pulled the rug out from under us! */
-                bitfile_rec->buf_read = n;              /* keep track of the number of bytes in buffer */
-                if (Hseek(bitfile_rec->acc_id, bitfile_rec->block_offset, DF_START) == FAIL)
-                    HRETURN_ERROR(DFE_SEEKERROR, FAIL);
-            } /* end if */
-        }     /* end if */
-    }         /* end while */
+    } /* end while */
 
     /* put any remaining bits into the bits buffer */
     if ((bitfile_rec->count = (int)BITNUM - count) > 0)
@@ -420,12 +387,10 @@ Hbitwrite(int32 bitid, int count, uint32 data)
 int
 Hbitread(int32 bitid, int count, uint32 *data)
 {
-    static int32     last_bit_id = (-1); /* the bit ID of the last bitfile_record accessed */
-    static bitrec_t *bitfile_rec = NULL; /* access record */
-    uint32           l;
-    uint32           b = 0;      /* bits to return */
-    int              orig_count; /* the original number of bits to read in */
-    int32            n;
+    bitrec_t *bitfile_rec = NULL; /* access record */
+    uint32    l;
+    uint32    b = 0;      /* bits to return */
+    int       orig_count; /* the original number of bits to read in */
 
     /* clear error stack and check validity of file id */
     HEclear();
@@ -433,11 +398,9 @@ Hbitread(int32 bitid, int count, uint32 *data)
     if (count <= 0)
         HRETURN_ERROR(DFE_ARGS, FAIL);
 
-    /* cache the bitfile_record since this routine gets called so many times */
-    if (bitid != last_bit_id) {
-        bitfile_rec = HAatom_object(bitid);
-        last_bit_id = bitid;
-    }
+    /* look the record up each time; a cached one could be stale or belong to
+       another thread */
+    bitfile_rec = HAatom_object(bitid);
 
     if (bitfile_rec == NULL)
         HRETURN_ERROR(DFE_ARGS, FAIL);
@@ -469,18 +432,13 @@ Hbitread(int32 bitid, int count, uint32 *data)
     /* bring in as many whole bytes as the request allows */
     while (count >= (int)BITNUM) {
         if (bitfile_rec->bytep == bitfile_rec->bytez) {
-            n = Hread(bitfile_rec->acc_id, BITBUF_SIZE, bitfile_rec->bytea);
-            if (n == FAIL) { /* EOF */
+            if (HIbitfill(bitfile_rec) == FAIL) { /* EOF */
                 bitfile_rec->count =
                     0;     /* make certain that we don't try to access the file->bits information */
                 *data = b; /* assign the bits read in */
                 return orig_count - count; /* break out now */
             }                              /* end if */
-            bitfile_rec->block_offset +=
-                bitfile_rec->buf_read; /* keep track of the number of bytes in buffer */
-            bitfile_rec->bytez    = n + (bitfile_rec->bytep = bitfile_rec->bytea);
-            bitfile_rec->buf_read = n; /* keep track of the number of bytes in buffer */
-        }                              /* end if */
+        }                                  /* end if */
         l = (uint32)(*bitfile_rec->bytep++);
         b |= (uint32)(l << (count -= (int)BITNUM));
         bitfile_rec->byte_offset++;
@@ -491,18 +449,13 @@ Hbitread(int32 bitid, int count, uint32 *data)
     /* split any partial request with the bits buffer */
     if (count > 0) {
         if (bitfile_rec->bytep == bitfile_rec->bytez) {
-            n = Hread(bitfile_rec->acc_id, BITBUF_SIZE, bitfile_rec->bytea);
-            if (n == FAIL) { /* EOF */
+            if (HIbitfill(bitfile_rec) == FAIL) { /* EOF */
                 bitfile_rec->count =
                     0;     /* make certain that we don't try to access the file->bits information */
                 *data = b; /* assign the bits read in */
                 return orig_count - count; /* return now */
             }                              /* end if */
-            bitfile_rec->block_offset +=
-                bitfile_rec->buf_read; /* keep track of the number of bytes in buffer */
-            bitfile_rec->bytez    = n + (bitfile_rec->bytep = bitfile_rec->bytea);
-            bitfile_rec->buf_read = n; /* keep track of the number of bytes in buffer */
-        }                              /* end if */
+        }                                  /* end if */
         bitfile_rec->count = ((int)BITNUM - count);
         l                  = (uint32)(bitfile_rec->bits = *bitfile_rec->bytep++);
         b |= l >> bitfile_rec->count;
@@ -517,6 +470,180 @@ Hbitread(int32 bitid, int count, uint32 *data)
     return orig_count;
 } /* end Hbitread() */
 
+/*--------------------------------------------------------------------------
+
+ NAME
+       Hbitread_n -- read an array of fixed-width values from a bit-element
+ USAGE
+       int32 Hbitread_n(bitid, count, nvals, data)
+       int32 bitid;         IN: id of bit-element to read from
+       int count;          IN: number of bits in each value, 1 to 32
+       int32 nvals;         IN: number of values to read
+       uint32 *data;        OUT: the values read in
+                            (bits of each value will be in the low bits)
+ RETURNS
+       the number of values read, which is less than nvals if the end
+       of the element is reached, or FAIL to indicate failure
+ DESCRIPTION
+       Reads the same bits as nvals calls to Hbitread with the same count,
+       but gathers them through a 64-bit accumulator loaded a word at a
+       time, rather than masking and shifting each value a byte at a time.
+ GLOBAL VARIABLES
+ COMMENTS, BUGS, ASSUMPTIONS
+ EXAMPLES
+ REVISION LOG
+--------------------------------------------------------------------------*/
+int32
+Hbitread_n(int32 bitid, int count, int32 nvals, uint32 *data)
+{
+    bitrec_t *bitfile_rec; /* access record */
+    uint64_t  acc;         /* bits read in, the newest in the low bits */
+    int       nacc;        /* # of bits in acc not returned yet */
+    int       nback;       /* # of whole bytes in acc to give back */
+    uint8    *p, *pz;      /* local copies of the buffer pointers */
+    int32     i;
+
+    /* clear error stack and check validity of file id */
+    HEclear();
+
+    if (count <= 0 || count > (int)DATANUM || nvals < 0 || data == NULL)
+        HRETURN_ERROR(DFE_ARGS, FAIL);
+
+    if ((bitfile_rec = HAatom_object(bitid)) == NULL)
+        HRETURN_ERROR(DFE_ARGS, FAIL);
+
+    /* change bitfile modes if necessary */
+    if (bitfile_rec->mode == 'w')
+        if (HIwrite2read(bitfile_rec) == FAIL)
+            HRETURN_ERROR(DFE_INTERNAL, FAIL);
+
+    /* start with the bits left in the current byte; the whole byte goes in
+       acc, so it can be put back below */
+    acc  = bitfile_rec->bits;
+    nacc = bitfile_rec->count;
+    p    = bitfile_rec->bytep;
+    pz   = bitfile_rec->bytez;
+
+    for (i = 0; i < nvals; i++) {
+        while (nacc < count) {
+            if (pz - p >= 4) { /* nacc < 32, so a whole word fits */
+                acc = (acc << 32) | ((uint64_t)p[0] << 24) | ((uint64_t)p[1] << 16) | ((uint64_t)p[2] << 8) |
+                      (uint64_t)p[3];
+                p += 4;
+                nacc += 32;
+            }
+            else {
+                if (p == pz) {
+                    bitfile_rec->byte_offset += (int32)(p - bitfile_rec->bytep);
+                    if (HIbitfill(bitfile_rec) <= 0) { /* EOF */
+                        bitfile_rec->count = 0;
+                        return i;
+                    }
+                    p  = bitfile_rec->bytep;
+                    pz = bitfile_rec->bytez;
+                }
+                acc = (acc << 8) | *p++;
+                nacc += 8;
+            }
+        }
+        nacc -= count;
+        data[i] = (uint32)(acc >> nacc) & maskl[count];
+    }
+
+    /* Give back the whole bytes not used; they were all loaded by the last
+       word from this buffer.  The byte holding the bits left over is then
+       the low byte of what remains in acc. */
+    nback = nacc / (int)BITNUM;
+    p -= nback;
+    nacc -= nback * (int)BITNUM;
+    bitfile_rec->byte_offset += (int32)(p - bitfile_rec->bytep);
+    bitfile_rec->bytep = p;
+    bitfile_rec->count = nacc;
+    bitfile_rec->bits  = (uint8)(acc >> (nback * (int)BITNUM));
+    if (bitfile_rec->byte_offset > bitfile_rec->max_offset)
+        bitfile_rec->max_offset = bitfile_rec->byte_offset;
+
+    return nvals;
+} /* end Hbitread_n() */
+
+/*--------------------------------------------------------------------------
+
+ NAME
+       Hbitwrite_n -- write an array of fixed-width values to a bit-element
+ USAGE
+       int32 Hbitwrite_n(bitid, count, nvals, data)
+       int32 bitid;         IN: id of bit-element to write to
+       int count;          IN: number of bits in each value, 1 to 32
+       int32 nvals;         IN: number of values to write
+       const uint32 *data;  IN: the values to output
+                            (bits to output must be in the low bits)
+ RETURNS
+       the number of values written, or FAIL to indicate failure
+ DESCRIPTION
+       Writes the same bits as nvals calls to Hbitwrite with the same count,
+       merging the values in a 64-bit accumulator and storing whole bytes
+       from it.
+ GLOBAL VARIABLES
+ COMMENTS, BUGS, ASSUMPTIONS
+ EXAMPLES
+ REVISION LOG
+--------------------------------------------------------------------------*/
+int32
+Hbitwrite_n(int32 bitid, int count, int32 nvals, const uint32 *data)
+{
+    bitrec_t *bitfile_rec; /* access record */
+    uint64_t  acc;         /* bits to output, the newest in the low bits */
+    int       nacc;        /* # of bits in acc not stored yet */
+    uint32    mask;        /* mask for the bits of a value */
+    int32     i;
+
+    /* clear error stack and check validity of file id */
+    HEclear();
+
+    if (count <= 0 || count > (int)DATANUM || nvals < 0 || data == NULL)
+        HRETURN_ERROR(DFE_ARGS, FAIL);
+
+    if ((bitfile_rec = HAatom_object(bitid)) == NULL)
+        HRETURN_ERROR(DFE_ARGS, FAIL);
+
+    /* Check for write access */
+    if (bitfile_rec->access != 'w')
+        HRETURN_ERROR(DFE_BADACC, FAIL);
+
+    /* change bitfile modes if necessary */
+    if (bitfile_rec->mode == 'r')
+        if (HIread2write(bitfile_rec) == FAIL)
+            HRETURN_ERROR(DFE_INTERNAL, FAIL);
+
+    /* start with the bits already in the current byte */
+    nacc = (int)BITNUM - bitfile_rec->count;
+    acc  = (uint64_t)bitfile_rec->bits >> bitfile_rec->count;
+    mask = maskl[count];
+
+    for (i = 0; i < nvals; i++) {
+        acc = (acc << count) | (data[i] & mask);
+        nacc += count;
+        while (nacc >= (int)BITNUM) {
+            nacc -= (int)BITNUM;
+            *(bitfile_rec->bytep) = (uint8)(acc >> nacc);
+            bitfile_rec->byte_offset++;
+            if (++bitfile_rec->bytep == bitfile_rec->bytez)
+                if (HIbitnext(bitfile_rec) == FAIL)
+                    HRETURN_ERROR(DFE_WRITEERROR, FAIL);
+        }
+    }
+
+    /* keep the bits left over for the next write */
+    bitfile_rec->count = (int)BITNUM - nacc;
+    bitfile_rec->bits  = (uint8)(acc << bitfile_rec->count);
+
+    /* Update the offset in the buffer */
+    if (bitfile_rec->byte_offset > bitfile_rec->max_offset)
+        bitfile_rec->max_offset = bitfile_rec->byte_offset;
+
+    return nvals;
+} /* end Hbitwrite_n() */
+
 /*--------------------------------------------------------------------------
 
  NAME
@@ -787,6 +914,81 @@ HIbitflush(bitrec_t *bitfile_rec, int flushbit, int writeout)
     return SUCCEED;
 } /* HIbitflush */
 
+/*--------------------------------------------------------------------------
+
+ NAME
+    HIbitfill -- read the next block of a bitfile into its buffer
+ USAGE
+    int32 HIbitfill(bitfile_rec)
+        bitrec_t *bitfile_rec;  IN: record of bitfile element to read
+ RETURNS
+    the number of bytes read, which is 0 at the end of the element, or
+    FAIL (-1)
+ DESCRIPTION
+    Used when reading has reached the end of the buffer.
+ GLOBAL VARIABLES
+ COMMENTS, BUGS, ASSUMPTIONS
+ EXAMPLES
+ REVISION LOG
+--------------------------------------------------------------------------*/
+static int32
+HIbitfill(bitrec_t *bitfile_rec)
+{
+    int32 n; /* number of bytes actually read */
+
+    if ((n = Hread(bitfile_rec->acc_id, BITBUF_SIZE, bitfile_rec->bytea)) == FAIL)
+        return FAIL;
+    bitfile_rec->block_offset += bitfile_rec->buf_read; /* the block just finished */
+    bitfile_rec->bytez    = n + (bitfile_rec->bytep = bitfile_rec->bytea);
+    bitfile_rec->buf_read = n; /* keep track of the number of bytes in buffer */
+    return n;
+} /* HIbitfill */
+
+/*--------------------------------------------------------------------------
+
+ NAME
+    HIbitnext -- write out a full buffer and move to the next block
+ USAGE
+    int HIbitnext(bitfile_rec)
+        bitrec_t *bitfile_rec;  IN: record of bitfile element to write
+ RETURNS
+    returns SUCCEED (0) if successful, FAIL (-1) otherwise
+ DESCRIPTION
+    Used when writing has filled the buffer.  If the element already has
+    bytes past the buffer, the next block of them is read in, so that a
+    partial byte written there is merged with them.
+ GLOBAL VARIABLES
+ COMMENTS, BUGS, ASSUMPTIONS
+ EXAMPLES
+ REVISION LOG
+--------------------------------------------------------------------------*/
+static int
+HIbitnext(bitrec_t *bitfile_rec)
+{
+    int32 write_size;
+
+    write_size         = (int32)(bitfile_rec->bytez - bitfile_rec->bytea);
+    bitfile_rec->bytep = bitfile_rec->bytea;
+    if (Hwrite(bitfile_rec->acc_id, write_size, bitfile_rec->bytea) == FAIL)
+        HRETURN_ERROR(DFE_WRITEERROR, FAIL);
+    bitfile_rec->block_offset += write_size;
+
+    /* check if we should pre-read the next block into the buffer */
+    if (bitfile_rec->max_offset > bitfile_rec->byte_offset) {
+        int32 read_size; /* number of bytes to read into buffer */
+        int32 n;         /* number of bytes actually read */
+
+        read_size = MIN((bitfile_rec->max_offset - bitfile_rec->byte_offset), BITBUF_SIZE);
+        if ((n = Hread(bitfile_rec->acc_id, read_size, bitfile_rec->bytea)) == FAIL)
+            HRETURN_ERROR(DFE_READERROR, FAIL); /* EOF? somebody pulled the rug out from under us! */
+        bitfile_rec->buf_read = n;              /* keep track of the number of bytes in buffer */
+        if (Hseek(bitfile_rec->acc_id, bitfile_rec->block_offset, DF_START) == FAIL)
+            HRETURN_ERROR(DFE_SEEKERROR, FAIL);
+    } /* end if */
+
+    return SUCCEED;
+} /* HIbitnext */
+
 /*--------------------------------------------------------------------------
  HIget_bitfile_rec - get a new bitfile record
 --------------------------------------------------------------------------*/
@@ -98,6 +98,21 @@
    For now, HLcreate() has the best description of what the on-disk
    representation of a linked block element looks like.
 
+   Block Runs
+   **********
+   Every block after the first has the same length, so the blocks can't
+   grow, but new blocks are placed in runs of space reserved for them at
+   the end of the file.  Each run has room for twice as many blocks as the
+   one before it, up to HDF_LINKED_RUN_MAX bytes, so the blocks of an
+   element which is appended to a block at a time stay next to each other
+   when other elements, block tables or DD blocks are written between
+   them.  What's left of a run when the element is closed is given back
+   if nothing was put after it.
+
+   HLPread collects where in the file each block it needs is, then reads
+   them all with HP_readv(), which reads the blocks that are next to each
+   other, or nearly so, with one system call.
+
 EXPORTED ROUTINES
 
    HLcreate       -- create a linked block element
@@ -116,11 +131,15 @@ LOCAL ROUTINES
    HLIstaccess -- set up AID to access a linked block elem
    HLIgetlink  -- get link information
    HLInewlink  -- write out some data to a linked block
+   HLInewblock -- start writing a new block in the element's run
 */
 
 #include "hdf_priv.h"
 #include "hfile_priv.h"
 
+/* Most pieces HLPread gives HP_readv() at once */
+#define HL_READ_PLAN_MAX 1024
+
 /* block_t - record of a linked block. contains the tag and ref of the
    data elt that forms the linked block */
 typedef struct block_t {
@@ -137,14 +156,17 @@ typedef struct link_t {
 
 /* information on this special linked block data elt */
 typedef struct linkinfo_t {
-    int     attached;      /* how many access records refer to this elt */
-    int32   length;        /* the actual length of the data elt */
-    int32   first_length;  /* length of first block */
-    int32   block_length;  /* the length of the remaining blocks */
-    int32   number_blocks; /* total number of blocks in each link/block table */
-    uint16  link_ref;      /* ref of the first block table structure */
-    link_t *link;          /* pointer to the first block table */
-    link_t *last_link;     /* pointer to the last block table */
+    int       attached;      /* how many access records refer to this elt */
+    int32     length;        /* the actual length of the data elt */
+    int32     first_length;  /* length of first block */
+    int32     block_length;  /* the length of the remaining blocks */
+    int32     number_blocks; /* total number of blocks in each link/block table */
+    uint16    link_ref;      /* ref of the first block table structure */
+    link_t   *link;          /* pointer to the first block table */
+    link_t   *last_link;     /* pointer to the last block table */
+    hdf_off_t run_off;       /* offset of the next unused block in the run */
+    int32     run_left;      /* # of unused blocks left in the run */
+    int32     run_blocks;    /* # of blocks the run had room for */
 } linkinfo_t;
 
 /* private functions */
@@ -154,6 +176,8 @@ static link_t *HLInewlink(int32 file_id, int32 number_blocks, uint16 link_ref, u
 
 static link_t *HLIgetlink(int32 file_id, uint16 ref, int32 number_blocks);
 
+static int32 HLInewblock(filerec_t *file_rec, int32 file_id, linkinfo_t *info, uint16 ref);
+
 /* the accessing function table for linked blocks */
 funclist_t linked_funcs = {
     HLPstread, HLPstwrite,   HLPseek, HLPinquire, HLPread,
@@ -201,8 +225,8 @@ HLcreate(int32 file_id, uint16 tag, uint16 ref, int32 block_length, int32 number
                                               (block table) */
     atom_t data_id;                        /* dd ID of existing regular element */
     uint16 new_data_tag, new_data_ref = 0; /* Tag/ref of the new data in the file */
-    int32  data_len;                       /* length of the data we are checking */
-    int32  data_off;                       /* offset of the data we are checking */
+    hdf_off_t data_len;                    /* length of the data we are checking */
+    hdf_off_t data_off;                    /* offset of the data we are checking */
     uint16 special_tag;                    /* special version of this tag */
     uint8  local_ptbuf[16];
     int32  ret_value = SUCCEED;
@@ -241,6 +265,12 @@ HLcreate(int32 file_id, uint16 tag, uint16 ref, int32 block_length, int32 number
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
         } /* end if */
 
+        /* the linked block header records the length in 32 bits */
+        if (data_len > INT32_MAX) {
+            HTPendaccess(data_id);
+            HGOTO_ERROR(DFE_RANGE, FAIL);
+        } /* end if */
+
         if (data_off == INVALID_OFFSET ||
             data_len == INVALID_LENGTH) { /* data object which has been created, but has no data */
             /* Delete the old data ID */
@@ -276,11 +306,13 @@ HLcreate(int32 file_id, uint16 tag, uint16 ref, int32 block_length, int32 number
         HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
     info->attached      = 1;
-    info->length        = (data_id != FAIL) ? data_len : 0;
-    info->first_length  = (data_id != FAIL) ? data_len : block_length;
+    info->length        = (data_id != FAIL) ? (int32)data_len : 0;
+    info->first_length  = (data_id != FAIL) ? (int32)data_len : block_length;
     info->block_length  = block_length;
     info->number_blocks = number_blocks;
     info->link_ref      = link_ref;
+    info->run_left      = 0;
+    info->run_blocks    = 0;
 
     /* encode special information for writing to file */
     {
@@ -387,12 +419,12 @@ HLconvert(int32 aid, int32 block_length, int32 number_blocks)
     int32  dd_aid;                                      /* AID for writing the special info */
     uint16 new_data_tag = DFTAG_NULL, new_data_ref = 0; /* Tag/ref of the new data in the file */
     uint16 data_tag, data_ref;                          /* Tag/ref of the data in the file */
-    int32  data_len;                                    /* length of the data we are checking */
-    int32  data_off;                                    /* offset of the data we are checking */
+    hdf_off_t data_len;                                 /* length of the data we are checking */
+    hdf_off_t data_off;                                 /* offset of the data we are checking */
     uint16 special_tag;                                 /* special version of this tag */
     int32  file_id;                                     /* file ID for the access record */
     uint8  local_ptbuf[16];
-    int32  old_posn; /* position in the access element */
+    hdf_off_t old_posn; /* position in the access element */
     int    ret_value = SUCCEED;
 
     /* clear error stack */
@@ -443,6 +475,10 @@ HLconvert(int32 aid, int32 block_length, int32 number_blocks)
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
     } /* end if */
 
+    /* the linked block header records the length in 32 bits */
+    if (data_len > INT32_MAX)
+        HGOTO_ERROR(DFE_RANGE, FAIL);
+
     /* set up new tag/ref for linked block element */
     new_data_tag = DFTAG_LINKED;
     new_data_ref = Htagnewref(file_id, new_data_tag);
@@ -470,11 +506,13 @@ HLconvert(int32 aid, int32 block_length, int32 number_blocks)
     /* fill in special info struct */
     info                = (linkinfo_t *)access_rec->special_info;
     info->attached      = 1;
-    info->length        = data_len;
-    info->first_length  = data_len;
+    info->length        = (int32)data_len;
+    info->first_length  = (int32)data_len;
     info->block_length  = block_length;
     info->number_blocks = number_blocks;
     info->link_ref      = link_ref;
+    info->run_left      = 0;
+    info->run_blocks    = 0;
 
     /* Get ready to fill and write the special info structure  */
 
@@ -511,7 +549,7 @@ HLconvert(int32 aid, int32 block_length, int32 number_blocks)
 
     /* check whether we should seek out to the proper position */
     if (old_posn > 0) {
-        if (Hseek(aid, old_posn, DF_START) == FAIL)
+        if (Hseek64(aid, old_posn, DF_START) == FAIL)
             HGOTO_ERROR(DFE_BADSEEK, FAIL);
     }
 
@@ -675,6 +713,8 @@ HLIstaccess(accrec_t *access_rec, int16 acc_mode)
         INT32DECODE(p, info->number_blocks);
         UINT16DECODE(p, info->link_ref);
     }
+    info->run_left   = 0;
+    info->run_blocks = 0;
 
     /* get the block length and number of blocks */
     access_rec->block_size = info->block_length;
@@ -1017,7 +1057,7 @@ NAME
 USAGE
    int32 HLPseek(access_rec, offset, origin)
    access_t * access_rec;      IN: access record to mess with
-   int32      offset;          IN: seek offset
+   hdf_off_t  offset;          IN: seek offset
    int32      origin;          IN: where we should calc the offset from
 RETURNS
    SUCCEED / FAIL
@@ -1026,7 +1066,7 @@ DESCRIPTION
 
 ---------------------------------------------------------------------------*/
 int32
-HLPseek(accrec_t *access_rec, int32 offset, int origin)
+HLPseek(accrec_t *access_rec, hdf_off_t offset, int origin)
 {
     int32 ret_value = SUCCEED;
 
@@ -1040,7 +1080,8 @@ HLPseek(accrec_t *access_rec, int32 offset, int origin)
         offset += access_rec->posn;
     if (origin == DF_END)
         offset += ((linkinfo_t *)(access_rec->special_info))->length;
-    if (offset < 0)
+    /* the length of a linked block element is stored in 32 bits */
+    if (offset < 0 || offset > INT32_MAX)
         HGOTO_ERROR(DFE_RANGE, FAIL);
 
     /* set position */
@@ -1068,6 +1109,9 @@ DESCRIPTION
    If length would take us off the end of the element only
    read what has been written.
 
+   Blocks which follow each other in the file are read with
+   one read.
+
 --------------------------------------------------------------------------- */
 int32
 HLPread(accrec_t *access_rec, int32 length, void *datap)
@@ -1076,24 +1120,41 @@ HLPread(accrec_t *access_rec, int32 length, void *datap)
     /* information record for this special data elt */
     linkinfo_t *info   = (linkinfo_t *)(access_rec->special_info);
     link_t     *t_link = info->link; /* block table record */
+    filerec_t  *file_rec;            /* file record */
 
     /* relative position in linked block of data elt */
-    int32 relative_posn = access_rec->posn;
+    int32 relative_posn = (int32)access_rec->posn;
+
+    int32         block_idx;         /* block table index of current block */
+    int32         current_length;    /* length of current block */
+    int32         nbytes     = 0;    /* # bytes read on any single Hread() */
+    int32         bytes_read = 0;    /* total # bytes read for this call of HLIread */
+    hdf_extent_t *plan       = NULL; /* pieces of the blocks to read */
+    int           nplan      = 0;    /* # of pieces in plan */
+    int           max_plan   = 0;    /* room in plan */
+    int32         ret_value  = SUCCEED;
 
-    int32 block_idx;      /* block table index of current block */
-    int32 current_length; /* length of current block */
-    int32 nbytes     = 0; /* # bytes read on any single Hread() */
-    int32 bytes_read = 0; /* total # bytes read for this call of HLIread */
-    int32 ret_value  = SUCCEED;
+    /* convert file id to file record */
+    file_rec = HAatom_object(access_rec->file_id);
+    if (BADFREC(file_rec))
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
     /* validate length */
     if (length == 0)
-        length = info->length - access_rec->posn;
+        length = info->length - relative_posn;
     else if (length < 0)
         HGOTO_ERROR(DFE_RANGE, FAIL);
 
     if (access_rec->posn + length > info->length)
-        length = info->length - access_rec->posn;
+        length = info->length - relative_posn;
+    if (length <= 0)
+        HGOTO_DONE(0);
+
+    /* room for a piece of each block the read touches, up to
+       HL_READ_PLAN_MAX; a fuller plan is read before adding to it */
+    max_plan = info->block_length > 0 ? (int)MIN(length / info->block_length + 2, HL_READ_PLAN_MAX) : 2;
+    if (NULL == (plan = (hdf_extent_t *)malloc((size_t)max_plan * sizeof(hdf_extent_t))))
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
     /* search for linked block to start reading from */
     if (relative_posn < info->first_length) { /* first block */
@@ -1129,22 +1190,56 @@ HLPread(accrec_t *access_rec, int32 length, void *datap)
         if (remaining > length)
             remaining = length;
         if (t_link->block_list[block_idx].ref != 0) {
-            int32    access_id;      /* access record id for this block */
             block_t *current_block = /* record on the current block */
                 &(t_link->block_list[block_idx]);
+            atom_t    block_id; /* DD id of the block */
+            hdf_off_t block_off, block_len;
 
-            access_id = Hstartread(access_rec->file_id, DFTAG_LINKED, current_block->ref);
-            if (access_id == (int32)FAIL ||
-                (relative_posn && (int32)FAIL == Hseek(access_id, relative_posn, DF_START)) ||
-                (int32)FAIL == (nbytes = Hread(access_id, remaining, data)))
+            /* HTPselect reads in more of a lazily read DD list if need be */
+            if ((block_id = HTPselect(file_rec, DFTAG_LINKED, current_block->ref)) == FAIL)
                 HGOTO_ERROR(DFE_READERROR, FAIL);
+            if (HTPinquire(block_id, NULL, NULL, &block_off, &block_len) == FAIL) {
+                HTPendaccess(block_id);
+                HGOTO_ERROR(DFE_INTERNAL, FAIL);
+            }
+            if (HTPendaccess(block_id) == FAIL)
+                HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
-            bytes_read += nbytes;
-            Hendaccess(access_id);
+            if (block_off == INVALID_OFFSET || block_len < relative_posn + remaining) {
+                /* the block is shorter than it should be; read what's there */
+                int32 access_id; /* access record id for this block */
+
+                access_id = Hstartread(access_rec->file_id, DFTAG_LINKED, current_block->ref);
+                if (access_id == (int32)FAIL ||
+                    (relative_posn && (int32)FAIL == Hseek(access_id, relative_posn, DF_START)) ||
+                    (int32)FAIL == (nbytes = Hread(access_id, remaining, data)))
+                    HGOTO_ERROR(DFE_READERROR, FAIL);
+
+                bytes_read += nbytes;
+                Hendaccess(access_id);
+            }
+            else if (nplan > 0 &&
+                     plan[nplan - 1].offset + plan[nplan - 1].len == block_off + relative_posn) {
+                /* this block follows the one before it in the file */
+                plan[nplan - 1].len += remaining;
+                bytes_read += remaining;
+            }
+            else {
+                if (nplan == max_plan) {
+                    if (HP_readv(file_rec, plan, nplan) == FAIL)
+                        HGOTO_ERROR(DFE_READERROR, FAIL);
+                    nplan = 0;
+                }
+                plan[nplan].offset = block_off + relative_posn;
+                plan[nplan].len    = remaining;
+                plan[nplan].buf    = data;
+                nplan++;
+                bytes_read += remaining;
+            }
         }
         else { /*if block is missing, fill this part of buffer with zero's */
             memset(data, 0, (size_t)remaining);
-            bytes_read += nbytes;
+            bytes_read += remaining;
         }
 
         /* move variables for the next block */
@@ -1160,10 +1255,14 @@ HLPread(accrec_t *access_rec, int32 length, void *datap)
         current_length = info->block_length;
     } while (length > 0); /* if still some more to read in, repeat */
 
+    if (HP_readv(file_rec, plan, nplan) == FAIL)
+        HGOTO_ERROR(DFE_READERROR, FAIL);
+
     access_rec->posn += bytes_read;
     ret_value = bytes_read;
 
 done:
+    free(plan);
     return ret_value;
 } /* HLPread  */
 
@@ -1196,7 +1295,7 @@ HLPwrite(accrec_t *access_rec, int32 length, const void *datap)
     link_t *t_link = /* ptr to link block table */
         info->link;
     int32 relative_posn = /* relative position in linked block */
-        access_rec->posn;
+        (int32)access_rec->posn;
     int32   block_idx;        /* block table index of current block */
     link_t *prev_link = NULL; /* ptr to block table before current block table.
                                    for groking the offset of
@@ -1211,7 +1310,7 @@ HLPwrite(accrec_t *access_rec, int32 length, const void *datap)
     file_rec = HAatom_object(access_rec->file_id);
 
     /* validate length and file records */
-    if (length <= 0)
+    if (length <= 0 || length > INT32_MAX - relative_posn)
         HGOTO_ERROR(DFE_RANGE, FAIL);
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
@@ -1290,8 +1389,11 @@ HLPwrite(accrec_t *access_rec, int32 length, const void *datap)
             access_id = Hstartwrite(access_rec->file_id, DFTAG_LINKED, current_block->ref, current_length);
         }
         else { /* block is missing, set up a new block */
-            new_ref   = Htagnewref(access_rec->file_id, DFTAG_LINKED);
-            access_id = Hstartwrite(access_rec->file_id, DFTAG_LINKED, new_ref, current_length);
+            new_ref = Htagnewref(access_rec->file_id, DFTAG_LINKED);
+            if (current_length == info->block_length && info->block_length > 0)
+                access_id = HLInewblock(file_rec, access_rec->file_id, info, new_ref);
+            else
+                access_id = Hstartwrite(access_rec->file_id, DFTAG_LINKED, new_ref, current_length);
         }
 
         if (access_id == (int32)FAIL)
@@ -1379,7 +1481,7 @@ HLPwrite(accrec_t *access_rec, int32 length, const void *datap)
         int32  tmp;
         uint8 *p = local_ptbuf;
 
-        tmp = bytes_written + access_rec->posn;
+        tmp = bytes_written + (int32)access_rec->posn;
         if (tmp > info->length)
             info->length = tmp;
         INT32ENCODE(p, info->length);
@@ -1398,6 +1500,67 @@ done:
     return ret_value;
 } /* HLPwrite */
 
+/* ------------------------------ HLInewblock ----------------------------- */
+/*
+NAME
+   HLInewblock -- start writing a new block in the element's run
+USAGE
+   int32 HLInewblock(file_rec, file_id, info, ref)
+   filerec_t  * file_rec;    IN: file record
+   int32        file_id;     IN: file ID
+   linkinfo_t * info;        IN/OUT: information on the element
+   uint16       ref;         IN: ref number for the new block
+RETURNS
+   The AID of the new block or FAIL
+DESCRIPTION
+   Place a new block of block_length bytes in the next unused
+   block of the element's run, reserving a new run at the end
+   of the file when there are none left.  Each run has room for
+   twice as many blocks as the one before it, up to
+   HDF_LINKED_RUN_MAX bytes.
+
+---------------------------------------------------------------------------*/
+static int32
+HLInewblock(filerec_t *file_rec, int32 file_id, linkinfo_t *info, uint16 ref)
+{
+    accrec_t *block_rec; /* access record of the new block */
+    int32     access_id; /* AID of the new block */
+    int32     ret_value = SUCCEED;
+
+    if (info->run_left == 0) {
+        int32     max_blocks = HDF_LINKED_RUN_MAX / info->block_length;
+        int32     nblocks    = info->run_blocks > 0 ? info->run_blocks : 1;
+        hdf_off_t run_off;
+
+        if (info->run_blocks > 0 && nblocks <= max_blocks / 2)
+            nblocks *= 2;
+        else if (nblocks > max_blocks)
+            nblocks = max_blocks > 0 ? max_blocks : 1;
+        if ((run_off = HPgetdiskblock(file_rec, nblocks * info->block_length, FALSE)) == FAIL)
+            HGOTO_ERROR(DFE_SEEKERROR, FAIL);
+        info->run_off    = run_off;
+        info->run_left   = nblocks;
+        info->run_blocks = nblocks;
+    }
+
+    if ((access_id = Hstartaccess(file_id, DFTAG_LINKED, ref, DFACC_RDWR)) == FAIL)
+        HGOTO_ERROR(DFE_BADAID, FAIL);
+    block_rec = HAatom_object(access_id);
+    if (HTPupdate(block_rec->ddid, info->run_off, info->block_length) == FAIL) {
+        Hendaccess(access_id);
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+    }
+    block_rec->new_elem = FALSE;
+
+    info->run_off += info->block_length;
+    info->run_left--;
+
+    ret_value = access_id;
+
+done:
+    return ret_value;
+} /* HLInewblock */
+
 /* ------------------------------ HLInewlink ------------------------------ */
 /*
 NAME
@@ -1492,9 +1655,9 @@ USAGE
    uint16   * file;            OUT: file ID;
    uint16   * tag;             OUT: tag of info record;
    uint16   * ref;             OUT: ref of info record;
-   int32    * len;             OUT: length of element;
-   int32    * off;             OUT: offset of element -- meaningless
-   int32    * pos;             OUT: current position in element;
+   hdf_off_t * len;            OUT: length of element;
+   hdf_off_t * off;            OUT: offset of element -- meaningless
+   hdf_off_t * pos;            OUT: current position in element;
    int16    * acc;             OUT: access mode;
    int16    * sp;              OUT: special code;
 RETURNS
@@ -1506,8 +1669,8 @@ DESCRIPTION
 
 --------------------------------------------------------------------------- */
 int32
-HLPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength, int32 *poffset,
-           int32 *pposn, int16 *paccess, int16 *pspecial)
+HLPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+           hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
 {
     uint16      data_tag, data_ref; /* Tag/ref of the data in the file */
     linkinfo_t *info =              /* special information record */
@@ -1624,8 +1787,16 @@ HLPcloseAID(accrec_t *access_rec)
     /* detach the special information record.
        If no more references to that, free the record */
     if (--(info->attached) == 0) {
-        link_t *t_link; /* current link to free */
-        link_t *next;   /* next link to free */
+        link_t    *t_link;   /* current link to free */
+        link_t    *next;     /* next link to free */
+        filerec_t *file_rec; /* file record */
+
+        file_rec = HAatom_object(access_rec->file_id);
+
+        /* give back the unused end of the run if nothing was put after it */
+        if (info->run_left > 0 && !BADFREC(file_rec) &&
+            info->run_off + (hdf_off_t)info->run_left * info->block_length == file_rec->f_end_off)
+            file_rec->f_end_off = info->run_off;
 
         /* free the linked list of links/block tables */
         for (t_link = info->link; t_link; t_link = next) {
@@ -100,8 +100,8 @@ HBconvert(int32 aid)
     accrec_t  *tmp_access_rec;     /* temp. access record */
     bufinfo_t *info;               /* information for the buffered element */
     uint16     data_tag, data_ref; /* tag/ref of the data we are checking */
-    int32      data_off;           /* offset of the data we are checking */
-    int32      data_len;           /* length of the data we are checking */
+    hdf_off_t  data_off;           /* offset of the data we are checking */
+    hdf_off_t  data_len;           /* length of the data we are checking */
     int        ret_value = SUCCEED;
 
     HEclear();
@@ -130,6 +130,10 @@ HBconvert(int32 aid)
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
     } /* end if */
 
+    /* the whole element has to fit in one memory buffer */
+    if (data_len > INT32_MAX)
+        HGOTO_ERROR(DFE_RANGE, FAIL);
+
     /* allocate special info struct for buffered element */
     if ((info = malloc((uint32)sizeof(bufinfo_t))) == NULL)
         HGOTO_ERROR(DFE_NOSPACE, FAIL);
@@ -137,7 +141,7 @@ HBconvert(int32 aid)
     /* fill in special info struct */
     info->attached = 1;
     info->modified = 0;        /* Data starts out not modified */
-    info->length   = data_len; /* initial buffer size */
+    info->length   = (int32)data_len; /* initial buffer size */
 
     /* Get space for buffer */
     if (data_len > 0) {
@@ -151,7 +155,7 @@ HBconvert(int32 aid)
     if (data_len > 0) {
         if (Hseek(aid, 0, DF_START) == FAIL)
             HGOTO_ERROR(DFE_SEEKERROR, FAIL);
-        if (Hread(aid, data_len, info->buf) == FAIL)
+        if (Hread(aid, (int32)data_len, info->buf) == FAIL)
             HGOTO_ERROR(DFE_READERROR, FAIL);
     } /* end if */
 
@@ -240,7 +244,7 @@ NAME
 USAGE
    int32 HXPseek(access_rec, offset, origin)
        access_t * access_rec;      IN: access record to mess with
-       int32      offset;          IN: seek offset
+       hdf_off_t  offset;          IN: seek offset
        int32      origin;          IN: where we should calc the offset from
 RETURNS
    SUCCEED / FAIL
@@ -249,7 +253,7 @@ DESCRIPTION
 
 ---------------------------------------------------------------------------*/
 int32
-HBPseek(accrec_t *access_rec, int32 offset, int origin)
+HBPseek(accrec_t *access_rec, hdf_off_t offset, int origin)
 {
     int32 ret_value = SUCCEED;
 
@@ -258,7 +262,8 @@ HBPseek(accrec_t *access_rec, int32 offset, int origin)
         offset += access_rec->posn;
     if (origin == DF_END)
         offset += ((bufinfo_t *)(access_rec->special_info))->length;
-    if (offset < 0)
+    /* the buffer can't grow past 2 GiB */
+    if (offset < 0 || offset > INT32_MAX)
         HGOTO_ERROR(DFE_RANGE, FAIL);
 
     /* set the offset */
@@ -298,7 +303,7 @@ HBPread(accrec_t *access_rec, int32 length, void *data)
 
     /* adjust length if it falls off the end of the element */
     if ((length == 0) || (access_rec->posn + length > info->length))
-        length = info->length - access_rec->posn;
+        length = info->length - (int32)access_rec->posn;
     else if (length < 0)
         HGOTO_ERROR(DFE_RANGE, FAIL);
 
@@ -338,13 +343,13 @@ HBPwrite(accrec_t *access_rec, int32 length, const void *data)
     int32 ret_value = SUCCEED;
 
     /* validate length */
-    if (length < 0)
+    if (length < 0 || length > INT32_MAX - access_rec->posn)
         HGOTO_ERROR(DFE_RANGE, FAIL);
 
     /* Check if the data to write will overrun the buffer and realloc it if so */
     if (access_rec->posn + length > info->length) {
         /* Calc. the new size of the object */
-        new_len = access_rec->posn + length;
+        new_len = (int32)access_rec->posn + length;
 
         /* Resize buffer in safe manner */
         /* Realloc should handle this, but the Sun is whining about it... -QAK */
@@ -390,9 +395,9 @@ USAGE
    uint16   * file;            OUT: file ID;
    uint16   * tag;             OUT: tag of info record;
    uint16   * ref;             OUT: ref of info record;
-   int32    * len;             OUT: length of element;
-   int32    * off;             OUT: offset of element (NOT correct);
-   int32    * pos;             OUT: current position in element;
+   hdf_off_t * len;            OUT: length of element;
+   hdf_off_t * off;            OUT: offset of element (NOT correct);
+   hdf_off_t * pos;            OUT: current position in element;
    int16    * acc;             OUT: access mode;
    int16    * sp;              OUT: special code;
 RETURNS
@@ -404,14 +409,14 @@ DESCRIPTION
 
 ---------------------------------------------------------------------------*/
 int32
-HBPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength, int32 *poffset,
-           int32 *pposn, int16 *paccess, int16 *pspecial)
+HBPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+           hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
 {
     bufinfo_t *info = /* special information record */
         (bufinfo_t *)access_rec->special_info;
-    uint16 data_tag, data_ref; /* tag/ref of the data we are checking */
-    int32  data_off;           /* offset of the data we are checking */
-    int32  ret_value = SUCCEED;
+    uint16    data_tag, data_ref; /* tag/ref of the data we are checking */
+    hdf_off_t data_off;           /* offset of the data we are checking */
+    int32     ret_value = SUCCEED;
 
     /* Get the data's offset & length */
     if (HTPinquire(info->buf_access_rec->ddid, &data_tag, &data_ref, &data_off, NULL) == FAIL)
@@ -199,6 +199,12 @@ EXPORTED ROUTINES
    HMCwriteChunk   -- write out the specified chunk to a chunked element
    HMCreadChunk    -- read the specified chunk from a chunked element
    HMCsetMaxcache  -- maximum number of chunks to cache
+   HMCsetCacheparams -- byte bound and replacement policy of the chunk cache
+   HMCgetCachestats -- statistics of the chunk cache
+   Hsetchunkcachebudget -- bytes all chunk caches may hold together
+   Hgetchunkcachebudget -- get the budget and the bytes held by all chunk caches
+   Hsetchunkthreads -- threads decoding the chunks a read needs
+   Hgetchunkthreads -- get the threads decoding the chunks a read needs
    HMCPcloseAID    -- close file but keep AID active (For Hnextread())
 
    Library Private
@@ -241,6 +247,8 @@ LOCAL ROUTINES
    Common Routine
    -------------
    HMCIstaccess -- set up AID to access a chunked element
+   HMCIdecode_chunks -- decode the chunks a read needs next on worker threads
+   HMCIread_chunks -- read the chunks a read needs next all at once
 
    AUTHOR
    -------
@@ -261,6 +269,7 @@ LOCAL ROUTINES
 #include "tbbt_priv.h"
 #include "mcache_priv.h"
 #include "hcomp.h"
+#include "cdeflate_priv.h"
 
 /* Define class, class version and name(partial) for chunk table i.e. Vdata */
 #define _HDF_CHK_TBL_NAME "_HDF_CHK_TBL_" /* 13 bytes */
@@ -274,6 +283,9 @@ LOCAL ROUTINES
 /* Define version number for chunked header format */
 #define _HDF_CHK_HDR_VER 0 /* zero version for format header */
 
+/* Fewest uncompressed chunks HMCIread_chunks() reads ahead at once */
+#define CHUNK_READ_AHEAD 8
+
 /* Structure for each Data array dimension */
 typedef struct dim_rec_struct {
     /* fields stored in chunked header */
@@ -302,8 +314,19 @@ typedef struct chunk_rec_struct {
     int32 *origin;  /* origin -> position of chunk */
     uint16 chk_tag; /* DFTAG_CHUNK or another Chunked element? */
     uint16 chk_ref; /* reference number of this chunk */
+
+    uint8 *decoded; /* chunk decoded ahead by HMCIdecode_chunks(), or NULL */
 } CHUNK_REC, *CHUNK_REC_PTR;
 
+/* A chunk HMCIdecode_chunks() decodes on a worker thread */
+typedef struct chunk_decode_struct {
+    CHUNK_REC *chk_rec;  /* the chunk */
+    void      *raw;      /* its compressed data */
+    int32      raw_len;  /* # of bytes of compressed data */
+    int32      data_len; /* # of bytes to decode into chk_rec->decoded */
+    int32      status;   /* # of bytes decoded or FAIL */
+} CHUNK_DECODE;
+
 /* information on this special chunk data elt */
 typedef struct chunkinfo_t {
     int   attached; /* how many access records refer to this elt */
@@ -348,6 +371,21 @@ typedef struct chunkinfo_t {
 /* private functions */
 static int32 HMCIstaccess(accrec_t *access_rec, /* IN: access record to fill in */
                           int16     acc_mode /* IN: access mode */);
+static int32 HMCIdecode_chunks(accrec_t     *access_rec, /* IN: access record being read */
+                               CHUNK_DECODE *batch,      /* IN/OUT: chunks decoded ahead */
+                               int32        *nbatch,     /* IN/OUT: # of chunks in batch */
+                               int32         maxbatch,   /* IN: most chunks to decode ahead */
+                               int           nthreads,   /* IN: # of threads to decode on */
+                               int32         posn,       /* IN: seek position of the read */
+                               int32         nbytes /* IN: # of bytes left to read */);
+static int32 HMCIread_chunks(accrec_t     *access_rec, /* IN: access record being read */
+                             CHUNK_DECODE *batch,      /* IN/OUT: chunks read ahead */
+                             int32        *nbatch,     /* IN/OUT: # of chunks in batch */
+                             int32         maxbatch,   /* IN: most chunks to read ahead */
+                             int32         posn,       /* IN: seek position of the read */
+                             int32         nbytes /* IN: # of bytes left to read */);
+static void  HMCIfree_decoded(CHUNK_DECODE *batch, /* IN: chunks decoded ahead */
+                              int32         nbatch /* IN: # of chunks in batch */);
 /* tbbt_priv.h helper routines */
 static int  chkcompare(void *k1, /* IN: first key */
                        void *k2, /* IN: second key */
@@ -360,7 +398,7 @@ static int32 HMCPstread(accrec_t *access_rec /* IN: access record to fill in */)
 static int32 HMCPstwrite(accrec_t *access_rec /* IN: access record to fill in */);
 
 static int32 HMCPseek(accrec_t *access_rec, /* IN: access record to mess with */
-                      int32     offset,     /* IN: seek offset */
+                      hdf_off_t offset,     /* IN: seek offset */
                       int       origin /* IN: where we should calc the offset from */);
 
 static int32 HMCPchunkread(void *cookie,    /* IN: access record to mess with */
@@ -388,9 +426,9 @@ static int32 HMCPinquire(accrec_t *access_rec, /* IN:  access record to return i
                          int32    *pfile_id,   /* OUT: file ID; */
                          uint16   *ptag,       /* OUT: tag of info record; */
                          uint16   *pref,       /* OUT: ref of info record; */
-                         int32    *plength,    /* OUT: length of element; */
-                         int32    *poffset,    /* OUT: offset of element -- meaningless */
-                         int32    *pposn,      /* OUT: current position in element; */
+                         hdf_off_t *plength,   /* OUT: length of element; */
+                         hdf_off_t *poffset,   /* OUT: offset of element -- meaningless */
+                         hdf_off_t *pposn,     /* OUT: current position in element; */
                          int16    *paccess,    /* OUT: access mode; */
                          int16    *pspecial /* OUT: special code; */);
 
@@ -400,6 +438,10 @@ funclist_t chunked_funcs = {
     HMCPwrite,  HMCPendaccess, HMCPinfo, NULL /* no routine registered */
 };
 
+/* # of threads decoding the chunks a read needs, 0 to decode them one at a
+   time as they're read (see Hsetchunkthreads()) */
+static int chunk_nthreads = 0;
+
 /* -------------------------------------------------------------------------
 NAME
     create_dim_recs -- create the appropriate arrays in memory
@@ -1155,7 +1197,7 @@ HMCIstaccess(accrec_t *access_rec, /* IN: access record to fill in */
                 pntr = v_data; /* set pointer to vdata record */
 
                 /* Allocate space for a chunk record */
-                if ((chkptr = (CHUNK_REC *)malloc(sizeof(CHUNK_REC))) == NULL)
+                if ((chkptr = (CHUNK_REC *)calloc(1, sizeof(CHUNK_REC))) == NULL)
                     HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
                 /* Allocate space for a origin in chunk record */
@@ -2416,6 +2458,7 @@ HMCsetMaxcache(int32 access_id, /* IN: access aid to mess with */
 {
     accrec_t    *access_rec = NULL; /* access record */
     chunkinfo_t *info       = NULL; /* chunked element information record */
+    filerec_t   *locked_rec = NULL; /* file record locked here */
     int32        ret_value  = SUCCEED;
 
     (void)flags;
@@ -2425,6 +2468,8 @@ HMCsetMaxcache(int32 access_id, /* IN: access aid to mess with */
     if (access_rec == NULL || maxcache < 1)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(access_rec->file_id);
+
     /* since this routine can be called by the user,
        need to check if this access id is special CHUNKED */
     if (access_rec->special == SPECIAL_CHUNKED) {
@@ -2439,9 +2484,247 @@ HMCsetMaxcache(int32 access_id, /* IN: access aid to mess with */
         ret_value = FAIL;
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* HMCsetMaxcache() */
 
+/*--------------------------------------------------------------------------
+NAME
+     HMCsetCacheparams - byte bound and replacement policy of the chunk cache
+
+DESCRIPTION
+     Bounds the chunk cache of the current object to 'maxbytes' bytes of
+     chunks and sets how chunks are chosen to leave the cache when it is
+     full.  A 'maxbytes' of 0 leaves the cache bounded by the number of
+     chunks set with HMCsetMaxcache().  Unlike HMCsetMaxcache(), a smaller
+     bound shrinks the cache, writing out the chunks which are dropped.
+
+     'policy' is one of HDF_CACHE_LRU (least recently used chunk first),
+     HDF_CACHE_ARC (adaptive replacement, resists large scans flushing
+     chunks which are reused) or HDF_CACHE_W0 (chunks which have been
+     fully read or written first, then least recently used).
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+
+NOTE
+     This calls the real routines mcache_set_maxbytes() and
+     mcache_set_policy().
+
+-------------------------------------------------------------------------- */
+int
+HMCsetCacheparams(int32 access_id, /* IN: access aid to mess with */
+                  int32 maxbytes,  /* IN: max bytes of chunks to cache, or 0 */
+                  int32 policy /* IN: HDF_CACHE_LRU, HDF_CACHE_ARC or HDF_CACHE_W0 */)
+{
+    accrec_t    *access_rec = NULL; /* access record */
+    chunkinfo_t *info       = NULL; /* chunked element information record */
+    filerec_t   *locked_rec = NULL; /* file record locked here */
+    int          ret_value  = SUCCEED;
+
+    /* Check args */
+    access_rec = HAatom_object(access_id);
+    if (access_rec == NULL || maxbytes < 0)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    if (policy != HDF_CACHE_LRU && policy != HDF_CACHE_ARC && policy != HDF_CACHE_W0)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    locked_rec = HPlock_file(access_rec->file_id);
+
+    /* since this routine can be called by the user,
+       need to check if this access id is special CHUNKED */
+    if (access_rec->special != SPECIAL_CHUNKED)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    info = (chunkinfo_t *)(access_rec->special_info);
+    if (info == NULL)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+    if (mcache_set_policy(info->chk_cache, (int)policy) == RET_ERROR)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+    if (mcache_set_maxbytes(info->chk_cache, maxbytes) == FAIL)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+done:
+    HPunlock_file(locked_rec);
+    return ret_value;
+} /* HMCsetCacheparams() */
+
+/*--------------------------------------------------------------------------
+NAME
+     HMCgetCachestats - statistics of the chunk cache
+
+DESCRIPTION
+     Fills in 'stats' with the number of chunks the chunk cache of the
+     current object found in the cache, read in or created, dropped to
+     make room, and had taken by other chunk caches to keep within the
+     budget set with Hsetchunkcachebudget().
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+
+-------------------------------------------------------------------------- */
+int
+HMCgetCachestats(int32            access_id, /* IN: access aid to mess with */
+                 HDF_CACHE_STATS *stats /* OUT: statistics of the chunk cache */)
+{
+    accrec_t    *access_rec = NULL; /* access record */
+    chunkinfo_t *info       = NULL; /* chunked element information record */
+    filerec_t   *locked_rec = NULL; /* file record locked here */
+    int          ret_value  = SUCCEED;
+
+    /* Check args */
+    access_rec = HAatom_object(access_id);
+    if (access_rec == NULL || stats == NULL)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    locked_rec = HPlock_file(access_rec->file_id);
+
+    /* since this routine can be called by the user,
+       need to check if this access id is special CHUNKED */
+    if (access_rec->special != SPECIAL_CHUNKED)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    info = (chunkinfo_t *)(access_rec->special_info);
+    if (info == NULL)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+    if (mcache_get_stats(info->chk_cache, stats) == RET_ERROR)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+done:
+    HPunlock_file(locked_rec);
+    return ret_value;
+} /* HMCgetCachestats() */
+
+/*--------------------------------------------------------------------------
+NAME
+     Hsetchunkcachebudget - bytes all chunk caches may hold together
+
+DESCRIPTION
+     Sets a budget of bytes of chunks shared by the chunk caches of all
+     chunked elements in all open files.  While the caches hold less, each
+     cache is only bounded by its own settings (HMCsetMaxcache() and
+     HMCsetCacheparams()).  Once they reach the budget, a cache holding
+     more than its fair share, the budget divided evenly among the caches
+     holding chunks, replaces its own chunks, and the other caches take
+     chunks which need not be written out from the caches most over their
+     share.  Chunks waiting to be written are only written out by their own
+     cache, so the caches may go over the budget for a while.
+
+     A budget of 0, the default, lifts the bound.
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+
+-------------------------------------------------------------------------- */
+int
+Hsetchunkcachebudget(hdf_off_t nbytes /* IN: bytes of chunks to cache, or 0 */)
+{
+    int ret_value = SUCCEED;
+
+    HEclear();
+
+    if (nbytes < 0)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    if (mcache_set_budget(nbytes) == RET_ERROR)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+done:
+    return ret_value;
+} /* Hsetchunkcachebudget() */
+
+/*--------------------------------------------------------------------------
+NAME
+     Hgetchunkcachebudget - get the budget and the bytes held by all chunk caches
+
+DESCRIPTION
+     Either pointer may be NULL.
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+
+-------------------------------------------------------------------------- */
+int
+Hgetchunkcachebudget(hdf_off_t *nbytes, /* OUT: budget set by Hsetchunkcachebudget() */
+                     hdf_off_t *nused /* OUT: bytes of chunks cached now */)
+{
+    int ret_value = SUCCEED;
+
+    HEclear();
+
+    if (mcache_get_budget(nbytes, nused) == RET_ERROR)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+done:
+    return ret_value;
+} /* Hgetchunkcachebudget() */
+
+/*--------------------------------------------------------------------------
+NAME
+     Hsetchunkthreads - threads decoding the chunks a read needs
+
+DESCRIPTION
+     When nthreads is more than 0, a read from a chunked element whose
+     chunks are compressed with deflate first reads the compressed data of
+     the chunks it needs which aren't cached, then decodes them on up to
+     nthreads threads at once, before copying the data out of the chunks.
+     At most the larger of the element's chunk cache size and twice
+     nthreads chunks are decoded ahead at a time, in memory apart from the
+     chunk cache.  The calling thread is one of the threads; the others
+     are started the first time they're needed.
+
+     0, the default, decodes each chunk as the read reaches it.  When the
+     library isn't built thread-safe the chunks are decoded ahead on the
+     calling thread only.
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+
+--------------------------------------------------------------------------- */
+int
+Hsetchunkthreads(int nthreads /* IN: # of threads, or 0 */)
+{
+    int ret_value = SUCCEED;
+
+    HEclear();
+
+    if (nthreads < 0)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    HTS_REGISTRY_LOCK();
+    chunk_nthreads = nthreads;
+    HTS_REGISTRY_UNLOCK();
+
+done:
+    return ret_value;
+} /* Hsetchunkthreads() */
+
+/*--------------------------------------------------------------------------
+NAME
+     Hgetchunkthreads - get the threads decoding the chunks a read needs
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+
+--------------------------------------------------------------------------- */
+int
+Hgetchunkthreads(int *nthreads /* OUT: # of threads set by Hsetchunkthreads() */)
+{
+    int ret_value = SUCCEED;
+
+    HEclear();
+
+    if (nthreads == NULL)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    HTS_REGISTRY_LOCK();
+    *nthreads = chunk_nthreads;
+    HTS_REGISTRY_UNLOCK();
+
+done:
+    return ret_value;
+} /* Hgetchunkthreads() */
+
 /* ------------------------------ HMCPstread -------------------------------
 NAME
    HMCPstread -- open an access record of chunked element for reading
@@ -2502,7 +2785,7 @@ AUTHOR
 ---------------------------------------------------------------------------*/
 static int32
 HMCPseek(accrec_t *access_rec, /* IN: access record to mess with */
-         int32     offset,     /* IN: seek offset */
+         hdf_off_t offset,     /* IN: seek offset */
          int       origin /* IN: where we should calc the offset from */)
 {
     chunkinfo_t *info      = NULL; /* information for the chunked elt */
@@ -2525,13 +2808,14 @@ HMCPseek(accrec_t *access_rec, /* IN: access record to mess with */
         offset += access_rec->posn;
     if (origin == DF_END)
         offset += (info->length * info->nt_size); /* adjust by number type size */
-    if (offset < 0)
+    /* chunk positions are computed in 32 bits */
+    if (offset < 0 || offset > INT32_MAX)
         HGOTO_ERROR(DFE_RANGE, FAIL);
 
     /* Seek to given location(bytes) for reading/writing */
     /* i.e calculate chunk indices given seek location
        this will update the proper arrays in the special info struct */
-    update_chunk_indices_seek(offset, info->ndims, info->nt_size, info->seek_chunk_indices,
+    update_chunk_indices_seek((int32)offset, info->ndims, info->nt_size, info->seek_chunk_indices,
                               info->seek_pos_chunk, info->ddims);
 
     /* set position in access record */
@@ -2597,8 +2881,12 @@ HMCPchunkread(void *cookie,    /* IN: access record to mess with */
         chk_rec = (CHUNK_REC *)entry->data;
 
         /* check to see if has been written to */
-        if (chk_rec->chk_tag != DFTAG_NULL &&
-            BASETAG(chk_rec->chk_tag) == DFTAG_CHUNK) { /* valid chunk in file */
+        if (chk_rec->decoded != NULL) { /* decoded ahead by HMCIdecode_chunks */
+            memcpy(bptr, chk_rec->decoded, (size_t)read_len);
+            bytes_read = read_len;
+        }
+        else if (chk_rec->chk_tag != DFTAG_NULL &&
+                 BASETAG(chk_rec->chk_tag) == DFTAG_CHUNK) { /* valid chunk in file */
             /* Start read on chunk */
             if ((chk_id = Hstartread(access_rec->file_id, chk_rec->chk_tag, chk_rec->chk_ref)) == FAIL) {
                 Hendaccess(chk_id);
@@ -2675,6 +2963,7 @@ HMCreadChunk(int32  access_id, /* IN: access aid to mess with */
     int32        bytes_read = 0;    /* total #bytes read  */
     int32        read_len   = 0;    /* bytes to read next */
     int32        chunk_num  = -1;   /* chunk number */
+    filerec_t   *locked_rec = NULL; /* file record locked here */
     int32        ret_value  = SUCCEED;
     int          i;
 
@@ -2683,6 +2972,8 @@ HMCreadChunk(int32  access_id, /* IN: access aid to mess with */
     if (access_rec == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(access_rec->file_id);
+
     if (origin == NULL || datap == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
@@ -2700,7 +2991,7 @@ HMCreadChunk(int32  access_id, /* IN: access aid to mess with */
     if (access_rec->special == SPECIAL_CHUNKED) {
         /* Set inputs */
         info          = (chunkinfo_t *)(access_rec->special_info);
-        relative_posn = access_rec->posn;
+        relative_posn = (int32)access_rec->posn;
         read_len      = (info->chunk_size * info->nt_size);
         bytes_read    = 0;
         bptr          = datap;
@@ -2726,6 +3017,7 @@ HMCreadChunk(int32  access_id, /* IN: access aid to mess with */
 
         /* copy data from chunk to users buffer */
         memcpy(bptr, chk_dptr, (size_t)read_len);
+        mcache_used(info->chk_cache, chk_data, read_len);
 
         /* put chunk back to cache and mark it as *not* DIRTY */
         if (mcache_put(info->chk_cache, /* cache handle */
@@ -2756,9 +3048,263 @@ HMCreadChunk(int32  access_id, /* IN: access aid to mess with */
         ret_value = FAIL;
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* HMCreadChunk() */
 
+/* Decodes one chunk of a batch, on a worker thread; see HTSrun_jobs() */
+static void
+HMCIdecode_job(void *data, int job)
+{
+    CHUNK_DECODE *dec = (CHUNK_DECODE *)data + job;
+
+    if (dec->raw != NULL) /* not already read */
+        dec->status = HCPcdeflate_inflate(dec->raw, dec->raw_len, dec->chk_rec->decoded, dec->data_len);
+}
+
+/* ------------------------------ HMCIfree_decoded ------------------------------
+NAME
+   HMCIfree_decoded - free the chunks decoded ahead of a read
+
+DESCRIPTION
+   Frees the chunks of a batch decoded by HMCIdecode_chunks() and empties
+   the batch.
+
+RETURNS
+   Nothing
+--------------------------------------------------------------------------- */
+static void
+HMCIfree_decoded(CHUNK_DECODE *batch, /* IN: chunks decoded ahead */
+                 int32         nbatch /* IN: # of chunks in batch */)
+{
+    for (int32 i = 0; i < nbatch; i++) {
+        free(batch[i].raw);
+        free(batch[i].chk_rec->decoded);
+        batch[i].raw              = NULL;
+        batch[i].chk_rec->decoded = NULL;
+    }
+} /* HMCIfree_decoded() */
+
+/* ------------------------------ HMCIdecode_chunks -----------------------------
+NAME
+   HMCIdecode_chunks - decode the chunks a read needs next on worker threads
+
+DESCRIPTION
+   Replaces the chunks in 'batch' with the chunks the rest of the read,
+   'nbytes' bytes from seek position 'posn', needs next which are written
+   in the file but not cached, up to 'maxbatch' of them.  Their compressed
+   data is read first, then the chunks are decoded on 'nthreads' threads
+   at once.  Chunks which aren't compressed with deflate are read as the
+   cache would read them.  HMCPchunkread() copies a chunk decoded ahead
+   into the cache instead of reading it again.
+
+RETURNS
+   SUCCEED or FAIL
+--------------------------------------------------------------------------- */
+static int32
+HMCIdecode_chunks(accrec_t     *access_rec, /* IN: access record being read */
+                  CHUNK_DECODE *batch,      /* IN/OUT: chunks decoded ahead */
+                  int32        *nbatch,     /* IN/OUT: # of chunks in batch */
+                  int32         maxbatch,   /* IN: most chunks to decode ahead */
+                  int           nthreads,   /* IN: # of threads to decode on */
+                  int32         posn,       /* IN: seek position of the read */
+                  int32         nbytes /* IN: # of bytes left to read */)
+{
+    chunkinfo_t  *info       = (chunkinfo_t *)(access_rec->special_info);
+    CHUNK_REC    *chk_rec    = NULL;           /* chunk record */
+    TBBT_NODE    *entry      = NULL;           /* chunk node from TBBT */
+    CHUNK_DECODE *dec        = NULL;           /* chunk being added to the batch */
+    uint8        *buf        = NULL;           /* chunk being added, once decoded */
+    int32        *sbi        = NULL;           /* chunk indices of the scan */
+    int32        *spb        = NULL;           /* position within the chunk of the scan */
+    int32         read_len   = 0;              /* bytes of a whole chunk */
+    int32         scanned    = 0;              /* bytes of the read scanned */
+    int32         chunk_num  = 0;              /* chunk the scan is in */
+    int32         last_num   = -1;             /* chunk the scan was in before */
+    int32         chunk_size = 0;              /* bytes of the read in this chunk */
+    comp_coder_t  coder_type = COMP_CODE_NONE; /* coder of a chunk */
+    int32         orig_size  = 0;              /* size of a chunk once decoded */
+    int32         ret_value  = SUCCEED;
+
+    /* let the chunks of the last batch go */
+    HMCIfree_decoded(batch, *nbatch);
+    *nbatch = 0;
+
+    read_len = info->chunk_size * info->nt_size;
+    if ((sbi = (int32 *)malloc((size_t)(2 * info->ndims) * sizeof(int32))) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    spb = sbi + info->ndims;
+
+    /* walk the rest of the read the way HMCPread will, collecting the
+       chunks it will have to read from the file */
+    update_chunk_indices_seek(posn, info->ndims, info->nt_size, sbi, spb, info->ddims);
+    while (scanned < nbytes && *nbatch < maxbatch) {
+        calculate_chunk_num(&chunk_num, info->ndims, sbi, info->ddims);
+        calculate_chunk_for_chunk(&chunk_size, info->ndims, info->nt_size, nbytes, scanned, sbi, spb,
+                                  info->ddims);
+
+        if (chunk_num != last_num && !mcache_cached(info->chk_cache, chunk_num + 1) &&
+            (entry = tbbtdfind(info->chk_tree, &chunk_num, NULL)) != NULL) {
+            chk_rec = (CHUNK_REC *)entry->data;
+            if (chk_rec->decoded == NULL && BASETAG(chk_rec->chk_tag) == DFTAG_CHUNK) {
+                dec = &batch[*nbatch];
+                if ((buf = (uint8 *)malloc((size_t)read_len)) == NULL)
+                    HGOTO_ERROR(DFE_NOSPACE, FAIL);
+                if ((dec->raw_len = HCPgetrawdata(access_rec->file_id, chk_rec->chk_tag, chk_rec->chk_ref,
+                                                  &coder_type, &orig_size, &dec->raw)) == FAIL)
+                    HGOTO_ERROR(DFE_READERROR, FAIL);
+
+                if (coder_type != COMP_CODE_DEFLATE || dec->raw == NULL) {
+                    /* read it now, on this thread */
+                    free(dec->raw);
+                    dec->raw = NULL;
+                    if (HMCPchunkread(access_rec, chunk_num, buf) == FAIL)
+                        HGOTO_ERROR(DFE_READERROR, FAIL);
+                }
+                dec->chk_rec     = chk_rec;
+                dec->data_len    = MIN(orig_size, read_len);
+                dec->status      = SUCCEED;
+                chk_rec->decoded = buf;
+                buf              = NULL;
+                (*nbatch)++;
+            }
+        }
+        last_num = chunk_num;
+
+        scanned += chunk_size;
+        update_chunk_indices_seek(posn + scanned, info->ndims, info->nt_size, sbi, spb, info->ddims);
+    }
+
+    /* decode the chunks all at once */
+    HTSrun_jobs(nthreads, (int)*nbatch, HMCIdecode_job, batch);
+    for (int32 i = 0; i < *nbatch; i++) {
+        free(batch[i].raw);
+        batch[i].raw = NULL;
+        if (batch[i].status == FAIL)
+            ret_value = FAIL;
+    }
+    if (ret_value == FAIL)
+        HGOTO_ERROR(DFE_READCOMP, FAIL);
+
+done:
+    free(buf);
+    free(sbi);
+    return ret_value;
+} /* HMCIdecode_chunks() */
+
+/* ------------------------------ HMCIread_chunks -------------------------------
+NAME
+   HMCIread_chunks - read the chunks a read needs next all at once
+
+DESCRIPTION
+   Replaces the chunks in 'batch' with the chunks the rest of the read,
+   'nbytes' bytes from seek position 'posn', needs next which are written
+   in the file, uncompressed, but not cached, up to 'maxbatch' of them.
+   Where each chunk is in the file is collected first, then they're all
+   read with HP_readv(), which reads chunks which are next to each other
+   in the file with one system call.  HMCPchunkread() copies a chunk read
+   ahead into the cache instead of reading it again.  Chunks which aren't
+   plain elements as long as a whole chunk are left for the cache to read.
+
+RETURNS
+   SUCCEED or FAIL
+--------------------------------------------------------------------------- */
+static int32
+HMCIread_chunks(accrec_t     *access_rec, /* IN: access record being read */
+                CHUNK_DECODE *batch,      /* IN/OUT: chunks read ahead */
+                int32        *nbatch,     /* IN/OUT: # of chunks in batch */
+                int32         maxbatch,   /* IN: most chunks to read ahead */
+                int32         posn,       /* IN: seek position of the read */
+                int32         nbytes /* IN: # of bytes left to read */)
+{
+    chunkinfo_t  *info       = (chunkinfo_t *)(access_rec->special_info);
+    filerec_t    *file_rec   = NULL; /* file record */
+    CHUNK_REC    *chk_rec    = NULL; /* chunk record */
+    TBBT_NODE    *entry      = NULL; /* chunk node from TBBT */
+    hdf_extent_t *plan       = NULL; /* where the chunks are in the file */
+    int32        *sbi        = NULL; /* chunk indices of the scan */
+    int32        *spb        = NULL; /* position within the chunk of the scan */
+    int32         read_len   = 0;    /* bytes of a whole chunk */
+    int32         scanned    = 0;    /* bytes of the read scanned */
+    int32         chunk_num  = 0;    /* chunk the scan is in */
+    int32         last_num   = -1;   /* chunk the scan was in before */
+    int32         chunk_size = 0;    /* bytes of the read in this chunk */
+    int32         ret_value  = SUCCEED;
+
+    /* let the chunks of the last batch go */
+    HMCIfree_decoded(batch, *nbatch);
+    *nbatch = 0;
+
+    file_rec = HAatom_object(access_rec->file_id);
+    if (BADFREC(file_rec))
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+    read_len = info->chunk_size * info->nt_size;
+    if ((plan = (hdf_extent_t *)malloc((size_t)maxbatch * sizeof(hdf_extent_t))) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    if ((sbi = (int32 *)malloc((size_t)(2 * info->ndims) * sizeof(int32))) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    spb = sbi + info->ndims;
+
+    /* walk the rest of the read the way HMCPread will, collecting the
+       chunks it will have to read from the file */
+    update_chunk_indices_seek(posn, info->ndims, info->nt_size, sbi, spb, info->ddims);
+    while (scanned < nbytes && *nbatch < maxbatch) {
+        calculate_chunk_num(&chunk_num, info->ndims, sbi, info->ddims);
+        calculate_chunk_for_chunk(&chunk_size, info->ndims, info->nt_size, nbytes, scanned, sbi, spb,
+                                  info->ddims);
+
+        if (chunk_num != last_num && !mcache_cached(info->chk_cache, chunk_num + 1) &&
+            (entry = tbbtdfind(info->chk_tree, &chunk_num, NULL)) != NULL) {
+            chk_rec = (CHUNK_REC *)entry->data;
+            if (chk_rec->decoded == NULL && chk_rec->chk_tag == DFTAG_CHUNK) {
+                atom_t    chk_id; /* DD id of the chunk */
+                hdf_off_t chk_off, chk_len;
+                int       special;
+
+                if ((chk_id = HTPselect(file_rec, chk_rec->chk_tag, chk_rec->chk_ref)) == FAIL)
+                    HGOTO_ERROR(DFE_NOMATCH, FAIL);
+                special = HTPis_special(chk_id);
+                if (HTPinquire(chk_id, NULL, NULL, &chk_off, &chk_len) == FAIL) {
+                    HTPendaccess(chk_id);
+                    HGOTO_ERROR(DFE_INTERNAL, FAIL);
+                }
+                if (HTPendaccess(chk_id) == FAIL)
+                    HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+                if (!special && chk_off != INVALID_OFFSET && chk_len >= read_len) {
+                    CHUNK_DECODE *dec = &batch[*nbatch];
+
+                    if ((chk_rec->decoded = (uint8 *)malloc((size_t)read_len)) == NULL)
+                        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+                    dec->chk_rec     = chk_rec;
+                    dec->raw         = NULL;
+                    dec->data_len    = read_len;
+                    dec->status      = SUCCEED;
+
+                    plan[*nbatch].offset = chk_off;
+                    plan[*nbatch].len    = read_len;
+                    plan[*nbatch].buf    = chk_rec->decoded;
+                    (*nbatch)++;
+                }
+            }
+        }
+        last_num = chunk_num;
+
+        scanned += chunk_size;
+        update_chunk_indices_seek(posn + scanned, info->ndims, info->nt_size, sbi, spb, info->ddims);
+    }
+
+    /* read the chunks all at once */
+    if (HP_readv(file_rec, plan, (int)*nbatch) == FAIL)
+        HGOTO_ERROR(DFE_READERROR, FAIL);
+
+done:
+    free(plan);
+    free(sbi);
+    return ret_value;
+} /* HMCIread_chunks() */
+
 /* ------------------------------- HMCPread --------------------------------
 NAME
    HMCPread - read data from a chunked element
@@ -2779,17 +3325,22 @@ HMCPread(accrec_t *access_rec, /* IN: access record to mess with */
          int32     length,     /* IN: number of bytes to read */
          void     *datap /* OUT: buffer for data */)
 {
-    chunkinfo_t *info          = NULL; /* information record for this special data elt */
-    int32        relative_posn = 0;    /* relative position in chunk of data elt */
-    int32        bytes_read    = 0;    /* total # bytes read for this call of HMCIread */
-    uint8       *bptr          = NULL; /* data buffer pointer */
-    int32        read_len      = 0;    /* amount of data to copy */
-    int32        read_seek     = 0;    /* next read seek position */
-    int32        chunk_size    = 0;    /* size of data to read from chunk */
-    int32        chunk_num     = 0;    /* next chunk number */
-    void        *chk_data      = NULL; /* chunk data */
-    uint8       *chk_dptr      = NULL; /* pointer to chunk data */
-    int32        ret_value     = SUCCEED;
+    chunkinfo_t  *info          = NULL; /* information record for this special data elt */
+    int32         relative_posn = 0;    /* relative position in chunk of data elt */
+    int32         bytes_read    = 0;    /* total # bytes read for this call of HMCIread */
+    uint8        *bptr          = NULL; /* data buffer pointer */
+    int32         read_len      = 0;    /* amount of data to copy */
+    int32         read_seek     = 0;    /* next read seek position */
+    int32         chunk_size    = 0;    /* size of data to read from chunk */
+    int32         chunk_num     = 0;    /* next chunk number */
+    void         *chk_data      = NULL; /* chunk data */
+    uint8        *chk_dptr      = NULL; /* pointer to chunk data */
+    TBBT_NODE    *entry         = NULL; /* chunk node from TBBT */
+    CHUNK_DECODE *batch         = NULL; /* chunks decoded ahead */
+    int32         nbatch        = 0;    /* # of chunks in batch */
+    int32         maxbatch      = 0;    /* most chunks to decode ahead */
+    int           nthreads      = 0;    /* # of threads to decode chunks on */
+    int32         ret_value     = SUCCEED;
 
     /* Check args */
     if (access_rec == NULL)
@@ -2797,20 +3348,36 @@ HMCPread(accrec_t *access_rec, /* IN: access record to mess with */
 
     /* set inputs */
     info          = (chunkinfo_t *)(access_rec->special_info);
-    relative_posn = access_rec->posn; /* current seek position in element */
+    relative_posn = (int32)access_rec->posn; /* current seek position in element */
+
+    /* decode the chunks ahead on worker threads? */
+    if (info->comp_type == COMP_CODE_DEFLATE) {
+        HTS_REGISTRY_LOCK();
+        nthreads = chunk_nthreads;
+        HTS_REGISTRY_UNLOCK();
+    }
+    /* or read uncompressed chunks ahead all at once? */
+    if (nthreads > 0)
+        maxbatch = MAX(mcache_get_maxcache(info->chk_cache), 2 * nthreads);
+    else if (info->comp_type == COMP_CODE_NONE)
+        maxbatch = MAX(mcache_get_maxcache(info->chk_cache), CHUNK_READ_AHEAD);
+    if (maxbatch > 0) {
+        if ((batch = (CHUNK_DECODE *)calloc((size_t)maxbatch, sizeof(CHUNK_DECODE))) == NULL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    }
 
     /* validate length and set proper length */
     if (length == 0)
-        length = (info->length * info->nt_size) - access_rec->posn;
+        length = (info->length * info->nt_size) - relative_posn;
     else if (length < 0)
         HGOTO_ERROR(DFE_RANGE, FAIL);
 
     if (access_rec->posn + length > (info->length * info->nt_size))
-        length = (info->length * info->nt_size) - access_rec->posn;
+        length = (info->length * info->nt_size) - relative_posn;
 
     /* should chunk indices be updated with relative_posn?
        or did last operation update it already */
-    update_chunk_indices_seek(access_rec->posn, info->ndims, info->nt_size, info->seek_chunk_indices,
+    update_chunk_indices_seek(relative_posn, info->ndims, info->nt_size, info->seek_chunk_indices,
                               info->seek_pos_chunk, info->ddims);
 
     /* enter translating length to proper filling of buffer from chunks */
@@ -2826,6 +3393,22 @@ HMCPread(accrec_t *access_rec, /* IN: access record to mess with */
         calculate_chunk_for_chunk(&chunk_size, info->ndims, info->nt_size, read_len, bytes_read,
                                   info->seek_chunk_indices, info->seek_pos_chunk, info->ddims);
 
+        /* when the cache will have to read this chunk and it hasn't been
+           decoded or read ahead, get it and the next chunks needed at once */
+        if (batch != NULL && !mcache_cached(info->chk_cache, chunk_num + 1) &&
+            (entry = tbbtdfind(info->chk_tree, &chunk_num, NULL)) != NULL &&
+            ((CHUNK_REC *)entry->data)->decoded == NULL &&
+            BASETAG(((CHUNK_REC *)entry->data)->chk_tag) == DFTAG_CHUNK) {
+            if (nthreads > 0) {
+                if (HMCIdecode_chunks(access_rec, batch, &nbatch, maxbatch, nthreads, relative_posn,
+                                      read_len - bytes_read) == FAIL)
+                    HGOTO_ERROR(DFE_READERROR, FAIL);
+            }
+            else if (HMCIread_chunks(access_rec, batch, &nbatch, maxbatch, relative_posn,
+                                     read_len - bytes_read) == FAIL)
+                HGOTO_ERROR(DFE_READERROR, FAIL);
+        }
+
         /* would be nice to get Chunk record from TBBT based on chunk number
            and then get chunk data base on chunk vdata number but
            currently the chunk calculations return chunk
@@ -2849,6 +3432,7 @@ HMCPread(accrec_t *access_rec, /* IN: access record to mess with */
 
         /* copy data from chunk to users buffer */
         memcpy(bptr, chk_dptr, (size_t)chunk_size);
+        mcache_used(info->chk_cache, chk_data, chunk_size);
 
         /* put chunk back to cache */
         if (mcache_put(info->chk_cache, /* cache handle */
@@ -2878,6 +3462,10 @@ HMCPread(accrec_t *access_rec, /* IN: access record to mess with */
     ret_value = bytes_read;
 
 done:
+    if (batch != NULL) {
+        HMCIfree_decoded(batch, nbatch);
+        free(batch);
+    }
     return ret_value;
 } /* HMCPread  */
 
@@ -3036,18 +3624,19 @@ HMCwriteChunk(int32       access_id, /* IN: access aid to mess with */
               int32      *origin,    /* IN: origin of chunk to write */
               const void *datap /* IN: buffer for data */)
 {
-    accrec_t    *access_rec = NULL;  /* access record */
-    filerec_t   *file_rec   = NULL;  /* file record */
-    chunkinfo_t *info       = NULL;  /* chunked element information record */
-    CHUNK_REC   *chkptr     = NULL;  /* Chunk record to inserted in TBBT  */
-    int32       *chk_key    = NULL;  /* Chunk record key for insertion in TBBT */
-    const void  *bptr       = NULL;  /* data buffer pointer */
-    void        *chk_data   = NULL;  /* chunk data */
-    uint8       *chk_dptr   = NULL;  /* chunk data pointer */
-    int32        relative_posn;      /* relative position in chunked element */
-    int32        bytes_written = 0;  /* total #bytes written by HMCIwrite */
-    int32        write_len     = 0;  /* bytes to write next */
-    int32        chunk_num     = -1; /* chunk number */
+    accrec_t    *access_rec = NULL;    /* access record */
+    filerec_t   *file_rec   = NULL;    /* file record */
+    chunkinfo_t *info       = NULL;    /* chunked element information record */
+    CHUNK_REC   *chkptr     = NULL;    /* Chunk record to inserted in TBBT  */
+    int32       *chk_key    = NULL;    /* Chunk record key for insertion in TBBT */
+    const void  *bptr       = NULL;    /* data buffer pointer */
+    void        *chk_data   = NULL;    /* chunk data */
+    uint8       *chk_dptr   = NULL;    /* chunk data pointer */
+    int32        relative_posn;        /* relative position in chunked element */
+    int32        bytes_written = 0;    /* total #bytes written by HMCIwrite */
+    int32        write_len     = 0;    /* bytes to write next */
+    int32        chunk_num     = -1;   /* chunk number */
+    filerec_t   *locked_rec    = NULL; /* file record locked here */
     int32        ret_value     = SUCCEED;
     int          k; /* loop index */
     int          i;
@@ -3057,6 +3646,8 @@ HMCwriteChunk(int32       access_id, /* IN: access aid to mess with */
     if (access_rec == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(access_rec->file_id);
+
     if (origin == NULL || datap == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
@@ -3074,7 +3665,7 @@ HMCwriteChunk(int32       access_id, /* IN: access aid to mess with */
     if (access_rec->special == SPECIAL_CHUNKED) {
         /* Set inputs */
         info          = (chunkinfo_t *)(access_rec->special_info);
-        relative_posn = access_rec->posn;
+        relative_posn = (int32)access_rec->posn;
         write_len     = (info->chunk_size * info->nt_size);
         bytes_written = 0;
         bptr          = datap;
@@ -3094,7 +3685,7 @@ HMCwriteChunk(int32       access_id, /* IN: access aid to mess with */
 
             /* so create a new chunk record */
             /* Allocate space for a chunk record */
-            if ((chkptr = (CHUNK_REC *)malloc(sizeof(CHUNK_REC))) == NULL)
+            if ((chkptr = (CHUNK_REC *)calloc(1, sizeof(CHUNK_REC))) == NULL)
                 HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
             /* Allocate space for a origin in chunk record */
@@ -3145,6 +3736,7 @@ HMCwriteChunk(int32       access_id, /* IN: access aid to mess with */
 
         /* copy data from users buffer to chunk */
         memcpy(chk_dptr, bptr, (size_t)write_len);
+        mcache_used(info->chk_cache, chk_data, write_len);
 
         /* put chunk back to cache and mark it as DIRTY */
         if (mcache_put(info->chk_cache, /* cache handle */
@@ -3173,6 +3765,7 @@ HMCwriteChunk(int32       access_id, /* IN: access aid to mess with */
         ret_value = FAIL;
 
 done:
+    HPunlock_file(locked_rec);
     if (ret_value == FAIL) { /* Error condition cleanup */
         /* check chunk ptrs */
         if (chkptr != NULL) {
@@ -3230,7 +3823,7 @@ HMCPwrite(accrec_t   *access_rec, /* IN: access record to mess with */
     /* Set inputs */
     file_rec      = HAatom_object(access_rec->file_id);
     info          = (chunkinfo_t *)(access_rec->special_info);
-    relative_posn = access_rec->posn;
+    relative_posn = (int32)access_rec->posn;
     write_len     = length;
 
     /* validate length and file records */
@@ -3241,7 +3834,7 @@ HMCPwrite(accrec_t   *access_rec, /* IN: access record to mess with */
 
     /* should chunk indices be updated with relative_posn?
        or did last operation update it already */
-    update_chunk_indices_seek(access_rec->posn, info->ndims, info->nt_size, info->seek_chunk_indices,
+    update_chunk_indices_seek(relative_posn, info->ndims, info->nt_size, info->seek_chunk_indices,
                               info->seek_pos_chunk, info->ddims);
 
     bytes_written = 0;
@@ -3260,7 +3853,7 @@ HMCPwrite(accrec_t   *access_rec, /* IN: access record to mess with */
 
             /* so create a new chunk record */
             /* Allocate space for a chunk record */
-            if ((chkptr = (CHUNK_REC *)malloc(sizeof(CHUNK_REC))) == NULL)
+            if ((chkptr = (CHUNK_REC *)calloc(1, sizeof(CHUNK_REC))) == NULL)
                 HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
             /* Allocate space for a origin in chunk record */
@@ -3315,6 +3908,7 @@ HMCPwrite(accrec_t   *access_rec, /* IN: access record to mess with */
 
         /* copy data from users buffer to chunk */
         memcpy(chk_dptr, bptr, (size_t)chunk_size);
+        mcache_used(info->chk_cache, chk_data, chunk_size);
 
         /* put chunk back to cache as DIRTY */
         if (mcache_put(info->chk_cache, /* cache handle */
@@ -3569,9 +4163,9 @@ HMCPinquire(accrec_t *access_rec, /* IN:  access record to return info about */
             int32    *pfile_id,   /* OUT: file ID; */
             uint16   *ptag,       /* OUT: tag of info record; */
             uint16   *pref,       /* OUT: ref of info record; */
-            int32    *plength,    /* OUT: length of element; */
-            int32    *poffset,    /* OUT: offset of element -- meaningless */
-            int32    *pposn,      /* OUT: current position in element; */
+            hdf_off_t *plength,   /* OUT: length of element; */
+            hdf_off_t *poffset,   /* OUT: offset of element -- meaningless */
+            hdf_off_t *pposn,     /* OUT: current position in element; */
             int16    *paccess,    /* OUT: access mode; */
             int16    *pspecial /* OUT: special code; */)
 {
@@ -94,6 +94,13 @@ HDFLIBAPI int32 HMCsetMaxcache(int32 access_id, /* IN: access aid to mess with *
                                int32 maxcache,  /* IN: max number of pages to cache */
                                int32 flags /* IN: flags = 0, HMC_PAGEALL */);
 
+HDFLIBAPI int HMCsetCacheparams(int32 access_id, /* IN: access aid to mess with */
+                                 int32 maxbytes,  /* IN: max bytes of chunks to cache, or 0 */
+                                 int32 policy /* IN: HDF_CACHE_LRU, HDF_CACHE_ARC or HDF_CACHE_W0 */);
+
+HDFLIBAPI int HMCgetCachestats(int32            access_id, /* IN: access aid to mess with */
+                               HDF_CACHE_STATS *stats /* OUT: statistics of the chunk cache */);
+
 HDFLIBAPI int32 HMCwriteChunk(int32       access_id, /* IN: access aid to mess with */
                               int32      *origin,    /* IN: origin of chunk to write */
                               const void *datap /* IN: buffer for data */);
@@ -651,7 +651,7 @@ HCcreate(int32 file_id, uint16 tag, uint16 ref, comp_model_t model_type, model_i
     accrec_t   *access_rec = NULL; /* access element record */
     compinfo_t *info       = NULL; /* special element information */
     atom_t      data_id    = FAIL; /* dd ID of existing regular element */
-    int32       data_len;          /* length of the data we are checking */
+    hdf_off_t   data_len;          /* length of the data we are checking */
     uint16      special_tag;       /* special version of tag */
     void       *buf       = NULL;  /* temporary buffer */
     int32       ret_value = SUCCEED;
@@ -686,6 +686,13 @@ HCcreate(int32 file_id, uint16 tag, uint16 ref, comp_model_t model_type, model_i
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
         }
 
+        /* the compression header records the length in 32 bits */
+        if (data_len > INT32_MAX) {
+            if (HTPendaccess(data_id) == FAIL)
+                HGOTO_ERROR(DFE_CANTFLUSH, FAIL);
+            HGOTO_ERROR(DFE_RANGE, FAIL);
+        }
+
         if ((buf = malloc((uint32)data_len)) == NULL)
             HGOTO_ERROR(DFE_NOSPACE, FAIL);
         if (Hgetelement(file_id, tag, ref, buf) == FAIL)
@@ -701,7 +708,7 @@ HCcreate(int32 file_id, uint16 tag, uint16 ref, comp_model_t model_type, model_i
     if (info == NULL)
         HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
-    info->length = (data_id != FAIL) ? data_len : COMP_START_BLOCK;
+    info->length = (data_id != FAIL) ? (int32)data_len : COMP_START_BLOCK;
 
     /* set up compressed special info structure */
     info->attached = 1;
@@ -732,7 +739,7 @@ HCcreate(int32 file_id, uint16 tag, uint16 ref, comp_model_t model_type, model_i
     /* compress the old DD and get rid of it, if there was one */
     if (data_id != FAIL) {
         /* write the data through to the compression layer */
-        if (HCPwrite(access_rec, data_len, buf) == FAIL)
+        if (HCPwrite(access_rec, (int32)data_len, buf) == FAIL)
             HGOTO_ERROR(DFE_MODEL, FAIL);
 
         /* seek back to the beginning of the data through to the compression layer */
@@ -974,7 +981,7 @@ done:
  USAGE
     int32 HCPseek(access_rec,offset,origin)
     accrec_t *access_rec;   IN: the access record of the data element
-    int32 offset;       IN: the offset in bytes from the origin specified
+    hdf_off_t offset;   IN: the offset in bytes from the origin specified
     int origin;        IN: the origin to seek from
  RETURNS
     Returns SUCCEED or FAIL
@@ -982,7 +989,7 @@ done:
     Seek to a position with a compressed data element.
 --------------------------------------------------------------------------*/
 int32
-HCPseek(accrec_t *access_rec, int32 offset, int origin)
+HCPseek(accrec_t *access_rec, hdf_off_t offset, int origin)
 {
     compinfo_t *info; /* information on the special element */
     int32       ret_value;
@@ -992,7 +999,8 @@ HCPseek(accrec_t *access_rec, int32 offset, int origin)
         offset += access_rec->posn;
     if (origin == DF_END)
         offset += ((compinfo_t *)(access_rec->special_info))->length;
-    if (offset < 0)
+    /* the uncompressed length is recorded in 32 bits */
+    if (offset < 0 || offset > INT32_MAX)
         HGOTO_ERROR(DFE_RANGE, FAIL);
 
     info = (compinfo_t *)access_rec->special_info;
@@ -1033,7 +1041,7 @@ HCPread(accrec_t *access_rec, int32 length, void *data)
 
     /* adjust length if it falls off the end of the element */
     if (length == 0)
-        length = info->length - access_rec->posn;
+        length = info->length - (int32)access_rec->posn;
     else if (length < 0 || access_rec->posn + length > info->length)
         HGOTO_ERROR(DFE_RANGE, FAIL);
 
@@ -1075,7 +1083,7 @@ HCPwrite(accrec_t *access_rec, int32 length, const void *data)
     file_rec = HAatom_object(access_rec->file_id);
 
     /* validate length */
-    if (length < 0)
+    if (length < 0 || length > INT32_MAX - access_rec->posn)
         HRETURN_ERROR(DFE_RANGE, FAIL);
 
     info = (compinfo_t *)access_rec->special_info;
@@ -1085,13 +1093,13 @@ HCPwrite(accrec_t *access_rec, int32 length, const void *data)
     /* update access record, and information about special element */
     access_rec->posn += length;
     if (access_rec->posn > info->length) {
-        int32 data_off; /* offset of the data we are checking */
+        hdf_off_t data_off; /* offset of the data we are checking */
 
         /* get the info for the dataset */
         if (HTPinquire(access_rec->ddid, NULL, NULL, &data_off, NULL) == FAIL)
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
-        info->length = access_rec->posn;
+        info->length = (int32)access_rec->posn;
 
         INT32ENCODE(p, info->length);
         if (HPseek(file_rec, data_off + 4) == FAIL)
@@ -1117,9 +1125,9 @@ done:
     int32 *pfile_id;        OUT: ptr to file id
     uint16 *ptag;           OUT: ptr to tag of information
     uint16 *pref;           OUT: ptr to ref of information
-    int32 *plength;         OUT: ptr to length of data element
-    int32 *poffset;         OUT: ptr to offset of data element
-    int32 *pposn;           OUT: ptr to position of access in element
+    hdf_off_t *plength;     OUT: ptr to length of data element
+    hdf_off_t *poffset;     OUT: ptr to offset of data element
+    hdf_off_t *pposn;       OUT: ptr to position of access in element
     int16 *paccess;         OUT: ptr to access mode
     int16 *pspecial;        OUT: ptr to special code
  RETURNS
@@ -1128,13 +1136,13 @@ done:
     Inquire information about the access record and data element.
 --------------------------------------------------------------------------*/
 int32
-HCPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength, int32 *poffset,
-           int32 *pposn, int16 *paccess, int16 *pspecial)
+HCPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+           hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
 {
     compinfo_t *info = /* special information record */
         (compinfo_t *)access_rec->special_info;
-    uint16 data_tag, data_ref; /* tag/ref of the data we are checking */
-    int32  data_off;           /* offset of the data we are checking */
+    uint16    data_tag, data_ref; /* tag/ref of the data we are checking */
+    hdf_off_t data_off;           /* offset of the data we are checking */
 
     /* get the info for the dataset */
     if (HTPinquire(access_rec->ddid, &data_tag, &data_ref, &data_off, NULL) == FAIL)
@@ -1367,13 +1375,14 @@ HCPgetcomptype(int32 file_id, uint16 data_tag, uint16 data_ref, /* IN: tag/ref o
     uint16     ctag, cref;         /* tag/ref for the special info header object */
     int32      data_id  = FAIL;    /* temporary AID for header info */
     int32      temp_aid = FAIL;    /* temporary AID for header info */
-    int32      data_len;           /* offset of the data we are checking */
+    hdf_off_t  data_len;           /* offset of the data we are checking */
     uint8     *p;                  /* pointers to the temporary buffer */
     uint8     *local_ptbuf = NULL; /* temporary buffer */
     uint16     sp_tag;             /* special tag */
     uint16     c_type;             /* compression type */
     filerec_t *file_rec;           /* file record */
-    int        ret_value = SUCCEED;
+    filerec_t *locked_rec = NULL;  /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     /* clear error stack */
     HEclear();
@@ -1383,6 +1392,8 @@ HCPgetcomptype(int32 file_id, uint16 data_tag, uint16 data_ref, /* IN: tag/ref o
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(file_id);
+
     /* get access element from dataset's tag/ref */
     if ((data_id = HTPselect(file_rec, data_tag, data_ref)) != FAIL) {
         /* get the info for the dataset */
@@ -1463,6 +1474,7 @@ done:
     /* release allocated memory */
     free(local_ptbuf);
 
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* HCPgetcomptype */
 
@@ -1500,8 +1512,9 @@ HCPgetdatasize(int32 file_id, uint16 data_tag, uint16 data_ref, /* IN: tag/ref o
     uint16     comp_ref = 0;
     atom_t     data_id  = FAIL; /* dd ID of existing regular element */
     int32      len      = 0;
-    filerec_t *file_rec; /* file record */
-    int        ret_value = SUCCEED;
+    filerec_t *file_rec;          /* file record */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     /* clear error stack */
     HEclear();
@@ -1511,6 +1524,8 @@ HCPgetdatasize(int32 file_id, uint16 data_tag, uint16 data_ref, /* IN: tag/ref o
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(file_id);
+
     /* get access element from dataset's tag/ref */
     if ((data_id = HTPselect(file_rec, data_tag, data_ref)) != FAIL) {
         /* if the element is not special, that means dataset's tag/ref
@@ -1583,5 +1598,112 @@ HCPgetdatasize(int32 file_id, uint16 data_tag, uint16 data_ref, /* IN: tag/ref o
 done:
     free(local_ptbuf);
 
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* HCPgetdatasize */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HCPgetrawdata -- Read the compressed data of an element without
+                     decoding it
+ USAGE
+    int32 HCPgetrawdata(file_id, data_tag, data_ref, coder_type, orig_size, data)
+        int32 file_id;          IN: file id
+        uint16 data_tag;        IN: tag of the element
+        uint16 data_ref;        IN: ref of element
+        comp_coder_t *coder_type; OUT: type of encoding of the data
+        int32 *orig_size;       OUT: size of the data once decoded
+        void **data;            OUT: the compressed data
+ RETURNS
+    The # of bytes of compressed data, or FAIL
+ DESCRIPTION
+    Reads the element's special header for the coder and the ref# of the
+    compressed data, then reads all of the compressed data into a buffer
+    which the caller frees.  When the element isn't compressed, or no data
+    has been written to it, *coder_type is COMP_CODE_NONE, *data is NULL
+    and 0 is returned.  This lets the data be decoded apart from the file,
+    e.g. on another thread.
+--------------------------------------------------------------------------*/
+int32
+HCPgetrawdata(int32 file_id, uint16 data_tag, uint16 data_ref, /* IN: tag/ref of element */
+              comp_coder_t *coder_type,                        /* OUT: type of encoding */
+              int32        *orig_size,                         /* OUT: size of decoded data */
+              void        **data)                              /* OUT: compressed data */
+{
+    uint8       *local_ptbuf = NULL, *p;
+    uint16       sp_tag;           /* special tag */
+    uint16       comp_ref = 0;     /* ref# of the compressed data */
+    atom_t       data_id  = FAIL;  /* dd ID of the element */
+    int32        aid      = FAIL;  /* AID of the compressed data */
+    int32        len      = 0;     /* length of the compressed data */
+    comp_model_t model_type;       /* modeling of the data */
+    model_info   m_info;           /* modeling information - dummy */
+    comp_info    c_info;           /* coding information - dummy */
+    filerec_t   *file_rec;          /* file record */
+    filerec_t   *locked_rec = NULL; /* file record locked here */
+    uint8       *buf        = NULL; /* the compressed data */
+    int32        ret_value  = 0;
+
+    if (coder_type == NULL || orig_size == NULL || data == NULL)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    *coder_type = COMP_CODE_NONE;
+    *orig_size  = 0;
+    *data       = NULL;
+
+    /* convert file id to file rec and check for validity */
+    file_rec = HAatom_object(file_id);
+    if (BADFREC(file_rec))
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    locked_rec = HPlock_file(file_id);
+
+    /* get access element from dataset's tag/ref */
+    if ((data_id = HTPselect(file_rec, data_tag, data_ref)) == FAIL)
+        HGOTO_ERROR(DFE_CANTACCESS, FAIL);
+    if (HTPis_special(data_id) == FALSE)
+        HGOTO_DONE(0);
+
+    /* Get the compression header (description record) */
+    if (HPread_drec(file_id, data_id, &local_ptbuf) <= 0)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+    p = local_ptbuf;
+    INT16DECODE(p, sp_tag);
+    if (sp_tag != SPECIAL_COMP)
+        HGOTO_DONE(0);
+
+    /* skip 2byte header_version */
+    p = p + 2;
+    INT32DECODE(p, len); /* get _uncompressed_ data length */
+    if (len == 0)        /* no data written */
+        HGOTO_DONE(0);
+    *orig_size = len;
+    UINT16DECODE(p, comp_ref);
+    if (HCPdecode_header(p, &model_type, &m_info, coder_type, &c_info) == FAIL)
+        HGOTO_ERROR(DFE_COMPINFO, FAIL);
+
+    /* read all of the compressed data */
+    if ((aid = Hstartread(file_id, DFTAG_COMPRESSED, comp_ref)) == FAIL)
+        HGOTO_ERROR(DFE_CANTACCESS, FAIL);
+    if (Hinquire(aid, NULL, NULL, NULL, &len, NULL, NULL, NULL, NULL) == FAIL)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+    if ((buf = malloc((size_t)MAX(len, 1))) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    if (Hread(aid, len, buf) != len)
+        HGOTO_ERROR(DFE_READERROR, FAIL);
+
+    *data     = buf;
+    ret_value = len;
+
+done:
+    if (aid != FAIL)
+        Hendaccess(aid);
+    if (data_id != FAIL)
+        HTPendaccess(data_id);
+    if (ret_value == FAIL)
+        free(buf);
+    free(local_ptbuf);
+
+    HPunlock_file(locked_rec);
+    return ret_value;
+} /* HCPgetrawdata */
@@ -210,7 +210,7 @@ NAME
 USAGE
    int32 HRPseek(access_rec, offset, origin)
        access_t * access_rec;      IN: access record to mess with
-       int32      offset;          IN: seek offset
+       hdf_off_t  offset;          IN: seek offset
        int32      origin;          IN: where we should calc the offset from
 RETURNS
    SUCCEED / FAIL
@@ -220,7 +220,7 @@ DESCRIPTION
 
 ---------------------------------------------------------------------------*/
 int32
-HRPseek(accrec_t *access_rec, int32 offset, int origin)
+HRPseek(accrec_t *access_rec, hdf_off_t offset, int origin)
 {
     int32 ret_value = SUCCEED;
 
@@ -326,9 +326,9 @@ USAGE
    uint16   * file;            OUT: file ID;
    uint16   * tag;             OUT: tag of info record;
    uint16   * ref;             OUT: ref of info record;
-   int32    * len;             OUT: length of element;
-   int32    * off;             OUT: offset of element (NOT correct);
-   int32    * pos;             OUT: current position in element;
+   hdf_off_t * len;            OUT: length of element;
+   hdf_off_t * off;            OUT: offset of element (NOT correct);
+   hdf_off_t * pos;            OUT: current position in element;
    int16    * acc;             OUT: access mode;
    int16    * sp;              OUT: special code;
 RETURNS
@@ -340,14 +340,14 @@ DESCRIPTION
 
 ---------------------------------------------------------------------------*/
 int32
-HRPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength, int32 *poffset,
-           int32 *pposn, int16 *paccess, int16 *pspecial)
+HRPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+           hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
 {
     crinfo_t *info = /* special information record */
         (crinfo_t *)access_rec->special_info;
-    uint16 data_tag, data_ref; /* tag/ref of the data we are checking */
-    int32  data_off;           /* offset of the data we are checking */
-    int32  ret_value = SUCCEED;
+    uint16    data_tag, data_ref; /* tag/ref of the data we are checking */
+    hdf_off_t data_off;           /* offset of the data we are checking */
+    int32     ret_value = SUCCEED;
 
     /* Get the data's offset & length */
     if (HTPinquire(access_rec->ddid, &data_tag, &data_ref, &data_off, NULL) == FAIL)
@@ -361,7 +361,7 @@ HRPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, in
     if (pref)
         *pref = data_ref;
     if (plength)
-        *plength = (access_rec->new_elem ? -1 : info->image_size);
+        *plength = (access_rec->new_elem ? -1 : (hdf_off_t)info->image_size);
     if (poffset)
         *poffset = data_off;
     if (pposn)
@@ -122,4 +122,21 @@ union float_uint_uchar {
     unsigned char c[4];
 };
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Whether data of a number type is stored in the file as it is in memory */
+HDFLIBAPI int DFKIiscopyNT(int32 numbertype);
+
+/* Size of the items whose bytes are swapped to convert a number type, or 0 */
+HDFLIBAPI int DFKIswapsizeNT(int32 numbertype);
+
+/* Swap the bytes of contiguous 2, 4 or 8-byte items */
+HDFLIBAPI void DFKIswap(const void *s, void *d, size_t num_elm, int size);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* H4_HCONV_PRIV_H */
@@ -109,14 +109,15 @@ HDgetdatainfo(int32 file_id, uint16 tag, uint16 ref, int32 *chk_coord, unsigned
     uint16     sp_tag;                              /* special tag */
     uint16     comp_ref = 0;                        /* ref for compressed data or comp header */
     uint16     dtag, dref;                          /* description record tag/ref */
-    int32      dlen = 0, doff               = 0;    /* offset/length of the description record */
+    hdf_off_t  dlen = 0, doff               = 0;    /* offset/length of the description record */
     uint8      lbuf[COMP_HEADER_LENGTH], *p = NULL; /* desc record buffer and a pointer to it */
     atom_t     data_id = FAIL;                      /* dd ID of existing element */
     int32      length;                              /* uncomp data len to check if data had been written */
     int        count     = 0;                       /* num of data blocks returned by getdatainfo funcs */
     uint16     spec_code = 0;                       /* special code: SPECIAL_LINKED, SPECIAL_COMP,... */
-    int32      comp_aid  = -1;                      /* compressed element access id */
-    int        ret_value = SUCCEED;
+    int32      comp_aid   = -1;                     /* compressed element access id */
+    filerec_t *locked_rec = NULL;                   /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     /* Clear error stack */
     HEclear();
@@ -134,6 +135,8 @@ HDgetdatainfo(int32 file_id, uint16 tag, uint16 ref, int32 *chk_coord, unsigned
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(file_id);
+
     /* Get access element from dataset's tag/ref */
     if ((data_id = HTPselect(file_rec, tag, ref)) != FAIL) {
         /* Get the info pointed to by this dd, which could point to data or
@@ -160,8 +163,11 @@ HDgetdatainfo(int32 file_id, uint16 tag, uint16 ref, int32 *chk_coord, unsigned
 
             /* Offset and length are requested by caller */
             if (offsetarray != NULL && lengtharray != NULL) {
-                offsetarray[0] = doff;
-                lengtharray[0] = dlen;
+                /* the arrays can only hold 32-bit values */
+                if (doff > INT32_MAX || dlen > INT32_MAX)
+                    HGOTO_ERROR(DFE_RANGE, FAIL);
+                offsetarray[0] = (int32)doff;
+                lengtharray[0] = (int32)dlen;
             }
             count = 1;
         }
@@ -313,6 +319,7 @@ HDgetdatainfo(int32 file_id, uint16 tag, uint16 ref, int32 *chk_coord, unsigned
     /* Return the number of data blocks */
     ret_value = count;
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* HDgetdatainfo */
 
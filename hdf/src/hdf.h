@@ -56,6 +56,10 @@ typedef uint16_t uint16;
 typedef int32_t  int32;
 typedef uint32_t uint32;
 
+/* Offsets in HDF files and lengths of data elements, as used by the
+ * 64-bit H-layer routines (Hseek64, Htell64, Hlength64 and Hoffset64) */
+typedef int64_t hdf_off_t;
+
 /* Native integer types */
 typedef int          intn;
 typedef unsigned int uintn;
@@ -111,6 +115,15 @@ typedef enum {
 /* The magic cookie for Hcache to cache all files */
 #define CACHE_ALL_FILES (-2)
 
+/* Low-level file drivers for Hsetfiledriver/Hgetfiledriver */
+#define DFDRV_STDIO 0 /* buffered C stdio (default) */
+#define DFDRV_POSIX 1 /* positional pread/pwrite */
+#define DFDRV_MMAP  2 /* read-only memory map */
+
+/* DD list loading for Hsetddload */
+#define DFDDL_ALL  0 /* read the whole DD list in Hopen (default) */
+#define DFDDL_LAZY 1 /* read DD blocks in read-only files as lookups need them */
+
 /* File access modes */
 /* 001--007 for different serial modes */
 /* 011--017 for different parallel modes */
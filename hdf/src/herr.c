@@ -27,15 +27,13 @@ EXPORTED ROUTINES
  */
 
 #include "hdf_priv.h"
+#include "hthread_priv.h"
 
 /*
  ** Include files for variable argument processing for HEreport
  */
 #include <stdarg.h>
 
-/* always points to the next available slot; the last error record is in slot (top-1) */
-static int32 error_top = 0;
-
 /* We use a stack to hold the errors plus we keep track of the function,
    file and line where the error occurs. */
 
@@ -237,8 +235,30 @@ static const struct error_messages_t error_messages[] = {
 
 };
 
-/* pointer to the structure to hold error messages */
-static error_t *error_stack = NULL;
+/* the error stack of a thread */
+typedef struct HEstack_t {
+    int32    top;   /* always points to the next available slot; the last error record is in slot (top-1) */
+    error_t *stack; /* pointer to the structure to hold error messages */
+} HEstack_t;
+
+/* Frees the error records of a thread's error stack */
+static void
+HEIfree_stack(void *data)
+{
+    HEstack_t *es = (HEstack_t *)data;
+
+    if (es->stack != NULL) {
+        for (int i = 0; i < ERR_STACK_SZ; i++)
+            free(es->stack[i].desc);
+        free(es->stack);
+    }
+}
+
+/* The calling thread's error stack, or NULL if it can't be allocated */
+#define HEIget_stack() ((HEstack_t *)HTSlocal(HTS_ERROR_STACK, sizeof(HEstack_t), HEIfree_stack))
+
+/* The calling thread's error stack, or NULL if nothing has been pushed on it yet */
+#define HEIpeek_stack() ((HEstack_t *)HTSpeek_local(HTS_ERROR_STACK))
 
 #ifndef DEFAULT_MESG
 #define DEFAULT_MESG "Unknown error"
@@ -291,14 +311,16 @@ DESCRIPTION
 void
 HEclear(void)
 {
-    if (!error_top)
+    HEstack_t *es = HEIpeek_stack();
+
+    /* es->top == 0 means no error in stack */
+    if (es == NULL || !es->top)
         goto done;
 
-    /* error_top == 0 means no error in stack */
     /* clean out old descriptions if they exist */
-    for (; error_top > 0; error_top--) {
-        free(error_stack[error_top - 1].desc);
-        error_stack[error_top - 1].desc = NULL;
+    for (; es->top > 0; es->top--) {
+        free(es->stack[es->top - 1].desc);
+        es->stack[es->top - 1].desc = NULL;
     }
 
 done:
@@ -328,30 +350,32 @@ DESCRIPTION
 void
 HEpush(hdf_err_code_t error_code, const char *function_name, const char *file_name, int line)
 {
-    int i;
+    HEstack_t *es = HEIget_stack();
+    int        i;
 
     /* if the stack is not allocated, then do it */
-    if (!error_stack) {
-        error_stack = (error_t *)malloc((uint32)sizeof(error_t) * ERR_STACK_SZ);
-        if (!error_stack) {
-            puts("HEpush cannot allocate space.  Unable to continue!!");
-            exit(8);
-        }
-        for (i = 0; i < ERR_STACK_SZ; i++)
-            error_stack[i].desc = NULL;
+    if (es != NULL && !es->stack) {
+        es->stack = (error_t *)malloc((uint32)sizeof(error_t) * ERR_STACK_SZ);
+        if (es->stack != NULL)
+            for (i = 0; i < ERR_STACK_SZ; i++)
+                es->stack[i].desc = NULL;
+    }
+    if (es == NULL || !es->stack) {
+        puts("HEpush cannot allocate space.  Unable to continue!!");
+        exit(8);
     }
 
     /* if stack is full, discard error */
     /* otherwise, push error details onto stack */
 
-    if (error_top < ERR_STACK_SZ) {
-        strcpy(error_stack[error_top].function_name, function_name);
-        error_stack[error_top].file_name  = file_name;
-        error_stack[error_top].line       = line;
-        error_stack[error_top].error_code = error_code;
-        free(error_stack[error_top].desc);
-        error_stack[error_top].desc = NULL;
-        error_top++;
+    if (es->top < ERR_STACK_SZ) {
+        strcpy(es->stack[es->top].function_name, function_name);
+        es->stack[es->top].file_name  = file_name;
+        es->stack[es->top].line       = line;
+        es->stack[es->top].error_code = error_code;
+        free(es->stack[es->top].desc);
+        es->stack[es->top].desc = NULL;
+        es->top++;
     }
 } /* HEpush */
 
@@ -372,20 +396,21 @@ DESCRIPTION
 void
 HEreport(const char *format, ...)
 {
-    va_list arg_ptr;
-    char   *tmp;
+    HEstack_t *es = HEIpeek_stack();
+    va_list    arg_ptr;
+    char      *tmp;
 
     va_start(arg_ptr, format);
 
-    if ((error_top < ERR_STACK_SZ + 1) && (error_top > 0)) {
+    if (es != NULL && (es->top < ERR_STACK_SZ + 1) && (es->top > 0)) {
         tmp = (char *)malloc(ERR_STRING_SIZE);
         if (!tmp) {
             HERROR(DFE_NOSPACE);
             goto done;
         }
         vsprintf(tmp, format, arg_ptr);
-        free(error_stack[error_top - 1].desc);
-        error_stack[error_top - 1].desc = tmp;
+        free(es->stack[es->top - 1].desc);
+        es->stack[es->top - 1].desc = tmp;
     }
 
     va_end(arg_ptr);
@@ -412,17 +437,21 @@ DESCRIPTION
 void
 HEprint(FILE *stream, int32 print_levels)
 {
-    if (print_levels == 0 || print_levels > error_top) /* print all errors */
-        print_levels = error_top;
+    HEstack_t *es = HEIpeek_stack();
+
+    if (es == NULL)
+        return;
+    if (print_levels == 0 || print_levels > es->top) /* print all errors */
+        print_levels = es->top;
 
     /* print the errors starting from most recent */
     for (print_levels--; print_levels >= 0; print_levels--) {
         fprintf(stream, "HDF error: (%d) <%s>\n\tDetected in %s() [%s line %d]\n",
-                error_stack[print_levels].error_code, HEstring(error_stack[print_levels].error_code),
-                error_stack[print_levels].function_name, error_stack[print_levels].file_name,
-                error_stack[print_levels].line);
-        if (error_stack[print_levels].desc)
-            fprintf(stream, "\t%s\n", error_stack[print_levels].desc);
+                es->stack[print_levels].error_code, HEstring(es->stack[print_levels].error_code),
+                es->stack[print_levels].function_name, es->stack[print_levels].file_name,
+                es->stack[print_levels].line);
+        if (es->stack[print_levels].desc)
+            fprintf(stream, "\t%s\n", es->stack[print_levels].desc);
     }
 } /* HEprint */
 
@@ -443,10 +472,11 @@ HEprint(FILE *stream, int32 print_levels)
 int16
 HEvalue(int32 level)
 {
-    int16 ret_value = DFE_NONE;
+    HEstack_t *es        = HEIpeek_stack();
+    int16      ret_value = DFE_NONE;
 
-    if (level > 0 && level <= error_top)
-        ret_value = (int16)error_stack[error_top - level].error_code;
+    if (es != NULL && level > 0 && level <= es->top)
+        ret_value = (int16)es->stack[es->top - level].error_code;
     else
         ret_value = DFE_NONE;
 
@@ -473,10 +503,6 @@ HEvalue(int32 level)
 int
 HEshutdown(void)
 {
-    if (error_stack != NULL) {
-        free(error_stack);
-        error_stack = NULL;
-        error_top   = 0;
-    }
+    HTSfree_local(HTS_ERROR_STACK);
     return SUCCEED;
 } /* end HEshutdown() */
@@ -53,6 +53,12 @@
  LOCAL ROUTINES
    HXIstaccess      -- set up AID to access an ext elem
    HXIbuildfilename -- Build the Filename for the External Element
+   HXIresolve       -- get the path of an element's external file
+   HXIget_file      -- get an open external file from the pool
+   HXIrelease_file  -- give an external file back to the pool
+   HXIread_file     -- read from an external file
+   HXIwrite_file    -- write to an external file
+   HXIflush_file    -- flush what was written to an external file
 
  EXPORTED BUT LIBRARY PRIVATE ROUTINES
    HXPcloseAID      -- close file but keep AID active
@@ -72,10 +78,22 @@ EXPORTED ROUTINES
    HXsetcreatedir   -- set the directory variable for creating external file
    HXsetdir         -- set the directory variable for locating external file
 
+   External File Pool
+  ********************
+   The external files are kept open in a pool shared by all of the
+   external elements in the process, so that accessing an element again,
+   or another element in the same file, doesn't open the file again.  The
+   files are found in the pool by the path they were opened with; when the
+   pool holds MAX_EXT_FILES files the least recently used one that isn't
+   being read or written is closed to make room.  The files are read and
+   written with the positional driver where it's available (see
+   hfiledrv.c), so several elements can share a file without seeking it.
+
 ------------------------------------------------------------------------- */
 
 #include "hdf_priv.h"
 #include "hfile_priv.h"
+#include "hthread_priv.h"
 
 /* Directory separator definitions relating to a path.
  * Note this does not provide a universal way to recognize
@@ -94,29 +112,64 @@ EXPORTED ROUTINES
 #define DIR_PATH_SEPC 124
 #define DIR_PATH_SEPS "|"
 
-static char *extcreatedir    = NULL;
-static char *HDFEXTCREATEDIR = NULL;
-static char *extdir          = NULL;
-static char *HDFEXTDIR       = NULL;
-static int   extdir_changed  = FALSE;
+static char  *extcreatedir    = NULL;
+static char  *HDFEXTCREATEDIR = NULL;
+static char  *extdir          = NULL;
+static char  *HDFEXTDIR       = NULL;
+static uint32 extdir_gen      = 0; /* changed each time HXsetdir changes extdir */
 
 /* extinfo_t -- external elt information structure */
 
 typedef struct {
     int attached; /* number of access records attached
                      to this information structure */
-    int32      extern_offset;
-    int32      length;           /* length of this element */
-    int32      length_file_name; /* length of the external file name */
-    int32      para_extfile_id;  /* parallel ID of the external file */
-    hdf_file_t file_external;    /* external file descriptor */
-    char      *extern_file_name; /* name of the external file */
-    int        file_open;        /* has the file been opened yet ? */
+    int32  extern_offset;
+    int32  length;           /* length of this element */
+    int32  length_file_name; /* length of the external file name */
+    int32  para_extfile_id;  /* parallel ID of the external file */
+    char  *extern_file_name; /* name of the external file */
+    char  *resolved_name;    /* path the external file was found at, NULL until it's needed */
+    uint32 resolved_gen;     /* extdir_gen when resolved_name was found */
+    int    checked;          /* has the pooled file been checked against resolved_name? */
+    int    dirty;            /* has the element been written since it was attached? */
 } extinfo_t;
 
+/* extfile_t -- an external file in the pool */
+
+typedef struct {
+    char                *path;     /* path the file was opened with, NULL if the slot is free */
+    const hdf_fdriver_t *driver;   /* driver the file was opened with */
+    hdf_fhandle_t        fh;       /* driver state for the open file */
+    int                  writable; /* was the file opened for writing? */
+    int                  gone;     /* has the file at path been replaced since it was opened? */
+    int                  busy;     /* # of reads and writes using the file now */
+    uint64_t             used;     /* value of extfile_clock when the file was last used */
+    uint64_t             dev;      /* device and inode of the file when it was opened */
+    uint64_t             ino;
+} extfile_t;
+
+/* extfile_ref_t -- an external file being read or written */
+
+typedef struct {
+    int                  slot;   /* slot of the file in the pool, -1 if it's not pooled */
+    const hdf_fdriver_t *driver; /* driver the file was opened with */
+    hdf_fhandle_t        fh;     /* driver state for the open file */
+} extfile_ref_t;
+
+/* The pool of MAX_EXT_FILES open external files, allocated when it's first
+   needed and protected by the external file lock */
+static extfile_t *extfile_pool  = NULL;
+static uint64_t   extfile_clock = 0; /* ticks each time a file in the pool is used */
+
 /* forward declaration of the functions provided in this module */
-static int32 HXIstaccess(accrec_t *access_rec, int16 access);
-static char *HXIbuildfilename(const char *ext_fname, const int acc_mode);
+static int32       HXIstaccess(accrec_t *access_rec, int16 access);
+static char       *HXIbuildfilename(const char *ext_fname, const int acc_mode);
+static const char *HXIresolve(extinfo_t *info);
+static int         HXIget_file(const char *path, int acc_mode, int check, extfile_ref_t *ref);
+static void        HXIrelease_file(extfile_ref_t *ref);
+static int         HXIread_file(extfile_ref_t *ref, hdf_off_t offset, void *buf, int32 length);
+static int         HXIwrite_file(extfile_ref_t *ref, hdf_off_t offset, const void *buf, int32 length);
+static void        HXIflush_file(const char *path);
 
 /* ext_funcs -- table of the accessing functions of the external
    data element function modules.  The position of each function in
@@ -177,18 +230,19 @@ MODIFICATION
 int32
 HXcreate(int32 file_id, uint16 tag, uint16 ref, const char *extern_file_name, int32 offset, int32 start_len)
 {
-    filerec_t *file_rec;                       /* file record */
-    accrec_t  *access_rec = NULL;              /* access element record */
-    int32      dd_aid;                         /* AID for writing the special info */
-    hdf_file_t file_external;                  /* external file descriptor */
-    extinfo_t *info    = NULL;                 /* special element information */
-    atom_t     data_id = FAIL;                 /* dd ID of existing regular element */
-    int32      data_len;                       /* length of the data we are checking */
-    uint16     special_tag;                    /* special version of tag */
-    uint8      local_ptbuf[20 + MAX_PATH_LEN]; /* temp working buffer */
-    char      *fname     = NULL;               /* filename built from external filename */
-    void      *buf       = NULL;               /* temporary buffer */
-    int32      ret_value = SUCCEED;
+    filerec_t    *file_rec;                       /* file record */
+    accrec_t     *access_rec = NULL;              /* access element record */
+    int32         dd_aid;                         /* AID for writing the special info */
+    extfile_ref_t file;                           /* the external file */
+    int           file_held = FALSE;              /* is the external file held from the pool? */
+    extinfo_t    *info      = NULL;               /* special element information */
+    atom_t        data_id   = FAIL;               /* dd ID of existing regular element */
+    int32         data_len;                       /* length of the data we are checking */
+    uint16        special_tag;                    /* special version of tag */
+    uint8         local_ptbuf[20 + MAX_PATH_LEN]; /* temp working buffer */
+    char         *fname     = NULL;               /* filename built from external filename */
+    void         *buf       = NULL;               /* temporary buffer */
+    int32         ret_value = SUCCEED;
 
     /* clear error stack and validate args */
     HEclear();
@@ -244,10 +298,19 @@ HXcreate(int32 file_id, uint16 tag, uint16 ref, const char *extern_file_name, in
                /* Then use HTPinquire to get the length of the data. Note: when
                   this tag is special, this length is the length of the special
                    info only, not data. */
-            if (HTPinquire(data_id, NULL, NULL, NULL, &data_len) == FAIL) {
+            hdf_off_t dd_len; /* length recorded in the DD */
+
+            if (HTPinquire(data_id, NULL, NULL, NULL, &dd_len) == FAIL) {
                 HTPendaccess(data_id);
                 HGOTO_ERROR(DFE_INTERNAL, FAIL);
             } /* end if */
+
+            /* the external element header records the length in 32 bits */
+            if (dd_len > INT32_MAX) {
+                HTPendaccess(data_id);
+                HGOTO_ERROR(DFE_RANGE, FAIL);
+            } /* end if */
+            data_len = (int32)dd_len;
         }
     } /* end if */
 
@@ -255,16 +318,11 @@ HXcreate(int32 file_id, uint16 tag, uint16 ref, const char *extern_file_name, in
     if (!(fname = HXIbuildfilename(extern_file_name, DFACC_CREATE)))
         HGOTO_ERROR(DFE_BADOPEN, FAIL);
 
-    /* Try to open the external file with write access first, if that fails,
-       create it */
-    file_external = (hdf_file_t)HI_OPEN(fname, DFACC_WRITE);
-    if (OPENERR(file_external)) {
-        file_external = (hdf_file_t)HI_CREATE(fname);
-        if (OPENERR(file_external))
-            HGOTO_ERROR(DFE_BADOPEN, FAIL);
-    }
-    free(fname);
-    extdir_changed = FALSE; /* set to TRUE when HXsetdir is called */
+    /* Get the external file with write access, creating it if it doesn't
+       exist */
+    if (HXIget_file(fname, DFACC_CREATE, TRUE, &file) == FAIL)
+        HGOTO_ERROR(DFE_BADOPEN, FAIL);
+    file_held = TRUE;
 
     /* Get a bare access record and special info structure */
     access_rec = HIget_access_rec();
@@ -276,8 +334,9 @@ HXcreate(int32 file_id, uint16 tag, uint16 ref, const char *extern_file_name, in
     if (!info)
         HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
-    /* Initialize char pointer for use in resource cleanup */
+    /* Initialize char pointers for use in resource cleanup */
     info->extern_file_name = NULL;
+    info->resolved_name    = NULL;
 
     /* If there is data, either regular or special, read the data then write
        it to the external file, otherwise, do nothing */
@@ -286,19 +345,22 @@ HXcreate(int32 file_id, uint16 tag, uint16 ref, const char *extern_file_name, in
             HGOTO_ERROR(DFE_NOSPACE, FAIL);
         if (Hgetelement(file_id, tag, ref, buf) == FAIL)
             HGOTO_ERROR(DFE_READERROR, FAIL);
-        if (HI_SEEK(file_external, offset) == FAIL)
-            HGOTO_ERROR(DFE_SEEKERROR, FAIL);
-        if (HI_WRITE(file_external, buf, (int)data_len) == FAIL)
+        if (HXIwrite_file(&file, offset, buf, data_len) == FAIL)
             HGOTO_ERROR(DFE_WRITEERROR, FAIL);
         info->length = data_len;
     }
     else
         info->length = start_len;
+    HXIrelease_file(&file);
+    file_held = FALSE;
 
     /* Set up the special element information and write it to file */
     info->attached         = 1;
-    info->file_open        = TRUE;
-    info->file_external    = file_external;
+    info->dirty            = (data_id != FAIL && data_len > 0);
+    info->resolved_name    = fname;
+    info->resolved_gen     = extdir_gen;
+    info->checked          = TRUE;
+    fname                  = NULL;
     info->extern_offset    = offset;
     info->extern_file_name = (char *)strdup(extern_file_name);
     if (!info->extern_file_name)
@@ -350,6 +412,7 @@ done:
             HIrelease_accrec_node(access_rec);
         if (info != NULL) {
             free(info->extern_file_name);
+            free(info->resolved_name);
             free(info);
 
             access_rec->special_info = NULL;
@@ -359,6 +422,8 @@ done:
             HTPendaccess(data_id);
     }
 
+    if (file_held)
+        HXIrelease_file(&file);
     free(buf);
 
     return ret_value;
@@ -379,10 +444,10 @@ DESCRIPTION
 int
 HXPsetaccesstype(accrec_t *access_rec)
 {
-    hdf_file_t file_external; /* external file descriptor */
-    extinfo_t *info;          /* special element information */
-    char      *fname     = NULL;
-    int        ret_value = SUCCEED;
+    extfile_ref_t file; /* the external file */
+    extinfo_t    *info; /* special element information */
+    char         *fname     = NULL;
+    int           ret_value = SUCCEED;
 
     /* clear error stack and validate args */
     HEclear();
@@ -401,15 +466,14 @@ HXPsetaccesstype(accrec_t *access_rec)
     /* Open the external file for the correct access type */
     switch (access_rec->access_type) {
         case DFACC_SERIAL:
-            file_external = (hdf_file_t)HI_OPEN(fname, DFACC_WRITE);
-            if (OPENERR(file_external)) {
-                file_external = (hdf_file_t)HI_CREATE(fname);
-                if (OPENERR(file_external))
-                    HGOTO_ERROR(DFE_BADOPEN, FAIL);
-            }
-            free(fname);
-            info->file_external = file_external;
-            extdir_changed      = FALSE; /* set to TRUE when HXsetdir is called again */
+            if (HXIget_file(fname, DFACC_CREATE, TRUE, &file) == FAIL)
+                HGOTO_ERROR(DFE_BADOPEN, FAIL);
+            HXIrelease_file(&file);
+            free(info->resolved_name);
+            info->resolved_name = fname;
+            info->resolved_gen  = extdir_gen;
+            info->checked       = TRUE;
+            fname               = NULL;
             break;
 
         default:
@@ -447,7 +511,7 @@ HXIstaccess(accrec_t *access_rec, int16 acc_mode)
 {
     extinfo_t *info     = NULL; /* special element information */
     filerec_t *file_rec = NULL; /* file record */
-    int32      data_off;        /* offset of the data we are checking */
+    hdf_off_t  data_off;        /* offset of the data we are checking */
     uint8      local_ptbuf[12]; /* working buffer */
     int32      ret_value = SUCCEED;
 
@@ -495,9 +559,11 @@ HXIstaccess(accrec_t *access_rec, int16 acc_mode)
 
         info->extern_file_name[info->length_file_name] = '\0';
 
-        /* delay file opening until needed */
-        info->file_open = FALSE;
-        info->attached  = 1;
+        /* delay finding the file until needed */
+        info->resolved_name = NULL;
+        info->checked       = FALSE;
+        info->dirty         = FALSE;
+        info->attached      = 1;
     }
 
     file_rec->attach++;
@@ -572,7 +638,7 @@ NAME
 USAGE
    int32 HXPseek(access_rec, offset, origin)
    access_t * access_rec;      IN: access record to mess with
-   int32      offset;          IN: seek offset
+   hdf_off_t  offset;          IN: seek offset
    int32      origin;          IN: where we should calc the offset from
 RETURNS
    SUCCEED / FAIL
@@ -581,7 +647,7 @@ DESCRIPTION
 
 ---------------------------------------------------------------------------*/
 int32
-HXPseek(accrec_t *access_rec, int32 offset, int origin)
+HXPseek(accrec_t *access_rec, hdf_off_t offset, int origin)
 {
     int32 ret_value = SUCCEED;
 
@@ -591,7 +657,8 @@ HXPseek(accrec_t *access_rec, int32 offset, int origin)
         offset += access_rec->posn;
     if (origin == DF_END)
         offset += ((extinfo_t *)(access_rec->special_info))->length;
-    if (offset < 0)
+    /* the external element header records the length in 32 bits */
+    if (offset < 0 || offset > INT32_MAX)
         HGOTO_ERROR(DFE_RANGE, FAIL);
 
     /* set the offset */
@@ -627,7 +694,9 @@ HXPread(accrec_t *access_rec, int32 length, void *data)
 {
     extinfo_t *info = /* information on the special element */
         (extinfo_t *)access_rec->special_info;
-    int32 ret_value = SUCCEED;
+    const char   *fname; /* path of the external file */
+    extfile_ref_t file;  /* the external file */
+    int32         ret_value = SUCCEED;
 
     /* validate length */
     if (length < 0)
@@ -635,43 +704,26 @@ HXPread(accrec_t *access_rec, int32 length, void *data)
 
     /* adjust length if it falls off the end of the element */
     if ((length == 0) || (access_rec->posn + length > info->length))
-        length = info->length - access_rec->posn;
+        length = info->length - (int32)access_rec->posn;
     else if (length < 0)
         HGOTO_ERROR(DFE_RANGE, FAIL);
 
-    /* if the file is open but external directory is changed (by HXsetdir),
-       then close the file first before making the new file path */
-    if (!info->file_open || (info->file_open && extdir_changed)) {
-        char *fname;
-
-        /* if the file is open, close it first */
-        if (info->file_open) {
-            HI_CLOSE(info->file_external);
-            info->file_open = FALSE;
-        }
-
-        /* build the customized external file name. */
-        if ((fname = HXIbuildfilename(info->extern_file_name, DFACC_OLD)) == NULL)
-            HGOTO_ERROR(DFE_BADOPEN, FAIL);
-
-        info->file_external = (hdf_file_t)HI_OPEN(fname, access_rec->access);
-        free(fname);
-        if (OPENERR(info->file_external)) {
-            HERROR(DFE_BADOPEN);
-            HEreport("Could not find external file %s\n", info->extern_file_name);
-            HGOTO_DONE(FAIL);
-        }
-        info->file_open = TRUE;
-        extdir_changed  = FALSE; /* set to TRUE when HXsetdir is called again */
+    /* find the external file and get it from the pool */
+    if ((fname = HXIresolve(info)) == NULL)
+        HGOTO_ERROR(DFE_BADOPEN, FAIL);
+    if (HXIget_file(fname, DFACC_READ, !info->checked, &file) == FAIL) {
+        HERROR(DFE_BADOPEN);
+        HEreport("Could not find external file %s\n", info->extern_file_name);
+        HGOTO_DONE(FAIL);
     }
+    info->checked = TRUE;
 
     /* read it in from the file */
-    {
-        if (HI_SEEK(info->file_external, access_rec->posn + info->extern_offset) == FAIL)
-            HGOTO_ERROR(DFE_SEEKERROR, FAIL);
-        if (HI_READ(info->file_external, data, length) == FAIL)
-            HGOTO_ERROR(DFE_READERROR, FAIL);
+    if (HXIread_file(&file, access_rec->posn + info->extern_offset, data, length) == FAIL) {
+        HXIrelease_file(&file);
+        HGOTO_ERROR(DFE_READERROR, FAIL);
     }
+    HXIrelease_file(&file);
 
     /* adjust access position */
     access_rec->posn += length;
@@ -706,69 +758,42 @@ HXPwrite(accrec_t *access_rec, int32 length, const void *data)
     uint8      local_ptbuf[4]; /* temp buffer */
     extinfo_t *info =          /* information on the special element */
         (extinfo_t *)(access_rec->special_info);
-    uint8     *p = local_ptbuf; /* temp buffer ptr */
-    filerec_t *file_rec;        /* file record */
-    int32      ret_value = SUCCEED;
+    uint8        *p = local_ptbuf; /* temp buffer ptr */
+    filerec_t    *file_rec;        /* file record */
+    const char   *fname;           /* path of the external file */
+    extfile_ref_t file;            /* the external file */
+    int32         ret_value = SUCCEED;
 
     /* convert file id to file record */
     file_rec = HAatom_object(access_rec->file_id);
 
     /* validate length */
-    if (length < 0)
+    if (length < 0 || length > INT32_MAX - access_rec->posn)
         HGOTO_ERROR(DFE_RANGE, FAIL);
 
-    /* if the file is open but external directory is changed (by HXsetdir),
-       then close the file first before making the new file path */
-    if (!info->file_open || (info->file_open && extdir_changed)) {
-        char *fname;
-
-        /* if the file is open, close it first */
-        if (info->file_open) {
-            HI_CLOSE(info->file_external);
-            info->file_open = FALSE;
-        }
-
-        /* build the customized external file name. */
-        if ((fname = HXIbuildfilename(info->extern_file_name, DFACC_OLD)) == NULL)
-            HGOTO_ERROR(DFE_BADOPEN, FAIL);
-
-        info->file_external = (hdf_file_t)HI_OPEN(fname, access_rec->access);
-        free(fname);
-        if (OPENERR(info->file_external)) {
-            HERROR(DFE_BADOPEN);
-            HEreport("Could not find external file %s\n", info->extern_file_name);
-            HGOTO_DONE(FAIL);
-        }
-        info->file_open = TRUE;
-        extdir_changed  = FALSE; /* set to TRUE when HXsetdir is called again */
+    /* find the external file and get it from the pool */
+    if ((fname = HXIresolve(info)) == NULL)
+        HGOTO_ERROR(DFE_BADOPEN, FAIL);
+    if (HXIget_file(fname, DFACC_WRITE, !info->checked, &file) == FAIL) {
+        HERROR(DFE_BADOPEN);
+        HEreport("Could not find external file %s\n", info->extern_file_name);
+        HGOTO_DONE(FAIL);
     }
+    info->checked = TRUE;
 
     /* write the data onto file */
-    {
-        if (HI_SEEK(info->file_external, access_rec->posn + info->extern_offset) == FAIL)
-            HGOTO_ERROR(DFE_SEEKERROR, FAIL);
-        if (HI_WRITE(info->file_external, data, length) == FAIL) {
-            /* this external file might not be opened with write permission,
-               reopen the file and try again */
-            hdf_file_t f = (hdf_file_t)HI_OPEN(info->extern_file_name, DFACC_WRITE);
-
-            if (OPENERR(f) || HI_SEEK(f, access_rec->posn + info->extern_offset) == FAIL ||
-                HI_WRITE(f, data, length) == FAIL) {
-                HI_CLOSE(f);
-                HGOTO_ERROR(DFE_DENIED, FAIL);
-            }
-            HI_CLOSE(info->file_external);
-
-            /* if okay, substitute the file descriptor */
-            info->file_external = f;
-        }
+    if (HXIwrite_file(&file, access_rec->posn + info->extern_offset, data, length) == FAIL) {
+        HXIrelease_file(&file);
+        HGOTO_ERROR(DFE_WRITEERROR, FAIL);
     }
+    HXIrelease_file(&file);
+    info->dirty = TRUE;
 
     /* update access record, and information about special elelemt */
     access_rec->posn += length;
     if (access_rec->posn > info->length) {
-        int32 data_off; /* offset of the data we are checking */
-        info->length = access_rec->posn;
+        hdf_off_t data_off; /* offset of the data we are checking */
+        info->length = (int32)access_rec->posn;
         INT32ENCODE(p, info->length);
 
         /* Get the data's offset & length */
@@ -796,9 +821,9 @@ USAGE
    uint16   * file;            OUT: file ID;
    uint16   * tag;             OUT: tag of info record;
    uint16   * ref;             OUT: ref of info record;
-   int32    * len;             OUT: length of element;
-   int32    * off;             OUT: offset of element (NOT correct);
-   int32    * pos;             OUT: current position in element;
+   hdf_off_t * len;            OUT: length of element;
+   hdf_off_t * off;            OUT: offset of element (NOT correct);
+   hdf_off_t * pos;            OUT: current position in element;
    int16    * acc;             OUT: access mode;
    int16    * sp;              OUT: special code;
 RETURNS
@@ -811,8 +836,8 @@ DESCRIPTION
 
 ---------------------------------------------------------------------------*/
 int32
-HXPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength, int32 *poffset,
-           int32 *pposn, int16 *paccess, int16 *pspecial)
+HXPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+           hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
 {
     extinfo_t *info = /* special information record */
         (extinfo_t *)access_rec->special_info;
@@ -925,8 +950,11 @@ HXPcloseAID(accrec_t *access_rec)
        If no more references to that, free the record */
 
     if (--(info->attached) == 0) {
-        if (info->file_open)
-            HI_CLOSE(info->file_external);
+        /* the file stays open in the pool, but what was written to it is
+           flushed as it was when the file was closed here */
+        if (info->dirty && info->resolved_name != NULL)
+            HXIflush_file(info->resolved_name);
+        free(info->resolved_name);
         free(info->extern_file_name);
         free(info);
         access_rec->special_info = NULL;
@@ -1001,7 +1029,8 @@ HXPreset(accrec_t *access_rec, sp_info_block_t *info_block)
     uint8      local_ptbuf[14 + MAX_PATH_LEN]; /* temp buffer */
     extinfo_t *info =                          /* special information record */
         (extinfo_t *)access_rec->special_info;
-    int32 new_len, new_off; /* new length & offset of the special info */
+    int32     new_len; /* new length of the special info */
+    hdf_off_t new_off; /* new offset of the special info */
     int32 ret_value = SUCCEED;
 
     /* validate access record -- make sure is already external element */
@@ -1020,6 +1049,8 @@ HXPreset(accrec_t *access_rec, sp_info_block_t *info_block)
 
     /* update our internal pointers */
     info->extern_offset = info_block->offset;
+    free(info->resolved_name);
+    info->resolved_name = NULL;
     free(info->extern_file_name);
     info->extern_file_name = (char *)strdup(info_block->path);
     if (!info->extern_file_name)
@@ -1132,8 +1163,8 @@ HXsetdir(const char *newdir)
     if (newdir == NULL) {
         if (extdir != NULL) {
             free(extdir);
-            extdir         = NULL;
-            extdir_changed = TRUE;
+            extdir = NULL;
+            extdir_gen++;
         }
     }
     else {
@@ -1142,16 +1173,16 @@ HXsetdir(const char *newdir)
 
         if (extdir != NULL) {
             if (!strcmp(newdir, extdir))
-                extdir_changed = FALSE;
+                free(pt);
             else {
                 free(extdir);
-                extdir         = pt;
-                extdir_changed = TRUE;
+                extdir = pt;
+                extdir_gen++;
             }
         }
         else {
-            extdir         = pt;
-            extdir_changed = TRUE;
+            extdir = pt;
+            extdir_gen++;
         }
     }
 
@@ -1352,6 +1383,289 @@ done:
     return ret_value;
 } /* HXIbuildfilename */
 
+/* ------------------------------- HXIresolve ------------------------------- */
+/*
+NAME
+    HXIresolve -- get the path of an element's external file
+USAGE
+    const char *HXIresolve(info)
+    extinfo_t *info;            IN/OUT: information on the element
+RETURNS
+    The path, or NULL if the file can't be found
+DESCRIPTION
+    The path is found with HXIbuildfilename the first time it's needed,
+    and again only when HXsetdir has changed the directories to look in.
+    Each time it's found the file pooled for it must be checked again.
+
+---------------------------------------------------------------------------*/
+static const char *
+HXIresolve(extinfo_t *info)
+{
+    char *fname;
+
+    if (info->resolved_name != NULL && info->resolved_gen == extdir_gen)
+        return info->resolved_name;
+
+    if ((fname = HXIbuildfilename(info->extern_file_name, DFACC_OLD)) == NULL)
+        return NULL;
+    free(info->resolved_name);
+    info->resolved_name = fname;
+    info->resolved_gen  = extdir_gen;
+    info->checked       = FALSE;
+
+    return fname;
+} /* HXIresolve */
+
+/* Closes the file in a slot of the pool and frees the slot */
+static void
+HXIclose_slot(extfile_t *ef)
+{
+    ef->driver->close(&ef->fh);
+    free(ef->path);
+    ef->path = NULL;
+} /* HXIclose_slot */
+
+/* ------------------------------- HXIget_file ------------------------------ */
+/*
+NAME
+    HXIget_file -- get an open external file from the pool
+USAGE
+    int HXIget_file(path, acc_mode, check, ref)
+    const char *path;           IN: path of the file
+    int acc_mode;               IN: DFACC_READ, DFACC_WRITE, or DFACC_CREATE
+                                    to open for writing and create the file
+                                    if it doesn't exist
+    int check;                  IN: check that a pooled file is still the
+                                    one at path
+    extfile_ref_t *ref;         OUT: the file
+RETURNS
+    SUCCEED / FAIL
+DESCRIPTION
+    If the file is already open in the pool (for writing, if acc_mode asks
+    for it) that is used, else it's opened and put in the pool, closing
+    the least recently used idle file if the pool is full.  If every file
+    in the pool is busy the file is opened outside of it.  The file must be
+    given back with HXIrelease_file.
+
+    A file which was removed or replaced while it was in the pool would
+    still be read and written through the old descriptor, so each element
+    checks the file the first time it uses it.
+
+
+---------------------------------------------------------------------------*/
+static int
+HXIget_file(const char *path, int acc_mode, int check, extfile_ref_t *ref)
+{
+    const hdf_fdriver_t *drv;            /* driver to open the file with */
+    hdf_fhandle_t        fh;             /* the newly opened file */
+    struct stat          sb;             /* what's at path now */
+    int                  have_sb;        /* could path be stat'ed? */
+    int                  for_write;      /* is the file wanted for writing? */
+    int                  slot      = -1; /* slot to put the newly opened file in */
+    int                  stale     = -1; /* idle slot holding the file opened read-only */
+    int                  victim    = -1; /* least recently used idle slot */
+    int                  ret_value = SUCCEED;
+
+    for_write = (acc_mode & (DFACC_WRITE | DFACC_CREATE)) != 0;
+    have_sb   = check && stat(path, &sb) == 0;
+
+    HTS_EXTFILE_LOCK();
+
+    /* without a pool the file is opened outside of it */
+    if (extfile_pool == NULL)
+        extfile_pool = (extfile_t *)calloc(MAX_EXT_FILES, sizeof(extfile_t));
+
+    for (int i = 0; extfile_pool != NULL && i < MAX_EXT_FILES; i++) {
+        extfile_t *ef = &extfile_pool[i];
+
+        if (ef->path != NULL && !ef->gone && check && strcmp(ef->path, path) == 0 &&
+            (!have_sb || ef->dev != (uint64_t)sb.st_dev || ef->ino != (uint64_t)sb.st_ino)) {
+            /* the file was replaced; close it when it's no longer in use */
+            ef->gone = TRUE;
+            if (ef->busy == 0)
+                HXIclose_slot(ef);
+        }
+        if (ef->path == NULL) {
+            if (slot < 0)
+                slot = i;
+            continue;
+        }
+        if (!ef->gone && strcmp(ef->path, path) == 0) {
+            if (ef->writable || !for_write) {
+                ef->busy++;
+                ef->used    = ++extfile_clock;
+                ref->slot   = i;
+                ref->driver = ef->driver;
+                ref->fh     = ef->fh;
+                HGOTO_DONE(SUCCEED);
+            }
+            if (ef->busy == 0)
+                stale = i;
+        }
+        if (ef->busy == 0 && (victim < 0 || ef->used < extfile_pool[victim].used))
+            victim = i;
+    }
+
+    /* open the file with the positional driver, if it was built */
+    if ((drv = HPget_fdriver(DFDRV_POSIX)) == NULL)
+        drv = HPget_fdriver(DFDRV_STDIO);
+    HPinit_fhandle(&fh);
+    if (drv->open(&fh, path, for_write ? DFACC_WRITE : DFACC_READ) == FAIL &&
+        ((acc_mode & DFACC_CREATE) == 0 || drv->create(&fh, path) == FAIL))
+        HGOTO_DONE(FAIL);
+    if (!have_sb && stat(path, &sb) != 0)
+        memset(&sb, 0, sizeof(sb));
+
+    /* a writable file replaces the read-only one, else the new file takes a
+       free slot or the least recently used one */
+    if (stale >= 0)
+        slot = stale;
+    else if (slot < 0)
+        slot = victim;
+    if (slot >= 0 && extfile_pool[slot].path != NULL)
+        HXIclose_slot(&extfile_pool[slot]);
+
+    ref->driver = drv;
+    ref->fh     = fh;
+    ref->slot   = -1;
+    if (slot >= 0 && (extfile_pool[slot].path = strdup(path)) != NULL) {
+        extfile_t *ef = &extfile_pool[slot];
+
+        ef->driver   = drv;
+        ef->fh       = fh;
+        ef->writable = for_write;
+        ef->gone     = FALSE;
+        ef->busy     = 1;
+        ef->used     = ++extfile_clock;
+        ef->dev      = (uint64_t)sb.st_dev;
+        ef->ino      = (uint64_t)sb.st_ino;
+        ref->slot    = slot;
+    }
+
+done:
+    HTS_EXTFILE_UNLOCK();
+
+    return ret_value;
+} /* HXIget_file */
+
+/* ----------------------------- HXIrelease_file ---------------------------- */
+/*
+NAME
+    HXIrelease_file -- give an external file back to the pool
+USAGE
+    void HXIrelease_file(ref)
+    extfile_ref_t *ref;         IN: file from HXIget_file
+DESCRIPTION
+    A pooled file stays open until it's pushed out of the pool or found to
+    have been replaced; one which was opened outside of the pool is closed.
+
+---------------------------------------------------------------------------*/
+static void
+HXIrelease_file(extfile_ref_t *ref)
+{
+    if (ref->slot < 0) {
+        ref->driver->close(&ref->fh);
+        return;
+    }
+
+    HTS_EXTFILE_LOCK();
+    if (--extfile_pool[ref->slot].busy == 0 && extfile_pool[ref->slot].gone)
+        HXIclose_slot(&extfile_pool[ref->slot]);
+    HTS_EXTFILE_UNLOCK();
+} /* HXIrelease_file */
+
+/* ------------------------------ HXIread_file ------------------------------ */
+/*
+NAME
+    HXIread_file -- read from an external file
+USAGE
+    int HXIread_file(ref, offset, buf, length)
+    extfile_ref_t *ref;         IN: file from HXIget_file
+    hdf_off_t offset;           IN: offset in the file to read at
+    void *buf;                  OUT: the data read
+    int32 length;               IN: # of bytes to read
+RETURNS
+    SUCCEED / FAIL
+DESCRIPTION
+    A driver which reads at the offset it's given is called directly;
+    one which must seek first is called under the external file lock, as
+    other elements in the same file share its position.
+
+---------------------------------------------------------------------------*/
+static int
+HXIread_file(extfile_ref_t *ref, hdf_off_t offset, void *buf, int32 length)
+{
+    int ret_value;
+
+    if (ref->driver->seek == NULL)
+        return ref->driver->read(&ref->fh, offset, buf, length);
+
+    HTS_EXTFILE_LOCK();
+    ret_value = ref->driver->seek(&ref->fh, offset);
+    if (ret_value != FAIL)
+        ret_value = ref->driver->read(&ref->fh, offset, buf, length);
+    HTS_EXTFILE_UNLOCK();
+
+    return ret_value;
+} /* HXIread_file */
+
+/* ----------------------------- HXIwrite_file ------------------------------ */
+/*
+NAME
+    HXIwrite_file -- write to an external file
+USAGE
+    int HXIwrite_file(ref, offset, buf, length)
+    extfile_ref_t *ref;         IN: file from HXIget_file for writing
+    hdf_off_t offset;           IN: offset in the file to write at
+    const void *buf;            IN: the data to write
+    int32 length;               IN: # of bytes to write
+RETURNS
+    SUCCEED / FAIL
+DESCRIPTION
+    See HXIread_file.
+
+---------------------------------------------------------------------------*/
+static int
+HXIwrite_file(extfile_ref_t *ref, hdf_off_t offset, const void *buf, int32 length)
+{
+    int ret_value;
+
+    if (ref->driver->seek == NULL)
+        return ref->driver->write(&ref->fh, offset, buf, length);
+
+    HTS_EXTFILE_LOCK();
+    ret_value = ref->driver->seek(&ref->fh, offset);
+    if (ret_value != FAIL)
+        ret_value = ref->driver->write(&ref->fh, offset, buf, length);
+    HTS_EXTFILE_UNLOCK();
+
+    return ret_value;
+} /* HXIwrite_file */
+
+/* ----------------------------- HXIflush_file ------------------------------ */
+/*
+NAME
+    HXIflush_file -- flush what was written to an external file
+USAGE
+    void HXIflush_file(path)
+    const char *path;           IN: path of the file
+DESCRIPTION
+    Flushes the file if it's open for writing in the pool.
+
+---------------------------------------------------------------------------*/
+static void
+HXIflush_file(const char *path)
+{
+    HTS_EXTFILE_LOCK();
+    for (int i = 0; extfile_pool != NULL && i < MAX_EXT_FILES; i++) {
+        extfile_t *ef = &extfile_pool[i];
+
+        if (ef->path != NULL && ef->writable && strcmp(ef->path, path) == 0)
+            ef->driver->flush(&ef->fh);
+    }
+    HTS_EXTFILE_UNLOCK();
+} /* HXIflush_file */
+
 /*------------------------------------------------------------------------
 NAME
    HXPshutdown -- free any memory buffers we've allocated
@@ -1360,12 +1674,23 @@ USAGE
 RETURNS
    SUCCEED/FAIL
 DESCRIPTION
-    Free buffers we've allocated during the execution of the program.
+    Free buffers we've allocated during the execution of the program,
+    and close the files in the external file pool.
 
 --------------------------------------------------------------------------*/
 int
 HXPshutdown(void)
 {
+    HTS_EXTFILE_LOCK();
+    if (extfile_pool != NULL) {
+        for (int i = 0; i < MAX_EXT_FILES; i++)
+            if (extfile_pool[i].path != NULL)
+                HXIclose_slot(&extfile_pool[i]);
+        free(extfile_pool);
+        extfile_pool = NULL;
+    }
+    HTS_EXTFILE_UNLOCK();
+
     free(extcreatedir);
     extcreatedir = NULL;
 
@@ -48,9 +48,13 @@
    Hnextread   -- locate and position a read access elt on next tag/ref.
    Hexist      -- locate an object in an HDF file
    Hinquire    -- inquire stats of an access elt
+   Hinquire64  -- inquire stats of an access elt, with 64-bit offsets
    Hstartwrite -- set up a WRITE access elt for a write
    Happendable -- attempt make a dataset appendable
    Hseek       -- position an access element to an offset in data element
+   Hseek64     -- position an access element to a 64-bit offset
+   Htell       -- report position of an access element in a data element
+   Htell64     -- report 64-bit position of an access element
    Hread       -- read the next segment from data element
    Hwrite      -- write next data segment to data element
    HDgetc      -- read a byte from data element
@@ -59,11 +63,16 @@
    Hgetelement -- read in a data element
    Hputelement -- writes a data element
    Hlength     -- returns length of a data element
+   Hlength64   -- returns 64-bit length of a data element
    Hoffset     -- get offset of data element in the file
+   Hoffset64   -- get 64-bit offset of data element in the file
    Hishdf      -- tells if a file is an HDF file
    Htrunc      -- truncate a dataset to a length
    Hsync       -- sync file with memory
    Hcache      -- set low-level caching for a file
+   Hsetfiledriver -- set the low-level file driver for subsequent opens
+   Hgetfiledriver -- get the low-level file driver used by a file
+   Hsetddload  -- set how the DD list is read in for subsequent opens
    HDvalidfid  -- check if a file ID is valid
    HDerr       --  Closes a file and return FAIL.
    Hsetacceesstype -- set the I/O access type (serial, parallel, ...)
@@ -72,6 +81,7 @@
    Hgetfileversion -- return version info on HDF file
    HPgetdiskblock  -- Get the offset of a free block in the file.
    HPfreediskblock -- Release a block in a file to be reused.
+   HP_readv    -- read pieces of the file from many places at once
    HDread_drec -- reads a description record
    HDcheck_empty   -- determines if an element has been written with data
    HDget_special_info -- get information about a special element
@@ -108,6 +118,7 @@
    HIget_access_rec     -- allocate a new access record
    HIupdate_version     -- determine whether new version tag should be written
    HIread_version       -- reads a version tag from a file
+   HIcompare_extents    -- order the pieces of a vectored read by offset
    + */
 
 #include <errno.h>
@@ -121,6 +132,12 @@
 /* The default state of the file DD caching */
 static int default_cache = TRUE;
 
+/* The low-level file driver used by Hopen */
+static int default_fdriver = DFDRV_STDIO;
+
+/* How Hopen reads in the DD list */
+static int default_ddload = DFDDL_ALL;
+
 /* Whether we've installed the library termination function yet for this interface */
 static int library_terminate = FALSE;
 
@@ -193,7 +210,7 @@ static filerec_t *HIget_filerec_node(const char *path);
 
 static int HIrelease_filerec_node(filerec_t *file_rec);
 
-static int HIvalid_magic(hdf_file_t file);
+static int HIvalid_magic(const hdf_fdriver_t *driver, hdf_fhandle_t *fh);
 
 static int HIextend_file(filerec_t *file_rec);
 
@@ -209,6 +226,8 @@ static int HIsync(filerec_t *file_rec);
 
 static int HIstart(void);
 
+static int HIstart_once(void);
+
 /*--------------------------------------------------------------------------
 NAME
    Hopen -- Opens or creates an HDF file.
@@ -250,20 +269,21 @@ DESCRIPTION
 int32
 Hopen(const char *path, int acc_mode, int16 ndds)
 {
-    filerec_t *file_rec  = NULL; /* File record */
-    int        vtag      = 0;    /* write version tag? */
-    int32      fid       = FAIL; /* File ID */
-    int32      ret_value = SUCCEED;
+    filerec_t *file_rec   = NULL; /* File record */
+    filerec_t *locked_rec = NULL; /* File record locked here */
+    int        vtag       = 0;    /* write version tag? */
+    int32      fid        = FAIL; /* File ID */
+    int32      ret_value  = SUCCEED;
 
     /* Clear errors and check args and all the boring stuff. */
     HEclear();
+    HTS_LOCK();
     if (!path || ((acc_mode & DFACC_ALL) != acc_mode))
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
     /* Perform global, one-time initialization */
-    if (library_terminate == FALSE)
-        if (HIstart() == FAIL)
-            HGOTO_ERROR(DFE_CANTINIT, FAIL);
+    if (HIstart_once() == FAIL)
+        HGOTO_ERROR(DFE_CANTINIT, FAIL);
 
     /* Get a space to put the file information.
      * HIget_filerec_node() also copies path into the record. */
@@ -271,6 +291,10 @@ Hopen(const char *path, int acc_mode, int16 ndds)
         HGOTO_ERROR(DFE_TOOMANY, FAIL); /* The slots are full. */
 
     if (file_rec->refcount) { /* File is already opened, check that permission is okay. */
+        /* Other threads may be working on the file */
+        HFILE_LOCK(file_rec);
+        locked_rec = file_rec;
+
         /* If this request is to create a new file and file is still
          * in use, return error. */
         if (acc_mode == DFACC_CREATE)
@@ -281,38 +305,50 @@ Hopen(const char *path, int acc_mode, int16 ndds)
                provide for write, then try to reopen file for writing.
                This cannot be done on OS (such as the SXOS) where only one
                open is allowed per file at any time. */
-            hdf_file_t f;
+            const hdf_fdriver_t *driver;
+            hdf_fhandle_t        fh;
 
             /* Sync. the file before throwing away the old file handle */
             if (HIsync(file_rec) == FAIL)
                 HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
-            f = (hdf_file_t)HI_OPEN(file_rec->path, acc_mode);
-            if (OPENERR(f))
+            /* Writing needs the whole DD list */
+            if (HTPload(file_rec) == FAIL)
+                HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+            /* The file may have been opened with a read-only driver */
+            if ((driver = HPselect_fdriver(file_rec->driver->type, acc_mode)) == NULL)
+                HGOTO_ERROR(DFE_UNSUPPORTED, FAIL);
+            HPinit_fhandle(&fh);
+            if (driver->open(&fh, file_rec->path, acc_mode) == FAIL)
                 HGOTO_ERROR(DFE_DENIED, FAIL);
 
-            /* Replace file_rec->file with new file pointer and
+            /* Replace file_rec->fh with new file handle and
                close old one. */
-            if (HI_CLOSE(file_rec->file) == FAIL) {
-                HI_CLOSE(f);
+            if (file_rec->driver->close(&file_rec->fh) == FAIL) {
+                driver->close(&fh);
                 HGOTO_ERROR(DFE_CANTCLOSE, FAIL);
             }
-            file_rec->file      = f;
+            file_rec->driver    = driver;
+            file_rec->fh        = fh;
             file_rec->f_cur_off = 0;
             file_rec->last_op   = H4_OP_UNKNOWN;
         }
 
         /* There is now one more open to this file. */
-        file_rec->refcount++;
+        HFILE_SET_REFCOUNT(file_rec, file_rec->refcount + 1);
     }
     else {
         /* Flag to see if file is new and needs to be set up. */
         int new_file = FALSE;
 
+        if ((file_rec->driver = HPselect_fdriver(default_fdriver, acc_mode)) == NULL)
+            HGOTO_ERROR(DFE_UNSUPPORTED, FAIL);
+        HPinit_fhandle(&file_rec->fh);
+
         /* Open the file, fill in the blanks and all the good stuff. */
         if (acc_mode != DFACC_CREATE) { /* try to open existing file */
-            file_rec->file = (hdf_file_t)HI_OPEN(file_rec->path, acc_mode);
-            if (OPENERR(file_rec->file)) {
+            if (file_rec->driver->open(&file_rec->fh, file_rec->path, acc_mode) == FAIL) {
                 if (acc_mode & DFACC_WRITE) {
                     /* Seems like the file is not there, try to create it. */
                     new_file = TRUE;
@@ -325,16 +361,18 @@ Hopen(const char *path, int acc_mode, int16 ndds)
                 file_rec->access = acc_mode | DFACC_READ;
 
                 /* Check to see if file is a HDF file. */
-                if (!HIvalid_magic(file_rec->file)) {
-                    HI_CLOSE(file_rec->file);
+                if (!HIvalid_magic(file_rec->driver, &file_rec->fh)) {
+                    file_rec->driver->close(&file_rec->fh);
                     HGOTO_ERROR(DFE_NOTDFFILE, FAIL);
                 }
 
                 file_rec->f_cur_off = 0;
                 file_rec->last_op   = H4_OP_UNKNOWN;
-                /* Read in all the relevant data descriptor records. */
-                if (HTPstart(file_rec) == FAIL) {
-                    HI_CLOSE(file_rec->file);
+                /* Read in the relevant data descriptor records.  Only files
+                   which can't be written to can be left partly on disk. */
+                if (HTPstart(file_rec, default_ddload == DFDDL_LAZY && !(acc_mode & DFACC_WRITE)) ==
+                    FAIL) {
+                    file_rec->driver->close(&file_rec->fh);
                     HGOTO_ERROR(DFE_BADOPEN, FAIL);
                 }
             }
@@ -344,8 +382,7 @@ Hopen(const char *path, int acc_mode, int16 ndds)
                                                     /* make user we get a version tag */
             vtag = 1;
 
-            file_rec->file = (hdf_file_t)HI_CREATE(file_rec->path);
-            if (OPENERR(file_rec->file)) {
+            if (file_rec->driver->create(&file_rec->fh, file_rec->path) == FAIL) {
                 /* check if the failure was due to "too many open files" */
                 if (errno == EMFILE) {
                     HGOTO_ERROR(DFE_TOOMANY, FAIL);
@@ -362,7 +399,7 @@ Hopen(const char *path, int acc_mode, int16 ndds)
             if (HP_write(file_rec, HDFMAGIC, MAGICLEN) == FAIL)
                 HGOTO_ERROR(DFE_WRITEERROR, FAIL);
 
-            if (HI_FLUSH(file_rec->file) == FAIL) /* flush the cookie */
+            if (file_rec->driver->flush(&file_rec->fh) == FAIL) /* flush the cookie */
                 HGOTO_ERROR(DFE_WRITEERROR, FAIL);
 
             if (HTPinit(file_rec, ndds) == FAIL)
@@ -371,8 +408,8 @@ Hopen(const char *path, int acc_mode, int16 ndds)
             file_rec->maxref = 0;
             file_rec->access = new_file ? acc_mode | DFACC_READ : DFACC_ALL;
         }
-        file_rec->refcount = 1;
-        file_rec->attach   = 0;
+        HFILE_SET_REFCOUNT(file_rec, 1);
+        file_rec->attach = 0;
 
         /* currently, default is caching OFF */
         file_rec->cache = default_cache;
@@ -396,6 +433,9 @@ Hopen(const char *path, int acc_mode, int16 ndds)
     ret_value = fid;
 
 done:
+    if (locked_rec != NULL)
+        HFILE_UNLOCK(locked_rec);
+
     if (ret_value == FAIL) { /* Error condition cleanup */
         if (fid != FAIL)
             HAremove_atom(fid);
@@ -404,6 +444,7 @@ done:
         if (file_rec != NULL && file_rec->refcount == 0)
             HIrelease_filerec_node(file_rec);
     }
+    HTS_UNLOCK();
 
     return ret_value;
 } /* Hopen */
@@ -425,27 +466,32 @@ DESCRIPTION
 int
 Hclose(int32 file_id)
 {
-    filerec_t *file_rec; /* file record pointer */
-    int        ret_value = SUCCEED;
+    filerec_t *file_rec;          /* file record pointer */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     /* Clear errors and check args and all the boring stuff. */
     HEclear();
+    HTS_LOCK();
 
     /* convert file id to file rec and check for validity */
     file_rec = HAatom_object(file_id);
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_ARGS, FAIL);
+    HFILE_LOCK(file_rec);
+    locked_rec = file_rec;
 
     /* version tags */
     if ((file_rec->refcount > 0) && (file_rec->version.modified == 1))
         HIupdate_version(file_id);
 
     /* decrease the reference count */
-    if (--file_rec->refcount == 0) {
+    HFILE_SET_REFCOUNT(file_rec, file_rec->refcount - 1);
+    if (file_rec->refcount == 0) {
         /* if file reference count is zero but there are still attached
            access elts, reject this close. */
         if (file_rec->attach > 0) {
-            file_rec->refcount++;
+            HFILE_SET_REFCOUNT(file_rec, 1);
             HEreport("There are still %d active aids attached", file_rec->attach);
             HGOTO_ERROR(DFE_OPENAID, FAIL);
         } /* end if */
@@ -456,11 +502,14 @@ Hclose(int32 file_id)
 
         /* otherwise, nothing should still be using this file, close it */
         /* ignore any close error */
-        HI_CLOSE(file_rec->file);
+        file_rec->driver->close(&file_rec->fh);
 
         if (HTPend(file_rec) == FAIL)
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
+        /* the lock goes away with the file record */
+        HFILE_UNLOCK(file_rec);
+        locked_rec = NULL;
         if (HIrelease_filerec_node(file_rec))
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
     } /* end if */
@@ -469,6 +518,10 @@ Hclose(int32 file_id)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
 done:
+    if (locked_rec != NULL)
+        HFILE_UNLOCK(locked_rec);
+    HTS_UNLOCK();
+
     return ret_value;
 } /* Hclose */
 
@@ -536,15 +589,69 @@ int
 Hinquire(int32 access_id, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength, int32 *poffset,
          int32 *pposn, int16 *paccess, int16 *pspecial)
 {
-    accrec_t *access_rec; /* access record */
+    hdf_off_t length    = 0; /* length of the element */
+    hdf_off_t offset    = 0; /* offset of the element in the file */
+    hdf_off_t posn      = 0; /* position in the element */
     int       ret_value = SUCCEED;
 
+    ret_value = Hinquire64(access_id, pfile_id, ptag, pref, &length, &offset, &posn, paccess, pspecial);
+    if (ret_value == FAIL)
+        HGOTO_DONE(FAIL);
+
+    /* Values that don't fit are reported through Hinquire64 only */
+    if (length > INT32_MAX || offset > INT32_MAX || posn > INT32_MAX)
+        HGOTO_ERROR(DFE_RANGE, FAIL);
+
+    if (plength != NULL)
+        *plength = (int32)length;
+    if (poffset != NULL)
+        *poffset = (int32)offset;
+    if (pposn != NULL)
+        *pposn = (int32)posn;
+
+done:
+    return ret_value;
+} /* end Hinquire */
+
+/*--------------------------------------------------------------------------
+NAME
+   Hinquire64 -- inquire stats of an access elt, with 64-bit offsets
+USAGE
+   int Hinquire64(access_id, pfile_id, ptag, pref, plength,
+                                   poffset, pposn, paccess, pspecial)
+   int access_id;          IN: id of an access elt
+   int32 *pfile_id;        OUT: file id
+   uint16 *ptag;           OUT: tag of the element pointed to
+   uint16 *pref;           OUT: ref of the element pointed to
+   hdf_off_t *plength;     OUT: length of the element pointed to
+   hdf_off_t *poffset;     OUT: offset of elt in the file
+   hdf_off_t *pposn;       OUT: position pointed to within the data elt
+   int16 *paccess;         OUT: the access type of this access elt
+   int16 *pspecial;        OUT: special code
+RETURNS
+   returns SUCCEED (0) if the access elt points to some data element,
+   otherwise FAIL (-1)
+DESCRIPTION
+   Same as Hinquire, but the length, offset and position are returned as
+   64-bit values so that elements beyond 2 GiB can be described.
+
+--------------------------------------------------------------------------*/
+int
+Hinquire64(int32 access_id, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+           hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
+{
+    accrec_t  *access_rec;        /* access record */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int        ret_value  = SUCCEED;
+
     /* clear error stack and check validity of access id */
     HEclear();
     access_rec = HAatom_object(access_id);
     if (access_rec == (accrec_t *)NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(access_rec->file_id);
+
     /* if special elt, let special functions handle it */
     if (access_rec->special) {
         ret_value = (int)(*access_rec->special_func->inquire)(access_rec, pfile_id, ptag, pref, plength,
@@ -564,8 +671,9 @@ Hinquire(int32 access_id, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *pl
         *pspecial = 0;
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
-} /* end Hinquire */
+} /* end Hinquire64 */
 
 /* ----------------------------- Hfidinquire ----------------------------- */
 /*
@@ -671,7 +779,8 @@ Hnextread(int32 access_id, uint16 tag, uint16 ref, int origin)
     accrec_t  *access_rec;               /* access record */
     uint16     new_tag = 0, new_ref = 0; /* new tag & ref to access */
     int32      new_off, new_len;         /* offset & length of new tag & ref */
-    int        ret_value = SUCCEED;
+    filerec_t *locked_rec = NULL;        /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     /* clear error stack and check validity of the access id */
     HEclear();
@@ -680,6 +789,8 @@ Hnextread(int32 access_id, uint16 tag, uint16 ref, int origin)
         (origin != DF_START && origin != DF_CURRENT)) /* DF_END is NOT supported yet !!!! */
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(access_rec->file_id);
+
     file_rec = HAatom_object(access_rec->file_id);
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
@@ -771,6 +882,7 @@ Hnextread(int32 access_id, uint16 tag, uint16 ref, int origin)
     access_rec->posn    = 0;
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* end Hnextread() */
 
@@ -846,7 +958,8 @@ Hstartaccess(int32 file_id, uint16 tag, uint16 ref, uint32 flags)
     accrec_t  *access_rec = NULL;        /* access record */
     uint16     new_tag = 0, new_ref = 0; /* new tag & ref to access */
     int32      new_off, new_len;         /* offset & length of new tag & ref */
-    int32      ret_value = SUCCEED;
+    filerec_t *locked_rec = NULL;        /* file record locked here */
+    int32      ret_value  = SUCCEED;
 
     /* clear error stack and check validity of file id */
     HEclear();
@@ -855,6 +968,8 @@ Hstartaccess(int32 file_id, uint16 tag, uint16 ref, uint32 flags)
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(file_id);
+
     /* If writing, can we write to this file? */
     if ((flags & DFACC_WRITE) && !(file_rec->access & DFACC_WRITE))
         HGOTO_ERROR(DFE_DENIED, FAIL);
@@ -957,6 +1072,7 @@ Hstartaccess(int32 file_id, uint16 tag, uint16 ref, uint32 flags)
     ret_value = HAregister_atom(AIDGROUP, access_rec);
 
 done:
+    HPunlock_file(locked_rec);
     if (ret_value == FAIL) { /* Error condition cleanup */
         if (access_rec != NULL)
             HIrelease_accrec_node(access_rec);
@@ -983,16 +1099,18 @@ DESCRIPTION
 int
 Hsetlength(int32 aid, int32 length)
 {
-    accrec_t  *access_rec; /* access record */
-    filerec_t *file_rec;   /* file record */
-    int32      offset;     /* offset of this data element in file */
-    int        ret_value = SUCCEED;
+    accrec_t  *access_rec;        /* access record */
+    filerec_t *file_rec;          /* file record */
+    hdf_off_t  offset;            /* offset of this data element in file */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     /* clear error stack and check validity of file id */
     HEclear();
 
     if ((access_rec = HAatom_object(aid)) == NULL) /* get the access_rec pointer */
         HGOTO_ERROR(DFE_ARGS, FAIL);
+    locked_rec = HPlock_file(access_rec->file_id);
 
     /* Check whether we are allowed to change the length */
     if (access_rec->new_elem != TRUE)
@@ -1014,6 +1132,7 @@ Hsetlength(int32 aid, int32 length)
     access_rec->new_elem = FALSE;
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* end Hsetlength */
 
@@ -1071,8 +1190,8 @@ HPisappendable(int32 aid)
 {
     accrec_t  *access_rec; /* access record */
     filerec_t *file_rec;   /* file record */
-    int32      data_len;   /* length of the data we are checking */
-    int32      data_off;   /* offset of the data we are checking */
+    hdf_off_t  data_len;   /* length of the data we are checking */
+    hdf_off_t  data_off;   /* offset of the data we are checking */
     int        ret_value = SUCCEED;
 
     /* clear error stack and check validity of file id */
@@ -1085,7 +1204,7 @@ HPisappendable(int32 aid)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
     /* get the offset and length of the dataset */
-    if (HTPinquire(access_rec->ddid, NULL, NULL, &data_len, &data_off) == FAIL)
+    if (HTPinquire(access_rec->ddid, NULL, NULL, &data_off, &data_len) == FAIL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
     /* dataset at end? */
@@ -1121,13 +1240,37 @@ DESCRIPTION
 --------------------------------------------------------------------------*/
 int
 Hseek(int32 access_id, int32 offset, int origin)
+{
+    return Hseek64(access_id, (hdf_off_t)offset, origin);
+} /* Hseek() */
+
+/*--------------------------------------------------------------------------
+
+NAME
+   Hseek64 -- position an access element to a 64-bit offset in data element
+USAGE
+   int Hseek64(access_id, offset, origin)
+   int32 access_id;        IN: id of access element
+   hdf_off_t offset;       IN: offset to seek to
+   int origin;             IN: position to seek from by offset, 0: from
+                                                   beginning; 1: current position; 2: end of
+                                                   data element
+RETURNS
+   returns FAIL (-1) if fail, SUCCEED (0) otherwise.
+DESCRIPTION
+   Same as Hseek, for positions that do not fit in 32 bits.
+
+--------------------------------------------------------------------------*/
+int
+Hseek64(int32 access_id, hdf_off_t offset, int origin)
 {
     accrec_t  *access_rec;          /* access record */
-    int        old_offset = offset; /* save for later potential use */
+    hdf_off_t  old_offset = offset; /* save for later potential use */
     filerec_t *file_rec;            /* file record */
-    int32      data_len;            /* length of the data we are checking */
-    int32      data_off;            /* offset of the data we are checking */
-    int        ret_value = SUCCEED;
+    hdf_off_t  data_len;            /* length of the data we are checking */
+    hdf_off_t  data_off;            /* offset of the data we are checking */
+    filerec_t *locked_rec = NULL;   /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     /* clear error stack and check validity of this access id */
     HEclear();
@@ -1136,6 +1279,8 @@ Hseek(int32 access_id, int32 offset, int origin)
     if (access_rec == (accrec_t *)NULL || (origin != DF_START && origin != DF_CURRENT && origin != DF_END))
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(access_rec->file_id);
+
     /* if special elt, use special function */
     if (access_rec->special) { /* yes, call special seek function with proper args */
         ret_value = (int)(*access_rec->special_func->seek)(access_rec, offset, origin);
@@ -1159,7 +1304,7 @@ Hseek(int32 access_id, int32 offset, int origin)
 
     /* Check the range */
     if (offset < 0 || (!access_rec->appendable && offset > data_len)) {
-        HEreport("Tried to seek to %d (object length:  %d)", offset, data_len);
+        HEreport("Tried to seek to %lld (object length:  %lld)", (long long)offset, (long long)data_len);
         HGOTO_ERROR(DFE_BADSEEK, FAIL);
     }
 
@@ -1172,14 +1317,15 @@ Hseek(int32 access_id, int32 offset, int origin)
             file_rec->f_end_off) { /* nope, so try to convert element into linked-block element */
             if (HLconvert(access_id, access_rec->block_size, access_rec->num_blocks) == FAIL) {
                 access_rec->appendable = FALSE;
-                HEreport("Tried to seek to %d (object length:  %d)", offset, data_len);
+                HEreport("Tried to seek to %lld (object length:  %lld)", (long long)offset,
+                         (long long)data_len);
                 HGOTO_ERROR(DFE_BADSEEK, FAIL);
             } /* end if */
             else
             /* successfully converted the element into a linked block */
             /* now loop back and actually seek to the correct position */
             {
-                if (Hseek(access_id, old_offset, origin) == FAIL)
+                if (Hseek64(access_id, old_offset, origin) == FAIL)
                     HGOTO_ERROR(DFE_BADSEEK, FAIL);
             } /* end else */
         }     /* end if */
@@ -1189,8 +1335,9 @@ Hseek(int32 access_id, int32 offset, int origin)
     access_rec->posn = offset;
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
-} /* Hseek() */
+} /* Hseek64() */
 
 /*--------------------------------------------------------------------------
 
@@ -1209,9 +1356,41 @@ DESCRIPTION
 int32
 Htell(int32 access_id)
 {
-    accrec_t *access_rec; /* access record */
+    hdf_off_t posn;
     int32     ret_value = SUCCEED;
 
+    if ((posn = Htell64(access_id)) == FAIL)
+        HGOTO_DONE(FAIL);
+
+    /* Positions past 2 GiB can only be reported by Htell64 */
+    if (posn > INT32_MAX)
+        HGOTO_ERROR(DFE_RANGE, FAIL);
+
+    ret_value = (int32)posn;
+
+done:
+    return ret_value;
+} /* Htell() */
+
+/*--------------------------------------------------------------------------
+
+NAME
+   Htell64 -- report 64-bit position of an access element in a data element
+USAGE
+   hdf_off_t Htell64(access_id)
+       int32 access_id;        IN: id of access element
+RETURNS
+   returns FAIL (-1) on error, offset in data element otherwise
+DESCRIPTION
+    Same as Htell, for positions that do not fit in 32 bits.
+
+--------------------------------------------------------------------------*/
+hdf_off_t
+Htell64(int32 access_id)
+{
+    accrec_t *access_rec; /* access record */
+    hdf_off_t ret_value = SUCCEED;
+
     /* clear error stack and check validity of this access id */
     HEclear();
 
@@ -1220,11 +1399,11 @@ Htell(int32 access_id)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
     /* return the offset in the AID */
-    ret_value = (int32)access_rec->posn;
+    ret_value = access_rec->posn;
 
 done:
     return ret_value;
-} /* Htell() */
+} /* Htell64() */
 
 /*--------------------------------------------------------------------------
 NAME
@@ -1246,11 +1425,12 @@ DESCRIPTION
 int32
 Hread(int32 access_id, int32 length, void *data)
 {
-    filerec_t *file_rec;   /* file record */
-    accrec_t  *access_rec; /* access record */
-    int32      data_len;   /* length of the data we are checking */
-    int32      data_off;   /* offset of the data we are checking */
-    int32      ret_value = SUCCEED;
+    filerec_t *file_rec;          /* file record */
+    accrec_t  *access_rec;        /* access record */
+    hdf_off_t  data_len;          /* length of the data we are checking */
+    hdf_off_t  data_off;          /* offset of the data we are checking */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int32      ret_value  = SUCCEED;
 
     /* clear error stack and check validity of access id */
     HEclear();
@@ -1258,6 +1438,8 @@ Hread(int32 access_id, int32 length, void *data)
     if (access_rec == (accrec_t *)NULL || data == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(access_rec->file_id);
+
     /* Don't allow reading of "new" elements */
     if (access_rec->new_elem == TRUE)
         HGOTO_ERROR(DFE_READERROR, FAIL);
@@ -1287,8 +1469,12 @@ Hread(int32 access_id, int32 length, void *data)
 
     /* length == 0 means to read to end of element, */
     /* if read length exceeds length of elt, read till end of elt */
-    if (length == 0 || length + access_rec->posn > data_len)
-        length = data_len - access_rec->posn;
+    if (length == 0 || length + access_rec->posn > data_len) {
+        /* the rest of a very large element can't be read at once */
+        if (data_len - access_rec->posn > INT32_MAX)
+            HGOTO_ERROR(DFE_RANGE, FAIL);
+        length = (int32)(data_len - access_rec->posn);
+    }
 
     /* read in data */
     if (HP_read(file_rec, data, length) == FAIL)
@@ -1300,6 +1486,7 @@ Hread(int32 access_id, int32 length, void *data)
     ret_value = length;
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* Hread */
 
@@ -1326,11 +1513,12 @@ DESCRIPTION
 int32
 Hwrite(int32 access_id, int32 length, const void *data)
 {
-    filerec_t *file_rec = NULL; /* file record */
-    accrec_t  *access_rec;      /* access record */
-    int32      data_len;        /* length of the data we are checking */
-    int32      data_off;        /* offset of the data we are checking */
-    int32      ret_value = SUCCEED;
+    filerec_t *file_rec = NULL;   /* file record */
+    accrec_t  *access_rec;        /* access record */
+    hdf_off_t  data_len;          /* length of the data we are checking */
+    hdf_off_t  data_off;          /* offset of the data we are checking */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int32      ret_value  = SUCCEED;
 
     /* clear error stack and check validity of access id */
     HEclear();
@@ -1338,6 +1526,8 @@ Hwrite(int32 access_id, int32 length, const void *data)
     if (access_rec == (accrec_t *)NULL || !(access_rec->access & DFACC_WRITE) || data == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(access_rec->file_id);
+
     /* if special elt, call special write function */
     if (access_rec->special) {
         ret_value = (*access_rec->special_func->write)(access_rec, length, data);
@@ -1408,6 +1598,7 @@ Hwrite(int32 access_id, int32 length, const void *data)
     ret_value = length;
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* end Hwrite */
 
@@ -1493,6 +1684,7 @@ Hendaccess(int32 access_id)
 {
     filerec_t *file_rec;          /* file record */
     accrec_t  *access_rec = NULL; /* access record */
+    filerec_t *locked_rec = NULL; /* file record locked here */
     int        ret_value  = SUCCEED;
 
     /* clear error stack and check validity of access id */
@@ -1500,6 +1692,8 @@ Hendaccess(int32 access_id)
     if ((access_rec = HAremove_atom(access_id)) == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(access_rec->file_id);
+
     /* if special elt, call special function */
     if (access_rec->special) {
         ret_value = (*access_rec->special_func->endaccess)(access_rec);
@@ -1519,6 +1713,7 @@ Hendaccess(int32 access_id)
     HIrelease_accrec_node(access_rec);
 
 done:
+    HPunlock_file(locked_rec);
     if (ret_value == FAIL) { /* Error condition cleanup */
         if (access_rec != NULL)
             HIrelease_accrec_node(access_rec);
@@ -1645,9 +1840,42 @@ DESCRIPTION
 int32
 Hlength(int32 file_id, uint16 tag, uint16 ref)
 {
-    int32 access_id;        /* access record id */
-    int32 length    = FAIL; /* length of elt inquired */
-    int32 ret_value = SUCCEED;
+    hdf_off_t length;
+    int32     ret_value = SUCCEED;
+
+    if ((length = Hlength64(file_id, tag, ref)) == FAIL)
+        HGOTO_DONE(FAIL);
+
+    /* Lengths past 2 GiB can only be reported by Hlength64 */
+    if (length > INT32_MAX)
+        HGOTO_ERROR(DFE_RANGE, FAIL);
+
+    ret_value = (int32)length;
+
+done:
+    return ret_value;
+} /* end Hlength */
+
+/*--------------------------------------------------------------------------
+NAME
+   Hlength64 -- returns the 64-bit length of a data element
+USAGE
+   hdf_off_t Hlength64(fileid, tag, ref)
+   int32 fileid;           IN: id of file
+   uint16 tag;             IN: tag of data element
+   uint16 ref;             IN: ref of data element
+RETURNS
+   return the length of a data element or FAIL (-1)
+DESCRIPTION
+   Same as Hlength, for elements that may be larger than 2 GiB.
+
+--------------------------------------------------------------------------*/
+hdf_off_t
+Hlength64(int32 file_id, uint16 tag, uint16 ref)
+{
+    int32     access_id;        /* access record id */
+    hdf_off_t length    = FAIL; /* length of elt inquired */
+    hdf_off_t ret_value = SUCCEED;
 
     /* clear error stack */
     HEclear();
@@ -1658,7 +1886,7 @@ Hlength(int32 file_id, uint16 tag, uint16 ref)
     if (access_id == FAIL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
-    if ((ret_value = HQuerylength(access_id, &length)) == FAIL)
+    if ((ret_value = Hinquire64(access_id, NULL, NULL, NULL, &length, NULL, NULL, NULL, NULL)) == FAIL)
         HERROR(DFE_INTERNAL);
 
     if (Hendaccess(access_id) == FAIL)
@@ -1668,7 +1896,7 @@ Hlength(int32 file_id, uint16 tag, uint16 ref)
 
 done:
     return ret_value;
-} /* end Hlength */
+} /* end Hlength64 */
 
 /*--------------------------------------------------------------------------
 NAME
@@ -1695,9 +1923,43 @@ DESCRIPTION
 int32
 Hoffset(int32 file_id, uint16 tag, uint16 ref)
 {
-    int32 access_id;        /* access record id */
-    int32 offset    = FAIL; /* offset of elt inquired */
-    int32 ret_value = SUCCEED;
+    hdf_off_t offset;
+    int32     ret_value = SUCCEED;
+
+    if ((offset = Hoffset64(file_id, tag, ref)) == FAIL)
+        HGOTO_DONE(FAIL);
+
+    /* Offsets past 2 GiB can only be reported by Hoffset64 */
+    if (offset > INT32_MAX)
+        HGOTO_ERROR(DFE_RANGE, FAIL);
+
+    ret_value = (int32)offset;
+
+done:
+    return ret_value;
+} /* Hoffset */
+
+/*--------------------------------------------------------------------------
+NAME
+   Hoffset64 -- get the 64-bit offset of a data element in the file
+USAGE
+   hdf_off_t Hoffset64(fileid, tag, ref)
+   int32 fileid;           IN: id of file
+   uint16 tag;             IN: tag of data element
+   uint16 ref;             IN: ref of data element
+RETURNS
+   returns offset of data element if it is present in the
+   file or FAIL (-1) if it is not.
+DESCRIPTION
+   Same as Hoffset, for elements stored past 2 GiB in the file.
+
+--------------------------------------------------------------------------*/
+hdf_off_t
+Hoffset64(int32 file_id, uint16 tag, uint16 ref)
+{
+    int32     access_id;        /* access record id */
+    hdf_off_t offset    = FAIL; /* offset of elt inquired */
+    hdf_off_t ret_value = SUCCEED;
 
     /* clear error stack */
     HEclear();
@@ -1707,7 +1969,7 @@ Hoffset(int32 file_id, uint16 tag, uint16 ref)
     if (access_id == FAIL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
-    if ((ret_value = HQueryoffset(access_id, &offset)) == FAIL)
+    if ((ret_value = Hinquire64(access_id, NULL, NULL, NULL, NULL, &offset, NULL, NULL, NULL)) == FAIL)
         HERROR(DFE_INTERNAL);
 
     if (Hendaccess(access_id) == FAIL)
@@ -1717,7 +1979,7 @@ Hoffset(int32 file_id, uint16 tag, uint16 ref)
 
 done:
     return ret_value;
-} /* Hoffset */
+} /* Hoffset64 */
 
 /*--------------------------------------------------------------------------
 NAME
@@ -1737,21 +1999,22 @@ DESCRIPTION
 int
 Hishdf(const char *filename)
 {
-    int        ret;
-    hdf_file_t fp;
-    int        ret_value = TRUE;
+    const hdf_fdriver_t *driver = HPget_fdriver(DFDRV_STDIO);
+    hdf_fhandle_t        fh;
+    int                  ret;
+    int                  ret_value = TRUE;
 
     /* Search for a matching slot in the already open files. */
     if (HAsearch_atom(FIDGROUP, HPcompare_filerec_path, filename) != NULL)
         HGOTO_DONE(TRUE);
 
-    fp = (hdf_file_t)HI_OPEN(filename, DFACC_READ);
-    if (OPENERR(fp)) {
+    HPinit_fhandle(&fh);
+    if (driver->open(&fh, filename, DFACC_READ) == FAIL) {
         ret_value = FALSE;
     }
     else {
-        ret = HIvalid_magic(fp);
-        HI_CLOSE(fp);
+        ret = HIvalid_magic(driver, &fh);
+        driver->close(&fh);
         ret_value = (int)ret;
     }
 
@@ -1776,10 +2039,11 @@ DESCRIPTION
 int32
 Htrunc(int32 aid, int32 trunc_len)
 {
-    accrec_t *access_rec; /* access record */
-    int32     data_len;   /* length of the data we are checking */
-    int32     data_off;   /* offset of the data we are checking */
-    int32     ret_value = SUCCEED;
+    accrec_t  *access_rec;        /* access record */
+    hdf_off_t  data_len;          /* length of the data we are checking */
+    hdf_off_t  data_off;          /* offset of the data we are checking */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int32      ret_value  = SUCCEED;
 
     /* clear error stack and check validity of access id */
     HEclear();
@@ -1787,6 +2051,8 @@ Htrunc(int32 aid, int32 trunc_len)
     if (access_rec == (accrec_t *)NULL || !(access_rec->access & DFACC_WRITE))
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(access_rec->file_id);
+
         /* Dunno about truncating special elements... -QAK */
 #ifdef DONT_KNOW
     /* if special elt, call special function */
@@ -1815,6 +2081,7 @@ Htrunc(int32 aid, int32 trunc_len)
         HGOTO_ERROR(DFE_BADLEN, FAIL);
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* end Htrunc() */
 
@@ -1874,19 +2141,23 @@ NOTE
 int
 Hsync(int32 file_id)
 {
-    filerec_t *file_rec; /* file record */
-    int        ret_value = SUCCEED;
+    filerec_t *file_rec;          /* file record */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     /* check validity of file record and get dd ptr */
     file_rec = HAatom_object(file_id);
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
+    locked_rec = HPlock_file(file_id);
+
     /* check whether to flush the file info */
     if (HIsync(file_rec) == FAIL)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* Hsync */
 
@@ -1907,8 +2178,9 @@ DESCRIPTION
 int
 Hcache(int32 file_id, int cache_on)
 {
-    filerec_t *file_rec; /* file record */
-    int        ret_value = SUCCEED;
+    filerec_t *file_rec;          /* file record */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     if (file_id == CACHE_ALL_FILES) /* check whether to modify the default cache */
     {                               /* set the default caching for all further files Hopen'ed */
@@ -1920,6 +2192,8 @@ Hcache(int32 file_id, int cache_on)
         if (BADFREC(file_rec))
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
+        locked_rec = HPlock_file(file_id);
+
         /* check whether to flush the file info */
         if (cache_on == FALSE && file_rec->cache) {
             if (HIsync(file_rec) == FAIL)
@@ -1929,9 +2203,117 @@ Hcache(int32 file_id, int cache_on)
     } /* end else */
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* Hcache */
 
+/*--------------------------------------------------------------------------
+NAME
+   Hsetfiledriver -- set the low-level file driver for subsequent opens
+USAGE
+   int Hsetfiledriver(driver)
+           int driver;              IN: DFDRV_xxx code of the driver
+RETURNS
+   returns SUCCEED (0) if successful, FAIL (-1) otherwise
+DESCRIPTION
+   Selects how raw bytes are moved to and from HDF files opened by
+   later calls to Hopen.  Files that are already open keep their driver.
+
+   DFDRV_STDIO   - buffered C stdio, the default
+   DFDRV_POSIX   - positional pread/pwrite with no user-space buffering
+   DFDRV_MMAP    - files opened read-only are mapped into memory; files
+                   opened for writing use DFDRV_POSIX instead
+
+   Fails with DFE_UNSUPPORTED if the driver is not available on this
+   platform.
+--------------------------------------------------------------------------*/
+int
+Hsetfiledriver(int driver)
+{
+    int ret_value = SUCCEED;
+
+    HEclear();
+
+    if (HPget_fdriver(driver) == NULL)
+        HGOTO_ERROR(DFE_UNSUPPORTED, FAIL);
+
+    default_fdriver = driver;
+
+done:
+    return ret_value;
+} /* Hsetfiledriver */
+
+/*--------------------------------------------------------------------------
+NAME
+   Hgetfiledriver -- get the low-level file driver used by a file
+USAGE
+   int Hgetfiledriver(file_id)
+           int32 file_id;           IN: id of file
+RETURNS
+   returns the DFDRV_xxx code of the driver if successful, FAIL (-1)
+   otherwise
+DESCRIPTION
+   The driver may differ from the one set by Hsetfiledriver when the
+   requested driver cannot write and the file was opened for writing.
+--------------------------------------------------------------------------*/
+int
+Hgetfiledriver(int32 file_id)
+{
+    filerec_t *file_rec; /* file record */
+    int        ret_value = FAIL;
+
+    HEclear();
+
+    file_rec = HAatom_object(file_id);
+    if (BADFREC(file_rec))
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    ret_value = file_rec->driver->type;
+
+done:
+    return ret_value;
+} /* Hgetfiledriver */
+
+/*--------------------------------------------------------------------------
+NAME
+   Hsetddload -- set how the DD list is read in for subsequent opens
+USAGE
+   int Hsetddload(mode)
+           int mode;                IN: DFDDL_xxx loading mode
+RETURNS
+   returns SUCCEED (0) if successful, FAIL (-1) otherwise
+DESCRIPTION
+   Selects how files opened by later calls to Hopen read in their DD
+   list.  Files that are already open are not affected.
+
+   DFDDL_ALL     - the whole DD list is read in by Hopen, the default
+   DFDDL_LAZY    - files opened read-only only read the first DD block in
+                   Hopen.  Later DD blocks are read when a lookup of a
+                   tag/ref doesn't find it in the blocks read so far, and
+                   the rest of the DD list is read the first time a
+                   search, count or new ref needs all of it.  Files
+                   opened for writing read the whole DD list.
+
+   Lazy loading suits opening many files to read a few objects from each.
+   A damaged DD block is then only noticed when it is read, rather than
+   failing Hopen.
+--------------------------------------------------------------------------*/
+int
+Hsetddload(int mode)
+{
+    int ret_value = SUCCEED;
+
+    HEclear();
+
+    if (mode != DFDDL_ALL && mode != DFDDL_LAZY)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    default_ddload = mode;
+
+done:
+    return ret_value;
+} /* Hsetddload */
+
 /*--------------------------------------------------------------------------
 NAME
    HDvalidfid -- check if a file ID is valid
@@ -2095,6 +2477,32 @@ done:
     return ret_value;
 } /* end HIstart() */
 
+/*--------------------------------------------------------------------------
+ NAME
+    HIstart_once
+ PURPOSE
+    Call HIstart if it hasn't been called yet
+ USAGE
+    int HIstart_once()
+ RETURNS
+    Returns SUCCEED/FAIL
+ DESCRIPTION
+    The check is made under the registry lock, so that two threads can't
+    both start the library.
+--------------------------------------------------------------------------*/
+static int
+HIstart_once(void)
+{
+    int ret_value = SUCCEED;
+
+    HTS_REGISTRY_LOCK();
+    if (library_terminate == FALSE)
+        ret_value = HIstart();
+    HTS_REGISTRY_UNLOCK();
+
+    return ret_value;
+} /* end HIstart_once() */
+
 /*--------------------------------------------------------------------------
  NAME
     HPregister_term_func
@@ -2108,7 +2516,9 @@ done:
     Returns SUCCEED/FAIL
  DESCRIPTION
     Adds routines to the linked-list of routines to call when terminating the
-    library.
+    library.  A routine which is already in the list isn't added again, so
+    that threads racing to start the same interface only register its
+    shutdown routine once.
  COMMENTS, BUGS, ASSUMPTIONS
     Should only ever be called by the "atexit" function, or real power-users.
 --------------------------------------------------------------------------*/
@@ -2117,14 +2527,21 @@ HPregister_term_func(hdf_termfunc_t term_func)
 {
     int ret_value = SUCCEED;
 
-    if (library_terminate == FALSE)
-        if (HIstart() == FAIL)
-            HGOTO_ERROR(DFE_CANTINIT, FAIL);
+    if (HIstart_once() == FAIL)
+        HRETURN_ERROR(DFE_CANTINIT, FAIL);
+
+    HTS_REGISTRY_LOCK();
+
+    if (atexit_functions != NULL)
+        for (size_t i = 0; i < atexit_functions->n_functions; i++)
+            if (atexit_functions->functions[i] == term_func)
+                HGOTO_DONE(SUCCEED);
 
     if (hfile_atexit_add(atexit_functions, term_func) < 0)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
 done:
+    HTS_REGISTRY_UNLOCK();
     return ret_value;
 } /* end HPregister_term_func() */
 
@@ -2159,6 +2576,7 @@ HPend(void)
     HPbitshutdown();
     HXPshutdown();
     Hshutdown();
+    HTSend_jobs();
     HEshutdown();
     HAshutdown();
     tbbt_shutdown();
@@ -2211,7 +2629,7 @@ HIget_function_table(accrec_t *access_rec)
     int16       spec_code;
     uint8       lbuf[4];          /* temporary buffer */
     uint8      *p;                /* tmp buf ptr */
-    int32       data_off;         /* offset of the data we are checking */
+    hdf_off_t   data_off;         /* offset of the data we are checking */
     int         i;                /* loop index */
     funclist_t *ret_value = NULL; /* FAIL */
 
@@ -2289,6 +2707,54 @@ HIunlock(filerec_t *file_rec)
     return SUCCEED;
 }
 
+#ifdef H4_HAVE_THREADSAFE
+/*--------------------------------------------------------------------------
+ NAME
+       HPlock_file -- take the lock of an open file
+ USAGE
+       filerec_t *HPlock_file(file_id)
+       int32 file_id;               IN: ID of the file to lock
+ RETURNS
+       The file record which was locked, or NULL if file_id isn't valid
+ DESCRIPTION
+       The lock is recursive, so routines which call each other can each
+       take it.  Pass the returned file record to HPunlock_file when done.
+       When the library isn't built thread-safe, this is a macro which
+       evaluates to NULL.
+--------------------------------------------------------------------------*/
+filerec_t *
+HPlock_file(int32 file_id)
+{
+    filerec_t *file_rec = HAatom_object(file_id);
+
+    if (file_rec == NULL)
+        return NULL;
+
+    /* Hclose changes the refcount under the lock, so check it after taking the lock */
+    HFILE_LOCK(file_rec);
+    if (file_rec->refcount == 0) {
+        HFILE_UNLOCK(file_rec);
+        return NULL;
+    }
+
+    return file_rec;
+} /* HPlock_file */
+
+/*--------------------------------------------------------------------------
+ NAME
+       HPunlock_file -- release the lock taken by HPlock_file
+ USAGE
+       void HPunlock_file(file_rec)
+       filerec_t *file_rec;         IN: file record to unlock, may be NULL
+--------------------------------------------------------------------------*/
+void
+HPunlock_file(filerec_t *file_rec)
+{
+    if (file_rec != NULL)
+        HFILE_UNLOCK(file_rec);
+} /* HPunlock_file */
+#endif /* H4_HAVE_THREADSAFE */
+
 /* ------------------------- SPECIAL TAG ROUTINES ------------------------- */
 /*
    The HDF tag space is divided as follows based on the 2 highest bits:
@@ -2550,8 +3016,18 @@ HIget_filerec_node(const char *path)
         if ((ret_value = (filerec_t *)calloc(1, sizeof(filerec_t))) == NULL)
             HGOTO_ERROR(DFE_NOSPACE, NULL);
 
-        if ((ret_value->path = (char *)strdup(path)) == NULL)
+        if ((ret_value->path = (char *)strdup(path)) == NULL) {
+            free(ret_value);
             HGOTO_ERROR(DFE_NOSPACE, NULL);
+        }
+
+#ifdef H4_HAVE_THREADSAFE
+        if (HTSmutex_init(&ret_value->lock) == FAIL) {
+            free(ret_value->path);
+            free(ret_value);
+            HGOTO_ERROR(DFE_INTERNAL, NULL);
+        }
+#endif
 
         /* Initialize annotation stuff */
         ret_value->an_tree[AN_DATA_LABEL] = NULL;
@@ -2583,11 +3059,14 @@ done:
 static int
 HIrelease_filerec_node(filerec_t *file_rec)
 {
-    /* Close file if it's opened */
-    if (file_rec->file != NULL)
-        HI_CLOSE(file_rec->file);
+    /* Close file if it's opened (driver close routines ignore unopened handles) */
+    if (file_rec->driver != NULL)
+        file_rec->driver->close(&file_rec->fh);
 
     /* Free all the components of the file record */
+#ifdef H4_HAVE_THREADSAFE
+    HTSmutex_destroy(&file_rec->lock);
+#endif
     free(file_rec->path);
     free(file_rec);
 
@@ -2619,7 +3098,7 @@ HPisfile_in_use(const char *path)
     /* If the file is not found, it can't be in use, return FALSE */
     if (file_rec == NULL)
         ret_value = FALSE;
-    else if (file_rec->refcount) /* file is in use if ref count is not 0 */
+    else if (HFILE_REFCOUNT(file_rec)) /* file is in use if ref count is not 0 */
         ret_value = TRUE;
 
     return ret_value;
@@ -2701,27 +3180,28 @@ done:
  NAME
        HIvalid_magic -- verify the magic number in a file
  USAGE
-       int32 HIvalid_magic(path)
-       hdf_file_t file;             IN: FILE pointer
+       int32 HIvalid_magic(driver, fh)
+       const hdf_fdriver_t *driver; IN: driver the file was opened with
+       hdf_fhandle_t *fh;           IN: driver handle of the open file
  RETURNS
        TRUE if valid magic number else FALSE
  DESCRIPTION
-       Given an open file pointer, see if the first four bytes of the
+       Given an open file, see if the first four bytes of the
        file are the HDF "magic number" HDFMAGIC
 
 --------------------------------------------------------------------------*/
 static int
-HIvalid_magic(hdf_file_t file)
+HIvalid_magic(const hdf_fdriver_t *driver, hdf_fhandle_t *fh)
 {
     char b[MAGICLEN];       /* Temporary buffer */
     int  ret_value = FALSE; /* FAIL */
 
     /* Seek to beginning of the file. */
-    if (HI_SEEK(file, 0) == FAIL)
+    if (driver->seek != NULL && driver->seek(fh, 0) == FAIL)
         HGOTO_ERROR(DFE_SEEKERROR, FALSE);
 
     /* Read in magic cookie and compare. */
-    if (HI_READ(file, b, MAGICLEN) == FAIL)
+    if (driver->read(fh, 0, b, MAGICLEN) == FAIL)
         HGOTO_ERROR(DFE_READERROR, FALSE);
 
     if (NSTREQ(b, HDFMAGIC, MAGICLEN))
@@ -2749,12 +3229,15 @@ HIget_access_rec(void)
 
     HEclear();
 
+#ifndef H4_HAVE_THREADSAFE
     /* Grab from free list if possible */
     if (accrec_free_list != NULL) {
         ret_value        = accrec_free_list;
         accrec_free_list = accrec_free_list->next;
     } /* end if */
-    else {
+    else
+#endif /* H4_HAVE_THREADSAFE */
+    {
         if ((ret_value = (accrec_t *)malloc(sizeof(accrec_t))) == NULL)
             HGOTO_ERROR(DFE_NOSPACE, NULL);
     } /* end else */
@@ -2780,9 +3263,14 @@ done:
 void
 HIrelease_accrec_node(accrec_t *acc)
 {
+#ifdef H4_HAVE_THREADSAFE
+    /* the free list isn't shared between threads */
+    free(acc);
+#else
     /* Insert the atom at the beginning of the free list */
     acc->next        = accrec_free_list;
     accrec_free_list = acc;
+#endif /* H4_HAVE_THREADSAFE */
 } /* end HIrelease_accrec_node() */
 
 /*--------------------------------------------------------------------------
@@ -2898,7 +3386,7 @@ done:
 NAME
    HPgetdiskblock --- Get the offset of a free block in the file.
 USAGE
-   int32 HPgetdiskblock(file_rec, block_size)
+   hdf_off_t HPgetdiskblock(file_rec, block_size)
    filerec_t *file_rec;     IN: ptr to the file record
    int32 block_size;        IN: size of the block needed
    int moveto;             IN: whether to move the file position
@@ -2913,16 +3401,20 @@ DESCRIPTION
    blocks in the file and dole those out.
 
 -------------------------------------------------------------------------*/
-int32
+hdf_off_t
 HPgetdiskblock(filerec_t *file_rec, int32 block_size, int moveto)
 {
-    uint8 temp;
-    int32 ret_value = SUCCEED;
+    uint8     temp;
+    hdf_off_t ret_value = SUCCEED;
 
     /* check for valid arguments */
     if (file_rec == NULL || block_size < 0)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    /* the block must end at an offset that can still be recorded in a DD */
+    if (file_rec->f_end_off + block_size > MAX_DD_OFFSET)
+        HGOTO_ERROR(DFE_EXCEEDMAX, FAIL);
+
 #ifdef DISKBLOCK_DEBUG
     block_size += (DISKBLOCK_HSIZE + DISKBLOCK_TSIZE);
     /* get the offset of the allocated block */
@@ -2978,8 +3470,8 @@ NAME
 USAGE
    int HPfreediskblock(file_rec, block_off, block_size)
    filerec_t *file_rec;     IN: ptr to the file record
-   int32 block_off;         IN: offset of the block to release
-   int32 block_size;        IN: size of the block to release
+   hdf_off_t block_off;     IN: offset of the block to release
+   hdf_off_t block_size;    IN: size of the block to release
 RETURNS
    returns SUCCEED (0) if successful, FAIL (-1) if failed.
 DESCRIPTION
@@ -2989,7 +3481,7 @@ DESCRIPTION
 
 -------------------------------------------------------------------------*/
 int
-HPfreediskblock(filerec_t *file_rec, int32 block_off, int32 block_size)
+HPfreediskblock(filerec_t *file_rec, hdf_off_t block_off, hdf_off_t block_size)
 {
     int ret_value = SUCCEED;
 
@@ -3019,8 +3511,9 @@ HPfreediskblock(filerec_t *file_rec, int32 block_off, int32 block_size)
 int32
 HDget_special_info(int32 access_id, sp_info_block_t *info_block)
 {
-    accrec_t *access_rec; /* access record */
-    int32     ret_value = FAIL;
+    accrec_t  *access_rec;        /* access record */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int32      ret_value  = FAIL;
 
     /* clear error stack and check validity of access id */
     HEclear();
@@ -3028,6 +3521,8 @@ HDget_special_info(int32 access_id, sp_info_block_t *info_block)
     if (access_rec == (accrec_t *)NULL || info_block == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(access_rec->file_id);
+
     /* special elt, so call special function */
     if (access_rec->special)
         ret_value = (*access_rec->special_func->info)(access_rec, info_block);
@@ -3035,6 +3530,7 @@ HDget_special_info(int32 access_id, sp_info_block_t *info_block)
         info_block->key = FAIL;
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* HDget_special_info */
 
@@ -3059,8 +3555,9 @@ done:
 int32
 HDset_special_info(int32 access_id, sp_info_block_t *info_block)
 {
-    accrec_t *access_rec; /* access record */
-    int32     ret_value = FAIL;
+    accrec_t  *access_rec;        /* access record */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int32      ret_value  = FAIL;
 
     /* clear error stack and check validity of access id */
     HEclear();
@@ -3068,12 +3565,15 @@ HDset_special_info(int32 access_id, sp_info_block_t *info_block)
     if (access_rec == (accrec_t *)NULL || info_block == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(access_rec->file_id);
+
     /* special elt, so call special function */
     if (access_rec->special)
         ret_value = (*access_rec->special_func->reset)(access_rec, info_block);
 
     /* else is not special so fail */
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* HDset_special_info */
 
@@ -3133,7 +3633,7 @@ Hdumpseek(void)
  NAME
     HP_read
  PURPOSE
-    Alias for HI_READ on HDF files.
+    Read from the current position of an HDF file.
  USAGE
     int HP_read(file_rec,buf,bytes)
         filerec_t * file_rec;   IN: Pointer to the HDF file record
@@ -3142,7 +3642,7 @@ Hdumpseek(void)
  RETURNS
     Returns SUCCEED/FAIL
  DESCRIPTION
-    Function to wrap around HI_READ
+    Function to wrap around the read routine of the file's driver
  GLOBAL VARIABLES
  COMMENTS, BUGS, ASSUMPTIONS
     Should only be called by HDF low-level routines
@@ -3164,7 +3664,7 @@ HP_read(filerec_t *file_rec, void *buf, int32 bytes)
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
     } /* end if */
 
-    if (HI_READ(file_rec->file, buf, bytes) == FAIL)
+    if (file_rec->driver->read(&file_rec->fh, file_rec->f_cur_off, buf, bytes) == FAIL)
         HGOTO_ERROR(DFE_READERROR, FAIL);
     file_rec->f_cur_off += bytes;
     file_rec->last_op = H4_OP_READ;
@@ -3172,19 +3672,116 @@ done:
     return ret_value;
 } /* end HP_read() */
 
+/* Orders the pieces of a vectored read by their offsets in the file */
+static int
+HIcompare_extents(const void *a, const void *b)
+{
+    hdf_off_t off_a = ((const hdf_extent_t *)a)->offset;
+    hdf_off_t off_b = ((const hdf_extent_t *)b)->offset;
+
+    return off_a < off_b ? -1 : off_a > off_b;
+} /* HIcompare_extents */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HP_readv
+ PURPOSE
+    Read pieces of an HDF file from many places at once.
+ USAGE
+    int HP_readv(file_rec,ext,n)
+        filerec_t * file_rec;   IN: Pointer to the HDF file record
+        hdf_extent_t * ext;     IN/OUT: pieces to read; sorted by offset
+        int n;                  IN: # of pieces
+ RETURNS
+    Returns SUCCEED/FAIL
+ DESCRIPTION
+    Sorts the pieces by their offsets in the file, then reads the pieces
+    which follow each other, or are separated by holes of no more than
+    HDF_READV_GAP bytes, with one call to the driver's vectored read
+    routine.  The bytes of the holes are read and thrown away.  Drivers
+    without a vectored read routine read the pieces one at a time, but
+    still without seeking between them.
+ GLOBAL VARIABLES
+ COMMENTS, BUGS, ASSUMPTIONS
+    Should only be called by HDF low-level routines.  The pieces must not
+    overlap in the file or in memory.
+ EXAMPLES
+ REVISION LOG
+--------------------------------------------------------------------------*/
+int
+HP_readv(filerec_t *file_rec, hdf_extent_t *ext, int n)
+{
+    hdf_extent_t *run       = NULL; /* pieces of one read, with the holes between them */
+    uint8        *hole      = NULL; /* where the bytes of the holes go */
+    int           ret_value = SUCCEED;
+
+    if (n <= 0)
+        HGOTO_DONE(SUCCEED);
+
+    qsort(ext, (size_t)n, sizeof(hdf_extent_t), HIcompare_extents);
+    if (NULL == (run = (hdf_extent_t *)malloc((size_t)(2 * n) * sizeof(hdf_extent_t))))
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+
+    for (int i = 0; i < n;) {
+        hdf_off_t end  = ext[i].offset; /* end of the read so far */
+        int       nrun = 0;             /* # of pieces in the read */
+
+        /* collect the pieces close enough to read together */
+        do {
+            if (ext[i].len > 0) {
+                if (ext[i].offset > end) {
+                    if (hole == NULL && NULL == (hole = (uint8 *)malloc(HDF_READV_GAP)))
+                        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+                    run[nrun].offset = end;
+                    run[nrun].len    = (int32)(ext[i].offset - end);
+                    run[nrun].buf    = hole;
+                    nrun++;
+                }
+                run[nrun++] = ext[i];
+                end         = ext[i].offset + ext[i].len;
+            }
+            i++;
+        } while (i < n && ext[i].offset >= end && ext[i].offset - end <= HDF_READV_GAP);
+        if (nrun == 0)
+            continue;
+
+        /* a read after a write has to seek */
+        if (file_rec->last_op == H4_OP_WRITE)
+            file_rec->last_op = H4_OP_UNKNOWN;
+        if (HPseek(file_rec, run[0].offset) == FAIL)
+            HGOTO_ERROR(DFE_SEEKERROR, FAIL);
+
+        if (file_rec->driver->readv != NULL) {
+            if (file_rec->driver->readv(&file_rec->fh, run, nrun) == FAIL)
+                HGOTO_ERROR(DFE_READERROR, FAIL);
+            file_rec->f_cur_off = end;
+            file_rec->last_op   = H4_OP_READ;
+        }
+        else
+            for (int j = 0; j < nrun; j++)
+                if (HP_read(file_rec, run[j].buf, run[j].len) == FAIL)
+                    HGOTO_ERROR(DFE_READERROR, FAIL);
+    }
+
+done:
+    free(run);
+    free(hole);
+    return ret_value;
+} /* end HP_readv() */
+
 /*--------------------------------------------------------------------------
  NAME
     HPseek
  PURPOSE
-    Alias for HI_SEEK on HDF files.
+    Set the current position of an HDF file.
  USAGE
     int HPseek(file_rec,offset)
         filerec_t * file_rec;   IN: Pointer to the HDF file record
-        int32 offset;           IN: offset in the file to go to
+        hdf_off_t offset;       IN: offset in the file to go to
  RETURNS
     Returns SUCCEED/FAIL
  DESCRIPTION
-    Function to wrap around HI_SEEK
+    Function to wrap around the seek routine of the file's driver
  GLOBAL VARIABLES
  COMMENTS, BUGS, ASSUMPTIONS
     Should only be called by HDF low-level routines
@@ -3192,7 +3789,7 @@ done:
  REVISION LOG
 --------------------------------------------------------------------------*/
 int
-HPseek(filerec_t *file_rec, int32 offset)
+HPseek(filerec_t *file_rec, hdf_off_t offset)
 {
     int ret_value = SUCCEED;
 
@@ -3205,7 +3802,8 @@ HPseek(filerec_t *file_rec, int32 offset)
         seek_taken++;
         printf(" taken: %d\n", (int)seek_taken);
 #endif /* HFILE_SEEKINFO */
-        if (HI_SEEK(file_rec->file, offset) == FAIL)
+        /* Positional drivers only need to remember the offset */
+        if (file_rec->driver->seek != NULL && file_rec->driver->seek(&file_rec->fh, offset) == FAIL)
             HGOTO_ERROR(DFE_SEEKERROR, FAIL);
         file_rec->f_cur_off = offset;
         file_rec->last_op   = H4_OP_SEEK;
@@ -3225,7 +3823,7 @@ done:
  NAME
     HP_write
  PURPOSE
-    Alias for HI_WRITE on HDF files.
+    Write at the current position of an HDF file.
  USAGE
     int HP_write(file_rec,buf,bytes)
         filerec_t * file_rec;   IN: Pointer to the HDF file record
@@ -3234,7 +3832,7 @@ done:
  RETURNS
     Returns SUCCEED/FAIL
  DESCRIPTION
-    Function to wrap around HI_WRITE
+    Function to wrap around the write routine of the file's driver
  GLOBAL VARIABLES
  COMMENTS, BUGS, ASSUMPTIONS
     Should only be called by HDF low-level routines
@@ -3256,7 +3854,9 @@ HP_write(filerec_t *file_rec, const void *buf, int32 bytes)
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
     }
 
-    if (HI_WRITE(file_rec->file, buf, bytes) == FAIL)
+    if (file_rec->driver->write == NULL)
+        HGOTO_ERROR(DFE_DENIED, FAIL);
+    if (file_rec->driver->write(&file_rec->fh, file_rec->f_cur_off, buf, bytes) == FAIL)
         HGOTO_ERROR(DFE_WRITEERROR, FAIL);
     file_rec->f_cur_off += bytes;
     file_rec->last_op = H4_OP_WRITE;
@@ -3288,16 +3888,16 @@ done:
 int32
 HPread_drec(int32 file_id, atom_t data_id, uint8 **drec_buf)
 {
-    int32  drec_len = 0;       /* length of the description record */
-    int32  drec_aid = -1;      /* description record access id */
-    uint16 drec_tag, drec_ref; /* description record tag/ref */
-    int32  ret_value = 0;
+    hdf_off_t drec_len = 0;       /* length of the description record */
+    int32     drec_aid = -1;      /* description record access id */
+    uint16    drec_tag, drec_ref; /* description record tag/ref */
+    int32     ret_value = 0;
 
     /* get the info for the dataset (description record) */
     if (HTPinquire(data_id, &drec_tag, &drec_ref, NULL, &drec_len) == FAIL)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
-    if (drec_len < 0)
+    if (drec_len < 0 || drec_len > INT32_MAX)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
     if ((*drec_buf = (uint8 *)malloc((size_t)drec_len)) == NULL)
         HGOTO_ERROR(DFE_NOSPACE, FAIL);
@@ -3311,7 +3911,7 @@ HPread_drec(int32 file_id, atom_t data_id, uint8 **drec_buf)
     if (Hendaccess(drec_aid) == FAIL)
         HGOTO_ERROR(DFE_CANTENDACCESS, FAIL);
 
-    ret_value = drec_len;
+    ret_value = (int32)drec_len;
 
 done:
     return ret_value;
@@ -3353,7 +3953,8 @@ HDcheck_empty(int32 file_id, uint16 tag, uint16 ref, int *emptySDS /* TRUE if da
     atom_t     data_id = FAIL; /* dd ID of existing regular element */
     filerec_t *file_rec;       /* file record pointer */
     uint8     *local_ptbuf = NULL, *p;
-    int16      sptag       = -1; /* special tag read from desc record */
+    int16      sptag       = -1;   /* special tag read from desc record */
+    filerec_t *locked_rec  = NULL; /* file record locked here */
     int32      ret_value   = SUCCEED;
 
     /* clear error stack */
@@ -3364,9 +3965,11 @@ HDcheck_empty(int32 file_id, uint16 tag, uint16 ref, int *emptySDS /* TRUE if da
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(file_id);
+
     /* get access element from dataset's tag/ref */
     if ((data_id = HTPselect(file_rec, tag, ref)) != FAIL) {
-        int32 dlen = 0, doff = 0; /* offset/length of the description record */
+        hdf_off_t dlen = 0, doff = 0; /* offset/length of the description record */
 
         /* Get the info pointed to by this dd, which could point to data or
            description record, or neither */
@@ -3449,6 +4052,7 @@ HDcheck_empty(int32 file_id, uint16 tag, uint16 ref, int *emptySDS /* TRUE if da
     }
 
 done:
+    HPunlock_file(locked_rec);
     free(local_ptbuf);
 
     return ret_value;
@@ -26,6 +26,7 @@
 #include "bitvect_priv.h"
 #include "atom_priv.h"
 #include "dynarray_priv.h"
+#include "hthread_priv.h"
 
 /* Magic cookie for HDF data files */
 #define MAGICLEN 4                  /* length */
@@ -44,6 +45,11 @@
 #define INVALID_OFFSET -1
 #define INVALID_LENGTH -1
 
+/* Offsets and lengths are stored in a DD as 32-bit unsigned integers, with
+   all bits set reserved for INVALID_OFFSET/INVALID_LENGTH.  This is the
+   largest offset or length that can be recorded in a DD. */
+#define MAX_DD_OFFSET ((hdf_off_t)0xFFFFFFFE)
+
 /* #define DISKBLOCK_DEBUG */
 #ifdef DISKBLOCK_DEBUG
 
@@ -92,6 +98,58 @@ typedef int hdf_file_t;
 #define OPENERR(f)        (f < 0)
 #endif /* FILELIB == UNIXUNBUFIO */
 
+/* -------------------------- Low-level File Drivers ---------------------- */
+/* The HI_xxx macros above are still used for auxiliary files (external
+   elements, netCDF/CDF files, etc.).  HDF files themselves are accessed
+   through a driver table kept in the file record, so the way raw bytes
+   are moved can be picked at Hopen time (see Hsetfiledriver):
+
+   DFDRV_STDIO -- C buffered I/O, seek + fread/fwrite (the historic default)
+   DFDRV_POSIX -- positional pread/pwrite on a file descriptor; there is no
+                  shared seek pointer and no user-space double buffering
+   DFDRV_MMAP  -- the whole file is mapped read-only and reads are memcpy's
+                  out of the mapping.  Files opened for writing fall back to
+                  the POSIX (or stdio) driver.
+*/
+
+/* Driver-specific state for an open file.  Only the members used by the
+   driver that opened the file are meaningful. */
+typedef struct hdf_fhandle_t {
+    FILE  *fp;       /* stdio stream (DFDRV_STDIO) */
+    int    fd;       /* file descriptor (DFDRV_POSIX) */
+    uint8 *map;      /* base of the read-only mapping (DFDRV_MMAP) */
+    size_t map_size; /* size of the mapping in bytes (DFDRV_MMAP) */
+} hdf_fhandle_t;
+
+/* One piece of a vectored read: 'len' bytes at 'offset' in the file are
+   read into 'buf' (see HP_readv) */
+typedef struct hdf_extent_t {
+    hdf_off_t offset; /* offset in the file */
+    int32     len;    /* # of bytes */
+    void     *buf;    /* where the bytes go */
+} hdf_extent_t;
+
+/* Table of functions implementing a low-level file driver.  Drivers without
+   a file position (positional I/O) leave 'seek' NULL and honor the offset
+   passed to 'read' and 'write'; stream drivers are positioned by 'seek'
+   before each read or write and may ignore the offset.  Read-only drivers
+   leave 'create' and 'write' NULL.  'readv' reads pieces which follow each
+   other in the file, starting at the offset of the first, with one system
+   call; drivers without it leave it NULL and the pieces are read one at a
+   time. */
+typedef struct hdf_fdriver_t {
+    int         type; /* DFDRV_xxx code of this driver */
+    const char *name; /* name of the driver, for debugging */
+    int (*open)(hdf_fhandle_t *fh, const char *path, int acc_mode);
+    int (*create)(hdf_fhandle_t *fh, const char *path);
+    int (*close)(hdf_fhandle_t *fh);
+    int (*flush)(hdf_fhandle_t *fh);
+    int (*seek)(hdf_fhandle_t *fh, hdf_off_t offset);
+    int (*read)(hdf_fhandle_t *fh, hdf_off_t offset, void *buf, int32 bytes);
+    int (*write)(hdf_fhandle_t *fh, hdf_off_t offset, const void *buf, int32 bytes);
+    int (*readv)(hdf_fhandle_t *fh, const hdf_extent_t *ext, int n);
+} hdf_fdriver_t;
+
 /* ----------------------- Internal Data Structures ----------------------- */
 /* The internal structure used to keep track of the files opened: an
    array of filerec_t structures, each has a linked list of ddblock_t.
@@ -181,8 +239,8 @@ typedef int hdf_file_t;
 typedef struct dd_t {
     uint16            tag;    /* Tag number of element i.e. type of data */
     uint16            ref;    /* Reference number of element */
-    int32             length; /* length of data element */
-    int32             offset; /* byte offset of data element from */
+    hdf_off_t         length; /* length of data element */
+    hdf_off_t         offset; /* byte offset of data element from */
     struct ddblock_t *blk;    /* Pointer to the block this dd is in */
 } /* beginning of file */
 dd_t;
@@ -199,21 +257,25 @@ typedef struct version_t {
 /* record of a block of data descriptors, mirrors structure of a HDF file.  */
 typedef struct ddblock_t {
     unsigned          dirty;      /* boolean: should this DD block be flushed? */
-    int32             myoffset;   /* offset of this DD block in the file */
+    hdf_off_t         myoffset;   /* offset of this DD block in the file */
     int16             ndds;       /* number of dd's in this block */
-    int32             nextoffset; /* offset to the next ddblock in the file */
+    hdf_off_t         nextoffset; /* offset to the next ddblock in the file */
     struct filerec_t *frec;       /* Pointer to the filerec this block is in */
     struct ddblock_t *next;       /* pointer to the next ddblock in memory */
     struct ddblock_t *prev;       /* Pointer to previous ddblock. */
     struct dd_t      *ddlist;     /* pointer to array of dd's */
+    int32             seq;        /* position of this ddblock in the DD list */
 } ddblock_t;
 
 /* Tag tree node structure */
 typedef struct tag_info_str {
     uint16 tag; /* tag value for this node */
     /* Needs to be first in this structure */
-    bv_ptr   b; /* bit-vector to keep track of which refs are used */
-    dynarr_p d; /* dynarray of the refs for this tag */
+    bv_ptr     b;        /* bit-vector to keep track of which refs are used */
+    dynarr_p   d;        /* dynarray of the refs for this tag */
+    TBBT_TREE *order;    /* TBBT of the DDs for this tag, in DD list order */
+    int32      nrefs;    /* number of DDs for this tag (regular and special) */
+    int32      nspecial; /* number of those DDs which use the special tag */
 } tag_info;
 
 /* For determining what the last file operation was */
@@ -226,27 +288,29 @@ typedef enum {
 
 /* File record structure */
 typedef struct filerec_t {
-    char      *path;        /* name of file */
-    hdf_file_t file;        /* either file descriptor or pointer */
-    uint16     maxref;      /* highest ref in this file */
-    int        access;      /* access mode */
-    int        refcount;    /* reference count / times opened */
-    int        attach;      /* number of access elts attached */
-    int        version_set; /* version tag stuff */
-    version_t  version;     /* file version info */
+    char                *path;        /* name of file */
+    const hdf_fdriver_t *driver;      /* low-level driver used for this file */
+    hdf_fhandle_t        fh;          /* driver state for the open file */
+    uint16               maxref;      /* highest ref in this file */
+    int                  access;      /* access mode */
+    int                  refcount;    /* reference count / times opened */
+    int                  attach;      /* number of access elts attached */
+    int                  version_set; /* version tag stuff */
+    version_t            version;     /* file version info */
 
     /* Seek caching info */
-    int32    f_cur_off; /* Current location in the file */
-    fileop_t last_op;   /* the last file operation performed */
+    hdf_off_t f_cur_off; /* Current location in the file */
+    fileop_t  last_op;   /* the last file operation performed */
 
     /* DD block caching info */
-    int   cache;     /* boolean: whether caching is on */
-    int   dirty;     /* boolean: if dd list needs to be flushed */
-    int32 f_end_off; /* offset of the end of the file */
+    int       cache;     /* boolean: whether caching is on */
+    int       dirty;     /* boolean: if dd list needs to be flushed */
+    hdf_off_t f_end_off; /* offset of the end of the file */
 
     /* DD list pointers */
-    struct ddblock_t *ddhead; /* head of ddblock list */
-    struct ddblock_t *ddlast; /* end of ddblock list */
+    struct ddblock_t *ddhead;   /* head of ddblock list */
+    struct ddblock_t *ddlast;   /* end of ddblock list */
+    int               ddunread; /* boolean: are there ddblocks not read in yet? */
 
     /* NULL DD pointers (for fast lookup of DFTAG_NULL) */
     struct ddblock_t *ddnull;     /* location of last ddblock with a DFTAG_NULL */
@@ -261,6 +325,10 @@ typedef struct filerec_t {
                             * i.e. file/data labels and descriptions.
                             * This is done for faster searching of annotations
                             * of a particular type. */
+
+#ifdef H4_HAVE_THREADSAFE
+    HTSmutex_t lock; /* held while a thread works on the file (see HPlock_file) */
+#endif
 } filerec_t;
 
 /* bits for filerec_t 'dirty' flag */
@@ -282,7 +350,7 @@ typedef struct accrec_t {
     unsigned           access_type;  /* I/O access type: serial/parallel/... */
     int32              file_id;      /* id of attached file */
     atom_t             ddid;         /* DD id for the DD attached to */
-    int32              posn;         /* seek position with respect to start of element */
+    hdf_off_t          posn;         /* seek position with respect to start of element */
     void              *special_info; /* special element info? */
     struct funclist_t *special_func; /* ptr to special function? */
     struct accrec_t   *next;         /* for free-list linking */
@@ -331,9 +399,9 @@ typedef struct sp_info_block_t {
 typedef struct funclist_t {
     int32 (*stread)(accrec_t *rec);
     int32 (*stwrite)(accrec_t *rec);
-    int32 (*seek)(accrec_t *access_rec, int32 offset, int origin);
-    int32 (*inquire)(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                     int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial);
+    int32 (*seek)(accrec_t *access_rec, hdf_off_t offset, int origin);
+    int32 (*inquire)(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+                     hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial);
     int32 (*read)(accrec_t *access_rec, int32 length, void *data);
     int32 (*write)(accrec_t *access_rec, int32 length, const void *data);
     int (*endaccess)(accrec_t *access_rec);
@@ -364,7 +432,29 @@ typedef struct functab_t {
 #define GRIDTYPE  11 /* for GR access */
 #define RIIDTYPE  12 /* for RI access */
 
-#define BADFREC(r) ((r) == NULL || (r)->refcount == 0)
+/* A file record's refcount only changes under the library lock and the
+   file's lock, but BADFREC looks at it without either, so the thread-safe
+   library reads and writes it atomically */
+#ifdef H4_HAVE_THREADSAFE
+#define HFILE_REFCOUNT(r)        __atomic_load_n(&(r)->refcount, __ATOMIC_RELAXED)
+#define HFILE_SET_REFCOUNT(r, n) __atomic_store_n(&(r)->refcount, (n), __ATOMIC_RELAXED)
+#else
+#define HFILE_REFCOUNT(r)        ((r)->refcount)
+#define HFILE_SET_REFCOUNT(r, n) ((r)->refcount = (n))
+#endif
+
+#define BADFREC(r) ((r) == NULL || HFILE_REFCOUNT(r) == 0)
+
+/* Take and release a file record's lock.  The H-level routines take the
+   lock of the file they work on, so threads working on different files
+   don't wait for each other. */
+#ifdef H4_HAVE_THREADSAFE
+#define HFILE_LOCK(r)   HTSmutex_lock(&(r)->lock)
+#define HFILE_UNLOCK(r) HTSmutex_unlock(&(r)->lock)
+#else
+#define HFILE_LOCK(r)   ((void)0)
+#define HFILE_UNLOCK(r) ((void)0)
+#endif
 
 /* --------------------------- Special Elements --------------------------- */
 /* The HDF tag space is divided as follows based on the 2 highest bits:
@@ -424,12 +514,21 @@ HDFLIBAPI int HPcompare_filerec_path(const void *obj, const void *key);
 
 HDFLIBAPI int HPcompare_accrec_tagref(const void *rec1, const void *rec2);
 
-HDFLIBAPI int32 HPgetdiskblock(filerec_t *file_rec, int32 block_size, int moveto);
+HDFLIBAPI hdf_off_t HPgetdiskblock(filerec_t *file_rec, int32 block_size, int moveto);
 
-HDFLIBAPI int HPfreediskblock(filerec_t *file_rec, int32 block_offset, int32 block_size);
+HDFLIBAPI int HPfreediskblock(filerec_t *file_rec, hdf_off_t block_offset, hdf_off_t block_size);
 
 HDFLIBAPI int HPisfile_in_use(const char *path);
 
+#ifdef H4_HAVE_THREADSAFE
+HDFLIBAPI filerec_t *HPlock_file(int32 file_id);
+
+HDFLIBAPI void HPunlock_file(filerec_t *file_rec);
+#else
+#define HPlock_file(file_id)    NULL
+#define HPunlock_file(file_rec) ((void)(file_rec))
+#endif
+
 HDFLIBAPI int32 HDcheck_empty(int32 file_id, uint16 tag, uint16 ref, int *emptySDS);
 
 HDFLIBAPI int32 HDget_special_info(int32 access_id, sp_info_block_t *info_block);
@@ -438,10 +537,21 @@ HDFLIBAPI int32 HDset_special_info(int32 access_id, sp_info_block_t *info_block)
 
 HDFLIBAPI int HP_read(filerec_t *file_rec, void *buf, int32 bytes);
 
-HDFLIBAPI int HPseek(filerec_t *file_rec, int32 offset);
+HDFLIBAPI int HP_readv(filerec_t *file_rec, hdf_extent_t *ext, int n);
+
+HDFLIBAPI int HPseek(filerec_t *file_rec, hdf_off_t offset);
 
 HDFLIBAPI int HP_write(filerec_t *file_rec, const void *buf, int32 bytes);
 
+/*
+** from hfiledrv.c
+*/
+HDFLIBAPI void HPinit_fhandle(hdf_fhandle_t *fh);
+
+HDFLIBAPI const hdf_fdriver_t *HPget_fdriver(int type);
+
+HDFLIBAPI const hdf_fdriver_t *HPselect_fdriver(int type, int acc_mode);
+
 HDFLIBAPI int32 HPread_drec(int32 file_id, atom_t data_id, uint8 **drec_buf);
 
 HDFLIBAPI int tagcompare(void *k1, void *k2, int cmparg);
@@ -455,14 +565,15 @@ HDFLIBAPI int32 HLPstread(accrec_t *access_rec);
 
 HDFLIBAPI int32 HLPstwrite(accrec_t *access_rec);
 
-HDFLIBAPI int32 HLPseek(accrec_t *access_rec, int32 offset, int origin);
+HDFLIBAPI int32 HLPseek(accrec_t *access_rec, hdf_off_t offset, int origin);
 
 HDFLIBAPI int32 HLPread(accrec_t *access_rec, int32 length, void *data);
 
 HDFLIBAPI int32 HLPwrite(accrec_t *access_rec, int32 length, const void *data);
 
-HDFLIBAPI int32 HLPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                           int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial);
+HDFLIBAPI int32 HLPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref,
+                           hdf_off_t *plength, hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess,
+                           int16 *pspecial);
 
 HDFLIBAPI int HLPendaccess(accrec_t *access_rec);
 
@@ -477,14 +588,15 @@ HDFLIBAPI int32 HXPstread(accrec_t *rec);
 
 HDFLIBAPI int32 HXPstwrite(accrec_t *rec);
 
-HDFLIBAPI int32 HXPseek(accrec_t *access_rec, int32 offset, int origin);
+HDFLIBAPI int32 HXPseek(accrec_t *access_rec, hdf_off_t offset, int origin);
 
 HDFLIBAPI int32 HXPread(accrec_t *access_rec, int32 length, void *data);
 
 HDFLIBAPI int32 HXPwrite(accrec_t *access_rec, int32 length, const void *data);
 
-HDFLIBAPI int32 HXPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                           int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial);
+HDFLIBAPI int32 HXPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref,
+                           hdf_off_t *plength, hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess,
+                           int16 *pspecial);
 
 HDFLIBAPI int HXPendaccess(accrec_t *access_rec);
 
@@ -506,10 +618,11 @@ HDFLIBAPI int32 HCPstread(accrec_t *rec);
 
 HDFLIBAPI int32 HCPstwrite(accrec_t *rec);
 
-HDFLIBAPI int32 HCPseek(accrec_t *access_rec, int32 offset, int origin);
+HDFLIBAPI int32 HCPseek(accrec_t *access_rec, hdf_off_t offset, int origin);
 
-HDFLIBAPI int32 HCPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                           int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial);
+HDFLIBAPI int32 HCPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref,
+                           hdf_off_t *plength, hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess,
+                           int16 *pspecial);
 
 HDFLIBAPI int32 HCPread(accrec_t *access_rec, int32 length, void *data);
 
@@ -536,10 +649,11 @@ HDFLIBAPI int32 HBPstread(accrec_t *rec);
 
 HDFLIBAPI int32 HBPstwrite(accrec_t *rec);
 
-HDFLIBAPI int32 HBPseek(accrec_t *access_rec, int32 offset, int origin);
+HDFLIBAPI int32 HBPseek(accrec_t *access_rec, hdf_off_t offset, int origin);
 
-HDFLIBAPI int32 HBPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                           int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial);
+HDFLIBAPI int32 HBPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref,
+                           hdf_off_t *plength, hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess,
+                           int16 *pspecial);
 
 HDFLIBAPI int32 HBPread(accrec_t *access_rec, int32 length, void *data);
 
@@ -559,10 +673,11 @@ HDFLIBAPI int32 HRPstread(accrec_t *rec);
 
 HDFLIBAPI int32 HRPstwrite(accrec_t *rec);
 
-HDFLIBAPI int32 HRPseek(accrec_t *access_rec, int32 offset, int origin);
+HDFLIBAPI int32 HRPseek(accrec_t *access_rec, hdf_off_t offset, int origin);
 
-HDFLIBAPI int32 HRPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                           int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial);
+HDFLIBAPI int32 HRPinquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref,
+                           hdf_off_t *plength, hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess,
+                           int16 *pspecial);
 
 HDFLIBAPI int32 HRPread(accrec_t *access_rec, int32 length, void *data);
 
@@ -585,13 +700,31 @@ HDFLIBAPI int32 HRPinfo(accrec_t *access_rec, sp_info_block_t *info_block);
     Reads the DD blocks from disk and creates the in-memory structures for
     handling them.  This routine should only be called once for a given
     file and HTPend should be called when finished with the DD list (i.e.
-    when the file is being closed).
+    when the file is being closed).  If 'lazy' is set, only the first DD
+    block is read now and the rest are read in as they are needed.
+
+ RETURNS
+    Returns SUCCEED if successful and FAIL otherwise
+
+*******************************************************************************/
+int HTPstart(filerec_t *file_rec, /* IN: File record to store info in */
+             int        lazy      /* IN: TRUE to only read in the first DD block */
+);
+
+/******************************************************************************
+ NAME
+     HTPload - Read in the rest of the DD list
+
+ DESCRIPTION
+    Reads in the DD blocks which were left on disk when the DD list was
+    started lazily, so that every DD in the file is in the DD list and the
+    tag tree.  Does nothing if the whole DD list is already in memory.
 
  RETURNS
     Returns SUCCEED if successful and FAIL otherwise
 
 *******************************************************************************/
-int HTPstart(filerec_t *file_rec /* IN:  File record to store info in */
+int HTPload(filerec_t *file_rec /* IN:  File record to load the DD list for */
 );
 
 /******************************************************************************
@@ -723,9 +856,9 @@ int HTPdelete(atom_t ddid /* IN: DD id to delete */
     Returns SUCCEED if successful and FAIL otherwise
 
 *******************************************************************************/
-int HTPupdate(atom_t ddid,    /* IN: DD id to update */
-              int32  new_off, /* IN: new offset for DD */
-              int32  new_len  /* IN: new length for DD */
+int HTPupdate(atom_t    ddid,    /* IN: DD id to update */
+              hdf_off_t new_off, /* IN: new offset for DD */
+              hdf_off_t new_len  /* IN: new length for DD */
 );
 
 /******************************************************************************
@@ -740,11 +873,11 @@ int HTPupdate(atom_t ddid,    /* IN: DD id to update */
     Returns SUCCEED if successful and FAIL otherwise
 
 *******************************************************************************/
-int HTPinquire(atom_t  ddid, /* IN: DD id to inquire about */
-               uint16 *tag,  /* IN: tag of DD */
-               uint16 *ref,  /* IN: ref of DD */
-               int32  *off,  /* IN: offset of DD */
-               int32  *len   /* IN: length of DD */
+int HTPinquire(atom_t     ddid, /* IN: DD id to inquire about */
+               uint16    *tag,  /* IN: tag of DD */
+               uint16    *ref,  /* IN: ref of DD */
+               hdf_off_t *off,  /* IN: offset of DD */
+               hdf_off_t *len   /* IN: length of DD */
 );
 
 /******************************************************************************
@@ -30,7 +30,19 @@ DESIGN
     The tag_tree is a tbbt of the tags contained within the file.  Each
     node of the tag_tree has a link to a bit-vector for keeping track of the
     refs used for that tag and a link to a dynamic array pointers into the
-    DD list for each ref # used.
+    DD list for each ref # used.  Each node also holds a tbbt of the DDs for
+    that tag kept in the order they appear in the DD list (ordered by the
+    sequence number of the DD block and the position within the block), so
+    searches for the next or previous object with a tag do not have to walk
+    the whole DD list.
+
+    The DD list may be read in lazily (see Hsetddload): HTPstart then only
+    reads the first DD block and file_rec->ddunread stays set while there
+    are blocks left on disk.  A lookup of a specific tag/ref which isn't
+    found reads in one more block at a time until it is found or the DD
+    list runs out, and every routine which looks at more than one DD (the
+    wildcard searches, the counts, new refs and new DDs) calls HTPload to
+    read in the rest of the DD list first.
 
 BUGS/LIMITATIONS
 
@@ -58,16 +70,19 @@ EXPORTED ROUTINES
     HTPis_special- Check if a DD id is associated with a special tag
   DD list functions:
     HTPstart    - Initialize the DD list from disk (creates the DD list in memory)
+    HTPload     - Read in the rest of a lazily started DD list
     HTPinit     - Create a new DD list (creates the DD list in memory)
     HTPsync     - Flush the DD list to disk (synchronizes with disk)
     HTPend      - Close the DD list to disk (synchronizes with disk too)
 LOCAL ROUTINES
     HTIfind_dd      - find a specific DD in the file
+    HTIread_dd_block - read the next DD block in from the file
     HTInew_dd_block - create a new (empty) DD block
     HTIupdate_dd    - update a DD on disk
     HTIcount_dd     - counts the dd's of a certain type in file
     HTIregister_tag_ref     - insert a ref into the tag tree for a file
     HTIunregister_tag_ref   - remove a ref from the tag tree for a file
+    HTIorder_step           - find the next/previous DD in a tag's DD order
 
 OLD ROUTINES
     HIlookup_dd             - find the dd record for an element
@@ -90,6 +105,8 @@ OLD ROUTINES
 /* Private routines */
 static int HTIfind_dd(filerec_t *file_rec, uint16 look_tag, uint16 look_ref, dd_t **pdd, int direction);
 
+static int HTIread_dd_block(filerec_t *file_rec);
+
 static int HTInew_dd_block(filerec_t *file_rec);
 
 static int HTIupdate_dd(filerec_t *file_rec, dd_t *dd);
@@ -101,25 +118,37 @@ static int HTIregister_tag_ref(filerec_t *file_rec, dd_t *dd);
 
 static int HTIunregister_tag_ref(filerec_t *file_rec, dd_t *dd_ptr);
 
+static TBBT_NODE *HTIorder_step(TBBT_TREE *order, dd_t *from, int direction);
+
+static int HTIddcompare(void *k1, void *k2, int cmparg);
+
 /* Local definitions */
 /* The initial size of a ref dynarray */
 #define REF_DYNARRAY_START 64
 /* The increment of a ref dynarray */
 #define REF_DYNARRAY_INCR 256
 /* macros to encode and decode a DD */
+/* Offsets and lengths are unsigned on disk; the all-ones value stays -1 (INVALID_xxx) in memory */
+#define OFFENCODE(p, o) UINT32ENCODE(p, (uint32)(o))
+#define OFFDECODE(p, o)                                                                                      \
+    {                                                                                                        \
+        uint32 _off;                                                                                         \
+        UINT32DECODE(p, _off);                                                                               \
+        (o) = (_off == (uint32)INVALID_OFFSET) ? (hdf_off_t)INVALID_OFFSET : (hdf_off_t)_off;                \
+    }
 #define DDENCODE(p, tag, ref, offset, length)                                                                \
     {                                                                                                        \
         UINT16ENCODE(p, tag);                                                                                \
         UINT16ENCODE(p, ref);                                                                                \
-        INT32ENCODE(p, offset);                                                                              \
-        INT32ENCODE(p, length);                                                                              \
+        OFFENCODE(p, offset);                                                                                \
+        OFFENCODE(p, length);                                                                                \
     }
 #define DDDECODE(p, tag, ref, offset, length)                                                                \
     {                                                                                                        \
         UINT16DECODE(p, tag);                                                                                \
         UINT16DECODE(p, ref);                                                                                \
-        INT32DECODE(p, offset);                                                                              \
-        INT32DECODE(p, length);                                                                              \
+        OFFDECODE(p, offset);                                                                                \
+        OFFDECODE(p, length);                                                                                \
     }
 
 /******************************************************************************
@@ -130,39 +159,29 @@ static int HTIunregister_tag_ref(filerec_t *file_rec, dd_t *dd_ptr);
     Reads the DD blocks from disk and creates the in-memory structures for
     handling them.  This routine should only be called once for a given
     file and HTPend should be called when finished with the DD list (i.e.
-    when the file is being closed).
+    when the file is being closed).  If 'lazy' is set, only the first DD
+    block is read now and the rest are read in as they are needed.
 
  RETURNS
     Returns SUCCEED if successful and FAIL otherwise
 
 *******************************************************************************/
 int
-HTPstart(filerec_t *file_rec /* IN:  File record to store info in */
+HTPstart(filerec_t *file_rec, /* IN: File record to store info in */
+         int        lazy      /* IN: TRUE to only read in the first DD block */
 )
 {
-    uint8   *tbuf      = NULL; /* temporary buffer */
-    unsigned tbuf_size = 0;    /* temporary buffer size */
-    int32    end_off   = 0;    /* offset of the end of the file */
-    int      ret_value = SUCCEED;
+    int ret_value = SUCCEED;
 
     HEclear();
-    /* Alloc start of linked list of ddblocks. */
-    file_rec->ddhead = (ddblock_t *)malloc(sizeof(ddblock_t));
-    if (file_rec->ddhead == (ddblock_t *)NULL)
-        HGOTO_ERROR(DFE_NOSPACE, FAIL);
-
-    /* Keep the filerec_t pointer around for each ddblock */
-    file_rec->ddhead->frec = file_rec;
-
-    /* Only one elt in linked list so head is also last. */
-    file_rec->ddlast       = file_rec->ddhead;
-    file_rec->ddlast->next = (ddblock_t *)NULL;
-    file_rec->ddlast->prev = (ddblock_t *)NULL;
+    /* Start with an empty linked list of ddblocks */
+    file_rec->ddhead   = (ddblock_t *)NULL;
+    file_rec->ddlast   = (ddblock_t *)NULL;
+    file_rec->ddunread = TRUE;
 
-    /* The first ddblock always starts after the magic number.
-    Set it up so that we start reading from there. */
-    file_rec->ddlast->myoffset = MAGICLEN; /* set offset of block in file */
-    file_rec->ddlast->dirty    = 0;        /* block does not need to be flushed */
+    /* Update the DFTAG_NULL pointers */
+    file_rec->ddnull     = NULL;
+    file_rec->ddnull_idx = (-1);
 
     /* Initialize the tag tree */
     file_rec->tag_tree = tbbtdmake(tagcompare, sizeof(uint16), TBBT_FAST_UINT16_COMPARE);
@@ -171,119 +190,46 @@ HTPstart(filerec_t *file_rec /* IN:  File record to store info in */
     if (HAinit_group(DDGROUP, 256) == FAIL)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
-    /* Read in the dd's one at a time and determine the max ref in the file
-             at the same time. */
-    file_rec->maxref = 0;
-    for (;;) {
-        ddblock_t *ddcurr;                      /* ptr to the current DD block */
-        dd_t      *curr_dd_ptr;                 /* pointer to the current DD being read in */
-        uint8      ddhead[NDDS_SZ + OFFSET_SZ]; /* storage for the DD header */
-        uint8     *p;                           /* Temporary buffer pointer. */
-        int        ndds;                        /* number of DDs in a block */
-        int        i;                           /* Temporary integer */
-
-        /* Get a short-cut for the current DD block being read-in */
-        ddcurr = file_rec->ddlast;
-
-        /* Go to the beginning of the DD block */
-        if (HPseek(file_rec, ddcurr->myoffset) == FAIL)
-            HGOTO_ERROR(DFE_SEEKERROR, FAIL);
-
-        /* Read in the start of this dd block.
-           Read data consists of ndds (number of dd's in this block) and
-           offset (offset to the next ddblock). */
-        if (HP_read(file_rec, ddhead, NDDS_SZ + OFFSET_SZ) == FAIL)
-            HGOTO_ERROR(DFE_READERROR, FAIL);
-
-        /* Decode the numbers. */
-        p = &ddhead[0];
-        INT16DECODE(p, ddcurr->ndds);
-        ndds = (int)ddcurr->ndds;
-        if (ndds <= 0) /* validity check */
-            HGOTO_ERROR(DFE_CORRUPT, FAIL);
-        INT32DECODE(p, ddcurr->nextoffset);
-
-        /* check if the DD block is the last thing in the file */
-        /* (Unlikely, but possible (I think)) */
-        if (ddcurr->myoffset + (NDDS_SZ + OFFSET_SZ) + (ndds * DD_SZ) > end_off)
-            end_off = ddcurr->myoffset + (NDDS_SZ + OFFSET_SZ) + (ndds * DD_SZ);
-
-        /* Now that we know how many dd's are in this block,
-           alloc memory for the records. */
-        ddcurr->ddlist = (dd_t *)malloc((uint32)ndds * sizeof(dd_t));
-        if (ddcurr->ddlist == (dd_t *)NULL)
-            HGOTO_ERROR(DFE_NOSPACE, FAIL);
-
-        /* Allocate memory for the temporary buffer also */
-        if (tbuf == NULL || ((unsigned)ndds * DD_SZ) > tbuf_size) {
-            free(tbuf);
-            tbuf_size = (unsigned)ndds * DD_SZ;
-            tbuf      = (uint8 *)malloc(tbuf_size);
-            if (tbuf == (uint8 *)NULL)
-                HGOTO_ERROR(DFE_NOSPACE, FAIL);
-        } /* end if */
-
-        /* Index of current dd in ddlist of this ddblock is 0. */
-        curr_dd_ptr = ddcurr->ddlist;
-
-        /* Read in a chunk of dd's from the file. */
-        if (HP_read(file_rec, tbuf, ndds * DD_SZ) == FAIL)
-            HGOTO_ERROR(DFE_READERROR, FAIL);
-
-        /* decode the dd's */
-        p = tbuf;
-        for (i = 0; i < ndds; i++, curr_dd_ptr++) {
-            DDDECODE(p, curr_dd_ptr->tag, curr_dd_ptr->ref, curr_dd_ptr->offset, curr_dd_ptr->length);
-            curr_dd_ptr->blk = ddcurr;
-
-            /* check if maximum ref # exceeded */
-            if (file_rec->maxref < curr_dd_ptr->ref)
-                file_rec->maxref = curr_dd_ptr->ref;
-
-            /* check if the data element is the last thing in the file */
-            if ((curr_dd_ptr->offset + curr_dd_ptr->length) > end_off)
-                end_off = curr_dd_ptr->offset + curr_dd_ptr->length;
-
-            /* Add to the tag info tree */
-            if (curr_dd_ptr->tag != DFTAG_NULL)
-                if (HTIregister_tag_ref(file_rec, curr_dd_ptr) == FAIL)
-                    HGOTO_ERROR(DFE_INTERNAL, FAIL);
-        }
+    /* Read in the dd's one block at a time and determine the max ref and
+       the end of the file at the same time. */
+    file_rec->maxref    = 0;
+    file_rec->f_end_off = 0;
+    do {
+        if (HTIread_dd_block(file_rec) == FAIL)
+            HGOTO_ERROR(DFE_INTERNAL, FAIL);
+    } while (!lazy && file_rec->ddunread);
 
-        if (ddcurr->nextoffset != 0) { /* More ddblocks in the file */
-            ddblock_t *ddnew;          /* ptr to the new DD block */
+done:
+    return ret_value;
+} /* end HTPstart() */
 
-            /* extend the linked list */
-            ddcurr->next = ddnew = (ddblock_t *)malloc((uint32)sizeof(ddblock_t));
-            if (ddnew == (ddblock_t *)NULL)
-                HGOTO_ERROR(DFE_NOSPACE, FAIL);
+/******************************************************************************
+ NAME
+     HTPload - Read in the rest of the DD list
 
-            ddnew->prev      = ddcurr;
-            ddnew->next      = (ddblock_t *)NULL;
-            ddnew->ddlist    = (dd_t *)NULL;
-            ddnew->myoffset  = ddcurr->nextoffset;
-            ddnew->dirty     = FALSE;
-            file_rec->ddlast = ddnew;
+ DESCRIPTION
+    Reads in the DD blocks which were left on disk when the DD list was
+    started lazily, so that every DD in the file is in the DD list and the
+    tag tree.  Does nothing if the whole DD list is already in memory.
 
-            /* Keep the filerec_t pointer around for each ddblock */
-            ddnew->frec = file_rec;
-        } /* end if */
-        else
-            break;
-    } /* end for */
+ RETURNS
+    Returns SUCCEED if successful and FAIL otherwise
 
-    /* Update the DFTAG_NULL pointers */
-    file_rec->ddnull     = NULL;
-    file_rec->ddnull_idx = (-1);
+*******************************************************************************/
+int
+HTPload(filerec_t *file_rec /* IN:  File record to load the DD list for */
+)
+{
+    int ret_value = SUCCEED;
 
-    /* Update the end of the file from the DD's we have read in */
-    file_rec->f_end_off = end_off;
+    HEclear();
+    while (file_rec->ddunread)
+        if (HTIread_dd_block(file_rec) == FAIL)
+            HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
 done:
-    free(tbuf);
-
     return ret_value;
-} /* end HTPstart() */
+} /* end HTPload() */
 
 /******************************************************************************
  NAME
@@ -331,10 +277,14 @@ HTPinit(filerec_t *file_rec, /* IN: File record to store info in */
     block->nextoffset        = 0;
     block->myoffset          = MAGICLEN;
     block->dirty             = FALSE;
+    block->seq               = 0;
 
     /* Keep the filerec_t pointer around for each ddblock */
     block->frec = file_rec;
 
+    /* A new DD list is all in memory */
+    file_rec->ddunread = FALSE;
+
     /* write first dd block header to file */
     p = &ddhead[0];
     INT16ENCODE(p, block->ndds);
@@ -431,7 +381,7 @@ HTPsync(filerec_t *file_rec /* IN:  File record to store info in */
             /* write dd block header to file */
             p = ddhead;
             INT16ENCODE(p, block->ndds);
-            INT32ENCODE(p, block->nextoffset);
+            OFFENCODE(p, block->nextoffset);
             if (HP_write(file_rec, ddhead, NDDS_SZ + OFFSET_SZ) == FAIL)
                 HGOTO_ERROR(DFE_WRITEERROR, FAIL);
 
@@ -577,7 +527,9 @@ done:
 
  DESCRIPTION
     Attaches to an existing tag/ref pair.  This routine returns a DD id which
-    can be used in the other tag/ref routines to modify the DD.
+    can be used in the other tag/ref routines to modify the DD.  If the DD
+    list is being read in lazily, blocks are read in until the tag/ref is
+    found or the DD list runs out.
 
  RETURNS
     Returns DD id if successful and FAIL otherwise
@@ -589,22 +541,15 @@ HTPselect(filerec_t *file_rec, /* IN: File record to store info in */
           uint16     ref       /* IN: ref to select */
 )
 {
-    dd_t      *dd_ptr;                   /* ptr to the DD info for the tag/ref */
-    tag_info **tip_ptr;                  /* ptr to the ptr to the info for a tag */
-    tag_info  *tinfo_ptr;                /* pointer to the info for a tag */
-    uint16     base_tag  = BASETAG(tag); /* corresponding base tag (if the tag is special) */
-    atom_t     ret_value = SUCCEED;
+    dd_t  *dd_ptr    = NULL; /* ptr to the DD info for the tag/ref */
+    atom_t ret_value = SUCCEED;
 
     HEclear();
     if (file_rec == NULL || (tag == DFTAG_NULL || tag == DFTAG_WILDCARD) || ref == DFREF_WILDCARD)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
-    /* Try to find the regular tag in the tag info tree */
-    if ((tip_ptr = (tag_info **)tbbtdfind(file_rec->tag_tree, (void *)&base_tag, NULL)) == NULL)
-        HGOTO_DONE(FAIL); /* Not an error, we just didn't find the object */
-
-    tinfo_ptr = *tip_ptr; /* get the pointer to the tag info */
-    if ((dd_ptr = DAget_elem(tinfo_ptr->d, (int)ref)) == NULL)
+    /* Look for the tag/ref, reading in more of the DD list if need be */
+    if (HTIfind_dd(file_rec, tag, ref, &dd_ptr, DF_FORWARD) == FAIL)
         HGOTO_DONE(FAIL); /* Not an error, we just didn't find the object */
 
     /* Get the atom to return */
@@ -711,20 +656,24 @@ done:
 
 *******************************************************************************/
 int
-HTPupdate(atom_t ddid,    /* IN: DD id to update */
-          int32  new_off, /* IN: new offset for DD */
-          int32  new_len  /* IN: new length for DD */
+HTPupdate(atom_t    ddid,    /* IN: DD id to update */
+          hdf_off_t new_off, /* IN: new offset for DD */
+          hdf_off_t new_len  /* IN: new length for DD */
 )
 {
-    dd_t *dd_ptr      = NULL; /* ptr to the DD info for the tag/ref */
-    int32 dont_change = -2;   /* initialize to '-2' */
-    int32 ret_value   = SUCCEED;
+    dd_t     *dd_ptr      = NULL; /* ptr to the DD info for the tag/ref */
+    hdf_off_t dont_change = -2;   /* initialize to '-2' */
+    int32     ret_value   = SUCCEED;
 
     HEclear();
     /* Retrieve the atom's object, so we can update the DD */
     if ((dd_ptr = HAatom_object(ddid)) == NULL)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
+    /* Offsets and lengths must fit in the 32-bit fields of a DD */
+    if (new_len > MAX_DD_OFFSET || new_off > MAX_DD_OFFSET)
+        HGOTO_ERROR(DFE_EXCEEDMAX, FAIL);
+
     /* Update the tag/ref in memory */
     if (new_len != dont_change)
         dd_ptr->length = new_len;
@@ -752,11 +701,11 @@ done:
 
 *******************************************************************************/
 int
-HTPinquire(atom_t  ddid, /* IN: DD id to inquire about */
-           uint16 *tag,  /* IN: tag of DD */
-           uint16 *ref,  /* IN: ref of DD */
-           int32  *off,  /* IN: offset of DD */
-           int32  *len   /* IN: length of DD */
+HTPinquire(atom_t     ddid, /* IN: DD id to inquire about */
+           uint16    *tag,  /* IN: tag of DD */
+           uint16    *ref,  /* IN: ref of DD */
+           hdf_off_t *off,  /* IN: offset of DD */
+           hdf_off_t *len   /* IN: length of DD */
 )
 {
     dd_t *dd_ptr; /* ptr to the DD info for the tag/ref */
@@ -835,12 +784,13 @@ Hdupdd(int32  file_id, /* IN: File ID the tag/refs are in */
        uint16 old_ref  /* IN: Ref of old tag/ref */
 )
 {
-    filerec_t *file_rec; /* file record */
-    atom_t     old_dd;   /* The DD id for the old DD */
-    atom_t     new_dd;   /* The DD id for the new DD */
-    int32      old_len;  /* The length of the old DD */
-    int32      old_off;  /* The offset of the old DD */
-    int        ret_value = SUCCEED;
+    filerec_t *file_rec;          /* file record */
+    atom_t     old_dd;            /* The DD id for the old DD */
+    atom_t     new_dd;            /* The DD id for the new DD */
+    hdf_off_t  old_len;           /* The length of the old DD */
+    hdf_off_t  old_off;           /* The offset of the old DD */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     /* clear error stack and check validity of file id */
     HEclear();
@@ -848,6 +798,8 @@ Hdupdd(int32  file_id, /* IN: File ID the tag/refs are in */
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(file_id);
+
     /* Attach to the old DD in the file */
     if ((old_dd = HTPselect(file_rec, old_tag, old_ref)) == FAIL)
         HGOTO_ERROR(DFE_NOMATCH, FAIL);
@@ -871,6 +823,7 @@ Hdupdd(int32  file_id, /* IN: File ID the tag/refs are in */
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* Hdupdd() */
 
@@ -896,8 +849,9 @@ Hnumber(int32  file_id, /* IN: File ID the tag/refs are in */
 {
     unsigned   all_cnt;
     unsigned   real_cnt;
-    filerec_t *file_rec; /* file record */
-    int32      ret_value = SUCCEED;
+    filerec_t *file_rec;          /* file record */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int32      ret_value  = SUCCEED;
 
     /* convert file id to file record */
     file_rec = HAatom_object(file_id);
@@ -906,6 +860,8 @@ Hnumber(int32  file_id, /* IN: File ID the tag/refs are in */
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(file_id);
+
     /* Go count the items with that tag */
     if (HTIcount_dd(file_rec, tag, DFREF_WILDCARD, &all_cnt, &real_cnt) == FAIL)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
@@ -913,6 +869,7 @@ Hnumber(int32  file_id, /* IN: File ID the tag/refs are in */
     ret_value = (int32)real_cnt;
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* Hnumber() */
 
@@ -933,9 +890,10 @@ done:
 uint16
 Hnewref(int32 file_id /* IN: File ID the tag/refs are in */)
 {
-    filerec_t *file_rec; /* file record */
-    uint16     ref;      /* the new ref */
-    uint16     ret_value = DFREF_NONE;
+    filerec_t *file_rec;          /* file record */
+    uint16     ref;               /* the new ref */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    uint16     ret_value  = DFREF_NONE;
     uint32     i_ref; /* index for FOR loop */
 
     /* clear error stack and check validity of file record id */
@@ -944,6 +902,12 @@ Hnewref(int32 file_id /* IN: File ID the tag/refs are in */)
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_ARGS, 0);
 
+    locked_rec = HPlock_file(file_id);
+
+    /* maxref is only known once the whole DD list has been read */
+    if (HTPload(file_rec) == FAIL)
+        HGOTO_ERROR(DFE_INTERNAL, 0);
+
     /* if maxref of this file is still below the maximum,
      just return next number */
     if (file_rec->maxref < MAX_REF)
@@ -962,6 +926,7 @@ Hnewref(int32 file_id /* IN: File ID the tag/refs are in */)
     }                            /* end else */
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* Hnewref() */
 
@@ -986,8 +951,9 @@ Htagnewref(int32  file_id, /* IN: File ID the tag/refs are in */
     filerec_t *file_rec;                 /* file record */
     tag_info  *tinfo_ptr;                /* pointer to the info for a tag */
     tag_info **tip_ptr;                  /* ptr to the ptr to the info for a tag */
-    uint16     base_tag  = BASETAG(tag); /* corresponding base tag (if the tag is special) */
-    uint16     ret_value = DFREF_NONE;
+    uint16     base_tag   = BASETAG(tag); /* corresponding base tag (if the tag is special) */
+    filerec_t *locked_rec = NULL;         /* file record locked here */
+    uint16     ret_value  = DFREF_NONE;
 
     /* clear error stack and check validity of file record id */
     HEclear();
@@ -995,6 +961,12 @@ Htagnewref(int32  file_id, /* IN: File ID the tag/refs are in */
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_ARGS, 0);
 
+    locked_rec = HPlock_file(file_id);
+
+    /* The refs used for the tag are only known once the whole DD list has been read */
+    if (HTPload(file_rec) == FAIL)
+        HGOTO_ERROR(DFE_INTERNAL, 0);
+
     if ((tip_ptr = (tag_info **)tbbtdfind(file_rec->tag_tree, (void *)&base_tag, NULL)) == NULL)
         ret_value = 1;        /* The first available ref */
     else {                    /* found an existing tag */
@@ -1004,6 +976,7 @@ Htagnewref(int32  file_id, /* IN: File ID the tag/refs are in */
     }
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* Htagnewref() */
 
@@ -1039,9 +1012,10 @@ Hfind(int32   file_id,    /* IN: file ID to search in */
                           /*  DF_BACKWARD searches backward from the current location */
 )
 {
-    filerec_t *file_rec; /* file record */
-    dd_t      *dd_ptr;   /* ptr to current ddlist searched */
-    int        ret_value = SUCCEED;
+    filerec_t *file_rec;          /* file record */
+    dd_t      *dd_ptr;            /* ptr to current ddlist searched */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     /* clear error stack and check validity of the access id */
     HEclear();
@@ -1053,6 +1027,8 @@ Hfind(int32   file_id,    /* IN: file ID to search in */
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
+    locked_rec = HPlock_file(file_id);
+
     dd_ptr = NULL;
     if (*find_ref != 0 || *find_tag != 0) { /* continue a search */
         /* get the block and index of the last tag/ref found, to continue */
@@ -1066,10 +1042,11 @@ Hfind(int32   file_id,    /* IN: file ID to search in */
 
     *find_tag    = dd_ptr->tag;
     *find_ref    = dd_ptr->ref;
-    *find_offset = dd_ptr->offset;
-    *find_length = dd_ptr->length;
+    *find_offset = (int32)dd_ptr->offset;
+    *find_length = (int32)dd_ptr->length;
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* end Hfind() */
 
@@ -1092,12 +1069,10 @@ HDcheck_tagref(int32  file_id, /* IN: id of file */
                uint16 tag,     /* IN: Tag to check */
                uint16 ref /* IN: ref to check */)
 {
-    filerec_t *file_rec  = NULL; /* file record */
-    dd_t      *dd_ptr    = NULL; /* ptr to the DD info for the tag/ref */
-    tag_info **tip_ptr   = NULL; /* ptr to the ptr to the info for a tag */
-    tag_info  *tinfo_ptr = NULL; /* pointer to the info for a tag */
-    uint16     base_tag;         /* corresponding base tag (if the tag is special) */
-    int        ret_value = 1;    /* default tag/ref exists  */
+    filerec_t *file_rec   = NULL; /* file record */
+    dd_t      *dd_ptr     = NULL; /* ptr to the DD info for the tag/ref */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int        ret_value  = 1;    /* default tag/ref exists  */
 
     /* clear error stack */
     HEclear();
@@ -1107,20 +1082,17 @@ HDcheck_tagref(int32  file_id, /* IN: id of file */
     if (file_rec == NULL || (tag == DFTAG_NULL || tag == DFTAG_WILDCARD) || ref == DFREF_WILDCARD)
         HGOTO_ERROR(DFE_ARGS, -1);
 
-    base_tag = BASETAG(tag);
-
-    /* Try to find the regular tag in the tag info tree */
-    if ((tip_ptr = (tag_info **)tbbtdfind(file_rec->tag_tree, (void *)&base_tag, NULL)) == NULL)
-        HGOTO_DONE(0); /* Not an error, we just didn't find the object */
+    locked_rec = HPlock_file(file_id);
 
-    tinfo_ptr = *tip_ptr; /* get the pointer to the tag info */
-    if ((dd_ptr = DAget_elem(tinfo_ptr->d, (int)ref)) == NULL)
+    /* Look for the tag/ref, reading in more of the DD list if needed */
+    if (HTIfind_dd(file_rec, tag, ref, &dd_ptr, DF_FORWARD) == FAIL)
         HGOTO_DONE(0); /* Not an error, we just didn't find the object */
 
     /* found if we reach here*/
     ret_value = 1;
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* HDcheck_tagref() */
 
@@ -1151,9 +1123,10 @@ HDreuse_tagref(int32  file_id, /* IN: id of file */
                uint16 tag,     /* IN: tag of data descriptor to reuse */
                uint16 ref /* IN: ref of data descriptor to reuse */)
 {
-    filerec_t *file_rec = NULL; /* file record */
-    atom_t     ddid;            /* ID for the DD */
-    int        ret_value = SUCCEED;
+    filerec_t *file_rec   = NULL; /* file record */
+    atom_t     ddid;              /* ID for the DD */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     /* clear error stack and check validity of file record id */
     HEclear();
@@ -1162,6 +1135,8 @@ HDreuse_tagref(int32  file_id, /* IN: id of file */
     if (BADFREC(file_rec) || tag == DFTAG_WILDCARD || ref == DFREF_WILDCARD)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(file_id);
+
     /* look for the dd to reuse */
     if ((ddid = HTPselect(file_rec, tag, ref)) == FAIL)
         HGOTO_ERROR(DFE_NOMATCH, FAIL);
@@ -1187,6 +1162,7 @@ HDreuse_tagref(int32  file_id, /* IN: id of file */
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* end HDreuse_tagref */
 
@@ -1211,9 +1187,10 @@ DESCRIPTION
 int
 Hdeldd(int32 file_id, uint16 tag, uint16 ref)
 {
-    filerec_t *file_rec; /* file record */
-    atom_t     ddid;     /* ID for the DD */
-    int        ret_value = SUCCEED;
+    filerec_t *file_rec;          /* file record */
+    atom_t     ddid;              /* ID for the DD */
+    filerec_t *locked_rec = NULL; /* file record locked here */
+    int        ret_value  = SUCCEED;
 
     /* clear error stack and check validity of file record id */
     HEclear();
@@ -1221,6 +1198,8 @@ Hdeldd(int32 file_id, uint16 tag, uint16 ref)
     if (BADFREC(file_rec) || tag == DFTAG_WILDCARD || ref == DFREF_WILDCARD)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    locked_rec = HPlock_file(file_id);
+
     /* look for the dd to delete */
     if ((ddid = HTPselect(file_rec, tag, ref)) == FAIL)
         HGOTO_ERROR(DFE_NOMATCH, FAIL);
@@ -1230,6 +1209,7 @@ Hdeldd(int32 file_id, uint16 tag, uint16 ref)
         HGOTO_ERROR(DFE_CANTDELDD, FAIL);
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* end Hdeldd */
 
@@ -1260,6 +1240,10 @@ HTPdump_dds(int32 file_id, FILE *fout)
     if (BADFREC(file_rec))
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    /* Dump the whole DD list */
+    if (HTPload(file_rec) == FAIL)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
     /* Print out each DD block */
     {
         ddblock_t *block     = file_rec->ddhead; /* dd block currently dumping */
@@ -1337,6 +1321,132 @@ done:
 
 /* Private, static, internal routines.  Do not call from outside this module */
 
+/*--------------------------------------------------------------------------
+ NAME
+    HTIread_dd_block -- read the next DD block in from the file
+ USAGE
+    int HTIread_dd_block(file_rec)
+        filerec_t  * file_rec;        IN: file record
+ RETURNS
+    returns SUCCEED (0) if successful and FAIL (-1) if failed.
+ DESCRIPTION
+    Reads the DD block following the last one in memory (or the first DD
+    block, if none have been read yet), appends it to the DD list and
+    registers its DDs in the tag tree.  The maximum ref # and the end of the
+    file are updated from the DDs read, and file_rec->ddunread is cleared
+    once the last DD block in the file has been read.  It is also cleared
+    if the block can't be read, so that a damaged DD list isn't read again.
+
+--------------------------------------------------------------------------*/
+static int
+HTIread_dd_block(filerec_t *file_rec)
+{
+    ddblock_t *block;                       /* the DD block being read in */
+    dd_t      *curr_dd_ptr;                 /* pointer to the current DD being read in */
+    uint8      ddhead[NDDS_SZ + OFFSET_SZ]; /* storage for the DD header */
+    uint8     *tbuf = NULL;                 /* temporary buffer */
+    uint8     *p;                           /* Temporary buffer pointer. */
+    int        ndds;                        /* number of DDs in a block */
+    int        i;                           /* Temporary integer */
+    int        ret_value = SUCCEED;
+
+    HEclear();
+    /* extend the linked list */
+    if ((block = (ddblock_t *)malloc(sizeof(ddblock_t))) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    block->ndds       = 0;
+    block->nextoffset = 0;
+    block->next       = (ddblock_t *)NULL;
+    block->ddlist     = (dd_t *)NULL;
+    block->dirty      = FALSE;
+
+    /* Keep the filerec_t pointer around for each ddblock */
+    block->frec = file_rec;
+
+    if (file_rec->ddlast == NULL) { /* The first ddblock always starts after the magic number. */
+        block->prev      = (ddblock_t *)NULL;
+        block->myoffset  = MAGICLEN;
+        block->seq       = 0;
+        file_rec->ddhead = block;
+    } /* end if */
+    else {
+        block->prev            = file_rec->ddlast;
+        block->myoffset        = file_rec->ddlast->nextoffset;
+        block->seq             = file_rec->ddlast->seq + 1;
+        file_rec->ddlast->next = block;
+    } /* end else */
+    file_rec->ddlast = block;
+
+    /* Go to the beginning of the DD block */
+    if (HPseek(file_rec, block->myoffset) == FAIL)
+        HGOTO_ERROR(DFE_SEEKERROR, FAIL);
+
+    /* Read in the start of this dd block.
+       Read data consists of ndds (number of dd's in this block) and
+       offset (offset to the next ddblock). */
+    if (HP_read(file_rec, ddhead, NDDS_SZ + OFFSET_SZ) == FAIL)
+        HGOTO_ERROR(DFE_READERROR, FAIL);
+
+    /* Decode the numbers. */
+    p = &ddhead[0];
+    INT16DECODE(p, ndds);
+    if (ndds <= 0) /* validity check */
+        HGOTO_ERROR(DFE_CORRUPT, FAIL);
+    OFFDECODE(p, block->nextoffset);
+
+    /* check if the DD block is the last thing in the file */
+    /* (Unlikely, but possible (I think)) */
+    if (block->myoffset + (NDDS_SZ + OFFSET_SZ) + (ndds * DD_SZ) > file_rec->f_end_off)
+        file_rec->f_end_off = block->myoffset + (NDDS_SZ + OFFSET_SZ) + (ndds * DD_SZ);
+
+    /* Now that we know how many dd's are in this block,
+       alloc memory for the records. */
+    if ((block->ddlist = (dd_t *)malloc((uint32)ndds * sizeof(dd_t))) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+
+    /* Allocate memory for the temporary buffer also */
+    if ((tbuf = (uint8 *)malloc((size_t)ndds * DD_SZ)) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+
+    /* Read in a chunk of dd's from the file. */
+    if (HP_read(file_rec, tbuf, ndds * DD_SZ) == FAIL)
+        HGOTO_ERROR(DFE_READERROR, FAIL);
+
+    /* decode the dd's */
+    p           = tbuf;
+    curr_dd_ptr = block->ddlist;
+    for (i = 0; i < ndds; i++, curr_dd_ptr++) {
+        DDDECODE(p, curr_dd_ptr->tag, curr_dd_ptr->ref, curr_dd_ptr->offset, curr_dd_ptr->length);
+        curr_dd_ptr->blk = block;
+    }
+    block->ndds = (int16)ndds;
+
+    for (i = 0, curr_dd_ptr = block->ddlist; i < ndds; i++, curr_dd_ptr++) {
+        /* check if maximum ref # exceeded */
+        if (file_rec->maxref < curr_dd_ptr->ref)
+            file_rec->maxref = curr_dd_ptr->ref;
+
+        /* check if the data element is the last thing in the file */
+        if ((curr_dd_ptr->offset + curr_dd_ptr->length) > file_rec->f_end_off)
+            file_rec->f_end_off = curr_dd_ptr->offset + curr_dd_ptr->length;
+
+        /* Add to the tag info tree */
+        if (curr_dd_ptr->tag != DFTAG_NULL)
+            if (HTIregister_tag_ref(file_rec, curr_dd_ptr) == FAIL)
+                HGOTO_ERROR(DFE_INTERNAL, FAIL);
+    }
+
+    /* More ddblocks in the file? */
+    file_rec->ddunread = (block->nextoffset != 0);
+
+done:
+    if (ret_value == FAIL) /* Error condition cleanup */
+        file_rec->ddunread = FALSE;
+    free(tbuf);
+
+    return ret_value;
+} /* HTIread_dd_block */
+
 /*--------------------------------------------------------------------------
  NAME
     HTInew_dd_block -- create a new (empty) DD block
@@ -1354,9 +1464,9 @@ done:
 static int
 HTInew_dd_block(filerec_t *file_rec)
 {
-    int32      nextoffset;                  /* offset of new ddblock */
+    hdf_off_t  nextoffset;                  /* offset of new ddblock */
     uint8      ddhead[NDDS_SZ + OFFSET_SZ]; /* storage for the DD header */
-    int32      offset;                      /* offset to the offset of new ddblock */
+    hdf_off_t  offset;                      /* offset to the offset of new ddblock */
     ddblock_t *block;                       /* Block the DD is located in */
     dd_t      *list;                        /* dd list array of new dd block */
     uint8     *p;                           /* Temporary buffer pointer. */
@@ -1374,6 +1484,7 @@ HTInew_dd_block(filerec_t *file_rec)
     block->ndds       = (int16)(ndds = (int)file_rec->ddhead->ndds); /* snarf from first block */
     block->next       = (ddblock_t *)NULL;
     block->nextoffset = 0;
+    block->seq        = file_rec->ddlast->seq + 1;
 
     /* Keep the filerec_t pointer around for each ddblock */
     block->frec = file_rec;
@@ -1439,7 +1550,7 @@ HTInew_dd_block(filerec_t *file_rec)
         else
             offset = file_rec->ddlast->prev->nextoffset + NDDS_SZ;
         p = ddhead;
-        INT32ENCODE(p, nextoffset);
+        OFFENCODE(p, nextoffset);
         if (HPseek(file_rec, offset) == FAIL)
             HGOTO_ERROR(DFE_SEEKERROR, FAIL);
         if (HP_write(file_rec, ddhead, OFFSET_SZ) == FAIL)
@@ -1494,190 +1605,163 @@ HTIfind_dd(filerec_t *file_rec, uint16 look_tag, uint16 look_ref, dd_t **pdd, in
         dd_t      *dd_ptr;            /* ptr to the DD info for a tag/ref */
         uint16     base_tag = BASETAG(look_tag); /* corresponding base tag (if the tag is special) */
 
-        /* Try to find the regular tag in the tag info tree */
-        if ((tip_ptr = (tag_info **)tbbtdfind(file_rec->tag_tree, (void *)&base_tag, NULL)) == NULL)
-            HGOTO_DONE(FAIL); /* Not an error, we just didn't find the object */
+        /* Try to find the regular tag in the tag info tree, reading in more
+           of the DD list until it turns up or there is nothing left to read */
+        for (;;) {
+            if ((tip_ptr = (tag_info **)tbbtdfind(file_rec->tag_tree, (void *)&base_tag, NULL)) != NULL) {
+                tinfo_ptr = *tip_ptr; /* get the pointer to the tag info */
+                if ((dd_ptr = DAget_elem(tinfo_ptr->d, (int)look_ref)) != NULL)
+                    break;
+            } /* end if */
 
-        tinfo_ptr = *tip_ptr; /* get the pointer to the tag info */
-        if ((dd_ptr = DAget_elem(tinfo_ptr->d, (int)look_ref)) == NULL)
-            HGOTO_DONE(FAIL); /* Not an error, we just didn't find the object */
+            if (!file_rec->ddunread)
+                HGOTO_DONE(FAIL); /* Not an error, we just didn't find the object */
+            if (HTIread_dd_block(file_rec) == FAIL)
+                HGOTO_ERROR(DFE_INTERNAL, FAIL);
+        } /* end for */
 
         *pdd = dd_ptr;
         HGOTO_DONE(SUCCEED);
-    }                                  /* end if */
-    else {                             /* handle wildcards, etc. */
-        if (direction == DF_FORWARD) { /* search forward through the DD list */
-            if (*pdd == NULL) {
-                block = file_rec->ddhead;
-                idx   = 0;
-            } /* end if */
-            else {
-                block = (*pdd)->blk;
-                idx   = ((*pdd) - &block->ddlist[0]) + 1;
-            }                                                               /* end else */
-            if (look_tag == DFTAG_WILDCARD && look_ref == DFREF_WILDCARD) { /* Both tag & ref are wildcards */
-                for (; block; block = block->next) {
-                    list = &block->ddlist[idx];
-                    for (; idx < block->ndds; idx++, list++) {
-                        /* skip the empty dd's */
-                        if (list->tag == DFTAG_NULL)
-                            continue;
-
-                        /* we have a match !! (anything matches! :-) */
-                        *pdd = list;
-                        HGOTO_DONE(SUCCEED);
-                    } /* end for */
+    } /* end if */
 
-                    /* start from beginning of the next dd list */
-                    idx = 0;
-                } /* end for */
-            }     /* end if */
-            else if (look_tag == DFTAG_NULL &&
-                     look_ref == DFTAG_WILDCARD) { /* special case for quick lookup of empty DD's */
-                if (file_rec->ddnull == NULL)
-                    block = file_rec->ddhead;
-                else
-                    block = file_rec->ddnull;
-                if (file_rec->ddnull_idx < 0)
-                    idx = 0;
-                else
-                    idx = file_rec->ddnull_idx + 1;
-
-                for (; block; block = block->next) {
-                    list = &block->ddlist[idx];
-                    for (; idx < block->ndds; idx++, list++) {
-                        /* skip the empty dd's */
-                        if (list->tag == DFTAG_NULL) {
-                            /* we have a match !! */
-                            *pdd = list;
-
-                            /* Update the DFTAG_NULL pointers */
-                            file_rec->ddnull     = block;
-                            file_rec->ddnull_idx = idx;
-
-                            HGOTO_DONE(SUCCEED);
-                        } /* end if */
-                    }     /* end for */
-
-                    /* start from beginning of the next dd list */
-                    idx = 0;
-                }                                  /* end for */
-            }                                      /* end if */
-            else if (look_tag == DFTAG_WILDCARD) { /* tag is wildcard */
-                for (; block; block = block->next) {
-                    list = &block->ddlist[idx];
-                    for (; idx < block->ndds; idx++, list++) {
-                        /* skip the empty dd's */
-                        if (list->tag == DFTAG_NULL)
-                            continue;
-
-                        if (list->ref == look_ref) {
-                            /* we have a match !! */
-                            *pdd = list;
-                            HGOTO_DONE(SUCCEED);
-                        } /* end if */
-                    }     /* end for */
-
-                    /* start from beginning of the next dd list */
-                    idx = 0;
-                }                                  /* end for */
-            }                                      /* end if */
-            else if (look_ref == DFREF_WILDCARD) { /* ref is wildcard */
-                if (special_tag == DFTAG_NULL) {
-                    /* Change this to lookup the next used ref # in the bitvector or dynarray -QAK */
-                    for (; block; block = block->next) {
-                        list = &block->ddlist[idx];
-                        for (; idx < block->ndds; idx++, list++) {
-                            /* skip the empty dd's */
-                            if (list->tag == DFTAG_NULL && look_tag != DFTAG_NULL)
-                                continue;
-
-                            if (list->tag == look_tag) {
-                                /* we have a match !! */
-                                *pdd = list;
-                                HGOTO_DONE(SUCCEED);
-                            } /* end if */
-                        }     /* end for */
-
-                        /* start from beginning of the next dd list */
-                        idx = 0;
-                    } /* end for */
-                }     /* end if */
-                else {
-                    for (; block; block = block->next) {
-                        list = &block->ddlist[idx];
-                        for (; idx < block->ndds; idx++, list++) {
-                            /* skip the empty dd's */
-                            if (list->tag == DFTAG_NULL && look_tag != DFTAG_NULL)
-                                continue;
-
-                            if (list->tag == look_tag || list->tag == special_tag) {
-                                /* we have a match !! */
-                                *pdd = list;
-                                HGOTO_DONE(SUCCEED);
-                            } /* end if */
-                        }     /* end for */
-
-                        /* start from beginning of the next dd list */
-                        idx = 0;
-                    } /* end for */
-                }     /* end else */
-            }         /* end if */
-            else {    /* Both tag & ref are not wildcards */
-                for (; block; block = block->next) {
-                    list = &block->ddlist[idx];
-                    for (; idx < block->ndds; idx++, list++) {
-                        /* skip the empty dd's */
-                        if (list->tag == DFTAG_NULL && look_tag != DFTAG_NULL)
-                            continue;
-
-                        if ((list->tag == look_tag ||
-                             (special_tag != DFTAG_NULL && list->tag == special_tag)) &&
-                            list->ref == look_ref) {
-                            /* we have a match !! */
-                            *pdd = list;
-                            HGOTO_DONE(SUCCEED);
-                        } /* end if */
-                    }     /* end for */
-
-                    /* start from beginning of the next dd list */
-                    idx = 0;
-                }                            /* end for */
-            }                                /* end else */
-        }                                    /* end if */
-        else if (direction == DF_BACKWARD) { /* search backward through the DD list */
-            if (*pdd == NULL) {
-                block = file_rec->ddlast;
-                idx   = block->ndds - 1;
+    /* Any other search may need to look at every DD in the file */
+    if (HTPload(file_rec) == FAIL)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+    if (look_tag != DFTAG_WILDCARD && look_tag != DFTAG_NULL) { /* ref is wildcard */
+        tag_info **tip_ptr;                      /* ptr to the ptr to the info for a tag */
+        TBBT_NODE *node;                         /* node in the DD order of the tag */
+        uint16     base_tag = BASETAG(look_tag); /* corresponding base tag (if the tag is special) */
+
+        if ((tip_ptr = (tag_info **)tbbtdfind(file_rec->tag_tree, (void *)&base_tag, NULL)) == NULL)
+            HGOTO_DONE(FAIL); /* Not an error, there are no objects with this tag */
+
+        /* Step through the DDs for the tag in DD list order, starting next to *pdd */
+        for (node = HTIorder_step((*tip_ptr)->order, *pdd, direction); node != NULL;
+             node = (direction == DF_FORWARD) ? tbbtnext(node) : tbbtprev(node)) {
+            dd_t *dd_ptr = (dd_t *)node->data;
+
+            if (dd_ptr->tag == look_tag || (special_tag != DFTAG_NULL && dd_ptr->tag == special_tag)) {
+                /* we have a match !! */
+                *pdd = dd_ptr;
+                HGOTO_DONE(SUCCEED);
+            } /* end if */
+        }     /* end for */
+    }         /* end if */
+    else if (look_tag == DFTAG_WILDCARD && look_ref != DFREF_WILDCARD) { /* tag is wildcard */
+        TBBT_NODE *node;         /* node in the tag tree */
+        dd_t      *found = NULL; /* closest matching DD so far */
+
+        /* Each tag has at most one DD with the ref, keep the one closest to *pdd */
+        for (node = tbbtfirst(file_rec->tag_tree->root); node != NULL; node = tbbtnext(node)) {
+            dd_t *dd_ptr = DAget_elem(((tag_info *)node->data)->d, (int)look_ref);
+
+            if (dd_ptr == NULL)
+                continue;
+            if (direction == DF_FORWARD) {
+                if ((*pdd == NULL || HTIddcompare(dd_ptr, *pdd, 0) > 0) &&
+                    (found == NULL || HTIddcompare(dd_ptr, found, 0) < 0))
+                    found = dd_ptr;
             } /* end if */
             else {
-                block = (*pdd)->blk;
-                idx   = ((*pdd) - &block->ddlist[0]) - 1;
+                if ((*pdd == NULL || HTIddcompare(dd_ptr, *pdd, 0) < 0) &&
+                    (found == NULL || HTIddcompare(dd_ptr, found, 0) > 0))
+                    found = dd_ptr;
             } /* end else */
-            for (; block;) {
-                list = block->ddlist;
-                for (; idx >= 0; idx--) {
+        }     /* end for */
+
+        if (found != NULL) {
+            /* we have a match !! */
+            *pdd = found;
+            HGOTO_DONE(SUCCEED);
+        } /* end if */
+    }     /* end if */
+    else if (direction == DF_FORWARD) { /* search forward through the DD list */
+        if (*pdd == NULL) {
+            block = file_rec->ddhead;
+            idx   = 0;
+        } /* end if */
+        else {
+            block = (*pdd)->blk;
+            idx   = ((*pdd) - &block->ddlist[0]) + 1;
+        } /* end else */
+        if (look_tag == DFTAG_WILDCARD) { /* Both tag & ref are wildcards */
+            for (; block; block = block->next) {
+                list = &block->ddlist[idx];
+                for (; idx < block->ndds; idx++, list++) {
                     /* skip the empty dd's */
-                    if (list[idx].tag == DFTAG_NULL && look_tag != DFTAG_NULL)
+                    if (list->tag == DFTAG_NULL)
                         continue;
 
-                    if (((look_tag == DFTAG_WILDCARD || list[idx].tag == look_tag) ||
-                         (special_tag != DFTAG_NULL && list[idx].tag == special_tag)) &&
-                        (look_ref == DFREF_WILDCARD || list[idx].ref == look_ref)) {
+                    /* we have a match !! (anything matches! :-) */
+                    *pdd = list;
+                    HGOTO_DONE(SUCCEED);
+                } /* end for */
 
+                /* start from beginning of the next dd list */
+                idx = 0;
+            } /* end for */
+        }     /* end if */
+        else { /* special case for quick lookup of empty DD's */
+            if (file_rec->ddnull == NULL)
+                block = file_rec->ddhead;
+            else
+                block = file_rec->ddnull;
+            if (file_rec->ddnull_idx < 0)
+                idx = 0;
+            else
+                idx = file_rec->ddnull_idx + 1;
+
+            for (; block; block = block->next) {
+                list = &block->ddlist[idx];
+                for (; idx < block->ndds; idx++, list++) {
+                    /* skip the empty dd's */
+                    if (list->tag == DFTAG_NULL) {
                         /* we have a match !! */
-                        *pdd = &list[idx];
+                        *pdd = list;
+
+                        /* Update the DFTAG_NULL pointers */
+                        file_rec->ddnull     = block;
+                        file_rec->ddnull_idx = idx;
+
                         HGOTO_DONE(SUCCEED);
                     } /* end if */
                 }     /* end for */
 
                 /* start from beginning of the next dd list */
-                block = block->prev;
-                if (block != NULL)
-                    idx = block->ndds - 1;
+                idx = 0;
             } /* end for */
-        }     /* end if */
-    }         /* end else */
+        }     /* end else */
+    }         /* end if */
+    else if (direction == DF_BACKWARD) { /* search backward through the DD list */
+        if (*pdd == NULL) {
+            block = file_rec->ddlast;
+            idx   = block->ndds - 1;
+        } /* end if */
+        else {
+            block = (*pdd)->blk;
+            idx   = ((*pdd) - &block->ddlist[0]) - 1;
+        } /* end else */
+        for (; block;) {
+            list = block->ddlist;
+            for (; idx >= 0; idx--) {
+                /* skip the empty dd's */
+                if (list[idx].tag == DFTAG_NULL && look_tag != DFTAG_NULL)
+                    continue;
+
+                if (look_tag == DFTAG_WILDCARD || list[idx].tag == look_tag) {
+                    /* we have a match !! */
+                    *pdd = &list[idx];
+                    HGOTO_DONE(SUCCEED);
+                } /* end if */
+            }     /* end for */
+
+            /* start from beginning of the next dd list */
+            block = block->prev;
+            if (block != NULL)
+                idx = block->ndds - 1;
+        } /* end for */
+    }     /* end if */
 
     /* If we get here, we've failed */
     ret_value = FAIL;
@@ -1714,9 +1798,9 @@ HTIupdate_dd(filerec_t *file_rec, dd_t *dd_ptr)
         block->dirty = TRUE;
     } /* end if */
     else {
-        int32  offset;      /* offset of updated dd in file */
-        uint8  tbuf[DD_SZ]; /* storage for the DD */
-        uint8 *p;           /* temp buffer ptr */
+        hdf_off_t offset;      /* offset of updated dd in file */
+        uint8     tbuf[DD_SZ]; /* storage for the DD */
+        uint8    *p;           /* temp buffer ptr */
 
         /* look for offset of updated dd block in the file */
         offset = block->myoffset + (NDDS_SZ + OFFSET_SZ) + (idx * DD_SZ);
@@ -1780,35 +1864,40 @@ HTIcount_dd(filerec_t *file_rec, uint16 cnt_tag, uint16 cnt_ref, unsigned *all_c
     int        idx;            /* index into ddlist of current dd searched */
     ddblock_t *block;          /* ptr to current ddblock searched */
     dd_t      *dd_ptr;         /* ptr to current ddlist searched */
+    tag_info  *tinfo_ptr;      /* pointer to the info for a tag */
     uint16     special_tag;    /* corresponding special tag */
+    int        ret_value = SUCCEED;
 
     HEclear();
+    /* Counting needs every DD in the file */
+    if (HTPload(file_rec) == FAIL)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
     /* search for special version also */
     special_tag = MKSPECIALTAG(cnt_tag);
 
-    /* Change these algorithms to take advantage of the dynamic arrays for tags -QAK */
-    switch (cnt_tag) {
-        case DFTAG_WILDCARD:
-            for (block = file_rec->ddhead; block != NULL; block = block->next) {
-                t_all_cnt += (unsigned)block->ndds;
-
-                dd_ptr = block->ddlist;
-                for (idx = 0; idx < block->ndds; idx++, dd_ptr++) {
-                    /* skip the empty dd's */
-                    if (dd_ptr->tag == DFTAG_NULL || dd_ptr->tag == DFTAG_FREE)
-                        continue;
+    /* Every slot in the DD list counts towards the total */
+    for (block = file_rec->ddhead; block != NULL; block = block->next)
+        t_all_cnt += (unsigned)block->ndds;
 
-                    if ((cnt_ref == DFREF_WILDCARD || dd_ptr->ref == cnt_ref))
-                        t_real_cnt++;
-                } /* end for */
-            }     /* end for */
-            break;
+    switch (cnt_tag) {
+        case DFTAG_WILDCARD: {
+            TBBT_NODE *node; /* node in the tag tree */
+
+            /* The DFTAG_NULL DD's are not in the tag tree, only DFTAG_FREE needs to be skipped */
+            for (node = tbbtfirst(file_rec->tag_tree->root); node != NULL; node = tbbtnext(node)) {
+                tinfo_ptr = (tag_info *)node->data;
+                if (cnt_ref == DFREF_WILDCARD)
+                    t_real_cnt += (unsigned)(tinfo_ptr->tag == DFTAG_FREE ? tinfo_ptr->nspecial
+                                                                          : tinfo_ptr->nrefs);
+                else if ((dd_ptr = DAget_elem(tinfo_ptr->d, (int)cnt_ref)) != NULL &&
+                         dd_ptr->tag != DFTAG_FREE)
+                    t_real_cnt++;
+            } /* end for */
+        } break;
 
         case DFTAG_NULL:
-        case DFTAG_FREE:
             for (block = file_rec->ddhead; block != NULL; block = block->next) {
-                t_all_cnt += (unsigned)block->ndds;
-
                 dd_ptr = block->ddlist;
                 for (idx = 0; idx < block->ndds; idx++, dd_ptr++)
                     if ((dd_ptr->tag == cnt_tag ||
@@ -1818,58 +1907,32 @@ HTIcount_dd(filerec_t *file_rec, uint16 cnt_tag, uint16 cnt_ref, unsigned *all_c
             } /* end for */
             break;
 
-        default:
-            if (special_tag == DFTAG_NULL) {
-                for (block = file_rec->ddhead; block != NULL; block = block->next) {
-                    t_all_cnt += (unsigned)block->ndds;
+        default: {
+            tag_info **tip_ptr;                     /* ptr to the ptr to the info for a tag */
+            uint16     base_tag = BASETAG(cnt_tag); /* corresponding base tag (if the tag is special) */
 
-                    dd_ptr = block->ddlist;
-                    for (idx = 0; idx < block->ndds; idx++, dd_ptr++)
-                        if (dd_ptr->tag == cnt_tag && (dd_ptr->ref == cnt_ref || cnt_ref == DFREF_WILDCARD))
-                            t_real_cnt++;
-                } /* end for */
-            }     /* end if */
-            else {
-                if (cnt_ref == DFREF_WILDCARD) {
-                    for (block = file_rec->ddhead; block != NULL; block = block->next) {
-                        t_all_cnt += (unsigned)block->ndds;
-
-                        idx    = 0;
-                        dd_ptr = block->ddlist;
-                        if (block->ndds % 2 == 1)
-                            if (dd_ptr->tag == cnt_tag || dd_ptr->tag == special_tag) {
-                                t_real_cnt++;
-                                idx++;
-                                dd_ptr++;
-                            } /* end if */
-                        for (; idx < block->ndds; idx++, dd_ptr++) {
-                            if (dd_ptr->tag == cnt_tag || dd_ptr->tag == special_tag)
-                                t_real_cnt++;
-                            idx++;
-                            dd_ptr++;
-                            if (dd_ptr->tag == cnt_tag || dd_ptr->tag == special_tag)
-                                t_real_cnt++;
-                        } /* end for */
-                    }     /* end for */
-                }         /* end if */
-                else {
-                    for (block = file_rec->ddhead; block != NULL; block = block->next) {
-                        t_all_cnt += (unsigned)block->ndds;
-
-                        dd_ptr = block->ddlist;
-                        for (idx = 0; idx < block->ndds; idx++, dd_ptr++)
-                            if ((dd_ptr->tag == cnt_tag || dd_ptr->tag == special_tag) &&
-                                dd_ptr->ref == cnt_ref)
-                                t_real_cnt++;
-                    } /* end for */
-                }     /* end else */
-            }         /* end else */
-            break;
+            if ((tip_ptr = (tag_info **)tbbtdfind(file_rec->tag_tree, (void *)&base_tag, NULL)) == NULL)
+                break; /* no objects with this tag */
+            tinfo_ptr = *tip_ptr;
+
+            if (cnt_ref == DFREF_WILDCARD) {
+                /* A special tag only counts the special DD's, otherwise both kinds count */
+                if (special_tag == cnt_tag)
+                    t_real_cnt = (unsigned)tinfo_ptr->nspecial;
+                else
+                    t_real_cnt = (unsigned)tinfo_ptr->nrefs;
+            } /* end if */
+            else if ((dd_ptr = DAget_elem(tinfo_ptr->d, (int)cnt_ref)) != NULL &&
+                     (dd_ptr->tag == cnt_tag || (special_tag != DFTAG_NULL && dd_ptr->tag == special_tag)))
+                t_real_cnt = 1;
+        } break;
     } /* end switch */
 
     *all_cnt  = t_all_cnt;
     *real_cnt = t_real_cnt;
-    return SUCCEED;
+
+done:
+    return ret_value;
 } /* HTIcount_dd */
 
 /*--------------------------------------------------------------------------
@@ -1888,7 +1951,8 @@ HTIcount_dd(filerec_t *file_rec, uint16 cnt_tag, uint16 cnt_ref, unsigned *all_c
 static int
 HTIregister_tag_ref(filerec_t *file_rec, dd_t *dd_ptr)
 {
-    tag_info  *tinfo_ptr;                        /* pointer to the info for a tag */
+    tag_info  *tinfo_ptr = NULL;                 /* pointer to the info for a tag */
+    tag_info  *new_tinfo = NULL;                 /* info for a tag not yet in the tag tree */
     tag_info **tip_ptr;                          /* ptr to the ptr to the info for a tag */
     uint16     base_tag  = BASETAG(dd_ptr->tag); /* the base tag for the tag tree */
     int        ret_value = SUCCEED;
@@ -1897,13 +1961,10 @@ HTIregister_tag_ref(filerec_t *file_rec, dd_t *dd_ptr)
     /* Add to the tag info tree */
     if ((tip_ptr = (tag_info **)tbbtdfind(file_rec->tag_tree, (void *)&base_tag, NULL)) ==
         NULL) { /* a new tag was found */
-        if ((tinfo_ptr = (tag_info *)calloc(1, sizeof(tag_info))) == NULL)
+        if ((tinfo_ptr = new_tinfo = (tag_info *)calloc(1, sizeof(tag_info))) == NULL)
             HGOTO_ERROR(DFE_NOSPACE, FAIL);
         tinfo_ptr->tag = base_tag;
 
-        /* Insert the tag node into the tree */
-        tbbtdins(file_rec->tag_tree, (void *)tinfo_ptr, NULL);
-
         /* Take care of the bit-vector */
         if ((tinfo_ptr->b = bv_new(-1)) == NULL)
             HGOTO_ERROR(DFE_BVNEW, FAIL);
@@ -1915,6 +1976,10 @@ HTIregister_tag_ref(filerec_t *file_rec, dd_t *dd_ptr)
         /* Take care of the dynarray */
         if ((tinfo_ptr->d = DAcreate_array(REF_DYNARRAY_START, REF_DYNARRAY_INCR)) == NULL)
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+        /* Take care of the DD order tree */
+        if ((tinfo_ptr->order = tbbtdmake(HTIddcompare, 0, 0)) == NULL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
     }                /* end if */
     else {           /* found an existing tag */
         int ref_bit; /* bit of the ref # in the tag info */
@@ -1934,11 +1999,24 @@ HTIregister_tag_ref(filerec_t *file_rec, dd_t *dd_ptr)
     if (DAset_elem(tinfo_ptr->d, (int)dd_ptr->ref, (void *)dd_ptr) == FAIL)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
+    /* Insert the DD into the DD order for the tag */
+    if (tbbtdins(tinfo_ptr->order, (void *)dd_ptr, NULL) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    tinfo_ptr->nrefs++;
+    if (SPECIALTAG(dd_ptr->tag))
+        tinfo_ptr->nspecial++;
+
+    /* Insert the tag node into the tree, now that it is complete */
+    if (new_tinfo != NULL) {
+        tbbtdins(file_rec->tag_tree, (void *)new_tinfo, NULL);
+        new_tinfo = NULL;
+    } /* end if */
+
 done:
     if (ret_value == FAIL) { /* Error condition cleanup */
-
-        if ((tinfo_ptr != NULL) && (tinfo_ptr->d != NULL))
-            DAdestroy_array(tinfo_ptr->d, 0);
+        /* Only a tag which isn't in the tag tree yet is thrown away */
+        if (new_tinfo != NULL)
+            tagdestroynode(new_tinfo);
     }
 
     return ret_value;
@@ -1985,6 +2063,13 @@ HTIunregister_tag_ref(filerec_t *file_rec, dd_t *dd_ptr)
         if (DAdel_elem(tinfo_ptr->d, (int)dd_ptr->ref) == NULL)
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
+        /* Delete the DD from the DD order for the tag */
+        if (tbbtrem(&tinfo_ptr->order->root, tbbtdfind(tinfo_ptr->order, (void *)dd_ptr, NULL), NULL) == NULL)
+            HGOTO_ERROR(DFE_INTERNAL, FAIL);
+        tinfo_ptr->nrefs--;
+        if (SPECIALTAG(dd_ptr->tag))
+            tinfo_ptr->nspecial--;
+
         /* Delete the tag/ref from the file */
         dd_ptr->tag = DFTAG_NULL;
     } /* end else */
@@ -1993,6 +2078,66 @@ done:
     return ret_value;
 } /* HTIunregister_tag_ref */
 
+/*--------------------------------------------------------------------------
+ NAME
+    HTIorder_step -- find the next/previous DD in a tag's DD order
+ USAGE
+    TBBT_NODE *HTIorder_step(order, from, direction)
+        TBBT_TREE *order;       IN: DD order tree of a tag
+        dd_t      *from;        IN: DD to start next to, NULL to start at the
+                                    beginning (or end) of the DD list
+        int        direction;   IN: direction to search
+                                    (DF_FORWARD / DF_BACKWARD)
+ RETURNS
+    The node of the first DD in the tree after (DF_FORWARD) or before
+    (DF_BACKWARD) 'from' in the DD list, or NULL if there is none.
+ DESCRIPTION
+    'from' doesn't have to be in the tree, so that a search for one tag can
+    carry on from a DD with a different tag.
+
+--------------------------------------------------------------------------*/
+static TBBT_NODE *
+HTIorder_step(TBBT_TREE *order, dd_t *from, int direction)
+{
+    TBBT_NODE *node;   /* node of 'from' in the tree */
+    TBBT_NODE *parent; /* node the search for 'from' stopped at */
+
+    if (from == NULL)
+        return (direction == DF_FORWARD) ? tbbtfirst(order->root) : tbbtlast(order->root);
+
+    if ((node = tbbtdfind(order, (void *)from, &parent)) != NULL)
+        return (direction == DF_FORWARD) ? tbbtnext(node) : tbbtprev(node);
+    if (parent == NULL) /* the tree is empty */
+        return NULL;
+
+    /* 'from' sits between the node the search stopped at and one of its neighbors */
+    if (HTIddcompare(from, parent->key, 0) < 0)
+        return (direction == DF_FORWARD) ? parent : tbbtprev(parent);
+    else
+        return (direction == DF_FORWARD) ? tbbtnext(parent) : parent;
+} /* HTIorder_step */
+
+/* ---------------------------- HTIddcompare ------------------------- */
+/*
+   Compares the positions of two DDs in the DD list.  Similar to memcmp.
+
+   *** Only called by B-tree routines and the DD search routines ***
+ */
+static int
+HTIddcompare(void *k1, void *k2, int cmparg)
+{
+    const dd_t *dd1 = (const dd_t *)k1;
+    const dd_t *dd2 = (const dd_t *)k2;
+
+    (void)cmparg;
+
+    if (dd1->blk != dd2->blk)
+        return (dd1->blk->seq < dd2->blk->seq) ? -1 : 1;
+    if (dd1 == dd2)
+        return 0;
+    return (dd1 < dd2) ? -1 : 1;
+} /* HTIddcompare */
+
 /* ---------------------------- tagcompare ------------------------- */
 /*
    Compares two tag B-tree keys for equality.  Similar to memcmp.
@@ -2026,5 +2171,7 @@ tagdestroynode(void *n)
         bv_delete(t->b);
     if (t->d != NULL)
         DAdestroy_array(t->d, 0);
+    if (t->order != NULL)
+        tbbtdfree(t->order, NULL, NULL);
     free(n);
 } /* tagdestroynode */
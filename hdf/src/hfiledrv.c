@@ -0,0 +1,408 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright by The HDF Group.                                               *
+ *                                                                           *
+ * This file is part of HDF.  The full HDF copyright notice, including       *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the root of the source code       *
+ * distribution tree, or in https://support.hdfgroup.org/ftp/HDF/releases/.  *
+ * If you do not have access to either file, you may request a copy from     *
+ * help@hdfgroup.org.                                                        *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*
+ * Low-level file drivers for HDF files
+ *
+ * Each driver moves raw bytes between an open HDF file and memory.  The
+ * driver used for a file is chosen when the file is opened (see
+ * Hsetfiledriver) and kept in the file record, so HP_read, HPseek and
+ * HP_write never need to know which one is in use.
+ *
+ * PRIVATE ROUTINES
+ *  HPinit_fhandle   -- reset a driver handle to the "not open" state
+ *  HPget_fdriver    -- get the driver table for a DFDRV_xxx code
+ *  HPselect_fdriver -- get the driver to use for a given access mode
+ */
+
+/* preadv() isn't part of POSIX, so glibc hides it when only
+   _POSIX_C_SOURCE is defined */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <errno.h>
+#include <string.h>
+
+#include "hdf_priv.h"
+#include "hfile_priv.h"
+
+#if defined(H4_HAVE_PREAD) && defined(H4_HAVE_PWRITE) && defined(H4_HAVE_UNISTD_H) && defined(H4_HAVE_FCNTL_H)
+#define H4_HAVE_POSIX_DRIVER
+#endif
+
+#if defined(H4_HAVE_POSIX_DRIVER) && defined(H4_HAVE_PREADV) && defined(H4_HAVE_SYS_UIO_H)
+#define H4_HAVE_POSIX_READV
+#include <sys/uio.h>
+
+/* Most buffers passed to one preadv() call */
+#define POSIX_READV_IOV 64
+#endif
+
+#if defined(H4_HAVE_POSIX_DRIVER) && defined(H4_HAVE_MMAP) && defined(H4_HAVE_SYS_MMAN_H)
+#define H4_HAVE_MMAP_DRIVER
+#include <sys/mman.h>
+#endif
+
+/* ------------------------------ stdio driver ----------------------------- */
+
+static int
+stdio_open(hdf_fhandle_t *fh, const char *path, int acc_mode)
+{
+    fh->fp = (acc_mode & DFACC_WRITE) ? fopen(path, "rb+") : fopen(path, "rb");
+    return fh->fp == NULL ? FAIL : SUCCEED;
+}
+
+static int
+stdio_create(hdf_fhandle_t *fh, const char *path)
+{
+    fh->fp = fopen(path, "wb+");
+    return fh->fp == NULL ? FAIL : SUCCEED;
+}
+
+static int
+stdio_close(hdf_fhandle_t *fh)
+{
+    int ret_value = SUCCEED;
+
+    if (fh->fp != NULL) {
+        if (fclose(fh->fp) == EOF)
+            ret_value = FAIL;
+        fh->fp = NULL;
+    }
+    return ret_value;
+}
+
+static int
+stdio_flush(hdf_fhandle_t *fh)
+{
+    return fflush(fh->fp) == 0 ? SUCCEED : FAIL;
+}
+
+static int
+stdio_seek(hdf_fhandle_t *fh, hdf_off_t offset)
+{
+#ifdef H4_HAVE_WIN32_API
+    return _fseeki64(fh->fp, (__int64)offset, SEEK_SET) == 0 ? SUCCEED : FAIL;
+#else
+    return fseeko(fh->fp, (off_t)offset, SEEK_SET) == 0 ? SUCCEED : FAIL;
+#endif
+}
+
+/* The stream is already positioned by stdio_seek, so the offset is unused */
+static int
+stdio_read(hdf_fhandle_t *fh, hdf_off_t offset, void *buf, int32 bytes)
+{
+    (void)offset;
+    return (size_t)bytes == fread(buf, 1, (size_t)bytes, fh->fp) ? SUCCEED : FAIL;
+}
+
+static int
+stdio_write(hdf_fhandle_t *fh, hdf_off_t offset, const void *buf, int32 bytes)
+{
+    (void)offset;
+    return (size_t)bytes == fwrite(buf, 1, (size_t)bytes, fh->fp) ? SUCCEED : FAIL;
+}
+
+static const hdf_fdriver_t stdio_driver = {DFDRV_STDIO, "stdio",     stdio_open,  stdio_create,
+                                           stdio_close, stdio_flush, stdio_seek, stdio_read,
+                                           stdio_write, NULL};
+
+/* ------------------------------ POSIX driver ----------------------------- */
+
+#ifdef H4_HAVE_POSIX_DRIVER
+
+static int
+posix_open(hdf_fhandle_t *fh, const char *path, int acc_mode)
+{
+    fh->fd = (acc_mode & DFACC_WRITE) ? open(path, O_RDWR) : open(path, O_RDONLY);
+    return fh->fd < 0 ? FAIL : SUCCEED;
+}
+
+static int
+posix_create(hdf_fhandle_t *fh, const char *path)
+{
+    fh->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    return fh->fd < 0 ? FAIL : SUCCEED;
+}
+
+static int
+posix_close(hdf_fhandle_t *fh)
+{
+    int ret_value = SUCCEED;
+
+    if (fh->fd >= 0) {
+        if (close(fh->fd) != 0)
+            ret_value = FAIL;
+        fh->fd = -1;
+    }
+    return ret_value;
+}
+
+/* Nothing is buffered in user space, so there is nothing to flush */
+static int
+posix_flush(hdf_fhandle_t *fh)
+{
+    (void)fh;
+    return SUCCEED;
+}
+
+static int
+posix_read(hdf_fhandle_t *fh, hdf_off_t offset, void *buf, int32 bytes)
+{
+    uint8 *p    = (uint8 *)buf;
+    size_t left = (size_t)bytes;
+    off_t  off  = (off_t)offset;
+
+    while (left > 0) {
+        ssize_t n = pread(fh->fd, p, left, off);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return FAIL;
+        }
+        if (n == 0) /* EOF before the request was satisfied */
+            return FAIL;
+        p += n;
+        off += n;
+        left -= (size_t)n;
+    }
+    return SUCCEED;
+}
+
+static int
+posix_write(hdf_fhandle_t *fh, hdf_off_t offset, const void *buf, int32 bytes)
+{
+    const uint8 *p    = (const uint8 *)buf;
+    size_t       left = (size_t)bytes;
+    off_t        off  = (off_t)offset;
+
+    while (left > 0) {
+        ssize_t n = pwrite(fh->fd, p, left, off);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return FAIL;
+        }
+        p += n;
+        off += n;
+        left -= (size_t)n;
+    }
+    return SUCCEED;
+}
+
+#ifdef H4_HAVE_POSIX_READV
+/* Reads the pieces POSIX_READV_IOV at a time, since they follow each other
+   in the file; preadv() may stop short, so pick up where it stopped */
+static int
+posix_readv(hdf_fhandle_t *fh, const hdf_extent_t *ext, int n)
+{
+    struct iovec iov[POSIX_READV_IOV];
+
+    while (n > 0) {
+        struct iovec *v    = iov;
+        int           nv   = MIN(n, POSIX_READV_IOV);
+        off_t         off  = (off_t)ext[0].offset;
+        size_t        left = 0;
+
+        for (int i = 0; i < nv; i++) {
+            iov[i].iov_base = ext[i].buf;
+            iov[i].iov_len  = (size_t)ext[i].len;
+            left += iov[i].iov_len;
+        }
+        ext += nv;
+        n -= nv;
+
+        while (left > 0) {
+            ssize_t got = preadv(fh->fd, v, nv, off);
+
+            if (got < 0) {
+                if (errno == EINTR)
+                    continue;
+                return FAIL;
+            }
+            if (got == 0) /* EOF before the request was satisfied */
+                return FAIL;
+            off += got;
+            left -= (size_t)got;
+            while (nv > 0 && (size_t)got >= v->iov_len) {
+                got -= (ssize_t)v->iov_len;
+                v++;
+                nv--;
+            }
+            if (nv > 0) {
+                v->iov_base = (uint8 *)v->iov_base + got;
+                v->iov_len -= (size_t)got;
+            }
+        }
+    }
+    return SUCCEED;
+}
+#else
+#define posix_readv NULL
+#endif /* H4_HAVE_POSIX_READV */
+
+static const hdf_fdriver_t posix_driver = {DFDRV_POSIX, "posix",     posix_open,  posix_create,
+                                           posix_close, posix_flush, NULL,        posix_read,
+                                           posix_write, posix_readv};
+
+#endif /* H4_HAVE_POSIX_DRIVER */
+
+/* ------------------------------ mmap driver ------------------------------ */
+
+#ifdef H4_HAVE_MMAP_DRIVER
+
+/* The descriptor is only needed to create the mapping */
+static int
+mmap_open(hdf_fhandle_t *fh, const char *path, int acc_mode)
+{
+    struct stat sb;
+    int         fd;
+    int         ret_value = SUCCEED;
+
+    if (acc_mode & DFACC_WRITE)
+        return FAIL;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return FAIL;
+
+    if (fstat(fd, &sb) != 0)
+        HGOTO_DONE(FAIL);
+
+    fh->map      = NULL;
+    fh->map_size = (size_t)sb.st_size;
+    if (fh->map_size > 0) {
+        void *map = mmap(NULL, fh->map_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (map == MAP_FAILED)
+            HGOTO_DONE(FAIL);
+        fh->map = (uint8 *)map;
+    }
+
+done:
+    close(fd);
+    return ret_value;
+}
+
+static int
+mmap_close(hdf_fhandle_t *fh)
+{
+    int ret_value = SUCCEED;
+
+    if (fh->map != NULL) {
+        if (munmap(fh->map, fh->map_size) != 0)
+            ret_value = FAIL;
+        fh->map = NULL;
+    }
+    fh->map_size = 0;
+    return ret_value;
+}
+
+static int
+mmap_flush(hdf_fhandle_t *fh)
+{
+    (void)fh;
+    return SUCCEED;
+}
+
+static int
+mmap_read(hdf_fhandle_t *fh, hdf_off_t offset, void *buf, int32 bytes)
+{
+    if (offset < 0 || bytes < 0 || (uint64_t)offset > (uint64_t)fh->map_size ||
+        (size_t)bytes > fh->map_size - (size_t)offset)
+        return FAIL;
+    if (bytes > 0)
+        memcpy(buf, fh->map + offset, (size_t)bytes);
+    return SUCCEED;
+}
+
+static const hdf_fdriver_t mmap_driver = {DFDRV_MMAP, "mmap", mmap_open, NULL, mmap_close,
+                                          mmap_flush, NULL,   mmap_read, NULL, NULL};
+
+#endif /* H4_HAVE_MMAP_DRIVER */
+
+/* ------------------------------------------------------------------------- */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HPinit_fhandle -- reset a driver handle to the "not open" state
+ USAGE
+    void HPinit_fhandle(fh)
+        hdf_fhandle_t *fh;          IN/OUT: handle to reset
+ DESCRIPTION
+    Clears every driver's member of the handle, so that a driver's close
+    routine can safely be called on a handle that was never opened.
+--------------------------------------------------------------------------*/
+void
+HPinit_fhandle(hdf_fhandle_t *fh)
+{
+    fh->fp       = NULL;
+    fh->fd       = -1;
+    fh->map      = NULL;
+    fh->map_size = 0;
+} /* HPinit_fhandle */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HPget_fdriver -- get the driver table for a DFDRV_xxx code
+ USAGE
+    const hdf_fdriver_t *HPget_fdriver(type)
+        int type;                   IN: DFDRV_xxx code of the driver
+ RETURNS
+    The driver table, or NULL if the driver is unknown or was not built
+    on this platform.
+--------------------------------------------------------------------------*/
+const hdf_fdriver_t *
+HPget_fdriver(int type)
+{
+    switch (type) {
+        case DFDRV_STDIO:
+            return &stdio_driver;
+#ifdef H4_HAVE_POSIX_DRIVER
+        case DFDRV_POSIX:
+            return &posix_driver;
+#endif
+#ifdef H4_HAVE_MMAP_DRIVER
+        case DFDRV_MMAP:
+            return &mmap_driver;
+#endif
+        default:
+            return NULL;
+    }
+} /* HPget_fdriver */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HPselect_fdriver -- get the driver to use for a given access mode
+ USAGE
+    const hdf_fdriver_t *HPselect_fdriver(type, acc_mode)
+        int type;                   IN: DFDRV_xxx code of the requested driver
+        int acc_mode;               IN: DFACC_xxx access the file is opened with
+ RETURNS
+    The driver table, or NULL if the driver is unknown.
+ DESCRIPTION
+    Read-only drivers cannot be used to create or write a file; in that
+    case the positional driver is used instead if it is available, else
+    the stdio driver.
+--------------------------------------------------------------------------*/
+const hdf_fdriver_t *
+HPselect_fdriver(int type, int acc_mode)
+{
+    const hdf_fdriver_t *drv = HPget_fdriver(type);
+
+    if (drv != NULL && drv->write == NULL && (acc_mode & (DFACC_WRITE | DFACC_CREATE))) {
+        if ((drv = HPget_fdriver(DFDRV_POSIX)) == NULL)
+            drv = HPget_fdriver(DFDRV_STDIO);
+    }
+    return drv;
+} /* HPselect_fdriver */
@@ -151,7 +151,7 @@ HDflush(int32 file_id)
     if (BADFREC(file_rec))
         HRETURN_ERROR(DFE_ARGS, FAIL);
 
-    HI_FLUSH(file_rec->file);
+    file_rec->driver->flush(&file_rec->fh);
 
     return SUCCEED;
 } /* HDflush */
@@ -97,6 +97,7 @@ static const tag_descript_t tag_descriptions[] = {
     {DFTAG_SDC, string(DFTAG_SDC), "SciData coordsys"},
     {DFTAG_SDT, string(DFTAG_SDT), "Transpose"},
     {DFTAG_SDLNK, string(DFTAG_SDLNK), "Links related to the dataset"},
+    {DFTAG_SDIDX, string(DFTAG_SDIDX), "Index of the SD metadata"},
     {DFTAG_NDG, string(DFTAG_NDG), "Numeric Data Group"},
     {DFTAG_CAL, string(DFTAG_CAL), "Calibration information"},
     {DFTAG_FV, string(DFTAG_FV), "Fill value information"},
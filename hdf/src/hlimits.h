@@ -94,6 +94,12 @@
 #define MAX_PATH_LEN 1024
 #endif /* MAX_PATH_LEN */
 
+/* Maximum number of external files kept open between accesses (used in
+   hextelt.c) */
+#ifndef MAX_EXT_FILES
+#define MAX_EXT_FILES 64
+#endif /* MAX_EXT_FILES */
+
 /* ndds (number of dd's in a block) default,
    so user need not specify */
 #ifndef DEF_NDDS
@@ -114,6 +120,19 @@
 #define HDF_APPENDABLE_BLOCK_LEN 4096
 #define HDF_APPENDABLE_BLOCK_NUM 16
 
+/* Most bytes reserved at once for the new blocks of a linked-block element,
+   so that blocks appended one at a time end up next to each other in the
+   file (used in hblocks.c) */
+#ifndef HDF_LINKED_RUN_MAX
+#define HDF_LINKED_RUN_MAX 262144
+#endif /* HDF_LINKED_RUN_MAX */
+
+/* Largest hole between two pieces of a vectored read which is read through
+   and thrown away rather than starting another read (used in hfile.c) */
+#ifndef HDF_READV_GAP
+#define HDF_READV_GAP 4096
+#endif /* HDF_READV_GAP */
+
 /* hashing information */
 #define HASH_MASK       0xff
 #define HASH_BLOCK_SIZE 100
@@ -122,14 +141,26 @@
 
 /*
  * Private conversion buffer stuff
- * VDATA_BUFFER_MAX is the largest buffer that can be allocated for
- *   writing (haven't implemented reading yet).
- * Vtbuf is the buffer
- * Vtbufsize is the buffer size in bytes at any given time.
- * Vtbuf is increased in size as need be
- * BUG: the final Vtbuf never gets freed
+ * VDATA_BUFFER_MAX is the largest buffer that VSread and VSwrite allocate
+ *   for reading and writing full interlaced records (plus one record).
+ * Vtbuf is each thread's buffer; it's increased in size as need be.
+ * VDATA_SCRATCH_MAX is the default largest Vtbuf kept between calls of
+ *   VSread and VSwrite; larger ones are freed (see VSsetscratchmax).
+ */
+#define VDATA_BUFFER_MAX  1000000
+#define VDATA_SCRATCH_MAX (2 * VDATA_BUFFER_MAX)
+
+/* ------------------------- Constants for GR interface --------------------- */
+
+/*
+ * GR_STAGE_MAX is the largest buffer (of each kind) that GRreadimage and
+ *   GRwriteimage allocate for converting the number type or interlace of an
+ *   image; larger images are converted a band of rows at a time.  A buffer
+ *   always holds at least one row.
  */
-#define VDATA_BUFFER_MAX 1000000
+#ifndef GR_STAGE_MAX
+#define GR_STAGE_MAX 1048576
+#endif /* GR_STAGE_MAX */
 
 /* --------------------- Constants for DFSDxx interface --------------------- */
 
@@ -0,0 +1,197 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright by The HDF Group.                                               *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of HDF.  The full HDF copyright notice, including       *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the root of the source code       *
+ * distribution tree, or in https://support.hdfgroup.org/ftp/HDF/releases/.  *
+ * If you do not have access to either file, you may request a copy from     *
+ * help@hdfgroup.org.                                                        *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*
+FILE
+    hnameidx.c - Hashed index of the names of the objects in a file
+
+REMARKS
+    The SD, GR and Vset interfaces keep one index for each kind of object
+    in an open file, so that looking an object up by name doesn't search
+    through all of the objects.  An interface builds its index the first
+    time it's searched, then adds, renames and removes objects in it as
+    they're created, renamed and deleted.
+
+DESIGN
+    The index is a hash table of chained entries, each holding one object's
+    name and key.  The table doubles in size when it holds more entries
+    than it has chains.
+
+EXPORTED ROUTINES
+    HNIcreate  - create an empty name index
+    HNIdestroy - free a name index
+    HNIadd     - add an object's name to a name index
+    HNIremove  - remove an object's name from a name index
+    HNIfind    - look up a name in a name index
+*/
+
+#include "hdf_priv.h"
+#include "hnameidx_priv.h"
+
+/* Initial # of chains in the table, a power of 2 */
+#define HNI_TABLE_SIZE 64
+
+/* One object in the index */
+typedef struct HNIentry_tag {
+    struct HNIentry_tag *next; /* next entry in the chain */
+    uint32               hash; /* hash of the name */
+    int32                key;  /* key of the object */
+    char                 name[];
+} HNIentry_t;
+
+typedef struct HNIindex_tag {
+    uint32       size;     /* # of chains in table */
+    uint32       nentries; /* # of entries in the index */
+    HNIentry_t **table;    /* the chains */
+} HNIindex_t;
+
+/* FNV-1a hash of a name */
+static uint32
+HNIhash(const char *name)
+{
+    uint32 hash = 2166136261U;
+
+    for (const uint8 *p = (const uint8 *)name; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 16777619U;
+    }
+    return hash;
+} /* HNIhash */
+
+HNIindex_p
+HNIcreate(void)
+{
+    HNIindex_t *idx       = NULL;
+    HNIindex_p  ret_value = NULL;
+
+    if (NULL == (idx = (HNIindex_t *)malloc(sizeof(HNIindex_t))))
+        HGOTO_ERROR(DFE_NOSPACE, NULL);
+    idx->size     = HNI_TABLE_SIZE;
+    idx->nentries = 0;
+    if (NULL == (idx->table = (HNIentry_t **)calloc(idx->size, sizeof(HNIentry_t *)))) {
+        free(idx);
+        HGOTO_ERROR(DFE_NOSPACE, NULL);
+    }
+
+    ret_value = idx;
+
+done:
+    return ret_value;
+} /* HNIcreate */
+
+void
+HNIdestroy(HNIindex_p idx)
+{
+    HNIentry_t *ent, *next;
+
+    if (idx == NULL)
+        return;
+
+    for (uint32 i = 0; i < idx->size; i++)
+        for (ent = idx->table[i]; ent != NULL; ent = next) {
+            next = ent->next;
+            free(ent);
+        }
+    free(idx->table);
+    free(idx);
+} /* HNIdestroy */
+
+int
+HNIadd(HNIindex_p idx, const char *name, int32 key)
+{
+    HNIentry_t  *ent      = NULL;
+    HNIentry_t **newtable = NULL;
+    size_t       len;
+    uint32       chain;
+    int          ret_value = SUCCEED;
+
+    if (idx == NULL || name == NULL || key < 0)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    /* Double the table when it gets full; if it can't be, the chains just
+       get longer */
+    if (idx->nentries >= idx->size && idx->size < 0x40000000 &&
+        NULL != (newtable = (HNIentry_t **)calloc(idx->size * 2, sizeof(HNIentry_t *)))) {
+        for (uint32 i = 0; i < idx->size; i++) {
+            HNIentry_t *next;
+
+            for (ent = idx->table[i]; ent != NULL; ent = next) {
+                chain           = ent->hash & (idx->size * 2 - 1);
+                next            = ent->next;
+                ent->next       = newtable[chain];
+                newtable[chain] = ent;
+            }
+        }
+        free(idx->table);
+        idx->table = newtable;
+        idx->size *= 2;
+    }
+
+    len = strlen(name);
+    if (NULL == (ent = (HNIentry_t *)malloc(sizeof(HNIentry_t) + len + 1)))
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    ent->hash = HNIhash(name);
+    ent->key  = key;
+    memcpy(ent->name, name, len + 1);
+
+    chain             = ent->hash & (idx->size - 1);
+    ent->next         = idx->table[chain];
+    idx->table[chain] = ent;
+    idx->nentries++;
+
+done:
+    return ret_value;
+} /* HNIadd */
+
+int
+HNIremove(HNIindex_p idx, const char *name, int32 key)
+{
+    HNIentry_t **entp;
+    HNIentry_t  *ent;
+    uint32       hash;
+    int          ret_value = FAIL;
+
+    if (idx == NULL || name == NULL)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    hash = HNIhash(name);
+    for (entp = &idx->table[hash & (idx->size - 1)]; (ent = *entp) != NULL; entp = &ent->next)
+        if (ent->key == key && ent->hash == hash && strcmp(ent->name, name) == 0) {
+            *entp = ent->next;
+            free(ent);
+            idx->nentries--;
+            HGOTO_DONE(SUCCEED);
+        }
+
+done:
+    return ret_value;
+} /* HNIremove */
+
+int32
+HNIfind(HNIindex_p idx, const char *name)
+{
+    HNIentry_t *ent;
+    uint32      hash;
+    int32       ret_value = FAIL;
+
+    if (idx == NULL || name == NULL)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    /* Objects with the same name are on the same chain; find the first */
+    hash = HNIhash(name);
+    for (ent = idx->table[hash & (idx->size - 1)]; ent != NULL; ent = ent->next)
+        if (ent->hash == hash && (ret_value == FAIL || ent->key < ret_value) && strcmp(ent->name, name) == 0)
+            ret_value = ent->key;
+
+done:
+    return ret_value;
+} /* HNIfind */
@@ -0,0 +1,101 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright by The HDF Group.                                               *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of HDF.  The full HDF copyright notice, including       *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the root of the source code       *
+ * distribution tree, or in https://support.hdfgroup.org/ftp/HDF/releases/.  *
+ * If you do not have access to either file, you may request a copy from     *
+ * help@hdfgroup.org.                                                        *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*-----------------------------------------------------------------------------
+ * File:    hnameidx_priv.h
+ * Purpose: hashed index of the names of the objects in a file
+ *
+ * A name index maps names to the keys (refs or indices) of the objects
+ * which have them.  Several objects may have the same name; a lookup
+ * returns the smallest key, which is the object a search through the
+ * objects in order of their keys would find first.
+ *---------------------------------------------------------------------------*/
+
+#ifndef H4_HNAMEIDX_PRIV_H
+#define H4_HNAMEIDX_PRIV_H
+
+#include "hdf_priv.h"
+
+/*
+    Define the pointer to the name index without giving outside routines
+    access to the internal workings of the structure.
+*/
+typedef struct HNIindex_tag *HNIindex_p;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*--------------------------------------------------------------------------
+ NAME
+    HNIcreate -- create an empty name index
+ USAGE
+    HNIindex_p HNIcreate()
+ RETURNS
+    The index, or NULL if it can't be allocated.
+--------------------------------------------------------------------------*/
+HDFLIBAPI HNIindex_p HNIcreate(void);
+
+/*--------------------------------------------------------------------------
+ NAME
+    HNIdestroy -- free a name index
+ USAGE
+    void HNIdestroy(idx)
+        HNIindex_p idx;             IN: index to free, or NULL
+--------------------------------------------------------------------------*/
+HDFLIBAPI void HNIdestroy(HNIindex_p idx);
+
+/*--------------------------------------------------------------------------
+ NAME
+    HNIadd -- add an object's name to a name index
+ USAGE
+    int HNIadd(idx, name, key)
+        HNIindex_p idx;             IN: index to add to
+        const char *name;           IN: name of the object
+        int32 key;                  IN: key of the object, >= 0
+ RETURNS
+    SUCCEED/FAIL
+ DESCRIPTION
+    The index keeps its own copy of the name.
+--------------------------------------------------------------------------*/
+HDFLIBAPI int HNIadd(HNIindex_p idx, const char *name, int32 key);
+
+/*--------------------------------------------------------------------------
+ NAME
+    HNIremove -- remove an object's name from a name index
+ USAGE
+    int HNIremove(idx, name, key)
+        HNIindex_p idx;             IN: index to remove from
+        const char *name;           IN: name the object was added with
+        int32 key;                  IN: key of the object
+ RETURNS
+    SUCCEED, or FAIL if the object isn't in the index under that name.
+--------------------------------------------------------------------------*/
+HDFLIBAPI int HNIremove(HNIindex_p idx, const char *name, int32 key);
+
+/*--------------------------------------------------------------------------
+ NAME
+    HNIfind -- look up a name in a name index
+ USAGE
+    int32 HNIfind(idx, name)
+        HNIindex_p idx;             IN: index to look in
+        const char *name;           IN: name to look up
+ RETURNS
+    The smallest key of the objects with the name, or FAIL if there is none.
+--------------------------------------------------------------------------*/
+HDFLIBAPI int32 HNIfind(HNIindex_p idx, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H4_HNAMEIDX_PRIV_H */
@@ -69,6 +69,9 @@ HDFLIBAPI int Hexist(int32 file_id, uint16 search_tag, uint16 search_ref);
 HDFLIBAPI int Hinquire(int32 access_id, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
                        int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial);
 
+HDFLIBAPI int Hinquire64(int32 access_id, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+                         hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial);
+
 HDFLIBAPI int32 Hstartwrite(int32 file_id, uint16 tag, uint16 ref, int32 length);
 
 HDFLIBAPI int32 Hstartaccess(int32 file_id, uint16 tag, uint16 ref, uint32 flags);
@@ -83,8 +86,12 @@ HDFLIBAPI int HPregister_term_func(hdf_termfunc_t term_func);
 
 HDFLIBAPI int Hseek(int32 access_id, int32 offset, int origin);
 
+HDFLIBAPI int Hseek64(int32 access_id, hdf_off_t offset, int origin);
+
 HDFLIBAPI int32 Htell(int32 access_id);
 
+HDFLIBAPI hdf_off_t Htell64(int32 access_id);
+
 HDFLIBAPI int32 Hread(int32 access_id, int32 length, void *data);
 
 HDFLIBAPI int32 Hwrite(int32 access_id, int32 length, const void *data);
@@ -103,12 +110,30 @@ HDFLIBAPI int32 Hputelement(int32 file_id, uint16 tag, uint16 ref, const uint8 *
 
 HDFLIBAPI int32 Hlength(int32 file_id, uint16 tag, uint16 ref);
 
+HDFLIBAPI hdf_off_t Hlength64(int32 file_id, uint16 tag, uint16 ref);
+
 HDFLIBAPI int32 Hoffset(int32 file_id, uint16 tag, uint16 ref);
 
+HDFLIBAPI hdf_off_t Hoffset64(int32 file_id, uint16 tag, uint16 ref);
+
 HDFLIBAPI int Hsync(int32 file_id);
 
 HDFLIBAPI int Hcache(int32 file_id, int cache_on);
 
+HDFLIBAPI int Hsetfiledriver(int driver);
+
+HDFLIBAPI int Hgetfiledriver(int32 file_id);
+
+HDFLIBAPI int Hsetddload(int mode);
+
+HDFLIBAPI int Hsetchunkcachebudget(hdf_off_t nbytes);
+
+HDFLIBAPI int Hgetchunkcachebudget(hdf_off_t *nbytes, hdf_off_t *nused);
+
+HDFLIBAPI int Hsetchunkthreads(int nthreads);
+
+HDFLIBAPI int Hgetchunkthreads(int *nthreads);
+
 HDFLIBAPI int Hgetlibversion(uint32 *majorv, uint32 *minorv, uint32 *releasev, char *string);
 
 HDFLIBAPI int Hgetfileversion(int32 file_id, uint32 *majorv, uint32 *minorv, uint32 *release, char *string);
@@ -376,6 +401,9 @@ HDFLIBAPI int HCPgetcomptype(int32 file_id, uint16 data_tag, uint16 data_ref, co
 HDFLIBAPI int HCPgetdatasize(int32 file_id, uint16 data_tag, uint16 data_ref, int32 *comp_size,
                              int32 *orig_size);
 
+HDFLIBAPI int32 HCPgetrawdata(int32 file_id, uint16 data_tag, uint16 data_ref, comp_coder_t *coder_type,
+                              int32 *orig_size, void **data);
+
 HDFPUBLIC int HCget_config_info(comp_coder_t coder_type, uint32 *compression_config_info);
 
 HDFLIBAPI int32 HCPquery_encode_header(comp_model_t model_type, model_info *m_info, comp_coder_t coder_type,
@@ -435,6 +463,10 @@ HDFLIBAPI int Hbitwrite(int32 bitid, int count, uint32 data);
 
 HDFLIBAPI int Hbitread(int32 bitid, int count, uint32 *data);
 
+HDFLIBAPI int32 Hbitwrite_n(int32 bitid, int count, int32 nvals, const uint32 *data);
+
+HDFLIBAPI int32 Hbitread_n(int32 bitid, int count, int32 nvals, uint32 *data);
+
 HDFLIBAPI int Hbitseek(int32 bitid, int32 byte_offset, int bit_offset);
 
 HDFLIBAPI int Hgetbit(int32 bitid);
@@ -967,6 +999,21 @@ HDFLIBAPI int GR2bmapped(int32 riid, int *tobe_mapped, int *created_byGR);
 /* Cache flags */
 #define HDF_CACHEALL 0x1
 
+/* Chunk cache replacement policies, see SDsetchunkcacheparams() */
+#define HDF_CACHE_LRU 0 /* least recently used chunk */
+#define HDF_CACHE_ARC 1 /* adaptive replacement cache */
+#define HDF_CACHE_W0  2 /* fully read/written chunks first, then LRU */
+
+/* Statistics of a chunk cache, see SDgetchunkcachestats() */
+typedef struct hdf_cache_stats_t {
+    uint32 hits;      /* chunks found in the cache */
+    uint32 misses;    /* chunks read in or created */
+    uint32 evictions; /* chunks dropped to make room in the cache */
+    uint32 reclaims;  /* chunks taken to keep all caches within their budget */
+    int32  nchunks;   /* chunks in the cache now */
+    int32  chunksize; /* bytes in a chunk */
+} HDF_CACHE_STATS;
+
 /* Chunk Definition, Note that GRs need only 2 dimensions for the chunk_lengths */
 typedef union hdf_chunk_def_u {
     /* Chunk Lengths only */
@@ -1226,6 +1273,39 @@ HDFLIBAPI int GRsetchunkcache(int32 riid,     /* IN: raster access id */
                               int32 maxcache, /* IN: max number of chunks to cache */
                               int32 flags /* IN: flags = 0, HDF_CACHEALL */);
 
+/******************************************************************************
+NAME
+     GRsetchunkcacheparams -- byte bound and replacement policy of the chunk cache
+
+DESCRIPTION
+     Bounds the chunk cache of the GR to 'maxbytes' bytes of chunks and
+     sets which chunk leaves the cache when it is full; 'policy' is one of
+     HDF_CACHE_LRU, HDF_CACHE_ARC or HDF_CACHE_W0.  A 'maxbytes' of 0 keeps
+     the bound set with GRsetchunkcache().  See SDsetchunkcacheparams()
+     for a description of the policies.
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+******************************************************************************/
+HDFLIBAPI int GRsetchunkcacheparams(int32 riid,     /* IN: raster access id */
+                                    int32 maxbytes, /* IN: max bytes of chunks to cache, or 0 */
+                                    int32 policy /* IN: HDF_CACHE_LRU, HDF_CACHE_ARC or HDF_CACHE_W0 */);
+
+/******************************************************************************
+NAME
+     GRgetchunkcachestats -- statistics of the chunk cache
+
+DESCRIPTION
+     Fills in 'stats' with the statistics of the chunk cache of the GR
+     since the GR was selected.  See SDgetchunkcachestats() for the
+     meaning of each field.
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+******************************************************************************/
+HDFLIBAPI int GRgetchunkcachestats(int32            riid, /* IN: raster access id */
+                                   HDF_CACHE_STATS *stats /* OUT: statistics of the chunk cache */);
+
 /* Vset interface functions (used to be in vproto.h) */
 
 /* Useful macros, which someday might become actual functions */
@@ -1526,6 +1606,10 @@ HDFLIBAPI int32 VSread(int32 vkey, uint8 buf[], int32 nelt, int32 interlace);
 
 HDFLIBAPI int32 VSwrite(int32 vkey, const uint8 buf[], int32 nelt, int32 interlace);
 
+HDFLIBAPI int VSsetscratchmax(int32 nbytes);
+
+HDFLIBAPI int VSgetscratchmax(int32 *nbytes);
+
 #ifdef __cplusplus
 }
 #endif
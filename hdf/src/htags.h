@@ -98,6 +98,7 @@
 #define DFTAG_SDC   ((uint16)708) /* Coord sys */
 #define DFTAG_SDT   ((uint16)709) /* Transpose */
 #define DFTAG_SDLNK ((uint16)710) /* Links related to the dataset */
+#define DFTAG_SDIDX ((uint16)711) /* Index of the SD metadata */
 #define DFTAG_NDG   ((uint16)720) /* Numeric Data Group */
                                   /* tag 721 reserved chouck 24-Nov-93 */
 #define DFTAG_CAL   ((uint16)731) /* Calibration information */
@@ -0,0 +1,597 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright by The HDF Group.                                               *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of HDF.  The full HDF copyright notice, including       *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the root of the source code       *
+ * distribution tree, or in https://support.hdfgroup.org/ftp/HDF/releases/.  *
+ * If you do not have access to either file, you may request a copy from     *
+ * help@hdfgroup.org.                                                        *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*
+ * Locks and per-thread data for the thread-safe library
+ *
+ * Modules which keep scratch buffers or other state between calls keep it
+ * in a per-thread slot (see HTSslot_t), so that threads never share it.
+ * In a library which isn't built thread-safe there is one static copy of
+ * each slot and no locks.
+ *
+ * EXPORTED ROUTINES
+ *  HTSlocal           -- get the calling thread's data for a slot
+ *  HTSpeek_local      -- get the calling thread's data for a slot, if it has any
+ *  HTSfree_local      -- free the calling thread's data for a slot
+ *  HTSget_buf         -- get the calling thread's scratch buffer for a slot
+ *  HTSrun_jobs        -- run a batch of jobs on worker threads
+ *  HTSend_jobs        -- stop the worker threads
+ *  HTSlock            -- take the library lock
+ *  HTSunlock          -- release the library lock
+ *  HTSregistry_lock   -- take the registry lock
+ *  HTSregistry_unlock -- release the registry lock
+ *  HTSpool_lock       -- take the chunk cache pool lock
+ *  HTSpool_unlock     -- release the chunk cache pool lock
+ *  HTSextfile_lock    -- take the external file pool lock
+ *  HTSextfile_unlock  -- release the external file pool lock
+ *  HTSmutex_init      -- initialize a lock
+ *  HTSmutex_destroy   -- destroy a lock
+ *  HTSmutex_lock      -- take a lock
+ *  HTSmutex_unlock    -- release a lock
+ *  HTSmutex_trylock   -- take a lock if no other thread holds it
+ */
+
+#include "hdf_priv.h"
+#include "hthread_priv.h"
+
+/* One thread's data for all of the slots */
+typedef struct {
+    void          *data[HTS_NSLOTS];      /* the data of each slot */
+    HTSfree_func_t free_func[HTS_NSLOTS]; /* frees what each slot's data points to */
+} HTSlocal_t;
+
+static void HTSIfree_slot(HTSlocal_t *local, HTSslot_t slot);
+
+#ifdef H4_HAVE_THREADSAFE
+
+static pthread_once_t  HTS_once = PTHREAD_ONCE_INIT;
+static pthread_key_t   HTS_key;            /* key of each thread's HTSlocal_t */
+static pthread_mutex_t HTS_library_lock;   /* the library lock */
+static pthread_mutex_t HTS_registry_lock;  /* the registry lock */
+static pthread_mutex_t HTS_pool_lock;      /* the chunk cache pool lock */
+static pthread_mutex_t HTS_extfile_lock;   /* the external file pool lock */
+
+/* Most worker threads HTSrun_jobs starts */
+#define HTS_MAX_WORKERS 64
+
+/* The worker threads and the batch of jobs they're running */
+static pthread_mutex_t HTS_jobs_lock; /* protects the rest */
+static pthread_cond_t  HTS_jobs_work; /* signalled when jobs are posted or the workers stop */
+static pthread_cond_t  HTS_jobs_done; /* signalled when the last job of a batch ends */
+static struct {
+    pthread_t     threads[HTS_MAX_WORKERS];
+    int           nthreads; /* # of workers started */
+    int           limit;    /* # of workers which may run jobs of the batch */
+    int           nrunning; /* # of workers running a job */
+    int           busy;     /* TRUE while a batch is running */
+    int           stop;     /* TRUE when the workers should exit */
+    HTSjob_func_t func;     /* runs one job of the batch */
+    void         *data;     /* passed to func */
+    int           njobs;    /* # of jobs in the batch */
+    int           next;     /* next job to hand out */
+    int           nleft;    /* # of jobs which haven't ended */
+} HTS_jobs;
+
+/* Frees a thread's data when the thread exits */
+static void
+HTSIdestroy_local(void *arg)
+{
+    HTSlocal_t *local = (HTSlocal_t *)arg;
+
+    for (int i = 0; i < (int)HTS_NSLOTS; i++)
+        HTSIfree_slot(local, (HTSslot_t)i);
+    free(local);
+}
+
+/* Sets up the key and the locks, once per process */
+static void
+HTSIinit(void)
+{
+    pthread_key_create(&HTS_key, HTSIdestroy_local);
+    HTSmutex_init(&HTS_library_lock);
+    HTSmutex_init(&HTS_registry_lock);
+    HTSmutex_init(&HTS_pool_lock);
+    HTSmutex_init(&HTS_extfile_lock);
+    pthread_mutex_init(&HTS_jobs_lock, NULL);
+    pthread_cond_init(&HTS_jobs_work, NULL);
+    pthread_cond_init(&HTS_jobs_done, NULL);
+}
+
+/* Runs jobs of the batches posted by HTSrun_jobs until told to stop */
+static void *
+HTSIworker(void *arg)
+{
+    HTSjob_func_t func;
+    void         *data;
+    int           job;
+
+    (void)arg;
+
+    pthread_mutex_lock(&HTS_jobs_lock);
+    for (;;) {
+        while (!HTS_jobs.stop &&
+               (HTS_jobs.next >= HTS_jobs.njobs || HTS_jobs.nrunning >= HTS_jobs.limit))
+            pthread_cond_wait(&HTS_jobs_work, &HTS_jobs_lock);
+        if (HTS_jobs.stop)
+            break;
+
+        job  = HTS_jobs.next++;
+        func = HTS_jobs.func;
+        data = HTS_jobs.data;
+        HTS_jobs.nrunning++;
+        pthread_mutex_unlock(&HTS_jobs_lock);
+
+        (*func)(data, job);
+
+        pthread_mutex_lock(&HTS_jobs_lock);
+        HTS_jobs.nrunning--;
+        if (--HTS_jobs.nleft == 0)
+            pthread_cond_broadcast(&HTS_jobs_done);
+    }
+    pthread_mutex_unlock(&HTS_jobs_lock);
+
+    return NULL;
+}
+
+/* Returns the calling thread's data, allocating it the first time */
+static HTSlocal_t *
+HTSIget_local(void)
+{
+    HTSlocal_t *local;
+
+    pthread_once(&HTS_once, HTSIinit);
+    if ((local = (HTSlocal_t *)pthread_getspecific(HTS_key)) == NULL) {
+        if ((local = (HTSlocal_t *)calloc(1, sizeof(HTSlocal_t))) == NULL)
+            return NULL;
+        if (pthread_setspecific(HTS_key, local) != 0) {
+            free(local);
+            return NULL;
+        }
+    }
+    return local;
+}
+
+#else /* H4_HAVE_THREADSAFE */
+
+static HTSlocal_t HTS_local; /* the only thread's data */
+
+#define HTSIget_local() (&HTS_local)
+
+#endif /* H4_HAVE_THREADSAFE */
+
+/* Frees one slot of a thread's data */
+static void
+HTSIfree_slot(HTSlocal_t *local, HTSslot_t slot)
+{
+    if (local->data[slot] != NULL) {
+        if (local->free_func[slot] != NULL)
+            (*local->free_func[slot])(local->data[slot]);
+        free(local->data[slot]);
+        local->data[slot]      = NULL;
+        local->free_func[slot] = NULL;
+    }
+}
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSlocal -- get the calling thread's data for a slot
+ USAGE
+    void *HTSlocal(slot, size, free_func)
+        HTSslot_t slot;             IN: slot to get the data of
+        size_t size;                IN: size of the slot's data
+        HTSfree_func_t free_func;   IN: frees what the data points to, or NULL
+ RETURNS
+    The thread's data for the slot, or NULL if it can't be allocated.
+ DESCRIPTION
+    The first call for a slot in a thread allocates the data zero-filled.
+    When the thread exits (or HTSfree_local is called) free_func is called
+    on the data, then the data itself is freed.
+--------------------------------------------------------------------------*/
+void *
+HTSlocal(HTSslot_t slot, size_t size, HTSfree_func_t free_func)
+{
+    HTSlocal_t *local = HTSIget_local();
+
+    if (local == NULL)
+        return NULL;
+    if (local->data[slot] == NULL) {
+        if ((local->data[slot] = calloc(1, size)) == NULL)
+            return NULL;
+        local->free_func[slot] = free_func;
+    }
+    return local->data[slot];
+} /* HTSlocal */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSpeek_local -- get the calling thread's data for a slot, if it has any
+ USAGE
+    void *HTSpeek_local(slot)
+        HTSslot_t slot;             IN: slot to get the data of
+ RETURNS
+    The thread's data for the slot, or NULL if it hasn't been allocated.
+--------------------------------------------------------------------------*/
+void *
+HTSpeek_local(HTSslot_t slot)
+{
+    HTSlocal_t *local = HTSIget_local();
+
+    return local == NULL ? NULL : local->data[slot];
+} /* HTSpeek_local */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSfree_local -- free the calling thread's data for a slot
+ USAGE
+    void HTSfree_local(slot)
+        HTSslot_t slot;             IN: slot to free the data of
+ DESCRIPTION
+    Called by the modules' shutdown routines; the data of other threads is
+    freed when they exit.
+--------------------------------------------------------------------------*/
+void
+HTSfree_local(HTSslot_t slot)
+{
+    HTSlocal_t *local = HTSIget_local();
+
+    if (local != NULL)
+        HTSIfree_slot(local, slot);
+} /* HTSfree_local */
+
+/* Frees the buffer of an HTSbuf_t */
+static void
+HTSIfree_buf(void *data)
+{
+    free(((HTSbuf_t *)data)->buf);
+}
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSget_buf -- get the calling thread's scratch buffer for a slot
+ USAGE
+    uint8 *HTSget_buf(slot, size)
+        HTSslot_t slot;             IN: slot the buffer is kept in
+        size_t size;                IN: # of bytes needed in the buffer
+ RETURNS
+    The buffer, or NULL if it can't be allocated.
+ DESCRIPTION
+    The buffer is reallocated when it is smaller than size; its contents
+    aren't kept when that happens.
+--------------------------------------------------------------------------*/
+uint8 *
+HTSget_buf(HTSslot_t slot, size_t size)
+{
+    HTSbuf_t *b = (HTSbuf_t *)HTSlocal(slot, sizeof(HTSbuf_t), HTSIfree_buf);
+
+    if (b == NULL)
+        return NULL;
+    if (size > b->size || b->buf == NULL) {
+        free(b->buf);
+        if (size == 0)
+            size = 1;
+        if ((b->buf = (uint8 *)malloc(size)) == NULL) {
+            b->size = 0;
+            return NULL;
+        }
+        b->size = size;
+    }
+    return b->buf;
+} /* HTSget_buf */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSrelease_buf -- free the calling thread's scratch buffer if it's large
+ USAGE
+    void HTSrelease_buf(slot, max_size)
+        HTSslot_t slot;             IN: slot the buffer is kept in
+        size_t max_size;            IN: largest buffer to keep
+ DESCRIPTION
+    Called when a caller is done with the buffer for now, so that a buffer
+    grown for one large request isn't kept until the thread exits.
+--------------------------------------------------------------------------*/
+void
+HTSrelease_buf(HTSslot_t slot, size_t max_size)
+{
+    HTSbuf_t *b = (HTSbuf_t *)HTSpeek_local(slot);
+
+    if (b != NULL && b->size > max_size) {
+        free(b->buf);
+        b->buf  = NULL;
+        b->size = 0;
+    }
+} /* HTSrelease_buf */
+
+#ifdef H4_HAVE_THREADSAFE
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSlock -- take the library lock
+ USAGE
+    void HTSlock()
+--------------------------------------------------------------------------*/
+void
+HTSlock(void)
+{
+    pthread_once(&HTS_once, HTSIinit);
+    HTSmutex_lock(&HTS_library_lock);
+} /* HTSlock */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSunlock -- release the library lock
+ USAGE
+    void HTSunlock()
+--------------------------------------------------------------------------*/
+void
+HTSunlock(void)
+{
+    HTSmutex_unlock(&HTS_library_lock);
+} /* HTSunlock */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSregistry_lock -- take the registry lock
+ USAGE
+    void HTSregistry_lock()
+--------------------------------------------------------------------------*/
+void
+HTSregistry_lock(void)
+{
+    pthread_once(&HTS_once, HTSIinit);
+    HTSmutex_lock(&HTS_registry_lock);
+} /* HTSregistry_lock */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSregistry_unlock -- release the registry lock
+ USAGE
+    void HTSregistry_unlock()
+--------------------------------------------------------------------------*/
+void
+HTSregistry_unlock(void)
+{
+    HTSmutex_unlock(&HTS_registry_lock);
+} /* HTSregistry_unlock */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSpool_lock -- take the chunk cache pool lock
+ USAGE
+    void HTSpool_lock()
+--------------------------------------------------------------------------*/
+void
+HTSpool_lock(void)
+{
+    pthread_once(&HTS_once, HTSIinit);
+    HTSmutex_lock(&HTS_pool_lock);
+} /* HTSpool_lock */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSpool_unlock -- release the chunk cache pool lock
+ USAGE
+    void HTSpool_unlock()
+--------------------------------------------------------------------------*/
+void
+HTSpool_unlock(void)
+{
+    HTSmutex_unlock(&HTS_pool_lock);
+} /* HTSpool_unlock */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSextfile_lock -- take the external file pool lock
+ USAGE
+    void HTSextfile_lock()
+--------------------------------------------------------------------------*/
+void
+HTSextfile_lock(void)
+{
+    pthread_once(&HTS_once, HTSIinit);
+    HTSmutex_lock(&HTS_extfile_lock);
+} /* HTSextfile_lock */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSextfile_unlock -- release the external file pool lock
+ USAGE
+    void HTSextfile_unlock()
+--------------------------------------------------------------------------*/
+void
+HTSextfile_unlock(void)
+{
+    HTSmutex_unlock(&HTS_extfile_lock);
+} /* HTSextfile_unlock */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSmutex_init -- initialize a lock
+ USAGE
+    int HTSmutex_init(mutex)
+        HTSmutex_t *mutex;          OUT: lock to initialize
+ RETURNS
+    SUCCEED/FAIL
+ DESCRIPTION
+    The lock can be taken again by the thread which holds it, as long as
+    it is released as many times.
+--------------------------------------------------------------------------*/
+int
+HTSmutex_init(HTSmutex_t *mutex)
+{
+    pthread_mutexattr_t attr;
+    int                 ret_value = SUCCEED;
+
+    if (pthread_mutexattr_init(&attr) != 0)
+        return FAIL;
+    if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0 ||
+        pthread_mutex_init(mutex, &attr) != 0)
+        ret_value = FAIL;
+    pthread_mutexattr_destroy(&attr);
+
+    return ret_value;
+} /* HTSmutex_init */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSmutex_destroy -- destroy a lock
+ USAGE
+    void HTSmutex_destroy(mutex)
+        HTSmutex_t *mutex;          IN: lock to destroy
+--------------------------------------------------------------------------*/
+void
+HTSmutex_destroy(HTSmutex_t *mutex)
+{
+    pthread_mutex_destroy(mutex);
+} /* HTSmutex_destroy */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSmutex_lock -- take a lock
+ USAGE
+    void HTSmutex_lock(mutex)
+        HTSmutex_t *mutex;          IN: lock to take
+--------------------------------------------------------------------------*/
+void
+HTSmutex_lock(HTSmutex_t *mutex)
+{
+    pthread_mutex_lock(mutex);
+} /* HTSmutex_lock */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSmutex_unlock -- release a lock
+ USAGE
+    void HTSmutex_unlock(mutex)
+        HTSmutex_t *mutex;          IN: lock to release
+--------------------------------------------------------------------------*/
+void
+HTSmutex_unlock(HTSmutex_t *mutex)
+{
+    pthread_mutex_unlock(mutex);
+} /* HTSmutex_unlock */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSmutex_trylock -- take a lock if no other thread holds it
+ USAGE
+    int HTSmutex_trylock(mutex)
+        HTSmutex_t *mutex;          IN: lock to take
+ RETURNS
+    TRUE if the lock was taken, FALSE otherwise.
+--------------------------------------------------------------------------*/
+int
+HTSmutex_trylock(HTSmutex_t *mutex)
+{
+    return pthread_mutex_trylock(mutex) == 0 ? TRUE : FALSE;
+} /* HTSmutex_trylock */
+
+#endif /* H4_HAVE_THREADSAFE */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSrun_jobs -- run a batch of jobs on worker threads
+ USAGE
+    void HTSrun_jobs(nthreads, njobs, func, data)
+        int nthreads;               IN: # of threads to run the jobs on
+        int njobs;                  IN: # of jobs in the batch
+        HTSjob_func_t func;         IN: runs one job
+        void *data;                 IN: passed to func
+ DESCRIPTION
+    The workers are started the first time they're needed and wait for
+    the next batch after that.  Only one batch runs at a time.
+--------------------------------------------------------------------------*/
+void
+HTSrun_jobs(int nthreads, int njobs, HTSjob_func_t func, void *data)
+{
+    int job;
+
+#ifdef H4_HAVE_THREADSAFE
+    if (nthreads > 1 && njobs > 1) {
+        pthread_once(&HTS_once, HTSIinit);
+        pthread_mutex_lock(&HTS_jobs_lock);
+        if (!HTS_jobs.busy && !HTS_jobs.stop) {
+            HTS_jobs.busy = TRUE;
+
+            /* start the workers this batch needs, if they aren't running */
+            nthreads = MIN(nthreads - 1, HTS_MAX_WORKERS);
+            while (HTS_jobs.nthreads < nthreads &&
+                   pthread_create(&HTS_jobs.threads[HTS_jobs.nthreads], NULL, HTSIworker, NULL) == 0)
+                HTS_jobs.nthreads++;
+
+            /* post the batch */
+            HTS_jobs.func  = func;
+            HTS_jobs.data  = data;
+            HTS_jobs.njobs = njobs;
+            HTS_jobs.next  = 0;
+            HTS_jobs.nleft = njobs;
+            HTS_jobs.limit = nthreads;
+            pthread_cond_broadcast(&HTS_jobs_work);
+
+            /* run jobs alongside the workers, then wait for theirs to end */
+            while (HTS_jobs.next < HTS_jobs.njobs) {
+                job = HTS_jobs.next++;
+                pthread_mutex_unlock(&HTS_jobs_lock);
+
+                (*func)(data, job);
+
+                pthread_mutex_lock(&HTS_jobs_lock);
+                --HTS_jobs.nleft;
+            }
+            while (HTS_jobs.nleft > 0)
+                pthread_cond_wait(&HTS_jobs_done, &HTS_jobs_lock);
+
+            HTS_jobs.func  = NULL;
+            HTS_jobs.data  = NULL;
+            HTS_jobs.njobs = 0;
+            HTS_jobs.next  = 0;
+            HTS_jobs.busy  = FALSE;
+            pthread_mutex_unlock(&HTS_jobs_lock);
+            return;
+        }
+        pthread_mutex_unlock(&HTS_jobs_lock);
+    }
+#else
+    (void)nthreads;
+#endif /* H4_HAVE_THREADSAFE */
+
+    for (job = 0; job < njobs; job++)
+        (*func)(data, job);
+} /* HTSrun_jobs */
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSend_jobs -- stop the worker threads
+ USAGE
+    void HTSend_jobs()
+--------------------------------------------------------------------------*/
+void
+HTSend_jobs(void)
+{
+#ifdef H4_HAVE_THREADSAFE
+    int nthreads;
+
+    pthread_once(&HTS_once, HTSIinit);
+    pthread_mutex_lock(&HTS_jobs_lock);
+    HTS_jobs.stop = TRUE;
+    nthreads      = HTS_jobs.nthreads;
+    pthread_cond_broadcast(&HTS_jobs_work);
+    pthread_mutex_unlock(&HTS_jobs_lock);
+
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(HTS_jobs.threads[i], NULL);
+
+    pthread_mutex_lock(&HTS_jobs_lock);
+    HTS_jobs.nthreads = 0;
+    HTS_jobs.stop     = FALSE;
+    pthread_mutex_unlock(&HTS_jobs_lock);
+#endif /* H4_HAVE_THREADSAFE */
+} /* HTSend_jobs */
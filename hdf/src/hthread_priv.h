@@ -0,0 +1,223 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright by The HDF Group.                                               *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of HDF.  The full HDF copyright notice, including       *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the root of the source code       *
+ * distribution tree, or in https://support.hdfgroup.org/ftp/HDF/releases/.  *
+ * If you do not have access to either file, you may request a copy from     *
+ * help@hdfgroup.org.                                                        *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*-----------------------------------------------------------------------------
+ * File:    hthread_priv.h
+ * Purpose: locks and per-thread data for the thread-safe library
+ *
+ * When the library is not built thread-safe (H4_HAVE_THREADSAFE isn't
+ * defined), the locks compile away and the per-thread data is kept in a
+ * single static copy.
+ *---------------------------------------------------------------------------*/
+
+#ifndef H4_HTHREAD_PRIV_H
+#define H4_HTHREAD_PRIV_H
+
+#include "hdf_priv.h"
+
+#ifdef H4_HAVE_THREADSAFE
+#include <pthread.h>
+
+/* A lock which the thread holding it can take again */
+typedef pthread_mutex_t HTSmutex_t;
+#endif /* H4_HAVE_THREADSAFE */
+
+/* Per-thread data, one slot for each module which keeps some */
+typedef enum {
+    HTS_ERROR_STACK = 0, /* error stack (herr.c) */
+    HTS_CONV_STATE,      /* number type set by DFKsetNT (dfconv.c) */
+    HTS_VG_BUF,          /* Vgroup header buffer (vgp.c) */
+    HTS_VH_BUF,          /* Vdata header buffer (vio.c) */
+    HTS_VP_BUF,          /* field name parser buffers (vparse.c) */
+    HTS_VT_BUF,          /* Vdata record buffer (vrw.c) */
+    HTS_SD_BUF,          /* SD conversion buffers (mfhdf putget.c) */
+    HTS_NSLOTS           /* # of slots (Invalid as a slot) */
+} HTSslot_t;
+
+/* Type of the function which frees what a slot's data points to */
+typedef void (*HTSfree_func_t)(void *data);
+
+/* Type of the function which runs one job of a batch given to HTSrun_jobs */
+typedef void (*HTSjob_func_t)(void *data, int job);
+
+/* A scratch buffer which grows until HTSrelease_buf frees it, kept in a slot
+   by HTSget_buf */
+typedef struct {
+    size_t size; /* # of bytes allocated for buf */
+    uint8 *buf;  /* the buffer */
+} HTSbuf_t;
+
+/*
+ * The library lock serializes opening and closing files and starting and
+ * ending the interfaces.  The registry lock protects the tables which map
+ * IDs of the higher-level interfaces to their per-file information, the
+ * one-time start of each interface and the list of shutdown routines.  Each
+ * file record has its own lock (see hfile_priv.h), and so does each chunk
+ * cache (see mcache.c).  The pool lock protects the budget the chunk caches
+ * share, and the external file lock the pool of open external files (see
+ * hextelt.c).  Locks are always taken in the order: library lock, file lock,
+ * chunk cache lock, pool lock, external file lock, registry lock, atom table
+ * lock.  While holding the pool lock the lock of another chunk cache is only
+ * tried.
+ */
+#ifdef H4_HAVE_THREADSAFE
+#define HTS_LOCK()            HTSlock()
+#define HTS_UNLOCK()          HTSunlock()
+#define HTS_REGISTRY_LOCK()   HTSregistry_lock()
+#define HTS_REGISTRY_UNLOCK() HTSregistry_unlock()
+#define HTS_POOL_LOCK()       HTSpool_lock()
+#define HTS_POOL_UNLOCK()     HTSpool_unlock()
+#define HTS_EXTFILE_LOCK()    HTSextfile_lock()
+#define HTS_EXTFILE_UNLOCK()  HTSextfile_unlock()
+#else
+#define HTS_LOCK()            ((void)0)
+#define HTS_UNLOCK()          ((void)0)
+#define HTS_REGISTRY_LOCK()   ((void)0)
+#define HTS_REGISTRY_UNLOCK() ((void)0)
+#define HTS_POOL_LOCK()       ((void)0)
+#define HTS_POOL_UNLOCK()     ((void)0)
+#define HTS_EXTFILE_LOCK()    ((void)0)
+#define HTS_EXTFILE_UNLOCK()  ((void)0)
+#endif
+
+/*
+ * Process-wide settings which are read on every call, such as the limit set
+ * by VSsetscratchmax, are read and written atomically instead of under the
+ * registry lock, so that threads working on different files don't all wait
+ * on one lock just to read them.
+ */
+#ifdef H4_HAVE_THREADSAFE
+#define HTS_GET_SETTING(v)    __atomic_load_n(&(v), __ATOMIC_RELAXED)
+#define HTS_SET_SETTING(v, n) __atomic_store_n(&(v), (n), __ATOMIC_RELAXED)
+#else
+#define HTS_GET_SETTING(v)    (v)
+#define HTS_SET_SETTING(v, n) ((v) = (n))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSlocal -- get the calling thread's data for a slot
+ USAGE
+    void *HTSlocal(slot, size, free_func)
+        HTSslot_t slot;             IN: slot to get the data of
+        size_t size;                IN: size of the slot's data
+        HTSfree_func_t free_func;   IN: frees what the data points to, or NULL
+ RETURNS
+    The thread's data for the slot, or NULL if it can't be allocated.
+ DESCRIPTION
+    The first call for a slot in a thread allocates the data zero-filled.
+    When the thread exits (or HTSfree_local is called) free_func is called
+    on the data, then the data itself is freed.
+--------------------------------------------------------------------------*/
+HDFLIBAPI void *HTSlocal(HTSslot_t slot, size_t size, HTSfree_func_t free_func);
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSpeek_local -- get the calling thread's data for a slot, if it has any
+ USAGE
+    void *HTSpeek_local(slot)
+        HTSslot_t slot;             IN: slot to get the data of
+ RETURNS
+    The thread's data for the slot, or NULL if it hasn't been allocated.
+--------------------------------------------------------------------------*/
+HDFLIBAPI void *HTSpeek_local(HTSslot_t slot);
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSfree_local -- free the calling thread's data for a slot
+ USAGE
+    void HTSfree_local(slot)
+        HTSslot_t slot;             IN: slot to free the data of
+--------------------------------------------------------------------------*/
+HDFLIBAPI void HTSfree_local(HTSslot_t slot);
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSget_buf -- get the calling thread's scratch buffer for a slot
+ USAGE
+    uint8 *HTSget_buf(slot, size)
+        HTSslot_t slot;             IN: slot the buffer is kept in
+        size_t size;                IN: # of bytes needed in the buffer
+ RETURNS
+    The buffer, or NULL if it can't be allocated.
+ DESCRIPTION
+    The buffer is reallocated when it is smaller than size; its contents
+    aren't kept when that happens.
+--------------------------------------------------------------------------*/
+HDFLIBAPI uint8 *HTSget_buf(HTSslot_t slot, size_t size);
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSrelease_buf -- free the calling thread's scratch buffer if it's large
+ USAGE
+    void HTSrelease_buf(slot, max_size)
+        HTSslot_t slot;             IN: slot the buffer is kept in
+        size_t max_size;            IN: largest buffer to keep
+--------------------------------------------------------------------------*/
+HDFLIBAPI void HTSrelease_buf(HTSslot_t slot, size_t max_size);
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSrun_jobs -- run a batch of jobs on worker threads
+ USAGE
+    void HTSrun_jobs(nthreads, njobs, func, data)
+        int nthreads;               IN: # of threads to run the jobs on
+        int njobs;                  IN: # of jobs in the batch
+        HTSjob_func_t func;         IN: runs one job
+        void *data;                 IN: passed to func
+ DESCRIPTION
+    Calls func(data, job) for each job from 0 to njobs - 1 and returns when
+    all of them have ended.  The calling thread and up to nthreads - 1
+    worker threads run the jobs at the same time, so func must not use the
+    library's error stack or any other state which isn't the job's own.
+    When the library isn't built thread-safe, or another batch is running,
+    the calling thread runs all of the jobs itself.
+--------------------------------------------------------------------------*/
+HDFLIBAPI void HTSrun_jobs(int nthreads, int njobs, HTSjob_func_t func, void *data);
+
+/*--------------------------------------------------------------------------
+ NAME
+    HTSend_jobs -- stop the worker threads
+ USAGE
+    void HTSend_jobs()
+ DESCRIPTION
+    Waits for the worker threads started by HTSrun_jobs to exit.  They are
+    started again when they're next needed.
+--------------------------------------------------------------------------*/
+HDFLIBAPI void HTSend_jobs(void);
+
+#ifdef H4_HAVE_THREADSAFE
+HDFLIBAPI void HTSlock(void);
+HDFLIBAPI void HTSunlock(void);
+HDFLIBAPI void HTSregistry_lock(void);
+HDFLIBAPI void HTSregistry_unlock(void);
+HDFLIBAPI void HTSpool_lock(void);
+HDFLIBAPI void HTSpool_unlock(void);
+HDFLIBAPI void HTSextfile_lock(void);
+HDFLIBAPI void HTSextfile_unlock(void);
+
+HDFLIBAPI int  HTSmutex_init(HTSmutex_t *mutex);
+HDFLIBAPI void HTSmutex_destroy(HTSmutex_t *mutex);
+HDFLIBAPI void HTSmutex_lock(HTSmutex_t *mutex);
+HDFLIBAPI void HTSmutex_unlock(HTSmutex_t *mutex);
+HDFLIBAPI int  HTSmutex_trylock(HTSmutex_t *mutex);
+#endif /* H4_HAVE_THREADSAFE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H4_HTHREAD_PRIV_H */
@@ -53,10 +53,48 @@
 #include "hqueue_priv.h"
 #include "mcache_priv.h"
 
+/* Lock of a cache, see hthread_priv.h for the order locks are taken in */
+#ifdef H4_HAVE_THREADSAFE
+#define MCACHE_LOCK(mp)    HTSmutex_lock(&(mp)->lock)
+#define MCACHE_UNLOCK(mp)  HTSmutex_unlock(&(mp)->lock)
+#define MCACHE_TRYLOCK(mp) HTSmutex_trylock(&(mp)->lock)
+#else
+#define MCACHE_LOCK(mp)    ((void)0)
+#define MCACHE_UNLOCK(mp)  ((void)0)
+#define MCACHE_TRYLOCK(mp) TRUE
+#endif
+
+/*
+ * The pool of all open caches, and the budget of bytes they share.  When
+ * the pool is out of budget, a cache which needs another page replaces one
+ * of its own if it holds more than its fair share, the budget divided
+ * evenly among the caches holding pages.  Otherwise clean pages are taken
+ * from the cache most over its share.  Dirty pages are only written out by
+ * the cache they belong to, so the budget can be exceeded while the caches
+ * over their share hold nothing but dirty or pinned pages.
+ */
+static H4_CIRCLEQ_HEAD(_pqh, MCACHE) mcache_pool = {(void *)&mcache_pool, (void *)&mcache_pool};
+static hdf_off_t mcache_budget  = 0; /* bytes the caches may hold, or 0 for no bound */
+static hdf_off_t mcache_nbytes  = 0; /* bytes the caches hold */
+static int32     mcache_nactive = 0; /* # of caches holding pages */
+
 /* Private routines */
-static BKT *mcache_bkt(MCACHE *mp);
-static BKT *mcache_look(MCACHE *mp, int32 pgno);
-static int  mcache_write(MCACHE *mp, BKT *bkt);
+static BKT    *mcache_bkt(MCACHE *mp, int b2hit);
+static BKT    *mcache_look(MCACHE *mp, int32 pgno);
+static int     mcache_write(MCACHE *mp, BKT *bkt);
+static BKT    *mcache_victim(MCACHE *mp, int b2hit);
+static int     mcache_evict(MCACHE *mp, BKT *bp);
+static int     mcache_trim(MCACHE *mp);
+static int32   mcache_capacity(MCACHE *mp);
+static void    mcache_hinsert(MCACHE *mp, BKT *bp);
+static void    mcache_hremove(MCACHE *mp, BKT *bp);
+static L_ELEM *mcache_elem(MCACHE *mp, int32 pgno);
+static void    mcache_add_elem(MCACHE *mp, L_ELEM *lp);
+static void    mcache_trim_ghosts(MCACHE *mp);
+static void    mcache_clear_ghosts(MCACHE *mp);
+static void    mcache_count(MCACHE *mp, int32 npages);
+static int     mcache_pool_room(MCACHE *mp);
+static void    mcache_reclaim(MCACHE *self, hdf_off_t nbytes);
 
 /******************************************************************************
 NAME
@@ -110,7 +148,10 @@ int32
 mcache_set_maxcache(MCACHE *mp, /* IN: MCACHE cookie */
                     int32   maxcache /* IN: max pages to cache */)
 {
+    int32 ret_value = 0;
+
     if (mp != NULL) { /* currently allow the current cache to grow up */
+        MCACHE_LOCK(mp);
         if (mp->maxcache < maxcache)
             mp->maxcache = maxcache;
         else /* maxcache is less than current maxcache */
@@ -121,11 +162,142 @@ mcache_set_maxcache(MCACHE *mp, /* IN: MCACHE cookie */
             if (maxcache > mp->curcache)
                 mp->maxcache = maxcache;
         }
-        return mp->maxcache;
+        ret_value = mp->maxcache;
+        MCACHE_UNLOCK(mp);
     }
+    return ret_value;
+} /* mcache_set_maxcache */
+
+/******************************************************************************
+NAME
+    mcache_get_maxbytes - returns the most bytes of pages to cache.
+
+DESCRIPTION
+    Finds the byte bound on the pages cached for object.
+
+RETURNS
+    Returns the most bytes of pages to cache, or 0 if the cache is bounded
+    by 'maxcache' pages instead.
+******************************************************************************/
+int32
+mcache_get_maxbytes(MCACHE *mp /* IN: MCACHE cookie */)
+{
+    if (mp != NULL)
+        return mp->maxbytes;
     else
         return 0;
-} /* mcache_set_maxcache */
+} /* mcache_get_maxbytes */
+
+/******************************************************************************
+NAME
+    mcache_set_maxbytes - sets the most bytes of pages to cache.
+
+DESCRIPTION
+    Bounds the pages cached for object to 'maxbytes' bytes, which replaces
+    the 'maxcache' page count as the capacity of the cache.  At least one
+    page is always cached.  A 'maxbytes' of 0 goes back to 'maxcache'.
+
+    Unlike mcache_set_maxcache() the cache may shrink: unpinned pages are
+    written out if dirty and dropped until the cache fits.
+
+RETURNS
+    Returns the new byte bound if successful and FAIL otherwise.
+******************************************************************************/
+int32
+mcache_set_maxbytes(MCACHE *mp, /* IN: MCACHE cookie */
+                    int32   maxbytes /* IN: max bytes to cache, 0 for none */)
+{
+    int32 ret_value = SUCCEED;
+
+    /* check inputs */
+    if (mp == NULL || maxbytes < 0)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    MCACHE_LOCK(mp);
+    mp->maxbytes = maxbytes;
+
+    /* drop pages until the cache fits */
+    if (mcache_trim(mp) == RET_ERROR)
+        ret_value = FAIL;
+    else
+        ret_value = mp->maxbytes;
+    MCACHE_UNLOCK(mp);
+
+    if (ret_value == FAIL)
+        HE_REPORT_GOTO("unable to shrink the cache", FAIL);
+
+done:
+    return ret_value;
+} /* mcache_set_maxbytes */
+
+/******************************************************************************
+NAME
+    mcache_get_policy - returns the replacement policy of the cache.
+
+RETURNS
+    Returns MCACHE_LRU, MCACHE_ARC or MCACHE_W0.
+******************************************************************************/
+int
+mcache_get_policy(MCACHE *mp /* IN: MCACHE cookie */)
+{
+    if (mp != NULL)
+        return mp->policy;
+    else
+        return MCACHE_LRU;
+} /* mcache_get_policy */
+
+/******************************************************************************
+NAME
+    mcache_set_policy - sets the replacement policy of the cache.
+
+DESCRIPTION
+    Chooses which unpinned page is dropped when the cache is full:
+
+    MCACHE_LRU - the least recently used page.
+    MCACHE_ARC - adaptive replacement: pages used once and pages used
+                 again are kept on separate queues, and the share of the
+                 cache given to each adapts to recently dropped pages
+                 which are asked for again.  Better than LRU when large
+                 scans would otherwise flush pages which are reused.
+    MCACHE_W0  - the least recently used page which has been fully read
+                 or written (see mcache_used()), else the least recently
+                 used page.  Suits reads which visit each chunk once.
+
+RETURNS
+    RET_SUCCESS if successful and RET_ERROR otherwise
+******************************************************************************/
+int
+mcache_set_policy(MCACHE *mp, /* IN: MCACHE cookie */
+                  int     policy /* IN: MCACHE_LRU, MCACHE_ARC or MCACHE_W0 */)
+{
+    BKT *bp        = NULL; /* bucket element */
+    int  ret_value = RET_SUCCESS;
+
+    /* check inputs */
+    if (mp == NULL || (policy != MCACHE_LRU && policy != MCACHE_ARC && policy != MCACHE_W0))
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    MCACHE_LOCK(mp);
+
+    /* leaving ARC: put pages of the frequency queue back on the lru queue
+       and forget the recently dropped pages */
+    if (mp->policy == MCACHE_ARC && policy != MCACHE_ARC) {
+        while ((bp = mp->fqh.cqh_first) != (void *)&mp->fqh) {
+            H4_CIRCLEQ_REMOVE(&mp->fqh, bp, q);
+            H4_CIRCLEQ_INSERT_TAIL(&mp->lqh, bp, q);
+            bp->queue = MCACHE_T1;
+        }
+        mp->nt2 = 0;
+        mcache_clear_ghosts(mp);
+    }
+    mp->policy = policy;
+    mp->arc_p  = 0;
+
+    MCACHE_UNLOCK(mp);
+
+done:
+    return ret_value;
+} /* mcache_set_policy */
 
 /******************************************************************************
 NAME
@@ -170,12 +342,11 @@ mcache_open(void *key,       /* IN: byte string used as handle to share buffers
             int32 npages,    /* IN: number of chunks currently in object */
             int32 flags /* IN: 0= object exists, 1= does not exist  */)
 {
-    struct _lhqh *lhead     = NULL; /* head of an entry in list hash chain */
-    MCACHE       *mp        = NULL; /* MCACHE cookie */
-    L_ELEM       *lp        = NULL;
-    int           ret_value = RET_SUCCESS;
-    int           entry; /* index into hash table */
-    int32         pageno;
+    MCACHE *mp        = NULL; /* MCACHE cookie */
+    L_ELEM *lp        = NULL;
+    int     ret_value = RET_SUCCESS;
+    uint32  entry; /* index into hash table */
+    int32   pageno;
 
     (void)key;
 
@@ -190,14 +361,24 @@ mcache_open(void *key,       /* IN: byte string used as handle to share buffers
         HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
     H4_CIRCLEQ_INIT(&mp->lqh);
-    for (entry = 0; entry < HASHSIZE; ++entry) {
-        H4_CIRCLEQ_INIT(&mp->hqh[entry]);
-        H4_CIRCLEQ_INIT(&mp->lhqh[entry]);
-    }
+    H4_CIRCLEQ_INIT(&mp->fqh);
+    H4_CIRCLEQ_INIT(&mp->b1h);
+    H4_CIRCLEQ_INIT(&mp->b2h);
+
+    /* Size the element table for the pages already in the object; the
+       page table starts small and grows with the cache */
+    for (mp->lsize = HASHSIZE; mp->lsize < (uint32)npages && mp->lsize < 0x40000000; mp->lsize *= 2)
+        ;
+    mp->hsize = HASHSIZE;
+    if ((mp->ltab = (L_ELEM **)calloc(mp->lsize, sizeof(L_ELEM *))) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    if ((mp->htab = (BKT **)calloc(mp->hsize, sizeof(BKT *))) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
     /* Initialize max # of pages to cache and number of pages in object */
     mp->maxcache = (int32)maxcache;
     mp->npages   = npages;
+    mp->policy   = MCACHE_LRU;
 
     /* Set pagesize and object handle and current object size */
     mp->pagesize    = pagesize;
@@ -206,8 +387,7 @@ mcache_open(void *key,       /* IN: byte string used as handle to share buffers
 
     /* Initialize list hash chain */
     for (pageno = 1; pageno <= mp->npages; ++pageno) {
-        lhead = &mp->lhqh[HASHKEY(pageno)];
-        if ((lp = (L_ELEM *)malloc(sizeof(L_ELEM))) == NULL)
+        if ((lp = (L_ELEM *)calloc(1, sizeof(L_ELEM))) == NULL)
             HGOTO_ERROR(DFE_NOSPACE, FAIL);
         lp->pgno = (int32)pageno; /* set page number */
 
@@ -222,13 +402,24 @@ mcache_open(void *key,       /* IN: byte string used as handle to share buffers
         lp->elemhit = 0;
         ++(mp->listalloc);
 #endif
-        H4_CIRCLEQ_INSERT_HEAD(lhead, lp, hl); /* add to list */
-    }                                          /* end for pageno */
+        mcache_add_elem(mp, lp); /* add to list */
+    }                            /* end for pageno */
 
     /* initialize input/output filters and cookie to NULL */
     mp->pgin     = NULL;
     mp->pgout    = NULL;
     mp->pgcookie = NULL;
+
+#ifdef H4_HAVE_THREADSAFE
+    if (HTSmutex_init(&mp->lock) == FAIL)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+#endif
+
+    /* join the pool of caches */
+    HTS_POOL_LOCK();
+    H4_CIRCLEQ_INSERT_TAIL(&mcache_pool, mp, pq);
+    HTS_POOL_UNLOCK();
+
 #ifdef STATISTICS
     mp->listhit   = 0;
     mp->cachehit  = 0;
@@ -244,19 +435,24 @@ mcache_open(void *key,       /* IN: byte string used as handle to share buffers
 
 done:
     if (ret_value == RET_ERROR) { /* error cleanup */
-        free(mp);
-        /* free up list elements */
-        for (entry = 0; entry < HASHSIZE; ++entry) {
-            while ((lp = mp->lhqh[entry].cqh_first) != (void *)&mp->lhqh[entry]) {
-                H4_CIRCLEQ_REMOVE(&mp->lhqh[entry], mp->lhqh[entry].cqh_first, hl);
-                free(lp);
-            }
-        } /* end for entry */
+        if (mp != NULL) {
+            /* free up list elements */
+            if (mp->ltab != NULL)
+                for (entry = 0; entry < mp->lsize; ++entry)
+                    while ((lp = mp->ltab[entry]) != NULL) {
+                        mp->ltab[entry] = lp->hnext;
+                        free(lp);
+                    }
+            free(mp->ltab);
+            free(mp->htab);
+            free(mp);
+        }
 
         mp = NULL; /* return value */
     }
 #ifdef STATISTICS
-    fprintf(stderr, "mcache_open: mp->listalloc=%lu\n", mp->listalloc);
+    else
+        fprintf(stderr, "mcache_open: mp->listalloc=%lu\n", mp->listalloc);
 #endif
 
     return mp;
@@ -303,12 +499,12 @@ mcache_get(MCACHE *mp,   /* IN: MCACHE cookie */
            int32   pgno, /* IN: page number */
            int32   flags /* IN: XXX not used? */)
 {
-    struct _hqh  *head      = NULL; /* head of lru queue */
-    struct _lhqh *lhead     = NULL; /* head of an entry in list hash chain */
-    BKT          *bp        = NULL; /* bucket element */
-    L_ELEM       *lp        = NULL;
-    int           ret_value = RET_SUCCESS;
-    int           list_hit; /* hit flag */
+    BKT    *bp        = NULL; /* bucket element */
+    L_ELEM *lp        = NULL;
+    int     ret_value = RET_SUCCESS;
+    int     ghost_hit = 0; /* page was dropped recently (MCACHE_ARC) */
+    int     b2hit     = 0; /* ... from the frequency queue */
+    int32   delta;         /* change of the ARC target */
 
     (void)flags;
 
@@ -316,6 +512,8 @@ mcache_get(MCACHE *mp,   /* IN: MCACHE cookie */
     if (mp == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
+    MCACHE_LOCK(mp);
+
     /* Check for attempting to retrieve a non-existent page.
      *  remember pages go from 1 ->npages  */
     if (pgno > mp->npages)
@@ -327,71 +525,98 @@ mcache_get(MCACHE *mp,   /* IN: MCACHE cookie */
 
     /* Check for a page that is cached. */
     if ((bp = mcache_look(mp, pgno)) != NULL) {
+        ++mp->hits;
+
         /*
-         * Move the page to the head of the hash chain and the tail
-         * of the lru chain.
+         * Move the page to the tail of its queue.  Under ARC a page used
+         * a second time moves to the tail of the frequency queue.
          */
-        head = &mp->hqh[HASHKEY(bp->pgno)];
-        H4_CIRCLEQ_REMOVE(head, bp, hq);
-        H4_CIRCLEQ_INSERT_HEAD(head, bp, hq);
-        H4_CIRCLEQ_REMOVE(&mp->lqh, bp, q);
-        H4_CIRCLEQ_INSERT_TAIL(&mp->lqh, bp, q);
+        if (bp->queue == MCACHE_T2) {
+            H4_CIRCLEQ_REMOVE(&mp->fqh, bp, q);
+            H4_CIRCLEQ_INSERT_TAIL(&mp->fqh, bp, q);
+        }
+        else {
+            H4_CIRCLEQ_REMOVE(&mp->lqh, bp, q);
+            if (mp->policy == MCACHE_ARC) {
+                H4_CIRCLEQ_INSERT_TAIL(&mp->fqh, bp, q);
+                bp->queue = MCACHE_T2;
+                ++mp->nt2;
+            }
+            else
+                H4_CIRCLEQ_INSERT_TAIL(&mp->lqh, bp, q);
+        }
         /* Return a pinned page. */
         bp->flags |= MCACHE_PINNED;
 
-        /* update this page reference */
-        lhead = &mp->lhqh[HASHKEY(bp->pgno)];
-        for (lp = lhead->cqh_first; lp != (void *)lhead; lp = lp->hl.cqe_next)
-            if (lp->pgno == bp->pgno) { /* hit */
 #ifdef STATISTICS
-                ++mp->listhit;
-                ++lp->elemhit;
+        /* update this page reference */
+        if ((lp = mcache_elem(mp, bp->pgno)) != NULL) {
+            ++mp->listhit;
+            ++lp->elemhit;
+        }
 #endif
-                break;
-            } /* end if lp->pgno */
 
         /* we are done */
         ret_value = RET_SUCCESS;
         goto done;
     } /* end if bp */
 
+    ++mp->misses;
+
+    /* Check to see if this page has ever been referenced */
+    lp = mcache_elem(mp, pgno);
+
+    /* Under ARC, asking again for a page dropped recently moves the target
+       size of the lru queue towards the queue it was dropped from */
+    if (lp != NULL && lp->ghost != 0) {
+        int32 cap = mcache_capacity(mp);
+
+        if (lp->ghost == MCACHE_B1) {
+            delta     = (mp->nb1 >= mp->nb2) ? 1 : mp->nb2 / mp->nb1;
+            mp->arc_p = MIN(mp->arc_p + delta, cap);
+            H4_CIRCLEQ_REMOVE(&mp->b1h, lp, gq);
+            --mp->nb1;
+        }
+        else {
+            delta     = (mp->nb2 >= mp->nb1) ? 1 : mp->nb1 / mp->nb2;
+            mp->arc_p = MAX(mp->arc_p - delta, 0);
+            H4_CIRCLEQ_REMOVE(&mp->b2h, lp, gq);
+            --mp->nb2;
+            b2hit = 1;
+        }
+        lp->ghost = 0;
+        ghost_hit = 1;
+    }
+
     /* Page not cached so
      * Get a page from the cache to use or create one. */
-    if ((bp = mcache_bkt(mp)) == NULL)
+    if ((bp = mcache_bkt(mp, b2hit)) == NULL)
         HE_REPORT_GOTO("unable to get a new page from bucket", FAIL);
 
-    /* Check to see if this page has ever been referenced */
-    list_hit = 0;
-    lhead    = &mp->lhqh[HASHKEY(pgno)];
-    for (lp = lhead->cqh_first; lp != (void *)lhead; lp = lp->hl.cqe_next)
-        if (lp->pgno == pgno && lp->eflags != 0) { /* hit */
+    /* If the page has never been referenced, or never been written, there
+       is no need to read it from disk */
+    if (lp == NULL || lp->eflags == 0) {
+        if (lp == NULL) { /* NO hit, new list element */
+            if ((lp = (L_ELEM *)calloc(1, sizeof(L_ELEM))) == NULL)
+                HGOTO_ERROR(DFE_NOSPACE, FAIL);
+
+            lp->pgno   = pgno;
+            lp->eflags = 0;
 #ifdef STATISTICS
-            ++mp->listhit;
-            ++lp->elemhit;
+            ++mp->listalloc;
 #endif
-            list_hit = 1;
-            break;
-        } /* end if lp->pgno */
-
-    /* If there is no hit then we allocate a new element
-     *  and insert into hash table */
-    if (!list_hit) { /* NO hit, new list element
-                      * no need to read this page from disk */
-        if ((lp = (L_ELEM *)malloc(sizeof(L_ELEM))) == NULL)
-            HGOTO_ERROR(DFE_NOSPACE, FAIL);
-
-        lp->pgno   = pgno;
-        lp->eflags = 0;
+            mcache_add_elem(mp, lp); /* add to list */
+        }
 #ifdef STATISTICS
-        ++mp->listalloc;
         lp->elemhit = 1;
 #endif
-        H4_CIRCLEQ_INSERT_HEAD(lhead, lp, hl); /* add to list */
-    }                                          /*end if !list_hit */
-    else {                                     /* list hit, need to read page */
-        lp->eflags = ELEM_READ;                /* Indicate we are reading this page */
+    }                           /*end if !list_hit */
+    else {                      /* list hit, need to read page */
+        lp->eflags = ELEM_READ; /* Indicate we are reading this page */
 
 #ifdef STATISTICS
+        ++mp->listhit;
+        ++lp->elemhit;
         ++mp->pageread;
 #endif
 
@@ -401,14 +626,12 @@ mcache_get(MCACHE *mp,   /* IN: MCACHE cookie */
         if (mp->pgin != NULL) { /* Note page numbers in HMCPxxx are 0 based not 1 based */
             if (((mp->pgin)(mp->pgcookie, pgno - 1, bp->page)) == FAIL) {
                 HEreport("mcache_get: error reading chunk=%d\n", (int)pgno - 1);
-                lp        = NULL; /* don't clobber the cache! */
                 ret_value = RET_ERROR;
                 goto done;
             }
         }
         else {
             HEreport("mcache_get: reading fcn not set,chunk=%d\n", (int)pgno - 1);
-            lp        = NULL;
             ret_value = RET_ERROR;
             goto done;
         }
@@ -417,23 +640,195 @@ mcache_get(MCACHE *mp,   /* IN: MCACHE cookie */
     /* Set the page number, pin the page. */
     bp->pgno  = pgno;
     bp->flags = MCACHE_PINNED;
+    bp->nused = 0;
 
     /*
-     * Add the page to the head of the hash chain and the tail
-     * of the lru chain.
+     * Add the page to the hash table and the tail of the lru queue, or of
+     * the frequency queue if ARC dropped it recently.
      */
-    head = &mp->hqh[HASHKEY(bp->pgno)];
-    H4_CIRCLEQ_INSERT_HEAD(head, bp, hq);
-    H4_CIRCLEQ_INSERT_TAIL(&mp->lqh, bp, q);
+    mcache_hinsert(mp, bp);
+    if (ghost_hit) {
+        H4_CIRCLEQ_INSERT_TAIL(&mp->fqh, bp, q);
+        bp->queue = MCACHE_T2;
+        ++mp->nt2;
+    }
+    else {
+        H4_CIRCLEQ_INSERT_TAIL(&mp->lqh, bp, q);
+        bp->queue = MCACHE_T1;
+    }
+    if (mp->policy == MCACHE_ARC)
+        mcache_trim_ghosts(mp);
 
 done:
     if (ret_value == RET_ERROR) { /* error cleanup */
-        free(lp);
-        return NULL;
+        if (bp != NULL) {         /* the page isn't on any list yet */
+            free(bp);
+            mcache_count(mp, -1);
+        }
+        bp = NULL;
     }
-    return bp->page;
+    if (mp != NULL)
+        MCACHE_UNLOCK(mp);
+    return bp == NULL ? NULL : bp->page;
 } /* mcache_get() */
 
+/******************************************************************************
+NAME
+   mcache_used -- record how much of a page has been used
+
+DESCRIPTION
+    Adds 'nbytes' to the bytes of a pinned page read or written since it
+    was cached.  Once every byte of the page has been used the page is
+    the first candidate for replacement under MCACHE_W0.
+
+RETURNS
+    RET_SUCCESS if successful and RET_ERROR otherwise
+******************************************************************************/
+int
+mcache_used(MCACHE *mp,   /* IN: MCACHE cookie */
+            void   *page, /* IN: page gotten with mcache_get */
+            int32   nbytes /* IN: # of bytes of the page used */)
+{
+    BKT *bp        = NULL; /* bucket element ptr */
+    int  ret_value = RET_SUCCESS;
+
+    /* check inputs */
+    if (mp == NULL || page == NULL || nbytes < 0)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    /* get pointer to bucket element */
+    bp = (BKT *)((char *)page - sizeof(BKT));
+
+    MCACHE_LOCK(mp);
+    if (nbytes >= mp->pagesize - bp->nused)
+        bp->nused = mp->pagesize;
+    else
+        bp->nused += nbytes;
+    if (bp->nused == mp->pagesize)
+        bp->flags |= MCACHE_DONE;
+    MCACHE_UNLOCK(mp);
+
+done:
+    return ret_value;
+} /* mcache_used () */
+
+/******************************************************************************
+NAME
+   mcache_cached -- check whether a page is in the cache
+
+DESCRIPTION
+    Looks the page up without getting it, so the page isn't pinned or
+    moved in its queue and the hit isn't counted.
+
+RETURNS
+    TRUE if the page is cached and FALSE otherwise
+******************************************************************************/
+int
+mcache_cached(MCACHE *mp,  /* IN: MCACHE cookie */
+              int32   pgno /* IN: page number */)
+{
+    int ret_value = FALSE;
+
+    if (mp == NULL || pgno < 1 || pgno > mp->npages)
+        return FALSE;
+
+    MCACHE_LOCK(mp);
+    ret_value = mcache_look(mp, pgno) != NULL ? TRUE : FALSE;
+    MCACHE_UNLOCK(mp);
+
+    return ret_value;
+} /* mcache_cached () */
+
+/******************************************************************************
+NAME
+   mcache_get_stats -- get the statistics of a cache
+
+DESCRIPTION
+    Fills in the number of pages found in the cache (hits), read in or
+    created (misses), dropped to make room in the cache (evictions) and
+    taken by other caches of the pool (reclaims), and the pages it holds
+    now.
+
+RETURNS
+    RET_SUCCESS if successful and RET_ERROR otherwise
+******************************************************************************/
+int
+mcache_get_stats(MCACHE          *mp, /* IN: MCACHE cookie */
+                 HDF_CACHE_STATS *stats /* OUT: statistics of the cache */)
+{
+    int ret_value = RET_SUCCESS;
+
+    /* check inputs */
+    if (mp == NULL || stats == NULL)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    MCACHE_LOCK(mp);
+    stats->hits      = mp->hits;
+    stats->misses    = mp->misses;
+    stats->evictions = mp->evictions;
+    stats->reclaims  = mp->reclaims;
+    stats->nchunks   = mp->curcache;
+    stats->chunksize = mp->pagesize;
+    MCACHE_UNLOCK(mp);
+
+done:
+    return ret_value;
+} /* mcache_get_stats () */
+
+/******************************************************************************
+NAME
+   mcache_set_budget -- set the budget of bytes all caches share
+
+DESCRIPTION
+    Bounds the bytes of pages held by all of the caches together, see
+    mcache_pool above for how the budget is shared.  A budget of 0 lifts
+    the bound, leaving each cache bounded only by its own capacity.  When
+    the caches hold more than a new budget, clean pages are dropped from
+    the caches most over their share.
+
+RETURNS
+    RET_SUCCESS if successful and RET_ERROR otherwise
+******************************************************************************/
+int
+mcache_set_budget(hdf_off_t budget /* IN: bytes all caches may hold, 0 for no bound */)
+{
+    int ret_value = RET_SUCCESS;
+
+    /* check inputs */
+    if (budget < 0)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    HTS_POOL_LOCK();
+    mcache_budget = budget;
+    if (mcache_budget > 0 && mcache_nbytes > mcache_budget)
+        mcache_reclaim(NULL, mcache_nbytes - mcache_budget);
+    HTS_POOL_UNLOCK();
+
+done:
+    return ret_value;
+} /* mcache_set_budget () */
+
+/******************************************************************************
+NAME
+   mcache_get_budget -- get the budget of bytes all caches share
+
+RETURNS
+    RET_SUCCESS if successful and RET_ERROR otherwise
+******************************************************************************/
+int
+mcache_get_budget(hdf_off_t *budget, /* OUT: bytes all caches may hold */
+                  hdf_off_t *nbytes /* OUT: bytes all caches hold now */)
+{
+    HTS_POOL_LOCK();
+    if (budget != NULL)
+        *budget = mcache_budget;
+    if (nbytes != NULL)
+        *nbytes = mcache_nbytes;
+    HTS_POOL_UNLOCK();
+
+    return RET_SUCCESS;
+} /* mcache_get_budget () */
+
 /******************************************************************************
 NAME
    mcache_put -- put a page back into the memory buffer pool
@@ -450,10 +845,9 @@ mcache_put(MCACHE *mp,   /* IN: MCACHE cookie */
            void   *page, /* IN: page to put */
            int32   flags /* IN: flags = 0, MCACHE_DIRTY */)
 {
-    struct _lhqh *lhead     = NULL; /* head of an entry in list hash chain */
-    L_ELEM       *lp        = NULL;
-    BKT          *bp        = NULL; /* bucket element ptr */
-    int           ret_value = RET_SUCCESS;
+    L_ELEM *lp        = NULL;
+    BKT    *bp        = NULL; /* bucket element ptr */
+    int     ret_value = RET_SUCCESS;
 
     /* check inputs */
     if (mp == NULL || page == NULL)
@@ -465,23 +859,24 @@ mcache_put(MCACHE *mp,   /* IN: MCACHE cookie */
     /* get pointer to bucket element */
     bp = (BKT *)((char *)page - sizeof(BKT));
 
+    MCACHE_LOCK(mp);
+
     /* Unpin the page and mark it appropriately */
     bp->flags &= ~MCACHE_PINNED;
     bp->flags |= flags & MCACHE_DIRTY;
 
     if (bp->flags & MCACHE_DIRTY) { /* update this page reference */
-        lhead = &mp->lhqh[HASHKEY(bp->pgno)];
-        for (lp = lhead->cqh_first; lp != (void *)lhead; lp = lp->hl.cqe_next)
-            if (lp->pgno == bp->pgno) { /* hit */
+        if ((lp = mcache_elem(mp, bp->pgno)) != NULL) {
 #ifdef STATISTICS
-                ++mp->listhit;
-                ++lp->elemhit;
+            ++mp->listhit;
+            ++lp->elemhit;
 #endif
-                lp->eflags = ELEM_WRITTEN;
-                break;
-            } /* end if lp->pgno */
+            lp->eflags = ELEM_WRITTEN;
+        }
     }
 
+    MCACHE_UNLOCK(mp);
+
 done:
     return ret_value;
 } /* mcache_put () */
@@ -503,22 +898,34 @@ mcache_close(MCACHE *mp /* IN: MCACHE cookie */)
     L_ELEM *lp        = NULL;
     BKT    *bp        = NULL; /* bucket element */
     int     ret_value = RET_SUCCESS;
-    int     entry; /* index into hash table */
+    uint32  entry; /* index into hash table */
 
     /* check inputs */
     if (mp == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
-    /* Free up any space allocated to the lru pages. */
+    MCACHE_LOCK(mp);
+
+    /* leave the pool of caches */
+    HTS_POOL_LOCK();
+    H4_CIRCLEQ_REMOVE(&mcache_pool, mp, pq);
+    mcache_count(mp, -mp->curcache);
+    HTS_POOL_UNLOCK();
+
+    /* Free up any space allocated to the cached pages. */
     while ((bp = mp->lqh.cqh_first) != (void *)&mp->lqh) {
         H4_CIRCLEQ_REMOVE(&mp->lqh, mp->lqh.cqh_first, q);
         free(bp);
     }
+    while ((bp = mp->fqh.cqh_first) != (void *)&mp->fqh) {
+        H4_CIRCLEQ_REMOVE(&mp->fqh, mp->fqh.cqh_first, q);
+        free(bp);
+    }
 
     /* free up list elements */
-    for (entry = 0; entry < HASHSIZE; ++entry) {
-        while ((lp = mp->lhqh[entry].cqh_first) != (void *)&mp->lhqh[entry]) {
-            H4_CIRCLEQ_REMOVE(&mp->lhqh[entry], mp->lhqh[entry].cqh_first, hl);
+    for (entry = 0; entry < mp->lsize; ++entry) {
+        while ((lp = mp->ltab[entry]) != NULL) {
+            mp->ltab[entry] = lp->hnext;
             free(lp);
         }
     } /* end for entry */
@@ -528,7 +935,14 @@ done:
         return ret_value;
     }
 
-    /* Free the MCACHE cookie. */
+    MCACHE_UNLOCK(mp);
+#ifdef H4_HAVE_THREADSAFE
+    HTSmutex_destroy(&mp->lock);
+#endif
+
+    /* Free the hash tables and the MCACHE cookie. */
+    free(mp->ltab);
+    free(mp->htab);
     free(mp);
 
     return ret_value;
@@ -554,12 +968,24 @@ mcache_sync(MCACHE *mp /* IN: MCACHE cookie */)
     if (mp == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
-    /* Walk the lru chain, flushing any dirty pages to disk. */
+    MCACHE_LOCK(mp);
+
+    /* Walk the queues, flushing any dirty pages to disk. */
     for (bp = mp->lqh.cqh_first; bp != (void *)&mp->lqh; bp = bp->q.cqe_next) {
-        if (bp->flags & MCACHE_DIRTY && mcache_write(mp, bp) == RET_ERROR)
+        if (bp->flags & MCACHE_DIRTY && mcache_write(mp, bp) == RET_ERROR) {
+            MCACHE_UNLOCK(mp);
+            HE_REPORT_GOTO("unable to flush a dirty page", FAIL);
+        }
+    } /* end for bp */
+    for (bp = mp->fqh.cqh_first; bp != (void *)&mp->fqh; bp = bp->q.cqe_next) {
+        if (bp->flags & MCACHE_DIRTY && mcache_write(mp, bp) == RET_ERROR) {
+            MCACHE_UNLOCK(mp);
             HE_REPORT_GOTO("unable to flush a dirty page", FAIL);
+        }
     } /* end for bp */
 
+    MCACHE_UNLOCK(mp);
+
 done:
     if (ret_value == RET_ERROR) { /* error cleanup */
         return ret_value;
@@ -568,6 +994,158 @@ done:
     return ret_value;
 } /* mcache_sync() */
 
+/******************************************************************************
+NAME
+   mcache_capacity - the number of pages the cache may hold.
+
+DESCRIPTION
+   Private routine. The capacity is 'maxbytes' worth of pages (at least
+   one) when a byte bound is set, and 'maxcache' pages otherwise.
+
+RETURNS
+   The capacity of the cache in pages.
+******************************************************************************/
+static int32
+mcache_capacity(MCACHE *mp /* IN: MCACHE cookie */)
+{
+    if (mp->maxbytes > 0)
+        return MAX(mp->maxbytes / mp->pagesize, 1);
+    return mp->maxcache;
+} /* mcache_capacity() */
+
+/******************************************************************************
+NAME
+   mcache_victim - choose the page to drop from a full cache.
+
+DESCRIPTION
+   Private routine. Picks an unpinned page according to the replacement
+   policy (see mcache_set_policy()).  'b2hit' tells ARC that the page
+   being brought in was dropped recently from the frequency queue.
+
+RETURNS
+   The page to drop, or NULL if every page is pinned.
+******************************************************************************/
+static BKT *
+mcache_victim(MCACHE *mp, /* IN: MCACHE cookie */
+              int     b2hit /* IN: page wanted was dropped from fqh */)
+{
+    BKT  *bp = NULL; /* bucket element */
+    int32 nt1;       /* # of pages on the lru queue */
+
+    /* W0 drops pages which have been used up first */
+    if (mp->policy == MCACHE_W0)
+        for (bp = mp->lqh.cqh_first; bp != (void *)&mp->lqh; bp = bp->q.cqe_next)
+            if ((bp->flags & (MCACHE_PINNED | MCACHE_DONE)) == MCACHE_DONE)
+                return bp;
+
+    /* ARC drops from the frequency queue while the lru queue is within
+       its target size */
+    if (mp->policy == MCACHE_ARC) {
+        nt1 = mp->curcache - mp->nt2;
+        if (nt1 == 0 || (nt1 < mp->arc_p || (nt1 == mp->arc_p && !b2hit)))
+            for (bp = mp->fqh.cqh_first; bp != (void *)&mp->fqh; bp = bp->q.cqe_next)
+                if (!(bp->flags & MCACHE_PINNED))
+                    return bp;
+    }
+
+    /* otherwise the least recently used unpinned page */
+    for (bp = mp->lqh.cqh_first; bp != (void *)&mp->lqh; bp = bp->q.cqe_next)
+        if (!(bp->flags & MCACHE_PINNED))
+            return bp;
+
+    /* the lru queue is all pinned */
+    for (bp = mp->fqh.cqh_first; bp != (void *)&mp->fqh; bp = bp->q.cqe_next)
+        if (!(bp->flags & MCACHE_PINNED))
+            return bp;
+
+    return NULL;
+} /* mcache_victim() */
+
+/******************************************************************************
+NAME
+   mcache_evict - take a page out of the cache.
+
+DESCRIPTION
+   Private routine. Writes the page out if it is dirty and takes it off
+   the hash table and its queue.  Under ARC the page is remembered on the
+   ghost queue matching the queue it was on.  The page itself is not
+   freed.
+
+RETURNS
+   RET_SUCCESS if successful and RET_ERROR otherwise
+******************************************************************************/
+static int
+mcache_evict(MCACHE *mp, /* IN: MCACHE cookie */
+             BKT    *bp /* IN: page to take out */)
+{
+    L_ELEM *lp        = NULL;
+    int     ret_value = RET_SUCCESS;
+
+    /* Flush if dirty. */
+    if (bp->flags & MCACHE_DIRTY && mcache_write(mp, bp) == RET_ERROR)
+        HE_REPORT_GOTO("unable to flush a dirty page", FAIL);
+#ifdef STATISTICS
+    ++mp->pageflush;
+#endif
+
+    /* Remove from the hash table and its queue. */
+    mcache_hremove(mp, bp);
+    if (bp->queue == MCACHE_T2) {
+        H4_CIRCLEQ_REMOVE(&mp->fqh, bp, q);
+        --mp->nt2;
+    }
+    else
+        H4_CIRCLEQ_REMOVE(&mp->lqh, bp, q);
+
+    /* remember the page on a ghost queue */
+    if (mp->policy == MCACHE_ARC && (lp = mcache_elem(mp, bp->pgno)) != NULL && lp->ghost == 0) {
+        if (bp->queue == MCACHE_T2) {
+            H4_CIRCLEQ_INSERT_TAIL(&mp->b2h, lp, gq);
+            lp->ghost = MCACHE_B2;
+            ++mp->nb2;
+        }
+        else {
+            H4_CIRCLEQ_INSERT_TAIL(&mp->b1h, lp, gq);
+            lp->ghost = MCACHE_B1;
+            ++mp->nb1;
+        }
+    }
+
+done:
+    return ret_value;
+} /* mcache_evict() */
+
+/******************************************************************************
+NAME
+   mcache_trim - drop pages until the cache fits its capacity.
+
+DESCRIPTION
+   Private routine. Used when the capacity of the cache shrinks.  Stops
+   early if the remaining pages are pinned.
+
+RETURNS
+   RET_SUCCESS if successful and RET_ERROR otherwise
+******************************************************************************/
+static int
+mcache_trim(MCACHE *mp /* IN: MCACHE cookie */)
+{
+    BKT *bp        = NULL; /* bucket element */
+    int  ret_value = RET_SUCCESS;
+
+    while (mp->curcache > mcache_capacity(mp) && (bp = mcache_victim(mp, 0)) != NULL) {
+        if (mcache_evict(mp, bp) == RET_ERROR)
+            HE_REPORT_GOTO("unable to drop a page", FAIL);
+        free(bp);
+        mcache_count(mp, -1);
+        ++mp->evictions;
+    }
+    if (mp->policy == MCACHE_ARC)
+        mcache_trim_ghosts(mp);
+
+done:
+    return ret_value;
+} /* mcache_trim() */
+
 /******************************************************************************
 NAME
    mcache_bkt - Get a page from the cache (or create one).
@@ -585,42 +1163,37 @@ NOTE: Note that the size of the page allocated is equal to
       information by writing out of the page size bounds.
 ******************************************************************************/
 static BKT *
-mcache_bkt(MCACHE *mp /* IN: MCACHE cookie */)
+mcache_bkt(MCACHE *mp, /* IN: MCACHE cookie */
+           int     b2hit /* IN: page wanted was dropped from fqh */)
 {
-    struct _hqh *head      = NULL; /* head of hash chain */
-    BKT         *bp        = NULL; /* bucket element */
-    int          ret_value = RET_SUCCESS;
+    BKT *bp        = NULL; /* bucket element */
+    int  ret_value = RET_SUCCESS;
 
     /* check inputs */
     if (mp == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
-    /* If under the max cached, always create a new page. */
-    if ((int32)mp->curcache < (int32)mp->maxcache)
+    /* If under the max cached, create a new page unless the pool is out of
+       budget and this cache holds more than its share */
+    if (mp->curcache < mcache_capacity(mp) && mcache_pool_room(mp))
         goto new;
 
     /*
-     * If the cache is max'd out, walk the lru list for a buffer we
+     * If the cache is max'd out, ask the replacement policy for a buffer we
      * can flush.  If we find one, write it (if necessary) and take it
      * off any lists.  If we don't find anything we grow the cache anyway.
-     * The cache never shrinks.
      */
-    for (bp = mp->lqh.cqh_first; bp != (void *)&mp->lqh; bp = bp->q.cqe_next)
-        if (!(bp->flags & MCACHE_PINNED)) { /* Flush if dirty. */
-            if (bp->flags & MCACHE_DIRTY && mcache_write(mp, bp) == RET_ERROR)
-                HE_REPORT_GOTO("unable to flush a dirty page", FAIL);
-#ifdef STATISTICS
-            ++mp->pageflush;
-#endif
-            /* Remove from the hash and lru queues. */
-            head = &mp->hqh[HASHKEY(bp->pgno)];
-            H4_CIRCLEQ_REMOVE(head, bp, hq);
-            H4_CIRCLEQ_REMOVE(&mp->lqh, bp, q);
+    if ((bp = mcache_victim(mp, b2hit)) != NULL) {
+        if (mcache_evict(mp, bp) == RET_ERROR) {
+            bp = NULL; /* still in the cache */
+            HE_REPORT_GOTO("unable to flush a dirty page", FAIL);
+        }
+        ++mp->evictions;
 
-            /* done */
-            ret_value = RET_SUCCESS;
-            goto done;
-        } /* end if bp->flags */
+        /* done */
+        ret_value = RET_SUCCESS;
+        goto done;
+    } /* end if bp */
 
     /* create a new page */
     new : if ((bp = (BKT *)malloc(sizeof(BKT) + (unsigned)mp->pagesize)) == NULL)
@@ -632,11 +1205,10 @@ mcache_bkt(MCACHE *mp /* IN: MCACHE cookie */)
 
     /* set page ptr past bucket element section */
     bp->page = (char *)bp + sizeof(BKT);
-    ++mp->curcache; /* increase number of cached pages */
+    mcache_count(mp, 1); /* increase number of cached pages */
 
 done:
     if (ret_value == RET_ERROR) { /* error cleanup */
-        free(bp);
         return NULL;
     }
 
@@ -657,9 +1229,8 @@ static int
 mcache_write(MCACHE *mp, /* IN: MCACHE cookie */
              BKT    *bp /* IN: bucket element */)
 {
-    struct _lhqh *lhead     = NULL; /* head of an entry in list hash chain */
-    L_ELEM       *lp        = NULL;
-    int           ret_value = RET_SUCCESS;
+    L_ELEM *lp        = NULL;
+    int     ret_value = RET_SUCCESS;
 
     /* check inputs */
     if (mp == NULL || bp == NULL)
@@ -670,16 +1241,13 @@ mcache_write(MCACHE *mp, /* IN: MCACHE cookie */
 #endif
 
     /* update this page reference */
-    lhead = &mp->lhqh[HASHKEY(bp->pgno)];
-    for (lp = lhead->cqh_first; lp != (void *)lhead; lp = lp->hl.cqe_next)
-        if (lp->pgno == bp->pgno) { /* hit */
+    if ((lp = mcache_elem(mp, bp->pgno)) != NULL) {
 #ifdef STATISTICS
-            ++mp->listhit;
-            ++lp->elemhit;
+        ++mp->listhit;
+        ++lp->elemhit;
 #endif
-            lp->eflags = ELEM_SYNC;
-            break;
-        }
+        lp->eflags = ELEM_SYNC;
+    }
 
     /* Run page through the user's filter.
        we use this to write the data chunk/page out.
@@ -722,8 +1290,7 @@ static BKT *
 mcache_look(MCACHE *mp, /* IN: MCACHE cookie */
             int32   pgno /* IN: page to look up in cache */)
 {
-    struct _hqh *head = NULL; /* head of hash chain */
-    BKT         *bp   = NULL; /* bucket element */
+    BKT *bp = NULL; /* bucket element */
 
     /* check inputs */
     if (mp == NULL) {
@@ -738,8 +1305,7 @@ mcache_look(MCACHE *mp, /* IN: MCACHE cookie */
     }
 
     /* search through hash chain */
-    head = &mp->hqh[HASHKEY(pgno)];
-    for (bp = head->cqh_first; bp != (void *)head; bp = bp->hq.cqe_next)
+    for (bp = mp->htab[HASHKEY(pgno, mp->hsize)]; bp != NULL; bp = bp->hnext)
         if (bp->pgno == pgno) { /* hit....found page in cache */
 #ifdef STATISTICS
             ++mp->cachehit;
@@ -759,6 +1325,320 @@ done:
     return bp;
 } /* mcache_look() */
 
+/******************************************************************************
+NAME
+   mcache_hinsert - add a page to the page hash table.
+
+DESCRIPTION
+   Private routine. The table doubles in size once there are more cached
+   pages than buckets.  If the bigger table can't be allocated the old one
+   is kept; its chains just get longer.
+
+RETURNS
+   Nothing
+******************************************************************************/
+static void
+mcache_hinsert(MCACHE *mp, /* IN: MCACHE cookie */
+               BKT    *bp /* IN: page to add */)
+{
+    BKT   **newtab = NULL; /* doubled hash table */
+    BKT    *next   = NULL;
+    uint32  newsize;
+    uint32  entry; /* index into hash table */
+    uint32  key;
+
+    if ((uint32)mp->curcache > mp->hsize && mp->hsize < 0x40000000) {
+        newsize = mp->hsize * 2;
+        if ((newtab = (BKT **)calloc(newsize, sizeof(BKT *))) != NULL) {
+            for (entry = 0; entry < mp->hsize; ++entry)
+                for (BKT *hp = mp->htab[entry]; hp != NULL; hp = next) {
+                    next         = hp->hnext;
+                    key          = HASHKEY(hp->pgno, newsize);
+                    hp->hnext    = newtab[key];
+                    newtab[key]  = hp;
+                }
+            free(mp->htab);
+            mp->htab  = newtab;
+            mp->hsize = newsize;
+        }
+    }
+
+    key           = HASHKEY(bp->pgno, mp->hsize);
+    bp->hnext     = mp->htab[key];
+    mp->htab[key] = bp;
+} /* mcache_hinsert() */
+
+/******************************************************************************
+NAME
+   mcache_hremove - take a page off the page hash table.
+
+RETURNS
+   Nothing
+******************************************************************************/
+static void
+mcache_hremove(MCACHE *mp, /* IN: MCACHE cookie */
+               BKT    *bp /* IN: page to take off */)
+{
+    BKT **hpp; /* link pointing to the page */
+
+    for (hpp = &mp->htab[HASHKEY(bp->pgno, mp->hsize)]; *hpp != NULL; hpp = &(*hpp)->hnext)
+        if (*hpp == bp) {
+            *hpp = bp->hnext;
+            break;
+        }
+} /* mcache_hremove() */
+
+/******************************************************************************
+NAME
+   mcache_elem - lookup the element of a page.
+
+DESCRIPTION
+   Private routine. Every page which has been referenced has an element,
+   which records whether the page is on disk.
+
+RETURNS
+   The element if found and NULL otherwise.
+******************************************************************************/
+static L_ELEM *
+mcache_elem(MCACHE *mp, /* IN: MCACHE cookie */
+            int32   pgno /* IN: page to look up */)
+{
+    L_ELEM *lp = NULL;
+
+    for (lp = mp->ltab[HASHKEY(pgno, mp->lsize)]; lp != NULL; lp = lp->hnext)
+        if (lp->pgno == pgno)
+            break;
+    return lp;
+} /* mcache_elem() */
+
+/******************************************************************************
+NAME
+   mcache_add_elem - add an element to the element hash table.
+
+DESCRIPTION
+   Private routine. Like the page table, the element table doubles in
+   size once there are more elements than buckets.
+
+RETURNS
+   Nothing
+******************************************************************************/
+static void
+mcache_add_elem(MCACHE *mp, /* IN: MCACHE cookie */
+                L_ELEM *lp /* IN: element to add */)
+{
+    L_ELEM **newtab = NULL; /* doubled hash table */
+    L_ELEM  *next   = NULL;
+    uint32   newsize;
+    uint32   entry; /* index into hash table */
+    uint32   key;
+
+    if ((uint32)++mp->nelems > mp->lsize && mp->lsize < 0x40000000) {
+        newsize = mp->lsize * 2;
+        if ((newtab = (L_ELEM **)calloc(newsize, sizeof(L_ELEM *))) != NULL) {
+            for (entry = 0; entry < mp->lsize; ++entry)
+                for (L_ELEM *ep = mp->ltab[entry]; ep != NULL; ep = next) {
+                    next        = ep->hnext;
+                    key         = HASHKEY(ep->pgno, newsize);
+                    ep->hnext   = newtab[key];
+                    newtab[key] = ep;
+                }
+            free(mp->ltab);
+            mp->ltab  = newtab;
+            mp->lsize = newsize;
+        }
+    }
+
+    key           = HASHKEY(lp->pgno, mp->lsize);
+    lp->hnext     = mp->ltab[key];
+    mp->ltab[key] = lp;
+} /* mcache_add_elem() */
+
+/******************************************************************************
+NAME
+   mcache_trim_ghosts - keep the ARC ghost queues within bounds.
+
+DESCRIPTION
+   Private routine. ARC remembers at most a cache's worth of pages dropped
+   from the lru queue, counting the lru queue itself, and at most two
+   caches' worth of pages in all.
+
+RETURNS
+   Nothing
+******************************************************************************/
+static void
+mcache_trim_ghosts(MCACHE *mp /* IN: MCACHE cookie */)
+{
+    L_ELEM *lp  = NULL;
+    int32   cap = mcache_capacity(mp);
+
+    while (mp->nb1 > 0 && (mp->curcache - mp->nt2) + mp->nb1 > cap) {
+        lp = mp->b1h.cqh_first;
+        H4_CIRCLEQ_REMOVE(&mp->b1h, lp, gq);
+        lp->ghost = 0;
+        --mp->nb1;
+    }
+    while (mp->nb2 > 0 && mp->curcache + mp->nb1 + mp->nb2 > 2 * cap) {
+        lp = mp->b2h.cqh_first;
+        H4_CIRCLEQ_REMOVE(&mp->b2h, lp, gq);
+        lp->ghost = 0;
+        --mp->nb2;
+    }
+} /* mcache_trim_ghosts() */
+
+/******************************************************************************
+NAME
+   mcache_clear_ghosts - empty the ARC ghost queues.
+
+RETURNS
+   Nothing
+******************************************************************************/
+static void
+mcache_clear_ghosts(MCACHE *mp /* IN: MCACHE cookie */)
+{
+    L_ELEM *lp = NULL;
+
+    while ((lp = mp->b1h.cqh_first) != (void *)&mp->b1h) {
+        H4_CIRCLEQ_REMOVE(&mp->b1h, lp, gq);
+        lp->ghost = 0;
+    }
+    while ((lp = mp->b2h.cqh_first) != (void *)&mp->b2h) {
+        H4_CIRCLEQ_REMOVE(&mp->b2h, lp, gq);
+        lp->ghost = 0;
+    }
+    mp->nb1 = 0;
+    mp->nb2 = 0;
+} /* mcache_clear_ghosts() */
+
+/******************************************************************************
+NAME
+   mcache_count - change the number of pages a cache holds.
+
+DESCRIPTION
+   Private routine. Keeps the bytes held by the pool and the number of
+   caches holding pages up to date.
+
+RETURNS
+   Nothing
+******************************************************************************/
+static void
+mcache_count(MCACHE *mp, /* IN: MCACHE cookie */
+             int32   npages /* IN: # of pages added, or taken away if < 0 */)
+{
+    int32 curcache = mp->curcache; /* # of pages before */
+
+    HTS_POOL_LOCK();
+    mp->curcache += npages;
+    mcache_nbytes += (hdf_off_t)npages * mp->pagesize;
+    if (curcache == 0 && mp->curcache > 0)
+        ++mcache_nactive;
+    else if (curcache > 0 && mp->curcache == 0)
+        --mcache_nactive;
+    HTS_POOL_UNLOCK();
+} /* mcache_count() */
+
+/******************************************************************************
+NAME
+   mcache_pool_room - make room in the pool for another page of a cache.
+
+DESCRIPTION
+   Private routine. Called with the cache locked, before the cache adds a
+   page.  If the pool is out of budget and the cache holds more than its
+   share of it, the cache should replace one of its own pages instead.
+   Otherwise clean pages are taken from the caches most over their share.
+
+RETURNS
+   TRUE if the cache may add a page, FALSE if it should replace one.
+******************************************************************************/
+static int
+mcache_pool_room(MCACHE *mp /* IN: MCACHE cookie */)
+{
+    hdf_off_t share;            /* fair share of the budget */
+    int       ret_value = TRUE;
+
+    HTS_POOL_LOCK();
+    if (mcache_budget == 0 || mcache_nbytes + mp->pagesize <= mcache_budget)
+        goto done;
+
+    /* count this cache among those sharing the budget */
+    share = mcache_budget / (mcache_nactive + (mp->curcache == 0 ? 1 : 0));
+    if (mp->curcache > 0 && (hdf_off_t)(mp->curcache + 1) * mp->pagesize > share)
+        ret_value = FALSE;
+    else
+        mcache_reclaim(mp, mcache_nbytes + mp->pagesize - mcache_budget);
+
+done:
+    HTS_POOL_UNLOCK();
+    return ret_value;
+} /* mcache_pool_room() */
+
+/******************************************************************************
+NAME
+   mcache_reclaim - take clean pages from the caches most over their share.
+
+DESCRIPTION
+   Private routine. Called with the pool locked.  Takes unpinned pages
+   which need not be written out from caches other than 'self' (which may
+   be NULL), the cache most over its share of the budget first, until
+   'nbytes' bytes have been freed or none of the caches over their share
+   can give any up.  Caches in use by another thread are passed over.
+
+RETURNS
+   Nothing
+******************************************************************************/
+static void
+mcache_reclaim(MCACHE   *self, /* IN: cache the room is made for, or NULL */
+               hdf_off_t nbytes /* IN: # of bytes to free */)
+{
+    MCACHE   *mp     = NULL;
+    MCACHE   *victim = NULL; /* cache most over its share */
+    BKT      *bp     = NULL; /* bucket element */
+    BKT      *next   = NULL;
+    hdf_off_t share;         /* fair share of the budget */
+    hdf_off_t over;          /* bytes victim holds over its share */
+    hdf_off_t freed = 0;     /* bytes freed so far */
+    int32     taken;         /* pages taken from victim */
+    int       pass;
+
+    while (freed < nbytes && mcache_nactive > 0) {
+        /* count 'self' among those sharing the budget */
+        share  = mcache_budget / (mcache_nactive + (self != NULL && self->curcache == 0 ? 1 : 0));
+        victim = NULL;
+        over   = 0;
+        for (mp = mcache_pool.cqh_first; mp != (void *)&mcache_pool; mp = mp->pq.cqe_next)
+            if (mp != self && (hdf_off_t)mp->curcache * mp->pagesize - share > over) {
+                victim = mp;
+                over   = (hdf_off_t)mp->curcache * mp->pagesize - share;
+            }
+        if (victim == NULL || !MCACHE_TRYLOCK(victim))
+            break;
+
+        /* least recently used pages first, then the frequency queue */
+        taken = 0;
+        for (pass = 0; pass < 2; pass++) {
+            bp = pass == 0 ? victim->lqh.cqh_first : victim->fqh.cqh_first;
+            for (; bp != (pass == 0 ? (void *)&victim->lqh : (void *)&victim->fqh) && freed < nbytes &&
+                   (hdf_off_t)victim->curcache * victim->pagesize > share;
+                 bp = next) {
+                next = bp->q.cqe_next;
+                if (bp->flags & (MCACHE_PINNED | MCACHE_DIRTY))
+                    continue;
+                mcache_evict(victim, bp); /* clean, so nothing is written */
+                free(bp);
+                mcache_count(victim, -1);
+                ++victim->reclaims;
+                freed += victim->pagesize;
+                ++taken;
+            }
+        }
+        if (victim->policy == MCACHE_ARC)
+            mcache_trim_ghosts(victim);
+        MCACHE_UNLOCK(victim);
+
+        if (taken == 0)
+            break;
+    }
+} /* mcache_reclaim() */
+
 #ifdef STATISTICS
 #ifdef H4_HAVE_GETRUSAGE
 
@@ -803,13 +1683,12 @@ RETURNS
 void
 mcache_stat(MCACHE *mp /* IN: MCACHE cookie */)
 {
-    struct _lhqh *lhead = NULL; /* head of an entry in list hash chain */
-    BKT          *bp    = NULL; /* bucket element */
-    L_ELEM       *lp    = NULL;
-    char         *sep   = NULL;
-    int           entry; /* index into hash table */
-    int           cnt;
-    int           hitcnt;
+    BKT    *bp  = NULL; /* bucket element */
+    L_ELEM *lp  = NULL;
+    char   *sep = NULL;
+    uint32  entry; /* index into hash table */
+    int     cnt;
+    int     hitcnt;
 
 #ifdef H4_HAVE_GETRUSAGE
     myrusage();
@@ -819,7 +1698,9 @@ mcache_stat(MCACHE *mp /* IN: MCACHE cookie */)
     if (mp != NULL) {
         fprintf(stderr, "%u pages in the object\n", mp->npages);
         fprintf(stderr, "page size %u, caching %u pages of %u page max cache\n", mp->pagesize, mp->curcache,
-                mp->maxcache);
+                mcache_capacity(mp));
+        fprintf(stderr, "policy %d, %u pages in frequency queue, %u/%u ghost pages\n", mp->policy, mp->nt2,
+                mp->nb1, mp->nb2);
         fprintf(stderr, "%u page puts, %u page gets, %u page new\n", mp->pageput, mp->pageget, mp->pagenew);
         fprintf(stderr, "%u page allocs, %u page flushes\n", mp->pagealloc, mp->pageflush);
         if (mp->cachehit + mp->cachemiss)
@@ -853,9 +1734,8 @@ mcache_stat(MCACHE *mp /* IN: MCACHE cookie */)
         sep    = "";
         cnt    = 0;
         hitcnt = 0;
-        for (entry = 0; entry < HASHSIZE; ++entry) {
-            lhead = &mp->lhqh[entry];
-            for (lp = lhead->cqh_first; lp != (void *)lhead; lp = lp->hl.cqe_next) {
+        for (entry = 0; entry < mp->lsize; ++entry) {
+            for (lp = mp->ltab[entry]; lp != NULL; lp = lp->hnext) {
                 cnt++;
                 fprintf(stderr, "%s%u(%u)", sep, lp->pgno, lp->elemhit);
                 hitcnt += lp->elemhit;
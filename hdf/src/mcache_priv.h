@@ -50,7 +50,8 @@
 #define H4_MCACHE_PRIV_H
 
 #include "hdf_priv.h"
-#include "hqueue_priv.h" /* Circular queue functions(Macros) */
+#include "hqueue_priv.h"  /* Circular queue functions(Macros) */
+#include "hthread_priv.h" /* Locks of the thread-safe library */
 
 /* Set return/succeed values */
 #ifdef SUCCEED
@@ -63,16 +64,27 @@
 
 /*
  * The memory pool scheme is a simple one.  Each in-memory page is referenced
- * by a bucket which is threaded in up to two (three?) ways.  All active pages
- * are threaded on a hash chain (hashed by page number) and an lru chain.
- * (Inactive pages are threaded on a free chain?).  Each reference to a memory
- * pool is handed an opaque MPOOL cookie which stores all of this information.
+ * by a bucket which is threaded in two ways.  All active pages are threaded
+ * on a hash chain (hashed by page number) and on one of the replacement
+ * queues.  Each page ever referenced also has an element, threaded on a
+ * second hash chain.  Both hash tables double in size as they fill up, so
+ * lookups stay short however many chunks an object has.  Each reference to a
+ * memory pool is handed an opaque MCACHE cookie which stores all of this
+ * information.
+ *
+ * All of the caches also belong to one pool, which can be given a budget of
+ * bytes they share (see mcache_set_budget()).
  */
 
-/* Current Hash table size. Page numbers start with 1
+/* Initial hash table size, a power of 2.  Page numbers start with 1
  * (i.e 0 will denote invalid page number) */
-#define HASHSIZE      128
-#define HASHKEY(pgno) ((pgno - 1) % HASHSIZE)
+#define HASHSIZE                128
+#define HASHKEY(pgno, hashsize) ((uint32)((pgno) - 1) & ((hashsize) - 1))
+
+/* Replacement policies, see mcache_set_policy() */
+#define MCACHE_LRU 0 /* least recently used page */
+#define MCACHE_ARC 1 /* adaptive replacement cache */
+#define MCACHE_W0  2 /* pages fully read or written first, then LRU */
 
 /* Default pagesize and max # of pages to cache */
 #define DEF_PAGESIZE 8192
@@ -82,19 +94,25 @@
 
 /* The BKT structures are the elements of the queues. */
 typedef struct _bkt {
-    H4_CIRCLEQ_ENTRY(_bkt) hq; /* hash queue */
-    H4_CIRCLEQ_ENTRY(_bkt) q;  /* lru queue */
+    struct _bkt *hnext;        /* next page in hash chain */
+    H4_CIRCLEQ_ENTRY(_bkt) q;  /* replacement queue */
     void *page;                /* page */
     int32 pgno;                /* page number */
+    int32 nused;               /* bytes read/written since the page was cached */
 #define MCACHE_DIRTY  0x01     /* page needs to be written */
 #define MCACHE_PINNED 0x02     /* page is pinned into memory */
+#define MCACHE_DONE   0x04     /* every byte of the page has been used */
     uint8 flags;               /* flags */
+#define MCACHE_T1 0            /* on the recency queue */
+#define MCACHE_T2 1            /* on the frequency queue (MCACHE_ARC only) */
+    uint8 queue;               /* queue the page is on */
 } BKT;
 
 /* The element structure for every page referenced(read/written) in object */
 typedef struct _lelem {
-    H4_CIRCLEQ_ENTRY(_lelem) hl; /* hash list */
-    int32 pgno;                  /* page number */
+    struct _lelem *hnext;         /* next element in hash chain */
+    H4_CIRCLEQ_ENTRY(_lelem) gq;  /* ghost queue (MCACHE_ARC only) */
+    int32 pgno;                   /* page number */
 #ifdef STATISTICS
     int32 elemhit; /* # of hits on page */
 #endif
@@ -102,6 +120,9 @@ typedef struct _lelem {
 #define ELEM_WRITTEN 0x02
 #define ELEM_SYNC    0x03
     uint8 eflags; /* 1= read, 2=written, 3=synced */
+#define MCACHE_B1 1 /* recently evicted from the recency queue */
+#define MCACHE_B2 2 /* recently evicted from the frequency queue */
+    uint8 ghost;  /* ghost queue the element is on, or 0 */
 } L_ELEM;
 
 #define MCACHE_EXTEND                                                                                        \
@@ -110,19 +131,39 @@ typedef struct _lelem {
 
 /* Memory pool cache */
 typedef struct MCACHE {
-    H4_CIRCLEQ_HEAD(_lqh, _bkt) lqh;                            /* lru queue head */
-    H4_CIRCLEQ_HEAD(_hqh, _bkt) hqh[HASHSIZE];                  /* hash queue array */
-    H4_CIRCLEQ_HEAD(_lhqh, _lelem) lhqh[HASHSIZE];              /* hash of all elements */
-    int32 curcache;                                             /* current num of cached pages */
-    int32 maxcache;                                             /* max number of cached pages */
-    int32 npages;                                               /* number of pages in the object */
-    int32 pagesize;                                             /* cache page size */
-    int32 object_id;                                            /* access ID of object this cache is for */
-    int32 object_size;                                          /* size of object to cache
-                                                                   must be multiple of pagesize for now */
-    int32 (*pgin)(void *cookie, int32 pgno, void *page);        /* page in conversion routine */
-    int32 (*pgout)(void *cookie, int32 pgno, const void *page); /* page out conversion routine*/
-    void *pgcookie;                                             /* cookie for page in/out routines */
+    H4_CIRCLEQ_HEAD(_lqh, _bkt) lqh;                               /* lru (recency) queue head */
+    H4_CIRCLEQ_HEAD(_fqh, _bkt) fqh;                               /* frequency queue head */
+    H4_CIRCLEQ_HEAD(_b1h, _lelem) b1h;                             /* ghosts evicted from lqh */
+    H4_CIRCLEQ_HEAD(_b2h, _lelem) b2h;                             /* ghosts evicted from fqh */
+    H4_CIRCLEQ_ENTRY(MCACHE) pq;                                   /* caches in the shared pool */
+    BKT    **htab;                                                 /* hash table of cached pages */
+    L_ELEM **ltab;                                                 /* hash table of all elements */
+    uint32   hsize;                                                /* # of buckets in htab */
+    uint32   lsize;                                                /* # of buckets in ltab */
+    int32    nelems;                                               /* # of elements in ltab */
+    int32    nt2;                                                  /* # of pages on fqh */
+    int32    nb1;                                                  /* # of elements on b1h */
+    int32    nb2;                                                  /* # of elements on b2h */
+    int32    arc_p;                                                /* ARC target size of lqh */
+    int      policy;                                               /* replacement policy */
+    int32    curcache;                                             /* current num of cached pages */
+    int32    maxcache;                                             /* max number of cached pages */
+    int32    maxbytes;                                             /* max bytes of cached pages, or 0 */
+    int32    npages;                                               /* number of pages in the object */
+    int32    pagesize;                                             /* cache page size */
+    int32    object_id;                                            /* access ID of object this cache is for */
+    int32    object_size;                                          /* size of object to cache
+                                                                      must be multiple of pagesize for now */
+    int32    (*pgin)(void *cookie, int32 pgno, void *page);        /* page in conversion routine */
+    int32    (*pgout)(void *cookie, int32 pgno, const void *page); /* page out conversion routine*/
+    void    *pgcookie;                                             /* cookie for page in/out routines */
+    uint32   hits;                                                 /* # of pages found in the cache */
+    uint32   misses;                                               /* # of pages read in or created */
+    uint32   evictions;                                            /* # of pages dropped for this cache */
+    uint32   reclaims;                                             /* # of pages taken by other caches */
+#ifdef H4_HAVE_THREADSAFE
+    HTSmutex_t lock; /* taken around every operation on the cache */
+#endif
 #ifdef STATISTICS
     int32 listhit;   /* # of list hits */
     int32 listalloc; /* # of list elems allocated */
@@ -180,6 +221,31 @@ HDFLIBAPI int32 mcache_set_maxcache(MCACHE *mp, /* IN: MCACHE cookie */
 
 HDFLIBAPI int32 mcache_get_npages(MCACHE *mp /* IN: MCACHE cookie */);
 
+HDFLIBAPI int32 mcache_get_maxbytes(MCACHE *mp /* IN: MCACHE cookie */);
+
+HDFLIBAPI int32 mcache_set_maxbytes(MCACHE *mp, /* IN: MCACHE cookie */
+                                    int32   maxbytes /* IN: max bytes to cache, 0 for none */);
+
+HDFLIBAPI int mcache_get_policy(MCACHE *mp /* IN: MCACHE cookie */);
+
+HDFLIBAPI int mcache_set_policy(MCACHE *mp, /* IN: MCACHE cookie */
+                                int     policy /* IN: MCACHE_LRU, MCACHE_ARC or MCACHE_W0 */);
+
+HDFLIBAPI int mcache_used(MCACHE *mp,   /* IN: MCACHE cookie */
+                          void   *page, /* IN: page gotten with mcache_get */
+                          int32   nbytes /* IN: # of bytes of the page used */);
+
+HDFLIBAPI int mcache_cached(MCACHE *mp,  /* IN: MCACHE cookie */
+                            int32   pgno /* IN: page number */);
+
+HDFLIBAPI int mcache_get_stats(MCACHE          *mp, /* IN: MCACHE cookie */
+                               HDF_CACHE_STATS *stats /* OUT: statistics of the cache */);
+
+HDFLIBAPI int mcache_set_budget(hdf_off_t budget /* IN: bytes all caches may hold, 0 for no bound */);
+
+HDFLIBAPI int mcache_get_budget(hdf_off_t *budget, /* OUT: bytes all caches may hold */
+                                hdf_off_t *nbytes /* OUT: bytes all caches hold now */);
+
 #ifdef STATISTICS
 HDFLIBAPI void mcache_stat(MCACHE *mp /* IN: MCACHE cookie */);
 #endif /* STATISTICS */
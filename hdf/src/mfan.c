@@ -254,6 +254,7 @@ ANIinit(void)
     HEclear();
 
     /* Perform global, one-time initialization */
+    HTS_REGISTRY_LOCK();
     if (library_terminate == FALSE) {
         if (ANIstart() == FAIL)
             HGOTO_ERROR(DFE_CANTINIT, FAIL);
@@ -263,6 +264,7 @@ ANIinit(void)
     }
 
 done:
+    HTS_REGISTRY_UNLOCK();
     return ret_value;
 } /* ANIinit() */
 
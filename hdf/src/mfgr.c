@@ -147,6 +147,8 @@ Chunking Functions:
      GRwritechunk   -- write the specified chunk to the GR
      GRreadchunk    -- read the specified chunk to the GR
      GRsetchunkcache -- maximum number of chunks to cache
+     GRsetchunkcacheparams -- byte bound and replacement policy of the chunk cache
+     GRgetchunkcachestats -- statistics of the chunk cache
 
 LOCAL ROUTINES
 int GRIil_convert(const void * inbuf,gr_interlace_t inil,void * outbuf,
@@ -155,16 +157,26 @@ int GRIil_convert(const void * inbuf,gr_interlace_t inil,void * outbuf,
  */
 
 #include "hdf_priv.h"
+#include "hthread_priv.h"
 #include "mfgr_priv.h"
 
 #ifdef H4_HAVE_LIBSZ /* we have the library */
 #include "szlib.h"
 #endif
 
+#if defined(__SSE2__) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GR_HAVE_SSSE3
+#endif
+
 /* Local pre-processor macros */
 #define XDIM 0
 #define YDIM 1
 
+/* # of pixels moved at a time when interleaving or separating components
+   which don't have a kernel of their own */
+#define GR_IL_BLOCK 64
+
 /*
  * --------------------------------------------------------------------
  * PRIVATE  data structure and routines.
@@ -244,6 +256,7 @@ GRIgrdestroynode(void *n)
     /* clear out the tbbt's */
     tbbtdfree(gr_ptr->grtree, GRIridestroynode, NULL);
     tbbtdfree(gr_ptr->gattree, GRIattrdestroynode, NULL);
+    HNIdestroy(gr_ptr->grnames);
 
     free(gr_ptr);
 } /* GRIgrdestroynode */
@@ -325,7 +338,9 @@ Get_grfile(HFILEID f)
     void **t; /* vfile_t pointer from tree */
     int32  key = (int32)f;
 
+    HTS_REGISTRY_LOCK();
     t = (void **)tbbtdfind(gr_tree, &key, NULL);
+    HTS_REGISTRY_UNLOCK();
     return (gr_info_t *)(t == NULL ? NULL : *t);
 } /* end Get_grfile() */
 
@@ -423,7 +438,9 @@ New_grfile(HFILEID f)
 
     /* Assign the file ID & insert into the tree */
     g->hdf_file_id = f;
+    HTS_REGISTRY_LOCK();
     tbbtdins(gr_tree, g, NULL); /* insert the vg instance in B-tree */
+    HTS_REGISTRY_UNLOCK();
 
     return g;
 } /* end New_grfile() */
@@ -1274,6 +1291,196 @@ done:
     return ret_value;
 } /* end GRIget_image_list() */
 
+#ifdef GR_HAVE_SSSE3
+/* Interleaves as many groups of 16 bytes of each of 2 to 4 planes as there
+   are into pixels, with byte shuffles, and returns the # of pixels moved */
+__attribute__((target("ssse3"))) static size_t
+GRIil_pack_ssse3(uint8 *pix, const uint8 *planes, size_t plane_stride, size_t npix, int ncomp, unsigned size)
+{
+    __m128i  mask[4][4];      /* [output vector][plane] shuffles */
+    __m128i  plane[4], v;     /* 16 bytes of each plane, output vector */
+    unsigned per = 16 / size; /* pixels in 16 bytes of a plane */
+    uint8    m[16];           /* a shuffle being set up */
+    size_t   done;
+    int      i, k;
+
+    /* byte b of the pixels is byte b % size of component (b / size) % ncomp
+       of pixel b / (ncomp * size) */
+    for (i = 0; i < ncomp; i++)
+        for (k = 0; k < ncomp; k++) {
+            for (unsigned j = 0; j < 16; j++) {
+                unsigned b = (unsigned)i * 16 + j;
+
+                m[j] = (uint8)(((b / size) % (unsigned)ncomp == (unsigned)k)
+                                   ? (b / ((unsigned)ncomp * size)) * size + b % size
+                                   : 0x80);
+            }
+            mask[i][k] = _mm_loadu_si128((const __m128i *)(const void *)m);
+        }
+
+    for (done = 0; done + per <= npix; done += per) {
+        for (k = 0; k < ncomp; k++) {
+            const uint8 *p = planes + (size_t)k * plane_stride + done * size;
+
+            plane[k] = _mm_loadu_si128((const __m128i *)(const void *)p);
+        }
+        for (i = 0; i < ncomp; i++) {
+            v = _mm_shuffle_epi8(plane[0], mask[i][0]);
+            for (k = 1; k < ncomp; k++)
+                v = _mm_or_si128(v, _mm_shuffle_epi8(plane[k], mask[i][k]));
+            _mm_storeu_si128((__m128i *)(void *)(pix + (done * (size_t)ncomp + (size_t)i * per) * size), v);
+        }
+    }
+    return done;
+} /* GRIil_pack_ssse3 */
+
+/* The reverse of GRIil_pack_ssse3 */
+__attribute__((target("ssse3"))) static size_t
+GRIil_unpack_ssse3(const uint8 *pix, uint8 *planes, size_t plane_stride, size_t npix, int ncomp,
+                   unsigned size)
+{
+    __m128i  mask[4][4];      /* [plane][input vector] shuffles */
+    __m128i  in[4], v;        /* input vectors, output plane vector */
+    unsigned per = 16 / size; /* pixels in 16 bytes of a plane */
+    uint8    m[16];           /* a shuffle being set up */
+    size_t   done;
+    int      i, k;
+
+    /* byte j of a plane's vector is byte j % size of pixel j / size */
+    for (k = 0; k < ncomp; k++)
+        for (i = 0; i < ncomp; i++) {
+            for (unsigned j = 0; j < 16; j++) {
+                unsigned b = (j / size) * (unsigned)ncomp * size + (unsigned)k * size + j % size;
+
+                m[j] = (uint8)(b / 16 == (unsigned)i ? b % 16 : 0x80);
+            }
+            mask[k][i] = _mm_loadu_si128((const __m128i *)(const void *)m);
+        }
+
+    for (done = 0; done + per <= npix; done += per) {
+        for (i = 0; i < ncomp; i++)
+            in[i] = _mm_loadu_si128(
+                (const __m128i *)(const void *)(pix + (done * (size_t)ncomp + (size_t)i * per) * size));
+        for (k = 0; k < ncomp; k++) {
+            v = _mm_shuffle_epi8(in[0], mask[k][0]);
+            for (i = 1; i < ncomp; i++)
+                v = _mm_or_si128(v, _mm_shuffle_epi8(in[i], mask[k][i]));
+            _mm_storeu_si128((__m128i *)(void *)(planes + (size_t)k * plane_stride + done * size), v);
+        }
+    }
+    return done;
+} /* GRIil_unpack_ssse3 */
+#endif /* GR_HAVE_SSSE3 */
+
+/* Moves pixels [done, npix) between planes and pixels, NC components of S
+   bytes at a time; with constant arguments the compiler can unroll and
+   vectorize the loop */
+#define GR_IL_PACK_LOOP(NC, S)                                                                               \
+    for (x = done; x < npix; x++)                                                                            \
+        for (k = 0; k < (NC); k++)                                                                           \
+            memcpy(pix + (x * (NC) + k) * (S), planes + k * plane_stride + x * (S), (S))
+#define GR_IL_UNPACK_LOOP(NC, S)                                                                             \
+    for (x = done; x < npix; x++)                                                                            \
+        for (k = 0; k < (NC); k++)                                                                           \
+            memcpy(planes + k * plane_stride + x * (S), pix + (x * (NC) + k) * (S), (S))
+
+/* Picks the loop for the size of the components */
+#define GR_IL_SIZES(LOOP, NC)                                                                                \
+    switch (size) {                                                                                          \
+        case 1:                                                                                              \
+            LOOP(NC, 1);                                                                                     \
+            break;                                                                                           \
+        case 2:                                                                                              \
+            LOOP(NC, 2);                                                                                     \
+            break;                                                                                           \
+        case 4:                                                                                              \
+            LOOP(NC, 4);                                                                                     \
+            break;                                                                                           \
+        case 8:                                                                                              \
+            LOOP(NC, 8);                                                                                     \
+            break;                                                                                           \
+        default:                                                                                             \
+            LOOP(NC, size);                                                                                  \
+            break;                                                                                           \
+    }
+
+/* Interleaves npix components from each of ncomp planes, plane_stride bytes
+   apart, into pixels */
+static void
+GRIil_pack(uint8 *pix, const uint8 *planes, size_t plane_stride, size_t npix, size_t ncomp, size_t size)
+{
+    size_t done = 0, x, k;
+
+#ifdef GR_HAVE_SSSE3
+    if (ncomp >= 2 && ncomp <= 4 && (size == 1 || size == 2 || size == 4 || size == 8) && npix >= 16 / size &&
+        __builtin_cpu_supports("ssse3"))
+        done = GRIil_pack_ssse3(pix, planes, plane_stride, npix, (int)ncomp, (unsigned)size);
+#endif
+
+    switch (ncomp) {
+        case 2:
+            GR_IL_SIZES(GR_IL_PACK_LOOP, 2);
+            break;
+        case 3:
+            GR_IL_SIZES(GR_IL_PACK_LOOP, 3);
+            break;
+        case 4:
+            GR_IL_SIZES(GR_IL_PACK_LOOP, 4);
+            break;
+        case 8:
+            GR_IL_SIZES(GR_IL_PACK_LOOP, 8);
+            break;
+        default:
+            /* a block of pixels at a time, so that the pixels written
+               stay in the cache while each plane is read in turn */
+            for (; done < npix; done += GR_IL_BLOCK) {
+                size_t end = MIN(npix, done + GR_IL_BLOCK);
+
+                for (k = 0; k < ncomp; k++)
+                    for (x = done; x < end; x++)
+                        memcpy(pix + (x * ncomp + k) * size, planes + k * plane_stride + x * size, size);
+            }
+            break;
+    }
+} /* GRIil_pack */
+
+/* The reverse of GRIil_pack */
+static void
+GRIil_unpack(const uint8 *pix, uint8 *planes, size_t plane_stride, size_t npix, size_t ncomp, size_t size)
+{
+    size_t done = 0, x, k;
+
+#ifdef GR_HAVE_SSSE3
+    if (ncomp >= 2 && ncomp <= 4 && (size == 1 || size == 2 || size == 4 || size == 8) && npix >= 16 / size &&
+        __builtin_cpu_supports("ssse3"))
+        done = GRIil_unpack_ssse3(pix, planes, plane_stride, npix, (int)ncomp, (unsigned)size);
+#endif
+
+    switch (ncomp) {
+        case 2:
+            GR_IL_SIZES(GR_IL_UNPACK_LOOP, 2);
+            break;
+        case 3:
+            GR_IL_SIZES(GR_IL_UNPACK_LOOP, 3);
+            break;
+        case 4:
+            GR_IL_SIZES(GR_IL_UNPACK_LOOP, 4);
+            break;
+        case 8:
+            GR_IL_SIZES(GR_IL_UNPACK_LOOP, 8);
+            break;
+        default:
+            for (; done < npix; done += GR_IL_BLOCK) {
+                size_t end = MIN(npix, done + GR_IL_BLOCK);
+
+                for (k = 0; k < ncomp; k++)
+                    for (x = done; x < end; x++)
+                        memcpy(planes + k * plane_stride + x * size, pix + (x * ncomp + k) * size, size);
+            }
+            break;
+    }
+} /* GRIil_unpack */
+
 /*--------------------------------------------------------------------------
  NAME
     GRIil_convert
@@ -1294,6 +1501,13 @@ done:
     This routine converts between PIXEL, LINE & COMPONENT interlacing schemes.
     All data written to the disk is written in PIXEL interlacing and converted
     to/from the user's buffers.
+
+    Converting to or from PIXEL interlace transposes pixels and planes of
+    components, a line at a time for LINE interlace or the whole image at
+    once for COMPONENT interlace.  There are loops for 2, 3, 4 and 8
+    components of 1, 2, 4 or 8 bytes, byte shuffles for 2 to 4 components
+    on processors with SSSE3, and a loop over blocks of pixels for other
+    numbers of components.
  GLOBAL VARIABLES
  COMMENTS, BUGS, ASSUMPTIONS
     This routine does no parameter checking, it's assumed to be done at a
@@ -1309,132 +1523,205 @@ int
 GRIil_convert(const void *inbuf, gr_interlace_t inil, void *outbuf, gr_interlace_t outil, int32 dims[2],
               int32 ncomp, int32 nt)
 {
-    int          ret_value     = SUCCEED;
-    unsigned     pixel_size    = (unsigned)DFKNTsize((nt | DFNT_NATIVE) & (~DFNT_LITEND)) * (unsigned)ncomp;
-    unsigned     comp_size     = (unsigned)DFKNTsize((nt | DFNT_NATIVE) & (~DFNT_LITEND));
-    const void **in_comp_ptr   = NULL; /* an array of pointers to each input component */
-    void       **out_comp_ptr  = NULL; /* an array of pointers to each output component */
-    int32       *in_pixel_add  = NULL; /* an array of increments for each input pixel moved */
-    int32       *out_pixel_add = NULL; /* an array of increments for each output pixel moved */
-    int32       *in_line_add   = NULL; /* an array of increments for each input line moved */
-    int32       *out_line_add  = NULL; /* an array of increments for each output line moved */
-    int          i, j, k;              /* local counting variables */
-
-    if (inil == outil) /* check for trivial input=output 'conversion' */
-        memcpy(outbuf, inbuf, (size_t)dims[XDIM] * (size_t)dims[YDIM] * (size_t)pixel_size);
-    else {
-        /* allocate pixel pointer arrays */
-        if ((in_comp_ptr = malloc(sizeof(void *) * (size_t)ncomp)) == NULL)
-            HGOTO_ERROR(DFE_NOSPACE, FAIL);
-        if ((out_comp_ptr = malloc(sizeof(void *) * (size_t)ncomp)) == NULL)
-            HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    const uint8 *in        = (const uint8 *)inbuf;
+    uint8       *out       = (uint8 *)outbuf;
+    size_t       comp_size = (size_t)DFKNTsize((nt | DFNT_NATIVE) & (~DFNT_LITEND));
+    size_t       nc        = (size_t)ncomp;
+    size_t       xdim      = (size_t)dims[XDIM];
+    size_t       ydim      = (size_t)dims[YDIM];
+    size_t       line_size = xdim * comp_size; /* bytes in a line of one component */
+    size_t       y, k;                         /* local counting variables */
+    int          ret_value = SUCCEED;
 
-        /* allocate pixel increment arrays */
-        if ((in_pixel_add = malloc(sizeof(int32) * (size_t)ncomp)) == NULL)
-            HGOTO_ERROR(DFE_NOSPACE, FAIL);
-        if ((out_pixel_add = malloc(sizeof(int32) * (size_t)ncomp)) == NULL)
-            HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    if (inil != MFGR_INTERLACE_PIXEL && inil != MFGR_INTERLACE_LINE && inil != MFGR_INTERLACE_COMPONENT)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    if (outil != MFGR_INTERLACE_PIXEL && outil != MFGR_INTERLACE_LINE && outil != MFGR_INTERLACE_COMPONENT)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
 
-        /* allocate line increment arrays */
-        if ((in_line_add = malloc(sizeof(int32) * (size_t)ncomp)) == NULL)
-            HGOTO_ERROR(DFE_NOSPACE, FAIL);
-        if ((out_line_add = malloc(sizeof(int32) * (size_t)ncomp)) == NULL)
+    /* check for trivial input=output 'conversion'; all the interlaces of
+       a single component are the same */
+    if (inil == outil || ncomp == 1)
+        memcpy(outbuf, inbuf, xdim * ydim * nc * comp_size);
+    else if (inil == MFGR_INTERLACE_PIXEL) {
+        if (outil == MFGR_INTERLACE_COMPONENT) /* the whole image is one run of pixels */
+            GRIil_unpack(in, out, xdim * ydim * comp_size, xdim * ydim, nc, comp_size);
+        else
+            for (y = 0; y < ydim; y++)
+                GRIil_unpack(in + y * nc * line_size, out + y * nc * line_size, line_size, xdim, nc,
+                             comp_size);
+    }
+    else if (outil == MFGR_INTERLACE_PIXEL) {
+        if (inil == MFGR_INTERLACE_COMPONENT)
+            GRIil_pack(out, in, xdim * ydim * comp_size, xdim * ydim, nc, comp_size);
+        else
+            for (y = 0; y < ydim; y++)
+                GRIil_pack(out + y * nc * line_size, in + y * nc * line_size, line_size, xdim, nc, comp_size);
+    }
+    else /* line <-> component, whole lines of components move */
+        for (y = 0; y < ydim; y++)
+            for (k = 0; k < nc; k++) {
+                size_t line_off = (y * nc + k) * line_size;   /* the line in line interlace */
+                size_t comp_off = (k * ydim + y) * line_size; /* the line in component interlace */
+
+                if (inil == MFGR_INTERLACE_LINE)
+                    memcpy(out + comp_off, in + line_off, line_size);
+                else
+                    memcpy(out + line_off, in + comp_off, line_size);
+            }
+
+done:
+    return ret_value;
+} /* end GRIil_convert() */
+
+/* State for moving the rows of an image between the user's buffer and the
+   file's format, a band of rows of at most GR_STAGE_MAX bytes at a time */
+typedef struct {
+    uint8         *data;      /* the user's buffer */
+    gr_interlace_t il;        /* interlace of the user's buffer */
+    int32          count[2];  /* dimensions of the user's buffer */
+    int32          ncomp;     /* # of components in a pixel */
+    int32          nt;        /* number type of the image */
+    int            convert;   /* whether the number type is converted */
+    int            reading;   /* whether the rows go to the user's buffer */
+    size_t         comp_size; /* size of a component in memory */
+    size_t         mem_row;   /* bytes in a row in memory */
+    size_t         disk_row;  /* bytes in a row on disk */
+    int32          band_rows; /* # of rows the buffers hold */
+    int32          first;     /* first row in the buffers, or -1 */
+    int32          nrows;     /* # of rows in the buffers */
+    uint8         *pixel_buf; /* rows in memory format and pixel interlace */
+    uint8         *disk_buf;  /* rows in disk format, or NULL if the user's buffer is */
+} gr_stage_t;
+
+/* Sets up to move rows between data and the file; the buffers are freed by
+   the caller, even on failure */
+static int
+GRIstage_start(gr_stage_t *st, ri_info_t *ri_ptr, gr_interlace_t il, void *data, int32 count[2], int convert,
+               int reading)
+{
+    int ret_value = SUCCEED;
+
+    st->data      = (uint8 *)data;
+    st->il        = il;
+    st->count[0]  = count[0];
+    st->count[1]  = count[1];
+    st->ncomp     = ri_ptr->img_dim.ncomps;
+    st->nt        = ri_ptr->img_dim.nt;
+    st->convert   = convert;
+    st->reading   = reading;
+    st->comp_size = (size_t)DFKNTsize((st->nt | DFNT_NATIVE) & (~DFNT_LITEND));
+    st->mem_row   = (size_t)count[XDIM] * (size_t)st->ncomp * st->comp_size;
+    st->disk_row  = st->mem_row;
+    if (convert)
+        st->disk_row = (size_t)count[XDIM] * (size_t)st->ncomp * (size_t)DFKNTsize(st->nt);
+    st->first     = -1;
+    st->nrows     = 0;
+    st->pixel_buf = NULL;
+    st->disk_buf  = NULL;
+
+    /* rows go straight to or from the user's buffer when they can */
+    if (!convert && il == MFGR_INTERLACE_PIXEL)
+        HGOTO_DONE(SUCCEED);
+
+    st->band_rows = (int32)MIN((size_t)count[YDIM], MAX(1, GR_STAGE_MAX / MAX(st->mem_row, st->disk_row)));
+    if ((st->disk_buf = malloc((size_t)st->band_rows * st->disk_row)) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    if (convert && il != MFGR_INTERLACE_PIXEL)
+        if ((st->pixel_buf = malloc((size_t)st->band_rows * st->mem_row)) == NULL)
             HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
-        /* Set up the input buffer pointers and adders */
-        switch (inil) {
-            case MFGR_INTERLACE_PIXEL:
-                for (i = 0; i < ncomp; i++) {
-                    in_comp_ptr[i]  = ((const uint8 *)inbuf) + (size_t)i * comp_size;
-                    in_pixel_add[i] = (int32)pixel_size;
-                    in_line_add[i]  = 0;
-                } /* end for */
-                break;
+done:
+    return ret_value;
+} /* GRIstage_start */
 
-            case MFGR_INTERLACE_LINE:
-                for (i = 0; i < ncomp; i++) {
-                    in_comp_ptr[i]  = ((const uint8 *)inbuf) + (size_t)i * (size_t)dims[XDIM] * comp_size;
-                    in_pixel_add[i] = (int32)comp_size;
-                    in_line_add[i]  = (int32)((size_t)(ncomp - 1) * (size_t)dims[XDIM] * comp_size);
-                } /* end for */
-                break;
+/* Moves the rows in the buffers between pixels, in pixel interlace, and the
+   user's buffer, in its own interlace */
+static void
+GRIstage_interlace(gr_stage_t *st, uint8 *pixels)
+{
+    size_t nc   = (size_t)st->ncomp;
+    size_t xdim = (size_t)st->count[XDIM];
+    size_t line = xdim * st->comp_size; /* bytes in a line of one component */
 
-            case MFGR_INTERLACE_COMPONENT:
-                for (i = 0; i < ncomp; i++) {
-                    in_comp_ptr[i] = ((const uint8 *)inbuf) +
-                                     (size_t)i * (size_t)dims[YDIM] * (size_t)dims[XDIM] * comp_size;
-                    in_pixel_add[i] = (int32)comp_size;
-                    in_line_add[i]  = 0;
-                } /* end for */
-                break;
+    if (st->il == MFGR_INTERLACE_LINE)
+        for (size_t y = 0; y < (size_t)st->nrows; y++) {
+            uint8 *pix    = pixels + y * st->mem_row;
+            uint8 *planes = st->data + ((size_t)st->first + y) * st->mem_row;
 
-            default:
-                HGOTO_ERROR(DFE_ARGS, FAIL);
-        } /* end switch */
-
-        /* Set up the output buffer pointers and adders */
-        switch (outil) {
-            case MFGR_INTERLACE_PIXEL:
-                for (i = 0; i < ncomp; i++) {
-                    out_comp_ptr[i]  = ((uint8 *)outbuf) + (size_t)i * comp_size;
-                    out_pixel_add[i] = (int32)pixel_size;
-                    out_line_add[i]  = 0;
-                } /* end for */
-                break;
+            if (st->reading)
+                GRIil_unpack(pix, planes, line, xdim, nc, st->comp_size);
+            else
+                GRIil_pack(pix, planes, line, xdim, nc, st->comp_size);
+        }
+    else { /* the rows are one run of pixels in each component's plane */
+        uint8 *planes = st->data + (size_t)st->first * line;
+        size_t stride = (size_t)st->count[YDIM] * line;
 
-            case MFGR_INTERLACE_LINE:
-                for (i = 0; i < ncomp; i++) {
-                    out_comp_ptr[i]  = ((uint8 *)outbuf) + (size_t)i * (size_t)dims[XDIM] * comp_size;
-                    out_pixel_add[i] = (int32)comp_size;
-                    out_line_add[i]  = (int32)((size_t)(ncomp - 1) * (size_t)dims[XDIM] * comp_size);
-                } /* end for */
-                break;
+        if (st->reading)
+            GRIil_unpack(pixels, planes, stride, (size_t)st->nrows * xdim, nc, st->comp_size);
+        else
+            GRIil_pack(pixels, planes, stride, (size_t)st->nrows * xdim, nc, st->comp_size);
+    }
+} /* GRIstage_interlace */
 
-            case MFGR_INTERLACE_COMPONENT:
-                for (i = 0; i < ncomp; i++) {
-                    out_comp_ptr[i] =
-                        ((uint8 *)outbuf) + (size_t)i * (size_t)dims[YDIM] * (size_t)dims[XDIM] * comp_size;
-                    out_pixel_add[i] = (int32)comp_size;
-                    out_line_add[i]  = 0;
-                } /* end for */
-                break;
+/* Moves the rows in the buffers to the user's buffer */
+static int
+GRIstage_flush(gr_stage_t *st)
+{
+    uint8 *pixels    = st->disk_buf; /* the rows in memory format and pixel interlace */
+    int32  nvals     = st->ncomp * st->count[XDIM] * st->nrows;
+    int    ret_value = SUCCEED;
 
-            default:
-                HGOTO_ERROR(DFE_ARGS, FAIL);
-        } /* end switch */
-
-        /* now just push pixels from one buffer to another */
-        for (i = 0; i < dims[YDIM]; i++) {
-            for (j = 0; j < dims[XDIM]; j++) {
-                for (k = 0; k < ncomp; k++) {
-                    memcpy(out_comp_ptr[k], in_comp_ptr[k], comp_size);
-                    out_comp_ptr[k] = ((uint8 *)out_comp_ptr[k]) + out_pixel_add[k];
-                    in_comp_ptr[k]  = ((const uint8 *)in_comp_ptr[k]) + in_pixel_add[k];
-                } /* end for */
-            }     /* end for */
+    if (st->disk_buf == NULL || st->first < 0)
+        HGOTO_DONE(SUCCEED);
 
-            /* wrap around the end of the line of pixels */
-            /* (only necessary if one of the buffers is in 'line' interlace) */
-            if (inil == MFGR_INTERLACE_LINE || outil == MFGR_INTERLACE_LINE)
-                for (k = 0; k < ncomp; k++) {
-                    out_comp_ptr[k] = ((uint8 *)out_comp_ptr[k]) + out_line_add[k];
-                    in_comp_ptr[k]  = ((const uint8 *)in_comp_ptr[k]) + in_line_add[k];
-                } /* end for */
-        }         /* end for */
-    }             /* end else */
+    if (st->convert) {
+        pixels = st->il == MFGR_INTERLACE_PIXEL ? st->data + (size_t)st->first * st->mem_row : st->pixel_buf;
+        if (DFKconvert(st->disk_buf, pixels, st->nt, nvals, DFACC_READ, 0, 0) == FAIL)
+            HGOTO_ERROR(DFE_BADCONV, FAIL);
+    }
+    if (st->il != MFGR_INTERLACE_PIXEL)
+        GRIstage_interlace(st, pixels);
 
 done:
-    /* Free arrays allocated during this routine */
-    /* (common for both error and normal returns) */
-    free(in_comp_ptr);
-    free(out_comp_ptr);
-    free(in_pixel_add);
-    free(out_pixel_add);
-    free(in_line_add);
-    free(out_line_add);
+    return ret_value;
+} /* GRIstage_flush */
+
+/* Returns where row is (when writing) or goes (when reading) in the file's
+   format, moving a band of rows from or to the user's buffer as needed;
+   NULL on failure */
+static uint8 *
+GRIstage_row(gr_stage_t *st, int32 row)
+{
+    uint8 *pixels;
+    uint8 *ret_value = NULL;
+
+    if (st->disk_buf == NULL)
+        HGOTO_DONE(st->data + (size_t)row * st->disk_row);
+
+    if (row < st->first || row >= st->first + st->nrows) {
+        if (st->reading && GRIstage_flush(st) == FAIL)
+            HGOTO_ERROR(DFE_BADCONV, NULL);
 
+        st->first = row;
+        st->nrows = MIN(st->band_rows, st->count[YDIM] - row);
+
+        if (!st->reading) {
+            pixels = st->convert ? st->pixel_buf : st->disk_buf;
+            if (st->il != MFGR_INTERLACE_PIXEL)
+                GRIstage_interlace(st, pixels);
+            else
+                pixels = st->data + (size_t)row * st->mem_row;
+            if (st->convert && DFKconvert(pixels, st->disk_buf, st->nt,
+                                          st->ncomp * st->count[XDIM] * st->nrows, DFACC_WRITE, 0, 0) == FAIL)
+                HGOTO_ERROR(DFE_BADCONV, NULL);
+        }
+    }
+    ret_value = st->disk_buf + (size_t)(row - st->first) * st->disk_row;
+
+done:
     return ret_value;
-} /* end GRIil_convert() */
+} /* GRIstage_row */
 
 /*--------------------------------------------------------------------------
  NAME
@@ -1465,6 +1752,9 @@ GRstart(int32 hdf_file_id)
     /* clear error stack and check validity of file id */
     HEclear();
 
+    /* starting the interface on a file is serialized by the library lock */
+    HTS_LOCK();
+
     /* Perform global, one-time initialization */
     if (library_terminate == FALSE)
         if (GRIstart() == FAIL)
@@ -1502,6 +1792,7 @@ GRstart(int32 hdf_file_id)
         if (gr_ptr->grtree == NULL)
             HGOTO_ERROR(DFE_NOSPACE, FAIL);
         gr_ptr->gr_modified = 0;
+        gr_ptr->grnames     = NULL;
 
         gr_ptr->gattr_count = 0;
         gr_ptr->gattree     = tbbtdmake(rigcompare, sizeof(int32), TBBT_FAST_INT32_COMPARE);
@@ -1520,6 +1811,7 @@ GRstart(int32 hdf_file_id)
     ret_value = HAregister_atom(GRIDGROUP, gr_ptr);
 
 done:
+    HTS_UNLOCK();
     return ret_value;
 } /* end GRstart() */
 
@@ -1953,6 +2245,9 @@ GRend(int32 grid)
     /* clear error stack and check validity of file id */
     HEclear();
 
+    /* ending the interface on a file is serialized by the library lock */
+    HTS_LOCK();
+
     /* check the validity of the GR ID */
     if (HAatom_group(grid) != GRIDGROUP)
         HGOTO_ERROR(DFE_ARGS, FAIL);
@@ -2118,14 +2413,19 @@ GRend(int32 grid)
     /* Free all the memory we've allocated */
     tbbtdfree(gr_ptr->grtree, GRIridestroynode, NULL);
     tbbtdfree(gr_ptr->gattree, GRIattrdestroynode, NULL);
+    HNIdestroy(gr_ptr->grnames);
+    gr_ptr->grnames = NULL;
 
     /* Close down the entry for this file in the GR tree */
-    /* Find the node in the tree */
-    if ((t1 = (void **)tbbtdfind(gr_tree, &hdf_file_id, NULL)) == NULL)
+    /* Find the node in the tree and delete it */
+    HTS_REGISTRY_LOCK();
+    if ((t1 = (void **)tbbtdfind(gr_tree, &hdf_file_id, NULL)) != NULL)
+        tbbtrem((TBBT_NODE **)gr_tree, (TBBT_NODE *)t1, NULL);
+    HTS_REGISTRY_UNLOCK();
+    if (t1 == NULL)
         HGOTO_DONE(FAIL);
 
-    /* Delete the node and free the gr_info_t structure */
-    tbbtrem((TBBT_NODE **)gr_tree, (TBBT_NODE *)t1, NULL);
+    /* free the gr_info_t structure */
     free(gr_ptr);
 
     /* Close down the Vset routines we started */
@@ -2136,6 +2436,7 @@ GRend(int32 grid)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
 done:
+    HTS_UNLOCK();
     return ret_value;
 } /* end GRend() */
 
@@ -2307,6 +2608,12 @@ GRcreate(int32 grid, const char *name, int32 ncomp, int32 nt, int32 il, int32 di
     /* insert the new image in the global image tree */
     tbbtdins(gr_ptr->grtree, ri_ptr, NULL); /* insert the new image into B-tree */
 
+    /* keep the name index current, or build it again when it's next needed */
+    if (gr_ptr->grnames != NULL && HNIadd(gr_ptr->grnames, ri_ptr->name, ri_ptr->index) == FAIL) {
+        HNIdestroy(gr_ptr->grnames);
+        gr_ptr->grnames = NULL;
+    }
+
     /* indicate that the GR info has changed */
     gr_ptr->gr_modified = TRUE;
     gr_ptr->gr_count++;
@@ -2359,13 +2666,22 @@ GRnametoindex(int32 grid, const char *name)
 
     if ((t = (void **)tbbtfirst(gr_ptr->grtree->root)) == NULL)
         HGOTO_ERROR(DFE_RINOTFOUND, FAIL);
-    do {
-        ri_ptr = (ri_info_t *)*t;
-        if (ri_ptr != NULL && strcmp(ri_ptr->name, name) == 0) /* ie. the name matches */
-            HGOTO_DONE(ri_ptr->index);
-    } while ((t = (void **)tbbtnext((TBBT_NODE *)t)) != NULL);
 
-    ret_value = (FAIL);
+    /* index the names of the images the first time through */
+    if (gr_ptr->grnames == NULL) {
+        if ((gr_ptr->grnames = HNIcreate()) == NULL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
+        do {
+            ri_ptr = (ri_info_t *)*t;
+            if (ri_ptr != NULL && HNIadd(gr_ptr->grnames, ri_ptr->name, ri_ptr->index) == FAIL) {
+                HNIdestroy(gr_ptr->grnames);
+                gr_ptr->grnames = NULL;
+                HGOTO_ERROR(DFE_NOSPACE, FAIL);
+            }
+        } while ((t = (void **)tbbtnext((TBBT_NODE *)t)) != NULL);
+    }
+
+    ret_value = HNIfind(gr_ptr->grnames, name);
 
 done:
     return ret_value;
@@ -2536,7 +2852,7 @@ GRwriteimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], voi
     ri_info_t   *ri_ptr;              /* ptr to the image to work with */
     int          solid_block = FALSE; /* whether the image data is a solid block of data */
     int          whole_image = FALSE; /* whether we are writing out the whole image */
-    void       **img_data;            /* pointer to the converted image data to write */
+    gr_stage_t   stage;               /* the image data being converted to write */
     size_t       pixel_mem_size;      /* size of a pixel in memory */
     size_t       pixel_disk_size;     /* size of a pixel on disk */
     uint16       scheme;              /* compression scheme used for JPEG images */
@@ -2546,12 +2862,12 @@ GRwriteimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], voi
     int          status  = FAIL;
     int          convert = FALSE;          /* true if machine NT != NT to be written */
     uint8        platnumsubclass;          /* class of this NT for this platform */
-    int          new_image        = FALSE; /* whether we are writing a new image out */
-    int          switch_interlace = FALSE; /* whether the memory interlace needs to be switched around */
-    int          ret_value        = SUCCEED;
+    int          new_image = FALSE;        /* whether we are writing a new image out */
+    int          ret_value = SUCCEED;
 
     /* clear error stack and check validity of args */
     HEclear();
+    stage.pixel_buf = stage.disk_buf = NULL;
 
     /* check the basic validity of the args (stride is OK to be NULL) */
     if (HAatom_group(riid) != RIIDGROUP || start == NULL /* || in_stride==NULL */ || count == NULL ||
@@ -2618,9 +2934,6 @@ GRwriteimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], voi
     else /* block of data spread out with strides */
         solid_block = FALSE;
 
-    if (ri_ptr->img_dim.il != MFGR_INTERLACE_PIXEL)
-        switch_interlace = TRUE;
-
     /* Get the size of the pixels in memory and on disk */
     pixel_mem_size =
         (size_t)(ri_ptr->img_dim.ncomps * DFKNTsize((ri_ptr->img_dim.nt | DFNT_NATIVE) & (~DFNT_LITEND)));
@@ -2631,33 +2944,10 @@ GRwriteimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], voi
     convert         = (ri_ptr->img_dim.file_nt_subclass != platnumsubclass) ||
               (pixel_mem_size != pixel_disk_size); /* is conversion necessary? */
 
-    if (convert || switch_interlace == TRUE) { /* convert image data to HDF disk format */
-        /* Allocate space for the conversion buffer */
-        if ((img_data = malloc(pixel_disk_size * (size_t)count[XDIM] * (size_t)count[YDIM])) == NULL)
-            HGOTO_ERROR(DFE_NOSPACE, FAIL);
-
-        if (switch_interlace == TRUE) {
-            void *pixel_buf; /* buffer for the pixel interlaced data */
-
-            /* Allocate space for the conversion buffer */
-            if ((pixel_buf = malloc(pixel_mem_size * (size_t)count[XDIM] * (size_t)count[YDIM])) == NULL)
-                HGOTO_ERROR(DFE_NOSPACE, FAIL);
-
-            GRIil_convert(data, ri_ptr->img_dim.il, pixel_buf, MFGR_INTERLACE_PIXEL, count,
-                          ri_ptr->img_dim.ncomps, ri_ptr->img_dim.nt);
-
-            /* convert the pixel data into the HDF disk format */
-            DFKconvert(pixel_buf, img_data, ri_ptr->img_dim.nt,
-                       ri_ptr->img_dim.ncomps * count[XDIM] * count[YDIM], DFACC_WRITE, 0, 0);
-
-            free(pixel_buf);
-        }    /* end if */
-        else /* convert the pixel data into the HDF disk format */
-            DFKconvert(data, img_data, ri_ptr->img_dim.nt, ri_ptr->img_dim.ncomps * count[XDIM] * count[YDIM],
-                       DFACC_WRITE, 0, 0);
-    }    /* end if */
-    else /* no conversion necessary, just use the user's buffer */
-        img_data = data;
+    /* convert the image data to the HDF disk format as it's written, unless
+       the user's buffer can be written as it is */
+    if (GRIstage_start(&stage, ri_ptr, ri_ptr->img_dim.il, data, count, convert, FALSE) == FAIL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
     if (ri_ptr->img_tag == DFTAG_NULL || ri_ptr->img_ref == DFREF_WILDCARD)
         new_image = TRUE;
@@ -2677,10 +2967,17 @@ GRwriteimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], voi
         if (Hseek(ri_ptr->img_aid, 0, DF_START) == FAIL)
             HGOTO_ERROR(DFE_SEEKERROR, FAIL);
 
-        /* Write the entire image out */
-        if (Hwrite(ri_ptr->img_aid, (int32)pixel_disk_size * count[XDIM] * count[YDIM], (uint8 *)img_data) ==
-            FAIL)
-            HGOTO_ERROR(DFE_WRITEERROR, FAIL);
+        /* Write the entire image out, a band of rows at a time if it's converted */
+        for (int32 row = 0; row < count[YDIM]; row += stage.nrows) {
+            uint8 *rows = GRIstage_row(&stage, row);
+
+            if (rows == NULL)
+                HGOTO_ERROR(DFE_BADCONV, FAIL);
+            if (stage.disk_buf == NULL) /* the user's buffer, all of it */
+                stage.nrows = count[YDIM];
+            if (Hwrite(ri_ptr->img_aid, (int32)pixel_disk_size * count[XDIM] * stage.nrows, rows) == FAIL)
+                HGOTO_ERROR(DFE_WRITEERROR, FAIL);
+        }
     }                               /* end if */
     else {                          /* write only part of the image out */
         int32 img_offset;           /* current offset in the image data */
@@ -2748,7 +3045,6 @@ GRwriteimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], voi
                 free(fill_pixel);
         } /* end if */
 
-        tmp_data = img_data;
         if (solid_block == TRUE) { /* write out runs of data in the image */
             int32 pix_len;         /* length of current row's pixel run */
             int   i;               /* temporary loop variable */
@@ -2770,6 +3066,8 @@ GRwriteimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], voi
 
                 /* write out the block */
                 for (i = 0; i < count[YDIM]; i++) {
+                    if ((tmp_data = GRIstage_row(&stage, i)) == NULL)
+                        HGOTO_ERROR(DFE_BADCONV, FAIL);
                     if (Hwrite(ri_ptr->img_aid, pix_len, tmp_data) == FAIL)
                         HGOTO_ERROR(DFE_WRITEERROR, FAIL);
 
@@ -2779,7 +3077,6 @@ GRwriteimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], voi
                     if ((fill_hi_size + fill_lo_size) > 0 && i < (count[YDIM] - 1))
                         if (Hwrite(ri_ptr->img_aid, (fill_hi_size + fill_lo_size), fill_line) == FAIL)
                             HGOTO_ERROR(DFE_WRITEERROR, FAIL);
-                    tmp_data = (void *)((char *)tmp_data + pix_len);
                 } /* end for */
 
                 /* Finish the last chunk of high side fill values */
@@ -2797,12 +3094,13 @@ GRwriteimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], voi
             }      /* end if */
             else { /* don't worry about fill values */
                 for (i = 0; i < count[YDIM]; i++) {
+                    if ((tmp_data = GRIstage_row(&stage, i)) == NULL)
+                        HGOTO_ERROR(DFE_BADCONV, FAIL);
                     if (Hseek(ri_ptr->img_aid, img_offset, DF_START) == FAIL)
                         HGOTO_ERROR(DFE_SEEKERROR, FAIL);
                     if (Hwrite(ri_ptr->img_aid, pix_len, tmp_data) == FAIL)
                         HGOTO_ERROR(DFE_WRITEERROR, FAIL);
                     img_offset += (int32)pixel_disk_size * ri_ptr->img_dim.xdim;
-                    tmp_data = (void *)((char *)tmp_data + pix_len);
                 }                           /* end for */
             }                               /* end else */
         }                                   /* end if */
@@ -2839,6 +3137,8 @@ GRwriteimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], voi
                 } /* end if */
 
                 for (i = 0; i < count[YDIM]; i++) {
+                    if ((tmp_data = GRIstage_row(&stage, i)) == NULL)
+                        HGOTO_ERROR(DFE_BADCONV, FAIL);
                     for (j = 0; j < count[XDIM]; j++) {
                         if (Hwrite(ri_ptr->img_aid, (int32)pixel_disk_size, tmp_data) == FAIL)
                             HGOTO_ERROR(DFE_WRITEERROR, FAIL);
@@ -2879,6 +3179,8 @@ GRwriteimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], voi
                 for (i = 0; i < count[YDIM]; i++) {
                     int32 local_offset;
 
+                    if ((tmp_data = GRIstage_row(&stage, i)) == NULL)
+                        HGOTO_ERROR(DFE_BADCONV, FAIL);
                     local_offset = img_offset;
                     for (j = 0; j < count[XDIM]; j++) {
                         if (Hseek(ri_ptr->img_aid, local_offset, DF_START) == FAIL)
@@ -2899,15 +3201,14 @@ GRwriteimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], voi
     } /* end else */
     ri_ptr->data_modified = TRUE;
 
-    /* if we've allocated a temporary buffer, free it */
-    if (convert || switch_interlace == TRUE)
-        free(img_data);
-
     /* mark the image as being modified */
     ri_ptr->data_modified = TRUE;
     gr_ptr->gr_modified   = TRUE;
 
 done:
+    free(stage.pixel_buf);
+    free(stage.disk_buf);
+
     return ret_value;
 } /* end GRwriteimage() */
 
@@ -2956,7 +3257,7 @@ GRreadimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], void
     int          solid_block = FALSE; /* whether the image data is a solid block of data */
     int          whole_image = FALSE; /* whether we are reading in the whole image */
     int          image_data  = FALSE; /* whether there is actual image data or not */
-    void       **img_data;            /* pointer to the converted image data to write */
+    gr_stage_t   stage;               /* the image data being converted as it's read */
     unsigned     pixel_disk_size;     /* size of a pixel on disk */
     unsigned     pixel_mem_size;      /* size of a pixel in memory */
     int          convert;             /* true if machine NT != NT to be written */
@@ -2970,6 +3271,7 @@ GRreadimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], void
 
     /* clear error stack and check validity of args */
     HEclear();
+    stage.pixel_buf = stage.disk_buf = NULL;
 
     /* check the basic validity of the args (stride is OK to be NULL) */
     if (HAatom_group(riid) != RIIDGROUP || start == NULL /* || in_stride==NULL */ || count == NULL ||
@@ -3073,18 +3375,27 @@ GRreadimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], void
         else /* no fill value attribute */
             memset(fill_pixel, 0, pixel_mem_size);
 
-        /* Fill the user's buffer with the fill value */
-        HDmemfill(data, fill_pixel, pixel_mem_size, (uint32)(count[XDIM] * count[YDIM]));
+        /* Fill the user's buffer with the fill value, in the requested interlace */
+        if (GRIstage_start(&stage, ri_ptr, ri_ptr->im_il, data, count, FALSE, TRUE) == FAIL) {
+            free(fill_pixel);
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
+        }
+        for (int32 row = 0; row < count[YDIM]; row++) {
+            uint8 *rows = GRIstage_row(&stage, row);
+
+            if (rows == NULL) {
+                free(fill_pixel);
+                HGOTO_ERROR(DFE_BADCONV, FAIL);
+            }
+            HDmemfill(rows, fill_pixel, pixel_mem_size, (uint32)count[XDIM]);
+        }
         free(fill_pixel);
-    }                  /* end if */
-    else {             /* an image exists in the file */
-        if (convert) { /* convert image data to HDF disk format */
-            /* Allocate space for the conversion buffer */
-            if ((img_data = malloc(pixel_disk_size * (size_t)count[XDIM] * (size_t)count[YDIM])) == NULL)
-                HGOTO_ERROR(DFE_NOSPACE, FAIL);
-        }    /* end if */
-        else /* no conversion necessary, just use the user's buffer */
-            img_data = data;
+    }      /* end if */
+    else { /* an image exists in the file */
+        /* convert the image data from the HDF disk format as it's read,
+           unless it can be read into the user's buffer as it is */
+        if (GRIstage_start(&stage, ri_ptr, ri_ptr->im_il, data, count, convert, TRUE) == FAIL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
         if (GRIgetaid(ri_ptr, DFACC_READ) == FAIL)
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
@@ -3098,9 +3409,16 @@ GRreadimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], void
 
             /* This offset is relative to the element not the file and this */
             /* is where it reads and decompresses the data -BMR 09/2010 */
-            if (Hread(ri_ptr->img_aid, (int32)pixel_disk_size * count[XDIM] * count[YDIM],
-                      (uint8 *)img_data) == FAIL)
-                HGOTO_ERROR(DFE_READERROR, FAIL);
+            for (int32 row = 0; row < count[YDIM]; row += stage.nrows) {
+                uint8 *rows = GRIstage_row(&stage, row);
+
+                if (rows == NULL)
+                    HGOTO_ERROR(DFE_BADCONV, FAIL);
+                if (stage.disk_buf == NULL) /* the user's buffer, all of it */
+                    stage.nrows = count[YDIM];
+                if (Hread(ri_ptr->img_aid, (int32)pixel_disk_size * count[XDIM] * stage.nrows, rows) == FAIL)
+                    HGOTO_ERROR(DFE_READERROR, FAIL);
+            }
         }                     /* end if */
         else {                /* read only part of the image in */
             int32 img_offset; /* current offset in the image data */
@@ -3108,7 +3426,6 @@ GRreadimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], void
 
             img_offset = ((ri_ptr->img_dim.xdim * start[YDIM]) + start[XDIM]) * (int32)pixel_disk_size;
 
-            tmp_data = img_data;
             if (solid_block == TRUE) { /* read in runs of data in the image */
                 int32 pix_len;         /* length of current row's pixel run */
                 int   i;               /* temporary loop variable */
@@ -3117,12 +3434,13 @@ GRreadimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], void
 
                 /* read in the block */
                 for (i = 0; i < count[YDIM]; i++) {
+                    if ((tmp_data = GRIstage_row(&stage, i)) == NULL)
+                        HGOTO_ERROR(DFE_BADCONV, FAIL);
                     if (Hseek(ri_ptr->img_aid, img_offset, DF_START) == FAIL)
                         HGOTO_ERROR(DFE_SEEKERROR, FAIL);
                     if (Hread(ri_ptr->img_aid, pix_len, tmp_data) == FAIL)
                         HGOTO_ERROR(DFE_READERROR, FAIL);
                     img_offset += (int32)pixel_disk_size * ri_ptr->img_dim.xdim;
-                    tmp_data = (void *)((char *)tmp_data + pix_len);
                 }                 /* end for */
             }                     /* end if */
             else {                /* sub-sampling, seek to each data element and read it in */
@@ -3134,6 +3452,8 @@ GRreadimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], void
                 for (i = 0; i < count[YDIM]; i++) {
                     int32 local_offset;
 
+                    if ((tmp_data = GRIstage_row(&stage, i)) == NULL)
+                        HGOTO_ERROR(DFE_BADCONV, FAIL);
                     local_offset = img_offset;
                     for (j = 0; j < count[XDIM]; j++) {
                         if (Hseek(ri_ptr->img_aid, local_offset, DF_START) == FAIL)
@@ -3148,34 +3468,16 @@ GRreadimage(int32 riid, int32 start[2], int32 in_stride[2], int32 count[2], void
                 } /* end for */
             }     /* end else */
         }         /* end else */
+    }             /* end else */
 
-        if (convert) { /* convert the pixel data into the HDF disk format */
-            DFKconvert(img_data, data, ri_ptr->img_dim.nt, ri_ptr->img_dim.ncomps * count[XDIM] * count[YDIM],
-                       DFACC_READ, 0, 0);
-            free(img_data);
-        } /* end if */
-    }     /* end else */
-
-    /* Check whether we need to convert the buffer to the user's */
-    /*    requested interlace scheme. */
-    /* Note: This is implemented in a horribly ugly & slow manner, but I'm */
-    /*        in a bit of a hurry right now - QAK */
-    if (ri_ptr->im_il != MFGR_INTERLACE_PIXEL) {
-        void *pixel_buf; /* buffer for the pixel interlaced data */
-
-        /* Allocate space for the conversion buffer */
-        if ((pixel_buf = malloc(pixel_mem_size * (size_t)count[XDIM] * (size_t)count[YDIM])) == NULL)
-            HGOTO_ERROR(DFE_NOSPACE, FAIL);
-
-        GRIil_convert(data, MFGR_INTERLACE_PIXEL, pixel_buf, ri_ptr->im_il, count, ri_ptr->img_dim.ncomps,
-                      ri_ptr->img_dim.nt);
-
-        memcpy(data, pixel_buf, pixel_mem_size * (size_t)count[XDIM] * (size_t)count[YDIM]);
-
-        free(pixel_buf);
-    } /* end if */
+    /* convert the last band of rows read */
+    if (GRIstage_flush(&stage) == FAIL)
+        HGOTO_ERROR(DFE_BADCONV, FAIL);
 
 done:
+    free(stage.pixel_buf);
+    free(stage.disk_buf);
+
     return ret_value;
 } /* end GRreadimage() */
 
@@ -5872,6 +6174,128 @@ done:
     return ret_value;
 } /* GRsetchunkcache() */
 
+/******************************************************************************
+NAME
+     GRsetchunkcacheparams - byte bound and replacement policy of the chunk cache
+
+DESCRIPTION
+     Bounds the chunk cache of the GR to 'maxbytes' bytes of chunks and
+     sets which chunk leaves the cache when it is full, one of
+     HDF_CACHE_LRU, HDF_CACHE_ARC or HDF_CACHE_W0.  A 'maxbytes' of 0 keeps
+     the bound set with GRsetchunkcache().
+
+     NOTE:
+          This routine directly calls a Special Chunked Element fcn HMCxxx.
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+******************************************************************************/
+int
+GRsetchunkcacheparams(int32 riid,     /* IN: access aid to mess with */
+                      int32 maxbytes, /* IN: max bytes of chunks to cache, or 0 */
+                      int32 policy /* IN: HDF_CACHE_LRU, HDF_CACHE_ARC or HDF_CACHE_W0 */)
+{
+    ri_info_t *ri_ptr = NULL; /* ptr to the image to work with */
+    int16      special;       /* Special code */
+    int        ret_value = SUCCEED;
+
+    /* clear error stack and check validity of args */
+    HEclear();
+
+    /* Check args */
+    if (maxbytes < 0)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    if (policy != HDF_CACHE_LRU && policy != HDF_CACHE_ARC && policy != HDF_CACHE_W0)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    /* check the validity of the RI ID */
+    if (HAatom_group(riid) != RIIDGROUP)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    /* locate RI's object in hash table */
+    if (NULL == (ri_ptr = (ri_info_t *)HAatom_object(riid)))
+        HGOTO_ERROR(DFE_RINOTFOUND, FAIL);
+
+    /* check if access id exists already */
+    if (ri_ptr->img_aid == 0) {
+        /* now get access id, use write access */
+        if (GRIgetaid(ri_ptr, DFACC_WRITE) == FAIL)
+            HGOTO_ERROR(DFE_INTERNAL, FAIL);
+    }
+    else if (ri_ptr->img_aid == FAIL)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+    /* inquire about element */
+    if (Hinquire(ri_ptr->img_aid, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &special) == FAIL)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+    if (special != SPECIAL_CHUNKED)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    ret_value = HMCsetCacheparams(ri_ptr->img_aid, maxbytes, policy);
+
+done:
+    return ret_value;
+} /* GRsetchunkcacheparams() */
+
+/******************************************************************************
+NAME
+     GRgetchunkcachestats - statistics of the chunk cache
+
+DESCRIPTION
+     Fills in 'stats' with the hits, misses, evictions and reclaims of the
+     chunk cache of the GR, and the chunks it holds now.
+
+     NOTE:
+          This routine directly calls a Special Chunked Element fcn HMCxxx.
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+******************************************************************************/
+int
+GRgetchunkcachestats(int32            riid, /* IN: access aid to mess with */
+                     HDF_CACHE_STATS *stats /* OUT: statistics of the chunk cache */)
+{
+    ri_info_t *ri_ptr = NULL; /* ptr to the image to work with */
+    int16      special;       /* Special code */
+    int        ret_value = SUCCEED;
+
+    /* clear error stack and check validity of args */
+    HEclear();
+
+    /* Check args */
+    if (stats == NULL)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    /* check the validity of the RI ID */
+    if (HAatom_group(riid) != RIIDGROUP)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    /* locate RI's object in hash table */
+    if (NULL == (ri_ptr = (ri_info_t *)HAatom_object(riid)))
+        HGOTO_ERROR(DFE_RINOTFOUND, FAIL);
+
+    /* check if access id exists already */
+    if (ri_ptr->img_aid == 0) {
+        /* now get access id, use write access */
+        if (GRIgetaid(ri_ptr, DFACC_WRITE) == FAIL)
+            HGOTO_ERROR(DFE_INTERNAL, FAIL);
+    }
+    else if (ri_ptr->img_aid == FAIL)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+    /* inquire about element */
+    if (Hinquire(ri_ptr->img_aid, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &special) == FAIL)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+    if (special != SPECIAL_CHUNKED)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    ret_value = HMCgetCachestats(ri_ptr->img_aid, stats);
+
+done:
+    return ret_value;
+} /* GRgetchunkcachestats() */
+
 /*---------------------------------------------------------------
 NAME
    GRmapped - Checks whether an RI is to be mapped (hmap project)
@@ -22,6 +22,7 @@
 #include "hdf_priv.h"
 
 #include "hfile_priv.h"
+#include "hnameidx_priv.h"
 #include "tbbt_priv.h"
 
 /* This is the size of the hash tables used for GR & RI IDs */
@@ -48,6 +49,7 @@ typedef struct gr_info {
     int32      gr_count;    /* # of image entries in gr_tab so far */
     TBBT_TREE *grtree;      /* Root of image B-Tree */
     unsigned   gr_modified; /* whether any images have been modified */
+    HNIindex_p grnames;     /* index of the image names, NULL until GRnametoindex needs it */
 
     int32      gattr_count;    /* # of global attr entries in gr_tab so far */
     TBBT_TREE *gattree;        /* Root of global attribute B-Tree */
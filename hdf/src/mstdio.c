@@ -130,7 +130,7 @@ HCPmstdio_stwrite(accrec_t *access_rec)
  USAGE
     int32 HCPmstdio_seek(access_rec,offset,origin)
     accrec_t *access_rec;   IN: the access record of the data element
-    int32 offset;       IN: the offset in bytes from the origin specified
+    hdf_off_t offset;   IN: the offset in bytes from the origin specified
     int origin;        IN: the origin to seek from [UNUSED!]
 
  RETURNS
@@ -148,7 +148,7 @@ HCPmstdio_stwrite(accrec_t *access_rec)
  REVISION LOG
 --------------------------------------------------------------------------*/
 int32
-HCPmstdio_seek(accrec_t *access_rec, int32 offset, int origin)
+HCPmstdio_seek(accrec_t *access_rec, hdf_off_t offset, int origin)
 {
     compinfo_t *info; /* information on the special element */
     int32       ret;
@@ -156,7 +156,7 @@ HCPmstdio_seek(accrec_t *access_rec, int32 offset, int origin)
     info = (compinfo_t *)access_rec->special_info;
 
     /* set the offset */
-    info->minfo.model_info.stdio_info.pos = offset;
+    info->minfo.model_info.stdio_info.pos = (int32)offset;
 
     if ((ret = (*(info->cinfo.coder_funcs.seek))(access_rec, offset, origin)) == FAIL)
         HRETURN_ERROR(DFE_CODER, FAIL);
@@ -269,8 +269,8 @@ HCPmstdio_write(accrec_t *access_rec, int32 length, const void *data)
  REVISION LOG
 --------------------------------------------------------------------------*/
 int32
-HCPmstdio_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, int32 *plength,
-                  int32 *poffset, int32 *pposn, int16 *paccess, int16 *pspecial)
+HCPmstdio_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref, hdf_off_t *plength,
+                  hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess, int16 *pspecial)
 {
     compinfo_t *info; /* information on the special element */
     int32       ret;
@@ -43,10 +43,10 @@ HDFLIBAPI int32 HCPmstdio_stread(accrec_t *rec);
 
 HDFLIBAPI int32 HCPmstdio_stwrite(accrec_t *rec);
 
-HDFLIBAPI int32 HCPmstdio_seek(accrec_t *access_rec, int32 offset, int origin);
+HDFLIBAPI int32 HCPmstdio_seek(accrec_t *access_rec, hdf_off_t offset, int origin);
 
 HDFLIBAPI int32 HCPmstdio_inquire(accrec_t *access_rec, int32 *pfile_id, uint16 *ptag, uint16 *pref,
-                                  int32 *plength, int32 *poffset, int32 *pposn, int16 *paccess,
+                                  hdf_off_t *plength, hdf_off_t *poffset, hdf_off_t *pposn, int16 *paccess,
                                   int16 *pspecial);
 
 HDFLIBAPI int32 HCPmstdio_read(accrec_t *access_rec, int32 length, void *data);
@@ -926,11 +926,14 @@ tbbt_get_node(void)
 {
     TBBT_NODE *ret_value = NULL;
 
+#ifndef H4_HAVE_THREADSAFE
     if (tbbt_free_list != NULL) {
         ret_value      = tbbt_free_list;
         tbbt_free_list = tbbt_free_list->Lchild;
     }
-    else {
+    else
+#endif /* H4_HAVE_THREADSAFE */
+    {
         if (NULL == (ret_value = (TBBT_NODE *)calloc(1, sizeof(TBBT_NODE))))
             goto error;
         if (NULL == (ret_value->priv = (TBBT_NODE_PRIV *)calloc(1, sizeof(TBBT_NODE_PRIV))))
@@ -959,9 +962,15 @@ error:
 static void
 tbbt_release_node(TBBT_NODE *nod)
 {
+#ifdef H4_HAVE_THREADSAFE
+    /* the free list isn't shared between threads */
+    free(nod->priv);
+    free(nod);
+#else
     /* Insert the atom at the beginning of the free list */
     nod->Lchild    = tbbt_free_list;
     tbbt_free_list = nod;
+#endif /* H4_HAVE_THREADSAFE */
 } /* end tbbt_release_node() */
 
 /*--------------------------------------------------------------------------
@@ -39,6 +39,7 @@ EXPORTED ROUTINES
      Vlone          -- returns an array of refs of all lone vgroups in the file
      Vfind          -- looks in the file for a vgroup with a given name
      VSfind         -- looks in the file for a vdata with a given name
+     VIupdate_names -- keeps a name index of a file current
      Vfindclass     -- looks in the file and returns the ref of
                        the vgroup with the specified class
      VSfindclass    -- looks in the file and returns the ref of the vdata
@@ -483,6 +484,7 @@ VSsetname(int32       vkey, /* IN: Vdata key */
 {
     vsinstance_t *w        = NULL;
     VDATA        *vs       = NULL;
+    vfile_t      *vf       = NULL;
     int32         curr_len = 0;
     int32         slen;
     int32         ret_value = SUCCEED;
@@ -507,6 +509,10 @@ VSsetname(int32       vkey, /* IN: Vdata key */
     /* get current length of vdata name */
     curr_len = (int32)strnlen(vs->vsname, VSNAMELENMAX + 1);
 
+    /* take the current name out of the file's name index */
+    if (NULL != (vf = Get_vfile(vs->f)))
+        VIupdate_names(&vf->vsnames, vs->vsname, NULL, vs->oref);
+
     /* check length of new name against MAX length */
     if ((slen = (int32)strlen(vsname)) > VSNAMELENMAX) { /* truncate name */
         strncpy(vs->vsname, vsname, VSNAMELENMAX);
@@ -515,6 +521,9 @@ VSsetname(int32       vkey, /* IN: Vdata key */
     else /* copy whole name */
         strcpy(vs->vsname, vsname);
 
+    if (vf != NULL)
+        VIupdate_names(&vf->vsnames, NULL, vs->vsname, vs->oref);
+
     vs->marked = TRUE; /* mark vdata as being modified */
 
     if (curr_len < slen)
@@ -877,31 +886,37 @@ int32
 Vfind(HFILEID     f, /* IN: file id */
       const char *vgname /* IN: name of vgroup to find */)
 {
-    int32         vgid      = -1;
+    vfile_t      *vf        = NULL;
     vginstance_t *v         = NULL;
-    VGROUP       *vg        = NULL;
+    void        **t         = NULL;
+    int32         ref       = FAIL;
     int32         ret_value = 0;
 
     /* check for null vgroup name */
     if (vgname == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
-    /* process through Vgroups in file */
-    while (FAIL != (vgid = Vgetid(f, vgid))) { /* get instance of vgroup */
-        if ((v = vginst(f, (uint16)vgid)) == NULL)
-            HGOTO_DONE(0);
+    if (NULL == (vf = Get_vfile(f)))
+        HGOTO_DONE(0);
 
-        /* get vgroup itself and check it */
-        vg = v->vg;
-        if (vg == NULL)
+    /* index the names of the vgroups in file the first time through */
+    if (vf->vgnames == NULL) {
+        if (NULL == (vf->vgnames = HNIcreate()))
             HGOTO_DONE(0);
-
-        /* compare vgroup name to 'vgname' if it had been set */
-        if (vg->vgname != NULL)
-            if (!strcmp(vgname, vg->vgname))
-                HGOTO_DONE((int32)(vg->oref)); /* found the vgroup */
+        for (t = (void **)tbbtfirst(vf->vgtree->root); t != NULL; t = (void **)tbbtnext((TBBT_NODE *)t)) {
+            v = (vginstance_t *)*t;
+            if (v->vg != NULL && v->vg->vgname != NULL)
+                if (HNIadd(vf->vgnames, v->vg->vgname, (int32)v->vg->oref) == FAIL) {
+                    HNIdestroy(vf->vgnames);
+                    vf->vgnames = NULL;
+                    HGOTO_DONE(0);
+                }
+        }
     }
 
+    if ((ref = HNIfind(vf->vgnames, vgname)) != FAIL)
+        ret_value = ref; /* found the vgroup */
+
 done:
     return ret_value;
 } /* Vfind */
@@ -923,34 +938,71 @@ int32
 VSfind(HFILEID     f, /* IN: file id */
        const char *vsname /* IN: name of vdata to find */)
 {
-    int32         vsid      = -1;
-    vsinstance_t *v         = NULL;
-    VDATA        *vs        = NULL;
+    vfile_t      *vf        = NULL;
+    vsinstance_t *w         = NULL;
+    void        **t         = NULL;
+    int32         ref       = FAIL;
     int32         ret_value = 0;
 
     /* check for null vdata name */
     if (vsname == NULL)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
-    /* process through Vdatas in file */
-    while (FAIL != (vsid = VSgetid(f, vsid))) { /* get instance of vdata */
-        if ((v = vsinst(f, (uint16)vsid)) == NULL)
-            HGOTO_DONE(0);
+    if (NULL == (vf = Get_vfile(f)))
+        HGOTO_DONE(0);
 
-        /* get vdata itself and check it */
-        vs = v->vs;
-        if (vs == NULL)
+    /* index the names of the vdatas in file the first time through */
+    if (vf->vsnames == NULL) {
+        if (NULL == (vf->vsnames = HNIcreate()))
             HGOTO_DONE(0);
-
-        /* compare vdata name to 'vsname' if it had been set */
-        if (!strcmp(vsname, vs->vsname))
-            HGOTO_DONE((int32)(vs->oref)); /* found the vdata */
+        for (t = (void **)tbbtfirst(vf->vstree->root); t != NULL; t = (void **)tbbtnext((TBBT_NODE *)t)) {
+            w = (vsinstance_t *)*t;
+            if (w->vs != NULL)
+                if (HNIadd(vf->vsnames, w->vs->vsname, (int32)w->vs->oref) == FAIL) {
+                    HNIdestroy(vf->vsnames);
+                    vf->vsnames = NULL;
+                    HGOTO_DONE(0);
+                }
+        }
     }
 
+    if ((ref = HNIfind(vf->vsnames, vsname)) != FAIL)
+        ret_value = ref; /* found the vdata */
+
 done:
     return ret_value;
 } /* VSfind */
 
+/*------------------------------------------------------------------
+NAME
+   VIupdate_names -- keeps a name index of a file current
+
+DESCRIPTION
+   Moves the vgroup or vdata with ref 'ref' from 'oldname' to
+   'newname' in the name index 'names' (either name may be NULL, for
+   an object which is created or deleted).  Nothing is done if the
+   index hasn't been built.  If the index can't be updated it is
+   freed, so that it is built again by the next search.
+
+RETURNS
+   Nothing
+---------------------------------------------------------------------*/
+void
+VIupdate_names(HNIindex_p *names,   /* IN/OUT: the name index */
+               const char *oldname, /* IN: name the object had, or NULL */
+               const char *newname, /* IN: name the object has, or NULL */
+               uint16      ref /* IN: ref of the object */)
+{
+    if (*names == NULL)
+        return;
+
+    if ((oldname != NULL && HNIremove(*names, oldname, (int32)ref) == FAIL) ||
+        (newname != NULL && HNIadd(*names, newname, (int32)ref) == FAIL)) {
+        HNIdestroy(*names);
+        *names = NULL;
+    }
+} /* VIupdate_names */
+
 /* -----------------------------------------------------------------
 NAME
    Vfindclass -- looks in the file and returns the ref of
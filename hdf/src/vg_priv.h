@@ -34,6 +34,9 @@
 /* Include file for Threaded, Balanced Binary Tree implementation */
 #include "tbbt_priv.h"
 
+/* Include file for the name indexes */
+#include "hnameidx_priv.h"
+
 /*
  * typedefs for VGROUP, VDATA and VSUBGROUP
  */
@@ -165,6 +168,7 @@ struct vdata_desc {
     int16                      version, more; /* version and "more" field */
     int32                      aid;           /* access id - for LINKED blocks */
     struct vs_instance_struct *instance;      /* ptr to the instance struct for this VData */
+    struct vs_plan_struct     *rplan;         /* plan for reading rlist, see vrw.c */
     struct vdata_desc         *next;          /* pointer to next node (for free list only) */
 };                                            /* VDATA */
 
@@ -215,6 +219,9 @@ typedef struct vfiledir_struct {
     int32      vstabn; /* # of vs entries in vstab so far */
     TBBT_TREE *vstree; /* Root of VSet B-Tree */
     int        access; /* the number of active pointers to this file's Vstuff */
+
+    HNIindex_p vgnames; /* index of the Vgroup names, NULL until Vfind needs it */
+    HNIindex_p vsnames; /* index of the Vdata names, NULL until VSfind needs it */
 } vfile_t;
 
 /* .................................................................. */
@@ -233,6 +240,8 @@ void VSIrelease_vdata_node(VDATA *v);
 int VSIgetvdatas(int32 id, const char *vsclass, const unsigned start_vd, const unsigned n_vds,
                  uint16 *refarray);
 
+void VIupdate_names(HNIindex_p *names, const char *oldname, const char *newname, uint16 ref);
+
 HDFLIBAPI vsinstance_t *VSIget_vsinstance_node(void);
 
 HDFLIBAPI void VSIrelease_vsinstance_node(vsinstance_t *vs);
@@ -25,6 +25,7 @@ LOCAL ROUTINES
  VIrelease_vgroup_node -- Releases a vgroup node
  VIget_vginstance_node -- allocate a new vginstance_t record
  VIrelease_vginstance_node -- Releases a vginstance node
+ VIfree_deleted -- Frees a deleted vgroup once it's detached
  Get_vfile    -- get vgroup file record
  New_vfile    -- create new vgroup file record
  Load_vfile   -- loads vgtab table with info of all vgroups in file.
@@ -102,6 +103,7 @@ EXPORTED ROUTINES
 *************************************************************************/
 
 #include "hdf_priv.h"
+#include "hthread_priv.h"
 #include "vg_priv.h"
 
 /* These are used to determine whether a vgroup had been created by the
@@ -120,6 +122,8 @@ static int vunpackvg(VGROUP *vg, uint8 buf[], int len);
 
 static int VIstart(void);
 
+static void VIfree_deleted(vginstance_t *v);
+
 /*
  * --------------------------------------------------------------------
  * Private data structure and routines.
@@ -138,10 +142,6 @@ TBBT_TREE *vtree = NULL;
 /* Whether we've installed the library termination function yet for this interface */
 static int library_terminate = FALSE;
 
-/* Temporary buffer for I/O */
-static uint32 Vgbufsize = 0;
-static uint8 *Vgbuf     = NULL;
-
 /* Pointers to the VGROUP & vginstance node free lists */
 static VGROUP       *vgroup_free_list     = NULL;
 static vginstance_t *vginstance_free_list = NULL;
@@ -165,12 +165,15 @@ VIget_vgroup_node(void)
     /* clear error stack */
     HEclear();
 
+#ifndef H4_HAVE_THREADSAFE
     /* Grab from free list if possible */
     if (vgroup_free_list != NULL) {
         ret_value        = vgroup_free_list;
         vgroup_free_list = vgroup_free_list->next;
     } /* end if */
-    else {
+    else
+#endif /* H4_HAVE_THREADSAFE */
+    {
         if ((ret_value = (VGROUP *)malloc(sizeof(VGROUP))) == NULL)
             HGOTO_ERROR(DFE_NOSPACE, NULL);
     } /* end else */
@@ -196,10 +199,14 @@ done:
 void
 VIrelease_vgroup_node(VGROUP *vg)
 {
+#ifdef H4_HAVE_THREADSAFE
+    /* the free list isn't shared between threads */
+    free(vg);
+#else
     /* Insert the atom at the beginning of the free list */
     vg->next         = vgroup_free_list;
     vgroup_free_list = vg;
-
+#endif /* H4_HAVE_THREADSAFE */
 } /* end VIrelease_vgroup_node() */
 
 /******************************************************************************
@@ -220,12 +227,15 @@ VIget_vginstance_node(void)
     /* clear error stack */
     HEclear();
 
+#ifndef H4_HAVE_THREADSAFE
     /* Grab from free list if possible */
     if (vginstance_free_list != NULL) {
         ret_value            = vginstance_free_list;
         vginstance_free_list = vginstance_free_list->next;
     } /* end if */
-    else {
+    else
+#endif /* H4_HAVE_THREADSAFE */
+    {
         if ((ret_value = (vginstance_t *)malloc(sizeof(vginstance_t))) == NULL)
             HGOTO_ERROR(DFE_NOSPACE, NULL);
     } /* end else */
@@ -251,10 +261,14 @@ done:
 void
 VIrelease_vginstance_node(vginstance_t *vg /* IN: vgroup instance to release */)
 {
+#ifdef H4_HAVE_THREADSAFE
+    /* the free list isn't shared between threads */
+    free(vg);
+#else
     /* Insert the vsinstance at the beginning of the free list */
     vg->next             = vginstance_free_list;
     vginstance_free_list = vg;
-
+#endif /* H4_HAVE_THREADSAFE */
 } /* end VIrelease_vginstance_node() */
 
 /*******************************************************************************
@@ -275,7 +289,9 @@ Get_vfile(HFILEID f /* IN: file handle */)
     int32  key = (int32)f; /* initialize key to file handle */
 
     /* find file record */
+    HTS_REGISTRY_LOCK();
     t = (void **)tbbtdfind(vtree, (void *)&key, NULL);
+    HTS_REGISTRY_UNLOCK();
 
     return (vfile_t *)(t == NULL ? NULL : *t);
 } /* end Get_vfile() */
@@ -304,7 +320,9 @@ New_vfile(HFILEID f /* IN: file handle */)
     v->f = f;
 
     /* insert the vg instance in B-tree */
+    HTS_REGISTRY_LOCK();
     tbbtdins(vtree, (void *)v, NULL);
+    HTS_REGISTRY_UNLOCK();
 
     /* return vfile_t struct */
     return v;
@@ -499,16 +517,21 @@ Remove_vfile(HFILEID f /* IN: file handle */)
     if (--vf->access)
         HGOTO_DONE(SUCCEED);
 
-    /* clear out the tbbt's */
+    /* clear out the tbbt's and the name indexes */
     tbbtdfree(vf->vgtree, vdestroynode, NULL);
     tbbtdfree(vf->vstree, vsdestroynode, NULL);
-
-    /* Find the node in the tree */
-    if ((t = (void **)tbbtdfind(vtree, (void *)&f, NULL)) == NULL)
+    HNIdestroy(vf->vgnames);
+    HNIdestroy(vf->vsnames);
+
+    /* Find the node in the tree and delete it */
+    HTS_REGISTRY_LOCK();
+    if ((t = (void **)tbbtdfind(vtree, (void *)&f, NULL)) != NULL)
+        vf = tbbtrem((TBBT_NODE **)vtree, (TBBT_NODE *)t, NULL);
+    HTS_REGISTRY_UNLOCK();
+    if (t == NULL)
         HGOTO_DONE(FAIL);
 
-    /* Delete the node and free the vfile_t structure */
-    vf = tbbtrem((TBBT_NODE **)vtree, (TBBT_NODE *)t, NULL);
+    /* free the vfile_t structure */
     free(vf);
 
 done:
@@ -597,6 +620,34 @@ vdestroynode(void *n /* IN: node to free */)
     } /* end if n */
 } /* vdestroynode */
 
+/*******************************************************************************
+ NAME
+    VIfree_deleted -- Frees a deleted vgroup once it's detached
+
+ DESCRIPTION
+    Vdelete takes a vgroup out of its file's tree, but leaves an instance
+    which is still attached for Vdetach to free.  Called when the last
+    attach to an instance ends; frees it if it's no longer in the tree.
+
+ RETURNS
+    No return value
+
+*******************************************************************************/
+static void
+VIfree_deleted(vginstance_t *v /* IN: instance whose last attach ended */)
+{
+    vfile_t *vf = NULL;
+    void   **t  = NULL;
+    int32    key;
+
+    if (NULL == (vf = Get_vfile(v->vg->f)))
+        return;
+
+    key = v->key;
+    if ((t = (void **)tbbtdfind(vf->vgtree, &key, NULL)) == NULL || *t != v)
+        vdestroynode(v);
+} /* VIfree_deleted */
+
 /*******************************************************************************
 NAME
    vfdestroynode  -- destroy vgroup file record node in TBBT
@@ -618,9 +669,11 @@ vfdestroynode(void *n /* IN: vfile_t record to free */)
     if (n != NULL) {
         vf = (vfile_t *)n;
 
-        /* clear out the tbbt's */
+        /* clear out the tbbt's and the name indexes */
         tbbtdfree(vf->vgtree, vdestroynode, NULL);
         tbbtdfree(vf->vstree, vsdestroynode, NULL);
+        HNIdestroy(vf->vgnames);
+        HNIdestroy(vf->vsnames);
 
         free(vf);
     }
@@ -640,7 +693,9 @@ RETURNS
 int
 Vinitialize(HFILEID f /* IN: file handle */)
 {
-    int ret_value = SUCCEED;
+    filerec_t *locked_rec = NULL;
+    int        status     = SUCCEED;
+    int        ret_value  = SUCCEED;
 
     /* clear error stack */
     HEclear();
@@ -650,16 +705,23 @@ Vinitialize(HFILEID f /* IN: file handle */)
         HGOTO_ERROR(DFE_ARGS, FAIL);
 
     /* Perform global, one-time initialization */
-    if (library_terminate == FALSE) {
-        if (VIstart() == FAIL)
-            HGOTO_ERROR(DFE_CANTINIT, FAIL);
-    }
+    HTS_REGISTRY_LOCK();
+    if (library_terminate == FALSE)
+        status = VIstart();
+    HTS_REGISTRY_UNLOCK();
+    if (status == FAIL)
+        HGOTO_ERROR(DFE_CANTINIT, FAIL);
+
+    /* loading and removing the file's record is serialized by the file's
+       lock, which may already be held when Vfinish is called */
+    locked_rec = HPlock_file(f);
 
     /* load Vxx stuff from file? */
     if (Load_vfile(f) == FAIL)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* Vinitialize() */
 
@@ -677,16 +739,20 @@ RETURNS
 int
 Vfinish(HFILEID f /* IN: file handle */)
 {
-    int ret_value = SUCCEED;
+    filerec_t *locked_rec = NULL;
+    int        ret_value  = SUCCEED;
 
     /* clear error stack */
     HEclear();
 
+    locked_rec = HPlock_file(f);
+
     /* remove Vxxx file record ? */
     if (Remove_vfile(f) == FAIL)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
 
 done:
+    HPunlock_file(locked_rec);
     return ret_value;
 } /* Vfinish() */
 
@@ -996,8 +1062,8 @@ VGROUP *
 VPgetinfo(HFILEID f, /* IN: file handle */
           uint16  ref /* IN: ref of vgroup */)
 {
-    VGROUP *vg = NULL;
-    /*  int          len;    int mismatches Vgbufsize type -- uint32 */
+    VGROUP *vg    = NULL;
+    uint8  *Vgbuf = NULL; /* this thread's buffer for the raw Vgroup info */
     size_t  len;
     VGROUP *ret_value = NULL; /* FAIL */
 
@@ -1008,14 +1074,8 @@ VPgetinfo(HFILEID f, /* IN: file handle */
     if ((len = Hlength(f, DFTAG_VG, (uint16)ref)) == FAIL)
         HGOTO_ERROR(DFE_INTERNAL, NULL);
 
-    if (len > Vgbufsize) {
-        Vgbufsize = len;
-
-        free(Vgbuf);
-
-        if ((Vgbuf = (uint8 *)malloc(Vgbufsize)) == NULL)
-            HGOTO_ERROR(DFE_NOSPACE, NULL);
-    }
+    if ((Vgbuf = HTSget_buf(HTS_VG_BUF, len)) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, NULL);
 
     /* Get the raw Vgroup info */
     if (Hgetelement(f, DFTAG_VG, (uint16)ref, Vgbuf) == (int32)FAIL)
@@ -1211,8 +1271,9 @@ RETURNS
 int32
 Vdetach(int32 vkey /* IN: vgroup key */)
 {
-    VGROUP       *vg = NULL;
-    vginstance_t *v  = NULL;
+    VGROUP       *vg    = NULL;
+    vginstance_t *v     = NULL;
+    uint8        *Vgbuf = NULL; /* this thread's buffer for the packed Vgroup */
     int32         vgpacksize;
     int32         ret_value = SUCCEED;
 
@@ -1246,14 +1307,8 @@ Vdetach(int32 vkey /* IN: vgroup key */)
         need = sizeof(VGROUP) + vgnamelen /* vgname dynamic, vpackvg omits null */
                + vgclasslen               /* vgclass dynamic, vpackvg omits null */
                + (size_t)vg->nvelt * 4 + (size_t)vg->nattrs * sizeof(vg_attr_t) + 1;
-        if (need > Vgbufsize) {
-            Vgbufsize = need;
-
-            free(Vgbuf);
-
-            if ((Vgbuf = (uint8 *)malloc(Vgbufsize)) == NULL)
-                HGOTO_ERROR(DFE_NOSPACE, FAIL);
-        } /* end if */
+        if ((Vgbuf = HTSget_buf(HTS_VG_BUF, need)) == NULL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
         if (FAIL == vpackvg(vg, Vgbuf, &vgpacksize))
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
@@ -1295,6 +1350,8 @@ Vdetach(int32 vkey /* IN: vgroup key */)
     }
 
     v->nattach--;
+    if (v->nattach == 0)
+        VIfree_deleted(v);
 
 done:
     return ret_value;
@@ -2046,6 +2103,7 @@ Vsetname(int32       vkey, /* IN: vgroup key */
 {
     vginstance_t *v  = NULL;
     VGROUP       *vg = NULL;
+    vfile_t      *vf = NULL;
     size_t        name_len;
     int32         ret_value = SUCCEED;
 
@@ -2070,6 +2128,8 @@ Vsetname(int32       vkey, /* IN: vgroup key */
     name_len = strlen(vgname); /* shortcut of length of the given name */
 
     /* if name exists, release it */
+    if (NULL != (vf = Get_vfile(vg->f)))
+        VIupdate_names(&vf->vgnames, vg->vgname, NULL, vg->oref);
     free(vg->vgname);
 
     /* allocate space for new name */
@@ -2081,6 +2141,8 @@ Vsetname(int32       vkey, /* IN: vgroup key */
 
     /* copy given name after allocation succeeded, with \0 terminated */
     HIstrncpy(vg->vgname, vgname, (int)name_len + 1);
+    if (vf != NULL)
+        VIupdate_names(&vf->vgnames, NULL, vg->vgname, vg->oref);
 
     vg->marked = TRUE;
 
@@ -2777,9 +2839,19 @@ Vdelete(int32 f, /* IN: file handle */
     if ((t = (void **)tbbtdfind(vf->vgtree, (void *)&key, NULL)) == NULL)
         HGOTO_DONE(FAIL);
 
-    /* remove vgroup node from TBBT */
-    if ((v = tbbtrem((TBBT_NODE **)vf->vgtree, (TBBT_NODE *)t, NULL)) != NULL)
-        vdestroynode((void *)v);
+    /* remove vgroup node from TBBT and from the name index; one still
+       attached is left for the last Vdetach to free, and mustn't write
+       itself back */
+    if ((v = tbbtrem((TBBT_NODE **)vf->vgtree, (TBBT_NODE *)t, NULL)) != NULL) {
+        vginstance_t *vi = (vginstance_t *)v;
+
+        if (vi->vg != NULL)
+            VIupdate_names(&vf->vgnames, vi->vg->vgname, NULL, (uint16)vgid);
+        if (vi->nattach > 0 && vi->vg != NULL)
+            vi->vg->marked = 0;
+        else
+            vdestroynode((void *)v);
+    }
 
     /* Delete vgroup from file */
     if (Hdeldd(f, DFTAG_VG, (uint16)vgid) == FAIL)
@@ -2872,11 +2944,7 @@ VPshutdown(void)
         vtree = NULL;
     }
 
-    if (Vgbuf != NULL) {
-        free(Vgbuf);
-        Vgbuf     = NULL;
-        Vgbufsize = 0;
-    }
+    HTSfree_local(HTS_VG_BUF);
 
 done:
     return ret_value;
@@ -26,6 +26,7 @@ LOCAL ROUTINES
  VSIrelease_vdata_node  -- Releases a vdata node
  VSIget_vsinstance_node -- allocate a new vsinstance_t record
  VSIrelease_vsinstance_node -- Releases a vsinstance node
+ VSIfree_deleted        -- Frees a deleted vdata once it's detached
 
 LIBRARY PRIVATE ROUTINES
  VSPhshutdown  --  shutdown the Vset interface
@@ -59,14 +60,12 @@ EXPORTED ROUTINES
 *************************************************************************/
 
 #include "hdf_priv.h"
+#include "hthread_priv.h"
 #include "vg_priv.h"
 
 /* Private Function Prototypes */
-static int vunpackvs(VDATA *vs, uint8 buf[], int32 len);
-
-/* Temporary buffer for I/O */
-static uint32 Vhbufsize = 0;
-static uint8 *Vhbuf     = NULL;
+static int  vunpackvs(VDATA *vs, uint8 buf[], int32 len);
+static void VSIfree_deleted(vsinstance_t *w);
 
 /* Pointers to the VDATA & vsinstance node free lists */
 static VDATA        *vdata_free_list      = NULL;
@@ -93,13 +92,15 @@ VSIget_vdata_node(void)
     /* clear error stack */
     HEclear();
 
+#ifndef H4_HAVE_THREADSAFE
     /* Grab from free list if possible */
     if (vdata_free_list != NULL) {
         ret_value       = vdata_free_list;
         vdata_free_list = vdata_free_list->next;
     }
-    else /* allocate a new node */
-    {
+    else
+#endif /* H4_HAVE_THREADSAFE */
+    { /* allocate a new node */
         if ((ret_value = (VDATA *)malloc(sizeof(VDATA))) == NULL)
             HGOTO_ERROR(DFE_NOSPACE, NULL);
     } /* end else */
@@ -125,10 +126,14 @@ done:
 void
 VSIrelease_vdata_node(VDATA *vs /* IN: vdata to release */)
 {
+#ifdef H4_HAVE_THREADSAFE
+    /* the free list isn't shared between threads */
+    free(vs);
+#else
     /* Insert the atom at the beginning of the free list */
     vs->next        = vdata_free_list;
     vdata_free_list = vs;
-
+#endif /* H4_HAVE_THREADSAFE */
 } /* end VSIrelease_vdata_node() */
 
 /*******************************************************************************
@@ -149,13 +154,15 @@ VSIget_vsinstance_node(void)
     /* clear error stack */
     HEclear();
 
+#ifndef H4_HAVE_THREADSAFE
     /* Grab from free list if possible */
     if (vsinstance_free_list != NULL) {
         ret_value            = vsinstance_free_list;
         vsinstance_free_list = vsinstance_free_list->next;
     }
-    else /* allocate a new vsinstance record */
-    {
+    else
+#endif /* H4_HAVE_THREADSAFE */
+    { /* allocate a new vsinstance record */
         if ((ret_value = (vsinstance_t *)malloc(sizeof(vsinstance_t))) == NULL)
             HGOTO_ERROR(DFE_NOSPACE, NULL);
     } /* end else */
@@ -181,10 +188,14 @@ done:
 void
 VSIrelease_vsinstance_node(vsinstance_t *vs /* IN: vinstance node to release */)
 {
+#ifdef H4_HAVE_THREADSAFE
+    /* the free list isn't shared between threads */
+    free(vs);
+#else
     /* Insert the atom at the beginning of the free list */
     vs->next             = vsinstance_free_list;
     vsinstance_free_list = vs;
-
+#endif /* H4_HAVE_THREADSAFE */
 } /* end VSIrelease_vsinstance_node() */
 
 /*******************************************************************************
@@ -227,12 +238,8 @@ VSPhshutdown(void)
         }
     }
 
-    /* free buffer */
-    if (Vhbuf != NULL) {
-        free(Vhbuf);
-        Vhbuf     = NULL;
-        Vhbufsize = 0;
-    }
+    /* free this thread's buffer */
+    HTSfree_local(HTS_VH_BUF);
 
     /* free the parsing buffer */
     ret_value = VPparse_shutdown();
@@ -662,6 +669,7 @@ vsdestroynode(void *n /* IN: Node in TBBT-tree */)
             free(vs->wlist.bptr);
 
             free(vs->rlist.item);
+            free(vs->rplan);
 
             free(vs->alist);
 
@@ -674,6 +682,34 @@ vsdestroynode(void *n /* IN: Node in TBBT-tree */)
 
 } /* vsdestroynode */
 
+/*******************************************************************************
+ NAME
+    VSIfree_deleted -- Frees a deleted vdata once it's detached
+
+ DESCRIPTION
+    VSdelete takes a vdata out of its file's tree, but leaves an instance
+    which is still attached for VSdetach to free.  Called when the last
+    attach to an instance ends; frees it if it's no longer in the tree.
+
+ RETURNS
+    No return value
+
+*******************************************************************************/
+static void
+VSIfree_deleted(vsinstance_t *w /* IN: instance whose last attach ended */)
+{
+    vfile_t *vf = NULL;
+    void   **t  = NULL;
+    int32    key;
+
+    if (NULL == (vf = Get_vfile(w->vs->f)))
+        return;
+
+    key = w->key;
+    if ((t = (void **)tbbtdfind(vf->vstree, &key, NULL)) == NULL || *t != w)
+        vsdestroynode(w);
+} /* VSIfree_deleted */
+
 /*******************************************************************************
  NAME
     VSPgetinfo -- Read in the "header" information about the Vdata.
@@ -691,8 +727,8 @@ VDATA *
 VSPgetinfo(HFILEID f, /* IN: file handle */
            uint16  ref /* IN: ref of the Vdata */)
 {
-    VDATA *vs = NULL;        /* new vdata to be returned */
-                             /* int32       vh_length;   int32 is mismatches Vhbuf's type -- uint32 */
+    VDATA *vs    = NULL;     /* new vdata to be returned */
+    uint8 *Vhbuf = NULL;     /* this thread's buffer for the vdata header */
     size_t vh_length;        /* length of the vdata header */
     VDATA *ret_value = NULL; /* FAIL */
 
@@ -707,15 +743,8 @@ VSPgetinfo(HFILEID f, /* IN: file handle */
     if ((vh_length = Hlength(f, DFTAG_VH, ref)) == FAIL)
         HGOTO_ERROR(DFE_BADLEN, NULL);
 
-    if (vh_length > Vhbufsize) {
-        Vhbufsize = vh_length;
-
-        if (Vhbuf != NULL)
-            free(Vhbuf);
-
-        if ((Vhbuf = (uint8 *)malloc(Vhbufsize)) == NULL)
-            HGOTO_ERROR(DFE_NOSPACE, NULL);
-    }
+    if ((Vhbuf = HTSget_buf(HTS_VH_BUF, vh_length)) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, NULL);
 
     /* get Vdata header from file */
     if (Hgetelement(f, DFTAG_VH, ref, Vhbuf) == FAIL)
@@ -861,8 +890,9 @@ VSattach(HFILEID     f,    /* IN: file handle */
         w->nattach   = 1;
         w->nvertices = 0;
 
-        /* insert the vs instance in B-tree */
+        /* insert the vs instance in B-tree and in the name index */
         tbbtdins(vf->vstree, w, NULL);
+        VIupdate_names(&vf->vsnames, NULL, vs->vsname, vs->oref);
 
         vs->instance = w;
     }      /* end of case where vsid is -1 */
@@ -978,6 +1008,7 @@ VSdetach(int32 vkey /* IN: vdata key? */)
     int32         i;
     int32         ret;
     int32         vspacksize;
+    uint8        *Vhbuf     = NULL; /* this thread's buffer for the packed vdata header */
     vsinstance_t *w         = NULL;
     VDATA        *vs        = NULL;
     int32         ret_value = SUCCEED;
@@ -1010,6 +1041,7 @@ VSdetach(int32 vkey /* IN: vdata key? */)
             /* remove from atom list */
             if (HAremove_atom(vkey) == NULL)
                 HGOTO_ERROR(DFE_INTERNAL, FAIL);
+            VSIfree_deleted(w);
         } /* end if */
 
         /* we are done */
@@ -1026,13 +1058,8 @@ VSdetach(int32 vkey /* IN: vdata key? */)
 
             need = sizeof(VWRITELIST) + (size_t)vs->nattrs * sizeof(vs_attr_t) + sizeof(VDATA) + 1;
 
-            if (need > Vhbufsize) {
-                Vhbufsize = need;
-                free(Vhbuf);
-
-                if ((Vhbuf = malloc(Vhbufsize)) == NULL)
-                    HGOTO_ERROR(DFE_NOSPACE, FAIL);
-            }
+            if ((Vhbuf = HTSget_buf(HTS_VH_BUF, need)) == NULL)
+                HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
             if (FAIL == vpackvs(vs, Vhbuf, &vspacksize))
                 HGOTO_ERROR(DFE_INTERNAL, FAIL);
@@ -1083,6 +1110,7 @@ VSdetach(int32 vkey /* IN: vdata key? */)
         /* remove vdata from atom list */
         if (HAremove_atom(vkey) == NULL)
             HGOTO_ERROR(DFE_INTERNAL, FAIL);
+        VSIfree_deleted(w);
 
     } /* end of 'write' case */
 
@@ -1411,9 +1439,21 @@ VSdelete(int32 f, /* IN: file handle */
     /* remove vdata from TBBT */
     v = tbbtrem((TBBT_NODE **)vf->vstree, (TBBT_NODE *)t, NULL);
 
-    /* destroy vdata node itself*/
-    if (v != NULL)
-        vsdestroynode(v);
+    /* destroy vdata node itself, after taking it out of the name index;
+       one still attached is left for the last VSdetach to free, and
+       mustn't write its header back */
+    if (v != NULL) {
+        vsinstance_t *w = (vsinstance_t *)v;
+
+        if (w->vs != NULL)
+            VIupdate_names(&vf->vsnames, w->vs->vsname, NULL, (uint16)vsid);
+        if (w->nattach > 0 && w->vs != NULL) {
+            w->vs->marked   = 0;
+            w->vs->new_h_sz = 0;
+        }
+        else
+            vsdestroynode(v);
+    }
 
     /* delete vdata header and data from file */
     if (Hdeldd(f, DFTAG_VS, (uint16)vsid) == FAIL)
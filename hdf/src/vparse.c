@@ -23,17 +23,25 @@
 ************************************************************************/
 
 #include "hdf_priv.h"
+#include "hthread_priv.h"
 #include "vg_priv.h"
 
 #define ISCOMMA(c) ((c == ',') ? 1 : 0)
 
-static char *symptr[VSFIELDMAX];                   /* array of ptrs to tokens  ? */
-static char  sym[VSFIELDMAX][FIELDNAMELENMAX + 1]; /* array of tokens ? */
-static int   nsym;                                 /* token index ? */
-
-/* Temporary buffer for I/O */
-static uint32 Vpbufsize = 0;
-static uint8 *Vpbuf     = NULL;
+/* Each thread's tokens and temporary buffer */
+typedef struct {
+    char  *symptr[VSFIELDMAX];                   /* array of ptrs to tokens  ? */
+    char   sym[VSFIELDMAX][FIELDNAMELENMAX + 1]; /* array of tokens ? */
+    uint32 Vpbufsize;                            /* size of Vpbuf */
+    uint8 *Vpbuf;                                /* temporary buffer for I/O */
+} VPstate_t;
+
+/* Frees the buffer of a thread's VPstate_t */
+static void
+VPIfree_state(void *data)
+{
+    free(((VPstate_t *)data)->Vpbuf);
+}
 
 /*******************************************************************************
  NAME
@@ -52,9 +60,9 @@ static uint8 *Vpbuf     = NULL;
    Current implementation: all strings inputs converted to uppercase.
    tokens must be separated by COMMAs.
 
-   Tokens are stored in static area sym , and pointers are returned
-   to calling routine. Hence, tokens must be used before next call
-   to scanattrs.
+   Tokens are stored in the calling thread's area sym , and pointers are
+   returned to calling routine. Hence, tokens must be used before the
+   thread's next call to scanattrs.
 
  RETURNS
     Returns SUCCEED/FAIL
@@ -63,19 +71,26 @@ static uint8 *Vpbuf     = NULL;
 int32
 scanattrs(const char *attrs, int32 *attrc, char ***attrv)
 {
-    char  *s, *s0, *ss;
-    int    len;
-    size_t slen = strlen(attrs) + 1;
-
-    if (slen > Vpbufsize) {
-        Vpbufsize = (uint32)slen;
-        free(Vpbuf);
-        if ((Vpbuf = (uint8 *)malloc(Vpbufsize)) == NULL)
+    char      *s, *s0, *ss;
+    int        len;
+    int        nsym;
+    size_t     slen = strlen(attrs) + 1;
+    VPstate_t *st;
+
+    if ((st = (VPstate_t *)HTSlocal(HTS_VP_BUF, sizeof(VPstate_t), VPIfree_state)) == NULL)
+        HRETURN_ERROR(DFE_NOSPACE, FAIL);
+
+    if (slen > st->Vpbufsize) {
+        st->Vpbufsize = (uint32)slen;
+        free(st->Vpbuf);
+        if ((st->Vpbuf = (uint8 *)malloc(st->Vpbufsize)) == NULL) {
+            st->Vpbufsize = 0;
             HRETURN_ERROR(DFE_NOSPACE, FAIL);
+        }
     }
 
-    strcpy((char *)Vpbuf, attrs);
-    s    = (char *)Vpbuf;
+    strcpy((char *)st->Vpbuf, attrs);
+    s    = (char *)st->Vpbuf;
     nsym = 0;
 
     s0 = s;
@@ -94,7 +109,7 @@ scanattrs(const char *attrs, int32 *attrc, char ***attrv)
                 return FAIL;
 
             /* save that token */
-            ss = symptr[nsym] = sym[nsym];
+            ss = st->symptr[nsym] = st->sym[nsym];
             nsym++;
 
             /* shove the string into our static buffer.  YUCK! */
@@ -123,16 +138,16 @@ scanattrs(const char *attrs, int32 *attrc, char ***attrv)
     len = (int)(s - s0);
     if (len <= 0)
         return FAIL;
-    ss = symptr[nsym] = sym[nsym];
+    ss = st->symptr[nsym] = st->sym[nsym];
     nsym++;
 
     if (len > FIELDNAMELENMAX)
         len = FIELDNAMELENMAX;
     HIstrncpy(ss, s0, len + 1);
 
-    symptr[nsym] = NULL;
-    *attrc       = nsym;
-    *attrv       = (char **)symptr;
+    st->symptr[nsym] = NULL;
+    *attrc           = nsym;
+    *attrv           = (char **)st->symptr;
 
     return SUCCEED; /* ok */
 } /* scanattrs */
@@ -153,11 +168,7 @@ scanattrs(const char *attrs, int32 *attrc, char ***attrv)
 int
 VPparse_shutdown(void)
 {
-    if (Vpbuf != NULL) {
-        free(Vpbuf);
-        Vpbuf     = NULL;
-        Vpbufsize = 0;
-    }
+    HTSfree_local(HTS_VP_BUF);
 
     return SUCCEED;
 } /* end VSPhshutdown() */
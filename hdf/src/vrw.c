@@ -20,6 +20,10 @@
 
 LOCAL ROUTINES
  VSPshutdown  --  Free the Vtbuf buffer.
+ VSIisplain   --  Checks whether records are read as they're stored.
+ VSIget_plan  --  Compiles the plan for moving the records VSread reads.
+ VSIrun_plan  --  Moves records read into the user's buffer by a plan.
+ VSIrelease_buf -- Frees the Vtbuf buffer if it's larger than the limit.
 
 EXPORTED ROUTINES
  VSseek  -- Seeks to an element boundary within a vdata i.e. 2nd element.
@@ -28,6 +32,8 @@ EXPORTED ROUTINES
  VSwrite -- Writes a specified number of elements' worth of data to a vdata.
              You must specify how your data in your buffer is interlaced.
              Creates an aid, and writes it out if this is the first time.
+ VSsetscratchmax -- Sets the largest Vtbuf buffer kept between calls.
+ VSgetscratchmax -- Gets the largest Vtbuf buffer kept between calls.
 
  NOTE: Another pass needs to made through this file to update some of
        the comments about certain sections of the code. -GV 9/8/97
@@ -35,14 +41,52 @@ EXPORTED ROUTINES
 ************************************************************************/
 
 #include "hdf_priv.h"
+#include "hconv_priv.h"
+#include "hthread_priv.h"
 #include "vg_priv.h"
 
 #ifndef MIN
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #endif /* MIN */
 
-static uint32 Vtbufsize = 0;
-static uint8 *Vtbuf     = NULL;
+/* How a run of items of each record is moved */
+typedef enum {
+    VS_RUN_BLOCK,   /* contiguous in both buffers; all records at once */
+    VS_RUN_STRIDED, /* converted an item of each record at a time */
+    VS_RUN_RECORD   /* copied or swapped a record at a time */
+} VSrun_t;
+
+/* One run of items of a record, from one or more adjacent fields moved the
+   same way: copied, swapped or, when swap is -1, converted by DFKconvert.
+   The run of record i starts base * nrecords + off + i * stride bytes into
+   its buffer, nrecords being the # of records in the buffer */
+typedef struct {
+    VSrun_t how;        /* how the run is moved */
+    int     swap;       /* size of the items swapped, 0 to copy them, or -1 */
+    int32   type;       /* number type of the items */
+    uint32  nitems;     /* # of items in the run of each record */
+    size_t  src_len;    /* # of bytes of the run in Vtbuf */
+    size_t  src_base;   /* offset of the field's array in Vtbuf / nrecords */
+    size_t  src_off;    /* offset of the run in a record in Vtbuf */
+    size_t  src_stride; /* # of bytes between the runs of two records */
+    size_t  dst_len;    /* # of bytes of the run in the user's buffer */
+    size_t  dst_base;   /* offset of the field's array in it / nrecords */
+    size_t  dst_off;    /* offset of the run in a record in it */
+    size_t  dst_stride; /* # of bytes between the runs of two records */
+} VSplanrun_t;
+
+/* The plan for moving the records of the fields set with VSsetfields from
+   Vtbuf into the user's buffer, kept in the vdata until the fields change */
+typedef struct vs_plan_struct {
+    int32       interlace; /* interlace of the user's buffer */
+    size_t      uvsize;    /* size of a record in the user's buffer */
+    int         nruns;     /* # of runs in runs */
+    int         nrecruns;  /* # of them moved a record at a time */
+    VSplanrun_t runs[];
+} VSplan_t;
+
+/* Largest record buffer kept between calls, set by VSsetscratchmax */
+static int32 vs_scratchmax = VDATA_SCRATCH_MAX;
 
 /*******************************************************************************
  NAME
@@ -62,12 +106,8 @@ VSPshutdown(void)
 {
     int ret_value = SUCCEED;
 
-    /* free global buffers */
-    if (Vtbuf != NULL) {
-        free(Vtbuf);
-        Vtbuf     = NULL;
-        Vtbufsize = 0;
-    }
+    /* free this thread's record buffer */
+    HTSfree_local(HTS_VT_BUF);
 
     /* Clear the local buffers in vio.c */
     ret_value = VSPhshutdown();
@@ -75,6 +115,22 @@ VSPshutdown(void)
     return ret_value;
 } /* end VSPshutdown() */
 
+/*******************************************************************************
+ NAME
+    VSIrelease_buf  --  Free the Vtbuf buffer if it's larger than the limit.
+
+ DESCRIPTION
+    Called when VSread and VSwrite are done with this thread's Vtbuf, so
+    that a buffer grown for a large request isn't kept for the life of
+    the thread.
+
+*******************************************************************************/
+static void
+VSIrelease_buf(void)
+{
+    HTSrelease_buf(HTS_VT_BUF, (size_t)HTS_GET_SETTING(vs_scratchmax));
+} /* VSIrelease_buf */
+
 /*******************************************************************************
 NAME
    VSseek
@@ -134,6 +190,213 @@ done:
     return ret_value;
 } /* VSseek */
 
+/*******************************************************************************
+NAME
+   VSIisplain
+
+DESCRIPTION
+   Checks whether the records of a vdata are returned exactly as they are
+   stored, i.e., the fields being read are all of the vdata's fields, in
+   order, and their number types need no conversion.
+
+RETURNS
+   TRUE/FALSE
+
+*******************************************************************************/
+static int
+VSIisplain(const DYN_VWRITELIST *w, const DYN_VREADLIST *r)
+{
+    if (r->n != w->n)
+        return FALSE;
+    for (int j = 0; j < r->n; j++)
+        if (r->item[j] != j || w->isize[j] != w->esize[j] || !DFKIiscopyNT((int32)w->type[j]))
+            return FALSE;
+    return TRUE;
+} /* VSIisplain */
+
+/*******************************************************************************
+NAME
+   VSIget_plan
+
+DESCRIPTION
+   Gets the plan for moving the records of the fields being read from a
+   vdata from Vtbuf into the user's buffer with the given interlace,
+   compiling it if the vdata doesn't have one for them.
+
+   Each field being read is a run of items in each record.  Runs which
+   follow each other in both buffers and are moved the same way, copied
+   or swapped, are merged into one.  A run which then covers whole records
+   in both buffers is moved for all of the records at once, with the
+   vector kernels of DFKconvert; the other copied and swapped runs are
+   moved together, a record at a time, in one pass over the buffers.  Runs
+   converted some other way are converted an item of each record at a
+   time, as the number conversion routines handle strides.
+
+RETURNS
+   The plan, or NULL if it can't be allocated.
+
+*******************************************************************************/
+static VSplan_t *
+VSIget_plan(VDATA *vs, int32 interlace)
+{
+    DYN_VWRITELIST *w = &vs->wlist;
+    DYN_VREADLIST  *r = &vs->rlist;
+    VSplan_t       *plan;
+    int             nitems;
+    size_t          hsize = w->ivsize;
+    size_t          uoff  = 0; /* offset of the next field in the user's record */
+
+    if (vs->rplan != NULL && vs->rplan->interlace == interlace)
+        return vs->rplan;
+    free(vs->rplan);
+    vs->rplan = NULL;
+
+    /* A vdata's only field is read even without VSsetfields, as always */
+    nitems = (r->n == 0 && w->n == 1) ? 1 : r->n;
+
+    if ((plan = (VSplan_t *)malloc(sizeof(VSplan_t) + (size_t)nitems * sizeof(VSplanrun_t))) == NULL)
+        return NULL;
+    plan->interlace = interlace;
+    plan->nruns     = 0;
+    plan->nrecruns  = 0;
+
+    for (int j = 0; j < nitems; j++)
+        uoff += w->esize[r->n == 0 ? 0 : r->item[j]];
+    plan->uvsize = uoff;
+
+    uoff = 0;
+    for (int j = 0; j < nitems; j++) {
+        int          i    = r->n == 0 ? 0 : r->item[j];
+        VSplanrun_t  run;
+        VSplanrun_t *prev = plan->nruns > 0 ? &plan->runs[plan->nruns - 1] : NULL;
+
+        run.type    = (int32)w->type[i];
+        run.nitems  = w->order[i];
+        run.src_len = w->isize[i];
+        run.dst_len = w->esize[i];
+        if (run.src_len != run.dst_len)
+            run.swap = -1;
+        else if (DFKIiscopyNT(run.type))
+            run.swap = 0;
+        else if ((run.swap = DFKIswapsizeNT(run.type)) == 0)
+            run.swap = -1;
+
+        /* Where the field is in Vtbuf */
+        if (vs->interlace == FULL_INTERLACE) {
+            run.src_base   = 0;
+            run.src_off    = w->off[i];
+            run.src_stride = hsize;
+        }
+        else {
+            run.src_base   = w->off[i];
+            run.src_off    = 0;
+            run.src_stride = run.src_len;
+        }
+
+        /* and in the user's buffer */
+        if (interlace == FULL_INTERLACE) {
+            run.dst_base   = 0;
+            run.dst_off    = uoff;
+            run.dst_stride = plan->uvsize;
+        }
+        else {
+            run.dst_base   = uoff;
+            run.dst_off    = 0;
+            run.dst_stride = run.dst_len;
+        }
+        uoff += run.dst_len;
+
+        /* Merge the run into the one before it if it follows it in both
+           buffers and is moved the same way */
+        if (prev != NULL && run.swap >= 0 && prev->swap == run.swap && prev->src_base == run.src_base &&
+            prev->src_stride == run.src_stride && prev->src_off + prev->src_len == run.src_off &&
+            prev->dst_base == run.dst_base && prev->dst_stride == run.dst_stride &&
+            prev->dst_off + prev->dst_len == run.dst_off) {
+            prev->nitems += run.nitems;
+            prev->src_len += run.src_len;
+            prev->dst_len += run.dst_len;
+        }
+        else
+            plan->runs[plan->nruns++] = run;
+    }
+
+    for (int k = 0; k < plan->nruns; k++) {
+        VSplanrun_t *run = &plan->runs[k];
+
+        if (run->src_stride == run->src_len && run->dst_stride == run->dst_len)
+            run->how = VS_RUN_BLOCK;
+        else if (run->swap < 0)
+            run->how = VS_RUN_STRIDED;
+        else {
+            run->how = VS_RUN_RECORD;
+            plan->nrecruns++;
+        }
+    }
+
+    vs->rplan = plan;
+    return plan;
+} /* VSIget_plan */
+
+/*******************************************************************************
+NAME
+   VSIrun_plan
+
+DESCRIPTION
+   Moves nrec records from Vtbuf into the user's buffer by a plan compiled
+   by VSIget_plan.
+
+*******************************************************************************/
+static void
+VSIrun_plan(const VSplan_t *plan, uint8 *src, uint8 *dest, int32 nrec)
+{
+    size_t n = (size_t)nrec;
+
+    if (nrec <= 0)
+        return;
+
+    for (int k = 0; k < plan->nruns; k++) {
+        const VSplanrun_t *run = &plan->runs[k];
+        uint8             *s   = src + run->src_base * n + run->src_off;
+        uint8             *d   = dest + run->dst_base * n + run->dst_off;
+
+        if (run->how == VS_RUN_BLOCK) {
+            if (run->swap == 0)
+                memcpy(d, s, run->src_len * n);
+            else if (run->swap > 0)
+                DFKIswap(s, d, run->nitems * n, run->swap);
+            else
+                DFKconvert(s, d, run->type, (int32)(run->nitems * n), DFACC_READ, 0, 0);
+        }
+        else if (run->how == VS_RUN_STRIDED) {
+            size_t isize = run->src_len / run->nitems;
+            size_t esize = run->dst_len / run->nitems;
+
+            for (uint32 c = 0; c < run->nitems; c++)
+                DFKconvert(s + c * isize, d + c * esize, run->type, nrec, DFACC_READ, (int32)run->src_stride,
+                           (int32)run->dst_stride);
+        }
+    }
+
+    /* Move the rest of the runs a record at a time */
+    if (plan->nrecruns == 0)
+        return;
+    for (size_t i = 0; i < n; i++)
+        for (int k = 0; k < plan->nruns; k++) {
+            const VSplanrun_t *run = &plan->runs[k];
+            const uint8       *s;
+            uint8             *d;
+
+            if (run->how != VS_RUN_RECORD)
+                continue;
+            s = src + run->src_base * n + run->src_off + i * run->src_stride;
+            d = dest + run->dst_base * n + run->dst_off + i * run->dst_stride;
+            if (run->swap == 0)
+                memcpy(d, s, run->src_len);
+            else
+                DFKIswap(s, d, run->nitems, run->swap);
+        }
+} /* VSIrun_plan */
+
 /*******************************************************************************
 NAME
    VSread
@@ -153,23 +416,15 @@ VSread(int32 vkey,  /* IN: vdata key */
        int32 nelt,  /* IN: number of elements to read */
        int32 interlace /* IN: interlace to return elements in 'buf' */)
 {
-    int             isize = 0;
-    int             order = 0;
-    int             index = 0;
-    int             esize = 0;
     int             hsize = 0;
     uint8          *Src;
-    uint8          *b1 = NULL;
-    uint8          *b2 = NULL;
-    int32           i, j;
     int32           nv;
-    int32           offset;
-    int32           type;
-    int32           uvsize;      /* size of "element" as NEEDED by user */
     int32           total_bytes; /* total number of bytes that need to be read in */
     int32           bytes;       /* number of elements / bytes to read next time */
     int32           chunk;       /* number of records in a buffer */
     int32           done;        /* number of records to do / done */
+    uint8          *Vtbuf     = NULL; /* this thread's record buffer */
+    VSplan_t       *plan      = NULL; /* how to move the records into buf */
     DYN_VWRITELIST *w         = NULL;
     DYN_VREADLIST  *r         = NULL;
     vsinstance_t   *wi        = NULL;
@@ -217,10 +472,11 @@ VSread(int32 vkey,  /* IN: vdata key */
     /*
        Now, convert and repack field(s) from Vtbuf into buf.
 
-       This section of the code deals with interlacing. In all cases
-       the items for each of the fields are converted and shuffled
-       around from the internal buffer "Vtbuf" to the user's buffer
-       "buf".
+       The records are read into the internal buffer "Vtbuf", then the
+       items of each of the fields are converted and shuffled around into
+       the user's buffer "buf" by the vdata's read plan (see VSIget_plan),
+       which is compiled for the fields set with VSsetfields and the
+       interlace of "buf".
 
        There are 5 cases :
        (A) user=NO_INTERLACE   & vdata=FULL_INTERLACE)
@@ -229,9 +485,6 @@ VSread(int32 vkey,  /* IN: vdata key */
        (D) user=FULL_INTERLACE & vadat=NO_INTERLACE)
        (E) SPECIAL CASE when only one field.
 
-       Cases (A)-(D) handles multiple fields.
-       Case (E) handles reading from a Vdata with a single field.
-
        Cases (E) and (C) are the most frequently used.  Limit buffer
        allocations to VDATA_BUFFER_MAX size so that we conserve
        memory.  Doing this involves a certain degree of added code
@@ -244,29 +497,34 @@ VSread(int32 vkey,  /* IN: vdata key */
     /* ----------------------------------------------------------------- */
     /* CASE  (E + C): Easy to unroll case */
     if ((w->n == 1) || (interlace == FULL_INTERLACE && vs->interlace == FULL_INTERLACE)) {
+        /* records which need no conversion or shuffling are read straight
+           into the user's buffer */
+        if (nelt > 0 && VSIisplain(w, r)) {
+            if ((nv = Hread(vs->aid, total_bytes, buf)) != total_bytes) {
+                HERROR(DFE_READERROR);
+                HEreport("Tried to read %d, only read %d", total_bytes, nv);
+                HGOTO_DONE(FAIL);
+            }
+            HGOTO_DONE(nelt);
+        }
+
+        if ((plan = VSIget_plan(vs, interlace)) == NULL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
+
         /*
          * figure out how many elements we can move at a time and
          * make sure our buffer is big enough
          */
 
-        if ((uint32)total_bytes < Vtbufsize) {
+        /* we are bounded above by VDATA_BUFFER_MAX, but make sure there is
+           at least room for one record in our buffer */
+        chunk = MIN(total_bytes, VDATA_BUFFER_MAX) / hsize + 1;
+        if (chunk > nelt)
             chunk = nelt;
-        }
-        else {
-            int32 buf_size;
-
-            /* we are bounded above by VDATA_BUFFER_MAX */
-            buf_size = MIN(total_bytes, VDATA_BUFFER_MAX);
 
-            /* make sure there is at least room for one record in our buffer */
-            chunk = buf_size / hsize + 1;
-
-            /* get a buffer big enough to hold the values */
-            Vtbufsize = (uint32)(chunk * hsize);
-            free(Vtbuf);
-            if ((Vtbuf = (uint8 *)malloc(Vtbufsize)) == NULL)
-                HGOTO_ERROR(DFE_NOSPACE, FAIL);
-        }
+        /* get this thread's buffer, big enough to hold the values */
+        if ((Vtbuf = HTSget_buf(HTS_VT_BUF, (size_t)chunk * (size_t)hsize)) == NULL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
         done = 0;
 
@@ -274,9 +532,6 @@ VSread(int32 vkey,  /* IN: vdata key */
         Src   = buf;
         bytes = hsize * chunk;
 
-        for (uvsize = 0, j = 0; j < r->n; j++)
-            uvsize += w->esize[r->item[j]];
-
         while (done < nelt) {
 
             /* chunk has changed so update the byte counts */
@@ -292,52 +547,27 @@ VSread(int32 vkey,  /* IN: vdata key */
                 HGOTO_DONE(FAIL);
             }
 
-            /* CASE  (E): Only a single field in the Vdata */
-            if (w->n == 1) {
-                DFKconvert(Vtbuf, Src, w->type[0], (int32)w->order[0] * chunk, DFACC_READ, 0, 0);
-            } /* case (e) */
-            /* ----------------------------------------------------------------- */
-            /* CASE  (C):  iu=full, iv=full */
-            else {
-                offset = 0;
-                for (j = 0; j < r->n; j++) {
-                    i     = r->item[j];
-                    b1    = Src + offset;
-                    b2    = Vtbuf + (size_t)w->off[i];
-                    type  = (int32)w->type[r->item[j]];
-                    esize = (int)w->esize[i];
-                    isize = (int)w->isize[i];
-                    order = (int)w->order[i];
-
-                    for (index = 0; index < order; index++) {
-                        DFKconvert(b2, b1, type, chunk, DFACC_READ, hsize, uvsize);
-                        b1 += (int)esize / order;
-                        b2 += (int)isize / order;
-                    }
-                    offset += esize;
-                }
-            } /* case (E) */
+            VSIrun_plan(plan, Vtbuf, Src, chunk);
 
             /* record what we've done and move to next group */
             done += chunk;
-            Src += chunk * uvsize;
+            Src += (size_t)chunk * plan->uvsize;
         } /* end while */
     }     /* case (C + E) */
     else {
         /*
-         * Handle the other cases now.
+         * Handle the other cases (A, B and D) now.
          * These cases are less frequent so don't bother unrolling
          *   the loops for now.  As a result, we may get into memory
          *   problems since we may end up allocating a huge buffer
          */
 
+        if ((plan = VSIget_plan(vs, interlace)) == NULL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
+
         /* alloc space (Vtbuf) for reading in the raw data from vdata */
-        if (Vtbufsize < (size_t)nelt * (size_t)hsize) {
-            Vtbufsize = (uint32)(nelt * hsize);
-            free(Vtbuf);
-            if ((Vtbuf = (uint8 *)malloc(Vtbufsize)) == NULL)
-                HGOTO_ERROR(DFE_NOSPACE, FAIL);
-        }
+        if ((Vtbuf = HTSget_buf(HTS_VT_BUF, (size_t)nelt * (size_t)hsize)) == NULL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
         /* ================ start reading ============================== */
 
@@ -349,78 +579,15 @@ VSread(int32 vkey,  /* IN: vdata key */
             HGOTO_DONE(FAIL);
         }
 
-        /* ----------------------------------------------------------------- */
-        /* CASE  (A):  user=none, vdata=full */
-        if (interlace == NO_INTERLACE && vs->interlace == FULL_INTERLACE) {
-            b1 = buf;
-            for (j = 0; j < r->n; j++) {
-                i     = r->item[j];
-                b2    = Vtbuf + (size_t)w->off[i];
-                type  = (int32)w->type[i];
-                isize = (int)w->isize[i];
-                esize = (int)w->esize[i];
-                order = (int)w->order[i];
-
-                for (index = 0; index < order; index++) {
-                    DFKconvert(b2, b1, type, nelt, DFACC_READ, hsize, esize);
-                    b2 += isize / order;
-                    b1 += esize / order;
-                }
-                b1 += ((nelt - 1) * esize);
-            }
-        } /* case (a) */
-
-        /* ----------------------------------------------------------------- */
-        /* CASE  (B):  user=none, vdata=none */
-        else if (interlace == NO_INTERLACE && vs->interlace == NO_INTERLACE) {
-            b1 = buf;
-            for (j = 0; j < r->n; j++) {
-                i     = r->item[j];
-                b2    = Vtbuf + (size_t)w->off[i] * (size_t)nelt;
-                type  = (int32)w->type[i];
-                esize = (int)w->esize[i];
-                isize = (int)w->isize[i];
-                order = (int)w->order[i];
-
-                for (index = 0; index < order; index++) {
-                    DFKconvert(b2, b1, type, nelt, DFACC_READ, isize, esize);
-                    b1 += esize / order;
-                    b2 += isize / order;
-                }
-                b1 += ((nelt - 1) * esize);
-            }
-        } /* case (b) */
-
-        /* ----------------------------------------------------------------- */
-        /* CASE  (D):  user=full, vdata=none */
-        else if (interlace == FULL_INTERLACE && vs->interlace == NO_INTERLACE) {
-
-            for (uvsize = 0, j = 0; j < r->n; j++)
-                uvsize += w->esize[r->item[j]];
-
-            offset = 0;
-            for (j = 0; j < r->n; j++) {
-                i     = r->item[j];
-                b1    = buf + offset;
-                b2    = Vtbuf + (size_t)w->off[i] * (size_t)nelt;
-                type  = (int32)w->type[i];
-                isize = (int)w->isize[i];
-                esize = (int)w->esize[i];
-                order = (int)w->order[i];
-
-                for (index = 0; index < order; index++) {
-                    DFKconvert(b2, b1, type, nelt, DFACC_READ, isize, uvsize);
-                    b1 += esize / order;
-                    b2 += isize / order;
-                }
-                offset += isize;
-            }
-        } /* case (d) */
-    }     /* end else, cases a, b, and d */
+        VSIrun_plan(plan, Vtbuf, buf, nelt);
+    } /* end else, cases a, b, and d */
 
     ret_value = (nelt);
 
 done:
+    if (Vtbuf != NULL)
+        VSIrelease_buf();
+
     return ret_value;
 } /* VSread */
 
@@ -467,7 +634,8 @@ VSwrite(int32       vkey,  /* IN: vdata key */
     VDATA          *vs       = NULL;
     int32           bytes; /* number of elements / bytes to write next time */
     int32           chunk;
-    int32           done; /* number of records to do / done */
+    int32           done;          /* number of records to do / done */
+    uint8          *Vtbuf = NULL; /* this thread's record buffer */
     int32           ret_value = SUCCEED;
 
     /* clear error stack */
@@ -559,24 +727,15 @@ VSwrite(int32       vkey,  /* IN: vdata key */
          * make sure our buffer is big enough
          */
 
-        if ((uint32)total_bytes < Vtbufsize) {
+        /* we are bounded above by VDATA_BUFFER_MAX, but make sure there is
+           at least room for one record in our buffer */
+        chunk = MIN(total_bytes, VDATA_BUFFER_MAX) / hdf_size + 1;
+        if (chunk > nelt)
             chunk = nelt;
-        }
-        else {
-            int32 buf_size;
-
-            /* we are bounded above by VDATA_BUFFER_MAX */
-            buf_size = MIN(total_bytes, VDATA_BUFFER_MAX);
 
-            /* make sure there is at least room for one record in our buffer */
-            chunk = buf_size / hdf_size + 1;
-
-            /* get a buffer big enough to hold the values */
-            Vtbufsize = (uint32)(chunk * hdf_size);
-            free(Vtbuf);
-            if ((Vtbuf = (uint8 *)malloc(Vtbufsize)) == NULL)
-                HGOTO_ERROR(DFE_NOSPACE, FAIL);
-        }
+        /* get this thread's buffer, big enough to hold the values */
+        if ((Vtbuf = HTSget_buf(HTS_VT_BUF, (size_t)chunk * (size_t)hdf_size)) == NULL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
         done = 0;
 
@@ -641,12 +800,8 @@ VSwrite(int32       vkey,  /* IN: vdata key */
          */
 
         /* alloc space (Vtbuf) for writing out the data */
-        if (Vtbufsize < (uint32)total_bytes) {
-            Vtbufsize = (uint32)total_bytes;
-            free(Vtbuf);
-            if ((Vtbuf = (uint8 *)malloc(Vtbufsize)) == NULL)
-                HGOTO_ERROR(DFE_NOSPACE, FAIL);
-        }
+        if ((Vtbuf = HTSget_buf(HTS_VT_BUF, (size_t)total_bytes)) == NULL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
 
         /* ----------------------------------------------------------------- */
         /* CASE  (A):  user=none, vdata=full */
@@ -745,5 +900,72 @@ VSwrite(int32       vkey,  /* IN: vdata key */
     ret_value = (nelt);
 
 done:
+    if (Vtbuf != NULL)
+        VSIrelease_buf();
+
     return ret_value;
 } /* VSwrite */
+
+/*******************************************************************************
+NAME
+   VSsetscratchmax
+
+DESCRIPTION
+   Sets the size of the largest record buffer VSread and VSwrite keep
+   between calls.  Each thread has its own buffer, which grows to hold the
+   records of the largest request it has made; once a call is done with a
+   buffer larger than nbytes, the buffer is freed.  Full interlaced reads
+   and writes use buffers of about VDATA_BUFFER_MAX bytes at most, other
+   requests ones large enough for all of their records.  A limit of 0
+   frees the buffer after every call.  The default is VDATA_SCRATCH_MAX.
+
+RETURNS
+   RETURNS SUCCEED/FAIL
+
+*******************************************************************************/
+int
+VSsetscratchmax(int32 nbytes /* IN: largest buffer to keep, in bytes */)
+{
+    int ret_value = SUCCEED;
+
+    HEclear();
+
+    if (nbytes < 0)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    HTS_SET_SETTING(vs_scratchmax, nbytes);
+
+    /* Apply the limit to this thread's buffer now */
+    HTSrelease_buf(HTS_VT_BUF, (size_t)nbytes);
+
+done:
+    return ret_value;
+} /* VSsetscratchmax */
+
+/*******************************************************************************
+NAME
+   VSgetscratchmax
+
+DESCRIPTION
+   Gets the size of the largest record buffer VSread and VSwrite keep
+   between calls.
+
+RETURNS
+   RETURNS SUCCEED/FAIL
+
+*******************************************************************************/
+int
+VSgetscratchmax(int32 *nbytes /* OUT: limit set by VSsetscratchmax */)
+{
+    int ret_value = SUCCEED;
+
+    HEclear();
+
+    if (nbytes == NULL)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    *nbytes = HTS_GET_SETTING(vs_scratchmax);
+
+done:
+    return ret_value;
+} /* VSgetscratchmax */
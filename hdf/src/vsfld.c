@@ -222,6 +222,10 @@ VSsetfields(int32 vkey, const char *fields)
         free(rlist->item);
         rlist->item = NULL;
 
+        /* VSread compiles a new plan for the new fields */
+        free(vs->rplan);
+        vs->rplan = NULL;
+
         /* Allocate enough space for the read list */
         if ((rlist->item = (int *)malloc(sizeof(int) * (size_t)(ac))) == NULL)
             HGOTO_ERROR(DFE_NOSPACE, FAIL);
@@ -82,13 +82,18 @@ set (HDF4_TESTHDF_FILES
     tdf24.hdf
     tdfan.hdf
     temp.hdf
+    tfindnames.hdf
     thf.hdf
     tjpeg.hdf
+    tlazy.dat
+    tlazy.hdf
     tlongnames.hdf
     tman.hdf
     tmgr.hdf
     tmgratt.hdf
     tmgrchk.hdf
+    tmgrname.hdf
+    tmgrstage.hdf
     tnbit.hdf
     tref.hdf
     tuservds.hdf
@@ -98,7 +103,10 @@ set (HDF4_TESTHDF_FILES
     tvsempty.hdf
     tvset.hdf
     tvsetext.hdf
+    tvsnative.hdf
+    tvsplan.hdf
     tx.hdf
+    txpool.hdf
     Tables_External_File
 )
 add_test (
@@ -44,6 +44,10 @@
 #define BITIO_REF_2 2500
 #define BITIO_TAG_3 3500
 #define BITIO_REF_3 3500
+#define BITIO_TAG_4 4500
+#define BITIO_REF_4 4500
+
+#define NUM_VALUES 1000
 
 static uint8 *outbuf = NULL;
 static uint8 *inbuf  = NULL;
@@ -62,6 +66,7 @@ static uint32 maskbuf[] = {0x00000000,   0x00000001,   0x00000003,  0x00000007,
 static void test_bitio_write(void);
 static void test_bitio_read(void);
 static void test_bitio_seek(void);
+static void test_bitio_array(void);
 
 static void
 test_bitio_write(void)
@@ -375,6 +380,77 @@ test_bitio_seek(void)
     RESULT("Hclose");
 } /* test_bitio_seek() */
 
+static void
+test_bitio_array(void)
+{
+    static const int widths[] = {1, 3, 7, 8, 13, 24, 31, 32};
+    int32            fid;
+    int32            bitid1;
+    int32            ret;
+    uint32           lead, val;
+    int              w, i;
+
+    MESSAGE(6, printf("Testing bitio array routines\n"););
+    for (i = 0; i < NUM_VALUES; i++)
+        outbuf2[i] = ((uint32)RAND() << 16) ^ (uint32)RAND();
+
+    fid = Hopen(TESTFILE_NAME, DFACC_RDWR, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    /* each array of values starts part way through a byte */
+    bitid1 = Hstartbitwrite(fid, BITIO_TAG_4, BITIO_REF_4, 16);
+    CHECK_VOID(bitid1, FAIL, "Hstartbitwrite");
+    ret = Hbitappendable(bitid1);
+    RESULT("Hbitappendable");
+    for (w = 0; w < (int)(sizeof(widths) / sizeof(widths[0])); w++) {
+        ret = Hbitwrite(bitid1, 5, (uint32)w);
+        VERIFY_VOID(ret, 5, "Hbitwrite");
+        ret = Hbitwrite_n(bitid1, widths[w], NUM_VALUES, outbuf2);
+        VERIFY_VOID(ret, NUM_VALUES, "Hbitwrite_n");
+    }
+    ret = Hendbitaccess(bitid1, 0);
+    RESULT("Hendbitaccess");
+
+    /* read the values back in two uneven parts, with single values between */
+    bitid1 = Hstartbitread(fid, BITIO_TAG_4, BITIO_REF_4);
+    CHECK_VOID(bitid1, FAIL, "Hstartbitread");
+    for (w = 0; w < (int)(sizeof(widths) / sizeof(widths[0])); w++) {
+        ret = Hbitread(bitid1, 5, &lead);
+        VERIFY_VOID(ret, 5, "Hbitread");
+        VERIFY_VOID(lead, (uint32)w, "Hbitread");
+        ret = Hbitread_n(bitid1, widths[w], 333, inbuf2);
+        VERIFY_VOID(ret, 333, "Hbitread_n");
+        ret = Hbitread(bitid1, widths[w], &inbuf2[333]);
+        VERIFY_VOID(ret, widths[w], "Hbitread");
+        ret = Hbitread_n(bitid1, widths[w], NUM_VALUES - 334, &inbuf2[334]);
+        VERIFY_VOID(ret, NUM_VALUES - 334, "Hbitread_n");
+        for (i = 0; i < NUM_VALUES; i++) {
+            val = outbuf2[i] & maskbuf[widths[w]];
+            if (inbuf2[i] != val) {
+                printf("Error reading %d-bit value %d: wrote %lu, read %lu\n", widths[w], i,
+                       (unsigned long)val, (unsigned long)inbuf2[i]);
+                num_errs++;
+                break;
+            }
+        }
+    }
+
+    /* reading stops at the end of the element, which is less than a
+       buffer past the last value */
+    ret = Hbitread_n(bitid1, 32, 2 * NUM_VALUES, inbuf2);
+    CHECK_VOID(ret, FAIL, "Hbitread_n");
+    if (ret >= 2 * NUM_VALUES) {
+        printf("Hbitread_n read %d values past the end of the element\n", (int)ret);
+        num_errs++;
+    }
+
+    ret = Hendbitaccess(bitid1, 0);
+    RESULT("Hendbitaccess");
+
+    ret = Hclose(fid);
+    RESULT("Hclose");
+} /* test_bitio_array() */
+
 void
 test_bitio(void)
 {
@@ -393,6 +469,7 @@ test_bitio(void)
     test_bitio_read();
     test_bitio_write();
     test_bitio_seek();
+    test_bitio_array();
 
     free(outbuf);
     free(inbuf);
@@ -19,9 +19,232 @@
 
 #define HLCONVERT_TAG 1500
 
+/* Elements appended to a block at a time, for the block run test */
+#define RUN_TAG     1600
+#define RUN_NELTS   2
+#define RUN_BLKLEN  100
+#define RUN_NBLOCKS 40
+
+/* Linked-block element whose blocks' DDs come after objects filling the
+   first DD blocks, for the lazy DD list test */
+#define LAZY_TAG     1700
+#define LAZY_NDDS    16
+#define LAZY_FILLERS 40
+#define LAZY_BLKLEN  10
+#define LAZY_NBLOCKS 100
+
 static uint8 *outbuf = NULL;
 static uint8 *inbuf  = NULL;
 
+/* Appends to several linked-block elements a block at a time, in turn, and
+   checks that the blocks of each element are mostly next to each other in
+   the file and read back correctly through each low-level driver */
+static void
+test_hblocks_runs(void)
+{
+    int    drivers[] = {DFDRV_STDIO, DFDRV_POSIX, DFDRV_MMAP};
+    int32  fid;
+    int32  aids[RUN_NELTS];
+    uint16 refs[RUN_NELTS];
+    int32  offsets[RUN_NBLOCKS], lengths[RUN_NBLOCKS];
+    uint8 *data = NULL;
+    uint8 *buf  = NULL;
+    int32  ret;
+    int    errors = 0;
+
+    MESSAGE(5, printf("Appending to linked blocks a block at a time\n"););
+
+    data = (uint8 *)malloc(RUN_NELTS * RUN_NBLOCKS * RUN_BLKLEN);
+    buf  = (uint8 *)malloc(RUN_NBLOCKS * RUN_BLKLEN);
+    CHECK_ALLOC(data, "data", "test_hblocks_runs");
+    CHECK_ALLOC(buf, "buf", "test_hblocks_runs");
+    for (int i = 0; i < RUN_NELTS * RUN_NBLOCKS * RUN_BLKLEN; i++)
+        data[i] = (uint8)(i % 251);
+
+    fid = Hopen(TESTFILE_NAME, DFACC_RDWR, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    for (int e = 0; e < RUN_NELTS; e++) {
+        refs[e] = Hnewref(fid);
+        aids[e] = HLcreate(fid, RUN_TAG, refs[e], RUN_BLKLEN, 8);
+        CHECK_VOID(aids[e], FAIL, "HLcreate");
+    }
+
+    /* Write the elements' blocks in turn, so that without the runs their
+       blocks would alternate in the file */
+    for (int b = 0; b < RUN_NBLOCKS; b++)
+        for (int e = 0; e < RUN_NELTS; e++) {
+            ret = Hwrite(aids[e], RUN_BLKLEN, &data[(e * RUN_NBLOCKS + b) * RUN_BLKLEN]);
+            VERIFY_VOID(ret, RUN_BLKLEN, "Hwrite");
+        }
+
+    for (int e = 0; e < RUN_NELTS; e++) {
+        ret = Hendaccess(aids[e]);
+        CHECK_VOID(ret, FAIL, "Hendaccess");
+    }
+
+    for (int e = 0; e < RUN_NELTS; e++) {
+        int nbreaks = 0;
+        int n;
+
+        /* Runs of 1, 2, 4, 8, 16 and 32 blocks leave 5 breaks between them */
+        n = HDgetdatainfo(fid, RUN_TAG, refs[e], NULL, 0, RUN_NBLOCKS, offsets, lengths);
+        VERIFY_VOID(n, RUN_NBLOCKS, "HDgetdatainfo");
+        for (int b = 0; b + 1 < n; b++)
+            if (offsets[b] + lengths[b] != offsets[b + 1])
+                nbreaks++;
+        if (nbreaks > 5) {
+            fprintf(stderr, "ERROR: element %d has %d breaks between its blocks\n", e, nbreaks);
+            errors++;
+        }
+    }
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    /* Read the elements back through each low-level driver, since they read
+       the blocks of a run, and the holes between runs, differently */
+    for (int d = 0; d < (int)(sizeof(drivers) / sizeof(drivers[0])); d++) {
+        if (Hsetfiledriver(drivers[d]) == FAIL)
+            continue;
+
+        fid = Hopen(TESTFILE_NAME, DFACC_READ, 0);
+        CHECK_VOID(fid, FAIL, "Hopen");
+
+        for (int e = 0; e < RUN_NELTS; e++) {
+            int32 aid;
+
+            /* Read the whole element, then a piece starting and ending in
+               the middle of blocks */
+            aid = Hstartread(fid, RUN_TAG, refs[e]);
+            CHECK_VOID(aid, FAIL, "Hstartread");
+
+            memset(buf, 0, RUN_NBLOCKS * RUN_BLKLEN);
+            ret = Hread(aid, RUN_NBLOCKS * RUN_BLKLEN, buf);
+            VERIFY_VOID(ret, RUN_NBLOCKS * RUN_BLKLEN, "Hread");
+            if (memcmp(buf, &data[e * RUN_NBLOCKS * RUN_BLKLEN], RUN_NBLOCKS * RUN_BLKLEN) != 0) {
+                fprintf(stderr, "ERROR: wrong data read from element %d with driver %d\n", e, drivers[d]);
+                errors++;
+            }
+
+            ret = Hseek(aid, RUN_BLKLEN + 50, DF_START);
+            CHECK_VOID(ret, FAIL, "Hseek");
+            memset(buf, 0, RUN_NBLOCKS * RUN_BLKLEN);
+            ret = Hread(aid, 30 * RUN_BLKLEN, buf);
+            VERIFY_VOID(ret, 30 * RUN_BLKLEN, "Hread");
+            if (memcmp(buf, &data[e * RUN_NBLOCKS * RUN_BLKLEN + RUN_BLKLEN + 50], 30 * RUN_BLKLEN) != 0) {
+                fprintf(stderr, "ERROR: wrong data read from the middle of element %d with driver %d\n", e,
+                        drivers[d]);
+                errors++;
+            }
+
+            ret = Hendaccess(aid);
+            CHECK_VOID(ret, FAIL, "Hendaccess");
+        }
+
+        ret = Hclose(fid);
+        CHECK_VOID(ret, FAIL, "Hclose");
+    }
+    Hsetfiledriver(DFDRV_STDIO);
+
+    free(data);
+    free(buf);
+
+    num_errs += errors;
+}
+
+/* Reads a linked-block element back from a file whose DD list is read
+   lazily, when the DDs of most of its blocks haven't been read yet */
+static void
+test_hblocks_lazy(void)
+{
+    uint8 data[LAZY_NBLOCKS * LAZY_BLKLEN];
+    uint8 buf[LAZY_NBLOCKS * LAZY_BLKLEN];
+    int32 fid, aid;
+    int32 ret;
+    int   errors = 0;
+
+    MESSAGE(5, printf("Reading linked blocks with the DD list read lazily\n"););
+
+    for (int i = 0; i < LAZY_NBLOCKS * LAZY_BLKLEN; i++)
+        data[i] = (uint8)(i % 251);
+
+    fid = Hopen(TESTFILE_NAME, DFACC_CREATE, LAZY_NDDS);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    /* The element and its block table go in the first DD block */
+    aid = HLcreate(fid, LAZY_TAG, 1, LAZY_BLKLEN, LAZY_NBLOCKS);
+    CHECK_VOID(aid, FAIL, "HLcreate");
+    ret = Hwrite(aid, LAZY_BLKLEN, data);
+    VERIFY_VOID(ret, LAZY_BLKLEN, "Hwrite");
+    ret = Hendaccess(aid);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+
+    for (int i = 0; i < LAZY_FILLERS; i++) {
+        ret = Hputelement(fid, (uint16)(LAZY_TAG + 1), (uint16)(i + 1), data, LAZY_BLKLEN);
+        CHECK_VOID(ret, FAIL, "Hputelement");
+    }
+
+    /* The rest of its blocks go after the fillers, a block at a time */
+    aid = Hstartaccess(fid, LAZY_TAG, 1, DFACC_RDWR);
+    CHECK_VOID(aid, FAIL, "Hstartaccess");
+    ret = Hseek(aid, LAZY_BLKLEN, DF_START);
+    CHECK_VOID(ret, FAIL, "Hseek");
+    for (int b = 1; b < LAZY_NBLOCKS; b++) {
+        ret = Hwrite(aid, LAZY_BLKLEN, &data[b * LAZY_BLKLEN]);
+        VERIFY_VOID(ret, LAZY_BLKLEN, "Hwrite");
+    }
+    ret = Hendaccess(aid);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    ret = Hsetddload(DFDDL_LAZY);
+    CHECK_VOID(ret, FAIL, "Hsetddload");
+
+    /* Read a piece from the middle of the element, then the whole of it, each
+       right after opening the file */
+    fid = Hopen(TESTFILE_NAME, DFACC_READ, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+    aid = Hstartread(fid, LAZY_TAG, 1);
+    CHECK_VOID(aid, FAIL, "Hstartread");
+    ret = Hseek(aid, 5 * LAZY_BLKLEN + 5, DF_START);
+    CHECK_VOID(ret, FAIL, "Hseek");
+    memset(buf, 0, sizeof(buf));
+    ret = Hread(aid, 20 * LAZY_BLKLEN, buf);
+    VERIFY_VOID(ret, 20 * LAZY_BLKLEN, "Hread");
+    if (memcmp(buf, &data[5 * LAZY_BLKLEN + 5], 20 * LAZY_BLKLEN) != 0) {
+        fprintf(stderr, "ERROR: wrong data read from the middle of a lazily loaded element\n");
+        errors++;
+    }
+    ret = Hendaccess(aid);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    fid = Hopen(TESTFILE_NAME, DFACC_READ, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+    aid = Hstartread(fid, LAZY_TAG, 1);
+    CHECK_VOID(aid, FAIL, "Hstartread");
+    memset(buf, 0, sizeof(buf));
+    ret = Hread(aid, (int32)sizeof(buf), buf);
+    VERIFY_VOID(ret, (int32)sizeof(buf), "Hread");
+    if (memcmp(buf, data, sizeof(buf)) != 0) {
+        fprintf(stderr, "ERROR: wrong data read from a lazily loaded element\n");
+        errors++;
+    }
+    ret = Hendaccess(aid);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    ret = Hsetddload(DFDDL_ALL);
+    CHECK_VOID(ret, FAIL, "Hsetddload");
+
+    num_errs += errors;
+}
+
 void
 test_hblocks(void)
 {
@@ -279,4 +502,8 @@ test_hblocks(void)
     free(inbuf);
 
     num_errs += errors; /* increment global error count */
+
+    test_hblocks_runs();
+
+    test_hblocks_lazy();
 }
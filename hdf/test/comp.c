@@ -84,6 +84,8 @@ static void free_buffers(void);
 static int  write_data(int32 fid, comp_model_t m_type, model_info *m_info, comp_coder_t c_type,
                        comp_info *c_info, int test_num, int32 ntype);
 static void read_data(int32 fid, uint16 ref_num, int test_num, int32 ntype);
+static int  read_range(int32 aid, const uint8 *out_ptr, uint8 *in_ptr, int32 from, int32 to);
+static void read_data_pieces(int32 fid, uint16 ref_num, int test_num, int32 ntype);
 
 static void
 init_model_info(comp_model_t m_type, model_info *m_info, int32 test_ntype)
@@ -370,6 +372,82 @@ read_data(int32 fid, uint16 ref_num, int test_num, int32 ntype)
     CHECK_VOID(err_ret, FAIL, "Hendaccess");
 } /* end read_data() */
 
+/* Read bytes [from, to) of an element in pieces of odd sizes, comparing them
+   with what was written */
+static int
+read_range(int32 aid, const uint8 *out_ptr, uint8 *in_ptr, int32 from, int32 to)
+{
+    int32 err_ret;
+    int32 piece = 1;
+
+    for (int32 posn = from; posn < to; posn += piece, piece = (piece * 7 + 3) % 997 + 1) {
+        if (posn + piece > to)
+            piece = to - posn;
+        err_ret = Hread(aid, piece, in_ptr);
+        if (err_ret != piece || memcmp(in_ptr, out_ptr + posn, (size_t)piece) != 0) {
+            fprintf(stderr, "ERROR: %d bytes read at %d differ\n", (int)piece, (int)posn);
+            return FAIL;
+        } /* end if */
+    }     /* end for */
+    return SUCCEED;
+} /* end read_range() */
+
+/* Read the data in pieces, seeking backward and forward between them, which
+   makes the decoders stop and restart part way through their input */
+static void
+read_data_pieces(int32 fid, uint16 ref_num, int test_num, int32 ntype)
+{
+    int32  aid;
+    int32  err_ret;
+    int32  data_size;
+    uint8 *out_ptr;
+
+    MESSAGE(8, printf("Reading data in pieces for test %d\n", (int)test_num);)
+
+    switch (ntype) {
+        case DFNT_INT8:
+            out_ptr = (uint8 *)outbuf_int8[test_num];
+            break;
+        case DFNT_UINT8:
+            out_ptr = (uint8 *)outbuf_uint8[test_num];
+            break;
+        case DFNT_INT16:
+            out_ptr = (uint8 *)outbuf_int16[test_num];
+            break;
+        case DFNT_UINT16:
+            out_ptr = (uint8 *)outbuf_uint16[test_num];
+            break;
+        case DFNT_INT32:
+            out_ptr = (uint8 *)outbuf_int32[test_num];
+            break;
+        case DFNT_UINT32:
+            out_ptr = (uint8 *)outbuf_uint32[test_num];
+            break;
+        default:
+            return;
+    } /* end switch */
+
+    aid = Hstartread(fid, COMP_TAG, ref_num);
+    CHECK_VOID(aid, FAIL, "Hstartread");
+    data_size = BUFSIZE * DFKNTsize(ntype);
+
+    /* the first half, then back to near the start, then on to the last quarter;
+       the pieces are no bigger than the input buffer for 32-bit data */
+    err_ret = read_range(aid, out_ptr, (uint8 *)inbuf_uint32, 0, data_size / 2);
+    CHECK_VOID(err_ret, FAIL, "read_range");
+    err_ret = Hseek(aid, 100, DF_START);
+    CHECK_VOID(err_ret, FAIL, "Hseek");
+    err_ret = read_range(aid, out_ptr, (uint8 *)inbuf_uint32, 100, 100 + data_size / 4);
+    CHECK_VOID(err_ret, FAIL, "read_range");
+    err_ret = Hseek(aid, (3 * data_size) / 4 + 1, DF_START);
+    CHECK_VOID(err_ret, FAIL, "Hseek");
+    err_ret = read_range(aid, out_ptr, (uint8 *)inbuf_uint32, (3 * data_size) / 4 + 1, data_size);
+    CHECK_VOID(err_ret, FAIL, "read_range");
+
+    err_ret = Hendaccess(aid);
+    CHECK_VOID(err_ret, FAIL, "Hendaccess");
+} /* end read_data_pieces() */
+
 void
 test_comp(void)
 {
@@ -406,6 +484,7 @@ test_comp(void)
                     ref_num = (uint16)write_data(fid, test_models[model_num], &m_info, test_coders[coder_num],
                                                  &c_info, test_num, test_ntypes[ntype_num]);
                     read_data(fid, ref_num, test_num, test_ntypes[ntype_num]);
+                    read_data_pieces(fid, ref_num, test_num, test_ntypes[ntype_num]);
                     MESSAGE(6, {
                         int32           aid;
                         sp_info_block_t info_block;
@@ -51,6 +51,72 @@ extern int Verbosity;
 static int32       test_type[] = {0, DFNT_LITEND, DFNT_NATIVE};
 static const char *test_name[] = {"Big-Endian", "Little-Endian", "Native"};
 
+/* Checks that big-endian items of each size are converted to their native values,
+ * for lengths which leave tails after the vector kernels' blocks, and for
+ * unaligned, overlapping (in place) and strided buffers
+ */
+static void
+test_conv_swap(void)
+{
+    static const int32 types[] = {DFNT_UINT16, DFNT_UINT32, DFNT_FLOAT64};
+    uint8              src[80 * 11], dst[80 * 11 + 1], buf[80 * 11 + 1];
+    int                ret;
+
+    for (int i = 0; i < (int)sizeof(src); i++)
+        src[i] = (uint8)RAND();
+
+    for (int t = 0; t < 3; t++) {
+        int size = DFKNTsize(types[t]);
+
+        for (int n = 1; n <= 70; n++) {
+            for (int stride = 0; stride <= size + 3; stride += size + 3) {
+                int out = stride ? size + 1 : size;
+
+                /* Unaligned, into another buffer */
+                memset(dst, 0, sizeof(dst));
+                ret = DFKconvert(src, dst + 1, types[t], n, DFACC_READ, stride, stride ? out : 0);
+                CHECK_VOID(ret, FAIL, "DFKconvert");
+
+                /* In place, when the items are contiguous */
+                memcpy(buf, src, sizeof(src));
+                if (stride == 0) {
+                    ret = DFKconvert(buf, buf, types[t], n, DFACC_READ, 0, 0);
+                    CHECK_VOID(ret, FAIL, "DFKconvert");
+                }
+
+                for (int i = 0; i < n; i++) {
+                    const uint8 *item  = src + i * (stride ? stride : size);
+                    uint64_t     value = 0;
+                    uint16       v16;
+                    uint32       v32;
+                    uint8        expect[8];
+
+                    for (int b = 0; b < size; b++)
+                        value = (value << 8) | item[b];
+                    if (size == 2) {
+                        v16 = (uint16)value;
+                        memcpy(expect, &v16, 2);
+                    }
+                    else if (size == 4) {
+                        v32 = (uint32)value;
+                        memcpy(expect, &v32, 4);
+                    }
+                    else
+                        memcpy(expect, &value, 8);
+
+                    if (memcmp(expect, dst + 1 + i * out, (size_t)size) != 0 ||
+                        (stride == 0 && memcmp(expect, buf + i * size, (size_t)size) != 0)) {
+                        printf("Error swapping item %d of %d %d-byte values with stride %d\n", i, n, size,
+                               stride);
+                        num_errs++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+} /* end test_conv_swap() */
+
 void
 test_conv(void)
 {
@@ -744,4 +810,6 @@ test_conv(void)
         free(dst2_float64);
     } /* end for */
 
+    MESSAGE(5, printf("Testing byte swapping of big-endian values\n"););
+    test_conv_swap();
 } /* end test_conv() */
@@ -18,6 +18,7 @@
 #include "testhdf.h"
 #define TESTFILE_NAME  "t.hdf"                  /* file for first 4 series of tests */
 #define TESTFILE_NAME1 "tx.hdf"                 /* file for last test */
+#define TESTFILE_POOL  "txpool.hdf"             /* file for the external file pool test */
 #define STRING         "element 1000 2"         /* 14 bytes */
 #define STRING2        "element 1000 1   wrong" /* 22 bytes */
 #define STRING3        "element 1000 1 correct" /* 22 bytes */
@@ -27,6 +28,140 @@
 static uint8 *outbuf = NULL;
 static uint8 *inbuf  = NULL;
 
+/* More external files than the pool keeps open, so that files are pushed
+   out of it and opened again */
+#define POOL_NFILES  (MAX_EXT_FILES + 8)
+#define POOL_ELT_LEN 64
+
+/* Checks the data of element i of the external file pool test */
+static int
+check_pool_elt(const uint8 *buf, int i, int changed)
+{
+    int errors = 0;
+
+    for (int k = 0; k < POOL_ELT_LEN; k++) {
+        uint8 expect = (uint8)(changed && k < 4 ? 0xA0 + k : i * 7 + k);
+
+        if (buf[k] != expect) {
+            MESSAGE(8, printf("Wrong data in element %d at %d, out %d in %d\n", i, k, expect, buf[k]););
+            errors++;
+        }
+    }
+    return errors;
+}
+
+/* Accesses elements in more external files than the external file pool
+   keeps open at once */
+static void
+test_hextelt_pool(void)
+{
+    int32 fid;
+    int32 aids[POOL_NFILES];
+    uint8 buf[POOL_ELT_LEN];
+    char  name[32];
+    int32 ret;
+    int   errors = 0;
+
+    MESSAGE(5, printf("Testing elements in %d external files\n", POOL_NFILES););
+
+    ret = HXsetcreatedir("testdir");
+    CHECK_VOID(ret, FAIL, "HXsetcreatedir");
+
+    fid = Hopen(TESTFILE_POOL, DFACC_CREATE, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    /* One element in each file */
+    for (int i = 0; i < POOL_NFILES; i++) {
+        int32 aid;
+
+        snprintf(name, sizeof(name), "txpool%d.dat", i);
+        aid = HXcreate(fid, 1000, (uint16)(i + 1), name, (int32)0, (int32)0);
+        CHECK_VOID(aid, FAIL, "HXcreate");
+
+        for (int k = 0; k < POOL_ELT_LEN; k++)
+            buf[k] = (uint8)(i * 7 + k);
+        ret = Hwrite(aid, POOL_ELT_LEN, buf);
+        VERIFY_VOID(ret, POOL_ELT_LEN, "Hwrite");
+
+        ret = Hendaccess(aid);
+        CHECK_VOID(ret, FAIL, "Hendaccess");
+    }
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    ret = HXsetdir("testdir");
+    CHECK_VOID(ret, FAIL, "HXsetdir");
+
+    /* Read all of the elements with all of them accessed at once, in two
+       orders, so that each read finds the file pushed out of the pool */
+    fid = Hopen(TESTFILE_POOL, DFACC_RDWR, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    for (int i = 0; i < POOL_NFILES; i++) {
+        aids[i] = Hstartread(fid, 1000, (uint16)(i + 1));
+        CHECK_VOID(aids[i], FAIL, "Hstartread");
+    }
+    for (int pass = 0; pass < 2; pass++)
+        for (int j = 0; j < POOL_NFILES; j++) {
+            int i = pass == 0 ? j : POOL_NFILES - 1 - j;
+
+            memset(buf, 0, sizeof(buf));
+            ret = Hseek(aids[i], 0, DF_START);
+            CHECK_VOID(ret, FAIL, "Hseek");
+            ret = Hread(aids[i], POOL_ELT_LEN, buf);
+            VERIFY_VOID(ret, POOL_ELT_LEN, "Hread");
+            errors += check_pool_elt(buf, i, FALSE);
+        }
+    for (int i = 0; i < POOL_NFILES; i++) {
+        ret = Hendaccess(aids[i]);
+        CHECK_VOID(ret, FAIL, "Hendaccess");
+    }
+
+    /* Write to elements whose files were last read, so that they're opened
+       again for writing */
+    for (int i = 0; i < POOL_NFILES; i += 9) {
+        int32 aid;
+        uint8 change[4] = {0xA0, 0xA1, 0xA2, 0xA3};
+
+        ret = Hgetelement(fid, 1000, (uint16)(i + 1), buf);
+        VERIFY_VOID(ret, POOL_ELT_LEN, "Hgetelement");
+
+        aid = Hstartwrite(fid, 1000, (uint16)(i + 1), POOL_ELT_LEN);
+        CHECK_VOID(aid, FAIL, "Hstartwrite");
+        ret = Hwrite(aid, 4, change);
+        VERIFY_VOID(ret, 4, "Hwrite");
+        ret = Hendaccess(aid);
+        CHECK_VOID(ret, FAIL, "Hendaccess");
+    }
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    /* Check all of the elements again from a new open of the file */
+    fid = Hopen(TESTFILE_POOL, DFACC_READ, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    for (int i = POOL_NFILES - 1; i >= 0; i--) {
+        memset(buf, 0, sizeof(buf));
+        ret = Hgetelement(fid, 1000, (uint16)(i + 1), buf);
+        VERIFY_VOID(ret, POOL_ELT_LEN, "Hgetelement");
+        errors += check_pool_elt(buf, i, i % 9 == 0);
+    }
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    ret = HXsetcreatedir(NULL);
+    CHECK_VOID(ret, FAIL, "HXsetcreatedir");
+    ret = HXsetdir(NULL);
+    CHECK_VOID(ret, FAIL, "HXsetdir");
+
+    if (errors)
+        fprintf(stderr, "Error: Wrong data in elements in the external file pool test\n");
+    num_errs += errors;
+}
+
 void
 test_hextelt(void)
 {
@@ -401,4 +536,6 @@ test_hextelt(void)
     free(inbuf);
 
     num_errs += errors; /* increment global error count */
+
+    test_hextelt_pool();
 }
@@ -41,15 +41,635 @@
    ** With wildcard.
    ** Open more access elements than there is space.
 
+   * Hsetfiledriver/Hgetfiledriver
+   ** Read an existing file with each available driver.
+   ** Write with a read-only driver (falls back to a writable one).
+
+   * Hfind/Hnumber
+   ** Tag searches in both directions over a DD list with holes in it.
+
+   * Hsetddload
+   ** Look up, count and add objects in a file whose DD list is read lazily.
+   ** Read compressed, linked block and external elements lazily.
+
+   * Thread-safe library
+   ** Open, read and close the same file from several threads at once.
+   ** Look up an access ID while other threads open and end access IDs.
+
  */
 
 #include "testhdf.h"
+
+#ifdef H4_HAVE_THREADSAFE
+#include <pthread.h>
+#endif
+
 #define TESTFILE_NAME "t.hdf"
+#define LAZYFILE_NAME "tlazy.hdf"
+#define LAZYEXT_NAME  "tlazy.dat"
 #define BUF_SIZE      4096
 
+/* Most DDs collected by a search in test_tag_search */
+#define TAG_SEARCH_MAX 256
+
+/* DDs in each DD block, objects put ahead of the special elements and
+   10-byte blocks in the linked block element in test_lazy_special */
+#define LAZY_NDDS    16
+#define LAZY_FILLERS 40
+#define LAZY_BLOCKS  10
+
+/* # of access IDs open at once in test_many_aids */
+#define NUM_AIDS 300
+
+/* # of threads, and of passes each makes, in test_threads */
+#define NUM_THREADS     8
+#define NUM_THREAD_RUNS 50
+
+/* # of access IDs each thread opens at once in test_atom_threads */
+#define NUM_THREAD_AIDS 40
+
 static uint8 *outbuf = NULL;
 static uint8 *inbuf  = NULL;
 
+/* Re-reads the elements written by test_hfile through each low-level driver */
+static void
+test_file_drivers(void)
+{
+    int   drivers[] = {DFDRV_STDIO, DFDRV_POSIX, DFDRV_MMAP};
+    int32 fid;
+    int32 ret;
+    int   d, i;
+
+    for (d = 0; d < (int)(sizeof(drivers) / sizeof(drivers[0])); d++) {
+        if (Hsetfiledriver(drivers[d]) == FAIL) {
+            MESSAGE(5, printf("File driver %d is not available, skipping\n", drivers[d]););
+            continue;
+        }
+
+        MESSAGE(5, printf("Reading file %s with file driver %d\n", TESTFILE_NAME, drivers[d]););
+        fid = Hopen(TESTFILE_NAME, DFACC_READ, 0);
+        CHECK_VOID(fid, FAIL, "Hopen");
+
+        ret = (int32)Hgetfiledriver(fid);
+        VERIFY_VOID(ret, drivers[d], "Hgetfiledriver");
+
+        memset(inbuf, 0, BUF_SIZE);
+        ret = Hgetelement(fid, (uint16)102, (uint16)2, inbuf);
+        VERIFY_VOID(ret, BUF_SIZE, "Hgetelement");
+        for (i = 0; i < BUF_SIZE; i++)
+            if (inbuf[i] != outbuf[i]) {
+                fprintf(stderr, "Wrong data at %d, out %d in %d\n", i, outbuf[i], inbuf[i]);
+                num_errs++;
+                break;
+            }
+
+        ret = Hclose(fid);
+        CHECK_VOID(ret, FAIL, "Hclose");
+
+        MESSAGE(5, printf("Writing file %s with file driver %d\n", TESTFILE_NAME, drivers[d]););
+        fid = Hopen(TESTFILE_NAME, DFACC_RDWR, 0);
+        CHECK_VOID(fid, FAIL, "Hopen");
+
+        /* read-only drivers are replaced by a writable one */
+        ret = (int32)Hgetfiledriver(fid);
+        CHECK_VOID(ret, DFDRV_MMAP, "Hgetfiledriver");
+
+        ret = Hputelement(fid, (uint16)104, (uint16)(d + 1), outbuf + d, 100);
+        CHECK_VOID(ret, FAIL, "Hputelement");
+
+        ret = Hclose(fid);
+        CHECK_VOID(ret, FAIL, "Hclose");
+
+        fid = Hopen(TESTFILE_NAME, DFACC_READ, 0);
+        CHECK_VOID(fid, FAIL, "Hopen");
+
+        ret = Hgetelement(fid, (uint16)104, (uint16)(d + 1), inbuf);
+        VERIFY_VOID(ret, 100, "Hgetelement");
+        if (memcmp(inbuf, outbuf + d, 100) != 0) {
+            fprintf(stderr, "Wrong data read back from element written with file driver %d\n", drivers[d]);
+            num_errs++;
+        }
+
+        ret = Hclose(fid);
+        CHECK_VOID(ret, FAIL, "Hclose");
+    }
+
+    ret = (int32)Hsetfiledriver(-1);
+    VERIFY_VOID(ret, FAIL, "Hsetfiledriver");
+
+    /* Restore the default for the rest of the tests */
+    ret = (int32)Hsetfiledriver(DFDRV_STDIO);
+    CHECK_VOID(ret, FAIL, "Hsetfiledriver");
+}
+
+static void
+test_64bit_offsets(void)
+{
+    int32     fid, aid;
+    hdf_off_t length64, offset64, posn64;
+    int32     ret;
+
+    MESSAGE(5, printf("Checking 64-bit offsets in file %s\n", TESTFILE_NAME););
+    fid = Hopen(TESTFILE_NAME, DFACC_READ, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    length64 = Hlength64(fid, (uint16)102, (uint16)2);
+    VERIFY_VOID(length64, BUF_SIZE, "Hlength64");
+
+    offset64 = Hoffset64(fid, (uint16)102, (uint16)2);
+    ret      = Hoffset(fid, (uint16)102, (uint16)2);
+    VERIFY_VOID(offset64, ret, "Hoffset64");
+
+    aid = Hstartread(fid, (uint16)102, (uint16)2);
+    CHECK_VOID(aid, FAIL, "Hstartread");
+
+    ret = Hseek64(aid, (hdf_off_t)100, DF_START);
+    CHECK_VOID(ret, FAIL, "Hseek64");
+
+    ret = Hseek64(aid, (hdf_off_t)-10, DF_CURRENT);
+    CHECK_VOID(ret, FAIL, "Hseek64");
+
+    posn64 = Htell64(aid);
+    VERIFY_VOID(posn64, 90, "Htell64");
+
+    ret = Htell(aid);
+    VERIFY_VOID(ret, 90, "Htell");
+
+    ret = Hinquire64(aid, NULL, NULL, NULL, &length64, &offset64, &posn64, NULL, NULL);
+    CHECK_VOID(ret, FAIL, "Hinquire64");
+    VERIFY_VOID(length64, BUF_SIZE, "Hinquire64");
+    VERIFY_VOID(posn64, 90, "Hinquire64");
+
+    /* positions past the end of a plain element can't be reached */
+    ret = Hseek64(aid, (hdf_off_t)INT32_MAX + 10, DF_START);
+    VERIFY_VOID(ret, FAIL, "Hseek64");
+
+    posn64 = Htell64(aid);
+    VERIFY_VOID(posn64, 90, "Htell64");
+
+    ret = Hendaccess(aid);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+}
+
+/* Collect the tag/refs Hfind returns for a search, in the order they are returned */
+static int
+find_all(int32 fid, uint16 search_tag, uint16 search_ref, int direction, uint16 *tags, uint16 *refs, int max)
+{
+    uint16 find_tag = 0, find_ref = 0;
+    int32  find_offset, find_length;
+    int    n = 0;
+
+    while (n < max && Hfind(fid, search_tag, search_ref, &find_tag, &find_ref, &find_offset, &find_length,
+                            direction) != FAIL) {
+        tags[n]   = find_tag;
+        refs[n++] = find_ref;
+    }
+    return n;
+}
+
+static void
+test_tag_search(void)
+{
+    uint16 all_tags[TAG_SEARCH_MAX], all_refs[TAG_SEARCH_MAX];
+    uint16 tags[TAG_SEARCH_MAX], refs[TAG_SEARCH_MAX];
+    uint16 first_ref = 0;
+    int32  fid;
+    int32  ret;
+    int    nall, n, i, j, k;
+
+    MESSAGE(5, printf("Checking tag searches in file %s\n", TESTFILE_NAME););
+    fid = Hopen(TESTFILE_NAME, DFACC_RDWR, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    /* Interleave a few tags over several DD blocks, then punch holes in the DD list */
+    for (i = 0; i < 60; i++) {
+        uint16 ref = Hnewref(fid);
+
+        ret = Hputelement(fid, (uint16)(1000 + i % 3), ref, outbuf, 10);
+        CHECK_VOID(ret, FAIL, "Hputelement");
+        if (i == 0)
+            first_ref = ref;
+    }
+    for (i = 0; i < 60; i += 4) {
+        ret = Hdeldd(fid, (uint16)(1000 + i % 3), (uint16)(first_ref + i));
+        CHECK_VOID(ret, FAIL, "Hdeldd");
+    }
+    /* This one goes into one of the holes, ahead of most of the other objects */
+    ret = Hputelement(fid, (uint16)1002, Hnewref(fid), outbuf, 10);
+    CHECK_VOID(ret, FAIL, "Hputelement");
+
+    /* The full DD list gives the expected order of every other search */
+    nall = find_all(fid, DFTAG_WILDCARD, DFREF_WILDCARD, DF_FORWARD, all_tags, all_refs, TAG_SEARCH_MAX);
+    CHECK_VOID(nall, TAG_SEARCH_MAX, "Hfind");
+
+    for (k = 1000; k < 1003; k++) {
+        /* Forward search */
+        n = find_all(fid, (uint16)k, DFREF_WILDCARD, DF_FORWARD, tags, refs, TAG_SEARCH_MAX);
+        ret = Hnumber(fid, (uint16)k);
+        VERIFY_VOID(ret, n, "Hnumber");
+        for (i = 0, j = 0; i < nall; i++)
+            if (all_tags[i] == k) {
+                VERIFY_VOID(refs[j], all_refs[i], "Hfind");
+                j++;
+            }
+        VERIFY_VOID(j, n, "Hfind");
+
+        /* Backward search */
+        n = find_all(fid, (uint16)k, DFREF_WILDCARD, DF_BACKWARD, tags, refs, TAG_SEARCH_MAX);
+        VERIFY_VOID(n, j, "Hfind");
+        for (i = nall - 1, j = 0; i >= 0; i--)
+            if (all_tags[i] == k) {
+                VERIFY_VOID(refs[j], all_refs[i], "Hfind");
+                j++;
+            }
+    }
+
+    /* A wildcard tag with a given ref finds the same object as the full list */
+    for (i = 0; i < nall; i++) {
+        n = find_all(fid, DFTAG_WILDCARD, all_refs[i], DF_FORWARD, tags, refs, 1);
+        VERIFY_VOID(n, 1, "Hfind");
+        for (j = 0; all_refs[j] != all_refs[i]; j++)
+            ;
+        VERIFY_VOID(tags[0], all_tags[j], "Hfind");
+    }
+
+    ret = Hnumber(fid, DFTAG_WILDCARD);
+    VERIFY_VOID(ret, nall, "Hnumber");
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+}
+
+static void
+test_lazy_dd_list(void)
+{
+    uint16 last_tag = 0, last_ref = 0;
+    int32  find_offset, find_length;
+    int32  fid, fid1;
+    int32  nobjs, newref;
+    int32  ret;
+
+    MESSAGE(5, printf("Reading the DD list of file %s lazily\n", TESTFILE_NAME););
+    fid = Hopen(TESTFILE_NAME, DFACC_READ, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    nobjs = Hnumber(fid, DFTAG_WILDCARD);
+    CHECK_VOID(nobjs, FAIL, "Hnumber");
+
+    newref = (int32)Hnewref(fid);
+    CHECK_VOID(newref, 0, "Hnewref");
+
+    /* The last object is in the last DD block */
+    ret = Hfind(fid, DFTAG_WILDCARD, DFREF_WILDCARD, &last_tag, &last_ref, &find_offset, &find_length,
+                DF_BACKWARD);
+    CHECK_VOID(ret, FAIL, "Hfind");
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    ret = Hsetddload(-1);
+    VERIFY_VOID(ret, FAIL, "Hsetddload");
+
+    ret = Hsetddload(DFDDL_LAZY);
+    CHECK_VOID(ret, FAIL, "Hsetddload");
+
+    /* Objects are found, or not, by reading as much of the DD list as needed */
+    fid = Hopen(TESTFILE_NAME, DFACC_READ, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    ret = Hlength(fid, last_tag, last_ref);
+    VERIFY_VOID(ret, find_length, "Hlength");
+
+    ret = Hexist(fid, (uint16)999, last_ref);
+    VERIFY_VOID(ret, FAIL, "Hexist");
+
+    ret = Hnumber(fid, DFTAG_WILDCARD);
+    VERIFY_VOID(ret, nobjs, "Hnumber");
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    /* Opening the file again for writing reads in the rest of the DD list */
+    fid = Hopen(TESTFILE_NAME, DFACC_READ, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    ret = Hlength(fid, last_tag, last_ref);
+    VERIFY_VOID(ret, find_length, "Hlength");
+
+    fid1 = Hopen(TESTFILE_NAME, DFACC_RDWR, 0);
+    CHECK_VOID(fid1, FAIL, "Hopen");
+
+    ret = (int32)Hnewref(fid1);
+    VERIFY_VOID(ret, newref, "Hnewref");
+
+    ret = Hnumber(fid1, DFTAG_WILDCARD);
+    VERIFY_VOID(ret, nobjs, "Hnumber");
+
+    ret = Hclose(fid1);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    ret = Hsetddload(DFDDL_ALL);
+    CHECK_VOID(ret, FAIL, "Hsetddload");
+}
+
+/* Reads a special element back from a file whose DD list is read lazily */
+static void
+check_lazy_element(uint16 tag, int32 length)
+{
+    int32 fid, aid;
+    int32 ret;
+
+    fid = Hopen(LAZYFILE_NAME, DFACC_READ, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    aid = Hstartread(fid, tag, 1);
+    CHECK_VOID(aid, FAIL, "Hstartread");
+
+    memset(inbuf, 0, BUF_SIZE);
+    ret = Hread(aid, length, inbuf);
+    VERIFY_VOID(ret, length, "Hread");
+    if (memcmp(inbuf, outbuf, (size_t)length) != 0) {
+        fprintf(stderr, "ERROR: Hread returned the wrong data for tag %d\n", (int)tag);
+        num_errs++;
+    }
+
+    ret = Hendaccess(aid);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+}
+
+static void
+test_lazy_special(void)
+{
+    model_info   minfo;
+    comp_info    cinfo;
+    comp_coder_t coder;
+    int32        fid, aid;
+    int32        ret;
+    int          i;
+
+    MESSAGE(5, printf("Reading special elements in file %s lazily\n", LAZYFILE_NAME););
+
+    fid = Hopen(LAZYFILE_NAME, DFACC_CREATE, LAZY_NDDS);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    /* The linked block element and its block table go in the first DD block,
+       the blocks appended to it after the fillers go in later ones */
+    aid = HLcreate(fid, (uint16)1002, 1, 10, LAZY_BLOCKS);
+    CHECK_VOID(aid, FAIL, "HLcreate");
+    ret = Hwrite(aid, 10, outbuf);
+    VERIFY_VOID(ret, 10, "Hwrite");
+    ret = Hendaccess(aid);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+
+    for (i = 0; i < LAZY_FILLERS; i++) {
+        ret = Hputelement(fid, (uint16)1000, (uint16)(i + 1), outbuf, 10);
+        CHECK_VOID(ret, FAIL, "Hputelement");
+    }
+
+    aid = Hstartaccess(fid, (uint16)1002, 1, DFACC_RDWR);
+    CHECK_VOID(aid, FAIL, "Hstartaccess");
+    ret = Hseek(aid, 10, DF_START);
+    CHECK_VOID(ret, FAIL, "Hseek");
+    for (i = 1; i < LAZY_BLOCKS; i++) {
+        ret = Hwrite(aid, 10, outbuf + i * 10);
+        VERIFY_VOID(ret, 10, "Hwrite");
+    }
+    ret = Hendaccess(aid);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+
+    /* The other special elements go past the first DD blocks too */
+    cinfo.deflate.level = 6;
+    aid = HCcreate(fid, (uint16)1001, 1, COMP_MODEL_STDIO, &minfo, COMP_CODE_DEFLATE, &cinfo);
+    CHECK_VOID(aid, FAIL, "HCcreate");
+    ret = Hwrite(aid, BUF_SIZE, outbuf);
+    VERIFY_VOID(ret, BUF_SIZE, "Hwrite");
+    ret = Hendaccess(aid);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+
+    aid = HXcreate(fid, (uint16)1003, 1, LAZYEXT_NAME, 0, 0);
+    CHECK_VOID(aid, FAIL, "HXcreate");
+    ret = Hwrite(aid, BUF_SIZE, outbuf);
+    VERIFY_VOID(ret, BUF_SIZE, "Hwrite");
+    ret = Hendaccess(aid);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    ret = Hsetddload(DFDDL_LAZY);
+    CHECK_VOID(ret, FAIL, "Hsetddload");
+
+    /* Each check opens the file again, so nothing past the first DD block has been read */
+    check_lazy_element((uint16)1002, LAZY_BLOCKS * 10);
+    check_lazy_element((uint16)1001, BUF_SIZE);
+    check_lazy_element((uint16)1003, BUF_SIZE);
+
+    fid = Hopen(LAZYFILE_NAME, DFACC_READ, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    coder = COMP_CODE_INVALID;
+    ret   = HCPgetcomptype(fid, (uint16)1001, 1, &coder);
+    CHECK_VOID(ret, FAIL, "HCPgetcomptype");
+    VERIFY_VOID(coder, COMP_CODE_DEFLATE, "HCPgetcomptype");
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    ret = Hsetddload(DFDDL_ALL);
+    CHECK_VOID(ret, FAIL, "Hsetddload");
+}
+
+static void
+test_many_aids(void)
+{
+    int32 aids[NUM_AIDS];
+    int32 fid;
+    int32 ret;
+    int   i;
+
+    MESSAGE(5, printf("Opening %d access IDs on file %s\n", NUM_AIDS, TESTFILE_NAME););
+    fid = Hopen(TESTFILE_NAME, DFACC_READ, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+
+    for (i = 0; i < NUM_AIDS; i++) {
+        aids[i] = Hstartread(fid, 100, 1);
+        CHECK_VOID(aids[i], FAIL, "Hstartread");
+    }
+
+    /* End every third access, so the rest have to be found around the holes */
+    for (i = NUM_AIDS - 1; i >= 0; i -= 3) {
+        ret = Hendaccess(aids[i]);
+        CHECK_VOID(ret, FAIL, "Hendaccess");
+    }
+
+    for (i = 0; i < NUM_AIDS; i++) {
+        ret = Htell(aids[i]);
+        if ((NUM_AIDS - 1 - i) % 3 == 0)
+            VERIFY_VOID(ret, FAIL, "Htell");
+        else
+            VERIFY_VOID(ret, 0, "Htell");
+    }
+
+    /* IDs of ended accesses stay invalid after their slots are reused */
+    for (i = NUM_AIDS - 1; i >= 0; i -= 3) {
+        int32 aid = Hstartread(fid, 100, 1);
+
+        CHECK_VOID(aid, FAIL, "Hstartread");
+        if (aid == aids[i]) {
+            fprintf(stderr, "Line %d: access ID %d was reused\n", (int)__LINE__, (int)aid);
+            num_errs++;
+        }
+        ret = Hendaccess(aid);
+        CHECK_VOID(ret, FAIL, "Hendaccess");
+    }
+
+    for (i = 0; i < NUM_AIDS; i++) {
+        if ((NUM_AIDS - 1 - i) % 3 == 0)
+            continue;
+        ret = Hendaccess(aids[i]);
+        CHECK_VOID(ret, FAIL, "Hendaccess");
+    }
+
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+}
+
+#ifdef H4_HAVE_THREADSAFE
+/* Opens the test file, reads an element and checks it, NUM_THREAD_RUNS times */
+static void *
+read_file_thread(void *arg)
+{
+    int  *errors = (int *)arg;
+    uint8 buf[2000];
+
+    for (int run = 0; run < NUM_THREAD_RUNS; run++) {
+        int32 fid = Hopen(TESTFILE_NAME, DFACC_READ, 0);
+
+        if (fid == FAIL) {
+            (*errors)++;
+            continue;
+        }
+        if (Hgetelement(fid, (uint16)100, (uint16)4, buf) != 2000 || memcmp(buf, outbuf, 2000) != 0)
+            (*errors)++;
+
+        /* an error here must not show up in the other threads' error stacks */
+        if (Hgetelement(fid, (uint16)999, (uint16)1, buf) != FAIL || HEvalue(1) == DFE_NONE)
+            (*errors)++;
+
+        if (Hclose(fid) == FAIL)
+            (*errors)++;
+    }
+    return NULL;
+}
+
+static void
+test_threads(void)
+{
+    pthread_t threads[NUM_THREADS];
+    int       errors[NUM_THREADS];
+    int       i;
+
+    MESSAGE(5, printf("Reading file %s from %d threads\n", TESTFILE_NAME, NUM_THREADS););
+    for (i = 0; i < NUM_THREADS; i++) {
+        errors[i] = 0;
+        if (pthread_create(&threads[i], NULL, read_file_thread, &errors[i]) != 0) {
+            fprintf(stderr, "Line %d: can't create thread %d\n", (int)__LINE__, i);
+            num_errs++;
+            break;
+        }
+    }
+
+    while (i-- > 0) {
+        pthread_join(threads[i], NULL);
+        if (errors[i] != 0) {
+            fprintf(stderr, "Line %d: thread %d had %d errors\n", (int)__LINE__, i, errors[i]);
+            num_errs++;
+        }
+    }
+}
+
+/* What a thread of test_atom_threads works with */
+typedef struct {
+    int32 fid;    /* file to open access IDs on */
+    int32 aid;    /* access ID which stays open */
+    int   errors; /* # of errors the thread had */
+} atom_thread_t;
+
+/* Opens and ends access IDs, so their table gets built again, while looking
+   up an access ID which stays open */
+static void *
+atom_thread(void *arg)
+{
+    atom_thread_t *t = (atom_thread_t *)arg;
+    int32          aids[NUM_THREAD_AIDS];
+
+    for (int run = 0; run < NUM_THREAD_RUNS; run++) {
+        for (int i = 0; i < NUM_THREAD_AIDS; i++) {
+            if ((aids[i] = Hstartread(t->fid, 100, 1)) == FAIL)
+                t->errors++;
+            if (Htell(t->aid) != 0)
+                t->errors++;
+        }
+        for (int i = 0; i < NUM_THREAD_AIDS; i++) {
+            if (aids[i] != FAIL && Hendaccess(aids[i]) == FAIL)
+                t->errors++;
+            if (Htell(t->aid) != 0)
+                t->errors++;
+        }
+    }
+    return NULL;
+}
+
+static void
+test_atom_threads(void)
+{
+    pthread_t     threads[NUM_THREADS];
+    atom_thread_t args[NUM_THREADS];
+    int32         fid, aid;
+    int32         ret;
+    int           i;
+
+    MESSAGE(5, printf("Looking up access IDs from %d threads\n", NUM_THREADS););
+    fid = Hopen(TESTFILE_NAME, DFACC_READ, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+    aid = Hstartread(fid, 100, 1);
+    CHECK_VOID(aid, FAIL, "Hstartread");
+
+    for (i = 0; i < NUM_THREADS; i++) {
+        args[i].fid    = fid;
+        args[i].aid    = aid;
+        args[i].errors = 0;
+        if (pthread_create(&threads[i], NULL, atom_thread, &args[i]) != 0) {
+            fprintf(stderr, "Line %d: can't create thread %d\n", (int)__LINE__, i);
+            num_errs++;
+            break;
+        }
+    }
+
+    while (i-- > 0) {
+        pthread_join(threads[i], NULL);
+        if (args[i].errors != 0) {
+            fprintf(stderr, "Line %d: thread %d had %d errors\n", (int)__LINE__, i, args[i].errors);
+            num_errs++;
+        }
+    }
+
+    ret = Hendaccess(aid);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+}
+#endif /* H4_HAVE_THREADSAFE */
+
 void
 test_hfile(void)
 {
@@ -219,6 +839,23 @@ test_hfile(void)
     ret_bool = (int)Hishdf("qqqqqqqq.qqq"); /* I sure hope it isn't there */
     CHECK_VOID(ret, TRUE, "Hishdf");
 
+    test_file_drivers();
+
+    test_64bit_offsets();
+
+    test_tag_search();
+
+    test_lazy_dd_list();
+
+    test_lazy_special();
+
+    test_many_aids();
+
+#ifdef H4_HAVE_THREADSAFE
+    test_threads();
+    test_atom_threads();
+#endif
+
     free(outbuf);
     free(inbuf);
 }
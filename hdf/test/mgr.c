@@ -2990,19 +2990,285 @@ test_mgr_image(int flag)
 **  III. ID/Ref/Index Functions
 **      A. GRidtoref
 **      B. GRreftoindex
+**      C. GRnametoindex
 **
 ****************************************************************/
+#define NAMEFILE "tmgrname.hdf"
 static void
 test_mgr_index(int flag)
 {
+    int32       fid;   /* HDF file ID */
+    int32       grid;  /* GR interface ID */
+    int32       riid;  /* RI ID */
+    int32       index; /* index of the image found */
+    int32       dims[2] = {4, 5};
+    int         ii;
+    int         ret;
+    const char *names[] = {"Image A", "Image B", "Image C", "Image A"};
+
     (void)flag;
 
     /* output message about test being performed */
     MESSAGE(6, printf("Testing Multi-File Raster id/ref/index routines\n"););
 
-    /* I believe that these are adequately tested in the test_mgr_image routine -QAK */
+    /* GRidtoref and GRreftoindex are adequately tested in the test_mgr_image routine -QAK */
+
+    /* Create two images and look one of them up, then create two more, one
+       with the name of the first image */
+    fid = Hopen(NAMEFILE, DFACC_CREATE, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+    grid = GRstart(fid);
+    CHECK_VOID(grid, FAIL, "GRstart");
+    for (ii = 0; ii < 4; ii++) {
+        riid = GRcreate(grid, names[ii], 1, DFNT_UINT8, MFGR_INTERLACE_PIXEL, dims);
+        CHECK_VOID(riid, FAIL, "GRcreate");
+        ret = GRendaccess(riid);
+        CHECK_VOID(ret, FAIL, "GRendaccess");
+
+        if (ii == 1) {
+            index = GRnametoindex(grid, "Image B");
+            VERIFY_VOID(index, 1, "GRnametoindex");
+        }
+    }
+
+    /* The images created later are found, and the first one of a name is */
+    index = GRnametoindex(grid, "Image C");
+    VERIFY_VOID(index, 2, "GRnametoindex");
+    index = GRnametoindex(grid, "Image A");
+    VERIFY_VOID(index, 0, "GRnametoindex");
+    index = GRnametoindex(grid, "Image D");
+    VERIFY_VOID(index, FAIL, "GRnametoindex");
+
+    ret = GRend(grid);
+    CHECK_VOID(ret, FAIL, "GRend");
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+
+    /* Re-open the file and look the images up again */
+    fid = Hopen(NAMEFILE, DFACC_READ, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+    grid = GRstart(fid);
+    CHECK_VOID(grid, FAIL, "GRstart");
+
+    index = GRnametoindex(grid, "Image A");
+    VERIFY_VOID(index, 0, "GRnametoindex");
+    index = GRnametoindex(grid, "Image B");
+    VERIFY_VOID(index, 1, "GRnametoindex");
+    index = GRnametoindex(grid, "Image C");
+    VERIFY_VOID(index, 2, "GRnametoindex");
+    index = GRnametoindex(grid, "Image D");
+    VERIFY_VOID(index, FAIL, "GRnametoindex");
+
+    ret = GRend(grid);
+    CHECK_VOID(ret, FAIL, "GRend");
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
 } /* end test_mgr_index() */
 
+/* Offset of component k of pixel (x,y) of an image in interlace il */
+static size_t
+il_offset(int il, int32 dims[2], int32 ncomp, int32 x, int32 y, int32 k)
+{
+    if (il == MFGR_INTERLACE_PIXEL)
+        return ((size_t)y * (size_t)dims[XDIM] + (size_t)x) * (size_t)ncomp + (size_t)k;
+    else if (il == MFGR_INTERLACE_LINE)
+        return ((size_t)y * (size_t)ncomp + (size_t)k) * (size_t)dims[XDIM] + (size_t)x;
+    else
+        return ((size_t)k * (size_t)dims[YDIM] + (size_t)y) * (size_t)dims[XDIM] + (size_t)x;
+}
+
+/* Checks GRIil_convert between each pair of interlaces for the numbers of
+   components and sizes of number type which have their own loops, and
+   some which don't */
+static void
+test_mgr_interlace_convert(void)
+{
+    static const int32 ncomps[] = {1, 2, 3, 4, 5, 8, 11};
+    static const int32 nts[]    = {DFNT_UINT8, DFNT_INT16, DFNT_INT32, DFNT_FLOAT64};
+    int32              dims[2]  = {37, 5}; /* not a whole number of vectors */
+    uint8             *inbuf, *outbuf;
+    size_t             size, npix = 37 * 5;
+    int32              x, y, k;
+    int                n, t, inil, outil;
+    int32              ret;
+
+    MESSAGE(6, printf("Testing conversions between interlaces\n"););
+
+    inbuf  = (uint8 *)malloc(npix * 11 * 8);
+    outbuf = (uint8 *)malloc(npix * 11 * 8);
+    CHECK_VOID(inbuf, NULL, "malloc");
+    CHECK_VOID(outbuf, NULL, "malloc");
+
+    for (n = 0; n < (int)(sizeof(ncomps) / sizeof(ncomps[0])); n++)
+        for (t = 0; t < (int)(sizeof(nts) / sizeof(nts[0])); t++)
+            for (inil = MFGR_INTERLACE_PIXEL; inil <= MFGR_INTERLACE_COMPONENT; inil++)
+                for (outil = MFGR_INTERLACE_PIXEL; outil <= MFGR_INTERLACE_COMPONENT; outil++) {
+                    int errors = 0;
+
+                    /* each byte of a component is set from where it is in the image */
+                    size = (size_t)DFKNTsize(nts[t] | DFNT_NATIVE);
+                    for (y = 0; y < dims[YDIM]; y++)
+                        for (x = 0; x < dims[XDIM]; x++)
+                            for (k = 0; k < ncomps[n]; k++)
+                                for (size_t b = 0; b < size; b++)
+                                    inbuf[il_offset(inil, dims, ncomps[n], x, y, k) * size + b] =
+                                        (uint8)((y * dims[XDIM] + x) * 7 + k * 31 + (int32)b * 101);
+
+                    memset(outbuf, 0, npix * (size_t)ncomps[n] * size);
+                    ret = GRIil_convert(inbuf, (gr_interlace_t)inil, outbuf, (gr_interlace_t)outil, dims,
+                                        ncomps[n], nts[t]);
+                    CHECK_VOID(ret, FAIL, "GRIil_convert");
+
+                    for (y = 0; y < dims[YDIM]; y++)
+                        for (x = 0; x < dims[XDIM]; x++)
+                            for (k = 0; k < ncomps[n]; k++)
+                                for (size_t b = 0; b < size; b++)
+                                    if (outbuf[il_offset(outil, dims, ncomps[n], x, y, k) * size + b] !=
+                                        (uint8)((y * dims[XDIM] + x) * 7 + k * 31 + (int32)b * 101))
+                                        errors++;
+                    if (errors > 0) {
+                        MESSAGE(3, printf("Error converting %d components of %d bytes from "
+                                          "interlace %d to %d\n",
+                                          (int)ncomps[n], (int)size, inil, outil););
+                        num_errs++;
+                    }
+                }
+
+    free(inbuf);
+    free(outbuf);
+} /* end test_mgr_interlace_convert() */
+
+/* Checks reading and writing images large enough to be converted several
+   bands of rows at a time */
+#define STAGEFILE          "tmgrstage.hdf"
+#define STAGE_X            700
+#define STAGE_Y            300
+#define STAGE_NCOMP        3
+#define STAGE_VAL(x, y, k) ((int16)((x) * 3 + (y) * 7 + (k) * 1000 - 3000))
+static void
+test_mgr_interlace_stage(void)
+{
+    int32  fid, grid, riid;
+    int32  dims[2]           = {STAGE_X, STAGE_Y};
+    int32  start[2]          = {0, 0};
+    int32  stride[2]         = {1, 1};
+    int32  blk_start[2]      = {5, 20}; /* a block of rows spanning several bands */
+    int32  blk_count[2]      = {690, 270};
+    int16  fill[STAGE_NCOMP] = {-1, -2, -3};
+    int16 *buf, *inbuf, expect;
+    int32  x, y, k;
+    int    il, errors = 0;
+    int32  ret;
+
+    MESSAGE(6, printf("Testing converting large images a band of rows at a time\n"););
+
+    buf   = (int16 *)malloc(STAGE_X * STAGE_Y * STAGE_NCOMP * sizeof(int16));
+    inbuf = (int16 *)malloc(STAGE_X * STAGE_Y * STAGE_NCOMP * sizeof(int16));
+    CHECK_VOID(buf, NULL, "malloc");
+    CHECK_VOID(inbuf, NULL, "malloc");
+
+    fid = Hopen(STAGEFILE, DFACC_CREATE, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+    grid = GRstart(fid);
+    CHECK_VOID(grid, FAIL, "GRstart");
+
+    /* Write a whole image from a component interlaced buffer */
+    for (k = 0; k < STAGE_NCOMP; k++)
+        for (y = 0; y < STAGE_Y; y++)
+            for (x = 0; x < STAGE_X; x++)
+                buf[(k * STAGE_Y + y) * STAGE_X + x] = STAGE_VAL(x, y, k);
+    riid = GRcreate(grid, "Whole", STAGE_NCOMP, DFNT_INT16, MFGR_INTERLACE_COMPONENT, dims);
+    CHECK_VOID(riid, FAIL, "GRcreate");
+    ret = GRwriteimage(riid, start, stride, dims, buf);
+    CHECK_VOID(ret, FAIL, "GRwriteimage");
+
+    /* Read it back in each interlace */
+    for (il = MFGR_INTERLACE_PIXEL; il <= MFGR_INTERLACE_COMPONENT; il++) {
+        ret = GRreqimageil(riid, il);
+        CHECK_VOID(ret, FAIL, "GRreqimageil");
+        memset(inbuf, 0, STAGE_X * STAGE_Y * STAGE_NCOMP * sizeof(int16));
+        ret = GRreadimage(riid, start, stride, dims, inbuf);
+        CHECK_VOID(ret, FAIL, "GRreadimage");
+        for (y = 0; y < STAGE_Y; y++)
+            for (x = 0; x < STAGE_X; x++)
+                for (k = 0; k < STAGE_NCOMP; k++)
+                    if (inbuf[il_offset(il, dims, STAGE_NCOMP, x, y, k)] != STAGE_VAL(x, y, k))
+                        errors++;
+    }
+    ret = GRendaccess(riid);
+    CHECK_VOID(ret, FAIL, "GRendaccess");
+
+    /* Write a block of a new image with a fill value, from a line
+       interlaced buffer */
+    for (y = 0; y < blk_count[YDIM]; y++)
+        for (k = 0; k < STAGE_NCOMP; k++)
+            for (x = 0; x < blk_count[XDIM]; x++)
+                buf[(y * STAGE_NCOMP + k) * blk_count[XDIM] + x] =
+                    STAGE_VAL(x + blk_start[XDIM], y + blk_start[YDIM], k);
+    riid = GRcreate(grid, "Block", STAGE_NCOMP, DFNT_INT16, MFGR_INTERLACE_LINE, dims);
+    CHECK_VOID(riid, FAIL, "GRcreate");
+    ret = GRsetattr(riid, FILL_ATTR, DFNT_INT16, STAGE_NCOMP, fill);
+    CHECK_VOID(ret, FAIL, "GRsetattr");
+    ret = GRwriteimage(riid, blk_start, stride, blk_count, buf);
+    CHECK_VOID(ret, FAIL, "GRwriteimage");
+
+    /* Read every other pixel of it back in component interlace */
+    {
+        int32 sub_start[2]  = {1, 1};
+        int32 sub_stride[2] = {2, 2};
+        int32 sub_count[2]  = {STAGE_X / 2, STAGE_Y / 2 - 1};
+
+        ret = GRreqimageil(riid, MFGR_INTERLACE_COMPONENT);
+        CHECK_VOID(ret, FAIL, "GRreqimageil");
+        ret = GRreadimage(riid, sub_start, sub_stride, sub_count, inbuf);
+        CHECK_VOID(ret, FAIL, "GRreadimage");
+        for (y = 0; y < sub_count[YDIM]; y++)
+            for (x = 0; x < sub_count[XDIM]; x++)
+                for (k = 0; k < STAGE_NCOMP; k++) {
+                    int32 ix = 1 + 2 * x, iy = 1 + 2 * y;
+
+                    if (ix >= blk_start[XDIM] && ix < blk_start[XDIM] + blk_count[XDIM] &&
+                        iy >= blk_start[YDIM] && iy < blk_start[YDIM] + blk_count[YDIM])
+                        expect = STAGE_VAL(ix, iy, k);
+                    else
+                        expect = fill[k];
+                    if (inbuf[il_offset(MFGR_INTERLACE_COMPONENT, sub_count, STAGE_NCOMP, x, y, k)] != expect)
+                        errors++;
+                }
+    }
+    ret = GRendaccess(riid);
+    CHECK_VOID(ret, FAIL, "GRendaccess");
+
+    /* Read an image which was never written, in line interlace */
+    riid = GRcreate(grid, "Empty", STAGE_NCOMP, DFNT_INT16, MFGR_INTERLACE_PIXEL, dims);
+    CHECK_VOID(riid, FAIL, "GRcreate");
+    ret = GRsetattr(riid, FILL_ATTR, DFNT_INT16, STAGE_NCOMP, fill);
+    CHECK_VOID(ret, FAIL, "GRsetattr");
+    ret = GRreqimageil(riid, MFGR_INTERLACE_LINE);
+    CHECK_VOID(ret, FAIL, "GRreqimageil");
+    ret = GRreadimage(riid, start, stride, dims, inbuf);
+    CHECK_VOID(ret, FAIL, "GRreadimage");
+    for (y = 0; y < STAGE_Y; y++)
+        for (x = 0; x < STAGE_X; x++)
+            for (k = 0; k < STAGE_NCOMP; k++)
+                if (inbuf[il_offset(MFGR_INTERLACE_LINE, dims, STAGE_NCOMP, x, y, k)] != fill[k])
+                    errors++;
+    ret = GRendaccess(riid);
+    CHECK_VOID(ret, FAIL, "GRendaccess");
+
+    if (errors > 0) {
+        MESSAGE(3, printf("%d errors in images converted a band of rows at a time\n", errors););
+        num_errs++;
+    }
+
+    ret = GRend(grid);
+    CHECK_VOID(ret, FAIL, "GRend");
+    ret = Hclose(fid);
+    CHECK_VOID(ret, FAIL, "Hclose");
+    free(buf);
+    free(inbuf);
+} /* end test_mgr_interlace_stage() */
+
 /****************************************************************
 **
 **  test_mgr_interlace(): Multi-file Raster Interlace Test Routine
@@ -3025,6 +3291,11 @@ test_mgr_interlace(int flag)
     /* Output message about test being performed */
     MESSAGE(6, printf("Testing Multi-file Raster Interlace routines\n"););
 
+    if (!flag) {
+        test_mgr_interlace_convert();
+        test_mgr_interlace_stage();
+    }
+
     /* open up the existing datafile and get the image information from it */
     if (flag)
         fid = Hopen(TESTFILE2, DFACC_RDWR, 0);
@@ -110,6 +110,11 @@
 #define NBIT_MASK12A 0x0000001f
 #define NBIT_MASK12B 0xffffffffUL
 
+#define NBIT_TAG13  1012
+#define NBIT_SIZE13 4096
+#define NBIT_BITS13 20
+#define NBIT_OFF13  40
+
 static void test_nbit1(int32 fid);
 static void test_nbit2(int32 fid);
 static void test_nbit3(int32 fid);
@@ -122,6 +127,7 @@ static void test_nbit9(int32 fid);
 static void test_nbit10(int32 fid);
 static void test_nbit11(int32 fid);
 static void test_nbit12(int32 fid);
+static void test_nbit13(int32 fid);
 
 static void
 test_nbit1(int32 fid)
@@ -255,7 +261,8 @@ test_nbit3(int32 fid)
     comp_info  c_info;
     uint16    *outbuf, *inbuf;
     uint16     test_out, test_in;
-    uint8     *convbuf;
+    uint8     *convbuf, *piecebuf;
+    int32      piece, posn;
 
     outbuf  = (uint16 *)malloc(NBIT_SIZE3 * sizeof(uint16));
     inbuf   = (uint16 *)malloc(NBIT_SIZE3 * sizeof(uint16));
@@ -312,9 +319,27 @@ test_nbit3(int32 fid)
         printf("data at %d, out (%d)%d in (%d)%d\n", i, outbuf[i], test_out, inbuf[i], test_in);
 #endif
     }
+
+    MESSAGE(5, printf("Verifying data read in pieces which split items\n"););
+    piecebuf = (uint8 *)malloc(NBIT_SIZE3 * (size_t)DFKNTsize(DFNT_UINT16));
+    aid1     = Hstartread(fid, NBIT_TAG3, ref1);
+    CHECK_VOID(aid1, FAIL, "Hstartread");
+    for (posn = 0, piece = 1501; posn < NBIT_SIZE3 * DFKNTsize(DFNT_UINT16); posn += piece, piece = 99) {
+        piece = MIN(piece, NBIT_SIZE3 * DFKNTsize(DFNT_UINT16) - posn);
+        ret   = Hread(aid1, piece, piecebuf + posn);
+        VERIFY_VOID(ret, piece, "Hread");
+    }
+    ret = Hendaccess(aid1);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+    if (memcmp(piecebuf, convbuf, NBIT_SIZE3 * (size_t)DFKNTsize(DFNT_UINT16)) != 0) {
+        printf("test_nbit3: Wrong data read in pieces\n");
+        errors++;
+    }
+
     free(outbuf);
     free(inbuf);
     free(convbuf);
+    free(piecebuf);
     num_errs += errors;
 }
 
@@ -1009,6 +1034,82 @@ test_nbit12(int32 fid)
     num_errs += errors;
 }
 
+/* 64-bit items are stored as raw big-endian bytes, as there is no 64-bit
+   integer type to convert them with */
+static void
+test_nbit13(int32 fid)
+{
+    int32      aid1;
+    uint16     ref1;
+    int        i, j;
+    int32      ret;
+    int        errors = 0;
+    model_info m_info;
+    comp_info  c_info;
+    uint8     *outbuf, *inbuf;
+    uint64_t   field, test_out, test_in;
+
+    outbuf = (uint8 *)malloc(NBIT_SIZE13 * 8);
+    inbuf  = (uint8 *)malloc(NBIT_SIZE13 * 8);
+
+    for (i = 0; i < NBIT_SIZE13; i++) /* fill with pseudo-random data */
+        for (j = 0; j < 8; j++)
+            outbuf[i * 8 + j] = (uint8)((i * 7 + j * 131) ^ (i >> 3));
+
+    ref1 = Hnewref(fid);
+    CHECK_VOID(ref1, 0, "Hnewref");
+
+    MESSAGE(5, printf("Create a new element as a signed 64-bit n-bit element\n"););
+    c_info.nbit.nt        = DFNT_FLOAT64;
+    c_info.nbit.sign_ext  = TRUE;
+    c_info.nbit.fill_one  = FALSE;
+    c_info.nbit.start_bit = NBIT_OFF13;
+    c_info.nbit.bit_len   = NBIT_BITS13;
+    aid1 = HCcreate(fid, NBIT_TAG13, ref1, COMP_MODEL_STDIO, &m_info, COMP_CODE_NBIT, &c_info);
+    CHECK_VOID(aid1, FAIL, "HCcreate");
+
+    ret = Hwrite(aid1, NBIT_SIZE13 * 8, outbuf);
+    if (ret != NBIT_SIZE13 * 8) {
+        fprintf(stderr, "ERROR(%d): Hwrite returned the wrong length: %d\n", __LINE__, (int)ret);
+        HEprint(stdout, 0);
+        errors++;
+    }
+
+    ret = Hendaccess(aid1);
+    CHECK_VOID(ret, FAIL, "Hendaccess");
+
+    MESSAGE(5, printf("Verifying data\n"););
+
+    memset(inbuf, 0, NBIT_SIZE13 * 8);
+
+    ret = Hgetelement(fid, NBIT_TAG13, (uint16)ref1, inbuf);
+    if (ret != NBIT_SIZE13 * 8) {
+        HEprint(stderr, 0);
+        fprintf(stderr, "ERROR: (%d) Hgetelement returned the wrong length: %d\n", __LINE__, (int)ret);
+        errors++;
+    }
+
+    for (i = 0; i < NBIT_SIZE13; i++) {
+        test_out = test_in = 0;
+        for (j = 0; j < 8; j++) {
+            test_out = (test_out << 8) | outbuf[i * 8 + j];
+            test_in  = (test_in << 8) | inbuf[i * 8 + j];
+        }
+        field    = (test_out >> (NBIT_OFF13 - NBIT_BITS13 + 1)) & ((1 << NBIT_BITS13) - 1);
+        test_out = field << (NBIT_OFF13 - NBIT_BITS13 + 1);
+        if (field >> (NBIT_BITS13 - 1))
+            test_out |= ~(uint64_t)0 << NBIT_OFF13;
+        if (test_in != test_out) {
+            printf("test_nbit13: Wrong data at %d, out %llx in %llx\n", i, (unsigned long long)test_out,
+                   (unsigned long long)test_in);
+            errors++;
+        }
+    }
+    free(outbuf);
+    free(inbuf);
+    num_errs += errors;
+}
+
 void
 test_nbit(void)
 {
@@ -1032,6 +1133,7 @@ test_nbit(void)
     test_nbit10(fid); /* advanced int16 with fill-ones test */
     test_nbit11(fid); /* advanced uint32 with fill-ones test */
     test_nbit12(fid); /* advanced int32 with fill-ones test */
+    test_nbit13(fid); /* sign extended 64-bit test */
 
     MESSAGE(5, printf("Closing the files\n"););
     ret = Hclose(fid);
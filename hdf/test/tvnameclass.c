@@ -21,6 +21,7 @@
 
 #define LONGNAMES    "tlongnames.hdf"
 #define NONAMECLASS  "tundefined.hdf"
+#define FINDNAMES    "tfindnames.hdf"
 #define VGROUP1      "VGROUP1"
 #define VG_LONGNAME  "Vgroup with more than 64 characters in length, 74 characters to be exact!"
 #define VG_LONGCLASS "Very long class name to classify all Vgroups with more than 64 characters in name"
@@ -338,6 +339,154 @@ test_vgisinternal()
     CHECK_VOID(status, FAIL, "Hclose");
 } /* test_vgisinternal */
 
+/****************************************************************************
+ * test_vfindnames
+ *   - Create vgroups and vdatas, some with the same name
+ *   - Verify that Vfind and VSfind find the first of them, and keep doing so
+ *     as they are created, renamed and deleted after the first search
+ *   - Re-open the file and verify that the names are found again
+ ****************************************************************************/
+
+/* Create a vgroup or a vdata with a name, and get its ref */
+static void
+make_named(int32 file_id, int vgroup, const char *name, int32 *ref)
+{
+    int32 id;
+    int32 value = 1;
+    int32 status;
+
+    if (vgroup) {
+        id = Vattach(file_id, -1, "w");
+        CHECK_VOID(id, FAIL, "Vattach");
+        status = Vsetname(id, name);
+        CHECK_VOID(status, FAIL, "Vsetname");
+        *ref   = VQueryref(id);
+        status = Vdetach(id);
+        CHECK_VOID(status, FAIL, "Vdetach");
+    }
+    else {
+        id = VSattach(file_id, -1, "w");
+        CHECK_VOID(id, FAIL, "VSattach");
+        status = VSsetname(id, name);
+        CHECK_VOID(status, FAIL, "VSsetname");
+        status = VSfdefine(id, "value", DFNT_INT32, 1);
+        CHECK_VOID(status, FAIL, "VSfdefine");
+        status = VSsetfields(id, "value");
+        CHECK_VOID(status, FAIL, "VSsetfields");
+        status = VSwrite(id, (uint8 *)&value, 1, FULL_INTERLACE);
+        CHECK_VOID(status, FAIL, "VSwrite");
+        *ref   = VSQueryref(id);
+        status = VSdetach(id);
+        CHECK_VOID(status, FAIL, "VSdetach");
+    }
+} /* make_named */
+
+static void
+test_vfindnames(void)
+{
+    int32 file_id;       /* File ID */
+    int32 id;            /* Vgroup or vdata ID */
+    int32 vg1, vg2, vg3; /* Vgroup refs */
+    int32 vs1, vs2, vs3; /* Vdata refs */
+    int32 ref;           /* Ref found by name */
+    int32 status;        /* Status values from routines */
+
+    /* Create the file with two vgroups and two vdatas */
+    file_id = Hopen(FINDNAMES, DFACC_CREATE, 0);
+    CHECK_VOID(file_id, FAIL, "Hopen");
+    status = Vstart(file_id);
+    CHECK_VOID(status, FAIL, "Vstart");
+
+    make_named(file_id, TRUE, "vgroup A", &vg1);
+    make_named(file_id, TRUE, "vgroup B", &vg2);
+    make_named(file_id, FALSE, "vdata A", &vs1);
+    make_named(file_id, FALSE, "vdata B", &vs2);
+
+    /* The first searches index the names */
+    ref = Vfind(file_id, "vgroup A");
+    VERIFY_VOID(ref, vg1, "Vfind");
+    ref = Vfind(file_id, "vgroup B");
+    VERIFY_VOID(ref, vg2, "Vfind");
+    ref = Vfind(file_id, "vgroup C");
+    VERIFY_VOID(ref, 0, "Vfind");
+    ref = VSfind(file_id, "vdata A");
+    VERIFY_VOID(ref, vs1, "VSfind");
+    ref = VSfind(file_id, "vdata B");
+    VERIFY_VOID(ref, vs2, "VSfind");
+    ref = VSfind(file_id, "vdata C");
+    VERIFY_VOID(ref, 0, "VSfind");
+
+    /* Objects created later with the same name don't hide the first ones */
+    make_named(file_id, TRUE, "vgroup A", &vg3);
+    make_named(file_id, FALSE, "vdata A", &vs3);
+    ref = Vfind(file_id, "vgroup A");
+    VERIFY_VOID(ref, vg1, "Vfind");
+    ref = VSfind(file_id, "vdata A");
+    VERIFY_VOID(ref, vs1, "VSfind");
+
+    /* Renamed objects are found by their new names only */
+    id = Vattach(file_id, vg1, "w");
+    CHECK_VOID(id, FAIL, "Vattach");
+    status = Vsetname(id, "vgroup C");
+    CHECK_VOID(status, FAIL, "Vsetname");
+    status = Vdetach(id);
+    CHECK_VOID(status, FAIL, "Vdetach");
+    ref = Vfind(file_id, "vgroup A");
+    VERIFY_VOID(ref, vg3, "Vfind");
+    ref = Vfind(file_id, "vgroup C");
+    VERIFY_VOID(ref, vg1, "Vfind");
+
+    id = VSattach(file_id, vs1, "w");
+    CHECK_VOID(id, FAIL, "VSattach");
+    status = VSsetname(id, "vdata C");
+    CHECK_VOID(status, FAIL, "VSsetname");
+    status = VSdetach(id);
+    CHECK_VOID(status, FAIL, "VSdetach");
+    ref = VSfind(file_id, "vdata A");
+    VERIFY_VOID(ref, vs3, "VSfind");
+    ref = VSfind(file_id, "vdata C");
+    VERIFY_VOID(ref, vs1, "VSfind");
+
+    /* Deleted objects aren't found */
+    status = Vdelete(file_id, vg3);
+    CHECK_VOID(status, FAIL, "Vdelete");
+    status = VSdelete(file_id, vs3);
+    CHECK_VOID(status, FAIL, "VSdelete");
+    ref = Vfind(file_id, "vgroup A");
+    VERIFY_VOID(ref, 0, "Vfind");
+    ref = VSfind(file_id, "vdata A");
+    VERIFY_VOID(ref, 0, "VSfind");
+
+    status = Vend(file_id);
+    CHECK_VOID(status, FAIL, "Vend");
+    status = Hclose(file_id);
+    CHECK_VOID(status, FAIL, "Hclose");
+
+    /* Re-open the file and find the objects again */
+    file_id = Hopen(FINDNAMES, DFACC_READ, 0);
+    CHECK_VOID(file_id, FAIL, "Hopen");
+    status = Vstart(file_id);
+    CHECK_VOID(status, FAIL, "Vstart");
+
+    ref = Vfind(file_id, "vgroup A");
+    VERIFY_VOID(ref, 0, "Vfind");
+    ref = Vfind(file_id, "vgroup B");
+    VERIFY_VOID(ref, vg2, "Vfind");
+    ref = Vfind(file_id, "vgroup C");
+    VERIFY_VOID(ref, vg1, "Vfind");
+    ref = VSfind(file_id, "vdata A");
+    VERIFY_VOID(ref, 0, "VSfind");
+    ref = VSfind(file_id, "vdata B");
+    VERIFY_VOID(ref, vs2, "VSfind");
+    ref = VSfind(file_id, "vdata C");
+    VERIFY_VOID(ref, vs1, "VSfind");
+
+    status = Vend(file_id);
+    CHECK_VOID(status, FAIL, "Vend");
+    status = Hclose(file_id);
+    CHECK_VOID(status, FAIL, "Hclose");
+} /* test_vfindnames */
+
 void
 test_vnameclass(void)
 {
@@ -349,4 +498,7 @@ test_vnameclass(void)
 
     /* test Vgisinternal when there is no class name */
     test_vgisinternal();
+
+    /* test Vfind and VSfind as vgroups and vdatas are created, renamed and deleted */
+    test_vfindnames();
 } /* test_vnameclass */
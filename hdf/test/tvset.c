@@ -66,6 +66,8 @@ static void  test_getvdatas(void);
 static void  test_blockinfo_oneLB(void);
 static void  test_blockinfo_multLBs(void);
 static void  test_VSofclass(void);
+static void  test_nativeread(void);
+static void  test_readplan(void);
 
 /* write some stuff to the file */
 static int32
@@ -2831,6 +2833,279 @@ test_extfile(void)
 
 } /* test_extfile() */
 
+/*************************** test_nativeread ***************************
+
+This test routine creates an hdf file, "tvsnative.hdf", with a vdata of
+native and 8-bit fields, whose records VSread returns without converting
+them, and checks the records read with all of the fields, from the middle
+of the vdata, and with only some of the fields, also after limiting the
+record buffer with VSsetscratchmax.
+
+***********************************************************************/
+
+#define NATIVEFILE   "tvsnative.hdf"
+#define NATIVE_NRECS 100
+#define NATIVE_RSIZE (2 * 4 + 8 + 3) /* size of a record of the vdata */
+
+static void
+test_nativeread(void)
+{
+    int32 fid, vsid;
+    int32 status;
+    int32 scratchmax;
+    uint8 records[NATIVE_NRECS * NATIVE_RSIZE];
+    uint8 rbuf[NATIVE_NRECS * NATIVE_RSIZE];
+
+    for (int i = 0; i < NATIVE_NRECS * NATIVE_RSIZE; i++)
+        records[i] = (uint8)(i * 7 + 3);
+
+    /* Create the vdata; field A has two native int32s, B a native float64
+       and C three uint8s */
+    fid = Hopen(NATIVEFILE, DFACC_CREATE, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+    status = Vstart(fid);
+    CHECK_VOID(status, FAIL, "Vstart");
+
+    vsid = VSattach(fid, -1, "w");
+    CHECK_VOID(vsid, FAIL, "VSattach");
+    status = VSfdefine(vsid, "A", DFNT_NATIVE | DFNT_INT32, 2);
+    CHECK_VOID(status, FAIL, "VSfdefine");
+    status = VSfdefine(vsid, "B", DFNT_NATIVE | DFNT_FLOAT64, 1);
+    CHECK_VOID(status, FAIL, "VSfdefine");
+    status = VSfdefine(vsid, "C", DFNT_UINT8, 3);
+    CHECK_VOID(status, FAIL, "VSfdefine");
+    status = VSsetfields(vsid, "A,B,C");
+    CHECK_VOID(status, FAIL, "VSsetfields");
+    status = VSwrite(vsid, records, NATIVE_NRECS, FULL_INTERLACE);
+    VERIFY_VOID(status, NATIVE_NRECS, "VSwrite");
+    status = VSdetach(vsid);
+    CHECK_VOID(status, FAIL, "VSdetach");
+
+    status = Vend(fid);
+    CHECK_VOID(status, FAIL, "Vend");
+    status = Hclose(fid);
+    CHECK_VOID(status, FAIL, "Hclose");
+
+    fid = Hopen(NATIVEFILE, DFACC_RDONLY, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+    status = Vstart(fid);
+    CHECK_VOID(status, FAIL, "Vstart");
+
+    vsid = VSattach(fid, VSgetid(fid, -1), "r");
+    CHECK_VOID(vsid, FAIL, "VSattach");
+
+    /* Read all of the records */
+    status = VSsetfields(vsid, "A,B,C");
+    CHECK_VOID(status, FAIL, "VSsetfields");
+    memset(rbuf, 0, sizeof(rbuf));
+    status = VSread(vsid, rbuf, NATIVE_NRECS, FULL_INTERLACE);
+    VERIFY_VOID(status, NATIVE_NRECS, "VSread");
+    if (memcmp(rbuf, records, sizeof(records)) != 0) {
+        num_errs++;
+        printf(">>> Wrong records read from the native vdata\n");
+    }
+
+    /* Read some of the records from the middle */
+    status = VSseek(vsid, 10);
+    VERIFY_VOID(status, 10, "VSseek");
+    memset(rbuf, 0, sizeof(rbuf));
+    status = VSread(vsid, rbuf, 5, FULL_INTERLACE);
+    VERIFY_VOID(status, 5, "VSread");
+    if (memcmp(rbuf, records + 10 * NATIVE_RSIZE, 5 * NATIVE_RSIZE) != 0) {
+        num_errs++;
+        printf(">>> Wrong records read from the middle of the native vdata\n");
+    }
+
+    /* Read only fields C and A, which are shuffled into the buffer */
+    status = VSseek(vsid, 0);
+    VERIFY_VOID(status, 0, "VSseek");
+    status = VSsetfields(vsid, "C,A");
+    CHECK_VOID(status, FAIL, "VSsetfields");
+    memset(rbuf, 0, sizeof(rbuf));
+    status = VSread(vsid, rbuf, NATIVE_NRECS, FULL_INTERLACE);
+    VERIFY_VOID(status, NATIVE_NRECS, "VSread");
+    for (int i = 0; i < NATIVE_NRECS; i++) {
+        const uint8 *rec = records + i * NATIVE_RSIZE;
+
+        if (memcmp(rbuf + i * 11, rec + 16, 3) != 0 || memcmp(rbuf + i * 11 + 3, rec, 8) != 0) {
+            num_errs++;
+            printf(">>> Wrong fields C,A read from record %d of the native vdata\n", i);
+            break;
+        }
+    }
+
+    /* Read them again without interlacing, keeping no record buffer
+       between calls */
+    status = VSgetscratchmax(&scratchmax);
+    CHECK_VOID(status, FAIL, "VSgetscratchmax");
+    VERIFY_VOID(scratchmax, VDATA_SCRATCH_MAX, "VSgetscratchmax");
+    status = VSsetscratchmax(-1);
+    VERIFY_VOID(status, FAIL, "VSsetscratchmax");
+    status = VSsetscratchmax(0);
+    CHECK_VOID(status, FAIL, "VSsetscratchmax");
+
+    status = VSseek(vsid, 0);
+    VERIFY_VOID(status, 0, "VSseek");
+    memset(rbuf, 0, sizeof(rbuf));
+    status = VSread(vsid, rbuf, NATIVE_NRECS, NO_INTERLACE);
+    VERIFY_VOID(status, NATIVE_NRECS, "VSread");
+    for (int i = 0; i < NATIVE_NRECS; i++) {
+        const uint8 *rec = records + i * NATIVE_RSIZE;
+
+        if (memcmp(rbuf + i * 3, rec + 16, 3) != 0 || memcmp(rbuf + NATIVE_NRECS * 3 + i * 8, rec, 8) != 0) {
+            num_errs++;
+            printf(">>> Wrong fields C,A read without interlacing from record %d\n", i);
+            break;
+        }
+    }
+
+    status = VSsetscratchmax(VDATA_SCRATCH_MAX);
+    CHECK_VOID(status, FAIL, "VSsetscratchmax");
+
+    status = VSdetach(vsid);
+    CHECK_VOID(status, FAIL, "VSdetach");
+    status = Vend(fid);
+    CHECK_VOID(status, FAIL, "Vend");
+    status = Hclose(fid);
+    CHECK_VOID(status, FAIL, "Hclose");
+} /* test_nativeread() */
+
+/*************************** test_readplan ***************************
+
+This test routine creates an hdf file, "tvsplan.hdf", with two vdatas of
+fields of different number types and orders, one stored with full
+interlace and one without, and checks the records read from them with
+all of the fields, with fields merged into one run, and with some of the
+fields in another order, into buffers with both interlaces.  There are
+enough records for full interlaced reads to take several blocks.
+
+***********************************************************************/
+
+#define PLANFILE   "tvsplan.hdf"
+#define PLAN_NRECS 40000
+#define PLAN_RSIZE (3 * 2 + 2 * 8 + 1 + 2 * 4 + 4) /* size of a record in memory */
+
+static void
+test_readplan(void)
+{
+    /* The fields, in order, and where they are in a record in memory */
+    static const struct {
+        const char *name;
+        int32       type;
+        int32       order;
+        int         off;
+        int         size;
+    } pfields[] = {
+        {"A", DFNT_INT16, 3, 0, 6},   {"B", DFNT_FLOAT64, 2, 6, 16}, {"C", DFNT_UINT8, 1, 22, 1},
+        {"D", DFNT_INT32, 2, 23, 8}, {"E", DFNT_UINT32, 1, 31, 4},
+    };
+    static const char *lists[][6] = {
+        {"A,B,C,D,E", "A", "B", "C", "D", "E"}, {"D,E", "D", "E"}, {"E,B,A", "E", "B", "A"}};
+    static const int   nlists[]   = {5, 2, 3};
+    int32              fid, vsid, ref[2];
+    int32              status;
+    uint8             *records = NULL, *rbuf = NULL, *expect = NULL;
+
+    records = (uint8 *)malloc(PLAN_NRECS * PLAN_RSIZE);
+    rbuf    = (uint8 *)malloc(PLAN_NRECS * PLAN_RSIZE);
+    expect  = (uint8 *)malloc(PLAN_NRECS * PLAN_RSIZE);
+    CHECK_ALLOC(records, "records", "test_readplan");
+    CHECK_ALLOC(rbuf, "rbuf", "test_readplan");
+    CHECK_ALLOC(expect, "expect", "test_readplan");
+    for (int i = 0; i < PLAN_NRECS * PLAN_RSIZE; i++)
+        records[i] = (uint8)(i * 13 + i / 251);
+
+    fid = Hopen(PLANFILE, DFACC_CREATE, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+    status = Vstart(fid);
+    CHECK_VOID(status, FAIL, "Vstart");
+
+    for (int v = 0; v < 2; v++) {
+        vsid = VSattach(fid, -1, "w");
+        CHECK_VOID(vsid, FAIL, "VSattach");
+        for (int f = 0; f < 5; f++) {
+            status = VSfdefine(vsid, pfields[f].name, pfields[f].type, pfields[f].order);
+            CHECK_VOID(status, FAIL, "VSfdefine");
+        }
+        status = VSsetinterlace(vsid, v == 0 ? FULL_INTERLACE : NO_INTERLACE);
+        CHECK_VOID(status, FAIL, "VSsetinterlace");
+        status = VSsetfields(vsid, lists[0][0]);
+        CHECK_VOID(status, FAIL, "VSsetfields");
+        status = VSwrite(vsid, records, PLAN_NRECS, FULL_INTERLACE);
+        VERIFY_VOID(status, PLAN_NRECS, "VSwrite");
+        ref[v] = VSQueryref(vsid);
+        status = VSdetach(vsid);
+        CHECK_VOID(status, FAIL, "VSdetach");
+    }
+
+    status = Vend(fid);
+    CHECK_VOID(status, FAIL, "Vend");
+    status = Hclose(fid);
+    CHECK_VOID(status, FAIL, "Hclose");
+
+    fid = Hopen(PLANFILE, DFACC_RDONLY, 0);
+    CHECK_VOID(fid, FAIL, "Hopen");
+    status = Vstart(fid);
+    CHECK_VOID(status, FAIL, "Vstart");
+
+    for (int v = 0; v < 2; v++) {
+        vsid = VSattach(fid, ref[v], "r");
+        CHECK_VOID(vsid, FAIL, "VSattach");
+
+        for (int l = 0; l < 3; l++) {
+            status = VSsetfields(vsid, lists[l][0]);
+            CHECK_VOID(status, FAIL, "VSsetfields");
+
+            for (int ui = 0; ui < 2; ui++) {
+                int32  interlace = ui == 0 ? FULL_INTERLACE : NO_INTERLACE;
+                int    uvsize    = 0;
+                uint8 *e         = expect;
+
+                /* Lay out the fields read as the buffer's interlace puts them */
+                for (int j = 1; j <= nlists[l]; j++)
+                    for (int f = 0; f < 5; f++)
+                        if (strcmp(lists[l][j], pfields[f].name) == 0)
+                            uvsize += pfields[f].size;
+                for (int j = 1; j <= nlists[l]; j++)
+                    for (int f = 0; f < 5; f++) {
+                        if (strcmp(lists[l][j], pfields[f].name) != 0)
+                            continue;
+                        for (int i = 0; i < PLAN_NRECS; i++) {
+                            uint8 *dst = interlace == FULL_INTERLACE ? expect + i * uvsize + (e - expect)
+                                                                     : e + i * pfields[f].size;
+
+                            memcpy(dst, records + i * PLAN_RSIZE + pfields[f].off, (size_t)pfields[f].size);
+                        }
+                        e += interlace == FULL_INTERLACE ? pfields[f].size : PLAN_NRECS * pfields[f].size;
+                    }
+
+                status = VSseek(vsid, 0);
+                VERIFY_VOID(status, 0, "VSseek");
+                memset(rbuf, 0, PLAN_NRECS * PLAN_RSIZE);
+                status = VSread(vsid, rbuf, PLAN_NRECS, interlace);
+                VERIFY_VOID(status, PLAN_NRECS, "VSread");
+                if (memcmp(rbuf, expect, (size_t)(PLAN_NRECS * uvsize)) != 0) {
+                    num_errs++;
+                    printf(">>> Wrong fields %s read with interlace %d from vdata with interlace %d\n",
+                           lists[l][0], (int)interlace, v == 0 ? FULL_INTERLACE : NO_INTERLACE);
+                }
+            }
+        }
+
+        status = VSdetach(vsid);
+        CHECK_VOID(status, FAIL, "VSdetach");
+    }
+
+    status = Vend(fid);
+    CHECK_VOID(status, FAIL, "Vend");
+    status = Hclose(fid);
+    CHECK_VOID(status, FAIL, "Hclose");
+
+    free(records);
+    free(rbuf);
+    free(expect);
+} /* test_readplan() */
+
 /****************************************************************************
    Name: test_blockinfo_oneLB() - tests setting/getting block info in the
                            simple case, only one linked block storage occur
@@ -3385,6 +3660,12 @@ test_vsets(void)
 
     /* test_extfile - getting external file information */
     test_extfile();
+
+    /* test_nativeread - reading records which need no conversion */
+    test_nativeread();
+
+    /* test_readplan - reading fields of several types with both interlaces */
+    test_readplan();
 } /* test_vsets */
 
 /* TODO:
@@ -79,9 +79,9 @@ main(int argc, char *argv[])
     if (aid != FAIL) {
         do {
             n++; /* increment the number of images found */
-            Hinquire(aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length, &image_desc.offset,
-                     NULL, NULL, NULL);
-            if (Hread(aid, image_desc.length, file_buf) != image_desc.length) {
+            Hinquire64(aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length, &image_desc.offset,
+                       NULL, NULL, NULL);
+            if (Hread(aid, (int32)image_desc.length, file_buf) != image_desc.length) {
                 printf("Error reading %d'th JPEG image from HDF file\n", n);
                 exit(1);
             } /* end if */
@@ -102,8 +102,8 @@ main(int argc, char *argv[])
                 exit(1);
             } /* end if */
             data_aid = Hstartread(fid, DFTAG_CI, image_desc.ref);
-            Hinquire(data_aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length, &image_desc.offset,
-                     NULL, NULL, NULL);
+            Hinquire64(data_aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length,
+                       &image_desc.offset, NULL, NULL, NULL);
             while (image_desc.length > MAX_FILE_BUF) {
                 if (Hread(data_aid, MAX_FILE_BUF, file_buf) != (int32)(MAX_FILE_BUF)) {
                     printf("Error reading JPEG image data from HDF file\n");
@@ -116,7 +116,7 @@ main(int argc, char *argv[])
                 image_desc.length -= MAX_FILE_BUF;
             } /* end while */
             if (image_desc.length > 0) {
-                if (Hread(data_aid, image_desc.length, file_buf) != (int32)(image_desc.length)) {
+                if (Hread(data_aid, (int32)image_desc.length, file_buf) != (int32)(image_desc.length)) {
                     printf("Error reading JPEG image data from HDF file\n");
                     exit(1);
                 } /* end if */
@@ -138,9 +138,9 @@ main(int argc, char *argv[])
     if (aid != FAIL) {
         do {
             n++; /* increment the number of images found */
-            Hinquire(aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length, &image_desc.offset,
-                     NULL, NULL, NULL);
-            if (Hread(aid, image_desc.length, file_buf) != image_desc.length) {
+            Hinquire64(aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length, &image_desc.offset,
+                       NULL, NULL, NULL);
+            if (Hread(aid, (int32)image_desc.length, file_buf) != image_desc.length) {
                 printf("Error reading %d'th JPEG image from HDF file\n", n);
                 exit(1);
             } /* end if */
@@ -161,8 +161,8 @@ main(int argc, char *argv[])
                 exit(1);
             } /* end if */
             data_aid = Hstartread(fid, DFTAG_CI, image_desc.ref);
-            Hinquire(data_aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length, &image_desc.offset,
-                     NULL, NULL, NULL);
+            Hinquire64(data_aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length,
+                       &image_desc.offset, NULL, NULL, NULL);
             while (image_desc.length > MAX_FILE_BUF) {
                 if (Hread(data_aid, MAX_FILE_BUF, file_buf) != (int32)(MAX_FILE_BUF)) {
                     printf("Error reading JPEG image data from HDF file\n");
@@ -175,7 +175,7 @@ main(int argc, char *argv[])
                 image_desc.length -= MAX_FILE_BUF;
             } /* end while */
             if (image_desc.length > 0) {
-                if (Hread(data_aid, image_desc.length, file_buf) != (int32)(image_desc.length)) {
+                if (Hread(data_aid, (int32)image_desc.length, file_buf) != (int32)(image_desc.length)) {
                     printf("Error reading JPEG image data from HDF file\n");
                     exit(1);
                 } /* end if */
@@ -197,8 +197,8 @@ main(int argc, char *argv[])
     aid = Hstartread(fid, DFTAG_JPEG5, DFREF_WILDCARD);
     if (aid != FAIL) {
         do {
-            Hinquire(aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length, &image_desc.offset,
-                     NULL, NULL, NULL);
+            Hinquire64(aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length, &image_desc.offset,
+                       NULL, NULL, NULL);
             n++; /* increment the number of images found */
             if (jfif_formatted == TRUE) {
                 sprintf(scratch, jfif_name, image_desc.ref);
@@ -212,8 +212,8 @@ main(int argc, char *argv[])
                 exit(1);
             } /* end if */
             data_aid = Hstartread(fid, DFTAG_CI, image_desc.ref);
-            Hinquire(data_aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length, &image_desc.offset,
-                     NULL, NULL, NULL);
+            Hinquire64(data_aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length,
+                       &image_desc.offset, NULL, NULL, NULL);
             while (image_desc.length > MAX_FILE_BUF) {
                 if (Hread(data_aid, MAX_FILE_BUF, file_buf) != (int32)(MAX_FILE_BUF)) {
                     printf("Error reading JPEG image data from HDF file\n");
@@ -226,7 +226,7 @@ main(int argc, char *argv[])
                 image_desc.length -= MAX_FILE_BUF;
             } /* end while */
             if (image_desc.length > 0) {
-                if (Hread(data_aid, image_desc.length, file_buf) != (int32)(image_desc.length)) {
+                if (Hread(data_aid, (int32)image_desc.length, file_buf) != (int32)(image_desc.length)) {
                     printf("Error reading JPEG image data from HDF file\n");
                     exit(1);
                 } /* end if */
@@ -249,8 +249,8 @@ main(int argc, char *argv[])
     if (aid != FAIL) {
         do {
             n++; /* increment the number of images found */
-            Hinquire(aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length, &image_desc.offset,
-                     NULL, NULL, NULL);
+            Hinquire64(aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length, &image_desc.offset,
+                       NULL, NULL, NULL);
             if (jfif_formatted == TRUE) {
                 sprintf(scratch, jfif_name, image_desc.ref);
                 jfif_file = fopen(scratch, "wb");
@@ -263,8 +263,8 @@ main(int argc, char *argv[])
                 exit(1);
             } /* end if */
             data_aid = Hstartread(fid, DFTAG_CI, image_desc.ref);
-            Hinquire(data_aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length, &image_desc.offset,
-                     NULL, NULL, NULL);
+            Hinquire64(data_aid, NULL, &image_desc.tag, &image_desc.ref, &image_desc.length,
+                       &image_desc.offset, NULL, NULL, NULL);
             while (image_desc.length > MAX_FILE_BUF) {
                 if (Hread(data_aid, MAX_FILE_BUF, file_buf) != (int32)(MAX_FILE_BUF)) {
                     printf("Error reading JPEG image data from HDF file\n");
@@ -277,7 +277,7 @@ main(int argc, char *argv[])
                 image_desc.length -= MAX_FILE_BUF;
             } /* end while */
             if (image_desc.length > 0) {
-                if (Hread(data_aid, image_desc.length, file_buf) != (int32)(image_desc.length)) {
+                if (Hread(data_aid, (int32)image_desc.length, file_buf) != (int32)(image_desc.length)) {
                     printf("Error reading JPEG image data from HDF file\n");
                     exit(1);
                 } /* end if */
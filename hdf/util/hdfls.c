@@ -66,7 +66,7 @@ print_item(int32 fid, dd_t *desc_list, int n)
     int32 len;
     char *name, *label_str;
 
-    printf("\tRef no %6d\t%8d bytes\n", (int)desc_list[n].ref, (int)desc_list[n].length);
+    printf("\tRef no %6d\t%8ld bytes\n", (int)desc_list[n].ref, (long)desc_list[n].length);
 
     /* print out labels and annotations if desired */
     if (labels) { /* read in all of the labels */
@@ -522,8 +522,8 @@ main(int argc, char *argv[])
 
         status = SUCCEED;
         for (n = 0; (n < MAXBUFF) && (status != FAIL); n++) {
-            Hinquire(aid, NULL, &desc_buf[n].tag, &desc_buf[n].ref, &desc_buf[n].length, &desc_buf[n].offset,
-                     NULL, NULL, NULL);
+            Hinquire64(aid, NULL, &desc_buf[n].tag, &desc_buf[n].ref, &desc_buf[n].length,
+                       &desc_buf[n].offset, NULL, NULL, NULL);
             status = Hnextread(aid, DFTAG_WILDCARD, DFREF_WILDCARD, DF_CURRENT);
         }
 
@@ -531,7 +531,7 @@ main(int argc, char *argv[])
             printf("\n");
             for (j = 0; j < n; j++) {
                 printf("%6d) tag %6d ref %6d ", j, desc_buf[j].tag, desc_buf[j].ref);
-                printf(" offset %10d length %10d\n", (int)desc_buf[j].offset, (int)desc_buf[j].length);
+                printf(" offset %10ld length %10ld\n", (long)desc_buf[j].offset, (long)desc_buf[j].length);
             }
         }
 
@@ -110,6 +110,10 @@ NC_attrarray(int cdfid, int varid)
     else if (handle->vars != NULL && varid >= 0 && (unsigned)varid < handle->vars->count) {
         ap = (NC_array **)handle->vars->values;
         ap += varid;
+        if (((NC_var *)(*ap))->unread && hdf_load_var(handle, varid) == FAIL) {
+            NCadvise(NC_EINVAL, "can't read in variable %d", varid);
+            return NULL;
+        }
         ap = &(((NC_var *)(*ap))->attrs); /* Whew! */
     }
     else {
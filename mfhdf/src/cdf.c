@@ -18,6 +18,7 @@
 #include "herr_priv.h"
 
 #include "hfile_priv.h"
+#include "hthread_priv.h"
 
 int32 hdf_get_magicnum(const char *filename);
 
@@ -31,6 +32,17 @@ static int NC_free_xcdf(NC *);
 /* hmm we write the NDG out always for now */
 #define WRITE_NDG 1
 
+/* What hdf_read_var() carries over from one variable to the next */
+typedef struct {
+    int32         HDFtype;  /* HDF number type */
+    int32         ndg_ref;  /* ref of the NDG */
+    hdf_vartype_t var_type; /* SDS or coordinate variable */
+    int32         vh_ref;   /* ref of the Vdata var_type is still to be read from, or 0 */
+} hdf_varstate_t;
+
+/* How much of each variable is read in when a file is opened read-only */
+static int hdf_metaload = SD_META_ALL;
+
 /*
  * Free the resources that xdr_cdf allocates
  */
@@ -46,6 +58,8 @@ NC_free_xcdf(NC *handle)
             HGOTO_FAIL(FAIL);
         if (NC_free_array(handle->vars) == FAIL)
             HGOTO_FAIL(FAIL);
+        HNIdestroy(handle->var_names);
+        handle->var_names = NULL;
     }
 
 done:
@@ -1494,301 +1508,461 @@ done:
 } /* hdf_read_attrs */
 
 /* ----------------------------------------------------------------
-** Read in the variables out of a cdf structure
+** Set *var_type by the class of the Vdata whose ref is ref
+** Return FAIL if something goes wrong
+*/
+static int
+hdf_read_vartype(NC *handle, int32 ref, hdf_vartype_t *var_type)
+{
+    char  vsclass[H4_MAX_NC_CLASS] = "";
+    int32 vs                       = FAIL;
+    int   ret_value                = SUCCEED;
+
+    vs = VSattach(handle->hdf_file, ref, "r");
+    if (FAIL == vs)
+        HGOTO_FAIL(FAIL);
+
+    if (FAIL == VSgetclass(vs, vsclass))
+        HGOTO_FAIL(FAIL);
+
+    if (!strcmp(vsclass, _HDF_SDSVAR))
+        *var_type = IS_SDSVAR;
+    else if (!strcmp(vsclass, _HDF_CRDVAR))
+        *var_type = IS_CRDVAR;
+    else
+        *var_type = UNKNOWN;
+
+done:
+    if (vs != FAIL && FAIL == VSdetach(vs))
+        ret_value = FAIL;
+
+    return ret_value;
+} /* hdf_read_vartype */
+
+/* ----------------------------------------------------------------
+** Read in the number type whose ref is ref into state->HDFtype and
+**   *typep
+** Return FAIL if something goes wrong
+** Set *skip to TRUE if the data is in the native format of another
+**   type of machine, so that the variable has to be skipped
+*/
+static int
+hdf_read_nt(NC *handle, int32 ref, hdf_varstate_t *state, nc_type *typep, int *skip)
+{
+    uint8 ntstring[4];
+    int   ret_value = SUCCEED;
+
+    *skip = FALSE;
+
+    if (Hgetelement(handle->hdf_file, DFTAG_NT, ref, ntstring) == FAIL) {
+        HGOTO_FAIL(FAIL);
+    }
+
+    state->HDFtype = ntstring[1];
+    if ((*typep = hdf_unmap_type(state->HDFtype)) == FAIL) {
+        HGOTO_FAIL(FAIL);
+    }
+
+    /*
+     * Check if data was stored in native format
+     * And make sure the numbertype version numbers are the same
+     */
+    if ((ntstring[0] != DFNT_VERSION) || ((ntstring[3] != DFNTF_NONE) && (ntstring[3] != DFNTF_IEEE))) {
+
+        /* check if in native mode for a different type of machine  or external data
+         * file is LITEND */
+        if (ntstring[3] == DFNTF_PC)
+            state->HDFtype |= DFNT_LITEND;
+        else {
+            if (ntstring[3] != (uint8)DFKgetPNSC(state->HDFtype, DF_MT)) {
+                /*
+                 * OK, we have a problem here --- is in native mode
+                 * for a different machine.  PUNT
+                 */
+                *skip = TRUE;
+            }
+            else {
+                /*
+                 * Is in native mode but its OK --- same machine type
+                 */
+                state->HDFtype |= DFNT_NATIVE;
+            }
+        }
+    }
+
+done:
+    return ret_value;
+} /* hdf_read_nt */
+
+/* ----------------------------------------------------------------
+** Read in one variable out of its attached Vgroup var, whose ref is id
 ** Return FAIL if something goes wrong
+** Set *vpp to the variable, or to NULL if it has to be skipped
 **
-** Important:  We must already assume that handle->dims is set
-**   so that we can do a call to NC_var_shape() so that we can
-**   set the numrecs fields of variables (so we can fill record
-**   variables intelligently)
+** state holds what is carried over to the next variable when a
+**   variable's Vgroup doesn't have its own
 */
-int
-hdf_read_vars(XDR *xdrs, NC *handle, int32 vg)
+static int
+hdf_read_var(XDR *xdrs, NC *handle, int32 var, int32 id, hdf_varstate_t *state, NC_var **vpp)
 {
     char vgname[H4_MAX_NC_NAME]  = "";
     char subname[H4_MAX_NC_NAME] = "";
-    char class[H4_MAX_NC_CLASS]  = "";
-    NC_var      **variables      = NULL;
-    NC_var       *vp             = NULL;
-    int           ndims, *dims = NULL;
-    uint8         ntstring[4];
-    int           data_ref, is_rec_var, vg_size, count;
-    int32         data_count;
-    int32         HDFtype = FAIL;
-    int32         tag;
-    int32         id;
-    int32         n;
-    int32         sub_id;
-    int32         entries;
-    int32         ndg_ref = 0;
-    int32         rag_ref = 0;
-    int           nattrs;
-    hdf_vartype_t var_type = UNKNOWN;
-    int           t, i;
-    nc_type       type;
-    int32         var, sub;
-    int           ret_value = SUCCEED;
+    NC_var *vp                   = NULL;
+    int     ndims, *dims = NULL;
+    int     skip;
+    int     data_ref, is_rec_var;
+    int32   data_count;
+    int32   tag;
+    int32   n;
+    int32   sub_id;
+    int32   entries;
+    int32   rag_ref = 0;
+    int     nattrs;
+    int     t;
+    nc_type type;
+    int32   sub;
+    int     ret_value = SUCCEED;
 
-    count = 0;
-    id    = -1;
+    *vpp = NULL;
 
     /*
-     * Allocate enough space in case everything is a variable
+     * We have found a VGroup representing a Variable or a
+     * a Coordinate Variable
      */
-    count     = 0;
-    variables = malloc(sizeof(NC_var *) * (size_t)Vntagrefs(vg) + 1);
-    if (NULL == variables) {
+    ndims      = 0;
+    type       = NC_UNSPECIFIED;
+    data_ref   = 0;
+    data_count = 0;
+    rag_ref    = 0;
+    is_rec_var = FALSE;
+
+    if (Vinquire(var, &n, vgname) == FAIL) {
         HGOTO_FAIL(FAIL);
     }
 
     /*
-     * Allocate enough space in case lots of dimensions
+     * Allocate enough space in case everything is a dimension
      */
-    dims = malloc(sizeof(int) * (size_t)Vntagrefs(vg) + 1);
+    dims = malloc(sizeof(int) * (size_t)n + 1);
     if (NULL == dims) {
         HGOTO_FAIL(FAIL);
     }
 
     /*
-     * Look through for a Vgroup of class _HDF_VARIABLE
+     * Loop through contents looking for dimensions
      */
-    if ((vg_size = Vntagrefs(vg)) == FAIL)
-        HGOTO_FAIL(FAIL);
-
-    for (i = 0; i < vg_size; i++) {
-        if (Vgettagref(vg, i, &tag, &id) == FAIL) {
+    for (t = 0; t < n; t++) {
+        char dimclass[H4_MAX_NC_CLASS] = "";
+        if (Vgettagref(var, t, &tag, &sub_id) == FAIL) {
             HGOTO_FAIL(FAIL);
         }
 
-        if (tag == DFTAG_VG) {
-            var = Vattach(handle->hdf_file, id, "r");
-            if (var == FAIL)
-                continue; /* isn't this bad? -GV */
-
-            if (Vgetclass(var, class) == FAIL) {
-                HGOTO_FAIL(FAIL);
-            }
-
-            /* Process as below if this VGroup represents a Variable or
-            a Coordinate Variable */
-            if (!strcmp(class, _HDF_VARIABLE)) {
+        switch (tag) {
+            case DFTAG_VG: /* ------ V G R O U P ---------- */
+                sub = Vattach(handle->hdf_file, sub_id, "r");
+                if (FAIL == sub) {
+                    HGOTO_FAIL(FAIL);
+                }
 
-                /*
-                 * We have found a VGroup representing a Variable or a
-                 * a Coordinate Variable
-                 */
-                ndims      = 0;
-                type       = NC_UNSPECIFIED;
-                data_ref   = 0;
-                data_count = 0;
-                rag_ref    = 0;
-                is_rec_var = FALSE;
-
-                if (Vinquire(var, &n, vgname) == FAIL) {
+                if (FAIL == Vgetclass(sub, dimclass)) {
                     HGOTO_FAIL(FAIL);
                 }
 
-                /*
-                 * Loop through contents looking for dimensions
-                 */
-                for (t = 0; t < n; t++) {
-                    char dimclass[H4_MAX_NC_CLASS] = "";
-                    char vsclass[H4_MAX_NC_CLASS]  = "";
-                    if (Vgettagref(var, t, &tag, &sub_id) == FAIL) {
+                if (!strcmp(dimclass, _HDF_DIMENSION) || !strcmp(dimclass, _HDF_UDIMENSION)) {
+
+                    if (!strcmp(dimclass, _HDF_UDIMENSION))
+                        is_rec_var = TRUE;
+
+                    if (FAIL == Vinquire(sub, &entries, subname)) {
                         HGOTO_FAIL(FAIL);
                     }
 
-                    switch (tag) {
-                        case DFTAG_VG: /* ------ V G R O U P ---------- */
-                            sub = Vattach(handle->hdf_file, sub_id, "r");
-                            if (FAIL == sub) {
-                                HGOTO_FAIL(FAIL);
-                            }
+                    dims[ndims] = (int)NC_dimid(handle, subname);
+                    if (-1 == dims[ndims]) /* should change to FAIL */
+                    {
+                        HGOTO_FAIL(FAIL);
+                    }
 
-                            if (FAIL == Vgetclass(sub, dimclass)) {
-                                HGOTO_FAIL(FAIL);
-                            }
+                    ndims++;
+                }
+                if (FAIL == Vdetach(sub)) {
+                    HGOTO_FAIL(FAIL);
+                }
+
+                break;
+            case DFTAG_VH: /* ----- V D A T A ----- */
+                if (hdf_read_vartype(handle, sub_id, &state->var_type) == FAIL)
+                    HGOTO_FAIL(FAIL);
+                state->vh_ref = 0;
+                break;
+            case DFTAG_NDG: /* ----- NDG Tag for HDF 3.2 ----- */
+                state->ndg_ref = sub_id;
+                break;
+            case DFTAG_SD: /* ------- Data Storage ------ */
+                data_ref = sub_id;
+                /* Note: apparently Hlength will fail in certain cases, but
+                         but this okay since I believe this is because
+                         the data does not exist yet in the file?
+                         So we can't catch this error -GV*/
+                data_count = Hlength(handle->hdf_file, DATA_TAG, sub_id);
 
-                            if (!strcmp(dimclass, _HDF_DIMENSION) || !strcmp(dimclass, _HDF_UDIMENSION)) {
+                break;
+            case DFTAG_SDRAG: /* ----- Ragged Array index ----- */
+                rag_ref = sub_id;
+                break;
+            case DFTAG_NT: /* ------- Number type ------- */
+                if (hdf_read_nt(handle, sub_id, state, &type, &skip) == FAIL)
+                    HGOTO_FAIL(FAIL);
+                if (skip)
+                    HGOTO_DONE(SUCCEED);
+                break;
+            default:
+                /* Do nothing */
+                break;
+        }
+    }
 
-                                if (!strcmp(dimclass, _HDF_UDIMENSION))
-                                    is_rec_var = TRUE;
+    /* the class of a Vdata carried over by hdf_scan_vars() is only read in
+       when the variable's Vgroup doesn't have a Vdata of its own */
+    if (state->vh_ref != 0) {
+        if (hdf_read_vartype(handle, state->vh_ref, &state->var_type) == FAIL)
+            HGOTO_FAIL(FAIL);
+        state->vh_ref = 0;
+    }
 
-                                if (FAIL == Vinquire(sub, &entries, subname)) {
-                                    HGOTO_FAIL(FAIL);
-                                }
+    vp = NC_new_var(vgname, type, ndims, dims);
+    if (NULL == vp) {
+        HGOTO_FAIL(FAIL);
+    }
 
-                                dims[ndims] = (int)NC_dimid(handle, subname);
-                                if (-1 == dims[ndims]) /* should change to FAIL */
-                                {
-                                    HGOTO_FAIL(FAIL);
-                                }
+    /* Read in the attributes if any */
+    if ((nattrs = hdf_num_attrs(handle, var)) > 0)
+        vp->attrs = hdf_read_attrs(xdrs, handle, var);
+    else
+        vp->attrs = NULL;
+
+    /* set up for easy access later */
+    vp->vgid     = id;
+    vp->data_ref = data_ref;
+    vp->data_tag = DATA_TAG;
+    /* BMR: put back hdf type that was set wrong by
+    NC_new_var; please refer to the cvs history of
+    bug #172 for reason on this statement - 4/17/2001
+    */
+    vp->HDFtype  = state->HDFtype;
+    vp->ndg_ref  = (uint16)state->ndg_ref;
+    vp->cdf      = handle; /* for NC_var_shape */
+    vp->var_type = state->var_type;
 
-                                ndims++;
-                            }
-                            if (FAIL == Vdetach(sub)) {
-                                HGOTO_FAIL(FAIL);
-                            }
+    /* need to process the ragged array info here */
+    /* QUESTION:  Load the whole rag_fill list in now??????? */
+    if (rag_ref) {
+        vp->is_ragged = TRUE;
+    }
 
-                            break;
-                        case DFTAG_VH: /* ----- V D A T A ----- */
-                            sub = VSattach(handle->hdf_file, sub_id, "r");
-                            if (FAIL == sub)
-                                HGOTO_FAIL(FAIL);
+    if (vp->data_ref) {
+        /*
+         * We have already seen data for this variable so now
+         *  we need to worry about its numrecs field
+         */
 
-                            if (FAIL == VSgetclass(sub, vsclass))
-                                HGOTO_FAIL(FAIL);
+        if (is_rec_var) {
+            /*
+             * Call NC_var_shape() so we can figure out how many
+             *  records have been written.  This is horribly
+             *  inefficient, but the separation-of-powers gets
+             *  really mucked up if we wait till later...
+             */
 
-                            if (!strcmp(vsclass, _HDF_SDSVAR))
-                                var_type = IS_SDSVAR;
-                            else if (!strcmp(vsclass, _HDF_CRDVAR))
-                                var_type = IS_CRDVAR;
-                            else
-                                var_type = UNKNOWN;
+            if (NC_var_shape(vp, handle->dims) == -1) {
+                HGOTO_FAIL(FAIL);
+            }
 
-                            if (FAIL == VSdetach(sub))
-                                HGOTO_FAIL(FAIL);
-                            break;
-                        case DFTAG_NDG: /* ----- NDG Tag for HDF 3.2 ----- */
-                            ndg_ref = sub_id;
-                            break;
-                        case DFTAG_SD: /* ------- Data Storage ------ */
-                            data_ref = sub_id;
-                            /* Note: apparently Hlength will fail in certain cases, but
-                                     but this okay since I believe this is because
-                                     the data does not exist yet in the file?
-                                     So we can't catch this error -GV*/
-                            data_count = Hlength(handle->hdf_file, DATA_TAG, sub_id);
-
-                            break;
-                        case DFTAG_SDRAG: /* ----- Ragged Array index ----- */
-                            rag_ref = sub_id;
-                            break;
-                        case DFTAG_NT: /* ------- Number type ------- */
-                            if (Hgetelement(handle->hdf_file, tag, sub_id, ntstring) == FAIL) {
-                                HGOTO_FAIL(FAIL);
-                            }
+            /*
+             * Now figure out how many recs have been written
+             * For a while there was a -1 at the end of this
+             *   equation.  I don't remember why its there
+             *   (4-Nov-93)
+             */
+            vp->numrecs = data_count / vp->dsizes[0];
+
+            /*
+             * Deallocate the shape info as it will be recomputed
+             *  at a higher level later
+             */
+            free(vp->shape);
+            free(vp->dsizes);
+            /* Reset these two pointers to NULL after
+                freeing.  BMR 4/11/01 */
+            vp->shape  = NULL;
+            vp->dsizes = NULL;
+        }
+        else {
+            /* Not a rec var, don't worry about it */
+            vp->numrecs = 1;
+        }
+    } /* end vp->data_ref */
 
-                            HDFtype = ntstring[1];
-                            if ((type = hdf_unmap_type(HDFtype)) == FAIL) {
-                                HGOTO_FAIL(FAIL);
-                            }
+    *vpp = vp;
 
-                            /*
-                             * Check if data was stored in native format
-                             * And make sure the numbertype version numbers are the same
-                             */
-                            if ((ntstring[0] != DFNT_VERSION) ||
-                                ((ntstring[3] != DFNTF_NONE) && (ntstring[3] != DFNTF_IEEE))) {
-
-                                /* check if in native mode for a different type of machine  or external data
-                                 * file is LITEND */
-                                if (ntstring[3] == DFNTF_PC)
-                                    HDFtype |= DFNT_LITEND;
-                                else {
-                                    if (ntstring[3] != (uint8)DFKgetPNSC(HDFtype, DF_MT)) {
-                                        /*
-                                         * OK, we have a problem here --- is in native mode
-                                         * for a different machine.  PUNT
-                                         */
-                                        goto bad_number_type; /* GOTO */
-                                    }
-                                    else {
-                                        /*
-                                         * Is in native mode but its OK --- same machine type
-                                         */
-                                        HDFtype |= DFNT_NATIVE;
-                                    }
-                                }
-                            }
+done:
+    if (ret_value == FAIL) {
+        if (vp != NULL)
+            NC_free_var(vp);
+    }
 
-                            break;
-                        default:
-                            /* Do nothing */
-                            break;
-                    }
-                }
+    free(dims);
 
-                variables[count] = NC_new_var(vgname, type, ndims, dims);
-                /* BMR: put back hdf type that was set wrong by
-                NC_new_var; please refer to the cvs history of
-                bug #172 for reason on this statement - 4/17/2001
-                */
-                variables[count]->HDFtype = HDFtype;
+    return ret_value;
+} /* hdf_read_var */
 
-                vp = variables[count];
-                if (NULL == vp) {
-                    HGOTO_FAIL(FAIL);
-                }
+/* ----------------------------------------------------------------
+** Go over one tag/ref of a variable's Vgroup the way hdf_read_var()
+**   does, for what it carries over to the next variable only; nothing
+**   but a number type is read in, and the class of a Vdata is left for
+**   hdf_read_var() to read
+** Return FAIL if something goes wrong
+** Set *skip to TRUE if hdf_read_var() would skip the variable there
+*/
+static int
+hdf_carry_tagref(NC *handle, int32 tag, int32 ref, hdf_varstate_t *state, int *skip)
+{
+    nc_type type;
+    int     ret_value = SUCCEED;
 
-                /* Read in the attributes if any */
-                if ((nattrs = hdf_num_attrs(handle, var)) > 0)
-                    vp->attrs = hdf_read_attrs(xdrs, handle, var);
-                else
-                    vp->attrs = NULL;
-
-                /* set up for easy access later */
-                vp->vgid     = id;
-                vp->data_ref = data_ref;
-                vp->data_tag = DATA_TAG;
-                vp->HDFtype  = HDFtype;
-                vp->ndg_ref  = (uint16)ndg_ref;
-                vp->cdf      = handle; /* for NC_var_shape */
-                vp->var_type = var_type;
-
-                /* need to process the ragged array info here */
-                /* QUESTION:  Load the whole rag_fill list in now??????? */
-                if (rag_ref) {
-                    vp->is_ragged = TRUE;
-                }
+    *skip = FALSE;
 
-                if (vp->data_ref) {
-                    /*
-                     * We have already seen data for this variable so now
-                     *  we need to worry about its numrecs field
-                     */
-
-                    if (is_rec_var) {
-                        /*
-                         * Call NC_var_shape() so we can figure out how many
-                         *  records have been written.  This is horribly
-                         *  inefficient, but the separation-of-powers gets
-                         *  really mucked up if we wait till later...
-                         */
-
-                        if (NC_var_shape(vp, handle->dims) == -1) {
-                            HGOTO_FAIL(FAIL);
-                        }
+    switch (tag) {
+        case DFTAG_VH:
+            state->vh_ref = ref;
+            break;
+        case DFTAG_NDG:
+            state->ndg_ref = ref;
+            break;
+        case DFTAG_NT:
+            if (hdf_read_nt(handle, ref, state, &type, skip) == FAIL)
+                HGOTO_FAIL(FAIL);
+            break;
+        default:
+            break;
+    }
+
+done:
+    return ret_value;
+} /* hdf_carry_tagref */
+
+/* ----------------------------------------------------------------
+** Make a variable of which only the name is read in, for the Vgroup
+**   whose ref is id; state is what hdf_read_var() is to start from
+**   when the rest is read in
+** Return NULL if something goes wrong
+*/
+static NC_var *
+hdf_new_unread_var(NC *handle, const char *name, int32 id, const hdf_varstate_t *state)
+{
+    NC_var *vp;
+
+    vp = NC_new_var(name, NC_UNSPECIFIED, 0, NULL);
+    if (vp == NULL)
+        return NULL;
+
+    vp->vgid     = id;
+    vp->cdf      = handle;
+    vp->unread   = TRUE;
+    vp->HDFtype  = state->HDFtype;
+    vp->ndg_ref  = (uint16)state->ndg_ref;
+    vp->var_type = state->var_type;
+    vp->vh_ref   = state->vh_ref;
 
-                        /*
-                         * Now figure out how many recs have been written
-                         * For a while there was a -1 at the end of this
-                         *   equation.  I don't remember why its there
-                         *   (4-Nov-93)
-                         */
-                        vp->numrecs = data_count / vp->dsizes[0];
-
-                        /*
-                         * Deallocate the shape info as it will be recomputed
-                         *  at a higher level later
-                         */
-                        free(vp->shape);
-                        free(vp->dsizes);
-                        /* Reset these two pointers to NULL after
-                            freeing.  BMR 4/11/01 */
-                        vp->shape  = NULL;
-                        vp->dsizes = NULL;
+    return vp;
+} /* hdf_new_unread_var */
+
+/* ----------------------------------------------------------------
+** Read in the variables out of a cdf structure, or only their names
+**   if lazy
+** Return FAIL if something goes wrong
+*/
+static int
+hdf_scan_vars(XDR *xdrs, NC *handle, int32 vg, int lazy)
+{
+    char vgname[H4_MAX_NC_NAME] = "";
+    char class[H4_MAX_NC_CLASS] = "";
+    NC_var       **variables    = NULL;
+    hdf_varstate_t state        = {FAIL, 0, UNKNOWN, 0};
+    int            vg_size, count;
+    int32          tag, subtag;
+    int32          id, subref;
+    int32          n, t;
+    int            i;
+    int            skip;
+    int32          var;
+    int            ret_value = SUCCEED;
+
+    /*
+     * Look through for a Vgroup of class _HDF_VARIABLE
+     */
+    if ((vg_size = Vntagrefs(vg)) == FAIL)
+        HGOTO_FAIL(FAIL);
+
+    /*
+     * Allocate enough space in case everything is a variable
+     */
+    count     = 0;
+    variables = malloc(sizeof(NC_var *) * (size_t)vg_size + 1);
+    if (NULL == variables) {
+        HGOTO_FAIL(FAIL);
+    }
+
+    for (i = 0; i < vg_size; i++) {
+        if (Vgettagref(vg, i, &tag, &id) == FAIL) {
+            HGOTO_FAIL(FAIL);
+        }
+
+        if (tag == DFTAG_VG) {
+            var = Vattach(handle->hdf_file, id, "r");
+            if (var == FAIL)
+                continue; /* isn't this bad? -GV */
+
+            if (Vgetclass(var, class) == FAIL) {
+                HGOTO_FAIL(FAIL);
+            }
+
+            /* Process as below if this VGroup represents a Variable or
+            a Coordinate Variable */
+            if (!strcmp(class, _HDF_VARIABLE)) {
+                if (lazy) {
+                    if (Vinquire(var, &n, vgname) == FAIL)
+                        HGOTO_FAIL(FAIL);
+
+                    variables[count] = hdf_new_unread_var(handle, vgname, id, &state);
+                    if (NULL == variables[count])
+                        HGOTO_FAIL(FAIL);
+
+                    /* go on from this variable's state to the next one's, and
+                       leave out the variables hdf_read_var() would skip, so
+                       that they are numbered as when read in */
+                    skip = FALSE;
+                    for (t = 0; t < n && !skip; t++) {
+                        if (Vgettagref(var, t, &subtag, &subref) == FAIL)
+                            HGOTO_FAIL(FAIL);
+                        if (hdf_carry_tagref(handle, subtag, subref, &state, &skip) == FAIL)
+                            HGOTO_FAIL(FAIL);
                     }
-                    else {
-                        /* Not a rec var, don't worry about it */
-                        vp->numrecs = 1;
+                    if (skip) {
+                        NC_free_var(variables[count]);
+                        variables[count] = NULL;
                     }
-                } /* end vp->data_ref */
-                count++;
+                    else
+                        count++;
+                }
+                else {
+                    if (hdf_read_var(xdrs, handle, var, id, &state, &variables[count]) == FAIL)
+                        HGOTO_FAIL(FAIL);
+                    if (variables[count] != NULL)
+                        count++;
+                }
             } /* end if vgroup class is variable */
 
-bad_number_type: /* ? */
-
             if (FAIL == Vdetach(var))
                 HGOTO_FAIL(FAIL);
 
@@ -1811,11 +1985,563 @@ done:
     }
 
     free(variables);
-    free(dims);
 
     return ret_value;
+} /* hdf_scan_vars */
+
+/* ----------------------------------------------------------------
+** Return TRUE if only the names of the variables are to be read in
+**   when the file is opened
+*/
+static int
+hdf_lazy_vars(NC *handle)
+{
+    int lazy;
+
+    HTS_REGISTRY_LOCK();
+    lazy = (hdf_metaload == SD_META_LAZY && handle->hdf_mode == DFACC_RDONLY);
+    HTS_REGISTRY_UNLOCK();
+
+    return lazy;
+} /* hdf_lazy_vars */
+
+/* ----------------------------------------------------------------
+** Read in the variables out of a cdf structure
+** Return FAIL if something goes wrong
+**
+** Important:  We must already assume that handle->dims is set
+**   so that we can do a call to NC_var_shape() so that we can
+**   set the numrecs fields of variables (so we can fill record
+**   variables intelligently)
+**
+** In a file opened read-only after hdf_set_metaload(SD_META_LAZY) only
+**   the name of each variable is read in; the rest is read in by
+**   hdf_load_var() when the variable is first used
+*/
+int
+hdf_read_vars(XDR *xdrs, NC *handle, int32 vg)
+{
+    return hdf_scan_vars(xdrs, handle, vg, hdf_lazy_vars(handle));
 } /* hdf_read_vars */
 
+/* ----------------------------------------------------------------
+** Read in the rest of a variable of which only the name was read in
+**   by hdf_read_vars()
+** Return FAIL if something goes wrong
+*/
+int
+hdf_load_var(NC *handle, int varid)
+{
+    NC_var       **vpp = NULL;
+    NC_var        *vp  = NULL;
+    hdf_varstate_t state;
+    int32          var       = FAIL;
+    int            ret_value = SUCCEED;
+
+    if (handle->vars == NULL || varid < 0 || (unsigned)varid >= handle->vars->count)
+        HGOTO_FAIL(FAIL);
+
+    vpp = (NC_var **)handle->vars->values + varid;
+    if (!(*vpp)->unread)
+        HGOTO_DONE(SUCCEED);
+
+    /* start from what the variables before this one carried over */
+    state.HDFtype  = (*vpp)->HDFtype;
+    state.ndg_ref  = (*vpp)->ndg_ref;
+    state.var_type = (*vpp)->var_type;
+    state.vh_ref   = (*vpp)->vh_ref;
+
+    var = Vattach(handle->hdf_file, (*vpp)->vgid, "r");
+    if (var == FAIL)
+        HGOTO_ERROR(DFE_CANTATTACH, FAIL);
+
+    if (hdf_read_var(handle->xdrs, handle, var, (*vpp)->vgid, &state, &vp) == FAIL)
+        HGOTO_FAIL(FAIL);
+
+    /* A variable whose number type can't be read in can't be used */
+    if (vp == NULL)
+        HGOTO_ERROR(DFE_BADNUMTYPE, FAIL);
+
+    /* Compute the shape, as NC_computeshapes() would have */
+    if (NC_var_shape(vp, handle->dims) == -1) {
+        NC_free_var(vp);
+        HGOTO_FAIL(FAIL);
+    }
+
+    NC_free_var(*vpp);
+    *vpp = vp;
+
+done:
+    if (var != FAIL)
+        Vdetach(var);
+
+    return ret_value;
+} /* hdf_load_var */
+
+/* ----------------------------------------------------------------
+** Set how much of each variable hdf_read_vars() reads in when a file
+**   is opened read-only: SD_META_ALL or SD_META_LAZY
+** Return FAIL if mode isn't one of those
+*/
+int
+hdf_set_metaload(int mode)
+{
+    int ret_value = SUCCEED;
+
+    if (mode != SD_META_ALL && mode != SD_META_LAZY)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    HTS_REGISTRY_LOCK();
+    hdf_metaload = mode;
+    HTS_REGISTRY_UNLOCK();
+
+done:
+    return ret_value;
+} /* hdf_set_metaload */
+
+/* ----------------------------------------------------------------
+** The index of the metadata of an HDF file is an element of tag
+**   DFTAG_SDIDX whose ref is that of the cdf Vgroup.  It holds, in
+**   network byte order:
+**
+**   uint16  version (HDF_INDEX_VERSION)
+**   int32   # of tag/refs in the cdf Vgroup, then each tag and ref
+**           as two uint16s
+**   int32   # of dimensions, then for each one:
+**             uint16 ref of its Vgroup, int32 size (0 if unlimited),
+**             int16 dim00_compat, uint16 length of the name, the name
+**   int32   # of Vgroups of variables, then for each one:
+**             uint16 ref of the Vgroup, uint16 length of the name,
+**             the name, uint16 # of its tag/refs of tag DFTAG_NT,
+**             DFTAG_NDG or DFTAG_VH, then each tag and ref as two
+**             uint16s, in their order in the Vgroup
+**
+** The tag/refs of each variable are what hdf_carry_tagref() goes over,
+**   so that the variables skipped when they are read in are also left
+**   out when only their names are
+**
+** The index is only used when the tag/refs of the cdf Vgroup are still
+**   the ones it holds; writing the metadata out again makes new
+**   Vgroups, so a file changed by a library which doesn't know about
+**   the index is read in the usual way.
+*/
+#define HDF_INDEX_VERSION 1
+
+/* Give up on the index unless n more bytes of it, from p to end, are left */
+#define HDF_INDEX_NEED(n)                                                                                    \
+    if (end - p < (ptrdiff_t)(n))                                                                            \
+        HGOTO_DONE(FAIL);
+
+/* ----------------------------------------------------------------
+** Read numrecs out of the Vdatas of the unlimited dimension whose
+**   Vgroup's ref is id, the way hdf_read_dims() does
+** Return FAIL if something goes wrong
+*/
+static int
+hdf_read_numrecs(NC *handle, int32 id)
+{
+    int32 dim    = FAIL;
+    int32 vs     = FAIL;
+    int32 sub_id = -1;
+    int32 val;
+    int   ret_value = SUCCEED;
+
+    dim = Vattach(handle->hdf_file, id, "r");
+    if (dim == FAIL)
+        HGOTO_FAIL(FAIL);
+
+    while ((sub_id = Vgetnext(dim, sub_id)) != FAIL) {
+        if (Visvs(dim, sub_id)) {
+            vs = VSattach(handle->hdf_file, sub_id, "r");
+            if (vs == FAIL)
+                HGOTO_FAIL(FAIL);
+            if (VSseek(vs, 0) == FAIL)
+                HGOTO_FAIL(FAIL);
+            if (VSread(vs, (uint8 *)&val, 1, FULL_INTERLACE) != 1)
+                HGOTO_FAIL(FAIL);
+            handle->numrecs = (unsigned)val;
+            if (VSdetach(vs) == FAIL)
+                HGOTO_FAIL(FAIL);
+            vs = FAIL;
+        }
+    }
+
+done:
+    if (vs != FAIL)
+        VSdetach(vs);
+    if (dim != FAIL)
+        Vdetach(dim);
+
+    return ret_value;
+} /* hdf_read_numrecs */
+
+/* ----------------------------------------------------------------
+** Read in the dimensions, and the names of the variables if lazy,
+**   out of the index of the metadata instead of the Vgroups
+** Return FAIL if the file has no index, the index doesn't match the
+**   cdf Vgroup vg, or something goes wrong; nothing is read in then
+*/
+static int
+hdf_read_index(NC *handle, int32 vg, int lazy)
+{
+    char           name[H4_MAX_NC_NAME] = "";
+    NC_dim       **dimension            = NULL;
+    NC_var       **variables            = NULL;
+    uint8         *buf                  = NULL;
+    uint8         *p, *end;
+    hdf_varstate_t state    = {FAIL, 0, UNKNOWN, 0};
+    uint16         find_tag = 0, find_ref = 0;
+    int32          find_offset, find_length;
+    uint16         version, tag16, ref16, namelen, nsubs;
+    int16          compat;
+    int32          ntagrefs, ndims = 0, nvars = 0, nvgs;
+    int32          tag, ref, size;
+    int32          i;
+    int            skip;
+    int            ret_value = SUCCEED;
+
+    if (Hfind(handle->hdf_file, DFTAG_SDIDX, (uint16)handle->vgid, &find_tag, &find_ref, &find_offset,
+              &find_length, DF_FORWARD) == FAIL)
+        HGOTO_DONE(FAIL);
+
+    if (find_length <= 0 || (buf = malloc((size_t)find_length)) == NULL)
+        HGOTO_DONE(FAIL);
+    if (Hgetelement(handle->hdf_file, DFTAG_SDIDX, (uint16)handle->vgid, buf) != find_length)
+        HGOTO_DONE(FAIL);
+    p   = buf;
+    end = buf + find_length;
+
+    HDF_INDEX_NEED(2 + 4);
+    UINT16DECODE(p, version);
+    if (version != HDF_INDEX_VERSION)
+        HGOTO_DONE(FAIL);
+
+    /* the index is stale unless the cdf Vgroup holds the same tag/refs */
+    INT32DECODE(p, ntagrefs);
+    if (ntagrefs != Vntagrefs(vg))
+        HGOTO_DONE(FAIL);
+    HDF_INDEX_NEED(4 * (size_t)ntagrefs);
+    for (i = 0; i < ntagrefs; i++) {
+        UINT16DECODE(p, tag16);
+        UINT16DECODE(p, ref16);
+        if (Vgettagref(vg, i, &tag, &ref) == FAIL || tag != tag16 || ref != ref16)
+            HGOTO_DONE(FAIL);
+    }
+
+    HDF_INDEX_NEED(4);
+    INT32DECODE(p, ndims);
+    if (ndims < 0 || ndims > ntagrefs)
+        HGOTO_DONE(FAIL);
+    dimension = calloc((size_t)ndims + 1, sizeof(NC_dim *));
+    if (dimension == NULL)
+        HGOTO_DONE(FAIL);
+    for (i = 0; i < ndims; i++) {
+        HDF_INDEX_NEED(2 + 4 + 2 + 2);
+        UINT16DECODE(p, ref16);
+        INT32DECODE(p, size);
+        INT16DECODE(p, compat);
+        UINT16DECODE(p, namelen);
+        if (namelen >= H4_MAX_NC_NAME)
+            HGOTO_DONE(FAIL);
+        HDF_INDEX_NEED(namelen);
+        memcpy(name, p, namelen);
+        name[namelen] = '\0';
+        p += namelen;
+
+        dimension[i] = NC_new_dim(name, size);
+        if (dimension[i] == NULL)
+            HGOTO_DONE(FAIL);
+        dimension[i]->dim00_compat = compat;
+        dimension[i]->vgid         = ref16;
+
+        if (size == NC_UNLIMITED && hdf_read_numrecs(handle, ref16) == FAIL)
+            HGOTO_DONE(FAIL);
+    }
+
+    if (lazy) {
+        HDF_INDEX_NEED(4);
+        INT32DECODE(p, nvgs);
+        if (nvgs < 0 || nvgs > ntagrefs)
+            HGOTO_DONE(FAIL);
+        variables = calloc((size_t)nvgs + 1, sizeof(NC_var *));
+        if (variables == NULL)
+            HGOTO_DONE(FAIL);
+        for (i = 0; i < nvgs; i++) {
+            HDF_INDEX_NEED(2 + 2);
+            UINT16DECODE(p, ref16);
+            UINT16DECODE(p, namelen);
+            if (namelen >= H4_MAX_NC_NAME)
+                HGOTO_DONE(FAIL);
+            HDF_INDEX_NEED(namelen + 2);
+            memcpy(name, p, namelen);
+            name[namelen] = '\0';
+            p += namelen;
+            UINT16DECODE(p, nsubs);
+            HDF_INDEX_NEED(4 * (size_t)nsubs);
+
+            variables[nvars] = hdf_new_unread_var(handle, name, ref16, &state);
+            if (variables[nvars] == NULL)
+                HGOTO_DONE(FAIL);
+            nvars++;
+
+            /* go on to the next variable's state, as hdf_scan_vars() does */
+            skip = FALSE;
+            for (; nsubs > 0; nsubs--) {
+                UINT16DECODE(p, tag16);
+                UINT16DECODE(p, ref16);
+                if (!skip && hdf_carry_tagref(handle, tag16, ref16, &state, &skip) == FAIL)
+                    HGOTO_DONE(FAIL);
+            }
+            if (skip) {
+                nvars--;
+                NC_free_var(variables[nvars]);
+                variables[nvars] = NULL;
+            }
+        }
+    }
+
+    /* the whole index is good, hand over what was read in */
+    handle->dims = NULL;
+    if (ndims) {
+        handle->dims = NC_new_array(NC_DIMENSION, (unsigned)ndims, (uint8_t *)dimension);
+        if (handle->dims == NULL)
+            HGOTO_DONE(FAIL);
+        ndims = 0;
+    }
+    handle->vars = NULL;
+    if (nvars) {
+        handle->vars = NC_new_array(NC_VARIABLE, (unsigned)nvars, (uint8_t *)variables);
+        if (handle->vars == NULL)
+            HGOTO_DONE(FAIL);
+        nvars = 0;
+    }
+
+done:
+    if (ret_value == FAIL) {
+        NC_free_array(handle->dims);
+        handle->dims    = NULL;
+        handle->vars    = NULL;
+        handle->numrecs = 0;
+    }
+    if (dimension != NULL)
+        for (i = 0; i < ndims; i++)
+            if (dimension[i] != NULL)
+                NC_free_dim(dimension[i]);
+    if (variables != NULL)
+        for (i = 0; i < nvars; i++)
+            if (variables[i] != NULL)
+                NC_free_var(variables[i]);
+    free(dimension);
+    free(variables);
+    free(buf);
+
+    return ret_value;
+} /* hdf_read_index */
+
+/* ----------------------------------------------------------------
+** Go over the Vgroups of variables in the cdf Vgroup vg, as
+**   hdf_scan_vars() does, for the index: count them into *nvgsp and
+**   add the size of their entries to *sizep; if pp isn't NULL, also
+**   write the entries out at *pp and move it on past them
+** Return FAIL if something goes wrong
+*/
+static int
+hdf_index_vars(NC *handle, int32 vg, uint8 **pp, int32 *nvgsp, size_t *sizep)
+{
+    char   vgname[H4_MAX_NC_NAME] = "";
+    char   class[H4_MAX_NC_CLASS] = "";
+    int32 *tags                   = NULL;
+    int32 *refs                   = NULL;
+    int32  var                    = FAIL;
+    int32  vg_size, n, nsubs;
+    int32  tag, id;
+    int32  i, t;
+    size_t namelen;
+    int    ret_value = SUCCEED;
+
+    if ((vg_size = Vntagrefs(vg)) == FAIL)
+        HGOTO_FAIL(FAIL);
+
+    for (i = 0; i < vg_size; i++) {
+        if (Vgettagref(vg, i, &tag, &id) == FAIL)
+            HGOTO_FAIL(FAIL);
+        if (tag != DFTAG_VG)
+            continue;
+
+        /* a Vgroup which can't be attached is passed over when read in too */
+        if ((var = Vattach(handle->hdf_file, id, "r")) == FAIL)
+            continue;
+        if (Vgetclass(var, class) == FAIL)
+            HGOTO_FAIL(FAIL);
+
+        if (!strcmp(class, _HDF_VARIABLE)) {
+            if (Vinquire(var, &n, vgname) == FAIL)
+                HGOTO_FAIL(FAIL);
+            tags = malloc(sizeof(int32) * (size_t)n + 1);
+            refs = malloc(sizeof(int32) * (size_t)n + 1);
+            if (tags == NULL || refs == NULL)
+                HGOTO_ERROR(DFE_NOSPACE, FAIL);
+            if (n > 0 && Vgettagrefs(var, tags, refs, n) == FAIL)
+                HGOTO_FAIL(FAIL);
+
+            /* only the tag/refs hdf_carry_tagref() goes over */
+            nsubs = 0;
+            for (t = 0; t < n; t++)
+                if (tags[t] == DFTAG_NT || tags[t] == DFTAG_NDG || tags[t] == DFTAG_VH) {
+                    tags[nsubs] = tags[t];
+                    refs[nsubs] = refs[t];
+                    nsubs++;
+                }
+            if (nsubs > UINT16_MAX)
+                HGOTO_ERROR(DFE_ARGS, FAIL);
+
+            namelen = strlen(vgname);
+            (*nvgsp)++;
+            *sizep += 2 + 2 + namelen + 2 + 4 * (size_t)nsubs;
+            if (pp != NULL) {
+                UINT16ENCODE(*pp, id);
+                UINT16ENCODE(*pp, namelen);
+                memcpy(*pp, vgname, namelen);
+                *pp += namelen;
+                UINT16ENCODE(*pp, nsubs);
+                for (t = 0; t < nsubs; t++) {
+                    UINT16ENCODE(*pp, tags[t]);
+                    UINT16ENCODE(*pp, refs[t]);
+                }
+            }
+
+            free(tags);
+            free(refs);
+            tags = refs = NULL;
+        }
+
+        if (Vdetach(var) == FAIL) {
+            var = FAIL;
+            HGOTO_FAIL(FAIL);
+        }
+        var = FAIL;
+    }
+
+done:
+    if (var != FAIL)
+        Vdetach(var);
+    free(tags);
+    free(refs);
+
+    return ret_value;
+} /* hdf_index_vars */
+
+/* ----------------------------------------------------------------
+** Write out the index of the metadata of the file, in place of any
+**   index written before
+** Return FAIL if something goes wrong
+*/
+int
+hdf_write_index(NC *handle)
+{
+    NC      *scratch = NULL;
+    NC_dim **dp;
+    uint8   *buf = NULL;
+    uint8   *p;
+    size_t   size, vars_size;
+    uint16   find_tag, find_ref;
+    int32    find_offset, find_length;
+    int32    cdf_vg = FAIL;
+    int32    ntagrefs, tag, ref, nvgs;
+    int32    i;
+    int      ret_value = SUCCEED;
+
+    /* indexes of Vgroups written before are stale */
+    for (;;) {
+        find_tag = find_ref = 0;
+        if (Hfind(handle->hdf_file, DFTAG_SDIDX, DFREF_WILDCARD, &find_tag, &find_ref, &find_offset,
+                  &find_length, DF_FORWARD) == FAIL)
+            break;
+        if (Hdeldd(handle->hdf_file, find_tag, find_ref) == FAIL)
+            HGOTO_ERROR(DFE_CANTDELDD, FAIL);
+    }
+
+    /* nothing to index without a cdf Vgroup */
+    if (handle->vgid == 0)
+        HGOTO_DONE(SUCCEED);
+
+    /* read the dimensions back in the way hdf_read_xdr_cdf() would */
+    if ((scratch = calloc(1, sizeof(NC))) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    scratch->hdf_file = handle->hdf_file;
+    scratch->hdf_mode = handle->hdf_mode;
+
+    cdf_vg = Vattach(handle->hdf_file, handle->vgid, "r");
+    if (cdf_vg == FAIL)
+        HGOTO_ERROR(DFE_CANTATTACH, FAIL);
+    if ((ntagrefs = Vntagrefs(cdf_vg)) == FAIL)
+        HGOTO_FAIL(FAIL);
+    if (hdf_read_dims(NULL, scratch, cdf_vg) == FAIL)
+        HGOTO_FAIL(FAIL);
+    nvgs      = 0;
+    vars_size = 0;
+    if (hdf_index_vars(handle, cdf_vg, NULL, &nvgs, &vars_size) == FAIL)
+        HGOTO_FAIL(FAIL);
+
+    size = 2 + 4 + 4 * (size_t)ntagrefs + 4 + 4;
+    if (scratch->dims != NULL) {
+        dp = (NC_dim **)scratch->dims->values;
+        for (unsigned ii = 0; ii < scratch->dims->count; ii++)
+            size += 2 + 4 + 2 + 2 + dp[ii]->name->len;
+    }
+    size += vars_size;
+    if (size > INT32_MAX)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    if ((buf = malloc(size)) == NULL)
+        HGOTO_ERROR(DFE_NOSPACE, FAIL);
+    p = buf;
+
+    UINT16ENCODE(p, HDF_INDEX_VERSION);
+    INT32ENCODE(p, ntagrefs);
+    for (i = 0; i < ntagrefs; i++) {
+        if (Vgettagref(cdf_vg, i, &tag, &ref) == FAIL)
+            HGOTO_FAIL(FAIL);
+        UINT16ENCODE(p, tag);
+        UINT16ENCODE(p, ref);
+    }
+
+    INT32ENCODE(p, scratch->dims != NULL ? (int32)scratch->dims->count : 0);
+    if (scratch->dims != NULL) {
+        dp = (NC_dim **)scratch->dims->values;
+        for (unsigned ii = 0; ii < scratch->dims->count; ii++) {
+            UINT16ENCODE(p, dp[ii]->vgid);
+            INT32ENCODE(p, dp[ii]->size);
+            INT16ENCODE(p, dp[ii]->dim00_compat);
+            UINT16ENCODE(p, dp[ii]->name->len);
+            memcpy(p, dp[ii]->name->values, dp[ii]->name->len);
+            p += dp[ii]->name->len;
+        }
+    }
+
+    INT32ENCODE(p, nvgs);
+    nvgs      = 0;
+    vars_size = 0;
+    if (hdf_index_vars(handle, cdf_vg, &p, &nvgs, &vars_size) == FAIL)
+        HGOTO_FAIL(FAIL);
+    if ((size_t)(p - buf) != size)
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
+    if (Hputelement(handle->hdf_file, DFTAG_SDIDX, (uint16)handle->vgid, buf, (int32)size) == FAIL)
+        HGOTO_ERROR(DFE_PUTELEM, FAIL);
+
+done:
+    if (cdf_vg != FAIL)
+        Vdetach(cdf_vg);
+    if (scratch != NULL) {
+        NC_free_xcdf(scratch);
+        free(scratch);
+    }
+    free(buf);
+
+    return ret_value;
+} /* hdf_write_index */
+
 /* ----------------------------------------------------------------
 ** Read in a cdf structure
 */
@@ -1824,6 +2550,7 @@ hdf_read_xdr_cdf(XDR *xdrs, NC **handlep)
 {
     int32 cdf_vg = FAIL;
     int   vgid   = 0;
+    int   lazy, indexed;
     int   status;
     int   ret_value = SUCCEED;
 
@@ -1837,15 +2564,26 @@ hdf_read_xdr_cdf(XDR *xdrs, NC **handlep)
 
     (*handlep)->vgid = vgid; /* ref of vgroup */
 
+    /* read in dimensions, and the names of the variables if only they are
+       to be read in, out of the index of the metadata if there's one */
+    lazy    = hdf_lazy_vars(*handlep);
+    indexed = FALSE;
+    if ((*handlep)->hdf_mode == DFACC_RDONLY)
+        indexed = (hdf_read_index((*handlep), cdf_vg, lazy) == SUCCEED);
+
     /* read in dimensions */
-    status = hdf_read_dims(xdrs, (*handlep), cdf_vg);
-    if (status == FAIL)
-        HGOTO_FAIL(FAIL);
+    if (!indexed) {
+        status = hdf_read_dims(xdrs, (*handlep), cdf_vg);
+        if (status == FAIL)
+            HGOTO_FAIL(FAIL);
+    }
 
     /* read in variables */
-    status = hdf_read_vars(xdrs, (*handlep), cdf_vg);
-    if (status == FAIL)
-        HGOTO_FAIL(FAIL);
+    if (!indexed || !lazy) {
+        status = hdf_scan_vars(xdrs, (*handlep), cdf_vg, lazy);
+        if (status == FAIL)
+            HGOTO_FAIL(FAIL);
+    }
 
     /* read in attributes */
     if (hdf_num_attrs((*handlep), cdf_vg) > 0)
@@ -18,6 +18,7 @@
 
 #include "nc_priv.h"
 #include "herr_priv.h"
+#include "hthread_priv.h"
 
 #if defined H4_HAVE_WIN32_API && !defined __MINGW32__
 typedef int                               pid_t;
@@ -67,20 +68,27 @@ static int max_NC_open = H4_MAX_NC_OPEN; /* current netCDF default */
 static int
 ncreset_cdflist(void)
 {
+    int ret_value = 0;
+
+    HTS_REGISTRY_LOCK();
+
     /* Check for non-NULL pointers in the _cdfs list, and if there is
        any, we should not deallocate _cdfs */
     if (_cdfs != NULL) {
         for (int i = 0; i < _cdfs_size; i++)
             if (_cdfs[i] != NULL) {
                 fprintf(stderr, "%d is not NULL\n", i);
-                return -1;
+                HGOTO_DONE(-1);
             }
         /* Release _cdfs and reset its size */
         free(_cdfs);
         _cdfs      = NULL;
         _cdfs_size = 0;
     }
-    return 0;
+
+done:
+    HTS_REGISTRY_UNLOCK();
+    return ret_value;
 }
 
 /*
@@ -99,6 +107,10 @@ NC_reset_maxopenfiles(int req_max)
     int  old_idx, new_idx; /* indices for the _cdfs list and the new list */
     int  ret_value = 0;
 
+    /* the list is only changed with both the library and registry locks held */
+    HTS_LOCK();
+    HTS_REGISTRY_LOCK();
+
     /* Verify arguments */
     if (req_max < 0) {
         NCadvise(NC_EINVAL, "Invalid request: %d for maximum files", req_max);
@@ -181,9 +193,11 @@ NC_reset_maxopenfiles(int req_max)
     /* Reset current max files opened allowed in HDF to the new max */
     max_NC_open = alloc_size;
 
-    return max_NC_open;
+    ret_value = max_NC_open;
 
 done:
+    HTS_REGISTRY_UNLOCK();
+    HTS_UNLOCK();
     return ret_value;
 } /* NC_reset_maxopenfiles */
 
@@ -226,7 +240,9 @@ NC_check_id(int cdfid)
 {
     NC *handle;
 
+    HTS_REGISTRY_LOCK();
     handle = (cdfid >= 0 && cdfid < _ncdf) ? _cdfs[cdfid] : NULL;
+    HTS_REGISTRY_UNLOCK();
     if (handle == NULL) {
         NCadvise(NC_EBADID, "%d is not a valid cdfid", cdfid);
         return NULL;
@@ -242,6 +258,8 @@ bool_t
 NC_indefine(int cdfid, bool_t iserr) /* Should be a Macro ? */
 {
     bool_t ret;
+
+    HTS_REGISTRY_LOCK();
     ret = (cdfid >= 0 && cdfid < _ncdf) ? (bool_t)(_cdfs[cdfid]->flags & NC_INDEF) : FALSE;
     if (!ret && iserr) {
         if (cdfid < 0 || cdfid >= _ncdf)
@@ -249,6 +267,7 @@ NC_indefine(int cdfid, bool_t iserr) /* Should be a Macro ? */
         else
             NCadvise(NC_ENOTINDEFINE, "%s Not in define mode", _cdfs[cdfid]->path);
     }
+    HTS_REGISTRY_UNLOCK();
     return ret;
 }
 
@@ -259,14 +278,18 @@ NC_indefine(int cdfid, bool_t iserr) /* Should be a Macro ? */
 static int
 NC_open(const char *path, int mode)
 {
-    NC *handle = NULL;
-    int cdfid  = -1;
+    NC *handle    = NULL;
+    int cdfid     = -1;
+    int ret_value = -1;
+
+    /* opening and closing cdfs is serialized by the library lock */
+    HTS_LOCK();
 
     /* Allocate _cdfs, if it has not been */
     if (_cdfs == NULL) {
         if (FAIL == (_cdfs_size = NC_reset_maxopenfiles(0))) {
             NCadvise(NC_ENFILE, "Could not reset max open files limit");
-            return -1;
+            HGOTO_DONE(-1);
         }
         cdfid = 0;
     }
@@ -288,12 +311,12 @@ NC_open(const char *path, int mode)
             if (max_NC_open == MAX_AVAIL_OPENFILES) {
                 NCadvise(NC_ENFILE, "maximum number of open cdfs allowed already reaches system limit %d",
                          MAX_AVAIL_OPENFILES);
-                return -1;
+                HGOTO_DONE(-1);
             }
             /* otherwise, increase the current max to the system limit */
             if (FAIL == NC_reset_maxopenfiles(MAX_AVAIL_OPENFILES)) {
                 NCadvise(NC_ENFILE, "Could not reset max open files limit");
-                return -1;
+                HGOTO_DONE(-1);
             }
         }
     }
@@ -303,7 +326,7 @@ NC_open(const char *path, int mode)
         /* if the failure was due to "too many open files," simply return */
         if (errno == EMFILE) {
             nc_serror("maximum number of open files allowed has been reached\"%s\"", path);
-            return -1;
+            HGOTO_DONE(-1);
         }
 
         if ((mode & 0x0f) == NC_CLOBBER) {
@@ -313,15 +336,21 @@ NC_open(const char *path, int mode)
                 if (remove(path) != 0)
                     nc_serror("couldn't remove filename \"%s\"", path);
         }
-        return -1;
+        HGOTO_DONE(-1);
     }
 
     (void)strncpy(handle->path, path, FILENAME_MAX);
+    HTS_REGISTRY_LOCK();
     _cdfs[cdfid] = handle;
     if (cdfid == _ncdf)
         _ncdf++;
+    HTS_REGISTRY_UNLOCK();
     _curr_opened++;
-    return cdfid;
+    ret_value = cdfid;
+
+done:
+    HTS_UNLOCK();
+    return ret_value;
 } /* NC_open */
 
 int
@@ -361,12 +390,16 @@ ncabort(int cdfid)
     char     path[FILENAME_MAX + 1];
     unsigned flags;
     int      file_type;
+    int      ret_value = 0;
 
     cdf_routine_name = "ncabort";
 
+    /* opening and closing cdfs is serialized by the library lock */
+    HTS_LOCK();
+
     handle = NC_check_id(cdfid);
     if (handle == NULL)
-        return -1;
+        HGOTO_DONE(-1);
 
     flags = handle->flags; /* need to save past free_cdf */
 
@@ -382,9 +415,11 @@ ncabort(int cdfid)
 
                 NC_free_cdf(STASH(cdfid));
 
+                HTS_REGISTRY_LOCK();
                 _cdfs[handle->redefid] = NULL;
                 if (handle->redefid == _ncdf - 1)
                     _ncdf--;
+                HTS_REGISTRY_UNLOCK();
                 handle->redefid = -1;
                 _curr_opened--; /* one less file currently opened */
 
@@ -392,7 +427,7 @@ ncabort(int cdfid)
                 if (_ncdf == 0)
                     if (ncreset_cdflist() == -1) {
                         fprintf(stderr, "unable to reset _cdfs list\n");
-                        return -1;
+                        HGOTO_DONE(-1);
                     }
             }
         }
@@ -401,11 +436,11 @@ ncabort(int cdfid)
         handle->xdrs->x_op = XDR_ENCODE;
         if (handle->flags & NC_HDIRTY) {
             if (!xdr_cdf(handle->xdrs, &handle))
-                return -1;
+                HGOTO_DONE(-1);
         }
         else if (handle->flags & NC_NDIRTY) {
             if (!xdr_numrecs(handle->xdrs, handle))
-                return -1;
+                HGOTO_DONE(-1);
         }
     }
     /* } file type is HDF */
@@ -428,21 +463,25 @@ ncabort(int cdfid)
             break;
     }
 
+    HTS_REGISTRY_LOCK();
     _cdfs[cdfid] = NULL; /* reset pointer */
 
     /* if current file is at the top of the list, adjust the water mark */
     if (cdfid == _ncdf - 1)
         _ncdf--;
+    HTS_REGISTRY_UNLOCK();
     _curr_opened--; /* one less file currently being opened */
 
     /* if the _cdf list is empty, deallocate and reset it to NULL */
     if (_ncdf == 0)
         if (ncreset_cdflist() == -1) {
             fprintf(stderr, "unable to reset _cdfs list\n");
-            return -1;
+            HGOTO_DONE(-1);
         }
 
-    return 0;
+done:
+    HTS_UNLOCK();
+    return ret_value;
 } /* ncabort */
 
 /*
@@ -652,10 +691,12 @@ NC_endef(int cdfid, NC *handle)
         if (rename(handle->path, realpath) != 0) {
             nc_serror("rename %s -> %s failed", handle->path, realpath);
             /* try to restore state prior to redef */
+            HTS_REGISTRY_LOCK();
             _cdfs[cdfid]           = stash;
             _cdfs[handle->redefid] = NULL;
             if (handle->redefid == _ncdf - 1)
                 _ncdf--;
+            HTS_REGISTRY_UNLOCK();
             _curr_opened--; /* one less file currently opened */
             NC_free_cdf(handle);
 
@@ -674,9 +715,11 @@ NC_endef(int cdfid, NC *handle)
             return -1;
 #endif
         NC_free_cdf(stash);
+        HTS_REGISTRY_LOCK();
         _cdfs[handle->redefid] = NULL;
         if (handle->redefid == _ncdf - 1)
             _ncdf--;
+        HTS_REGISTRY_UNLOCK();
         _curr_opened--; /* one less file currently opened */
         handle->redefid = -1;
 
@@ -694,15 +737,19 @@ int
 ncendef(int cdfid)
 {
     NC *handle;
+    int ret_value = -1;
 
     cdf_routine_name = "ncendef";
 
+    /* NC_endef may change the list of cdfs, which needs the library lock */
+    HTS_LOCK();
+
     handle = NC_check_id(cdfid);
-    if (handle == NULL)
-        return -1;
-    if (!NC_indefine(cdfid, TRUE))
-        return -1;
-    return NC_endef(cdfid, handle);
+    if (handle != NULL && NC_indefine(cdfid, TRUE))
+        ret_value = NC_endef(cdfid, handle);
+
+    HTS_UNLOCK();
+    return ret_value;
 }
 
 /*
@@ -712,48 +759,62 @@ int
 ncclose(int cdfid)
 {
     NC *handle;
+    int ret_value = 0;
 
     cdf_routine_name = "ncclose";
 
+    /* opening and closing cdfs is serialized by the library lock */
+    HTS_LOCK();
+
     handle = NC_check_id(cdfid);
     if (handle == NULL)
-        return -1;
+        HGOTO_DONE(-1);
 
     if (handle->flags & NC_INDEF) {
         if (NC_endef(cdfid, handle) == -1) {
-            return ncabort(cdfid);
+            HGOTO_DONE(ncabort(cdfid));
         }
     }
     else if (handle->flags & NC_RDWR) {
         handle->xdrs->x_op = XDR_ENCODE;
         if (handle->flags & NC_HDIRTY) {
             if (!xdr_cdf(handle->xdrs, &handle))
-                return -1;
+                HGOTO_DONE(-1);
         }
         else if (handle->flags & NC_NDIRTY) {
             if (!xdr_numrecs(handle->xdrs, handle))
-                return -1;
+                HGOTO_DONE(-1);
         }
     }
 
-    if (handle->file_type == HDF_FILE)
+    if (handle->file_type == HDF_FILE) {
         hdf_close(handle);
 
+        /* the metadata is all written out now, so it can be indexed */
+        if ((handle->flags & NC_RDWR) && handle->metaindex)
+            hdf_write_index(handle);
+    }
+
     NC_free_cdf(handle); /* calls fclose */
 
+    HTS_REGISTRY_LOCK();
     _cdfs[cdfid] = NULL; /* reset pointer */
 
     if (cdfid == _ncdf - 1)
         _ncdf--;
+    HTS_REGISTRY_UNLOCK();
     _curr_opened--; /* one less file currently opened */
 
     /* if the _cdf list is empty, deallocate and reset it to NULL */
     if (_curr_opened == 0)
         if (ncreset_cdflist() == -1) {
             fprintf(stderr, "unable to reset _cdfs list\n");
-            return -1;
+            HGOTO_DONE(-1);
         }
-    return 0;
+
+done:
+    HTS_UNLOCK();
+    return ret_value;
 }
 
 int
@@ -132,8 +132,8 @@ hdf_xdr_u_int(XDR *xdrs, unsigned *up)
 bool_t
 hdf_xdr_opaque(XDR *xdrs, char *cp, unsigned cnt)
 {
-    unsigned   rndup;
-    static int crud[BYTES_PER_XDR_UNIT];
+    unsigned rndup;
+    int      crud[BYTES_PER_XDR_UNIT];
 
     /*
      * if no data we are done
@@ -319,12 +319,18 @@ hdf_xdr_double(XDR *xdrs, double *dp)
 /* As an optimization, the XDR I/O layer uses a single I/O buffer to
  * speed up nearby reads and writes ("bio" == Buffered I/O).
  *
- * TODO: This is not a very big cache! Bumping it might enhance I/O
- *       performance.
+ * The buffer holds a window of one or more pages of the file.  Files which
+ * can be written always have a one-page window.  In a read-only file the
+ * window grows while the file is read straight through (read-ahead), and
+ * goes back to one page when the reads jump around.  Reads of at least a
+ * page are read straight into the caller's memory.
  */
 
-/* Size of the I/O buffer in bytes */
-#define BIOBUFSIZ 8192
+/* Default size of a page of the I/O buffer in bytes */
+#define BIO_DEFAULT_SIZE 8192
+
+/* Most bytes read ahead into the buffer at once */
+#define BIO_MAX_AHEAD (1024 * 1024)
 
 /* # of valid bytes in the buffer */
 #define CNT(p) ((p)->ptr - (p)->base)
@@ -333,7 +339,10 @@ hdf_xdr_double(XDR *xdrs, double *dp)
 #define REM(p) ((p)->cnt - CNT(p))
 
 /* Available space for write in buffer */
-#define BREM(p) (BIOBUFSIZ - CNT(p))
+#define BREM(p) ((p)->size - CNT(p))
+
+/* Whether the file can only be read */
+#define RDONLY(p) (!((p)->mode & (O_WRONLY | O_RDWR)))
 
 /* POSIX and I/O buffer info
  *
@@ -343,15 +352,17 @@ hdf_xdr_double(XDR *xdrs, double *dp)
  *       HDF4 files are limited to 4 GB.
  */
 typedef struct biobuf {
-    int      fd;              /* POSIX file descriptor */
-    int      mode;            /* File access mode, O_RDONLY, etc */
-    int      isdirty;         /* Dirty buffer flag */
-    off_t    page;            /* Location in the file */
-    int      nread;           /* Number of bytes successfully read */
-    int      nwrote;          /* Number of bytes last written */
-    int      cnt;             /* Number of valid bytes in buffer */
-    uint8_t *ptr;             /* Next byte (pointer into base) */
-    uint8_t  base[BIOBUFSIZ]; /* Data buffer */
+    int      fd;       /* POSIX file descriptor */
+    int      mode;     /* File access mode, O_RDONLY, etc */
+    int      isdirty;  /* Dirty buffer flag */
+    off_t    page;     /* Location in the file, in pages */
+    off_t    fpos;     /* Offset of fd in the file, -1 if not known */
+    int      size;     /* Size of a page in bytes */
+    int      npages;   /* # of pages in the window */
+    int      maxpages; /* # of pages base has room for */
+    int      cnt;      /* Number of valid bytes in buffer */
+    uint8_t *ptr;      /* Next byte (pointer into base) */
+    uint8_t *base;     /* Data buffer */
 } biobuf;
 
 /*
@@ -364,36 +375,98 @@ bio_get_new(int fd, int fmode)
 
     if (NULL == (biop = (biobuf *)calloc(1, sizeof(biobuf))))
         return NULL;
+    if (NULL == (biop->base = (uint8_t *)calloc(1, BIO_DEFAULT_SIZE))) {
+        free(biop);
+        return NULL;
+    }
 
-    biop->fd   = fd;
-    biop->mode = fmode;
-    biop->ptr  = biop->base;
+    biop->fd       = fd;
+    biop->mode     = fmode;
+    biop->fpos     = -1;
+    biop->size     = BIO_DEFAULT_SIZE;
+    biop->npages   = 1;
+    biop->maxpages = 1;
+    biop->ptr      = biop->base;
 
     return biop;
 }
 
 /*
- * Read a page from the file into the buffer
+ * Set the # of pages in the window, growing the buffer if needed
+ *
+ * The buffer's contents are lost when it grows.  If it can't grow, the
+ * window is left as it was.
+ */
+static void
+bio_set_window(biobuf *biop, int npages)
+{
+    if (npages > biop->maxpages) {
+        uint8_t *base = (uint8_t *)malloc((size_t)npages * (size_t)biop->size);
+
+        if (base == NULL)
+            return;
+        free(biop->base);
+        biop->base     = base;
+        biop->ptr      = base;
+        biop->cnt      = 0;
+        biop->maxpages = npages;
+    }
+    biop->npages = npages;
+}
+
+/*
+ * Grow the window of a read-only file which is being read straight through
+ */
+static void
+bio_read_ahead(biobuf *biop)
+{
+    int maxpages = MAX(1, BIO_MAX_AHEAD / biop->size);
+
+    if (RDONLY(biop) && biop->npages < maxpages)
+        bio_set_window(biop, MIN(2 * biop->npages, maxpages));
+}
+
+/*
+ * Move the file descriptor to off, unless it is already there
+ */
+static int
+bio_seek(biobuf *biop, off_t off)
+{
+    if (biop->fpos != off) {
+        biop->fpos = lseek(biop->fd, off, SEEK_SET);
+        if (biop->fpos == ((off_t)-1))
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * Read a window from the file into the buffer
  */
 static int
 bio_read_page(biobuf *biop)
 {
-    /* Clear out the buffer */
-    memset(biop->base, 0, BIOBUFSIZ);
+    int len = biop->npages * biop->size;
 
     if (biop->mode & O_WRONLY) {
         /* If we're only writing, the buffer is empty */
+        memset(biop->base, 0, (size_t)biop->size);
         biop->cnt = 0;
     }
     else {
-        if (biop->nwrote != BIOBUFSIZ) {
-            /* Last write wasn't a full block, adjust position ahead */
-            if (lseek(biop->fd, biop->page * BIOBUFSIZ, SEEK_SET) == ((off_t)-1))
-                return -1;
-        }
+        if (bio_seek(biop, biop->page * biop->size) < 0)
+            return -1;
 
         /* Read from storage into the buffer */
-        biop->nread = biop->cnt = read(biop->fd, (void *)biop->base, BIOBUFSIZ);
+        biop->cnt = read(biop->fd, (void *)biop->base, (size_t)len);
+        if (biop->cnt < 0) {
+            biop->fpos = -1;
+            return -1;
+        }
+        biop->fpos += biop->cnt;
+
+        /* Clear out the rest of the buffer */
+        memset(biop->base + biop->cnt, 0, (size_t)(len - biop->cnt));
     }
 
     biop->ptr = biop->base;
@@ -407,21 +480,21 @@ bio_read_page(biobuf *biop)
 static int
 bio_write_page(biobuf *biop)
 {
+    int nwrote = 0;
 
-    if (!((biop->mode & O_WRONLY) || (biop->mode & O_RDWR)) || biop->cnt == 0) {
-        biop->nwrote = 0;
-    }
-    else {
-        if (biop->nread != 0) {
-            /* If we read something, we have to adjust position back */
-            if (lseek(biop->fd, biop->page * BIOBUFSIZ, SEEK_SET) == ((off_t)-1))
-                return -1;
+    if (((biop->mode & O_WRONLY) || (biop->mode & O_RDWR)) && biop->cnt != 0) {
+        if (bio_seek(biop, biop->page * biop->size) < 0)
+            return -1;
+        nwrote = write(biop->fd, (void *)biop->base, (size_t)biop->cnt);
+        if (nwrote < 0) {
+            biop->fpos = -1;
+            return -1;
         }
-        biop->nwrote = write(biop->fd, (void *)biop->base, biop->cnt);
+        biop->fpos += nwrote;
     }
     biop->isdirty = 0;
 
-    return biop->nwrote;
+    return nwrote;
 }
 
 /*
@@ -438,7 +511,8 @@ bio_get_next_page(biobuf *biop)
             return -1;
     }
 
-    biop->page++;
+    biop->page += biop->npages;
+    bio_read_ahead(biop);
 
     /* Read in the next page */
     if (bio_read_page(biop) < 0)
@@ -447,26 +521,70 @@ bio_get_next_page(biobuf *biop)
     return biop->cnt;
 }
 
+/*
+ * Read whole pages from the file straight into ptr, then read the page
+ * after them into the buffer
+ *
+ * Returns the number of bytes read into ptr
+ */
+static int
+bio_read_direct(biobuf *biop, unsigned char *ptr, int nbytes)
+{
+    off_t page = biop->page + biop->npages;
+    int   nread;
+
+    /* Flush if dirty */
+    if (biop->isdirty) {
+        if (bio_write_page(biop) < 0)
+            return -1;
+    }
+
+    if (bio_seek(biop, page * biop->size) < 0)
+        return -1;
+    nread = read(biop->fd, (void *)ptr, (size_t)(nbytes - nbytes % biop->size));
+    if (nread < 0) {
+        biop->fpos = -1;
+        return -1;
+    }
+    biop->fpos += nread;
+
+    biop->page = page + nread / biop->size;
+    if (bio_read_page(biop) < 0)
+        return -1;
+    biop->ptr += MIN(nread % biop->size, biop->cnt);
+
+    return nread;
+}
+
 /*
  * Read bytes from the file through the buffer
  */
 static int
 bio_read(biobuf *biop, unsigned char *ptr, int nbytes)
 {
-    int    ngot = 0;
-    size_t rem;
+    int ngot = 0;
+    int rem;
+    int nread;
 
     if (nbytes == 0)
         return 0;
 
     while (nbytes > (rem = REM(biop))) {
         if (rem > 0) {
-            (void)memcpy(ptr, biop->ptr, rem);
+            (void)memcpy(ptr, biop->ptr, (size_t)rem);
             ptr += rem;
             nbytes -= rem;
             ngot += rem;
         }
-        if (bio_get_next_page(biop) <= 0)
+        if (nbytes >= biop->size && !(biop->mode & O_WRONLY)) {
+            /* Skip the buffer for whole pages */
+            if ((nread = bio_read_direct(biop, ptr, nbytes)) <= 0)
+                return ngot;
+            ptr += nread;
+            nbytes -= nread;
+            ngot += nread;
+        }
+        else if (bio_get_next_page(biop) <= 0)
             return ngot;
     }
 
@@ -483,18 +601,18 @@ bio_read(biobuf *biop, unsigned char *ptr, int nbytes)
 static int
 bio_write(biobuf *biop, unsigned char *ptr, int nbytes)
 {
-    size_t rem;
-    int    nwrote = 0;
-    int    cnt;
+    int rem;
+    int nwrote = 0;
+    int cnt;
 
     if (!((biop->mode & O_WRONLY) || (biop->mode & O_RDWR)))
         return -1;
 
     while (nbytes > (rem = BREM(biop))) {
         if (rem > 0) {
-            (void)memcpy(biop->ptr, ptr, rem);
+            (void)memcpy(biop->ptr, ptr, (size_t)rem);
             biop->isdirty = !0;
-            biop->cnt     = BIOBUFSIZ;
+            biop->cnt     = biop->size;
             ptr += rem;
             nbytes -= rem;
             nwrote += rem;
@@ -586,7 +704,7 @@ unsigned
 hdf_xdr_getpos(XDR *xdrs)
 {
     biobuf *biop = (biobuf *)xdrs->x_private;
-    return BIOBUFSIZ * biop->page + CNT(biop);
+    return biop->size * biop->page + CNT(biop);
 }
 
 bool_t
@@ -597,20 +715,31 @@ hdf_xdr_setpos(XDR *xdrs, unsigned pos)
         off_t page;
         int   index;
         int   nread;
-        page  = pos / BIOBUFSIZ;
-        index = pos % BIOBUFSIZ;
+        page  = pos / (unsigned)biop->size;
+        index = (int)(pos % (unsigned)biop->size);
+        if (RDONLY(biop) && page >= biop->page && page < biop->page + biop->npages) {
+            /* Still in the window */
+            index += (int)(page - biop->page) * biop->size;
+            if (index > biop->cnt)
+                return FALSE;
+            page = biop->page;
+        }
         if (page != biop->page) {
             if (biop->isdirty) {
                 if (bio_write_page(biop) < 0)
                     return FALSE;
             }
-            if (page != biop->page + 1)
-                biop->nwrote = 0; /* force seek in bio_read_page */
+
+            /* Keep reading ahead only if this is the next window */
+            if (page == biop->page + biop->npages)
+                bio_read_ahead(biop);
+            else
+                bio_set_window(biop, 1);
 
             biop->page = page;
 
             nread = bio_read_page(biop);
-            if (nread < 0 || ((biop->mode & O_RDONLY) && nread < index))
+            if (nread < 0 || (RDONLY(biop) && nread < index))
                 return FALSE;
         }
         biop->ptr = biop->base + index;
@@ -620,6 +749,47 @@ hdf_xdr_setpos(XDR *xdrs, unsigned pos)
         return FALSE;
 }
 
+/*
+ * Set the size of the pages the I/O buffer reads and writes, keeping the
+ * position in the file
+ */
+int
+hdf_xdr_setbufsize(XDR *xdrs, unsigned size)
+{
+    biobuf  *biop = (biobuf *)xdrs->x_private;
+    uint8_t *base = NULL;
+    unsigned pos;
+
+    if (biop == NULL || size == 0 || size > INT_MAX / 2)
+        return -1;
+    if ((int)size == biop->size)
+        return 0;
+
+    pos = hdf_xdr_getpos(xdrs);
+
+    /* Flush if dirty */
+    if (biop->isdirty) {
+        if (bio_write_page(biop) < 0)
+            return -1;
+    }
+
+    if (NULL == (base = (uint8_t *)calloc(1, size)))
+        return -1;
+    free(biop->base);
+    biop->base     = base;
+    biop->size     = (int)size;
+    biop->npages   = 1;
+    biop->maxpages = 1;
+
+    /* Read in the page holding pos */
+    biop->page = pos / size;
+    if (bio_read_page(biop) < 0)
+        return -1;
+    biop->ptr += pos % size;
+
+    return 0;
+}
+
 /************************/
 /* XDR File State Calls */
 /************************/
@@ -683,6 +853,7 @@ hdf_xdr_destroy(XDR *xdrs)
         }
         if (biop->fd != -1)
             (void)close(biop->fd);
+        free(biop->base);
         free(biop);
     }
 }
@@ -115,6 +115,8 @@ HDFLIBAPI void hdf_xdr_destroy(XDR *);
 
 HDFLIBAPI void hdf_xdr_setup_nofile(XDR *xdrs, int ncop);
 
+HDFLIBAPI int hdf_xdr_setbufsize(XDR *xdrs, unsigned size);
+
 #ifdef __cplusplus
 }
 #endif
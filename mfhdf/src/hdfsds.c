@@ -76,16 +76,17 @@
 
 #define SDG_MAX_INITIAL 100
 
-/* local variables */
-static int     sdgCurrent;
-static int     sdgMax;
-static uint16 *sdgTable = NULL;
-static uint8  *ptbuf    = NULL;
+/* SDGs seen in SDG-NDG combos while reading one file */
+typedef struct {
+    int     sdgCurrent;
+    int     sdgMax;
+    uint16 *sdgTable;
+} sdg_seen_t;
 
 /* Local routines */
-static int hdf_query_seen_sdg(uint16 ndgRef);
+static int hdf_query_seen_sdg(const sdg_seen_t *seen, uint16 ndgRef);
 
-static int hdf_register_seen_sdg(uint16 ndgRef);
+static int hdf_register_seen_sdg(sdg_seen_t *seen, uint16 ndgRef);
 
 static int hdf_read_ndgs(NC *handle);
 
@@ -107,15 +108,15 @@ uint8 *hdf_get_pred_str_attr(NC *handle, uint16 stratt_tag, uint16 satt_ref, int
 
 ******************************************************************************/
 static int
-hdf_query_seen_sdg(uint16 ndgRef)
+hdf_query_seen_sdg(const sdg_seen_t *seen, uint16 ndgRef)
 {
     int i;
 
-    if (!sdgTable)
+    if (!seen->sdgTable)
         return FALSE;
 
-    for (i = 0; i < sdgCurrent; i++) {
-        if (sdgTable[i] == ndgRef)
+    for (i = 0; i < seen->sdgCurrent; i++) {
+        if (seen->sdgTable[i] == ndgRef)
             return TRUE;
     }
 
@@ -135,30 +136,32 @@ hdf_query_seen_sdg(uint16 ndgRef)
 
 ******************************************************************************/
 static int
-hdf_register_seen_sdg(uint16 sdgRef)
+hdf_register_seen_sdg(sdg_seen_t *seen, uint16 sdgRef)
 {
-    int ret_value = SUCCEED;
+    uint16 *new_table;
+    int     ret_value = SUCCEED;
 
     /* check if table is allocated */
-    if (!sdgTable) {
-        sdgMax   = SDG_MAX_INITIAL;
-        sdgTable = malloc((size_t)sdgMax * sizeof(uint16));
-        if (sdgTable == NULL) {
+    if (!seen->sdgTable) {
+        seen->sdgMax   = SDG_MAX_INITIAL;
+        seen->sdgTable = malloc((size_t)seen->sdgMax * sizeof(uint16));
+        if (seen->sdgTable == NULL) {
             HGOTO_ERROR(DFE_NOSPACE, FAIL);
         }
-        sdgCurrent = 0;
+        seen->sdgCurrent = 0;
     }
 
     /* add ref to table */
-    sdgTable[sdgCurrent++] = sdgRef;
+    seen->sdgTable[seen->sdgCurrent++] = sdgRef;
 
     /* check if we need to increase size of table */
-    if (sdgCurrent == sdgMax) {
-        sdgMax *= 2;
-        sdgTable = realloc(sdgTable, (size_t)sdgMax * sizeof(uint16));
-        if (sdgTable == NULL) {
+    if (seen->sdgCurrent == seen->sdgMax) {
+        new_table = realloc(seen->sdgTable, (size_t)seen->sdgMax * 2 * sizeof(uint16));
+        if (new_table == NULL) {
             HGOTO_ERROR(DFE_NOSPACE, FAIL);
         }
+        seen->sdgTable = new_table;
+        seen->sdgMax *= 2;
     }
 
 done:
@@ -728,7 +731,7 @@ done:
 
 ******************************************************************************/
 static hdf_err_code_t
-hdf_get_rangeinfo(nc_type nctype, int32 hdftype, NC_attr **tmp_attr, int *curr_attr)
+hdf_get_rangeinfo(uint8 *ptbuf, nc_type nctype, int32 hdftype, NC_attr **tmp_attr, int *curr_attr)
 {
     uint8          tBuf[128] = "";
     int            idx       = 0; /* index for tBuf */
@@ -780,7 +783,7 @@ done:
 
 ******************************************************************************/
 static hdf_err_code_t
-hdf_get_cal(nc_type nctype, int32 hdftype, NC_attr **tmp_attr, int *curr_attr)
+hdf_get_cal(uint8 *ptbuf, nc_type nctype, int32 hdftype, NC_attr **tmp_attr, int *curr_attr)
 {
     uint8          tBuf[128] = "";
     int            idx       = 0; /* index for tBuf */
@@ -935,7 +938,9 @@ hdf_read_ndgs(NC *handle)
     uint8 *p = NULL;
     int    scale_offset; /* current offset into the scales record for the
                         current dimension's values */
-    int ret_value = SUCCEED;
+    uint8     *ptbuf     = NULL;            /* buffer for the elements of an NDG */
+    sdg_seen_t seen      = {0, 0, NULL};    /* SDGs seen in SDG-NDG combos */
+    int        ret_value = SUCCEED;
 
     /*
      *  Allocate the array to store the dimensions
@@ -986,7 +991,7 @@ hdf_read_ndgs(NC *handle)
             }
 
             /* Test if its an SDG-NDG which we've processed already */
-            if ((ndgTag == DFTAG_SDG) && (hdf_query_seen_sdg(ndgRef))) {
+            if ((ndgTag == DFTAG_SDG) && (hdf_query_seen_sdg(&seen, ndgRef))) {
                 status = Hnextread(aid, ndgTag, DFREF_WILDCARD, DF_CURRENT);
                 continue; /* go to next element */
             }
@@ -1149,7 +1154,7 @@ hdf_read_ndgs(NC *handle)
                             if (Hlength(handle->hdf_file, tmpTag, tmpRef) == 36) {
                                 /* DFNT_FLOAT64 based calibration */
                                 err_code =
-                                    hdf_get_cal(NC_DOUBLE, DFNT_FLOAT64, &attrs[current_attr], &current_attr);
+                                    hdf_get_cal(ptbuf, NC_DOUBLE, DFNT_FLOAT64, &attrs[current_attr], &current_attr);
                                 if (err_code != DFE_NONE) {
                                     HGOTO_ERROR(err_code, FAIL);
                                 }
@@ -1157,7 +1162,7 @@ hdf_read_ndgs(NC *handle)
                             else {
                                 /* DFNT_FLOAT32 based calibration */
                                 err_code =
-                                    hdf_get_cal(NC_FLOAT, DFNT_FLOAT32, &attrs[current_attr], &current_attr);
+                                    hdf_get_cal(ptbuf, NC_FLOAT, DFNT_FLOAT32, &attrs[current_attr], &current_attr);
 
                                 if (err_code != DFE_NONE) {
                                     HGOTO_ERROR(err_code, FAIL);
@@ -1172,7 +1177,7 @@ hdf_read_ndgs(NC *handle)
                             HGOTO_ERROR(DFE_GETELEM, FAIL);
                         }
 
-                        err_code = hdf_get_rangeinfo(type, HDFtype, &attrs[current_attr], &current_attr);
+                        err_code = hdf_get_rangeinfo(ptbuf, type, HDFtype, &attrs[current_attr], &current_attr);
                         if (err_code != DFE_NONE) {
                             HGOTO_ERROR(err_code, FAIL);
                         }
@@ -1199,7 +1204,7 @@ hdf_read_ndgs(NC *handle)
                             UINT16DECODE(p, sdgTag);
                             UINT16DECODE(p, sdgRef);
 
-                            if (hdf_register_seen_sdg(sdgRef) == FAIL) {
+                            if (hdf_register_seen_sdg(&seen, sdgRef) == FAIL) {
                                 HGOTO_ERROR(DFE_INTERNAL, FAIL);
                             }
                         }
@@ -1562,6 +1567,9 @@ done:
         free(ptbuf);
     }
 
+    /* deallocate SDG-NDG space */
+    free(seen.sdgTable);
+
     free(dims);
     free(vars);
     free(attrs);
@@ -1599,10 +1607,6 @@ hdf_read_sds_cdf(XDR *xdrs, NC **handlep)
      * should we try to create an unlimited dimension somehow ???
      */
 
-    /* we haven't seen any SDG-NDG combos yet */
-    free(sdgTable);
-    sdgTable = NULL;
-
     handle = (*handlep);
     if (NULL == handle) {
         HGOTO_ERROR(DFE_ARGS, FAIL);
@@ -1613,10 +1617,6 @@ hdf_read_sds_cdf(XDR *xdrs, NC **handlep)
         HGOTO_ERROR(DFE_INTERNAL, FAIL);
     }
 
-    /* deallocate SDG-NDG space */
-    free(sdgTable);
-    sdgTable = NULL;
-
 done:
     return ret_value;
 } /* hdf_read_sds_cdf */
@@ -28,6 +28,14 @@
 #define SD_DIMVAL_BW_INCOMP 0
 #define SD_RAGGED           -1 /* Marker for ragged dimension */
 
+/* Range of the I/O buffer page size of a netCDF file, see SDsetbufsize() */
+#define SD_MIN_BUFSIZE 512
+#define SD_MAX_BUFSIZE (16 * 1024 * 1024)
+
+/* How much of each data set SDstart reads in, see SDsetmetaload() */
+#define SD_META_ALL  0 /* everything (default) */
+#define SD_META_LAZY 1 /* only the name, the rest on first use */
+
 /* Fill values
  *
  * These values are stuffed into newly allocated space as appropriate.
@@ -122,6 +130,12 @@ HDFLIBAPI int SDgetfillvalue(int32 sdsid, void *val);
 
 HDFLIBAPI int SDsetfillmode(int32 id, int fillmode);
 
+HDFLIBAPI int SDsetbufsize(int32 id, int32 size);
+
+HDFLIBAPI int SDsetmetaload(int mode);
+
+HDFLIBAPI int SDsetmetaindex(int32 id, int flag);
+
 HDFLIBAPI int SDgetdatastrs(int32 sdsid, char *l, char *u, char *f, char *c, int len);
 
 HDFLIBAPI int SDgetcal(int32 sdsid, float64 *cal, float64 *cale, float64 *ioff, float64 *ioffe, int32 *nt);
@@ -433,6 +447,58 @@ HDFLIBAPI int SDsetchunkcache(int32 sdsid,    /* IN: sds access id */
                               int32 maxcache, /* IN: max number of chunks to cache */
                               int32 flags /* IN: flags = 0, HDF_CACHEALL */);
 
+/******************************************************************************
+NAME
+     SDsetchunkcacheparams -- byte bound and replacement policy of the chunk cache
+
+DESCRIPTION
+     Bounds the chunk cache of the SDS to 'maxbytes' bytes of chunks, at
+     least one chunk, and sets which chunk leaves the cache when it is
+     full.  With a 'maxbytes' of 0 the cache stays bounded by the number of
+     chunks set with SDsetchunkcache().  Unlike SDsetchunkcache() the cache
+     may shrink; dirty chunks which are dropped are written out.
+
+     'policy' is one of:
+
+     HDF_CACHE_LRU - the least recently used chunk (the default).
+     HDF_CACHE_ARC - adaptive replacement: chunks used once and chunks
+                     used again are kept apart, so a large scan does not
+                     flush the chunks which are reused.
+     HDF_CACHE_W0  - the least recently used chunk which has been read or
+                     written in full, else the least recently used chunk.
+                     Suits reads which visit each chunk once.
+
+    See SDsetchunk() for a description of the organization of chunks in an SDS.
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+******************************************************************************/
+HDFLIBAPI int SDsetchunkcacheparams(int32 sdsid,    /* IN: sds access id */
+                                    int32 maxbytes, /* IN: max bytes of chunks to cache, or 0 */
+                                    int32 policy /* IN: HDF_CACHE_LRU, HDF_CACHE_ARC or HDF_CACHE_W0 */);
+
+/******************************************************************************
+NAME
+     SDgetchunkcachestats -- statistics of the chunk cache
+
+DESCRIPTION
+     Fills in 'stats' with the statistics of the chunk cache of the SDS
+     since the SDS was selected:
+
+     hits      - chunks found in the cache
+     misses    - chunks read in, or created when they didn't exist yet
+     evictions - chunks dropped to make room in the cache
+     reclaims  - chunks taken by the caches of other datasets to keep all
+                 caches within the budget set with Hsetchunkcachebudget()
+     nchunks   - chunks in the cache now
+     chunksize - bytes in a chunk
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+******************************************************************************/
+HDFLIBAPI int SDgetchunkcachestats(int32            sdsid, /* IN: sds access id */
+                                   HDF_CACHE_STATS *stats /* OUT: statistics of the chunk cache */);
+
 /*
  ** Public functions for getting raw data information - from mfdatainfo.c
  */
@@ -167,6 +167,11 @@ SDIget_var(NC   *handle, /* IN: the handle for this file */
     else
         HGOTO_ERROR(DFE_ARGS, NULL);
 
+    /* read in the rest of the variable if only its name has been */
+    if (((NC_var *)*ap)->unread)
+        if (hdf_load_var(handle, (int)varid) == FAIL)
+            HGOTO_ERROR(DFE_INTERNAL, NULL);
+
     ret_value = ((NC_var *)*ap);
 
 done:
@@ -294,18 +299,24 @@ SDstart(const char *name, /* IN: file name to open */
     int32 fid       = -1;
     int   NCmode    = -1;
     NC   *handle    = NULL;
+    int   status    = SUCCEED;
     int32 ret_value = SUCCEED;
 
     /* clear error stack */
     HEclear();
 
+    HTS_REGISTRY_LOCK();
+
     /* turn off annoying crash on error stuff */
-    ncopts = 0;
+    if (ncopts != 0)
+        ncopts = 0;
 
     /* Perform global, one-time initialization */
     if (library_terminate == FALSE)
-        if (SDIstart() == FAIL)
-            HGOTO_ERROR(DFE_CANTINIT, FAIL);
+        status = SDIstart();
+    HTS_REGISTRY_UNLOCK();
+    if (status == FAIL)
+        HGOTO_ERROR(DFE_CANTINIT, FAIL);
 
     /* check access mode */
     if (HDFmode & DFACC_WRITE)
@@ -500,6 +511,11 @@ SDselect(int32 fid, /* IN: file ID */
         HGOTO_ERROR(DFE_ARGS, FAIL);
     }
 
+    /* read in the rest of the data set if only its name has been */
+    if (SDIget_var(handle, index) == NULL) {
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    }
+
     /* create SDS id to return */
     sdsid = (((int32)fid & 0xffff) << 20) + (((int32)SDSTYPE) << 16) + index;
 
@@ -783,10 +799,10 @@ int32
 SDnametoindex(int32       fid, /* IN: file ID */
               const char *name /* IN: name of dataset to search for */)
 {
-    size_t   len;
-    NC      *handle    = NULL;
-    NC_var **dp        = NULL;
-    int32    ret_value = FAIL;
+    NC        *handle    = NULL;
+    NC_string *vname     = NULL;
+    NC_var   **dp        = NULL;
+    int32      ret_value = FAIL;
 
     /* check that fid is valid */
     handle = SDIhandle_from_id(fid, CDFTYPE);
@@ -798,15 +814,25 @@ SDnametoindex(int32       fid, /* IN: file ID */
         HGOTO_ERROR(DFE_ARGS, FAIL);
     }
 
-    len = strlen(name);
-    dp  = (NC_var **)handle->vars->values;
-    for (unsigned ii = 0; ii < handle->vars->count; ii++, dp++) {
-        if (len == (*dp)->name->len && strncmp(name, (*dp)->name->values, strlen(name)) == 0) {
-            HGOTO_DONE((int32)ii);
+    /* index the names of the data sets the first time through, and those
+       of the data sets created since then on later calls */
+    if (handle->var_names == NULL) {
+        if ((handle->var_names = HNIcreate()) == NULL)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
+        handle->var_named = 0;
+    }
+    dp = (NC_var **)handle->vars->values;
+    for (; handle->var_named < handle->vars->count; handle->var_named++) {
+        vname = dp[handle->var_named]->name;
+        if (HNIadd(handle->var_names, vname->values != NULL ? vname->values : "", (int32)handle->var_named) ==
+            FAIL) {
+            HNIdestroy(handle->var_names);
+            handle->var_names = NULL;
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
         }
     }
 
-    ret_value = FAIL;
+    ret_value = HNIfind(handle->var_names, name);
 
 done:
     return ret_value;
@@ -912,6 +938,8 @@ SDnametoindices(int32          fid,  /* IN: file ID */
     varlistp = var_list;
     for (unsigned ii = 0; ii < handle->vars->count; ii++, dp++) {
         if (len == (*dp)->name->len && strncmp(name, (*dp)->name->values, strlen(name)) == 0) {
+            if ((*dp)->unread && hdf_load_var(handle, (int)ii) == FAIL)
+                HGOTO_ERROR(DFE_INTERNAL, FAIL);
             varlistp->var_index = (int32)ii;
             varlistp->var_type  = (*dp)->var_type;
             varlistp++;
@@ -2431,6 +2459,12 @@ SDIgetcoordvar(NC     *handle, /* IN: file handle */
     len  = dim->name->len;
     dp   = (NC_var **)handle->vars->values;
     for (unsigned ii = 0; ii < handle->vars->count; ii++, dp++) {
+        /* read in the rest of a variable of this name if only its name has been */
+        if ((*dp)->unread && len == (*dp)->name->len &&
+            strncmp(name->values, (*dp)->name->values, (size_t)len) == 0 &&
+            hdf_load_var(handle, (int)ii) == FAIL)
+            HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
         /* eliminate vars with rank > 1, coord vars only have rank 1 */
         if ((*dp)->assoc->count == 1)
             if (len == (*dp)->name->len && strncmp(name->values, (*dp)->name->values, (size_t)len) == 0)
@@ -2874,6 +2908,11 @@ SDdiminfo(int32  id,   /* IN:  dimension ID */
         len = dim->name->len;
         dp  = (NC_var **)handle->vars->values;
         for (int ii = 0; ii < handle->vars->count; ii++, dp++) {
+            /* read in the rest of a variable of this name if only its name has been */
+            if ((*dp)->unread && len == (*dp)->name->len &&
+                strncmp(name, (*dp)->name->values, (*dp)->name->len) == 0 && hdf_load_var(handle, ii) == FAIL)
+                HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
             /* eliminate vars with rank > 1, coord vars only have rank 1 */
             if ((*dp)->assoc->count == 1) {
                 /* check if this variable matches the searched name */
@@ -2960,6 +2999,11 @@ SDgetdimstrs(int32 id, /* IN:  dataset ID */
         namelen = (int32)strlen(name);
         dp      = (NC_var **)handle->vars->values;
         for (int i = 0; i < handle->vars->count; i++, dp++) {
+            /* read in the rest of a variable of this name if only its name has been */
+            if ((*dp)->unread && namelen == (*dp)->name->len &&
+                strncmp(name, (*dp)->name->values, strlen(name)) == 0 && hdf_load_var(handle, i) == FAIL)
+                HGOTO_ERROR(DFE_INTERNAL, FAIL);
+
             /* eliminate vars with rank > 1, coord vars only have rank 1 */
             if ((*dp)->assoc->count == 1) {
                 if (namelen == (*dp)->name->len && strncmp(name, (*dp)->name->values, strlen(name)) == 0) {
@@ -4090,6 +4134,9 @@ SDreftoindex(int32 fid, /* IN: file ID */
 
     dp = (NC_var **)handle->vars->values;
     for (int ii = 0; ii < handle->vars->count; ii++, dp++) {
+        /* the ref is only known once the variable has been read in */
+        if ((*dp)->unread && hdf_load_var(handle, ii) == FAIL)
+            continue;
         if ((*dp)->ndg_ref == ref) {
             HGOTO_ERROR(DFE_ARGS, ii);
         }
@@ -4434,6 +4481,124 @@ done:
     return ret_value;
 } /* SDsetfillmode() */
 
+/******************************************************************************
+ NAME
+   SDsetbufsize -- set the size of the I/O buffer of a netCDF file
+
+ DESCRIPTION
+   Sets the size in bytes of the pages which the buffer used to read and
+   write a netCDF file holds, between SD_MIN_BUFSIZE (512) and
+   SD_MAX_BUFSIZE (16 MB).  The default is 8192 bytes.  Larger pages mean
+   fewer system calls for each byte read or written; reads of a page or
+   more go around the buffer.  HDF files don't use this buffer, so the size
+   is ignored for them.
+
+ RETURNS
+   SUCCEED/FAIL
+
+******************************************************************************/
+int
+SDsetbufsize(int32 sd_id, /* IN: HDF file ID, returned from SDstart */
+             int32 size /* IN: size of a page of the buffer in bytes */)
+{
+    NC *handle    = NULL;
+    int ret_value = SUCCEED;
+
+    /* clear error stack */
+    HEclear();
+
+    /* get the handle */
+    handle = SDIhandle_from_id(sd_id, CDFTYPE);
+    if (handle == NULL)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    if (size < SD_MIN_BUFSIZE || size > SD_MAX_BUFSIZE)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    if (handle->file_type == netCDF_FILE)
+        if (hdf_xdr_setbufsize(handle->xdrs, (unsigned)size) < 0)
+            HGOTO_ERROR(DFE_NOSPACE, FAIL);
+
+done:
+    return ret_value;
+} /* SDsetbufsize() */
+
+/******************************************************************************
+ NAME
+   SDsetmetaload -- set how much of each data set SDstart reads in
+
+ DESCRIPTION
+   Sets how much of the information about each data set (dimensions,
+   number type, attributes, data storage) is read in by the SDstart calls
+   which follow.  With SD_META_ALL, the default, all of it is read in
+   before SDstart returns.  With SD_META_LAZY only the names of the data
+   sets are read in, and the rest of a data set's information is read in
+   when the data set is first used, e.g. by SDselect, SDgetinfo or
+   SDattrinfo.  This makes opening a file with many data sets faster when
+   only a few of them are used.  SD_META_LAZY applies only to HDF files
+   opened with DFACC_READ.
+
+ RETURNS
+   SUCCEED/FAIL
+
+******************************************************************************/
+int
+SDsetmetaload(int mode /* IN: SD_META_ALL or SD_META_LAZY */)
+{
+    int ret_value = SUCCEED;
+
+    /* clear error stack */
+    HEclear();
+
+    if (hdf_set_metaload(mode) == FAIL)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+done:
+    return ret_value;
+} /* SDsetmetaload() */
+
+/******************************************************************************
+ NAME
+   SDsetmetaindex -- write an index of the metadata when the file is closed
+
+ DESCRIPTION
+   When flag is TRUE, SDend writes an index of the file's dimensions and
+   data set names into the file.  A later SDstart with DFACC_READ reads
+   the dimensions, and after SDsetmetaload(SD_META_LAZY) the names of the
+   data sets, out of the index instead of out of the Vgroups of each of
+   them.  The index is an element of its own which older versions of the
+   library ignore; if such a version changes the file, the index no
+   longer matches the file and is not used.  Only HDF files opened for
+   writing can be given an index.
+
+ RETURNS
+   SUCCEED/FAIL
+
+******************************************************************************/
+int
+SDsetmetaindex(int32 sd_id, /* IN: HDF file ID, returned from SDstart */
+               int   flag /* IN: TRUE to write the index at SDend */)
+{
+    NC *handle    = NULL;
+    int ret_value = SUCCEED;
+
+    /* clear error stack */
+    HEclear();
+
+    /* get the handle */
+    handle = SDIhandle_from_id(sd_id, CDFTYPE);
+    if (handle == NULL)
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    if (handle->file_type != HDF_FILE || !(handle->flags & NC_RDWR))
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+
+    handle->metaindex = flag ? TRUE : FALSE;
+
+done:
+    return ret_value;
+} /* SDsetmetaindex() */
+
 /******************************************************************************
  NAME
     SDsetdimval_comp -- set dimval backward compatibility
@@ -5657,6 +5822,139 @@ done:
     return ret_value;
 } /* SDsetchunkcache() */
 
+/******************************************************************************
+NAME
+     SDsetchunkcacheparams - byte bound and replacement policy of the chunk cache
+
+DESCRIPTION
+     Bounds the chunk cache of the SDS to 'maxbytes' bytes of chunks and
+     sets which chunk leaves the cache when it is full, one of
+     HDF_CACHE_LRU, HDF_CACHE_ARC or HDF_CACHE_W0.  A 'maxbytes' of 0 keeps
+     the bound set with SDsetchunkcache().
+
+     NOTE:
+          This routine directly calls a Special Chunked Element fcn HMCxxx.
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+******************************************************************************/
+int
+SDsetchunkcacheparams(int32 sdsid,    /* IN: access aid to mess with */
+                      int32 maxbytes, /* IN: max bytes of chunks to cache, or 0 */
+                      int32 policy /* IN: HDF_CACHE_LRU, HDF_CACHE_ARC or HDF_CACHE_W0 */)
+{
+    NC     *handle = NULL; /* file handle */
+    NC_var *var    = NULL; /* SDS variable */
+    int16   special;       /* Special code */
+    int     ret_value = SUCCEED;
+
+    /* clear error stack */
+    HEclear();
+
+    /* Check args */
+    if (maxbytes < 0) {
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    }
+
+    if (policy != HDF_CACHE_LRU && policy != HDF_CACHE_ARC && policy != HDF_CACHE_W0) {
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    }
+
+    /* get file handle and verify it is an HDF file
+       we only handle dealing with SDS only not coordinate variables */
+    handle = SDIhandle_from_id(sdsid, SDSTYPE);
+    if (handle == NULL || handle->file_type != HDF_FILE || handle->vars == NULL) {
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    }
+
+    /* get variable from id */
+    var = SDIget_var(handle, sdsid);
+    if (var == NULL) {
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    }
+
+    /* Check to see if data aid exists? i.e. may need to create a ref for SDS */
+    if (var->aid == FAIL && hdf_get_vp_aid(handle, var) == FAIL) {
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    }
+
+    /* inquire about element */
+    if (Hinquire(var->aid, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &special) == FAIL) {
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+    }
+    if (special != SPECIAL_CHUNKED) {
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    }
+
+    ret_value = HMCsetCacheparams(var->aid, maxbytes, policy);
+
+done:
+    return ret_value;
+} /* SDsetchunkcacheparams() */
+
+/******************************************************************************
+NAME
+     SDgetchunkcachestats - statistics of the chunk cache
+
+DESCRIPTION
+     Fills in 'stats' with the hits, misses, evictions and reclaims of the
+     chunk cache of the SDS, and the chunks it holds now.
+
+     NOTE:
+          This routine directly calls a Special Chunked Element fcn HMCxxx.
+
+RETURNS
+     Returns SUCCEED if successful and FAIL otherwise
+******************************************************************************/
+int
+SDgetchunkcachestats(int32            sdsid, /* IN: access aid to mess with */
+                     HDF_CACHE_STATS *stats /* OUT: statistics of the chunk cache */)
+{
+    NC     *handle = NULL; /* file handle */
+    NC_var *var    = NULL; /* SDS variable */
+    int16   special;       /* Special code */
+    int     ret_value = SUCCEED;
+
+    /* clear error stack */
+    HEclear();
+
+    /* Check args */
+    if (stats == NULL) {
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    }
+
+    /* get file handle and verify it is an HDF file
+       we only handle dealing with SDS only not coordinate variables */
+    handle = SDIhandle_from_id(sdsid, SDSTYPE);
+    if (handle == NULL || handle->file_type != HDF_FILE || handle->vars == NULL) {
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    }
+
+    /* get variable from id */
+    var = SDIget_var(handle, sdsid);
+    if (var == NULL) {
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    }
+
+    /* Check to see if data aid exists? i.e. may need to create a ref for SDS */
+    if (var->aid == FAIL && hdf_get_vp_aid(handle, var) == FAIL) {
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    }
+
+    /* inquire about element */
+    if (Hinquire(var->aid, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &special) == FAIL) {
+        HGOTO_ERROR(DFE_INTERNAL, FAIL);
+    }
+    if (special != SPECIAL_CHUNKED) {
+        HGOTO_ERROR(DFE_ARGS, FAIL);
+    }
+
+    ret_value = HMCgetCachestats(var->aid, stats);
+
+done:
+    return ret_value;
+} /* SDgetchunkcachestats() */
+
 /******************************************************************************
  NAME
     SDcheckempty -- checks whether an SDS is empty
@@ -245,6 +245,7 @@ HDFLIBAPI int ncopts; /* default is (NC_FATAL | NC_VERBOSE) */
 
 #include "vg.h"
 #include "hfile_priv.h"
+#include "hnameidx_priv.h"
 #include "mfhdf.h"
 
 #define ATTR_TAG  DFTAG_VH
@@ -338,8 +339,11 @@ typedef struct {
     int32      hdf_file;
     int        file_type;
     int32      vgid;
-    int        hdf_mode; /* mode we are attached for */
-    hdf_file_t cdf_fp;   /* file pointer used for CDF files */
+    int        hdf_mode;  /* mode we are attached for */
+    hdf_file_t cdf_fp;    /* file pointer used for CDF files */
+    int        metaindex; /* BOOLEAN == write the index of the metadata at close */
+    HNIindex_p var_names; /* index of the variable names, NULL until SDnametoindex needs it */
+    unsigned   var_named; /* # of variables in var_names */
 } NC;
 
 /* NC variable: description and data */
@@ -384,6 +388,8 @@ typedef struct {
     int32 *rag_list;   /* size of ragged array lines */
     int32  rag_fill;   /* last line in rag_list to be set */
     vix_t *vixHead;    /* list of VXR records for CDF data storage */
+    int32  unread;     /* BOOLEAN == only the name has been read in */
+    int32  vh_ref;     /* if unread, ref of the Vdata whose class var_type is to be read from, or 0 */
 } NC_var;
 
 #define IS_RECVAR(vp) ((vp)->shape != NULL ? (*(vp)->shape == NC_UNLIMITED) : 0)
@@ -519,6 +525,9 @@ HDFLIBAPI int       hdf_conv_scales(NC **);
 HDFLIBAPI int       hdf_read_dims(XDR *, NC *, int32);
 HDFLIBAPI NC_array *hdf_read_attrs(XDR *, NC *, int32);
 HDFLIBAPI int       hdf_read_vars(XDR *, NC *, int32);
+HDFLIBAPI int       hdf_load_var(NC *, int);
+HDFLIBAPI int       hdf_set_metaload(int);
+HDFLIBAPI int       hdf_write_index(NC *);
 HDFLIBAPI int       hdf_read_xdr_cdf(XDR *, NC **);
 HDFLIBAPI int       hdf_xdr_cdf(XDR *, NC **);
 HDFLIBAPI int       hdf_vg_clobber(NC *, int);
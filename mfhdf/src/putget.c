@@ -15,7 +15,9 @@
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 #include "nc_priv.h"
+#include "hconv_priv.h"
 #include "hfile_priv.h"
+#include "hthread_priv.h"
 
 /* Local function prototypes */
 static bool_t nssdc_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint32 count,
@@ -496,29 +498,40 @@ xdr_NCv1data(XDR *xdrs, unsigned long where, nc_type type, uint8_t *values)
  *
  *****************************************************************************/
 
-static int32 tBuf_size    = 0;
-static int32 tValues_size = 0;
-static int8 *tBuf         = NULL;
-static int8 *tValues      = NULL;
+/* Each thread's temporary conversion buffers */
+typedef struct {
+    int32 tBuf_size;
+    int32 tValues_size;
+    int8 *tBuf;
+    int8 *tValues;
+} SDbuf_t;
+
+/* ------------------------------ SDIfreebuf ------------------------------ */
+/*
+    Throw away the buffers in a thread's SDbuf_t, keeping the SDbuf_t
+*/
+static void
+SDIfreebuf(void *data)
+{
+    SDbuf_t *sb = (SDbuf_t *)data;
+
+    free(sb->tBuf);
+    sb->tBuf      = NULL;
+    sb->tBuf_size = 0;
+
+    free(sb->tValues);
+    sb->tValues      = NULL;
+    sb->tValues_size = 0;
+}
 
 /* ------------------------------ SDPfreebuf ------------------------------ */
 /*
-    Throw away the temporary buffer we've allocated
+    Throw away the temporary buffers this thread has allocated
 */
 int
 SDPfreebuf(void)
 {
-    if (tBuf != NULL) {
-        free(tBuf);
-        tBuf      = NULL;
-        tBuf_size = 0;
-    }
-
-    if (tValues != NULL) {
-        free(tValues);
-        tValues      = NULL;
-        tValues_size = 0;
-    }
+    HTSfree_local(HTS_SD_BUF);
 
     return SUCCEED;
 }
@@ -786,17 +799,21 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
     int32     new_count; /* computed by dividing number of elements 'count' by 2 since 'count' is too big to
                             allocate temporary buffer */
     int32    bytes_left;
-    int32    elem_length;    /* length of the element pointed to */
-    int8     platntsubclass; /* the machine type of the current platform */
-    int8     outntsubclass;  /* the data's machine type */
-    unsigned convert;        /* whether to convert or not */
-    uint8   *pvalues;        /* pointer to traverse user's buffer "values" */
+    int32    elem_length; /* length of the element pointed to */
+    unsigned convert;     /* whether to convert or not */
+    uint8   *pvalues;     /* pointer to traverse user's buffer "values" */
     int16    isspecial;
+    SDbuf_t *sb           = NULL; /* this thread's conversion buffers */
     int      ret_value    = SUCCEED;
     int32    alloc_status = FAIL; /* no successful allocation yet */
 
     (void)type;
 
+    if ((sb = (SDbuf_t *)HTSlocal(HTS_SD_BUF, sizeof(SDbuf_t), SDIfreebuf)) == NULL) {
+        ret_value = FAIL;
+        goto done;
+    }
+
     if (vp->aid == FAIL && hdf_get_vp_aid(handle, vp) == FAIL) {
         /*
          * Fail if there is no data *AND* we were trying to read...
@@ -851,22 +868,9 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
     /* Collect all the number-type size information, etc. */
     byte_count = count * vp->HDFsize;
 
-    if (FAIL == (platntsubclass = DFKgetPNSC(vp->HDFtype, DF_MT))) {
-        ret_value = FAIL;
-        goto done;
-    }
-
-    if (DFKisnativeNT(vp->HDFtype)) {
-        if (FAIL == (outntsubclass = DFKgetPNSC(vp->HDFtype, DF_MT))) {
-            ret_value = FAIL;
-            goto done;
-        }
-    }
-    else {
-        outntsubclass = DFKislitendNT(vp->HDFtype) ? DFNTF_PC : DFNTF_HDFDEFAULT;
-    }
-
-    convert = (unsigned)(platntsubclass != outntsubclass);
+    /* Data which is stored as it is in memory, including all 8-bit data, is
+       read and written directly from and to the user's buffer */
+    convert = (unsigned)!DFKIiscopyNT(vp->HDFtype);
 
     /* BMR - bug#268: removed the block here that attempted to allocation
     large amount of space and failed.  The allocation is not incorporated
@@ -892,7 +896,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
             new_count = vp->data_offset / vp->HDFsize;
 
             /* attempt to allocate the entire amount needed first, data_size bytes */
-            alloc_status = SDIresizebuf((void **)&tBuf, &tBuf_size, data_size);
+            alloc_status = SDIresizebuf((void **)&sb->tBuf, &sb->tBuf_size, data_size);
 
             /* if fail to allocate, repeatedly calculate a new amount
             and allocate until success or until no more memory available */
@@ -905,7 +909,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
                 }
                 /* re-calculate the size of the data block using smaller # of elements */
                 data_size    = new_count * vp->szof;
-                alloc_status = SDIresizebuf((void **)&tBuf, &tBuf_size, data_size);
+                alloc_status = SDIresizebuf((void **)&sb->tBuf, &sb->tBuf_size, data_size);
             } /* while trying to allocate */
 
             /* assume that all elements are to be processed */
@@ -917,20 +921,20 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
             while (elements_left > 0) {
                 /* Fill the temporary buffer with the fill-value */
                 if (attr != NULL)
-                    HDmemfill(tBuf, (*attr)->data->values, vp->szof, new_count);
+                    HDmemfill(sb->tBuf, (*attr)->data->values, vp->szof, new_count);
                 else
-                    NC_arrayfill(tBuf, data_size, vp->type);
+                    NC_arrayfill(sb->tBuf, data_size, vp->type);
 
                 /* convert the fill-values, if necessary */
                 if (convert) {
-                    if (FAIL == DFKconvert(tBuf, tBuf, vp->HDFtype, (uint32)new_count, DFACC_WRITE, 0, 0)) {
+                    if (FAIL == DFKconvert(sb->tBuf, sb->tBuf, vp->HDFtype, (uint32)new_count, DFACC_WRITE, 0, 0)) {
                         ret_value = FAIL;
                         goto done;
                     }
                 } /* end if convert */
 
                 /* Write the fill-values out */
-                status = Hwrite(vp->aid, data_size, tBuf);
+                status = Hwrite(vp->aid, data_size, sb->tBuf);
                 if (data_size == status) {
                     ret_value = FAIL;
                     goto done;
@@ -947,7 +951,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
                 }
             } /* while more elements left to be processed */
 
-            SDPfreebuf(); /* free tBuf and tValues if any exists */
+            SDIfreebuf(sb); /* free tBuf and tValues if any exists */
                           /* end of BMR part */
         }                 /* end if */
     }                     /* end if */
@@ -974,7 +978,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
             /* while any allocation fails */
             while (alloc_status == FAIL) {
                 /* try to allocate the buffer to hold the fill values after conversion */
-                alloc_status = SDIresizebuf((void **)&tValues, &tValues_size, chunk_size);
+                alloc_status = SDIresizebuf((void **)&sb->tValues, &sb->tValues_size, chunk_size);
                 /* then, if successful, try to allocate the temporary
                 buffer that holds the fill values before conversion */
                 if (alloc_status != FAIL) {
@@ -987,7 +991,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
                         the buffer to hold fill_count fill values of type
                         vp->szof, i.e., before conversion */
                     tempbuf_size = fill_count * vp->szof;
-                    alloc_status = SDIresizebuf((void **)&tBuf, &tBuf_size, tempbuf_size);
+                    alloc_status = SDIresizebuf((void **)&sb->tBuf, &sb->tBuf_size, tempbuf_size);
                 } /* if first allocation successes */
 
                 if (alloc_status == FAIL)        /* if any allocations fail */
@@ -1004,21 +1008,21 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
             specified in the attribute if one exists, otherwise,
             with the default value */
             if (attr != NULL)
-                HDmemfill(tBuf, (*attr)->data->values, vp->szof, fill_count);
+                HDmemfill(sb->tBuf, (*attr)->data->values, vp->szof, fill_count);
             else
-                NC_arrayfill(tBuf, tempbuf_size, vp->type);
+                NC_arrayfill(sb->tBuf, tempbuf_size, vp->type);
 
             /* convert the fill-values, if necessary, and store
             them in the buffer tValues */
             if (convert) {
-                if (FAIL == DFKconvert(tBuf, tValues, vp->HDFtype, fill_count, DFACC_WRITE, 0, 0)) {
+                if (FAIL == DFKconvert(sb->tBuf, sb->tValues, vp->HDFtype, fill_count, DFACC_WRITE, 0, 0)) {
                     ret_value = FAIL;
                     goto done;
                 }
-                write_buf = (uint8 *)tValues;
+                write_buf = (uint8 *)sb->tValues;
             } /* end if */
             else
-                write_buf = (uint8 *)tBuf;
+                write_buf = (uint8 *)sb->tBuf;
 
             do {
                 /* Write the fill-values out */
@@ -1061,7 +1065,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
             new_count = count;      /* use new_count; preserve the # of elements */
 
             /* attempt to allocate the entire amount needed first */
-            alloc_status = SDIresizebuf((void **)&tBuf, &tBuf_size, data_size);
+            alloc_status = SDIresizebuf((void **)&sb->tBuf, &sb->tBuf_size, data_size);
 
             /* if fail to allocate, repeatedly calculate a new amount and
                 allocate until success or until no memory available */
@@ -1075,7 +1079,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
 
                 /* re-calculate the size of the data block */
                 data_size    = new_count * vp->szof;
-                alloc_status = SDIresizebuf((void **)&tBuf, &tBuf_size, data_size);
+                alloc_status = SDIresizebuf((void **)&sb->tBuf, &sb->tBuf_size, data_size);
             }
 
             /* repeatedly read, convert, and store blocks of data_size
@@ -1089,7 +1093,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
             pvalues = values;
 
             while (elements_left > 0) {
-                status = Hread(vp->aid, data_size, tBuf);
+                status = Hread(vp->aid, data_size, sb->tBuf);
                 if (status != data_size) /* amount read != amount specified */
                 {
                     ret_value = FAIL;
@@ -1097,7 +1101,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
                 }
                 /* convert and store new_count elements in tBuf into
                    the buffer values, pointed to by pvalues */
-                if (FAIL == DFKconvert(tBuf, pvalues, vp->HDFtype, (uint32)new_count, DFACC_READ, 0, 0)) {
+                if (FAIL == DFKconvert(sb->tBuf, pvalues, vp->HDFtype, (uint32)new_count, DFACC_READ, 0, 0)) {
                     ret_value = FAIL;
                     goto done;
                 }
@@ -1116,7 +1120,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
                 pvalues = pvalues + data_size;
             } /* while more elements left to be processed */
 
-            SDPfreebuf(); /* free tBuf and tValues if any exist */
+            SDIfreebuf(sb); /* free tBuf and tValues if any exist */
         }                 /* end if convert */
         else              /* no convert, read directly into the user's buffer */
         {
@@ -1134,7 +1138,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
             new_count = count;      /* use new_count; preserve the # of elements */
 
             /* attempt to allocate the entire amount needed first */
-            alloc_status = SDIresizebuf((void **)&tBuf, &tBuf_size, data_size);
+            alloc_status = SDIresizebuf((void **)&sb->tBuf, &sb->tBuf_size, data_size);
 
             /* if fail to allocate, repeatedly calculate a new amount and
                allocate until success or no more memory left */
@@ -1148,7 +1152,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
 
                 /* re-calculate the size of the data block */
                 data_size    = new_count * vp->HDFsize;
-                alloc_status = SDIresizebuf((void **)&tBuf, &tBuf_size, data_size);
+                alloc_status = SDIresizebuf((void **)&sb->tBuf, &sb->tBuf_size, data_size);
             }
 
             /* repeatedly convert, store blocks of data_size bytes of data
@@ -1164,11 +1168,11 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
             while (elements_left > 0) {
                 /* convert new_count elements in the user's buffer values and
                    write them into the temporary buffer */
-                if (FAIL == DFKconvert(pvalues, tBuf, vp->HDFtype, (uint32)new_count, DFACC_WRITE, 0, 0)) {
+                if (FAIL == DFKconvert(pvalues, sb->tBuf, vp->HDFtype, (uint32)new_count, DFACC_WRITE, 0, 0)) {
                     ret_value = FAIL;
                     goto done;
                 }
-                status = Hwrite(vp->aid, data_size, tBuf);
+                status = Hwrite(vp->aid, data_size, sb->tBuf);
                 if (status != data_size) {
                     ret_value = FAIL;
                     goto done;
@@ -1187,7 +1191,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
                 pvalues = pvalues + data_size;
             } /* while more elements left to be processed */
 
-            SDPfreebuf(); /* free tBuf and tValues if any exist */
+            SDIfreebuf(sb); /* free tBuf and tValues if any exist */
         }                 /* end if convert */
         else {            /* no convert, write directly from the user's buffer */
             status = Hwrite(vp->aid, byte_count, values);
@@ -1222,7 +1226,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
             while (alloc_status == FAIL) {
                 /* first, try to allocate the buffer to hold the fill
                    values after conversion */
-                alloc_status = SDIresizebuf((void **)&tValues, &tValues_size, chunk_size);
+                alloc_status = SDIresizebuf((void **)&sb->tValues, &sb->tValues_size, chunk_size);
 
                 /* then, if successful, try to allocate the temporary
                     buffer that holds the fill values before conversion */
@@ -1236,7 +1240,7 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
                        buffer to hold fill_count fill values of type
           vp->szof, i.e., before conversion */
                     tempbuf_size = fill_count * vp->szof;
-                    alloc_status = SDIresizebuf((void **)&tBuf, &tBuf_size, tempbuf_size);
+                    alloc_status = SDIresizebuf((void **)&sb->tBuf, &sb->tBuf_size, tempbuf_size);
                 } /* if first allocation successes */
 
                 if (alloc_status == FAIL)        /* if any allocations fail */
@@ -1253,20 +1257,20 @@ hdf_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint3
             /* Fill the temporary buffer tBuf with the fill-value specified                    in the
              * attribute if one exists, otherwise, with the default value */
             if (attr != NULL)
-                HDmemfill(tBuf, (*attr)->data->values, vp->szof, fill_count);
+                HDmemfill(sb->tBuf, (*attr)->data->values, vp->szof, fill_count);
             else
-                NC_arrayfill(tBuf, tempbuf_size, vp->type);
+                NC_arrayfill(sb->tBuf, tempbuf_size, vp->type);
 
             /* convert the fill-values, if necessary, and store them in the buffer tValues */
             if (convert) {
-                if (FAIL == DFKconvert(tBuf, tValues, vp->HDFtype, fill_count, DFACC_WRITE, 0, 0)) {
+                if (FAIL == DFKconvert(sb->tBuf, sb->tValues, vp->HDFtype, fill_count, DFACC_WRITE, 0, 0)) {
                     ret_value = FAIL;
                     goto done;
                 }
-                write_buf = (uint8 *)tValues;
+                write_buf = (uint8 *)sb->tValues;
             } /* end if */
             else
-                write_buf = (uint8 *)tBuf;
+                write_buf = (uint8 *)sb->tBuf;
 
             do {
                 /* Write the fill-values out */
@@ -1326,12 +1330,16 @@ done:
 static bool_t
 nssdc_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uint32 count, void *values)
 {
-    int32 status;
-    int32 byte_count;
+    int32    status;
+    int32    byte_count;
+    SDbuf_t *sb; /* this thread's conversion buffers */
 
     (void)type;
     (void)values;
 
+    if ((sb = (SDbuf_t *)HTSlocal(HTS_SD_BUF, sizeof(SDbuf_t), SDIfreebuf)) == NULL)
+        return FALSE;
+
     /* position ourselves correctly */
     status = HI_SEEK((hdf_file_t)handle->cdf_fp, where);
     if (status == FAIL)
@@ -1339,7 +1347,7 @@ nssdc_xdr_NCvdata(NC *handle, NC_var *vp, unsigned long where, nc_type type, uin
 
     /* make sure our tmp buffer is big enough to hold everything */
     byte_count = count * vp->HDFsize;
-    if (SDIresizebuf((void **)&tBuf, &tBuf_size, byte_count) == FAIL)
+    if (SDIresizebuf((void **)&sb->tBuf, &sb->tBuf_size, byte_count) == FAIL)
         return FALSE;
 
     return TRUE;
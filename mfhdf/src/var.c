@@ -300,6 +300,10 @@ NC_computeshapes(NC *handle)
     for (vpp = vbase; vpp < &vbase[handle->vars->count]; vpp++) {
         (*vpp)->cdf = handle;
 
+        /* shape is computed when the rest of the variable is read in */
+        if ((*vpp)->unread)
+            continue;
+
         if (NC_var_shape(*vpp, handle->dims) == -1)
             return -1;
         if (IS_RECVAR(*vpp)) {
@@ -365,6 +369,10 @@ NC_hlookupvar(NC *handle, int varid)
         NCadvise(NC_ENOTVAR, "%d is not a valid variable id", varid);
         return NULL;
     }
+    if (((NC_var *)*ap)->unread && hdf_load_var(handle, varid) == FAIL) {
+        NCadvise(NC_EINVAL, "can't read in variable %d", varid);
+        return NULL;
+    }
     return (NC_var *)*ap;
 }
 
@@ -37,6 +37,9 @@ set (HDF4_TESTMFHDF_FILES
     cdfout.new
     cdfout.new.err
     chkbit.hdf
+    chkbudg.hdf
+    chkcache.hdf
+    chkthrd.hdf
     chktst.hdf
     comptst1.hdf
     comptst2.hdf
@@ -57,8 +60,13 @@ set (HDF4_TESTMFHDF_FILES
     extfile.hdf
     exttst.hdf
     idtypes.hdf
+    metaforeign.hdf
+    metaindex.hdf
+    metaload.hdf
     multidimvar.nc
+    nametoindex.hdf
     nbit.hdf
+    ncbuffer.nc
     onedimmultivars.nc
     onedimonevar.nc
     scaletst.hdf
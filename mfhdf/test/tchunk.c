@@ -11,6 +11,7 @@
  * help@hdfgroup.org.                                                        *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "mfhdf.h"
@@ -19,6 +20,13 @@
 
 #define CHKFILE   "chktst.hdf"  /* Chunking test file */
 #define CNBITFILE "chknbit.hdf" /* Chunking w/ NBIT compression */
+#define CCACHFILE "chkcache.hdf" /* Chunk cache parameters */
+#define CBUDGFILE "chkbudg.hdf"  /* Chunk cache budget */
+#define CTHRDFILE "chkthrd.hdf"  /* Chunks decoded on worker threads */
+
+/* Dimensions of the dataset and chunks for the chunk cache test */
+#define CACHE_DIM  64
+#define CACHE_CDIM 8
 
 /* Dimensions of slab */
 static int32 edge_dims[3]  = {2, 3, 4}; /* size of slab dims */
@@ -75,6 +83,355 @@ static uint16 u16_data[2][3][4] = {{{0, 1, 2, 3}, {10, 11, 12, 13}, {20, 21, 22,
 static uint8 u8_data[2][3][4] = {{{0, 1, 2, 3}, {10, 11, 12, 13}, {20, 21, 22, 23}},
                                  {{100, 101, 102, 103}, {110, 111, 112, 113}, {120, 121, 122, 123}}};
 
+/*
+ * Writes and reads a chunked SDS under each chunk cache replacement policy,
+ * with a cache which holds only a few of its chunks, so that dirty chunks
+ * are dropped and read back in again.
+ */
+static int
+test_chunk_cache_params(void)
+{
+    int32         fid, sdsid;
+    int32         dims[2]     = {CACHE_DIM, CACHE_DIM};
+    int32         start[2]    = {0, 0};
+    int32         edges[2]    = {CACHE_DIM, CACHE_DIM};
+    int32         policies[3] = {HDF_CACHE_LRU, HDF_CACHE_ARC, HDF_CACHE_W0};
+    int32        *data        = NULL;
+    int32        *rdata       = NULL;
+    HDF_CHUNK_DEF chunk_def;
+    int           status;
+    int           p, i, j;
+    int           num_errs = 0;
+
+    data  = (int32 *)malloc(CACHE_DIM * CACHE_DIM * sizeof(int32));
+    rdata = (int32 *)malloc(CACHE_DIM * CACHE_DIM * sizeof(int32));
+    CHECK_ALLOC(data, "data", "test_chunk_cache_params");
+    CHECK_ALLOC(rdata, "rdata", "test_chunk_cache_params");
+
+    fid = SDstart(CCACHFILE, DFACC_CREATE);
+    CHECK(fid, FAIL, "SDstart");
+
+    sdsid = SDcreate(fid, "cached", DFNT_INT32, 2, dims);
+    CHECK(sdsid, FAIL, "SDcreate");
+
+    chunk_def.chunk_lengths[0] = chunk_def.chunk_lengths[1] = CACHE_CDIM;
+    status                     = SDsetchunk(sdsid, chunk_def, HDF_CHUNK);
+    CHECK(status, FAIL, "SDsetchunk");
+
+    /* bad policy and bound */
+    status = SDsetchunkcacheparams(sdsid, 0, 3);
+    VERIFY(status, FAIL, "SDsetchunkcacheparams");
+    status = SDsetchunkcacheparams(sdsid, -1, HDF_CACHE_LRU);
+    VERIFY(status, FAIL, "SDsetchunkcacheparams");
+
+    for (p = 0; p < 3; p++) {
+        /* room for 3 of the 64 chunks */
+        status = SDsetchunkcacheparams(sdsid, 3 * CACHE_CDIM * CACHE_CDIM * (int32)sizeof(int32), policies[p]);
+        CHECK(status, FAIL, "SDsetchunkcacheparams");
+
+        /* write a row of chunks at a time, each row touching 8 chunks */
+        for (i = 0; i < CACHE_DIM * CACHE_DIM; i++)
+            data[i] = i + p * 10000;
+        edges[0] = CACHE_CDIM;
+        for (i = 0; i < CACHE_DIM; i += CACHE_CDIM) {
+            start[0] = i;
+            status   = SDwritedata(sdsid, start, NULL, edges, (void *)&data[i * CACHE_DIM]);
+            CHECK(status, FAIL, "SDwritedata");
+        }
+
+        /* read it back a row at a time, crossing every chunk of a row */
+        start[0] = 0;
+        edges[0] = 1;
+        for (i = 0; i < CACHE_DIM; i++) {
+            start[0] = i;
+            status   = SDreaddata(sdsid, start, NULL, edges, (void *)&rdata[i * CACHE_DIM]);
+            CHECK(status, FAIL, "SDreaddata");
+        }
+        for (j = 0; j < CACHE_DIM * CACHE_DIM; j++)
+            if (rdata[j] != data[j]) {
+                fprintf(stderr, "Chunk cache test, policy %d: wrong value at %d, want %d got %d\n",
+                        (int)policies[p], j, (int)data[j], (int)rdata[j]);
+                num_errs++;
+                break;
+            }
+        start[0] = 0;
+        edges[0] = CACHE_DIM;
+    }
+
+    /* dirty the whole cache, then shrink it to a single chunk */
+    status = SDsetchunkcacheparams(sdsid, 0, HDF_CACHE_LRU);
+    CHECK(status, FAIL, "SDsetchunkcacheparams");
+    for (i = 0; i < CACHE_DIM * CACHE_DIM; i++)
+        data[i] = -i;
+    status = SDwritedata(sdsid, start, NULL, edges, (void *)data);
+    CHECK(status, FAIL, "SDwritedata");
+    status = SDsetchunkcacheparams(sdsid, 1, HDF_CACHE_ARC);
+    CHECK(status, FAIL, "SDsetchunkcacheparams");
+
+    status = SDendaccess(sdsid);
+    CHECK(status, FAIL, "SDendaccess");
+    status = SDend(fid);
+    CHECK(status, FAIL, "SDend");
+
+    /* the data written must all have made it to the file */
+    fid = SDstart(CCACHFILE, DFACC_READ);
+    CHECK(fid, FAIL, "SDstart");
+    sdsid = SDselect(fid, 0);
+    CHECK(sdsid, FAIL, "SDselect");
+    status = SDsetchunkcacheparams(sdsid, CACHE_CDIM * CACHE_CDIM * (int32)sizeof(int32), HDF_CACHE_W0);
+    CHECK(status, FAIL, "SDsetchunkcacheparams");
+    memset(rdata, 0, CACHE_DIM * CACHE_DIM * sizeof(int32));
+    status = SDreaddata(sdsid, start, NULL, edges, (void *)rdata);
+    CHECK(status, FAIL, "SDreaddata");
+    for (j = 0; j < CACHE_DIM * CACHE_DIM; j++)
+        if (rdata[j] != data[j]) {
+            fprintf(stderr, "Chunk cache test: wrong value at %d after reopening, want %d got %d\n", j,
+                    (int)data[j], (int)rdata[j]);
+            num_errs++;
+            break;
+        }
+
+    status = SDendaccess(sdsid);
+    CHECK(status, FAIL, "SDendaccess");
+    status = SDend(fid);
+    CHECK(status, FAIL, "SDend");
+
+    free(data);
+    free(rdata);
+    return num_errs;
+} /* test_chunk_cache_params() */
+
+/*
+ * Reads two chunked SDSs with a budget shared by all chunk caches which
+ * holds only a few chunks, and checks the caches share it.
+ */
+static int
+test_chunk_cache_budget(void)
+{
+    int32           fid, sdsid[2];
+    int32           dims[2]  = {CACHE_DIM, CACHE_DIM};
+    int32           start[2] = {0, 0};
+    int32           edges[2] = {1, CACHE_DIM};
+    int32           chunkbytes = CACHE_CDIM * CACHE_CDIM * (int32)sizeof(int32);
+    int32          *data       = NULL;
+    int32          *rdata      = NULL;
+    hdf_off_t       budget, used;
+    HDF_CACHE_STATS stats[2];
+    HDF_CHUNK_DEF   chunk_def;
+    int             status;
+    int             d, i, j;
+    int             num_errs = 0;
+
+    data  = (int32 *)malloc(CACHE_DIM * CACHE_DIM * sizeof(int32));
+    rdata = (int32 *)malloc(CACHE_DIM * sizeof(int32));
+    CHECK_ALLOC(data, "data", "test_chunk_cache_budget");
+    CHECK_ALLOC(rdata, "rdata", "test_chunk_cache_budget");
+    for (i = 0; i < CACHE_DIM * CACHE_DIM; i++)
+        data[i] = i;
+
+    /* two chunked SDSs of 64 chunks each */
+    fid = SDstart(CBUDGFILE, DFACC_CREATE);
+    CHECK(fid, FAIL, "SDstart");
+    chunk_def.chunk_lengths[0] = chunk_def.chunk_lengths[1] = CACHE_CDIM;
+    for (d = 0; d < 2; d++) {
+        sdsid[d] = SDcreate(fid, d == 0 ? "first" : "second", DFNT_INT32, 2, dims);
+        CHECK(sdsid[d], FAIL, "SDcreate");
+        status = SDsetchunk(sdsid[d], chunk_def, HDF_CHUNK);
+        CHECK(status, FAIL, "SDsetchunk");
+        edges[0] = CACHE_DIM;
+        status   = SDwritedata(sdsid[d], start, NULL, edges, (void *)data);
+        CHECK(status, FAIL, "SDwritedata");
+        status = SDendaccess(sdsid[d]);
+        CHECK(status, FAIL, "SDendaccess");
+    }
+    status = SDend(fid);
+    CHECK(status, FAIL, "SDend");
+
+    /* room for two rows of chunks in all caches together */
+    status = Hsetchunkcachebudget(16 * (hdf_off_t)chunkbytes);
+    CHECK(status, FAIL, "Hsetchunkcachebudget");
+
+    fid = SDstart(CBUDGFILE, DFACC_READ);
+    CHECK(fid, FAIL, "SDstart");
+    for (d = 0; d < 2; d++) {
+        sdsid[d] = SDselect(fid, d);
+        CHECK(sdsid[d], FAIL, "SDselect");
+        status = SDsetchunkcache(sdsid[d], CACHE_DIM, 0);
+        CHECK(status, FAIL, "SDsetchunkcache");
+    }
+
+    /* read the first SDS, then the second, a row at a time */
+    edges[0] = 1;
+    for (d = 0; d < 2; d++)
+        for (i = 0; i < CACHE_DIM; i++) {
+            start[0] = i;
+            status   = SDreaddata(sdsid[d], start, NULL, edges, (void *)rdata);
+            CHECK(status, FAIL, "SDreaddata");
+            for (j = 0; j < CACHE_DIM; j++)
+                if (rdata[j] != data[i * CACHE_DIM + j]) {
+                    fprintf(stderr, "Chunk budget test: wrong value in SDS %d at (%d,%d)\n", d, i, j);
+                    num_errs++;
+                    break;
+                }
+        }
+
+    for (d = 0; d < 2; d++) {
+        status = SDgetchunkcachestats(sdsid[d], &stats[d]);
+        CHECK(status, FAIL, "SDgetchunkcachestats");
+        VERIFY(stats[d].chunksize, chunkbytes, "SDgetchunkcachestats");
+        VERIFY(stats[d].misses, 64, "SDgetchunkcachestats");
+        VERIFY(stats[d].hits, 7 * 64, "SDgetchunkcachestats");
+    }
+
+    /* the first SDS made room itself, then gave up half of the budget to
+       the second */
+    if (stats[0].evictions == 0 || stats[0].reclaims == 0 || stats[1].nchunks != 8) {
+        fprintf(stderr, "Chunk budget test: budget not shared, evictions %u, reclaims %u, chunks %d\n",
+                (unsigned)stats[0].evictions, (unsigned)stats[0].reclaims, (int)stats[1].nchunks);
+        num_errs++;
+    }
+    status = Hgetchunkcachebudget(&budget, &used);
+    CHECK(status, FAIL, "Hgetchunkcachebudget");
+    if (budget != 16 * chunkbytes || used > budget ||
+        used != (hdf_off_t)(stats[0].nchunks + stats[1].nchunks) * chunkbytes) {
+        fprintf(stderr, "Chunk budget test: budget %ld, %ld bytes used\n", (long)budget, (long)used);
+        num_errs++;
+    }
+
+    /* a smaller budget drops clean chunks right away */
+    status = Hsetchunkcachebudget(chunkbytes);
+    CHECK(status, FAIL, "Hsetchunkcachebudget");
+    status = Hgetchunkcachebudget(NULL, &used);
+    CHECK(status, FAIL, "Hgetchunkcachebudget");
+    if (used > chunkbytes) {
+        fprintf(stderr, "Chunk budget test: %ld bytes used after shrinking the budget\n", (long)used);
+        num_errs++;
+    }
+
+    for (d = 0; d < 2; d++) {
+        status = SDendaccess(sdsid[d]);
+        CHECK(status, FAIL, "SDendaccess");
+    }
+    status = SDend(fid);
+    CHECK(status, FAIL, "SDend");
+
+    status = Hsetchunkcachebudget(0);
+    CHECK(status, FAIL, "Hsetchunkcachebudget");
+
+    free(data);
+    free(rdata);
+    return num_errs;
+} /* test_chunk_cache_budget() */
+
+/*
+ * Reads deflated chunks decoded ahead on worker threads, with a chunk cache
+ * too small to hold a row of chunks and some chunks never written.
+ */
+static int
+test_chunk_decode_threads(void)
+{
+    int32         fid, sdsid;
+    int32         dims[2]  = {CACHE_DIM, CACHE_DIM};
+    int32         start[2] = {0, 0};
+    int32         edges[2] = {CACHE_DIM / 2 + 4, CACHE_DIM};
+    int32         fill     = -1;
+    int32        *data     = NULL;
+    int32        *rdata    = NULL;
+    int32         expect;
+    HDF_CHUNK_DEF chunk_def;
+    int           nthreads;
+    int           status;
+    int           i, j;
+    int           num_errs = 0;
+
+    data  = (int32 *)malloc(CACHE_DIM * CACHE_DIM * sizeof(int32));
+    rdata = (int32 *)malloc(CACHE_DIM * CACHE_DIM * sizeof(int32));
+    CHECK_ALLOC(data, "data", "test_chunk_decode_threads");
+    CHECK_ALLOC(rdata, "rdata", "test_chunk_decode_threads");
+    for (i = 0; i < CACHE_DIM * CACHE_DIM; i++)
+        data[i] = i % 1000;
+
+    /* a deflated SDS whose lower chunks are left unwritten */
+    fid = SDstart(CTHRDFILE, DFACC_CREATE);
+    CHECK(fid, FAIL, "SDstart");
+    sdsid = SDcreate(fid, "deflated", DFNT_INT32, 2, dims);
+    CHECK(sdsid, FAIL, "SDcreate");
+    status = SDsetfillvalue(sdsid, (void *)&fill);
+    CHECK(status, FAIL, "SDsetfillvalue");
+    chunk_def.comp.chunk_lengths[0]    = CACHE_CDIM;
+    chunk_def.comp.chunk_lengths[1]    = CACHE_CDIM;
+    chunk_def.comp.comp_type           = COMP_CODE_DEFLATE;
+    chunk_def.comp.cinfo.deflate.level = 6;
+
+    status = SDsetchunk(sdsid, chunk_def, HDF_CHUNK | HDF_COMP);
+    CHECK(status, FAIL, "SDsetchunk");
+    status = SDwritedata(sdsid, start, NULL, edges, (void *)data);
+    CHECK(status, FAIL, "SDwritedata");
+    status = SDendaccess(sdsid);
+    CHECK(status, FAIL, "SDendaccess");
+    status = SDend(fid);
+    CHECK(status, FAIL, "SDend");
+
+    status = Hsetchunkthreads(-1);
+    VERIFY(status, FAIL, "Hsetchunkthreads");
+    status = Hsetchunkthreads(4);
+    CHECK(status, FAIL, "Hsetchunkthreads");
+    status = Hgetchunkthreads(&nthreads);
+    CHECK(status, FAIL, "Hgetchunkthreads");
+    VERIFY(nthreads, 4, "Hgetchunkthreads");
+
+    fid = SDstart(CTHRDFILE, DFACC_READ);
+    CHECK(fid, FAIL, "SDstart");
+    sdsid = SDselect(fid, 0);
+    CHECK(sdsid, FAIL, "SDselect");
+    status = SDsetchunkcache(sdsid, 4, 0);
+    CHECK(status, FAIL, "SDsetchunkcache");
+
+    /* the whole SDS, then a slab which doesn't line up with the chunks */
+    edges[0] = CACHE_DIM;
+    status   = SDreaddata(sdsid, start, NULL, edges, (void *)rdata);
+    CHECK(status, FAIL, "SDreaddata");
+    for (i = 0; i < CACHE_DIM; i++)
+        for (j = 0; j < CACHE_DIM; j++) {
+            expect = i < CACHE_DIM / 2 + 4 ? data[i * CACHE_DIM + j] : fill;
+            if (rdata[i * CACHE_DIM + j] != expect) {
+                fprintf(stderr, "Chunk thread test: wrong value at (%d,%d)\n", i, j);
+                num_errs++;
+                i = CACHE_DIM;
+                break;
+            }
+        }
+
+    start[0] = 5;
+    start[1] = 3;
+    edges[0] = 50;
+    edges[1] = 40;
+    status   = SDreaddata(sdsid, start, NULL, edges, (void *)rdata);
+    CHECK(status, FAIL, "SDreaddata");
+    for (i = 0; i < edges[0]; i++)
+        for (j = 0; j < edges[1]; j++) {
+            expect = i + 5 < CACHE_DIM / 2 + 4 ? data[(i + 5) * CACHE_DIM + j + 3] : fill;
+            if (rdata[i * edges[1] + j] != expect) {
+                fprintf(stderr, "Chunk thread test: wrong value in slab at (%d,%d)\n", i, j);
+                num_errs++;
+                i = edges[0];
+                break;
+            }
+        }
+
+    status = SDendaccess(sdsid);
+    CHECK(status, FAIL, "SDendaccess");
+    status = SDend(fid);
+    CHECK(status, FAIL, "SDend");
+
+    status = Hsetchunkthreads(0);
+    CHECK(status, FAIL, "Hsetchunkthreads");
+
+    free(data);
+    free(rdata);
+    return num_errs;
+} /* test_chunk_decode_threads() */
+
 extern int
 test_chunk()
 {
@@ -1374,6 +1731,15 @@ test8:
     status = SDend(fchk);
     CHECK(status, FAIL, "Chunk Test 8. SDend");
 
+    /* Chunk cache bounded in bytes, under each replacement policy */
+    num_errs += test_chunk_cache_params();
+
+    /* Budget shared by all chunk caches */
+    num_errs += test_chunk_cache_budget();
+
+    /* Chunks decoded on worker threads */
+    num_errs += test_chunk_decode_threads();
+
     if (num_errs == 0)
         PASSED();
 
@@ -487,6 +487,750 @@ test_invalid_opening()
         return num_errs;
 }
 
+/********************************************************************
+   Name: test_metaload() - tests that the information about the data
+            sets is the same when it is read in lazily
+
+   Description:
+    The main contents include:
+    - create a file with data sets which have attributes, dimensions
+      and a dimension scale
+    - open it with SD_META_ALL and with SD_META_LAZY, and verify that
+      SDstart only reads in the names of the data sets in the latter
+    - verify that SDgetinfo, SDattrinfo, SDreadattr, SDreaddata,
+      SDnametoindices, SDdiminfo, SDgetdimstrs and SDreftoindex give
+      the same results both ways
+    - verify that SD_META_LAZY is ignored when the file is opened for
+      writing
+
+   Return value:
+    The number of errors occurred in this routine.
+
+*********************************************************************/
+
+#define META_FILE   "metaload.hdf"
+#define META_NDSETS 3
+#define META_NX     4
+#define META_NY     5
+
+/* Check that data set index of the file opened as fid has been read in or not */
+static int
+check_unread(int32 fid, int32 index, int32 unread, const char *where)
+{
+    NC      *handle;
+    NC_var **vpp;
+    int      num_errs = 0;
+
+    handle = NC_check_id((int)(fid & 0xffff));
+    if (handle == NULL || handle->vars == NULL) {
+        fprintf(stderr, "%s: can't get the variables of the file\n", where);
+        return 1;
+    }
+    vpp = (NC_var **)handle->vars->values;
+    VERIFY(vpp[index]->unread, unread, where);
+    return num_errs;
+}
+
+static int
+test_metaload()
+{
+    int32         fid, sds_id, dim_id;
+    int32         sizes[2] = {META_NX, META_NY};
+    int32         rank, nt, nattrs, ndsets, ngattrs, count, size;
+    int32         dims[H4_MAX_VAR_DIMS];
+    int32         start[2] = {0, 0};
+    int32         data[META_NX][META_NY], outdata[META_NX][META_NY];
+    float32       scale[META_NX], outscale[META_NX];
+    int32         refs[META_NDSETS];
+    int           mode;
+    int           n_vars;
+    hdf_varlist_t var_list[2];
+    char          name[H4_MAX_NC_NAME];
+    char          label[32];
+    char          units[32];
+    int           status;
+    int           num_errs = 0;
+
+    for (int i = 0; i < META_NX; i++) {
+        scale[i] = (float32)i * 0.5F;
+        for (int j = 0; j < META_NY; j++)
+            data[i][j] = i * 100 + j;
+    }
+
+    /* Create a file with three data sets; the third one is named like the
+       first dimension, which has a scale */
+    fid = SDstart(META_FILE, DFACC_CREATE);
+    CHECK(fid, FAIL, "test_metaload: SDstart");
+
+    sds_id = SDcreate(fid, "temperature", DFNT_INT32, 2, sizes);
+    CHECK(sds_id, FAIL, "test_metaload: SDcreate");
+    status = SDsetattr(sds_id, "units", DFNT_CHAR8, 6, "kelvin");
+    CHECK(status, FAIL, "test_metaload: SDsetattr");
+    status = SDwritedata(sds_id, start, NULL, sizes, data);
+    CHECK(status, FAIL, "test_metaload: SDwritedata");
+    dim_id = SDgetdimid(sds_id, 0);
+    CHECK(dim_id, FAIL, "test_metaload: SDgetdimid");
+    status = SDsetdimname(dim_id, "lat");
+    CHECK(status, FAIL, "test_metaload: SDsetdimname");
+    status = SDsetdimscale(dim_id, META_NX, DFNT_FLOAT32, scale);
+    CHECK(status, FAIL, "test_metaload: SDsetdimscale");
+    status = SDsetdimstrs(dim_id, "latitude", "degrees", NULL);
+    CHECK(status, FAIL, "test_metaload: SDsetdimstrs");
+    refs[0] = SDidtoref(sds_id);
+    CHECK(refs[0], FAIL, "test_metaload: SDidtoref");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "test_metaload: SDendaccess");
+
+    sds_id = SDcreate(fid, "pressure", DFNT_FLOAT64, 1, sizes);
+    CHECK(sds_id, FAIL, "test_metaload: SDcreate");
+    status = SDsetattr(sds_id, "valid", DFNT_INT32, 2, sizes);
+    CHECK(status, FAIL, "test_metaload: SDsetattr");
+    refs[1] = SDidtoref(sds_id);
+    CHECK(refs[1], FAIL, "test_metaload: SDidtoref");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "test_metaload: SDendaccess");
+
+    sds_id = SDcreate(fid, "lat", DFNT_INT16, 2, sizes);
+    CHECK(sds_id, FAIL, "test_metaload: SDcreate");
+    refs[2] = SDidtoref(sds_id);
+    CHECK(refs[2], FAIL, "test_metaload: SDidtoref");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "test_metaload: SDendaccess");
+
+    status = SDend(fid);
+    CHECK(status, FAIL, "test_metaload: SDend");
+
+    /* Only the two modes are valid */
+    status = SDsetmetaload(2);
+    VERIFY(status, FAIL, "test_metaload: SDsetmetaload");
+
+    for (mode = SD_META_ALL; mode <= SD_META_LAZY; mode++) {
+        status = SDsetmetaload(mode);
+        CHECK(status, FAIL, "test_metaload: SDsetmetaload");
+
+        fid = SDstart(META_FILE, DFACC_RDONLY);
+        CHECK(fid, FAIL, "test_metaload: SDstart");
+
+        /* The data sets are temperature, lat (the scale), pressure, lat */
+        status = SDfileinfo(fid, &ndsets, &ngattrs);
+        CHECK(status, FAIL, "test_metaload: SDfileinfo");
+        VERIFY(ndsets, META_NDSETS + 1, "test_metaload: SDfileinfo");
+        num_errs += check_unread(fid, 0, mode == SD_META_LAZY, "test_metaload: SDstart");
+        num_errs += check_unread(fid, 2, mode == SD_META_LAZY, "test_metaload: SDstart");
+
+        /* Only the data set which is selected is read in */
+        sds_id = SDselect(fid, SDnametoindex(fid, "temperature"));
+        CHECK(sds_id, FAIL, "test_metaload: SDselect");
+        num_errs += check_unread(fid, 0, FALSE, "test_metaload: SDselect");
+        num_errs += check_unread(fid, 1, mode == SD_META_LAZY, "test_metaload: SDselect");
+
+        /* Look up pressure and lat by their refs before anything else reads them in */
+        VERIFY(SDreftoindex(fid, refs[1]), 2, "test_metaload: SDreftoindex");
+        VERIFY(SDreftoindex(fid, refs[2]), 3, "test_metaload: SDreftoindex");
+
+        status = SDgetinfo(sds_id, name, &rank, dims, &nt, &nattrs);
+        CHECK(status, FAIL, "test_metaload: SDgetinfo");
+        VERIFY(rank, 2, "test_metaload: SDgetinfo");
+        VERIFY(dims[0], META_NX, "test_metaload: SDgetinfo");
+        VERIFY(dims[1], META_NY, "test_metaload: SDgetinfo");
+        VERIFY(nt, DFNT_INT32, "test_metaload: SDgetinfo");
+        VERIFY(nattrs, 1, "test_metaload: SDgetinfo");
+        VERIFY(SDidtoref(sds_id), refs[0], "test_metaload: SDidtoref");
+
+        status = SDattrinfo(sds_id, 0, name, &nt, &count);
+        CHECK(status, FAIL, "test_metaload: SDattrinfo");
+        VERIFY(nt, DFNT_CHAR8, "test_metaload: SDattrinfo");
+        VERIFY(count, 6, "test_metaload: SDattrinfo");
+        memset(units, 0, sizeof(units));
+        status = SDreadattr(sds_id, 0, units);
+        CHECK(status, FAIL, "test_metaload: SDreadattr");
+        VERIFY(strcmp(units, "kelvin"), 0, "test_metaload: SDreadattr");
+
+        memset(outdata, 0, sizeof(outdata));
+        status = SDreaddata(sds_id, start, NULL, sizes, outdata);
+        CHECK(status, FAIL, "test_metaload: SDreaddata");
+        VERIFY(memcmp(outdata, data, sizeof(data)), 0, "test_metaload: SDreaddata");
+
+        /* The scale and the strings of the dimension are in its coordinate variable */
+        dim_id = SDgetdimid(sds_id, 0);
+        CHECK(dim_id, FAIL, "test_metaload: SDgetdimid");
+        status = SDdiminfo(dim_id, name, &size, &nt, &nattrs);
+        CHECK(status, FAIL, "test_metaload: SDdiminfo");
+        VERIFY(strcmp(name, "lat"), 0, "test_metaload: SDdiminfo");
+        VERIFY(size, META_NX, "test_metaload: SDdiminfo");
+        VERIFY(nt, DFNT_FLOAT32, "test_metaload: SDdiminfo");
+        VERIFY(nattrs, 2, "test_metaload: SDdiminfo");
+
+        memset(label, 0, sizeof(label));
+        memset(units, 0, sizeof(units));
+        status = SDgetdimstrs(dim_id, label, units, NULL, (int)sizeof(label));
+        CHECK(status, FAIL, "test_metaload: SDgetdimstrs");
+        VERIFY(strcmp(label, "latitude"), 0, "test_metaload: SDgetdimstrs");
+        VERIFY(strcmp(units, "degrees"), 0, "test_metaload: SDgetdimstrs");
+
+        memset(outscale, 0, sizeof(outscale));
+        status = SDgetdimscale(dim_id, outscale);
+        CHECK(status, FAIL, "test_metaload: SDgetdimscale");
+        VERIFY(memcmp(outscale, scale, sizeof(scale)), 0, "test_metaload: SDgetdimscale");
+
+        status = SDendaccess(sds_id);
+        CHECK(status, FAIL, "test_metaload: SDendaccess");
+
+        /* Both variables named lat are found, and which is which */
+        status = SDgetnumvars_byname(fid, "lat", &n_vars);
+        CHECK(status, FAIL, "test_metaload: SDgetnumvars_byname");
+        VERIFY(n_vars, 2, "test_metaload: SDgetnumvars_byname");
+        status = SDnametoindices(fid, "lat", var_list);
+        CHECK(status, FAIL, "test_metaload: SDnametoindices");
+        VERIFY(var_list[0].var_index, 1, "test_metaload: SDnametoindices");
+        VERIFY(var_list[0].var_type, IS_CRDVAR, "test_metaload: SDnametoindices");
+        VERIFY(var_list[1].var_index, 3, "test_metaload: SDnametoindices");
+        VERIFY(var_list[1].var_type, IS_SDSVAR, "test_metaload: SDnametoindices");
+
+        sds_id = SDselect(fid, 2);
+        CHECK(sds_id, FAIL, "test_metaload: SDselect");
+        status = SDgetinfo(sds_id, name, &rank, dims, &nt, &nattrs);
+        CHECK(status, FAIL, "test_metaload: SDgetinfo");
+        VERIFY(strcmp(name, "pressure"), 0, "test_metaload: SDgetinfo");
+        VERIFY(rank, 1, "test_metaload: SDgetinfo");
+        VERIFY(dims[0], META_NX, "test_metaload: SDgetinfo");
+        VERIFY(nt, DFNT_FLOAT64, "test_metaload: SDgetinfo");
+        VERIFY(nattrs, 1, "test_metaload: SDgetinfo");
+        status = SDattrinfo(sds_id, 0, name, &nt, &count);
+        CHECK(status, FAIL, "test_metaload: SDattrinfo");
+        VERIFY(strcmp(name, "valid"), 0, "test_metaload: SDattrinfo");
+        VERIFY(count, 2, "test_metaload: SDattrinfo");
+        status = SDendaccess(sds_id);
+        CHECK(status, FAIL, "test_metaload: SDendaccess");
+
+        status = SDend(fid);
+        CHECK(status, FAIL, "test_metaload: SDend");
+    }
+
+    /* Everything is read in when the file can be written to */
+    fid = SDstart(META_FILE, DFACC_RDWR);
+    CHECK(fid, FAIL, "test_metaload: SDstart");
+    num_errs += check_unread(fid, 0, FALSE, "test_metaload: SDstart");
+    status = SDend(fid);
+    CHECK(status, FAIL, "test_metaload: SDend");
+
+    status = SDsetmetaload(SD_META_ALL);
+    CHECK(status, FAIL, "test_metaload: SDsetmetaload");
+
+    return num_errs;
+}
+
+/********************************************************************
+   Name: test_metaload_foreign() - tests that data sets are numbered the
+                same way when only their names are read in
+
+   Description:
+    The main contents include:
+    - create a file with an index of its metadata, in which the number
+      type of one data set is in the native format of another type of
+      machine
+    - verify that SD_META_ALL and SD_META_LAZY both leave that data set
+      out and give the others the same indices, names, number types and
+      kinds, through the index and without it
+
+   Return value:
+    The number of errors occurred in this routine.
+
+*********************************************************************/
+
+#define FOREIGN_FILE   "metaforeign.hdf"
+#define FOREIGN_NDSETS 3
+#define FOREIGN_NX     4
+
+/* Get the name, number type and kind of each data set of the file made by
+   test_metaload_foreign, read in the way mode says */
+static int
+get_foreign_dsets(int mode, char names[][H4_MAX_NC_NAME], int32 *nts, int32 *coords)
+{
+    int32 fid, sds_id;
+    int32 rank, nattrs, ndsets, ngattrs;
+    int32 dims[H4_MAX_VAR_DIMS];
+    int   status;
+    int   num_errs = 0;
+
+    status = SDsetmetaload(mode);
+    CHECK(status, FAIL, "get_foreign_dsets: SDsetmetaload");
+
+    fid = SDstart(FOREIGN_FILE, DFACC_RDONLY);
+    CHECK(fid, FAIL, "get_foreign_dsets: SDstart");
+
+    /* The data set of the foreign number type is left out */
+    status = SDfileinfo(fid, &ndsets, &ngattrs);
+    CHECK(status, FAIL, "get_foreign_dsets: SDfileinfo");
+    VERIFY(ndsets, FOREIGN_NDSETS, "get_foreign_dsets: SDfileinfo");
+    VERIFY(SDnametoindex(fid, "foreign"), FAIL, "get_foreign_dsets: SDnametoindex");
+
+    for (int32 i = 0; i < ndsets && i < FOREIGN_NDSETS; i++) {
+        sds_id = SDselect(fid, i);
+        CHECK(sds_id, FAIL, "get_foreign_dsets: SDselect");
+        status = SDgetinfo(sds_id, names[i], &rank, dims, &nts[i], &nattrs);
+        CHECK(status, FAIL, "get_foreign_dsets: SDgetinfo");
+        coords[i] = SDiscoordvar(sds_id);
+        status    = SDendaccess(sds_id);
+        CHECK(status, FAIL, "get_foreign_dsets: SDendaccess");
+        VERIFY(SDnametoindex(fid, names[i]), i, "get_foreign_dsets: SDnametoindex");
+    }
+
+    status = SDend(fid);
+    CHECK(status, FAIL, "get_foreign_dsets: SDend");
+
+    return num_errs;
+}
+
+/* Check that the data sets are the same when read in all at once and lazily */
+static int
+check_foreign_dsets(void)
+{
+    char  names[2][FOREIGN_NDSETS][H4_MAX_NC_NAME];
+    int32 nts[2][FOREIGN_NDSETS];
+    int32 coords[2][FOREIGN_NDSETS];
+    int   num_errs = 0;
+
+    memset(names, 0, sizeof(names));
+    memset(nts, 0, sizeof(nts));
+    memset(coords, 0, sizeof(coords));
+    num_errs += get_foreign_dsets(SD_META_ALL, names[0], nts[0], coords[0]);
+    num_errs += get_foreign_dsets(SD_META_LAZY, names[1], nts[1], coords[1]);
+
+    for (int i = 0; i < FOREIGN_NDSETS; i++) {
+        VERIFY(strcmp(names[1][i], names[0][i]), 0, "check_foreign_dsets: name");
+        VERIFY(nts[1][i], nts[0][i], "check_foreign_dsets: number type");
+        VERIFY(coords[1][i], coords[0][i], "check_foreign_dsets: SDiscoordvar");
+    }
+    VERIFY(strcmp(names[0][2], "last"), 0, "check_foreign_dsets: name");
+    VERIFY(nts[0][2], DFNT_FLOAT32, "check_foreign_dsets: number type");
+    VERIFY(coords[0][1], TRUE, "check_foreign_dsets: SDiscoordvar");
+
+    return num_errs;
+}
+
+static int
+test_metaload_foreign()
+{
+    int32   fid, sds_id, dim_id, file_id, vgref, vg;
+    int32   size = FOREIGN_NX;
+    int32   tags[H4_MAX_VAR_DIMS + 16], refs[H4_MAX_VAR_DIMS + 16];
+    int32   n, nt_ref = FAIL;
+    float32 scale[FOREIGN_NX] = {0.0F, 1.0F, 2.0F, 3.0F};
+    uint8   ntstring[4];
+    int     status;
+    int     num_errs = 0;
+
+    /* Create first, its scale x, foreign and last, and have the metadata indexed */
+    fid = SDstart(FOREIGN_FILE, DFACC_CREATE);
+    CHECK(fid, FAIL, "test_metaload_foreign: SDstart");
+    status = SDsetmetaindex(fid, TRUE);
+    CHECK(status, FAIL, "test_metaload_foreign: SDsetmetaindex");
+
+    sds_id = SDcreate(fid, "first", DFNT_INT32, 1, &size);
+    CHECK(sds_id, FAIL, "test_metaload_foreign: SDcreate");
+    dim_id = SDgetdimid(sds_id, 0);
+    CHECK(dim_id, FAIL, "test_metaload_foreign: SDgetdimid");
+    status = SDsetdimname(dim_id, "x");
+    CHECK(status, FAIL, "test_metaload_foreign: SDsetdimname");
+    status = SDsetdimscale(dim_id, FOREIGN_NX, DFNT_FLOAT32, scale);
+    CHECK(status, FAIL, "test_metaload_foreign: SDsetdimscale");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "test_metaload_foreign: SDendaccess");
+
+    sds_id = SDcreate(fid, "foreign", DFNT_INT16, 1, &size);
+    CHECK(sds_id, FAIL, "test_metaload_foreign: SDcreate");
+    status = SDsetattr(sds_id, "units", DFNT_CHAR8, 1, "m");
+    CHECK(status, FAIL, "test_metaload_foreign: SDsetattr");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "test_metaload_foreign: SDendaccess");
+
+    sds_id = SDcreate(fid, "last", DFNT_FLOAT32, 1, &size);
+    CHECK(sds_id, FAIL, "test_metaload_foreign: SDcreate");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "test_metaload_foreign: SDendaccess");
+
+    status = SDend(fid);
+    CHECK(status, FAIL, "test_metaload_foreign: SDend");
+
+    /* Make the number type of foreign that of a Cray */
+    file_id = Hopen(FOREIGN_FILE, DFACC_RDWR, 0);
+    CHECK(file_id, FAIL, "test_metaload_foreign: Hopen");
+    status = Vstart(file_id);
+    CHECK(status, FAIL, "test_metaload_foreign: Vstart");
+    vgref = Vfind(file_id, "foreign");
+    CHECK(vgref, FAIL, "test_metaload_foreign: Vfind");
+    vg = Vattach(file_id, vgref, "r");
+    CHECK(vg, FAIL, "test_metaload_foreign: Vattach");
+    n = Vgettagrefs(vg, tags, refs, (int32)(sizeof(tags) / sizeof(tags[0])));
+    CHECK(n, FAIL, "test_metaload_foreign: Vgettagrefs");
+    for (int32 i = 0; i < n; i++)
+        if (tags[i] == DFTAG_NT)
+            nt_ref = refs[i];
+    CHECK(nt_ref, FAIL, "test_metaload_foreign: no number type");
+    status = Vdetach(vg);
+    CHECK(status, FAIL, "test_metaload_foreign: Vdetach");
+    status = Hgetelement(file_id, DFTAG_NT, (uint16)nt_ref, ntstring);
+    VERIFY(status, 4, "test_metaload_foreign: Hgetelement");
+    ntstring[3] = DFNTF_CRAY;
+    status      = Hputelement(file_id, DFTAG_NT, (uint16)nt_ref, ntstring, 4);
+    CHECK(status, FAIL, "test_metaload_foreign: Hputelement");
+    status = Vend(file_id);
+    CHECK(status, FAIL, "test_metaload_foreign: Vend");
+    status = Hclose(file_id);
+    CHECK(status, FAIL, "test_metaload_foreign: Hclose");
+
+    /* Through the index */
+    num_errs += check_foreign_dsets();
+
+    /* Without the index */
+    file_id = Hopen(FOREIGN_FILE, DFACC_RDWR, 0);
+    CHECK(file_id, FAIL, "test_metaload_foreign: Hopen");
+    status = Vstart(file_id);
+    CHECK(status, FAIL, "test_metaload_foreign: Vstart");
+    status = Hdeldd(file_id, DFTAG_SDIDX, (uint16)Vfindclass(file_id, _HDF_CDF));
+    CHECK(status, FAIL, "test_metaload_foreign: Hdeldd");
+    status = Vend(file_id);
+    CHECK(status, FAIL, "test_metaload_foreign: Vend");
+    status = Hclose(file_id);
+    CHECK(status, FAIL, "test_metaload_foreign: Hclose");
+    num_errs += check_foreign_dsets();
+
+    status = SDsetmetaload(SD_META_ALL);
+    CHECK(status, FAIL, "test_metaload_foreign: SDsetmetaload");
+
+    return num_errs;
+}
+
+/********************************************************************
+   Name: test_metaindex() - tests the index of the metadata
+
+   Description:
+    The main contents include:
+    - create a file with data sets on fixed and unlimited dimensions
+      and have SDend write an index of its metadata
+    - verify that the index is written as an element whose ref is that
+      of the SD Vgroup, and only when asked for
+    - verify that the file reads the same through the index, with
+      SD_META_ALL and with SD_META_LAZY
+    - verify that an index which no longer matches the file, or which
+      has an unknown version, is not used
+
+   Return value:
+    The number of errors occurred in this routine.
+
+*********************************************************************/
+
+#define INDEX_FILE "metaindex.hdf"
+#define INDEX_NX   6
+#define INDEX_NY   3
+
+/* Check the data sets of the file made by test_metaindex */
+static int
+check_metaindex(int ndsets_expected, int recs_expected)
+{
+    int32 fid, sds_id, dim_id;
+    int32 rank, nt, nattrs, ndsets, ngattrs, size;
+    int32 dims[H4_MAX_VAR_DIMS];
+    int32 start[2] = {0, 0};
+    int32 edges[2] = {INDEX_NX, INDEX_NY};
+    int32 outdata[INDEX_NX][INDEX_NY];
+    char  name[H4_MAX_NC_NAME];
+    int   status;
+    int   num_errs = 0;
+
+    fid = SDstart(INDEX_FILE, DFACC_RDONLY);
+    CHECK(fid, FAIL, "check_metaindex: SDstart");
+
+    status = SDfileinfo(fid, &ndsets, &ngattrs);
+    CHECK(status, FAIL, "check_metaindex: SDfileinfo");
+    VERIFY(ndsets, ndsets_expected, "check_metaindex: SDfileinfo");
+    VERIFY(ngattrs, 1, "check_metaindex: SDfileinfo");
+
+    sds_id = SDselect(fid, SDnametoindex(fid, "grid"));
+    CHECK(sds_id, FAIL, "check_metaindex: SDselect");
+    status = SDgetinfo(sds_id, name, &rank, dims, &nt, &nattrs);
+    CHECK(status, FAIL, "check_metaindex: SDgetinfo");
+    VERIFY(rank, 2, "check_metaindex: SDgetinfo");
+    VERIFY(dims[0], INDEX_NX, "check_metaindex: SDgetinfo");
+    VERIFY(dims[1], INDEX_NY, "check_metaindex: SDgetinfo");
+    VERIFY(nt, DFNT_INT32, "check_metaindex: SDgetinfo");
+    VERIFY(nattrs, 1, "check_metaindex: SDgetinfo");
+
+    memset(outdata, 0, sizeof(outdata));
+    status = SDreaddata(sds_id, start, NULL, edges, outdata);
+    CHECK(status, FAIL, "check_metaindex: SDreaddata");
+    VERIFY(outdata[INDEX_NX - 1][INDEX_NY - 1], (INDEX_NX - 1) * 10 + INDEX_NY - 1,
+           "check_metaindex: SDreaddata");
+
+    dim_id = SDgetdimid(sds_id, 0);
+    CHECK(dim_id, FAIL, "check_metaindex: SDgetdimid");
+    status = SDdiminfo(dim_id, name, &size, &nt, &nattrs);
+    CHECK(status, FAIL, "check_metaindex: SDdiminfo");
+    VERIFY(strcmp(name, "x"), 0, "check_metaindex: SDdiminfo");
+    VERIFY(size, INDEX_NX, "check_metaindex: SDdiminfo");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "check_metaindex: SDendaccess");
+
+    /* The number of records is read from the file, not from the index */
+    sds_id = SDselect(fid, SDnametoindex(fid, "series"));
+    CHECK(sds_id, FAIL, "check_metaindex: SDselect");
+    status = SDgetinfo(sds_id, name, &rank, dims, &nt, &nattrs);
+    CHECK(status, FAIL, "check_metaindex: SDgetinfo");
+    VERIFY(rank, 1, "check_metaindex: SDgetinfo");
+    VERIFY(dims[0], recs_expected, "check_metaindex: SDgetinfo");
+    VERIFY(nt, DFNT_FLOAT32, "check_metaindex: SDgetinfo");
+    VERIFY(SDisrecord(sds_id), TRUE, "check_metaindex: SDisrecord");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "check_metaindex: SDendaccess");
+
+    status = SDend(fid);
+    CHECK(status, FAIL, "check_metaindex: SDend");
+
+    return num_errs;
+}
+
+/* Return the length of the index of the file, or FAIL if it has none */
+static int32
+metaindex_length(uint8 *version)
+{
+    int32  file_id, vgref;
+    int32  length = FAIL;
+    uint8 *buf;
+
+    file_id = Hopen(INDEX_FILE, DFACC_READ, 0);
+    if (file_id == FAIL)
+        return FAIL;
+    Vstart(file_id);
+    vgref = Vfindclass(file_id, _HDF_CDF);
+    if (vgref != FAIL && (length = Hlength(file_id, DFTAG_SDIDX, (uint16)vgref)) > 0 && version != NULL) {
+        buf = malloc((size_t)length);
+        if (buf != NULL && Hgetelement(file_id, DFTAG_SDIDX, (uint16)vgref, buf) == length)
+            *version = buf[1];
+        free(buf);
+    }
+    Vend(file_id);
+    Hclose(file_id);
+    return length;
+}
+
+static int
+test_metaindex()
+{
+    int32   fid, sds_id, file_id, vgref;
+    int32   sizes[2] = {INDEX_NX, INDEX_NY};
+    int32   start[2] = {0, 0};
+    int32   data[INDEX_NX][INDEX_NY];
+    float32 series[INDEX_NX];
+    int32   recs;
+    uint16  find_tag, find_ref;
+    int32   find_offset, find_length;
+    uint8   version = 0;
+    uint8   bad[2]  = {0, 99};
+    int     mode;
+    int     status;
+    int     num_errs = 0;
+
+    for (int i = 0; i < INDEX_NX; i++) {
+        series[i] = (float32)i;
+        for (int j = 0; j < INDEX_NY; j++)
+            data[i][j] = i * 10 + j;
+    }
+
+    /* Create a file without an index */
+    fid = SDstart(INDEX_FILE, DFACC_CREATE);
+    CHECK(fid, FAIL, "test_metaindex: SDstart");
+    status = SDsetattr(fid, "title", DFNT_CHAR8, 5, "index");
+    CHECK(status, FAIL, "test_metaindex: SDsetattr");
+
+    sds_id = SDcreate(fid, "grid", DFNT_INT32, 2, sizes);
+    CHECK(sds_id, FAIL, "test_metaindex: SDcreate");
+    status = SDsetdimname(SDgetdimid(sds_id, 0), "x");
+    CHECK(status, FAIL, "test_metaindex: SDsetdimname");
+    status = SDsetattr(sds_id, "units", DFNT_CHAR8, 1, "m");
+    CHECK(status, FAIL, "test_metaindex: SDsetattr");
+    status = SDwritedata(sds_id, start, NULL, sizes, data);
+    CHECK(status, FAIL, "test_metaindex: SDwritedata");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "test_metaindex: SDendaccess");
+
+    sizes[0] = SD_UNLIMITED;
+    sds_id   = SDcreate(fid, "series", DFNT_FLOAT32, 1, sizes);
+    CHECK(sds_id, FAIL, "test_metaindex: SDcreate");
+    recs   = 2;
+    status = SDwritedata(sds_id, start, NULL, &recs, series);
+    CHECK(status, FAIL, "test_metaindex: SDwritedata");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "test_metaindex: SDendaccess");
+
+    status = SDend(fid);
+    CHECK(status, FAIL, "test_metaindex: SDend");
+    VERIFY(metaindex_length(NULL), FAIL, "test_metaindex: index written unasked");
+
+    /* The index can only be asked for when the file is written to */
+    fid = SDstart(INDEX_FILE, DFACC_RDONLY);
+    CHECK(fid, FAIL, "test_metaindex: SDstart");
+    VERIFY(SDsetmetaindex(fid, TRUE), FAIL, "test_metaindex: SDsetmetaindex");
+    status = SDend(fid);
+    CHECK(status, FAIL, "test_metaindex: SDend");
+
+    /* Append records and have the index written */
+    fid = SDstart(INDEX_FILE, DFACC_RDWR);
+    CHECK(fid, FAIL, "test_metaindex: SDstart");
+    status = SDsetmetaindex(fid, TRUE);
+    CHECK(status, FAIL, "test_metaindex: SDsetmetaindex");
+    sds_id = SDselect(fid, SDnametoindex(fid, "series"));
+    CHECK(sds_id, FAIL, "test_metaindex: SDselect");
+    start[0] = 2;
+    recs     = 2;
+    status   = SDwritedata(sds_id, start, NULL, &recs, &series[2]);
+    CHECK(status, FAIL, "test_metaindex: SDwritedata");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "test_metaindex: SDendaccess");
+    status = SDend(fid);
+    CHECK(status, FAIL, "test_metaindex: SDend");
+
+    if (metaindex_length(&version) <= 0) {
+        fprintf(stderr, "test_metaindex: no index was written\n");
+        num_errs++;
+    }
+    VERIFY(version, 1, "test_metaindex: index version");
+
+    for (mode = SD_META_ALL; mode <= SD_META_LAZY; mode++) {
+        status = SDsetmetaload(mode);
+        CHECK(status, FAIL, "test_metaindex: SDsetmetaload");
+        num_errs += check_metaindex(2, 4);
+    }
+
+    /* Append records without the index; the number of records isn't kept
+       in the index, so it still matches the file */
+    fid = SDstart(INDEX_FILE, DFACC_RDWR);
+    CHECK(fid, FAIL, "test_metaindex: SDstart");
+    sds_id = SDselect(fid, SDnametoindex(fid, "series"));
+    CHECK(sds_id, FAIL, "test_metaindex: SDselect");
+    start[0] = 4;
+    recs     = 2;
+    status   = SDwritedata(sds_id, start, NULL, &recs, &series[4]);
+    CHECK(status, FAIL, "test_metaindex: SDwritedata");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "test_metaindex: SDendaccess");
+    status = SDend(fid);
+    CHECK(status, FAIL, "test_metaindex: SDend");
+    num_errs += check_metaindex(2, 6);
+
+    /* Add a data set without the index; the index no longer matches */
+    fid = SDstart(INDEX_FILE, DFACC_RDWR);
+    CHECK(fid, FAIL, "test_metaindex: SDstart");
+    sizes[0] = INDEX_NX;
+    sds_id   = SDcreate(fid, "added", DFNT_INT8, 1, sizes);
+    CHECK(sds_id, FAIL, "test_metaindex: SDcreate");
+    status = SDendaccess(sds_id);
+    CHECK(status, FAIL, "test_metaindex: SDendaccess");
+    status = SDend(fid);
+    CHECK(status, FAIL, "test_metaindex: SDend");
+    num_errs += check_metaindex(3, 6);
+
+    /* Write the index again, then give it a version which isn't known */
+    fid = SDstart(INDEX_FILE, DFACC_RDWR);
+    CHECK(fid, FAIL, "test_metaindex: SDstart");
+    status = SDsetmetaindex(fid, TRUE);
+    CHECK(status, FAIL, "test_metaindex: SDsetmetaindex");
+    status = SDend(fid);
+    CHECK(status, FAIL, "test_metaindex: SDend");
+
+    file_id = Hopen(INDEX_FILE, DFACC_RDWR, 0);
+    CHECK(file_id, FAIL, "test_metaindex: Hopen");
+    status = Vstart(file_id);
+    CHECK(status, FAIL, "test_metaindex: Vstart");
+    vgref = Vfindclass(file_id, _HDF_CDF);
+    CHECK(vgref, FAIL, "test_metaindex: Vfindclass");
+    find_tag = find_ref = 0;
+    status = Hfind(file_id, DFTAG_SDIDX, DFREF_WILDCARD, &find_tag, &find_ref, &find_offset, &find_length,
+                   DF_FORWARD);
+    CHECK(status, FAIL, "test_metaindex: Hfind");
+    VERIFY(find_ref, vgref, "test_metaindex: Hfind");
+    status = Hdeldd(file_id, DFTAG_SDIDX, (uint16)vgref);
+    CHECK(status, FAIL, "test_metaindex: Hdeldd");
+    status = Hputelement(file_id, DFTAG_SDIDX, (uint16)vgref, bad, 2);
+    CHECK(status, FAIL, "test_metaindex: Hputelement");
+    status = Vend(file_id);
+    CHECK(status, FAIL, "test_metaindex: Vend");
+    status = Hclose(file_id);
+    CHECK(status, FAIL, "test_metaindex: Hclose");
+    num_errs += check_metaindex(3, 6);
+
+    status = SDsetmetaload(SD_META_ALL);
+    CHECK(status, FAIL, "test_metaindex: SDsetmetaload");
+
+    return num_errs;
+}
+
+/********************************************************************
+   Name: test_nametoindex() - tests SDnametoindex on a changing file
+
+   Description:
+    The main contents include:
+    - create data sets, look one up by name, then create more, one of
+      them with the name of an earlier data set
+    - verify that the data sets created after the first lookup are found,
+      and that the first of the data sets with a name is the one found
+    - verify the same after the file is reopened
+
+   Return value:
+    The number of errors occurred in this routine.
+
+*********************************************************************/
+
+#define NAMES_FILE "nametoindex.hdf"
+
+static int
+test_nametoindex()
+{
+    int32       fid, sds_id, index;
+    int32       dims[1]  = {10};
+    const char *names[4] = {"data A", "data B", "data C", "data A"};
+    int         status;
+    int         num_errs = 0;
+
+    fid = SDstart(NAMES_FILE, DFACC_CREATE);
+    CHECK(fid, FAIL, "test_nametoindex: SDstart");
+    for (int i = 0; i < 4; i++) {
+        sds_id = SDcreate(fid, names[i], DFNT_INT16, 1, dims);
+        CHECK(sds_id, FAIL, "test_nametoindex: SDcreate");
+        status = SDendaccess(sds_id);
+        CHECK(status, FAIL, "test_nametoindex: SDendaccess");
+
+        if (i == 1) {
+            index = SDnametoindex(fid, "data B");
+            VERIFY(index, 1, "test_nametoindex: SDnametoindex");
+        }
+    }
+
+    index = SDnametoindex(fid, "data C");
+    VERIFY(index, 2, "test_nametoindex: SDnametoindex");
+    index = SDnametoindex(fid, "data A");
+    VERIFY(index, 0, "test_nametoindex: SDnametoindex");
+    index = SDnametoindex(fid, "data D");
+    VERIFY(index, FAIL, "test_nametoindex: SDnametoindex");
+    status = SDend(fid);
+    CHECK(status, FAIL, "test_nametoindex: SDend");
+
+    fid = SDstart(NAMES_FILE, DFACC_RDONLY);
+    CHECK(fid, FAIL, "test_nametoindex: SDstart");
+    index = SDnametoindex(fid, "data A");
+    VERIFY(index, 0, "test_nametoindex: SDnametoindex");
+    index = SDnametoindex(fid, "data B");
+    VERIFY(index, 1, "test_nametoindex: SDnametoindex");
+    index = SDnametoindex(fid, "data C");
+    VERIFY(index, 2, "test_nametoindex: SDnametoindex");
+    index = SDnametoindex(fid, "data D");
+    VERIFY(index, FAIL, "test_nametoindex: SDnametoindex");
+    status = SDend(fid);
+    CHECK(status, FAIL, "test_nametoindex: SDend");
+
+    return num_errs;
+}
+
 /* Test driver for testing miscellaneous file related APIs. */
 extern int
 test_files()
@@ -511,6 +1255,18 @@ test_files()
     /* Test SDstart on various scenarios */
     num_errs = num_errs + test_invalid_opening();
 
+    /* Test reading in the data sets' information lazily */
+    num_errs = num_errs + test_metaload();
+
+    /* Test that data sets are numbered the same way when read in lazily */
+    num_errs = num_errs + test_metaload_foreign();
+
+    /* Test the index of the metadata */
+    num_errs = num_errs + test_metaindex();
+
+    /* Test SDnametoindex as data sets are created */
+    num_errs = num_errs + test_nametoindex();
+
     if (num_errs == 0)
         PASSED();
     else
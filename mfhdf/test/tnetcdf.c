@@ -99,6 +99,186 @@ test_read_dim()
 
 } /* test_read_dim */
 
+/********************************************************************
+   Name: test_bufsize() - tests reading a netCDF file with different
+                          sizes of the I/O buffer.
+
+   Description:
+        Writes a netCDF file holding a byte variable and an int variable
+    of NC_BUFLEN values each, then reads them back whole, in slabs and
+    with a stride, with the default buffer and with the buffer set by
+    SDsetbufsize.  Whole reads of the byte variable go around the
+    buffer, and reads of the int variable go through it.
+
+   Return value:
+        The number of errors occurred in this routine.
+*********************************************************************/
+
+#define NC_BUFFILE "ncbuffer.nc"
+#define NC_BUFLEN  100000
+
+/* Writes a 32-bit value to the file, most significant byte first */
+static void
+put_be32(FILE *fp, uint32 val)
+{
+    uint8 buf[4];
+
+    buf[0] = (uint8)(val >> 24);
+    buf[1] = (uint8)(val >> 16);
+    buf[2] = (uint8)(val >> 8);
+    buf[3] = (uint8)val;
+    fwrite(buf, 1, 4, fp);
+}
+
+/* Writes the header of a variable named 'name' over dimension 0 */
+static void
+put_var(FILE *fp, const char *name, uint32 type, uint32 vsize, uint32 begin)
+{
+    put_be32(fp, 1); /* name */
+    fwrite(name, 1, 1, fp);
+    fwrite("\0\0\0", 1, 3, fp);
+    put_be32(fp, 1); /* rank */
+    put_be32(fp, 0); /* dimension ID */
+    put_be32(fp, 0); /* no attributes */
+    put_be32(fp, 0);
+    put_be32(fp, type);
+    put_be32(fp, vsize);
+    put_be32(fp, begin);
+}
+
+static int
+test_bufsize()
+{
+    FILE  *fp;
+    int32  fid, sds_id, status;
+    int32  start, stride, edge;
+    int8  *bdata  = NULL;
+    int32 *idata  = NULL;
+    int32  sizes[] = {0, SD_MIN_BUFSIZE, 65536};
+    uint32 begin   = 116; /* size of the header */
+    int    i, k;
+    int    num_errs = 0; /* number of errors so far */
+
+    bdata = (int8 *)malloc(NC_BUFLEN * sizeof(int8));
+    CHECK_ALLOC(bdata, "bdata", "test_bufsize");
+    idata = (int32 *)malloc(NC_BUFLEN * sizeof(int32));
+    CHECK_ALLOC(idata, "idata", "test_bufsize");
+
+    /* Write the file: one dimension, no attributes, variables 'b' and 'i' */
+    fp = fopen(NC_BUFFILE, "wb");
+    CHECK_ALLOC(fp, "fp", "test_bufsize");
+    fwrite("CDF\001", 1, 4, fp);
+    put_be32(fp, 0);  /* # of records */
+    put_be32(fp, 10); /* NC_DIMENSION */
+    put_be32(fp, 1);
+    put_be32(fp, 1); /* dimension 'n' */
+    fwrite("n\0\0\0", 1, 4, fp);
+    put_be32(fp, NC_BUFLEN);
+    put_be32(fp, 0); /* no attributes */
+    put_be32(fp, 0);
+    put_be32(fp, 11); /* NC_VARIABLE */
+    put_be32(fp, 2);
+    put_var(fp, "b", 1, NC_BUFLEN, begin);
+    put_var(fp, "i", 4, 4 * NC_BUFLEN, begin + NC_BUFLEN);
+    for (i = 0; i < NC_BUFLEN; i++)
+        fputc(i % 127, fp);
+    for (i = 0; i < NC_BUFLEN; i++)
+        put_be32(fp, (uint32)i);
+    fclose(fp);
+
+    for (k = 0; k < (int)(sizeof(sizes) / sizeof(sizes[0])); k++) {
+        fid = SDstart(NC_BUFFILE, DFACC_RDONLY);
+        CHECK(fid, FAIL, "SDstart");
+
+        /* Sizes out of range are refused */
+        status = SDsetbufsize(fid, SD_MIN_BUFSIZE - 1);
+        VERIFY(status, FAIL, "SDsetbufsize");
+        status = SDsetbufsize(fid, SD_MAX_BUFSIZE + 1);
+        VERIFY(status, FAIL, "SDsetbufsize");
+
+        if (sizes[k] != 0) {
+            status = SDsetbufsize(fid, sizes[k]);
+            CHECK(status, FAIL, "SDsetbufsize");
+        }
+
+        /* Read the bytes whole, then a slab at a time */
+        sds_id = SDselect(fid, 0);
+        CHECK(sds_id, FAIL, "SDselect");
+        start = 0;
+        edge  = NC_BUFLEN;
+        memset(bdata, 0xff, NC_BUFLEN);
+        status = SDreaddata(sds_id, &start, NULL, &edge, (void *)bdata);
+        CHECK(status, FAIL, "SDreaddata");
+        for (i = 0; i < NC_BUFLEN; i++)
+            if (bdata[i] != i % 127) {
+                fprintf(stderr, "test_bufsize: byte %d is %d, should be %d\n", i, bdata[i], i % 127);
+                num_errs++;
+                break;
+            }
+
+        memset(bdata, 0xff, NC_BUFLEN);
+        for (start = 0; start < NC_BUFLEN; start += edge) {
+            edge   = MIN(3001, NC_BUFLEN - start);
+            status = SDreaddata(sds_id, &start, NULL, &edge, (void *)(bdata + start));
+            CHECK(status, FAIL, "SDreaddata");
+        }
+        for (i = 0; i < NC_BUFLEN; i++)
+            if (bdata[i] != i % 127) {
+                fprintf(stderr, "test_bufsize: byte %d is %d, should be %d\n", i, bdata[i], i % 127);
+                num_errs++;
+                break;
+            }
+
+        status = SDendaccess(sds_id);
+        CHECK(status, FAIL, "SDendaccess");
+
+        /* Read the ints whole, then every 7th from the end of the file back */
+        sds_id = SDselect(fid, 1);
+        CHECK(sds_id, FAIL, "SDselect");
+        start = 0;
+        edge  = NC_BUFLEN;
+        memset(idata, 0xff, NC_BUFLEN * sizeof(int32));
+        status = SDreaddata(sds_id, &start, NULL, &edge, (void *)idata);
+        CHECK(status, FAIL, "SDreaddata");
+        for (i = 0; i < NC_BUFLEN; i++)
+            if (idata[i] != i) {
+                fprintf(stderr, "test_bufsize: int %d is %d\n", i, (int)idata[i]);
+                num_errs++;
+                break;
+            }
+
+        stride = 7;
+        edge   = 1;
+        for (start = NC_BUFLEN - 1; start >= 0; start -= 9973) {
+            status = SDreaddata(sds_id, &start, NULL, &edge, (void *)idata);
+            CHECK(status, FAIL, "SDreaddata");
+            VERIFY(idata[0], start, "SDreaddata");
+        }
+        start = 3;
+        edge  = (NC_BUFLEN - start + stride - 1) / stride;
+        status = SDreaddata(sds_id, &start, &stride, &edge, (void *)idata);
+        CHECK(status, FAIL, "SDreaddata");
+        for (i = 0; i < edge; i++)
+            if (idata[i] != start + i * stride) {
+                fprintf(stderr, "test_bufsize: int %d is %d\n", (int)(start + i * stride), (int)idata[i]);
+                num_errs++;
+                break;
+            }
+
+        status = SDendaccess(sds_id);
+        CHECK(status, FAIL, "SDendaccess");
+
+        status = SDend(fid);
+        CHECK(status, FAIL, "SDend");
+    }
+
+    free(bdata);
+    free(idata);
+
+    /* Return the number of errors that's been kept track of so far */
+    return num_errs;
+} /* test_bufsize */
+
 static int16 netcdf_u16[2][3] = {{1, 2, 3}, {4, 5, 6}};
 
 /* Tests reading of netCDF file 'test1.nc' using the SDxxx interface.
@@ -197,6 +377,9 @@ test_netcdf_reading()
     /* Test reading dimension scale - bugzilla 1644 */
     num_errs = num_errs + test_read_dim();
 
+    /* Test reading with different sizes of the I/O buffer */
+    num_errs = num_errs + test_bufsize();
+
     if (num_errs == 0)
         PASSED();
     return num_errs;